@@ -36,6 +36,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
 
 #ifdef __APPLE__
 #define ENOKEY 126
@@ -48,6 +54,338 @@ XrdOucTrace TkTrace(&TkEroute);
 /*----------------------------------------------------------------------------*/
 XrdCapability gCapabilityEngine;
 
+namespace
+{
+//------------------------------------------------------------------------------
+// Layout of the compact capability token:
+//
+// | version(1) | key digest(20) | iv(12) | sealed payload | gcm tag(16) |
+//
+// The header (version, key digest and iv) is authenticated as additional
+// data. The payload starts with the expiration timestamp as 8 bytes big
+// endian followed by the env entries. Each entry starts with a tag byte whose
+// lower 7 bits hold the index of the key in the dictionary below or 0 if the
+// key name follows as a length-prefixed string. If the upper bit of the tag
+// is set then the value is a varint encoded number, otherwise a
+// length-prefixed string. Lengths are varint encoded.
+//------------------------------------------------------------------------------
+const unsigned char kCompactVersion = 1;
+const size_t kDigestLen = SHA_DIGEST_LENGTH;
+const size_t kIvLen = 12;
+const size_t kTagLen = 16;
+const size_t kHeaderLen = 1 + kDigestLen + kIvLen;
+const unsigned char kNumericFlag = 0x80;
+const size_t kMaxCachedContexts = 16;
+
+//! Well known capability keys - the index is part of the wire format therefore
+//! new keys must only be appended and never exceed 127 entries
+const char* const sDictionary[] = {
+  "", "mgm.access", "mgm.ruid", "mgm.rgid", "mgm.uid", "mgm.gid", "mgm.path",
+  "mgm.manager", "mgm.fid", "mgm.cid", "mgm.sec", "mgm.lid", "mgm.bookingsize",
+  "mgm.fsid", "mgm.localprefix", "mgm.targetsize", "mgm.minsize",
+  "mgm.maxsize", "mgm.container", "mgm.logid", "mgm.replicaindex",
+  "mgm.replicahead", "mgm.drainfsid", "mgm.sourcehostport",
+  "mgm.targethostport", "mgm.blockchecksum", "mgm.checksum", "mgm.etag",
+  "mgm.mtime", "mgm.id", "mgm.cmd", "mgm.subcmd", "mgm.fids", "mgm.time",
+  "mgm.url0", "mgm.url1", "mgm.url2", "mgm.url3", "mgm.url4", "mgm.url5",
+  "mgm.url6", "mgm.url7", "mgm.fsid0", "mgm.fsid1", "mgm.fsid2", "mgm.fsid3",
+  "mgm.fsid4", "mgm.fsid5", "mgm.fsid6", "mgm.fsid7"
+};
+
+const size_t kDictionarySize = sizeof(sDictionary) / sizeof(sDictionary[0]);
+
+//------------------------------------------------------------------------------
+// Get dictionary index of the key, 0 if not found
+//------------------------------------------------------------------------------
+unsigned char
+GetDictionaryIndex(const char* key, size_t len)
+{
+  for (size_t i = 1; i < kDictionarySize; ++i) {
+    if ((strncmp(sDictionary[i], key, len) == 0) &&
+        (sDictionary[i][len] == '\0')) {
+      return static_cast<unsigned char>(i);
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Varint encoding/decoding
+//------------------------------------------------------------------------------
+void
+PutVarint(std::string& out, uint64_t val)
+{
+  while (val >= 0x80) {
+    out += static_cast<char>((val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+
+  out += static_cast<char>(val);
+}
+
+bool
+GetVarint(const std::string& in, size_t& pos, uint64_t& val)
+{
+  val = 0;
+
+  for (int shift = 0; (shift < 64) && (pos < in.size()); shift += 7) {
+    unsigned char byte = in[pos++];
+    val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool
+GetString(const std::string& in, size_t& pos, const char*& data, size_t& len)
+{
+  uint64_t val;
+
+  if (!GetVarint(in, pos, val) || (val > in.size() - pos)) {
+    return false;
+  }
+
+  data = in.data() + pos;
+  len = val;
+  pos += len;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Check if value is a canonical decimal number which survives a round-trip
+// through the varint encoding
+//------------------------------------------------------------------------------
+bool
+IsCanonicalNumber(const char* val, size_t len, uint64_t& num)
+{
+  if ((len == 0) || (len > 19) || ((len > 1) && (val[0] == '0'))) {
+    return false;
+  }
+
+  num = 0;
+
+  for (size_t i = 0; i < len; ++i) {
+    if ((val[i] < '0') || (val[i] > '9')) {
+      return false;
+    }
+
+    num = num * 10 + (val[i] - '0');
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Base64 encoding, URL-safe without padding or the standard alphabet
+//------------------------------------------------------------------------------
+void
+Base64Encode(const unsigned char* in, size_t len, std::string& out,
+             bool url_safe)
+{
+  static const char* std_chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  static const char* url_chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  const char* chars = (url_safe ? url_chars : std_chars);
+  out.reserve(out.size() + ((len + 2) / 3) * 4);
+  size_t i = 0;
+
+  for (; i + 2 < len; i += 3) {
+    uint32_t val = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    out += chars[(val >> 18) & 0x3f];
+    out += chars[(val >> 12) & 0x3f];
+    out += chars[(val >> 6) & 0x3f];
+    out += chars[val & 0x3f];
+  }
+
+  if (i < len) {
+    uint32_t val = in[i] << 16;
+
+    if (i + 1 < len) {
+      val |= in[i + 1] << 8;
+    }
+
+    out += chars[(val >> 18) & 0x3f];
+    out += chars[(val >> 12) & 0x3f];
+
+    if (i + 1 < len) {
+      out += chars[(val >> 6) & 0x3f];
+    } else if (!url_safe) {
+      out += '=';
+    }
+
+    if (!url_safe) {
+      out += '=';
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// URL-safe base64 decoding
+//------------------------------------------------------------------------------
+bool
+Base64UrlDecode(const char* in, std::string& out)
+{
+  uint32_t val = 0;
+  int bits = 0;
+
+  for (const char* ptr = in; *ptr; ++ptr) {
+    char c = *ptr;
+    uint32_t sextet;
+
+    if ((c >= 'A') && (c <= 'Z')) {
+      sextet = c - 'A';
+    } else if ((c >= 'a') && (c <= 'z')) {
+      sextet = c - 'a' + 26;
+    } else if ((c >= '0') && (c <= '9')) {
+      sextet = c - '0' + 52;
+    } else if (c == '-') {
+      sextet = 62;
+    } else if (c == '_') {
+      sextet = 63;
+    } else {
+      return false;
+    }
+
+    val = (val << 6) | sextet;
+    bits += 6;
+
+    if (bits >= 8) {
+      bits -= 8;
+      out += static_cast<char>((val >> bits) & 0xff);
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+//! AES-256-GCM contexts for one symmetric key. The contexts are initialized
+//! once with the derived key so that sealing/opening only needs a new iv.
+//------------------------------------------------------------------------------
+class CipherContext
+{
+public:
+  explicit CipherContext(const char* key):
+    mEncCtx(EVP_CIPHER_CTX_new()), mDecCtx(EVP_CIPHER_CTX_new())
+  {
+    // Derive a dedicated AEAD key from the shared symmetric key
+    static const char* label = "eos.capability.v1";
+    unsigned char material[32 + kDigestLen];
+    unsigned char aead_key[EVP_MAX_MD_SIZE];
+    unsigned int aead_key_len = 0;
+    size_t label_len = strlen(label);
+    memcpy(material, label, label_len);
+    memcpy(material + label_len, key, kDigestLen);
+    mOk = (mEncCtx && mDecCtx &&
+           EVP_Digest(material, label_len + kDigestLen, aead_key, &aead_key_len,
+                      EVP_sha256(), nullptr) &&
+           EVP_EncryptInit_ex(mEncCtx, EVP_aes_256_gcm(), nullptr, aead_key,
+                              nullptr) &&
+           EVP_DecryptInit_ex(mDecCtx, EVP_aes_256_gcm(), nullptr, aead_key,
+                              nullptr));
+    OPENSSL_cleanse(aead_key, sizeof(aead_key));
+    OPENSSL_cleanse(material, sizeof(material));
+  }
+
+  ~CipherContext()
+  {
+    EVP_CIPHER_CTX_free(mEncCtx);
+    EVP_CIPHER_CTX_free(mDecCtx);
+  }
+
+  //----------------------------------------------------------------------------
+  //! Seal payload and append it together with the tag to the token which
+  //! already holds the header
+  //----------------------------------------------------------------------------
+  bool
+  Seal(std::string& token, const std::string& payload)
+  {
+    const unsigned char* header = (const unsigned char*) token.data();
+    int len = 0;
+    size_t offset = token.size();
+    token.resize(offset + payload.size() + kTagLen);
+    unsigned char* out = (unsigned char*) &token[offset];
+
+    if (!mOk ||
+        !EVP_EncryptInit_ex(mEncCtx, nullptr, nullptr, nullptr,
+                            header + 1 + kDigestLen) ||
+        !EVP_EncryptUpdate(mEncCtx, nullptr, &len, header, kHeaderLen) ||
+        !EVP_EncryptUpdate(mEncCtx, out, &len,
+                           (const unsigned char*) payload.data(),
+                           payload.size()) ||
+        !EVP_EncryptFinal_ex(mEncCtx, out + len, &len) ||
+        !EVP_CIPHER_CTX_ctrl(mEncCtx, EVP_CTRL_GCM_GET_TAG, kTagLen,
+                             out + payload.size())) {
+      return false;
+    }
+
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Verify and open the sealed payload of the token
+  //----------------------------------------------------------------------------
+  bool
+  Open(const std::string& token, std::string& payload)
+  {
+    const unsigned char* header = (const unsigned char*) token.data();
+    size_t sealed_len = token.size() - kHeaderLen - kTagLen;
+    int len = 0;
+    payload.resize(sealed_len);
+    unsigned char* out = (unsigned char*) &payload[0];
+
+    if (!mOk ||
+        !EVP_DecryptInit_ex(mDecCtx, nullptr, nullptr, nullptr,
+                            header + 1 + kDigestLen) ||
+        !EVP_DecryptUpdate(mDecCtx, nullptr, &len, header, kHeaderLen) ||
+        !EVP_DecryptUpdate(mDecCtx, out, &len, header + kHeaderLen, sealed_len) ||
+        !EVP_CIPHER_CTX_ctrl(mDecCtx, EVP_CTRL_GCM_SET_TAG, kTagLen,
+                             (void*)(header + kHeaderLen + sealed_len)) ||
+        (EVP_DecryptFinal_ex(mDecCtx, out + len, &len) <= 0)) {
+      return false;
+    }
+
+    return true;
+  }
+
+private:
+  EVP_CIPHER_CTX* mEncCtx; ///< Encryption context
+  EVP_CIPHER_CTX* mDecCtx; ///< Decryption context
+  bool mOk; ///< Flag if contexts are initialized
+};
+
+//------------------------------------------------------------------------------
+// Get cipher context of the key - the contexts are not thread-safe so every
+// thread keeps its own cache indexed by the key digest
+//------------------------------------------------------------------------------
+CipherContext*
+GetCipherContext(eos::common::SymKey* key)
+{
+  static thread_local std::map<std::string, std::unique_ptr<CipherContext>>
+      cache;
+  std::string digest(key->GetDigest(), kDigestLen);
+  auto it = cache.find(digest);
+
+  if (it == cache.end()) {
+    // Keys are rotated rarely, just drop everything once the cache is full
+    if (cache.size() >= kMaxCachedContexts) {
+      cache.clear();
+    }
+
+    it = cache.emplace(digest, std::unique_ptr<CipherContext>
+                       (new CipherContext(key->GetKey()))).first;
+  }
+
+  return it->second.get();
+}
+}
+
 /*----------------------------------------------------------------------------*/
 XrdAccPrivs
 XrdCapability::Access(const XrdSecEntity*    Entity,
@@ -103,7 +441,8 @@ int
 XrdCapability::Create(XrdOucEnv* inenv,
                       XrdOucEnv*& outenv,
                       eos::common::SymKey* key,
-                      uint64_t cap_validity)
+                      uint64_t cap_validity,
+                      Format format)
 {
   outenv = 0;
 
@@ -116,6 +455,12 @@ XrdCapability::Create(XrdOucEnv* inenv,
   }
 
   int envlen;
+
+  if (format == Format::kCompact) {
+    return CreateCompact(inenv->Env(envlen), outenv, key,
+                         time(NULL) + cap_validity);
+  }
+
   XrdOucString toencrypt = inenv->Env(envlen);
   // Add the validity time - default 1 hour
   toencrypt += "&cap.valid=";
@@ -157,6 +502,12 @@ XrdCapability::Extract(XrdOucEnv* inenv, XrdOucEnv*& outenv)
     return EINVAL;
   }
 
+  const char* token = inenv->Get("cap.bin");
+
+  if (token) {
+    return ExtractCompact(token, outenv);
+  }
+
   int envlen;
   XrdOucString instring = inenv->Env(envlen);
 
@@ -210,6 +561,162 @@ XrdCapability::Extract(XrdOucEnv* inenv, XrdOucEnv*& outenv)
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+int
+XrdCapability::CreateCompact(const char* env, XrdOucEnv*& outenv,
+                             eos::common::SymKey* key, uint64_t valid_until)
+{
+  std::string payload;
+  payload.reserve(strlen(env) + 8);
+
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    payload += static_cast<char>((valid_until >> shift) & 0xff);
+  }
+
+  // Encode the key=value pairs of the env, same as XrdOucEnv entries without
+  // a key or without a value assignment are skipped
+  for (const char* ptr = env; *ptr;) {
+    const char* end = strchr(ptr, '&');
+
+    if (!end) {
+      end = ptr + strlen(ptr);
+    }
+
+    const char* eq = (const char*) memchr(ptr, '=', end - ptr);
+
+    if (eq && (eq != ptr)) {
+      size_t key_len = eq - ptr;
+      const char* val = eq + 1;
+      size_t val_len = end - val;
+      unsigned char tag = GetDictionaryIndex(ptr, key_len);
+      uint64_t num;
+      bool is_num = IsCanonicalNumber(val, val_len, num);
+      payload += static_cast<char>(tag | (is_num ? kNumericFlag : 0));
+
+      if (tag == 0) {
+        PutVarint(payload, key_len);
+        payload.append(ptr, key_len);
+      }
+
+      if (is_num) {
+        PutVarint(payload, num);
+      } else {
+        PutVarint(payload, val_len);
+        payload.append(val, val_len);
+      }
+    }
+
+    ptr = (*end ? end + 1 : end);
+  }
+
+  unsigned char iv[kIvLen];
+
+  if (RAND_bytes(iv, kIvLen) != 1) {
+    return EKEYREJECTED;
+  }
+
+  std::string token;
+  token.reserve(kHeaderLen + payload.size() + kTagLen);
+  token += static_cast<char>(kCompactVersion);
+  token.append(key->GetDigest(), kDigestLen);
+  token.append((const char*) iv, kIvLen);
+
+  if (!GetCipherContext(key)->Seal(token, payload)) {
+    return EKEYREJECTED;
+  }
+
+  std::string encenv = "cap.bin=";
+  Base64Encode((const unsigned char*) token.data(), token.size(), encenv, true);
+  outenv = new XrdOucEnv(encenv.c_str());
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int
+XrdCapability::ExtractCompact(const char* token, XrdOucEnv*& outenv)
+{
+  std::string raw;
+
+  if (!Base64UrlDecode(token, raw) || (raw.size() < kHeaderLen + 8 + kTagLen) ||
+      (static_cast<unsigned char>(raw[0]) != kCompactVersion)) {
+    return EINVAL;
+  }
+
+  std::string digest64;
+  Base64Encode((const unsigned char*) raw.data() + 1, kDigestLen, digest64,
+               false);
+  eos::common::SymKey* key = eos::common::gSymKeyStore.GetKey(digest64.c_str());
+
+  if (!key) {
+    return ENOKEY;
+  }
+
+  std::string payload;
+
+  if (!GetCipherContext(key)->Open(raw, payload)) {
+    return EKEYREJECTED;
+  }
+
+  uint64_t valid_until = 0;
+
+  for (size_t i = 0; i < 8; ++i) {
+    valid_until = (valid_until << 8) | static_cast<unsigned char>(payload[i]);
+  }
+
+  std::string env;
+  env.reserve(2 * payload.size());
+
+  for (size_t pos = 8; pos < payload.size();) {
+    unsigned char tag = payload[pos++];
+    unsigned char index = tag & ~kNumericFlag;
+    const char* data;
+    size_t len;
+
+    if (index == 0) {
+      if (!GetString(payload, pos, data, len)) {
+        return EINVAL;
+      }
+
+      env.append(data, len);
+    } else if (index < kDictionarySize) {
+      env += sDictionary[index];
+    } else {
+      return EINVAL;
+    }
+
+    env += '=';
+
+    if (tag & kNumericFlag) {
+      uint64_t num;
+
+      if (!GetVarint(payload, pos, num)) {
+        return EINVAL;
+      }
+
+      env += std::to_string(num);
+    } else {
+      if (!GetString(payload, pos, data, len)) {
+        return EINVAL;
+      }
+
+      env.append(data, len);
+    }
+
+    env += '&';
+  }
+
+  env += "cap.valid=";
+  env += std::to_string(valid_until);
+  outenv = new XrdOucEnv(env.c_str());
+
+  // capability expired!
+  if (valid_until < (uint64_t) time(NULL)) {
+    return ETIME;
+  }
+
+  return 0;
+}
+
 //------------------------------------------------------------------------------
 // Destructor
 //------------------------------------------------------------------------------
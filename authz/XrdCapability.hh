@@ -54,6 +54,14 @@ extern "C" XrdAccAuthorize* XrdAccAuthorizeObject(XrdSysLogger* lp,
 class XrdCapability
 {
 public:
+  //----------------------------------------------------------------------------
+  //! Capability encoding formats, Extract accepts both of them
+  //----------------------------------------------------------------------------
+  enum class Format {
+    kLegacy, ///< Encrypted and base64 encoded env in cap.sym and cap.msg
+    kCompact ///< Versioned binary token sealed with AES-GCM in cap.bin
+  };
+
   /* Access() indicates whether or not the user/host is permitted access to the
      path for the specified operation. The default implementation that is
      statically linked determines privileges by combining user, host, user group,
@@ -99,14 +107,56 @@ public:
 
   XrdCapability() {}
 
+  //----------------------------------------------------------------------------
+  //! Create capability
+  //!
+  //! @param inenv env to be encoded
+  //! @param outenv newly allocated env holding the capability
+  //! @param symkey key used to encrypt the capability
+  //! @param cap_validity validity of the capability in seconds
+  //! @param format capability encoding
+  //!
+  //! @return 0 if successful, otherwise errno
+  //----------------------------------------------------------------------------
   static int Create(XrdOucEnv* inenv, XrdOucEnv*& outenv,
-                    eos::common::SymKey* symkey, uint64_t cap_validity);
-
+                    eos::common::SymKey* symkey, uint64_t cap_validity,
+                    Format format = Format::kLegacy);
+
+  //----------------------------------------------------------------------------
+  //! Extract capability in any of the supported formats
+  //!
+  //! @param inenv env holding the capability
+  //! @param outenv newly allocated env holding the decoded capability
+  //!
+  //! @return 0 if successful, otherwise errno
+  //----------------------------------------------------------------------------
   static int Extract(XrdOucEnv* inenv, XrdOucEnv*& outenv);
 
   virtual                  ~XrdCapability();
 
 private:
+  //----------------------------------------------------------------------------
+  //! Create capability in the compact format
+  //!
+  //! @param env env string to be encoded
+  //! @param outenv newly allocated env holding the capability
+  //! @param symkey key used to seal the capability
+  //! @param valid_until expiration timestamp
+  //!
+  //! @return 0 if successful, otherwise errno
+  //----------------------------------------------------------------------------
+  static int CreateCompact(const char* env, XrdOucEnv*& outenv,
+                           eos::common::SymKey* symkey, uint64_t valid_until);
+
+  //----------------------------------------------------------------------------
+  //! Extract capability in the compact format
+  //!
+  //! @param token URL-safe base64 encoded token
+  //! @param outenv newly allocated env holding the decoded capability
+  //!
+  //! @return 0 if successful, otherwise errno
+  //----------------------------------------------------------------------------
+  static int ExtractCompact(const char* token, XrdOucEnv*& outenv);
 };
 
 /*----------------------------------------------------------------------------*/
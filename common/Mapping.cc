@@ -31,6 +31,11 @@
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysDNS.hh"
 /*----------------------------------------------------------------------------*/
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+/*----------------------------------------------------------------------------*/
 
 EOSCOMMONNAMESPACE_BEGIN
 
@@ -67,7 +72,19 @@ std::map<gid_t, std::string> Mapping::gPhysicalGroupNameCache;
 std::map<std::string, uid_t> Mapping::gPhysicalUserIdCache;
 std::map<std::string, gid_t> Mapping::gPhysicalGroupIdCache;
 
+std::map<std::string, time_t> Mapping::gPhysicalNegativeCache;
+
 Mapping::ip_cache Mapping::gIpCache(300);
+
+Mapping::vid_cache Mapping::gVidCache(getenv("EOS_IDMAP_CACHE_LIFETIME") ?
+                                      atoi(getenv("EOS_IDMAP_CACHE_LIFETIME")) :
+                                      60);
+std::atomic<unsigned long long> Mapping::gMapGeneration(0);
+
+//! Lifetime of the negative physical lookup cache entries
+static const time_t sNegativeCacheLifetime = 60;
+//! Maximum number of queued identity refreshes
+static const size_t sMaxQueuedRefreshes = 1024;
 /*----------------------------------------------------------------------------*/
 /**
  * Initialize Google maps
@@ -100,11 +117,59 @@ Mapping::Reset()
     gPhysicalUserNameCache.clear();
     gPhysicalGroupIdCache.clear();
     gPhysicalUserIdCache.clear();
+    gPhysicalNegativeCache.clear();
   }
   {
     XrdSysMutexHelper mLock(ActiveLock);
     ActiveTidents.clear();
   }
+  InvalidateIdMapCache();
+}
+
+//------------------------------------------------------------------------------
+// Drop the cached identities
+//------------------------------------------------------------------------------
+void
+Mapping::InvalidateIdMapCache()
+{
+  // entries stored concurrently by a mapping done with the old rules carry
+  // the old generation and are never returned
+  gMapGeneration++;
+  gVidCache.Clear();
+}
+
+//------------------------------------------------------------------------------
+// Check for a failed physical lookup in the negative cache
+//------------------------------------------------------------------------------
+bool
+Mapping::IsNegativeCached(const std::string& key)
+{
+  XrdSysMutexHelper cMutex(gPhysicalNameCacheMutex);
+  auto it = gPhysicalNegativeCache.find(key);
+  return ((it != gPhysicalNegativeCache.end()) && (it->second > time(NULL)));
+}
+
+//------------------------------------------------------------------------------
+// Add a failed physical lookup to the negative cache
+//------------------------------------------------------------------------------
+void
+Mapping::AddNegativeCache(const std::string& key)
+{
+  time_t now = time(NULL);
+  XrdSysMutexHelper cMutex(gPhysicalNameCacheMutex);
+
+  if (gPhysicalNegativeCache.size() > 65536) {
+    for (auto it = gPhysicalNegativeCache.begin();
+         it != gPhysicalNegativeCache.end();) {
+      if (it->second <= now) {
+        it = gPhysicalNegativeCache.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  gPhysicalNegativeCache[key] = now + sNegativeCacheLifetime;
 }
 
 
@@ -163,11 +228,88 @@ Mapping::IdMap(const XrdSecEntity* client, const char* env, const char* tident,
     return;
   }
 
+  XrdOucEnv Env(env);
+  std::string key;
+  bool cached = false;
+  bool refresh = false;
+
+  // an externally set geo location is an input of the mapping
+  if (gVidCache.GetLifeTime() && !vid.geolocation.length()) {
+    key = IdMapCacheKey(client, Env, tident);
+    cached = gVidCache.Get(key, gMapGeneration.load(), vid, refresh);
+  }
+
+  if (cached) {
+    vid.tident = tident;
+
+    if (refresh) {
+      IdMapRefresh(key, client, Env, tident);
+    }
+  } else {
+    unsigned long long generation = 0;
+    IdMapUncached(client, Env, tident, vid, generation);
+
+    if (key.length()) {
+      gVidCache.Put(key, generation, vid);
+    }
+  }
+
+  time_t now = time(NULL);
+  XrdOucString mytident = "";
+  XrdOucString wildcardtident = "";
+  XrdOucString host = "";
+  ReduceTident(vid.tident, wildcardtident, mytident, host);
+
+  // ---------------------------------------------------------------------------
+  // Maintain the active client map and expire old entries
+  // ---------------------------------------------------------------------------
+  ActiveLock.Lock();
+
+  // ---------------------------------------------------------------------------
+  // safty measures not to exceed memory by 'nasty' clients
+  // ---------------------------------------------------------------------------
+  if (ActiveTidents.size() > 25000) {
+    ActiveExpire();
+  }
+
+  if (ActiveTidents.size() < 60000) {
+    char actident[1024];
+    snprintf(actident, sizeof(actident) - 1, "%d^%s^%s^%s^%s", vid.uid,
+             mytident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
+    std::string intident = actident;
+    ActiveTidents[intident] = now;
+  }
+
+  ActiveLock.UnLock();
+  eos_static_debug("selected %d %d cached=%d", vid.uid, vid.gid, cached);
+
+  if (log) {
+    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client,
+                    Env.Get("eos.app")).c_str(), tident);
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * Map a client to its virtual identity without the identity cache
+ *
+ * @param client xrootd client authenticatino object
+ * @param Env opaque information containing role selection like 'eos.ruid' and 'eos.rgid'
+ * @param tident trace identifier of the client
+ * @param vid returned virtual identity
+ * @param generation returned generation of the mapping rules used
+ */
+
+/*----------------------------------------------------------------------------*/
+void
+Mapping::IdMapUncached(const XrdSecEntity* client, XrdOucEnv& Env,
+                       const char* tident, Mapping::VirtualIdentity& vid,
+                       unsigned long long& generation)
+{
   eos_static_debug("name:%s role:%s group:%s tident:%s", client->name,
                    client->role, client->grps, client->tident);
   // you first are 'nobody'
   Nobody(vid);
-  XrdOucEnv Env(env);
   vid.name = client->name;
   vid.tident = tident;
   vid.sudoer = false;
@@ -182,6 +324,7 @@ Mapping::IdMap(const XrdSecEntity* client, const char* env, const char* tident,
   useralias += "uid";
   groupalias += "gid";
   RWMutexReadLock lock(gMapMutex);
+  generation = gMapGeneration.load();
   vid.prot = client->prot;
 
   // ---------------------------------------------------------------------------
@@ -793,8 +936,6 @@ Mapping::IdMap(const XrdSecEntity* client, const char* env, const char* tident,
     vid.app = rapp.c_str();
   }
 
-  time_t now = time(NULL);
-
   // ---------------------------------------------------------------------------
   // Check the Geo Location
   // ---------------------------------------------------------------------------
@@ -830,35 +971,155 @@ Mapping::IdMap(const XrdSecEntity* client, const char* env, const char* tident,
     }
   }
 
-  // ---------------------------------------------------------------------------
-  // Maintain the active client map and expire old entries
-  // ---------------------------------------------------------------------------
-  ActiveLock.Lock();
+  eos_static_debug("mapped %d %d [%s %s]", vid.uid, vid.gid, ruid.c_str(),
+                   rgid.c_str());
+}
 
-  // ---------------------------------------------------------------------------
-  // safty measures not to exceed memory by 'nasty' clients
-  // ---------------------------------------------------------------------------
-  if (ActiveTidents.size() > 25000) {
-    ActiveExpire();
+//------------------------------------------------------------------------------
+// Build the identity cache key of a client. It holds everything IdMap uses
+// except the connection part of the tident which does not change the mapping.
+//------------------------------------------------------------------------------
+std::string
+Mapping::IdMapCacheKey(const XrdSecEntity* client, XrdOucEnv& env,
+                       const char* tident)
+{
+  if (!tident) {
+    return "";
   }
 
-  if (ActiveTidents.size() < 60000) {
-    char actident[1024];
-    snprintf(actident, sizeof(actident) - 1, "%d^%s^%s^%s^%s", vid.uid,
-             mytident.c_str(), vid.prot.c_str(), vid.host.c_str(), vid.app.c_str());
-    std::string intident = actident;
-    ActiveTidents[intident] = now;
+  XrdOucString stident = tident;
+  XrdOucString mytident = "";
+  XrdOucString wildcardtident = "";
+  XrdOucString host = "";
+  ReduceTident(stident, wildcardtident, mytident, host);
+  const char* fields[] = {
+    client->prot, client->name, client->grps, client->role, client->host,
+    mytident.c_str(), env.Get("eos.ruid"), env.Get("eos.rgid"), env.Get("eos.app")
+  };
+  std::string key;
+
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    // distinguish a missing field from an empty one
+    if (fields[i]) {
+      key += fields[i];
+    } else {
+      key += '\002';
+    }
+
+    key += '\001';
   }
 
-  ActiveLock.UnLock();
-  eos_static_debug("selected %d %d [%s %s]", vid.uid, vid.gid, ruid.c_str(),
-                   rgid.c_str());
+  return key;
+}
 
-  if (log) {
-    eos_static_info("%s sec.tident=\"%s\"", eos::common::SecEntity::ToString(client,
-                    Env.Get("eos.app")).c_str(), tident);
+//------------------------------------------------------------------------------
+// Asynchronous refresh of the identity cache entries. The mapping may need
+// password and group database lookups which are done by a single background
+// thread instead of the request.
+//------------------------------------------------------------------------------
+namespace
+{
+struct IdMapRefreshJob {
+  std::string key;
+  std::string prot;
+  std::string name[4]; // name, grps, role, host
+  bool isset[4];
+  std::string env;
+  std::string tident;
+};
+
+struct IdMapRefreshQueue {
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  std::deque<IdMapRefreshJob> mJobs;
+};
+
+// never destroyed since the refresh thread is detached
+IdMapRefreshQueue&
+GetRefreshQueue()
+{
+  static IdMapRefreshQueue* sQueue = new IdMapRefreshQueue();
+  return *sQueue;
+}
+
+void
+IdMapRefreshLoop()
+{
+  IdMapRefreshQueue& queue = GetRefreshQueue();
+
+  while (true) {
+    IdMapRefreshJob job;
+    {
+      std::unique_lock<std::mutex> lock(queue.mMutex);
+
+      while (queue.mJobs.empty()) {
+        queue.mCond.wait(lock);
+      }
+
+      job = queue.mJobs.front();
+      queue.mJobs.pop_front();
+    }
+    XrdSecEntity client(job.prot.c_str());
+    char** fields[] = { &client.name, &client.grps, &client.role, &client.host };
+
+    for (size_t i = 0; i < 4; i++) {
+      *fields[i] = job.isset[i] ? (char*) job.name[i].c_str() : 0;
+    }
+
+    XrdOucEnv env(job.env.c_str());
+    Mapping::VirtualIdentity vid;
+    unsigned long long generation = 0;
+    Mapping::IdMapUncached(&client, env, job.tident.c_str(), vid, generation);
+    Mapping::gVidCache.Put(job.key, generation, vid);
+    // the entity does not own the strings
+    client.name = client.grps = client.role = client.host = 0;
   }
 }
+}
+
+void
+Mapping::IdMapRefresh(const std::string& key, const XrdSecEntity* client,
+                      XrdOucEnv& env, const char* tident)
+{
+  static std::once_flag sStarted;
+  IdMapRefreshJob job;
+  job.key = key;
+  job.prot = client->prot;
+  const char* fields[] = { client->name, client->grps, client->role, client->host };
+
+  for (size_t i = 0; i < 4; i++) {
+    job.isset[i] = (fields[i] != 0);
+    job.name[i] = fields[i] ? fields[i] : "";
+  }
+
+  // only the role selection and the application are used by the mapping
+  const char* keys[] = { "eos.ruid", "eos.rgid", "eos.app" };
+
+  for (size_t i = 0; i < 3; i++) {
+    const char* val = env.Get(keys[i]);
+
+    if (val) {
+      job.env += "&";
+      job.env += keys[i];
+      job.env += "=";
+      job.env += val;
+    }
+  }
+
+  job.tident = tident;
+  std::call_once(sStarted, []() {
+    std::thread(IdMapRefreshLoop).detach();
+  });
+  IdMapRefreshQueue& queue = GetRefreshQueue();
+  std::lock_guard<std::mutex> lock(queue.mMutex);
+
+  if (queue.mJobs.size() < sMaxQueuedRefreshes) {
+    queue.mJobs.push_back(job);
+    queue.mCond.notify_one();
+  }
+
+  // if the queue is full the entry expires and is computed by a request
+}
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -1225,8 +1486,16 @@ Mapping::getPhysicalIds(const char* name, VirtualIdentity& vid)
     if (use_pw) {
       gPhysicalIdMutex.UnLock();
       struct passwd* pwbufp = 0;
+      std::string negkey = "n:";
+      negkey += name;
+
+      if (IsNegativeCached(negkey)) {
+        return;
+      }
+
       {
         if (getpwnam_r(name, &passwdinfo, buffer, 16384, &pwbufp) || (!pwbufp)) {
+          AddNegativeCache(negkey);
           return;
         }
       }
@@ -1321,6 +1590,13 @@ Mapping::UidToUserName(uid_t uid, int& errc)
   std::string uid_string = "";
   struct passwd pwbuf;
   struct passwd* pwbufp = 0;
+  std::string negkey = "u:" + UidAsString(uid);
+
+  if (IsNegativeCached(negkey)) {
+    errc = EINVAL;
+    return UidAsString(uid);
+  }
+
   (void) getpwuid_r(uid, &pwbuf, buffer, buflen, &pwbufp);
 
   if (pwbufp == NULL) {
@@ -1335,7 +1611,8 @@ Mapping::UidToUserName(uid_t uid, int& errc)
         snprintf(suid, sizeof(suid) - 1, "%u", uid);
         uid_string = suid;
         errc = EINVAL;
-        return uid_string; // don't cache this one
+        AddNegativeCache(negkey);
+        return uid_string; // only in the negative cache
       } else {
         uid_string = pwbuf.pw_name;
         errc = 0;
@@ -1384,6 +1661,12 @@ Mapping::GidToGroupName(gid_t gid, int& errc)
     struct group grbuf;
     struct group* grbufp = 0;
     std::string gid_string = "";
+    std::string negkey = "g:" + GidAsString(gid);
+
+    if (IsNegativeCached(negkey)) {
+      errc = EINVAL;
+      return GidAsString(gid);
+    }
 
     if (getgrgid_r(gid, &grbuf, buffer, buflen, &grbufp) || (!grbufp)) {
       // cannot translate this name
@@ -1391,7 +1674,8 @@ Mapping::GidToGroupName(gid_t gid, int& errc)
       snprintf(sgid, sizeof(sgid) - 1, "%u", gid);
       gid_string = sgid;
       errc = EINVAL;
-      return gid_string; // don't cache this one
+      AddNegativeCache(negkey);
+      return gid_string; // only in the negative cache
     } else {
       gid_string = grbuf.gr_name;
       errc = 0;
@@ -1578,5 +1862,78 @@ Mapping::ip_cache::GetIp(const char* hostname)
     return "";
   }
 }
+//------------------------------------------------------------------------------
+// Get an identity from the cache
+//------------------------------------------------------------------------------
+bool
+Mapping::vid_cache::Get(const std::string& key, unsigned long long generation,
+                        VirtualIdentity& vid, bool& refresh)
+{
+  time_t now = time(NULL);
+  shard_t& shard = GetShard(key);
+  XrdSysMutexHelper lock(shard.mMutex);
+  auto it = shard.mMap.find(key);
+  refresh = false;
+
+  if ((it == shard.mMap.end()) || (it->second.generation != generation) ||
+      (it->second.expire <= now)) {
+    return false;
+  }
+
+  if ((it->second.refresh <= now) && !it->second.refreshing) {
+    // only one caller refreshes the entry
+    it->second.refreshing = true;
+    refresh = true;
+  }
+
+  vid = it->second.vid;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Store an identity in the cache
+//------------------------------------------------------------------------------
+void
+Mapping::vid_cache::Put(const std::string& key, unsigned long long generation,
+                        const VirtualIdentity& vid)
+{
+  time_t now = time(NULL);
+  shard_t& shard = GetShard(key);
+  XrdSysMutexHelper lock(shard.mMutex);
+
+  if (shard.mMap.size() >= sMaxShardEntries) {
+    for (auto it = shard.mMap.begin(); it != shard.mMap.end();) {
+      if ((it->second.expire <= now) || (it->second.generation != generation)) {
+        it = shard.mMap.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    if (shard.mMap.size() >= sMaxShardEntries) {
+      shard.mMap.clear();
+    }
+  }
+
+  entry_t& entry = shard.mMap[key];
+  entry.vid = vid;
+  entry.generation = generation;
+  entry.refresh = now + mLifeTime / 2;
+  entry.expire = now + mLifeTime;
+  entry.refreshing = false;
+}
+
+//------------------------------------------------------------------------------
+// Drop all the cached identities
+//------------------------------------------------------------------------------
+void
+Mapping::vid_cache::Clear()
+{
+  for (size_t i = 0; i < sShards; i++) {
+    XrdSysMutexHelper lock(mShards[i].mMutex);
+    mShards[i].mMap.clear();
+  }
+}
+
 /*----------------------------------------------------------------------------*/
 EOSCOMMONNAMESPACE_END
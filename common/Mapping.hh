@@ -47,7 +47,9 @@
 /*----------------------------------------------------------------------------*/
 #include <pwd.h>
 #include <grp.h>
+#include <atomic>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <vector>
 #include <string>
@@ -158,6 +160,69 @@ public:
   //----------------------------------------------------------------------------
   typedef struct VirtualIdentity_t VirtualIdentity;
 
+  //----------------------------------------------------------------------------
+  //! Cache of the identities computed by IdMap keyed by the authentication
+  //! information of the client. Entries expire after the lifetime and have to
+  //! be refreshed when they are used in the second half of it. Entries
+  //! computed with a previous mapping configuration are ignored.
+  //----------------------------------------------------------------------------
+  class vid_cache
+  {
+  public:
+    // Cached identity with the generation of the mapping configuration
+    struct entry_t {
+      VirtualIdentity vid;
+      unsigned long long generation;
+      time_t refresh;
+      time_t expire;
+      bool refreshing;
+    };
+
+    // Constructor, a lifetime of 0 disables the cache
+    vid_cache(int lifetime = 60)
+    {
+      mLifeTime = lifetime;
+    }
+
+    // Destructor
+    virtual ~vid_cache()
+    {
+    }
+
+    // Get an identity, refresh is set if the caller should refresh the entry
+    bool Get(const std::string& key, unsigned long long generation,
+             VirtualIdentity& vid, bool& refresh);
+
+    // Store an identity
+    void Put(const std::string& key, unsigned long long generation,
+             const VirtualIdentity& vid);
+
+    // Drop all the entries
+    void Clear();
+
+    int GetLifeTime() const
+    {
+      return mLifeTime;
+    }
+
+  private:
+    static const size_t sShards = 64;
+    static const size_t sMaxShardEntries = 4096;
+
+    struct shard_t {
+      XrdSysMutex mMutex;
+      std::unordered_map<std::string, entry_t> mMap;
+    };
+
+    shard_t& GetShard(const std::string& key)
+    {
+      return mShards[std::hash<std::string>()(key) % sShards];
+    }
+
+    shard_t mShards[sShards];
+    int mLifeTime;
+  };
+
   // ---------------------------------------------------------------------------
   //! Function creating the Nobody identity
   // ---------------------------------------------------------------------------
@@ -327,6 +392,33 @@ public:
   static void IdMap(const XrdSecEntity* client, const char* env,
                     const char* tident, Mapping::VirtualIdentity& vid, bool log = true);
 
+  // ---------------------------------------------------------------------------
+  //! Compute a virtual identity without using the identity cache
+  //!
+  //! @param generation returns the mapping configuration generation used
+  // ---------------------------------------------------------------------------
+  static void IdMapUncached(const XrdSecEntity* client, XrdOucEnv& env,
+                            const char* tident, Mapping::VirtualIdentity& vid,
+                            unsigned long long& generation);
+
+  // ---------------------------------------------------------------------------
+  //! Build the identity cache key of a client, empty if it can't be cached
+  // ---------------------------------------------------------------------------
+  static std::string IdMapCacheKey(const XrdSecEntity* client, XrdOucEnv& env,
+                                   const char* tident);
+
+  // ---------------------------------------------------------------------------
+  //! Queue the asynchronous refresh of an identity cache entry
+  // ---------------------------------------------------------------------------
+  static void IdMapRefresh(const std::string& key, const XrdSecEntity* client,
+                           XrdOucEnv& env, const char* tident);
+
+  // ---------------------------------------------------------------------------
+  //! Drop the cached identities, has to be called with gMapMutex write-locked
+  //! whenever a mapping rule is changed
+  // ---------------------------------------------------------------------------
+  static void InvalidateIdMapCache();
+
   // ---------------------------------------------------------------------------
   //! Map describing which virtual user roles a user with a given uid has
   // ---------------------------------------------------------------------------
@@ -387,6 +479,22 @@ public:
   static std::map<gid_t, std::string> gPhysicalGroupNameCache;
   static std::map<std::string, gid_t> gPhysicalGroupIdCache;
 
+  // ---------------------------------------------------------------------------
+  //! A cache for failed physical lookups (name, uid or gid) and their expiry,
+  //! protected by gPhysicalNameCacheMutex
+  // ---------------------------------------------------------------------------
+  static std::map<std::string, time_t> gPhysicalNegativeCache;
+
+  // ---------------------------------------------------------------------------
+  //! Check for a failed physical lookup in the negative cache
+  // ---------------------------------------------------------------------------
+  static bool IsNegativeCached(const std::string& key);
+
+  // ---------------------------------------------------------------------------
+  //! Add a failed physical lookup to the negative cache
+  // ---------------------------------------------------------------------------
+  static void AddNegativeCache(const std::string& key);
+
   // ---------------------------------------------------------------------------
   //! Mutex to protect the physical ID caches
   // ---------------------------------------------------------------------------
@@ -407,6 +515,16 @@ public:
   // ---------------------------------------------------------------------------
   static ip_cache gIpCache;
 
+  // ---------------------------------------------------------------------------
+  //! Cache of the identities computed by IdMap
+  // ---------------------------------------------------------------------------
+  static vid_cache gVidCache;
+
+  // ---------------------------------------------------------------------------
+  //! Generation of the mapping configuration, bumped by InvalidateIdMapCache
+  // ---------------------------------------------------------------------------
+  static std::atomic<unsigned long long> gMapGeneration;
+
 
   // ---------------------------------------------------------------------------
   //! Function to expire unused ActiveTident entries by default after 1 day
@@ -24,11 +24,149 @@
 /*----------------------------------------------------------------------------*/
 #include "common/Namespace.hh"
 #include "common/Report.hh"
-
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 /*----------------------------------------------------------------------------*/
 
 EOSCOMMONNAMESPACE_BEGIN
 
+const char* Report::sBinaryTag = "eosrpt1:";
+
+//------------------------------------------------------------------------------
+// Helpers of the binary report format
+//------------------------------------------------------------------------------
+static const char sB64Chars[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+//! Reverse lookup of sB64Chars, -1 for characters not in the alphabet
+struct B64Table {
+  signed char mVal[256];
+
+  B64Table()
+  {
+    memset(mVal, -1, sizeof(mVal));
+
+    for (int i = 0; i < 64; ++i) {
+      mVal[(unsigned char) sB64Chars[i]] = i;
+    }
+  }
+};
+
+static const B64Table sB64Table;
+
+//! Version byte leading a binary report
+static const unsigned char sBinaryVersion = 1;
+
+static void
+PutVarint(std::string& out, uint64_t val)
+{
+  while (val >= 0x80) {
+    out += (char)((val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+
+  out += (char) val;
+}
+
+static void
+PutDouble(std::string& out, double val)
+{
+  uint64_t bits;
+  memcpy(&bits, &val, sizeof(bits));
+
+  for (int i = 0; i < 8; ++i) {
+    out += (char)((bits >> (8 * i)) & 0xff);
+  }
+}
+
+static void
+PutString(std::string& out, const std::string& val)
+{
+  PutVarint(out, val.size());
+  out += val;
+}
+
+//! Cursor over a decoded binary report, fails once the input is exhausted
+struct BinaryReader {
+  const unsigned char* mPos;
+  const unsigned char* mEnd;
+  bool mOk;
+
+  uint64_t Varint()
+  {
+    uint64_t val = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (mPos >= mEnd) {
+        break;
+      }
+
+      unsigned char c = *mPos++;
+      val |= ((uint64_t)(c & 0x7f)) << shift;
+
+      if (!(c & 0x80)) {
+        return val;
+      }
+    }
+
+    mOk = false;
+    return 0;
+  }
+
+  double Double()
+  {
+    if (mEnd - mPos < 8) {
+      mOk = false;
+      return 0;
+    }
+
+    uint64_t bits = 0;
+
+    for (int i = 0; i < 8; ++i) {
+      bits |= ((uint64_t) mPos[i]) << (8 * i);
+    }
+
+    mPos += 8;
+    double val;
+    memcpy(&val, &bits, sizeof(val));
+    return val;
+  }
+
+  std::string String()
+  {
+    uint64_t len = Varint();
+
+    if (!mOk || ((uint64_t)(mEnd - mPos) < len)) {
+      mOk = false;
+      return "";
+    }
+
+    std::string val((const char*) mPos, len);
+    mPos += len;
+    return val;
+  }
+};
+
+//------------------------------------------------------------------------------
+//! 
+//! Create an empty Report object
+//! 
+//------------------------------------------------------------------------------
+Report::Report () :
+  ots(0), cts(0), otms(0), ctms(0), uid(0), gid(0), td("none"), host("none"),
+  lid(0), fid(0), fsid(0), rb(0), rb_min(0), rb_max(0), rb_sigma(0), rv_op(0),
+  rvb_min(0), rvb_max(0), rvb_sum(0), rvb_sigma(0), rs_op(0), rsb_min(0),
+  rsb_max(0), rsb_sum(0), rsb_sigma(0), rc_min(0), rc_max(0), rc_sum(0),
+  rc_sigma(0), wb(0), wb_min(0), wb_max(0), wb_sigma(0), sfwdb(0), sbwdb(0),
+  sxlfwdb(0), sxlbwdb(0), nrc(0), nwc(0), nfwds(0), nbwds(0), nxlfwds(0),
+  nxlbwds(0), rt(0), rvt(0), wt(0), osize(0), csize(0)
+{
+  SplitHosts();
+}
+
 //------------------------------------------------------------------------------
 //! 
 //! Create a Report object based on a report env representation
@@ -48,14 +186,6 @@ Report::Report (XrdOucEnv &report)
   gid = (gid_t) atoi(report.Get("rgid") ? report.Get("rgid") : "0");
   td = report.Get("td") ? report.Get("td") : "none";
   host = report.Get("host") ? report.Get("host") : "none";
-  server_name = host;
-  server_domain = host;
-  int dpos = host.find(".");
-  if (dpos != STR_NPOS)
-  {
-    server_name.erase(dpos);
-    server_domain.erase(0, dpos + 1);
-  }
   lid = strtoul(report.Get("lid") ? report.Get("lid") : "0", 0, 10);
   fid = strtoull(report.Get("fid") ? report.Get("fid") : "0", 0, 10);
   fsid = strtoul(report.Get("fsid") ? report.Get("fsid") : "0", 0, 10);
@@ -83,8 +213,11 @@ Report::Report (XrdOucEnv &report)
   wb_sigma = strtod(report.Get("wb_sigma") ? report.Get("wb_sigma") : "0", 0);
   sfwdb = strtoull(report.Get("sfwdb") ? report.Get("sfwdb") : "0", 0, 10);
   sbwdb = strtoull(report.Get("sbwdb") ? report.Get("sbwdb") : "0", 0, 10);
-  sxlfwdb = strtoull(report.Get("sxlfwd") ? report.Get("sxlfwd") : "0", 0, 10);
-  sxlbwdb = strtoull(report.Get("sxlbwd") ? report.Get("sxlbwd") : "0", 0, 10);
+  // older FSTs sent sxlfwdb/sxlbwdb, the keys were read as sxlfwd/sxlbwd
+  sxlfwdb = strtoull(report.Get("sxlfwdb") ? report.Get("sxlfwdb") :
+                     (report.Get("sxlfwd") ? report.Get("sxlfwd") : "0"), 0, 10);
+  sxlbwdb = strtoull(report.Get("sxlbwdb") ? report.Get("sxlbwdb") :
+                     (report.Get("sxlbwd") ? report.Get("sxlbwd") : "0"), 0, 10);
   nrc = strtoull(report.Get("nrc") ? report.Get("nrc") : "0", 0, 10);
   nwc = strtoull(report.Get("nwc") ? report.Get("nwc") : "0", 0, 10);
   nfwds = strtoull(report.Get("nfwds") ? report.Get("nfwds") : "0", 0, 10);
@@ -99,15 +232,9 @@ Report::Report (XrdOucEnv &report)
   // sec extensions
   sec_prot = report.Get("sec.prot") ? report.Get("sec.prot") : "";
   sec_name = report.Get("sec.name") ? report.Get("sec.name") : "";
-  sec_host = report.Get("sec.host") ? report.Get("sec.host") : "";
-  sec_domain = report.Get("sec.host") ? report.Get("sec.host") : "";
-  dpos = sec_host.find(".");
-  if (dpos != STR_NPOS)
-  {
-    sec_host.erase(dpos);
-    sec_domain.erase(0, dpos + 1);
-  }
+  sec_client = report.Get("sec.host") ? report.Get("sec.host") : "";
   sec_vorg = report.Get("sec.vorg") ? report.Get("sec.vorg") : "";
+  sec_grps = report.Get("sec.grps") ? report.Get("sec.grps") : "";
   sec_role = report.Get("sec.role") ? report.Get("sec.role") : "";
   sec_info = report.Get("sec.info") ? report.Get("sec.info") : "";
   sec_app = report.Get("sec.app") ? report.Get("sec.app") : "";
@@ -115,6 +242,7 @@ Report::Report (XrdOucEnv &report)
   {
     sec_app.erase(sec_app.find("?"));
   }
+  SplitHosts();
 }
 
 
@@ -165,6 +293,308 @@ Report::Dump (XrdOucString &out, bool dumpsec)
   
   out += "\n";
 }
+
+//------------------------------------------------------------------------------
+//! 
+//! Split the server and the client host names into host and domain
+//! 
+//------------------------------------------------------------------------------
+void
+Report::SplitHosts ()
+{
+  server_name = host;
+  server_domain = host;
+  size_t dpos = host.find(".");
+  if (dpos != std::string::npos)
+  {
+    server_name.erase(dpos);
+    server_domain.erase(0, dpos + 1);
+  }
+  sec_host = sec_client;
+  sec_domain = sec_client;
+  dpos = sec_client.find(".");
+  if (dpos != std::string::npos)
+  {
+    sec_host.erase(dpos);
+    sec_domain.erase(0, dpos + 1);
+  }
+}
+
+//------------------------------------------------------------------------------
+//! 
+//! Check if a report string is in binary format
+//! 
+//------------------------------------------------------------------------------
+bool
+Report::IsBinary (const char* report)
+{
+  return (report && !strncmp(report, sBinaryTag, strlen(sBinaryTag)));
+}
+
+//------------------------------------------------------------------------------
+//! 
+//! Encode the report in binary format
+//! 
+//! @param out string containing the encoded report
+//! 
+//------------------------------------------------------------------------------
+void
+Report::Encode (std::string &out) const
+{
+  std::string raw;
+  raw.reserve(256 + path.size());
+  raw += (char) sBinaryVersion;
+  PutVarint(raw, ots);
+  PutVarint(raw, cts);
+  PutVarint(raw, otms);
+  PutVarint(raw, ctms);
+  PutVarint(raw, uid);
+  PutVarint(raw, gid);
+  PutVarint(raw, lid);
+  PutVarint(raw, fid);
+  PutVarint(raw, fsid);
+  PutVarint(raw, rb);
+  PutVarint(raw, rb_min);
+  PutVarint(raw, rb_max);
+  PutVarint(raw, rv_op);
+  PutVarint(raw, rvb_min);
+  PutVarint(raw, rvb_max);
+  PutVarint(raw, rvb_sum);
+  PutVarint(raw, rs_op);
+  PutVarint(raw, rsb_min);
+  PutVarint(raw, rsb_max);
+  PutVarint(raw, rsb_sum);
+  PutVarint(raw, rc_min);
+  PutVarint(raw, rc_max);
+  PutVarint(raw, rc_sum);
+  PutVarint(raw, wb);
+  PutVarint(raw, wb_min);
+  PutVarint(raw, wb_max);
+  PutVarint(raw, sfwdb);
+  PutVarint(raw, sbwdb);
+  PutVarint(raw, sxlfwdb);
+  PutVarint(raw, sxlbwdb);
+  PutVarint(raw, nrc);
+  PutVarint(raw, nwc);
+  PutVarint(raw, nfwds);
+  PutVarint(raw, nbwds);
+  PutVarint(raw, nxlfwds);
+  PutVarint(raw, nxlbwds);
+  PutVarint(raw, osize);
+  PutVarint(raw, csize);
+  PutDouble(raw, rb_sigma);
+  PutDouble(raw, rvb_sigma);
+  PutDouble(raw, rsb_sigma);
+  PutDouble(raw, rc_sigma);
+  PutDouble(raw, wb_sigma);
+  PutDouble(raw, rt);
+  PutDouble(raw, rvt);
+  PutDouble(raw, wt);
+  PutString(raw, logid);
+  PutString(raw, path);
+  PutString(raw, td);
+  PutString(raw, host);
+  PutString(raw, sec_prot);
+  PutString(raw, sec_name);
+  PutString(raw, sec_client);
+  PutString(raw, sec_vorg);
+  PutString(raw, sec_grps);
+  PutString(raw, sec_role);
+  PutString(raw, sec_info);
+  PutString(raw, sec_app);
+
+  out = sBinaryTag;
+  out.reserve(out.size() + (raw.size() * 4 + 2) / 3);
+  const unsigned char* in = (const unsigned char*) raw.data();
+  size_t len = raw.size();
+  size_t i = 0;
+
+  for (; i + 2 < len; i += 3)
+  {
+    uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    out += sB64Chars[(v >> 18) & 0x3f];
+    out += sB64Chars[(v >> 12) & 0x3f];
+    out += sB64Chars[(v >> 6) & 0x3f];
+    out += sB64Chars[v & 0x3f];
+  }
+
+  if (i < len)
+  {
+    uint32_t v = in[i] << 16;
+    if (i + 1 < len)
+    {
+      v |= in[i + 1] << 8;
+    }
+    out += sB64Chars[(v >> 18) & 0x3f];
+    out += sB64Chars[(v >> 12) & 0x3f];
+    if (i + 1 < len)
+    {
+      out += sB64Chars[(v >> 6) & 0x3f];
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+//! 
+//! Fill the report from a report in binary format
+//! 
+//! @param report encoded report starting with sBinaryTag
+//! 
+//! @return false if the report can not be decoded
+//! 
+//------------------------------------------------------------------------------
+bool
+Report::Decode (const char* report)
+{
+  if (!IsBinary(report))
+  {
+    return false;
+  }
+
+  const unsigned char* in = (const unsigned char*) report + strlen(sBinaryTag);
+  size_t len = strlen((const char*) in);
+  if ((len % 4) == 1)
+  {
+    return false;
+  }
+
+  std::string raw;
+  raw.reserve(len * 3 / 4);
+  uint32_t v = 0;
+  int bits = 0;
+  for (size_t i = 0; i < len; ++i)
+  {
+    int c = sB64Table.mVal[in[i]];
+    if (c < 0)
+    {
+      return false;
+    }
+    v = (v << 6) | c;
+    bits += 6;
+    if (bits >= 8)
+    {
+      bits -= 8;
+      raw += (char) ((v >> bits) & 0xff);
+    }
+  }
+
+  if (raw.empty() || ((unsigned char) raw[0] != sBinaryVersion))
+  {
+    return false;
+  }
+
+  BinaryReader r;
+  r.mPos = (const unsigned char*) raw.data() + 1;
+  r.mEnd = (const unsigned char*) raw.data() + raw.size();
+  r.mOk = true;
+  ots = r.Varint();
+  cts = r.Varint();
+  otms = r.Varint();
+  ctms = r.Varint();
+  uid = (uid_t) r.Varint();
+  gid = (gid_t) r.Varint();
+  lid = r.Varint();
+  fid = r.Varint();
+  fsid = r.Varint();
+  rb = r.Varint();
+  rb_min = r.Varint();
+  rb_max = r.Varint();
+  rv_op = r.Varint();
+  rvb_min = r.Varint();
+  rvb_max = r.Varint();
+  rvb_sum = r.Varint();
+  rs_op = r.Varint();
+  rsb_min = r.Varint();
+  rsb_max = r.Varint();
+  rsb_sum = r.Varint();
+  rc_min = r.Varint();
+  rc_max = r.Varint();
+  rc_sum = r.Varint();
+  wb = r.Varint();
+  wb_min = r.Varint();
+  wb_max = r.Varint();
+  sfwdb = r.Varint();
+  sbwdb = r.Varint();
+  sxlfwdb = r.Varint();
+  sxlbwdb = r.Varint();
+  nrc = r.Varint();
+  nwc = r.Varint();
+  nfwds = r.Varint();
+  nbwds = r.Varint();
+  nxlfwds = r.Varint();
+  nxlbwds = r.Varint();
+  osize = r.Varint();
+  csize = r.Varint();
+  rb_sigma = r.Double();
+  rvb_sigma = r.Double();
+  rsb_sigma = r.Double();
+  rc_sigma = r.Double();
+  wb_sigma = r.Double();
+  rt = r.Double();
+  rvt = r.Double();
+  wt = r.Double();
+  logid = r.String();
+  path = r.String();
+  td = r.String();
+  host = r.String();
+  sec_prot = r.String();
+  sec_name = r.String();
+  sec_client = r.String();
+  sec_vorg = r.String();
+  sec_grps = r.String();
+  sec_role = r.String();
+  sec_info = r.String();
+  sec_app = r.String();
+  // fields appended by newer versions are ignored
+  SplitHosts();
+  return r.mOk;
+}
+
+//------------------------------------------------------------------------------
+//! 
+//! Convert the report into the env format created by the FST, as written to
+//! the report log files
+//! 
+//! @param out string containing the report
+//! 
+//------------------------------------------------------------------------------
+void
+Report::ToEnv (std::string &out) const
+{
+  char report[16384];
+  snprintf(report, sizeof (report) - 1,
+           "log=%s&path=%s&ruid=%u&rgid=%u&td=%s&"
+           "host=%s&lid=%lu&fid=%llu&fsid=%lu&"
+           "ots=%llu&otms=%llu&"
+           "cts=%llu&ctms=%llu&"
+           "nrc=%llu&nwc=%llu&"
+           "rb=%llu&rb_min=%llu&rb_max=%llu&rb_sigma=%.02f&"
+           "rv_op=%llu&rvb_min=%llu&rvb_max=%llu&rvb_sum=%llu&rvb_sigma=%.02f&"
+           "rs_op=%llu&rsb_min=%llu&rsb_max=%llu&rsb_sum=%llu&rsb_sigma=%.02f&"
+           "rc_min=%lu&rc_max=%lu&rc_sum=%lu&rc_sigma=%.02f&"
+           "wb=%llu&wb_min=%llu&wb_max=%llu&wb_sigma=%.02f&"
+           "sfwdb=%llu&sbwdb=%llu&sxlfwdb=%llu&sxlbwdb=%llu&"
+           "nfwds=%llu&nbwds=%llu&nxlfwds=%llu&nxlbwds=%llu&"
+           "rt=%.02f&rvt=%.02f&wt=%.02f&osize=%llu&csize=%llu&"
+           "sec.prot=%s&sec.name=%s&sec.host=%s&sec.vorg=%s&sec.grps=%s&"
+           "sec.role=%s&sec.info=%s&sec.app=%s",
+           logid.c_str(), path.c_str(), (unsigned int) uid, (unsigned int) gid,
+           td.c_str(), host.c_str(), lid, fid, fsid,
+           ots, otms, cts, ctms, nrc, nwc,
+           rb, rb_min, rb_max, rb_sigma,
+           rv_op, rvb_min, rvb_max, rvb_sum, rvb_sigma,
+           rs_op, rsb_min, rsb_max, rsb_sum, rsb_sigma,
+           rc_min, rc_max, rc_sum, rc_sigma,
+           wb, wb_min, wb_max, wb_sigma,
+           sfwdb, sbwdb, sxlfwdb, sxlbwdb,
+           nfwds, nbwds, nxlfwds, nxlbwds,
+           rt, rvt, wt, osize, csize,
+           sec_prot.c_str(), sec_name.c_str(), sec_client.c_str(),
+           sec_vorg.c_str(), sec_grps.c_str(), sec_role.c_str(),
+           sec_info.c_str(), sec_app.c_str());
+  out = report;
+}
+
 /*----------------------------------------------------------------------------*/
 
 EOSCOMMONNAMESPACE_END
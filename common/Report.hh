@@ -110,6 +110,7 @@ public:
   std::string sec_prot;    //< auth protocol
   std::string sec_name;    //< auth name
   std::string sec_host;    //< auth client host
+  std::string sec_client;  //< auth client host with domain
   std::string sec_domain;  //< auth domain
   std::string sec_vorg;    //< auth vorg
   std::string sec_grps;    //< auth grps
@@ -117,6 +118,16 @@ public:
   std::string sec_info;    //< auth info (=dn if moninfo configuredin GSI plugin)
   std::string sec_app;     //< auth application
 
+  // ---------------------------------------------------------------------------
+  //! Prefix of a report in binary format
+  // ---------------------------------------------------------------------------
+  static const char* sBinaryTag;
+
+  // ---------------------------------------------------------------------------
+  //! Constructor of an empty report, to be filled by Decode
+  // ---------------------------------------------------------------------------
+  Report();
+
   // ---------------------------------------------------------------------------
   //! Constructor by report env 
   // ---------------------------------------------------------------------------
@@ -131,6 +142,39 @@ public:
   //! Dump the report contents into a string
   // ---------------------------------------------------------------------------
   void Dump(XrdOucString &out, bool dumpsec=false);
+
+  // ---------------------------------------------------------------------------
+  //! Check if a report string is in binary format
+  // ---------------------------------------------------------------------------
+  static bool IsBinary(const char* report);
+
+  // ---------------------------------------------------------------------------
+  //! Encode the report in binary format
+  //!
+  //! The numeric fields are stored as variable length integers and the
+  //! strings with their length in a fixed order, new fields can only be
+  //! appended. The record is base64 encoded with the url alphabet behind
+  //! sBinaryTag, so it can be sent as message body.
+  // ---------------------------------------------------------------------------
+  void Encode(std::string &out) const;
+
+  // ---------------------------------------------------------------------------
+  //! Fill the report from a report in binary format
+  //!
+  //! @return false if the report is not in binary format or is truncated
+  // ---------------------------------------------------------------------------
+  bool Decode(const char* report);
+
+  // ---------------------------------------------------------------------------
+  //! Convert the report into the env format created by the FST
+  // ---------------------------------------------------------------------------
+  void ToEnv(std::string &out) const;
+
+private:
+  // ---------------------------------------------------------------------------
+  //! Split the host names into host and domain
+  // ---------------------------------------------------------------------------
+  void SplitHosts();
 };
 
 /*----------------------------------------------------------------------------*/
@@ -23,6 +23,7 @@
 
 #include "StringConversion.hh"
 #include "common/Logging.hh"
+#include "common/SymKeys.hh"
 #include <XrdOuc/XrdOucTokenizer.hh>
 #include "curl/curl.h"
 
@@ -601,6 +602,132 @@ StringConversion::ParseStringIdSet(char* in, std::string& tag,
   return false;
 }
 
+//------------------------------------------------------------------------------
+// Encode a set of ids as base64 of the varint encoded differences
+//------------------------------------------------------------------------------
+void
+StringConversion::EncodeIdSet(std::set<unsigned long long>::const_iterator
+                              begin,
+                              std::set<unsigned long long>::const_iterator end,
+                              std::string& out)
+{
+  std::string raw;
+  unsigned long long last = 0;
+
+  for (auto it = begin; it != end; ++it)
+  {
+    unsigned long long delta = *it - last;
+    last = *it;
+
+    while (delta >= 0x80)
+    {
+      raw += (char)((delta & 0x7f) | 0x80);
+      delta >>= 7;
+    }
+
+    raw += (char) delta;
+  }
+
+  out.clear();
+
+  if (raw.empty())
+  {
+    return;
+  }
+
+  XrdOucString out64;
+  SymKey::Base64Encode((char*) raw.c_str(), raw.length(), out64);
+  out = out64.c_str();
+}
+
+//------------------------------------------------------------------------------
+// Decode a set of ids encoded by EncodeIdSet
+//------------------------------------------------------------------------------
+bool
+StringConversion::DecodeIdSet(const char* in, std::set<unsigned long long>& set)
+{
+  if (!in || !*in)
+  {
+    return true;
+  }
+
+  // the base64 decoder skips what is not base64, check the input first
+  size_t len = strlen(in);
+  size_t npad = 0;
+
+  if (len % 4)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < len; i++)
+  {
+    char c = in[i];
+
+    if (c == '=')
+    {
+      npad++;
+    } else if (npad || !(((c >= 'A') && (c <= 'Z')) ||
+                         ((c >= 'a') && (c <= 'z')) ||
+                         ((c >= '0') && (c <= '9')) || (c == '+') || (c == '/')))
+    {
+      return false;
+    }
+  }
+
+  if (npad > 2)
+  {
+    return false;
+  }
+
+  XrdOucString in64 = in;
+  char* raw = 0;
+  unsigned int rawlen = 0;
+
+  if (!SymKey::Base64Decode(in64, raw, rawlen) || !raw)
+  {
+    return false;
+  }
+
+  // BIO_read returns -1 for invalid input
+  if (((int) rawlen < 0) || (rawlen != (len / 4) * 3 - npad))
+  {
+    free(raw);
+    return false;
+  }
+
+  unsigned long long last = 0;
+  unsigned long long delta = 0;
+  unsigned int shift = 0;
+  bool ok = true;
+
+  for (unsigned int i = 0; i < rawlen; i++)
+  {
+    unsigned char c = (unsigned char) raw[i];
+
+    if (shift > 63)
+    {
+      ok = false;
+      break;
+    }
+
+    delta |= ((unsigned long long)(c & 0x7f)) << shift;
+    shift += 7;
+
+    if (!(c & 0x80))
+    {
+      last += delta;
+      set.insert(last);
+      delta = 0;
+      shift = 0;
+    }
+  }
+
+  free(raw);
+  // a truncated last id is a format error
+  return ok && !shift;
+}
+
 //------------------------------------------------------------------------------
 // Load a text file <name> into a string
 //------------------------------------------------------------------------------
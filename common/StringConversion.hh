@@ -352,6 +352,33 @@ public:
   ParseStringIdSet(char* in, std::string& tag, unsigned long& id,
                    std::set<unsigned long long>& set);
 
+  // ---------------------------------------------------------------------------
+  /**
+   * Encode a set of ids compactly: the differences between consecutive ids
+   * as variable length integers, base64 encoded to be text safe.
+   *
+   * @param begin first id of the set to encode
+   * @param end end of the set to encode
+   * @param out encoded string
+   */
+  // ---------------------------------------------------------------------------
+  static void
+  EncodeIdSet(std::set<unsigned long long>::const_iterator begin,
+              std::set<unsigned long long>::const_iterator end,
+              std::string& out);
+
+  // ---------------------------------------------------------------------------
+  /**
+   * Decode a set of ids encoded by EncodeIdSet
+   *
+   * @param in encoded string
+   * @param set decoded ids are added to this set
+   * @return true if decoded, false if format error
+   */
+  // ---------------------------------------------------------------------------
+  static bool
+  DecodeIdSet(const char* in, std::set<unsigned long long>& set);
+
   // ---------------------------------------------------------------------------
   /**
    * Load a text file <name> into a string
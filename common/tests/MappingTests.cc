@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+// File: MappingTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "common/Mapping.hh"
+#include "common/RWMutex.hh"
+#include <errno.h>
+#include <string>
+
+using eos::common::Mapping;
+
+namespace
+{
+//! Forced uid mapping of the unix protocol
+const char* sUnixUidKey = "unix:\"<pwd>\":uid";
+
+//------------------------------------------------------------------------------
+// Map a unix client with the given tident
+//------------------------------------------------------------------------------
+Mapping::VirtualIdentity
+MapUnix(const char* tident)
+{
+  XrdSecEntity client("unix");
+  char name[] = "eostest";
+  client.name = name;
+  Mapping::VirtualIdentity vid;
+  Mapping::Nobody(vid);
+  Mapping::IdMap(&client, "", tident, vid, false);
+  // the entity does not own the strings
+  client.name = 0;
+  return vid;
+}
+
+//------------------------------------------------------------------------------
+// Set the forced uid of the unix protocol, optionally without dropping the
+// cached identities
+//------------------------------------------------------------------------------
+void
+SetUnixUid(uid_t uid, bool invalidate)
+{
+  eos::common::RWMutexWriteLock lock(Mapping::gMapMutex);
+  Mapping::gVirtualUidMap[sUnixUidKey] = uid;
+
+  if (invalidate) {
+    Mapping::InvalidateIdMapCache();
+  }
+}
+}
+
+//------------------------------------------------------------------------------
+// Entries are returned for their generation only and dropped by Clear
+//------------------------------------------------------------------------------
+TEST(Mapping, VidCache)
+{
+  Mapping::vid_cache cache(600);
+  Mapping::VirtualIdentity vid, out;
+  Mapping::Nobody(vid);
+  vid.uid = 1234;
+  vid.gid = 5678;
+  bool refresh = true;
+  ASSERT_FALSE(cache.Get("key", 1, out, refresh));
+  cache.Put("key", 1, vid);
+  ASSERT_TRUE(cache.Get("key", 1, out, refresh));
+  ASSERT_EQ(1234u, out.uid);
+  ASSERT_EQ(5678u, out.gid);
+  // far from the second half of the lifetime
+  ASSERT_FALSE(refresh);
+  ASSERT_FALSE(cache.Get("other", 1, out, refresh));
+  // computed with other mapping rules
+  ASSERT_FALSE(cache.Get("key", 2, out, refresh));
+  cache.Clear();
+  ASSERT_FALSE(cache.Get("key", 1, out, refresh));
+}
+
+//------------------------------------------------------------------------------
+// A second mapping of a client is served from the cache, also for another
+// connection of the client, until the mapping rules are invalidated
+//------------------------------------------------------------------------------
+TEST(Mapping, IdMapCacheHit)
+{
+  if (!Mapping::gVidCache.GetLifeTime()) {
+    return;
+  }
+
+  SetUnixUid(4001, true);
+  ASSERT_EQ(4001u, MapUnix("eostest.1:10@localhost").uid);
+  // a rule change without invalidation is not seen, i.e. the cache is used
+  SetUnixUid(4002, false);
+  ASSERT_EQ(4001u, MapUnix("eostest.1:10@localhost").uid);
+  ASSERT_EQ(4001u, MapUnix("eostest.2:20@localhost").uid);
+  // another host is another client
+  ASSERT_EQ(4002u, MapUnix("eostest.1:10@otherhost").uid);
+  // what vid set/rm, config apply and reset do after changing the rules
+  SetUnixUid(4003, true);
+  ASSERT_EQ(4003u, MapUnix("eostest.1:10@localhost").uid);
+  ASSERT_EQ(4003u, MapUnix("eostest.1:10@otherhost").uid);
+  {
+    eos::common::RWMutexWriteLock lock(Mapping::gMapMutex);
+    Mapping::gVirtualUidMap.erase(sUnixUidKey);
+    Mapping::InvalidateIdMapCache();
+  }
+  ASSERT_EQ(99u, MapUnix("eostest.1:10@localhost").uid);
+}
+
+//------------------------------------------------------------------------------
+// Failed password and group database lookups are remembered until a reset
+//------------------------------------------------------------------------------
+TEST(Mapping, NegativeCache)
+{
+  // ids which are not in any password or group database
+  const uid_t uid = 3999999901u;
+  const gid_t gid = 3999999902u;
+  ASSERT_FALSE(Mapping::IsNegativeCached("u:3999999901"));
+  int errc = 0;
+  ASSERT_EQ("3999999901", Mapping::UidToUserName(uid, errc));
+  ASSERT_EQ(EINVAL, errc);
+  ASSERT_TRUE(Mapping::IsNegativeCached("u:3999999901"));
+  // served from the negative cache
+  errc = 0;
+  ASSERT_EQ("3999999901", Mapping::UidToUserName(uid, errc));
+  ASSERT_EQ(EINVAL, errc);
+  ASSERT_FALSE(Mapping::IsNegativeCached("g:3999999902"));
+  errc = 0;
+  ASSERT_EQ("3999999902", Mapping::GidToGroupName(gid, errc));
+  ASSERT_EQ(EINVAL, errc);
+  ASSERT_TRUE(Mapping::IsNegativeCached("g:3999999902"));
+  // unknown user names are remembered too
+  Mapping::VirtualIdentity vid;
+  Mapping::Nobody(vid);
+  Mapping::getPhysicalIds("no-such-user-eostest", vid);
+  ASSERT_EQ(99u, vid.uid);
+  ASSERT_TRUE(Mapping::IsNegativeCached("n:no-such-user-eostest"));
+  // a reset forgets all of them
+  Mapping::AddNegativeCache("u:1");
+  ASSERT_TRUE(Mapping::IsNegativeCached("u:1"));
+  Mapping::Reset();
+  ASSERT_FALSE(Mapping::IsNegativeCached("u:1"));
+  ASSERT_FALSE(Mapping::IsNegativeCached("u:3999999901"));
+  ASSERT_FALSE(Mapping::IsNegativeCached("n:no-such-user-eostest"));
+}
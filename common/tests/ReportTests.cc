@@ -0,0 +1,228 @@
+//------------------------------------------------------------------------------
+// File: ReportTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "common/Report.hh"
+#include <climits>
+#include <cstring>
+#include <string>
+
+using eos::common::Report;
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Report with a distinct value in every field
+//------------------------------------------------------------------------------
+void
+FillReport(Report& report)
+{
+  report.ots = 1500000000;
+  report.cts = 1500000123;
+  report.otms = 17;
+  report.ctms = 999;
+  report.logid = "7a3b2c1e-0000-11e7-9f3c-02163e009ad2";
+  report.path = "/eos/dev/user/a/alice/file with blanks&amp.dat";
+  report.uid = 11876;
+  report.gid = 1338;
+  report.td = "alice.12345:67@lxplus001.cern.ch";
+  report.host = "fst-01.cern.ch";
+  report.lid = 0x00100112;
+  report.fid = ULLONG_MAX;
+  report.fsid = 4321;
+  report.rb = 1ull << 40;
+  report.rb_min = 1;
+  report.rb_max = 1 << 20;
+  report.rb_sigma = 1234.5;
+  report.rv_op = 3;
+  report.rvb_min = 4;
+  report.rvb_max = 5;
+  report.rvb_sum = 6;
+  report.rvb_sigma = 0.25;
+  report.rs_op = 7;
+  report.rsb_min = 8;
+  report.rsb_max = 9;
+  report.rsb_sum = 10;
+  report.rsb_sigma = 0.5;
+  report.rc_min = 11;
+  report.rc_max = 12;
+  report.rc_sum = 13;
+  report.rc_sigma = 0.75;
+  report.wb = 14;
+  report.wb_min = 15;
+  report.wb_max = 16;
+  report.wb_sigma = 1.25;
+  report.sfwdb = 17;
+  report.sbwdb = 18;
+  report.sxlfwdb = 19;
+  report.sxlbwdb = 20;
+  report.nrc = 21;
+  report.nwc = 22;
+  report.nfwds = 23;
+  report.nbwds = 24;
+  report.nxlfwds = 25;
+  report.nxlbwds = 26;
+  report.rt = 1.5;
+  report.rvt = 2.5;
+  report.wt = 3.5;
+  report.osize = 0;
+  report.csize = 1ull << 33;
+  report.sec_prot = "krb5";
+  report.sec_name = "alice";
+  report.sec_client = "lxplus001.cern.ch";
+  report.sec_vorg = "";
+  report.sec_grps = "z2 def-cg";
+  report.sec_role = "";
+  report.sec_info = "/DC=ch/DC=cern/CN=alice";
+  report.sec_app = "fuse";
+}
+}
+
+//------------------------------------------------------------------------------
+// Every field survives Encode and Decode
+//------------------------------------------------------------------------------
+TEST(Report, EncodeDecode)
+{
+  Report in, out;
+  FillReport(in);
+  std::string encoded;
+  in.Encode(encoded);
+  ASSERT_TRUE(Report::IsBinary(encoded.c_str()));
+  // url alphabet only, so it is a valid message body
+  ASSERT_EQ(std::string::npos, encoded.find_first_of("+/=&\n ",
+            strlen(Report::sBinaryTag)));
+  ASSERT_TRUE(out.Decode(encoded.c_str()));
+  ASSERT_EQ(in.ots, out.ots);
+  ASSERT_EQ(in.cts, out.cts);
+  ASSERT_EQ(in.otms, out.otms);
+  ASSERT_EQ(in.ctms, out.ctms);
+  ASSERT_EQ(in.logid, out.logid);
+  ASSERT_EQ(in.path, out.path);
+  ASSERT_EQ(in.uid, out.uid);
+  ASSERT_EQ(in.gid, out.gid);
+  ASSERT_EQ(in.td, out.td);
+  ASSERT_EQ(in.host, out.host);
+  ASSERT_EQ(in.lid, out.lid);
+  ASSERT_EQ(in.fid, out.fid);
+  ASSERT_EQ(in.fsid, out.fsid);
+  ASSERT_EQ(in.rb, out.rb);
+  ASSERT_EQ(in.rb_min, out.rb_min);
+  ASSERT_EQ(in.rb_max, out.rb_max);
+  ASSERT_EQ(in.rb_sigma, out.rb_sigma);
+  ASSERT_EQ(in.rv_op, out.rv_op);
+  ASSERT_EQ(in.rvb_min, out.rvb_min);
+  ASSERT_EQ(in.rvb_max, out.rvb_max);
+  ASSERT_EQ(in.rvb_sum, out.rvb_sum);
+  ASSERT_EQ(in.rvb_sigma, out.rvb_sigma);
+  ASSERT_EQ(in.rs_op, out.rs_op);
+  ASSERT_EQ(in.rsb_min, out.rsb_min);
+  ASSERT_EQ(in.rsb_max, out.rsb_max);
+  ASSERT_EQ(in.rsb_sum, out.rsb_sum);
+  ASSERT_EQ(in.rsb_sigma, out.rsb_sigma);
+  ASSERT_EQ(in.rc_min, out.rc_min);
+  ASSERT_EQ(in.rc_max, out.rc_max);
+  ASSERT_EQ(in.rc_sum, out.rc_sum);
+  ASSERT_EQ(in.rc_sigma, out.rc_sigma);
+  ASSERT_EQ(in.wb, out.wb);
+  ASSERT_EQ(in.wb_min, out.wb_min);
+  ASSERT_EQ(in.wb_max, out.wb_max);
+  ASSERT_EQ(in.wb_sigma, out.wb_sigma);
+  ASSERT_EQ(in.sfwdb, out.sfwdb);
+  ASSERT_EQ(in.sbwdb, out.sbwdb);
+  ASSERT_EQ(in.sxlfwdb, out.sxlfwdb);
+  ASSERT_EQ(in.sxlbwdb, out.sxlbwdb);
+  ASSERT_EQ(in.nrc, out.nrc);
+  ASSERT_EQ(in.nwc, out.nwc);
+  ASSERT_EQ(in.nfwds, out.nfwds);
+  ASSERT_EQ(in.nbwds, out.nbwds);
+  ASSERT_EQ(in.nxlfwds, out.nxlfwds);
+  ASSERT_EQ(in.nxlbwds, out.nxlbwds);
+  ASSERT_EQ(in.rt, out.rt);
+  ASSERT_EQ(in.rvt, out.rvt);
+  ASSERT_EQ(in.wt, out.wt);
+  ASSERT_EQ(in.osize, out.osize);
+  ASSERT_EQ(in.csize, out.csize);
+  ASSERT_EQ(in.sec_prot, out.sec_prot);
+  ASSERT_EQ(in.sec_name, out.sec_name);
+  ASSERT_EQ(in.sec_client, out.sec_client);
+  ASSERT_EQ(in.sec_vorg, out.sec_vorg);
+  ASSERT_EQ(in.sec_grps, out.sec_grps);
+  ASSERT_EQ(in.sec_role, out.sec_role);
+  ASSERT_EQ(in.sec_info, out.sec_info);
+  ASSERT_EQ(in.sec_app, out.sec_app);
+  // the derived host names are filled by Decode
+  ASSERT_EQ("fst-01", out.server_name);
+  ASSERT_EQ("cern.ch", out.server_domain);
+  ASSERT_EQ("lxplus001", out.sec_host);
+  ASSERT_EQ("cern.ch", out.sec_domain);
+  // and encoding the decoded report gives the same record
+  std::string reencoded;
+  out.Encode(reencoded);
+  ASSERT_EQ(encoded, reencoded);
+}
+
+//------------------------------------------------------------------------------
+// An empty report round trips too
+//------------------------------------------------------------------------------
+TEST(Report, EncodeDecodeEmpty)
+{
+  Report in, out;
+  std::string encoded, reencoded;
+  out.uid = 42;
+  out.path = "stale";
+  in.Encode(encoded);
+  ASSERT_TRUE(out.Decode(encoded.c_str()));
+  ASSERT_EQ(0u, out.uid);
+  ASSERT_EQ("", out.path);
+  ASSERT_EQ("none", out.td);
+  out.Encode(reencoded);
+  ASSERT_EQ(encoded, reencoded);
+}
+
+//------------------------------------------------------------------------------
+// Env reports, truncated and corrupt records are rejected by Decode
+//------------------------------------------------------------------------------
+TEST(Report, DecodeInvalid)
+{
+  Report in, out;
+  FillReport(in);
+  std::string encoded;
+  in.Encode(encoded);
+  ASSERT_FALSE(Report::IsBinary("log=abc&path=/eos/x&ruid=1"));
+  ASSERT_FALSE(out.Decode("log=abc&path=/eos/x&ruid=1"));
+  ASSERT_FALSE(out.Decode(nullptr));
+  ASSERT_FALSE(out.Decode(Report::sBinaryTag));
+
+  // every truncation of the record is detected
+  for (size_t len = strlen(Report::sBinaryTag); len < encoded.length(); ++len) {
+    ASSERT_FALSE(out.Decode(encoded.substr(0, len).c_str())) << "len=" << len;
+  }
+
+  // characters outside of the url alphabet
+  std::string corrupt = encoded;
+  corrupt[strlen(Report::sBinaryTag) + 5] = '+';
+  ASSERT_FALSE(out.Decode(corrupt.c_str()));
+  // unknown version
+  Report other;
+  corrupt = encoded;
+  corrupt[strlen(Report::sBinaryTag)] = 'Z';
+  ASSERT_FALSE(other.Decode(corrupt.c_str()));
+}
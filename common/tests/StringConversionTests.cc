@@ -0,0 +1,181 @@
+//------------------------------------------------------------------------------
+// File: StringConversionTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "common/StringConversion.hh"
+#include "common/SymKeys.hh"
+#include <climits>
+#include <set>
+#include <string>
+#include <vector>
+
+using eos::common::StringConversion;
+
+namespace
+{
+typedef std::set<unsigned long long> IdSet;
+
+//------------------------------------------------------------------------------
+// Encode and decode a set of ids
+//------------------------------------------------------------------------------
+IdSet
+RoundTrip(const IdSet& in)
+{
+  std::string encoded;
+  IdSet out;
+  StringConversion::EncodeIdSet(in.begin(), in.end(), encoded);
+  EXPECT_TRUE(StringConversion::DecodeIdSet(encoded.c_str(), out));
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Base64 encode raw varint bytes the way EncodeIdSet does
+//------------------------------------------------------------------------------
+std::string
+Base64(const std::string& raw)
+{
+  XrdOucString out64;
+  eos::common::SymKey::Base64Encode((char*) raw.c_str(), raw.length(), out64);
+  return out64.c_str();
+}
+}
+
+//------------------------------------------------------------------------------
+// An empty set is an empty string and back
+//------------------------------------------------------------------------------
+TEST(IdSet, Empty)
+{
+  IdSet empty, out;
+  std::string encoded = "garbage";
+  StringConversion::EncodeIdSet(empty.begin(), empty.end(), encoded);
+  ASSERT_TRUE(encoded.empty());
+  ASSERT_TRUE(StringConversion::DecodeIdSet("", out));
+  ASSERT_TRUE(StringConversion::DecodeIdSet(nullptr, out));
+  ASSERT_TRUE(out.empty());
+}
+
+//------------------------------------------------------------------------------
+// Ids around the varint byte boundaries survive the round trip
+//------------------------------------------------------------------------------
+TEST(IdSet, RoundTrip)
+{
+  IdSet in = {0, 1, 127, 128, 255, 16383, 16384, 16385, 2097151, 2097152,
+              (1ull << 32) - 1, 1ull << 32, (1ull << 56) + 3
+             };
+  ASSERT_EQ(in, RoundTrip(in));
+
+  for (unsigned long long id = 1; id < 100000; id += 7) {
+    in.insert(id);
+  }
+
+  ASSERT_EQ(in, RoundTrip(in));
+}
+
+//------------------------------------------------------------------------------
+// The largest fid takes the longest varint
+//------------------------------------------------------------------------------
+TEST(IdSet, MaxFid)
+{
+  IdSet in = {ULLONG_MAX};
+  ASSERT_EQ(in, RoundTrip(in));
+  in = {0, 1, ULLONG_MAX - 1, ULLONG_MAX};
+  ASSERT_EQ(in, RoundTrip(in));
+}
+
+//------------------------------------------------------------------------------
+// Ids given unsorted and repeated are sent once and merged into the
+// receiving set
+//------------------------------------------------------------------------------
+TEST(IdSet, UnsortedDuplicateInput)
+{
+  std::vector<unsigned long long> ids = {42, 7, 42, 1000000, 7, 3, 1000000};
+  IdSet in(ids.begin(), ids.end());
+  std::string encoded;
+  StringConversion::EncodeIdSet(in.begin(), in.end(), encoded);
+  IdSet out = {5, 7};
+  ASSERT_TRUE(StringConversion::DecodeIdSet(encoded.c_str(), out));
+  IdSet expected = {3, 5, 7, 42, 1000000};
+  ASSERT_EQ(expected, out);
+  // a zero delta, which EncodeIdSet never produces, is still the same id
+  out.clear();
+  ASSERT_TRUE(StringConversion::DecodeIdSet(Base64(std::string("\x05\x00\x00",
+              3)).c_str(), out));
+  ASSERT_EQ(IdSet({5}), out);
+}
+
+//------------------------------------------------------------------------------
+// A set sent in several chunks is decoded into the same set
+//------------------------------------------------------------------------------
+TEST(IdSet, Chunks)
+{
+  IdSet in, out;
+
+  for (unsigned long long id = 1000; id < 50000; id += 13) {
+    in.insert(id);
+  }
+
+  auto middle = in.begin();
+  std::advance(middle, in.size() / 2);
+  std::string first, second;
+  StringConversion::EncodeIdSet(in.begin(), middle, first);
+  StringConversion::EncodeIdSet(middle, in.end(), second);
+  ASSERT_TRUE(StringConversion::DecodeIdSet(first.c_str(), out));
+  ASSERT_TRUE(StringConversion::DecodeIdSet(second.c_str(), out));
+  ASSERT_EQ(in, out);
+}
+
+//------------------------------------------------------------------------------
+// A last id cut in the middle of its varint is rejected
+//------------------------------------------------------------------------------
+TEST(IdSet, Truncated)
+{
+  IdSet out;
+  // 300 is 0xac 0x02
+  ASSERT_TRUE(StringConversion::DecodeIdSet(Base64("\xac\x02").c_str(), out));
+  ASSERT_EQ(IdSet({300}), out);
+  out.clear();
+  ASSERT_FALSE(StringConversion::DecodeIdSet(Base64("\x01\xac").c_str(), out));
+  // the max fid without its last byte
+  out.clear();
+  std::string raw(9, '\xff');
+  ASSERT_FALSE(StringConversion::DecodeIdSet(Base64(raw).c_str(), out));
+  raw += '\x01';
+  ASSERT_TRUE(StringConversion::DecodeIdSet(Base64(raw).c_str(), out));
+  ASSERT_EQ(IdSet({ULLONG_MAX}), out);
+}
+
+//------------------------------------------------------------------------------
+// Varints longer than 64 bits and text that is not base64 are rejected
+//------------------------------------------------------------------------------
+TEST(IdSet, Corrupt)
+{
+  IdSet out;
+  std::string raw(10, '\x80');
+  raw += '\x01';
+  ASSERT_FALSE(StringConversion::DecodeIdSet(Base64(raw).c_str(), out));
+  ASSERT_FALSE(StringConversion::DecodeIdSet("*not:base64*", out));
+  ASSERT_FALSE(StringConversion::DecodeIdSet("AQI", out));
+  ASSERT_FALSE(StringConversion::DecodeIdSet("AQ=I", out));
+  ASSERT_FALSE(StringConversion::DecodeIdSet("A===", out));
+  // valid base64 of bytes all announcing a next one
+  ASSERT_FALSE(StringConversion::DecodeIdSet("////", out));
+  ASSERT_TRUE(out.empty());
+}
@@ -47,6 +47,9 @@ com_find(char* arg1)
   XrdOucString stripes = "";
   XrdOucString versions = "";
   XrdOucString filematch = "";
+  XrdOucString minsize = "";
+  XrdOucString maxsize = "";
+  XrdOucString layout = "";
   XrdOucString in = "mgm.cmd=find&";
   bool valid = false;
 
@@ -290,6 +293,37 @@ com_find(char* arg1)
       }
     }
 
+    if ((s1 == "--minsize") || (s1 == "--maxsize")) {
+      valid = true;
+      XrdOucString size = subtokenizer.GetToken();
+      option += "f";
+      unsigned long long nbytes =
+        eos::common::StringConversion::GetSizeFromString(size);
+
+      if (!size.length() || errno) {
+        goto com_find_usage;
+      }
+
+      char ssize[64];
+      snprintf(ssize, sizeof(ssize), "%llu", nbytes);
+
+      if (s1 == "--minsize") {
+        minsize = ssize;
+      } else {
+        maxsize = ssize;
+      }
+    }
+
+    if (s1 == "--layout") {
+      valid = true;
+      layout = subtokenizer.GetToken();
+      option += "f";
+
+      if (!layout.length()) {
+        goto com_find_usage;
+      }
+    }
+
     if (s1 == "-layoutstripes") {
       valid = true;
       stripes = subtokenizer.GetToken();
@@ -736,6 +770,21 @@ com_find(char* arg1)
     in += printkey;
   }
 
+  if (minsize.length()) {
+    in += "&mgm.find.minsize=";
+    in += minsize;
+  }
+
+  if (maxsize.length()) {
+    in += "&mgm.find.maxsize=";
+    in += maxsize;
+  }
+
+  if (layout.length()) {
+    in += "&mgm.find.layout=";
+    in += layout;
+  }
+
   XrdOucEnv* result;
   result = client_user_command(in);
 
@@ -752,7 +801,7 @@ com_find(char* arg1)
   return (0);
 com_find_usage:
   fprintf(stdout,
-          "usage: find [-name <pattern>] [--xurl] [--childcount] [--purge <n> ] [--count] [-s] [-d] [-f] [-0] [-1] [-ctime +<n>|-<n>] [-m] [-x <key>=<val>] [-p <key>] [-b] [-c %%tags] [-layoutstripes <n>] <path>\n");
+          "usage: find [-name <pattern>] [--xurl] [--childcount] [--purge <n> ] [--count] [-s] [-d] [-f] [-0] [-1] [-ctime +<n>|-<n>] [-m] [-x <key>=<val>] [-p <key>] [-b] [-c %%tags] [-layoutstripes <n>] [--minsize <size>] [--maxsize <size>] [--layout <type>] <path>\n");
   fprintf(stdout,
           "                                                                        -f -d :  find files(-f) or directories (-d) in <path>\n");
   fprintf(stdout,
@@ -779,6 +828,12 @@ com_find_usage:
           "                                                           -layoutstripes <n> :  apply new layout with <n> stripes to all files found\n");
   fprintf(stdout,
           "                                                               --maxdepth <n> :  descend only <n> levels\n");
+  fprintf(stdout,
+          "                                                           --minsize <size> :  find files with at least <size> bytes e.g. 1M\n");
+  fprintf(stdout,
+          "                                                           --maxsize <size> :  find files with at most <size> bytes e.g. 1G\n");
+  fprintf(stdout,
+          "                                                            --layout <type> :  find files with layout <type> plain|replica|archive|raiddp|raid6\n");
   fprintf(stdout,
           "                                                                           -1 :  find files which are atleast 1 hour old\n");
   fprintf(stdout,
@@ -233,9 +233,9 @@ com_io_usage:
   fprintf(stdout,
           "       io report <path>                                           :  show contents of report namespace for <path>\n");
   fprintf(stdout,
-          "       io ns [-a] [-n] [-b] [-100|-1000|-10000] [-w] [-f]         :  show namespace IO ranking (popularity)\n");
+          "       io ns [-a] [-n] [-b] [-100|-1000|-10000] [-w] [-f]         :  show file IO ranking (popularity)\n");
   fprintf(stdout,
-          "                                                               -a    don't limit the output list\n");
+          "                                                               -a    show all the ranked files (10000 per day)\n");
   fprintf(stdout,
           "                                                               -n :  show ranking by number of accesses \n");
   fprintf(stdout,
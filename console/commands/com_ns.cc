@@ -40,13 +40,14 @@ com_ns(char* arg1)
   XrdOucString delay;
   XrdOucString interval;
   XrdOucString compacttype;
+  XrdOucString threshold;
 
   if (wants_help(arg1)) {
     goto com_ns_usage;
   }
 
   if ((cmd != "stat") && (cmd != "") && (cmd != "compact") && (cmd != "master") &&
-      (cmd != "mutex")) {
+      (cmd != "mutex") && (cmd != "latency") && (cmd != "workflow")) {
     goto com_ns_usage;
   }
 
@@ -56,6 +57,14 @@ com_ns(char* arg1)
     in += "mgm.subcmd=stat";
   }
 
+  if (cmd == "latency") {
+    in += "mgm.subcmd=latency";
+  }
+
+  if (cmd == "workflow") {
+    in += "mgm.subcmd=workflow";
+  }
+
   if (cmd == "compact") {
     in += "mgm.subcmd=compact";
     state = subtokenizer.GetToken();
@@ -135,6 +144,19 @@ com_ns(char* arg1)
       break;
     }
 
+    if ((cmd == "latency") && (option == "--threshold")) {
+      threshold = subtokenizer.GetToken();
+
+      if (!threshold.length() ||
+          (strspn(threshold.c_str(), "0123456789") != (size_t) threshold.length())) {
+        goto com_ns_usage;
+      }
+
+      in += "&mgm.ns.latency.threshold=";
+      in += threshold;
+      continue;
+    }
+
     if (option == "-a") {
       options += "a";
     } else {
@@ -200,6 +222,20 @@ com_ns_usage:
           "                -n                                                   -  print numerical uid/gids\n");
   fprintf(stdout,
           "                --reset                                              -  reset namespace counter\n");
+  fprintf(stdout,
+          "       ns latency [-a] [-m] [--reset] [--threshold <ms>]          :  print p50/p99/p999 latencies of the open phases\n");
+  fprintf(stdout,
+          "                -a                                                   -  show the most recent slow opens\n");
+  fprintf(stdout,
+          "                -m                                                   -  print in <key>=<val> monitoring format\n");
+  fprintf(stdout,
+          "                --reset                                              -  reset the histograms and slow opens\n");
+  fprintf(stdout,
+          "                --threshold <ms>                                     -  record opens slower than <ms> as slow (default 1000 or $EOS_MGM_OPEN_SLOW_MS on the MGM)\n");
+  fprintf(stdout,
+          "       ns workflow [-m]                                           :  print the queued, running and finished jobs and the latencies per workflow\n");
+  fprintf(stdout,
+          "                -m                                                   -  print in <key>=<val> monitoring format\n");
 #ifdef EOS_INSTRUMENTED_RWMUTEX
   fprintf(stdout,
           "       ns mutex                                                   :  manage mutex monitoring\n");
@@ -80,12 +80,26 @@ com_recycle(char* arg1)
     }
   } while (1);
 
-  if ((subcmd == "ls") && options.size()) {
-    goto com_recycle_usage;
-  }
+  if (subcmd == "ls") {
+    // every paging option takes the next argument as value
+    if (options.size() != args.size()) {
+      goto com_recycle_usage;
+    }
 
-  if ((subcmd == "ls") && args.size()) {
-    goto com_recycle_usage;
+    for (size_t i = 0; i < options.size(); i++) {
+      if (((options[i] != "--offset") && (options[i] != "--limit")) ||
+          (args[i].find_first_not_of("0123456789") != std::string::npos)) {
+        goto com_recycle_usage;
+      }
+
+      in += "&mgm.recycle.";
+      in += options[i].c_str() + 2;
+      in += "=";
+      in += args[i].c_str();
+    }
+
+    options.clear();
+    args.clear();
   }
 
   if ((subcmd == "purge") && options.size()) {
@@ -172,9 +186,13 @@ com_recycle_usage:
   fprintf(stdout, "recycle :\n");
   fprintf(stdout,
           "                                                  print status of recycle bin and if executed by root the recycle bin configuration settings.\n");
-  fprintf(stdout, "recycle ls :\n");
+  fprintf(stdout, "recycle ls [--offset <n>] [--limit <n>] :\n");
+  fprintf(stdout,
+          "                                                  list files in the recycle bin ordered by deletion time\n");
+  fprintf(stdout,
+          "       --offset <n> : skip the <n> oldest entries\n");
   fprintf(stdout,
-          "                                                  list files in the recycle bin\n");
+          "       --limit <n>  : list at most <n> entries\n");
   fprintf(stdout, "recycle purge :\n");
   fprintf(stdout,
           "                                                  purge files in the recycle bin\n");
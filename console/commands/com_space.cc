@@ -497,14 +497,26 @@ com_space_usage:
           "       space config <space-name> space.converter=on|off              : enable/disable the space converter [default=off]\n");
   fprintf(stdout,
           "       space config <space-name> space.converter.ntx=<#>             : configure the number of parallel conversions per space                 [ default=2 (streams) ]\n");
+  fprintf(stdout,
+          "       space config <space-name> space.converter.rate=<MB/s>         : configure the maximum conversion throughput of a space                 [ default=0 (unlimited) ]\n");
   fprintf(stdout,
           "       space config <space-name> space.drainer.node.rate=<MB/s >     : configure the nominal transfer bandwith per running transfer on a node [ default=25 (MB/s)   ]\n");
   fprintf(stdout,
           "       space config <space-name> space.drainer.node.ntx=<#>          : configure the number of parallel draining transfers per node           [ default=2 (streams) ]\n");
+  fprintf(stdout,
+          "       space config <space-name> space.drainer.fs.ntx=<#>            : configure the number of parallel draining transfers per filesystem     [ default=5 (streams) ]\n");
+  fprintf(stdout,
+          "       space config <space-name> space.drainer.central=on|off        : enable/disable the scheduling of the drain transfers by the MGM [default=on]\n");
   fprintf(stdout,
           "       space config <space-name> space.lru=on|off                    : enable/disable the LRU policy engine [default=off]\n");
   fprintf(stdout,
           "       space config <space-name> space.lru.interval=<sec>            : configure the default lru scan interval\n");
+  fprintf(stdout,
+          "       space config default space.wfe.ntx=<#>                        : configure the number of parallel workflow jobs [ default=0 (unlimited) ]\n");
+  fprintf(stdout,
+          "       space config default space.wfe.workflow.ntx=<#>               : configure the number of parallel jobs of one workflow [ default=0 (unlimited) ]\n");
+  fprintf(stdout,
+          "       space config default space.wfe.export=on|off                  : also store the workflow jobs in the workflow proc directory [default=off]\n");
   fprintf(stdout,
           "       space config <space-name> space.headroom=<size>               : configure the default disk headroom if not defined on a filesystem (see fs for details)\n");
   fprintf(stdout,
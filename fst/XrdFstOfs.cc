@@ -105,7 +105,7 @@ EOSFSTNAMESPACE_BEGIN
 // Constructor
 //------------------------------------------------------------------------------
 XrdFstOfs::XrdFstOfs() :
-  eos::common::LogId(), mHostName(NULL), mHttpd(0),
+  eos::common::LogId(), mHostName(NULL), mBinaryReports(false), mHttpd(0),
   Simulate_IO_read_error(false), Simulate_IO_write_error(false),
   Simulate_XS_read_error(false), Simulate_XS_write_error(false),
   Simulate_FMD_open_error(false)
@@ -284,6 +284,8 @@ XrdFstOfs::Configure(XrdSysError& Eroute, XrdOucEnv* envP)
     return 1;
   }
 
+  mBinaryReports = (getenv("EOS_FST_BINARY_REPORTS") &&
+                    !strcmp(getenv("EOS_FST_BINARY_REPORTS"), "1"));
   TransferScheduler = new XrdScheduler(&Eroute, &OfsTrace, 8, 128, 60);
   TransferScheduler->Start();
   eos::fst::Config::gConfig.autoBoot = false;
@@ -917,6 +919,12 @@ void
 XrdFstOfs::SendFsck(XrdMqMessage* message)
 {
   XrdOucEnv opaque(message->GetBody());
+
+  if (opaque.Get("mgm.fsck.seq")) {
+    SendFsckDelta(message, opaque);
+    return;
+  }
+
   XrdOucString stdOut = "";
   // The tag is either '*' for all or a, seperated list of tag names
   XrdOucString tag = opaque.Get("mgm.fsck.tags");
@@ -1004,6 +1012,142 @@ XrdFstOfs::SendFsck(XrdMqMessage* message)
   }
 }
 
+//------------------------------------------------------------------------------
+// Send the changes of the inconsistencies since the last fsck report
+// acknowledged by the MGM. Each filesystem gets the lines
+//   <tag>@<fsid>+<ids> for the file ids new since the last report
+//   <tag>@<fsid>-<ids> for the file ids gone since the last report
+// where <ids> is a set encoded by StringConversion::EncodeIdSet, followed by
+//   #<fsid>:<base>:<seq>:<lines>
+// giving the sequence number the report is based on (0 for a full report),
+// the one of the report and the number of lines sent for the filesystem.
+//------------------------------------------------------------------------------
+void
+XrdFstOfs::SendFsckDelta(XrdMqMessage* message, XrdOucEnv& opaque)
+{
+  // Number of file ids encoded per line
+  static const size_t sIdsPerLine = 4096;
+  std::string peer = message->kMessageHeader.kSenderId.c_str();
+  unsigned long long seq = strtoull(opaque.Get("mgm.fsck.seq"), 0, 10);
+  unsigned long long ack = opaque.Get("mgm.fsck.ack") ?
+                           strtoull(opaque.Get("mgm.fsck.ack"), 0, 10) : 0;
+  std::set<eos::common::FileSystem::fsid_t> resync;
+
+  if (opaque.Get("mgm.fsck.resync")) {
+    std::vector<std::string> tokens;
+    eos::common::StringConversion::Tokenize(opaque.Get("mgm.fsck.resync"), tokens,
+                                            ",");
+
+    for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+      resync.insert(strtoul(it->c_str(), 0, 10));
+    }
+  }
+
+  std::string stdOut;
+  auto send = [&]() {
+    XrdMqMessage repmessage("fsck reply message");
+    repmessage.SetBody(stdOut.c_str());
+    repmessage.MarkAsMonitor();
+
+    if (!XrdMqMessaging::gMessageClient.ReplyMessage(repmessage, *message)) {
+      eos_err("unable to send fsck reply message to %s",
+              message->kMessageHeader.kSenderId.c_str());
+    }
+
+    stdOut.clear();
+  };
+  eos::common::RWMutexReadLock lock(gOFS.Storage->fsMutex);
+
+  for (unsigned int i = 0; i < gOFS.Storage->fileSystemsVector.size(); i++) {
+    eos::fst::FileSystem* fs = gOFS.Storage->fileSystemsVector[i];
+    eos::common::FileSystem::fsid_t fsid = fs->GetId();
+    std::map<std::string, std::set<eos::common::FileId::fileid_t> > current;
+    std::map<std::string, std::set<eos::common::FileId::fileid_t> > added;
+    std::map<std::string, std::set<eos::common::FileId::fileid_t> > removed;
+    unsigned long long base = 0;
+    {
+      XrdSysMutexHelper ISLock(fs->InconsistencyStatsMutex);
+
+      // we don't report filesystems which are not booted, so their
+      // inconsistencies are reported as gone
+      if (fs->GetStatus() == eos::common::FileSystem::kBooted) {
+        std::map<std::string, std::set<eos::common::FileId::fileid_t> >* icset =
+          fs->GetInconsistencySets();
+        XrdSysMutexHelper wLock(gOFS.OpenFidMutex);
+        auto wopen = gOFS.WOpenFid.find(fsid);
+
+        for (auto icit = icset->begin(); icit != icset->end(); ++icit) {
+          if ((icit->first == "mem_n") || (icit->first == "d_sync_n") ||
+              (icit->first == "m_sync_n")) {
+            continue;
+          }
+
+          std::set<eos::common::FileId::fileid_t>& fids = current[icit->first];
+
+          for (auto fit = icit->second.begin(); fit != icit->second.end(); ++fit) {
+            // don't report files which are currently write-open
+            if (wopen != gOFS.WOpenFid.end()) {
+              auto wit = wopen->second.find(*fit);
+
+              if ((wit != wopen->second.end()) && (wit->second > 0)) {
+                continue;
+              }
+            }
+
+            fids.insert(fids.end(), *fit);
+          }
+        }
+      }
+
+      base = fs->FsckDelta(peer, ack, seq, resync.count(fsid), current, added,
+                           removed);
+    }
+    size_t nlines = 0;
+
+    for (int op = 0; op < 2; op++) {
+      std::map<std::string, std::set<eos::common::FileId::fileid_t> >& delta =
+        op ? removed : added;
+
+      for (auto it = delta.begin(); it != delta.end(); ++it) {
+        auto begin = it->second.begin();
+
+        while (begin != it->second.end()) {
+          auto end = begin;
+
+          for (size_t n = 0; (n < sIdsPerLine) && (end != it->second.end()); n++) {
+            ++end;
+          }
+
+          std::string ids;
+          eos::common::StringConversion::EncodeIdSet(begin, end, ids);
+          begin = end;
+
+          if (stdOut.length() > (64 * 1024)) {
+            send();
+          }
+
+          char stag[4096];
+          snprintf(stag, sizeof(stag) - 1, "%s@%lu%c", it->first.c_str(),
+                   (unsigned long) fsid, op ? '-' : '+');
+          stdOut += stag;
+          stdOut += ids;
+          stdOut += "\n";
+          nlines++;
+        }
+      }
+    }
+
+    char header[256];
+    snprintf(header, sizeof(header) - 1, "#%lu:%llu:%llu:%lu\n",
+             (unsigned long) fsid, base, seq, (unsigned long) nlines);
+    stdOut += header;
+  }
+
+  if (stdOut.length()) {
+    send();
+  }
+}
+
 //------------------------------------------------------------------------------
 // Remove entry - interface function
 //------------------------------------------------------------------------------
@@ -307,6 +307,15 @@ public:
 
   void SendFsck(XrdMqMessage* message);
 
+  //----------------------------------------------------------------------------
+  //! Reply to an incremental fsck request with the changes of the
+  //! inconsistencies since the last report acknowledged by the MGM
+  //!
+  //! @param message fsck request
+  //! @param opaque decoded body of the request
+  //----------------------------------------------------------------------------
+  void SendFsckDelta(XrdMqMessage* message, XrdOucEnv& opaque);
+
   int Stall(XrdOucErrInfo& error, int stime, const char* msg);
 
   int Redirect(XrdOucErrInfo& error, const char* host, int& port);
@@ -348,6 +357,8 @@ public:
   XrdSysMutex TransferSchedulerMutex; ///< protecting the TransferScheduler
   XrdOucString eoscpTransferLog; ///< eoscp.log full path
   const char* mHostName; ///< FST hostname
+  //! Queue the reports in binary format, only if the MGMs can decode it
+  bool mBinaryReports;
 
 private:
   HttpServer* mHttpd; ///< Embedded http server
@@ -234,6 +234,7 @@ XrdFstOfsFile::open(const char* path, XrdSfsFileOpenMode open_mode,
   XrdOucString maskOpaque = opaque ? opaque : "";
   // mask some opaque parameters to shorten the logging
   eos::common::StringConversion::MaskTag(maskOpaque, "cap.sym");
+  eos::common::StringConversion::MaskTag(maskOpaque, "cap.bin");
   eos::common::StringConversion::MaskTag(maskOpaque, "cap.msg");
   eos::common::StringConversion::MaskTag(maskOpaque, "authz");
   // For RAIN layouts if the opaque information contains the tag fst.store=1 the
@@ -1147,10 +1148,10 @@ XrdFstOfsFile::AddWriteTime()
 }
 
 //------------------------------------------------------------------------------
-// Make report
+// Fill a report with the statistics of the file
 //------------------------------------------------------------------------------
 void
-XrdFstOfsFile::MakeReportEnv(XrdOucString& reportString)
+XrdFstOfsFile::MakeReport(eos::common::Report& report)
 {
   // compute avg, min, max, sigma for read and written bytes
   unsigned long long rmin, rmax, rsum;
@@ -1159,70 +1160,105 @@ XrdFstOfsFile::MakeReportEnv(XrdOucString& reportString)
   unsigned long rcmin, rcmax, rcsum;      // readv count
   unsigned long long wmin, wmax, wsum;
   double rsigma, rvsigma, rssigma, rcsigma, wsigma;
-  {
-    XrdSysMutexHelper vecLock(vecMutex);
-    ComputeStatistics(rvec, rmin, rmax, rsum, rsigma);
-    ComputeStatistics(wvec, wmin, wmax, wsum, wsigma);
-    ComputeStatistics(monReadvBytes, rvmin, rvmax, rvsum, rvsigma);
-    ComputeStatistics(monReadSingleBytes, rsmin, rsmax, rssum, rssigma);
-    ComputeStatistics(monReadvCount, rcmin, rcmax, rcsum, rcsigma);
-    char report[16384];
-
-    if (rmin == 0xffffffff) {
-      rmin = 0;
-    }
-
-    if (wmin == 0xffffffff) {
-      wmin = 0;
-    }
-
-    snprintf(report, sizeof(report) - 1,
-             "log=%s&path=%s&ruid=%u&rgid=%u&td=%s&"
-             "host=%s&lid=%lu&fid=%llu&fsid=%lu&"
-             "ots=%lu&otms=%lu&"
-             "cts=%lu&ctms=%lu&"
-             "nrc=%lu&nwc=%lu&"
-             "rb=%llu&rb_min=%llu&rb_max=%llu&rb_sigma=%.02f&"
-             "rv_op=%llu&rvb_min=%llu&rvb_max=%llu&rvb_sum=%llu&rvb_sigma=%.02f&"
-             "rs_op=%llu&rsb_min=%llu&rsb_max=%llu&rsb_sum=%llu&rsb_sigma=%.02f&"
-             "rc_min=%lu&rc_max=%lu&rc_sum=%lu&rc_sigma=%.02f&"
-             "wb=%llu&wb_min=%llu&wb_max=%llu&wb_sigma=%.02f&"
-             "sfwdb=%llu&sbwdb=%llu&sxlfwdb=%llu&sxlbwdb=%llu"
-             "nfwds=%lu&nbwds=%lu&nxlfwds=%lu&nxlbwds=%lu&"
-             "rt=%.02f&rvt=%.02f&wt=%.02f&osize=%llu&csize=%llu&%s"
-             , this->logId, Path.c_str(), this->vid.uid, this->vid.gid, tIdent.c_str()
-             , gOFS.mHostName, lid, fileid, fsid
-             , openTime.tv_sec, (unsigned long) openTime.tv_usec / 1000
-             , closeTime.tv_sec, (unsigned long) closeTime.tv_usec / 1000
-             , rCalls, wCalls
-             , rsum, rmin, rmax, rsigma
-             , (unsigned long long)monReadvBytes.size(), rvmin, rvmax, rvsum, rvsigma
-             , (unsigned long long)monReadSingleBytes.size(), rsmin, rsmax, rssum, rssigma
-             , rcmin, rcmax, rcsum, rcsigma
-             , wsum
-             , wmin
-             , wmax
-             , wsigma
-             , sFwdBytes
-             , sBwdBytes
-             , sXlFwdBytes
-             , sXlBwdBytes
-             , nFwdSeeks
-             , nBwdSeeks
-             , nXlFwdSeeks
-             , nXlBwdSeeks
-             , ((rTime.tv_sec * 1000.0) + (rTime.tv_usec / 1000.0))
-             , ((rvTime.tv_sec * 1000.0) + (rvTime.tv_usec / 1000.0))
-             , ((wTime.tv_sec * 1000.0) + (wTime.tv_usec / 1000.0))
-             , (unsigned long long) openSize
-             , (unsigned long long) closeSize
-             , eos::common::SecEntity::ToEnv(SecString.c_str(),
-                 ((tpcFlag == kTpcDstSetup) ||
-                  (tpcFlag == kTpcSrcRead)) ? "tpc" : 0).c_str());
-    reportString = report;
+  XrdSysMutexHelper vecLock(vecMutex);
+  ComputeStatistics(rvec, rmin, rmax, rsum, rsigma);
+  ComputeStatistics(wvec, wmin, wmax, wsum, wsigma);
+  ComputeStatistics(monReadvBytes, rvmin, rvmax, rvsum, rvsigma);
+  ComputeStatistics(monReadSingleBytes, rsmin, rsmax, rssum, rssigma);
+  ComputeStatistics(monReadvCount, rcmin, rcmax, rcsum, rcsigma);
+
+  if (rmin == 0xffffffff) {
+    rmin = 0;
+  }
+
+  if (wmin == 0xffffffff) {
+    wmin = 0;
+  }
+
+  report.logid = this->logId;
+  report.path = Path.c_str();
+  report.uid = this->vid.uid;
+  report.gid = this->vid.gid;
+  report.td = tIdent.c_str();
+  report.host = gOFS.mHostName;
+  report.lid = lid;
+  report.fid = fileid;
+  report.fsid = fsid;
+  report.ots = openTime.tv_sec;
+  report.otms = openTime.tv_usec / 1000;
+  report.cts = closeTime.tv_sec;
+  report.ctms = closeTime.tv_usec / 1000;
+  report.nrc = rCalls;
+  report.nwc = wCalls;
+  report.rb = rsum;
+  report.rb_min = rmin;
+  report.rb_max = rmax;
+  report.rb_sigma = rsigma;
+  report.rv_op = monReadvBytes.size();
+  report.rvb_min = rvmin;
+  report.rvb_max = rvmax;
+  report.rvb_sum = rvsum;
+  report.rvb_sigma = rvsigma;
+  report.rs_op = monReadSingleBytes.size();
+  report.rsb_min = rsmin;
+  report.rsb_max = rsmax;
+  report.rsb_sum = rssum;
+  report.rsb_sigma = rssigma;
+  report.rc_min = rcmin;
+  report.rc_max = rcmax;
+  report.rc_sum = rcsum;
+  report.rc_sigma = rcsigma;
+  report.wb = wsum;
+  report.wb_min = wmin;
+  report.wb_max = wmax;
+  report.wb_sigma = wsigma;
+  report.sfwdb = sFwdBytes;
+  report.sbwdb = sBwdBytes;
+  report.sxlfwdb = sXlFwdBytes;
+  report.sxlbwdb = sXlBwdBytes;
+  report.nfwds = nFwdSeeks;
+  report.nbwds = nBwdSeeks;
+  report.nxlfwds = nXlFwdSeeks;
+  report.nxlbwds = nXlBwdSeeks;
+  report.rt = (rTime.tv_sec * 1000.0) + (rTime.tv_usec / 1000.0);
+  report.rvt = (rvTime.tv_sec * 1000.0) + (rvTime.tv_usec / 1000.0);
+  report.wt = (wTime.tv_sec * 1000.0) + (wTime.tv_usec / 1000.0);
+  report.osize = openSize;
+  report.csize = closeSize;
+  // security summary prot|name|host|vorg|grps|role|info|app
+  std::vector<std::string> sec;
+  eos::common::StringConversion::EmptyTokenize(SecString.c_str(), sec, "|");
+
+  if (sec.size() > 7) {
+    report.sec_prot = sec[0];
+    report.sec_name = sec[1];
+    report.sec_client = sec[2];
+    report.sec_vorg = sec[3];
+    report.sec_grps = sec[4];
+    report.sec_role = sec[5];
+    report.sec_info = sec[6];
+    report.sec_app = ((tpcFlag == kTpcDstSetup) || (tpcFlag == kTpcSrcRead)) ?
+                     "tpc" : sec[7];
+
+    if (report.sec_app.find("?") != std::string::npos) {
+      report.sec_app.erase(report.sec_app.find("?"));
+    }
   }
 }
 
+//------------------------------------------------------------------------------
+// Make report
+//------------------------------------------------------------------------------
+void
+XrdFstOfsFile::MakeReportEnv(XrdOucString& reportString)
+{
+  eos::common::Report report;
+  std::string env;
+  MakeReport(report);
+  report.ToEnv(env);
+  reportString = env.c_str();
+}
+
 //------------------------------------------------------------------------------
 // Check if file has been modified while in use
 //------------------------------------------------------------------------------
@@ -1924,7 +1960,17 @@ XrdFstOfsFile::close()
       if ((tpcFlag != kTpcSrcSetup) && (tpcFlag != kTpcSrcCanDo)) {
         // We don't want a report for the source tpc setup or can do open
         XrdOucString reportString = "";
-        MakeReportEnv(reportString);
+
+        if (gOFS.mBinaryReports) {
+          eos::common::Report report;
+          std::string encoded;
+          MakeReport(report);
+          report.Encode(encoded);
+          reportString = encoded.c_str();
+        } else {
+          MakeReportEnv(reportString);
+        }
+
         gOFS.ReportQueueMutex.Lock();
         gOFS.ReportQueue.push(reportString);
         gOFS.ReportQueueMutex.UnLock();
@@ -37,6 +37,7 @@
 #include "XrdOfsTPCInfo.hh"
 #include "common/Logging.hh"
 #include "common/Fmd.hh"
+#include "common/Report.hh"
 #include "common/SecEntity.hh"
 #include "fst/Namespace.hh"
 #include "fst/checksum/CheckSum.hh"
@@ -567,6 +568,11 @@ private:
     }
   }
 
+  //--------------------------------------------------------------------------
+  //! Fill a report with the statistics of the file
+  //--------------------------------------------------------------------------
+  void MakeReport(eos::common::Report& report);
+
   //--------------------------------------------------------------------------
   //! Create report as a string
   //--------------------------------------------------------------------------
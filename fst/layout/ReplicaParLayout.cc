@@ -202,6 +202,7 @@ ReplicaParLayout::Open(XrdSfsFileOpenMode flags, mode_t mode,
           XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
           // Mask some opaque parameters to shorten the logging
           eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+          eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
           eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
           eos::common::StringConversion::MaskTag(maskUrl, "authz");
           FileIo* file = FileIoPlugin::GetIoObject(mReplicaUrl[i].c_str(), mOfsFile,
@@ -261,6 +262,7 @@ ReplicaParLayout::Read(XrdSfsFileOffset offset, char* buffer,
       XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
       // mask some opaque parameters to shorten the logging
       eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+      eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
       eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
       eos::common::StringConversion::MaskTag(maskUrl, "authz");
       eos_warning("Failed to read from replica off=%lld, lenght=%i, mask_url=%s",
@@ -298,6 +300,7 @@ ReplicaParLayout::ReadV(XrdCl::ChunkList& chunkList, uint32_t len)
       XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
       // Mask some opaque parameters to shorten the logging
       eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+      eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
       eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
       eos::common::StringConversion::MaskTag(maskUrl, "authz");
       eos_warning("Failed to readv from replica -%s", maskUrl.c_str());
@@ -333,6 +336,7 @@ ReplicaParLayout::Write(XrdSfsFileOffset offset,
       XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
       // mask some opaque parameters to shorten the logging
       eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+      eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
       eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
       eos::common::StringConversion::MaskTag(maskUrl, "authz");
 
@@ -377,6 +381,7 @@ ReplicaParLayout::Truncate(XrdSfsFileOffset offset)
       XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
       // mask some opaque parameters to shorten the logging
       eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+      eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
       eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
       eos::common::StringConversion::MaskTag(maskUrl, "authz");
       eos_err("Failed to truncate replica %i", i);
@@ -420,6 +425,7 @@ ReplicaParLayout::Sync()
     XrdOucString maskUrl = mReplicaUrl[i].c_str() ? mReplicaUrl[i].c_str() : "";
     // mask some opaque parameters to shorten the logging
     eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+    eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
     eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
     eos::common::StringConversion::MaskTag(maskUrl, "authz");
     rc = mReplicaFile[i]->fileSync(mTimeout);
@@ -454,6 +460,7 @@ ReplicaParLayout::Remove()
       XrdOucString maskUrl = mReplicaUrl[0].c_str() ? mReplicaUrl[i].c_str() : "";
       // mask some opaque parameters to shorten the logging
       eos::common::StringConversion::MaskTag(maskUrl, "cap.sym");
+      eos::common::StringConversion::MaskTag(maskUrl, "cap.bin");
       eos::common::StringConversion::MaskTag(maskUrl, "cap.msg");
       eos::common::StringConversion::MaskTag(maskUrl, "authz");
       got_error = true;
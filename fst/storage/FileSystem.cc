@@ -23,6 +23,8 @@
 
 #include "fst/storage/FileSystem.hh"
 #include "fst/XrdFstOfs.hh"
+#include <algorithm>
+#include <iterator>
 
 #ifdef __APPLE__
 #define O_DIRECT 0
@@ -57,6 +59,7 @@ FileSystem::FileSystem(const char* queuepath,
   mTxMultiplexer.Add(mTxExternQueue);
   mTxMultiplexer.Run();
   mRecoverable = false;
+  mFsckSeq = 0;
   mFileIO = FileIoPlugin::GetIoObject(GetPath().c_str());
 }
 
@@ -395,5 +398,72 @@ FileSystem::IoPing()
   eos_info("bw=%lld iops=%d", seqBandwidth, IOPS);
 }
 
+/*----------------------------------------------------------------------------*/
+unsigned long long
+FileSystem::FsckDelta(const std::string& peer, unsigned long long ack,
+                      unsigned long long seq, bool resync,
+                      std::map<std::string, std::set<eos::common::FileId::fileid_t> >& current,
+                      std::map<std::string, std::set<eos::common::FileId::fileid_t> >& added,
+                      std::map<std::string, std::set<eos::common::FileId::fileid_t> >& removed)
+{
+  unsigned long long base = 0;
+  added.clear();
+  removed.clear();
+
+  if (!resync && mFsckSeq && (ack == mFsckSeq) && (peer == mFsckPeer)) {
+    base = mFsckSeq;
+  }
+
+  if (!base) {
+    // full report
+    for (auto it = current.begin(); it != current.end(); ++it) {
+      if (!it->second.empty()) {
+        added[it->first] = it->second;
+      }
+    }
+  } else {
+    for (auto it = current.begin(); it != current.end(); ++it) {
+      auto rit = mFsckReported.find(it->first);
+
+      if (rit == mFsckReported.end()) {
+        if (!it->second.empty()) {
+          added[it->first] = it->second;
+        }
+
+        continue;
+      }
+
+      std::set<eos::common::FileId::fileid_t> diff;
+      std::set_difference(it->second.begin(), it->second.end(),
+                          rit->second.begin(), rit->second.end(),
+                          std::inserter(diff, diff.end()));
+
+      if (!diff.empty()) {
+        added[it->first].swap(diff);
+      }
+
+      std::set_difference(rit->second.begin(), rit->second.end(),
+                          it->second.begin(), it->second.end(),
+                          std::inserter(diff, diff.end()));
+
+      if (!diff.empty()) {
+        removed[it->first].swap(diff);
+      }
+    }
+
+    for (auto rit = mFsckReported.begin(); rit != mFsckReported.end(); ++rit) {
+      if (!current.count(rit->first) && !rit->second.empty()) {
+        removed[rit->first] = rit->second;
+      }
+    }
+  }
+
+  mFsckReported.swap(current);
+  current.clear();
+  mFsckSeq = seq;
+  mFsckPeer = peer;
+  return base;
+}
+
 
 EOSFSTNAMESPACE_END
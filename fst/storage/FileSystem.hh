@@ -71,6 +71,11 @@ private:
   std::map<std::string, std::set<eos::common::FileId::fileid_t> >
   inconsistency_sets;
 
+  std::string mFsckPeer; ///< MGM which got the last fsck report
+  unsigned long long mFsckSeq; ///< Sequence number of the last fsck report
+  //! Inconsistencies sent in the last fsck report
+  std::map<std::string, std::set<eos::common::FileId::fileid_t> > mFsckReported;
+
   long long seqBandwidth; // measurement of sequential bandwidth
   int IOPS; // measurement of IOPS
   FileIo* mFileIO; // file io plugin used for statfs calls
@@ -136,6 +141,29 @@ public:
     return &inconsistency_sets;
   }
 
+  //----------------------------------------------------------------------------
+  //! Compute the fsck report of the filesystem as the difference to the last
+  //! report, and remember the new one. A full report is computed if the
+  //! requesting MGM did not acknowledge the last report. Must be called with
+  //! the InconsistencyStatsMutex held.
+  //!
+  //! @param peer MGM requesting the report
+  //! @param ack sequence number of the last report the MGM applied
+  //! @param seq sequence number of the new report
+  //! @param resync true if the MGM asks for a full report
+  //! @param current inconsistencies to report, emptied by the call
+  //! @param added inconsistencies new since the last report
+  //! @param removed inconsistencies gone since the last report
+  //!
+  //! @return sequence number the report is based on, 0 for a full report
+  //----------------------------------------------------------------------------
+  unsigned long long
+  FsckDelta(const std::string& peer, unsigned long long ack,
+            unsigned long long seq, bool resync,
+            std::map<std::string, std::set<eos::common::FileId::fileid_t> >& current,
+            std::map<std::string, std::set<eos::common::FileId::fileid_t> >& added,
+            std::map<std::string, std::set<eos::common::FileId::fileid_t> >& removed);
+
   void
   SetStatus(eos::common::FileSystem::fsstatus_t status)
   {
@@ -79,6 +79,9 @@ std::map<gid_t, std::string> Access::gGroupRedirection;
 //! global rw mutex protecting all static singletons
 eos::common::RWMutex Access::gAccessMutex;
 
+//! token buckets for the rate stall rules
+RateLimiter Access::gRateLimiter;
+
 /*----------------------------------------------------------------------------*/
 //! constant used in the configuration store
 const char* Access::gUserKey = "BanUsers";
@@ -128,6 +131,7 @@ Access::Reset ()
   Access::gGroupRedirection.clear();
   Access::gStallGlobal = Access::gStallRead = \
     Access::gStallWrite = Access::gStallUserGroup = false;
+  Access::gRateLimiter.Compile(Access::gStallRules);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -141,6 +145,19 @@ Access::ApplyAccessConfig (bool applyredirectandstall)
 /*----------------------------------------------------------------------------*/
 {
   Access::Reset();
+  std::string stall = FsView::gFsView.GetGlobalConfig(gStallKey);
+
+  if (applyredirectandstall)
+  {
+    // resolve the names of the rate rules before locking, this may be slow
+    std::vector<std::string> rules;
+    eos::common::StringConversion::Tokenize(stall, rules, ",");
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+      Access::gRateLimiter.Resolve(rules[i].substr(0, rules[i].find('~')));
+    }
+  }
+
   eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
   std::string userval = FsView::gFsView.GetGlobalConfig(gUserKey);
   std::string groupval = FsView::gFsView.GetGlobalConfig(gGroupKey);
@@ -150,7 +167,6 @@ Access::ApplyAccessConfig (bool applyredirectandstall)
   std::string groupaval = FsView::gFsView.GetGlobalConfig(gAllowedGroupKey);
   std::string hostaval = FsView::gFsView.GetGlobalConfig(gAllowedHostKey);
 
-  std::string stall = FsView::gFsView.GetGlobalConfig(gStallKey);
   std::string redirect = FsView::gFsView.GetGlobalConfig(gRedirectionKey);
 
   // parse the list's and fill the hash
@@ -272,6 +288,7 @@ Access::ApplyAccessConfig (bool applyredirectandstall)
       }
     }
 
+    Access::gRateLimiter.Compile(Access::gStallRules);
     tokens.clear();
     delimiter = ",";
     eos::common::StringConversion::Tokenize(redirect, tokens, delimiter);
@@ -392,6 +409,8 @@ Access::StoreAccessConfig ()
     }
   }
 
+  Access::gRateLimiter.Compile(Access::gStallRules);
+
   for (itredirect = Access::gRedirectionRules.begin();
        itredirect != Access::gRedirectionRules.end(); itredirect++)
   {
@@ -37,6 +37,7 @@
 /*----------------------------------------------------------------------------*/
 #include "mgm/Namespace.hh"
 #include "common/RWMutex.hh"
+#include "mgm/RateLimiter.hh"
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
@@ -151,6 +152,10 @@ public:
   //! global rw mutex protecting all static set's and maps in Access
   static eos::common::RWMutex gAccessMutex;
 
+  //! token buckets compiled from the rate stall rules, can be used without
+  //! holding gAccessMutex
+  static RateLimiter gRateLimiter;
+
   // ---------------------------------------------------------------------------
   // reset/cleear all access rules
   // ---------------------------------------------------------------------------
@@ -0,0 +1,237 @@
+//------------------------------------------------------------------------------
+// File: AttrIndex.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/AttrIndex.hh"
+#include "mgm/XrdMgmOfs.hh"
+#include "common/Logging.hh"
+#include "common/RWMutex.hh"
+#include "namespace/interface/IContainerMDSvc.hh"
+#include "namespace/interface/IView.hh"
+#include "XrdSys/XrdSysTimer.hh"
+#include <cstring>
+#include <vector>
+
+EOSMGMNAMESPACE_BEGIN
+
+const char* AttrIndex::sPrefixes[] = {
+  "sys.lru.", "sys.workflow.", "sys.recycle", 0
+};
+std::mutex AttrIndex::sMutex;
+std::map<std::string, std::set<eos::IContainerMD::id_t> > AttrIndex::sIndex;
+std::atomic<bool> AttrIndex::sReady(false);
+std::atomic<uint64_t> AttrIndex::sGeneration(0);
+std::mutex AttrIndex::sRebuildMutex;
+
+//! Number of containers looked at per namespace lock during a rebuild
+static const eos::IContainerMD::id_t sRebuildBatch = 1000;
+
+//------------------------------------------------------------------------------
+// Check if an attribute key is covered by the index
+//------------------------------------------------------------------------------
+bool
+AttrIndex::IsIndexed(const std::string& key)
+{
+  for (size_t i = 0; sPrefixes[i]; i++) {
+    if (!key.compare(0, strlen(sPrefixes[i]), sPrefixes[i])) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Update the entries of a container
+//------------------------------------------------------------------------------
+void
+AttrIndex::Update(eos::IContainerMD::id_t cid,
+                  const eos::IContainerMD::XAttrMap& attrs)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+
+  for (size_t i = 0; sPrefixes[i]; i++) {
+    std::string prefix = sPrefixes[i];
+    // the first key not smaller than the prefix is the only candidate
+    auto it = attrs.lower_bound(prefix);
+
+    if ((it != attrs.end()) && !it->first.compare(0, prefix.length(), prefix)) {
+      sIndex[prefix].insert(cid);
+    } else {
+      auto iit = sIndex.find(prefix);
+
+      if (iit != sIndex.end()) {
+        iit->second.erase(cid);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove a deleted container
+//------------------------------------------------------------------------------
+void
+AttrIndex::Remove(eos::IContainerMD::id_t cid)
+{
+  std::lock_guard<std::mutex> lock(sMutex);
+
+  for (auto it = sIndex.begin(); it != sIndex.end(); ++it) {
+    it->second.erase(cid);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Drop the index
+//------------------------------------------------------------------------------
+void
+AttrIndex::Invalidate()
+{
+  sGeneration++;
+  sReady = false;
+}
+
+//------------------------------------------------------------------------------
+// Build the index by scanning all the container ids. Containers created or
+// deleted during the scan are handled by Update and Remove, and since the scan
+// goes by id rather than by path, subtrees renamed meanwhile are not missed.
+//------------------------------------------------------------------------------
+bool
+AttrIndex::Rebuild(time_t millisleep)
+{
+  std::lock_guard<std::mutex> rebuild_lock(sRebuildMutex);
+
+  if (sReady) {
+    return true;
+  }
+
+  uint64_t generation = sGeneration;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sIndex.clear();
+  }
+  eos::IContainerMD::id_t maxid = 0;
+  {
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+    maxid = gOFS->eosDirectoryService->getFirstFreeId();
+  }
+  eos_static_info("msg=\"rebuilding attribute index\" containers=%llu",
+                  (unsigned long long) maxid);
+  XrdSysTimer snooze;
+  unsigned long long indexed = 0;
+
+  for (eos::IContainerMD::id_t id = 1; id < maxid; id += sRebuildBatch) {
+    if (millisleep && (id > 1)) {
+      snooze.Wait(millisleep);
+    }
+
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+    for (eos::IContainerMD::id_t cid = id;
+         (cid < id + sRebuildBatch) && (cid < maxid); cid++) {
+      std::shared_ptr<eos::IContainerMD> cmd;
+
+      try {
+        cmd = gOFS->eosDirectoryService->getContainerMD(cid);
+      } catch (eos::MDException& e) {
+        // deleted container
+        continue;
+      }
+
+      if (cmd && cmd->numAttributes()) {
+        eos::IContainerMD::XAttrMap attrs = cmd->getAttributes();
+        Update(cid, attrs);
+        indexed++;
+      }
+    }
+  }
+
+  if (generation != sGeneration) {
+    eos_static_warning("msg=\"attribute index invalidated during the rebuild\"");
+    return false;
+  }
+
+  sReady = true;
+  eos_static_info("msg=\"rebuilt attribute index\" containers-with-attributes=%llu",
+                  indexed);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Get the directories having an attribute matching a key
+//------------------------------------------------------------------------------
+bool
+AttrIndex::Find(const std::string& key,
+                std::map<std::string, std::set<std::string> >& found)
+{
+  if (!sReady || key.empty() || (key[key.length() - 1] != '*')) {
+    return false;
+  }
+
+  std::string prefix = key.substr(0, key.length() - 1);
+  bool indexed = false;
+
+  for (size_t i = 0; sPrefixes[i]; i++) {
+    if (prefix == sPrefixes[i]) {
+      indexed = true;
+      break;
+    }
+  }
+
+  if (!indexed) {
+    return false;
+  }
+
+  std::vector<eos::IContainerMD::id_t> cids;
+  {
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sIndex.find(prefix);
+
+    if (it != sIndex.end()) {
+      cids.assign(it->second.begin(), it->second.end());
+    }
+  }
+
+  // resolve the paths in batches, to not hold the namespace lock for long
+  for (size_t i = 0; i < cids.size(); i += sRebuildBatch) {
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+    for (size_t j = i; (j < i + sRebuildBatch) && (j < cids.size()); j++) {
+      try {
+        std::shared_ptr<eos::IContainerMD> cmd =
+          gOFS->eosDirectoryService->getContainerMD(cids[j]);
+        std::string path = gOFS->eosView->getUri(cmd.get());
+
+        if (path.empty() || (path[path.length() - 1] != '/')) {
+          path += "/";
+        }
+
+        (void) found[path].size();
+      } catch (eos::MDException& e) {
+        eos_static_debug("msg=\"indexed container vanished\" cid=%llu",
+                         (unsigned long long) cids[j]);
+      }
+    }
+  }
+
+  return true;
+}
+
+EOSMGMNAMESPACE_END
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+// File: AttrIndex.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_ATTRINDEX__HH__
+#define __EOSMGM_ATTRINDEX__HH__
+
+#include "mgm/Namespace.hh"
+#include "namespace/interface/IContainerMD.hh"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Index of the containers carrying policy attributes.
+//!
+//! The background services driven by directory attributes (LRU, workflows,
+//! recycling) used to discover their directories with a find over the whole
+//! namespace on every cycle. The index keeps, for a fixed set of attribute
+//! key prefixes, the ids of the containers having at least one attribute
+//! starting with the prefix. It is updated by the namespace operations
+//! changing container attributes, under the namespace write lock, and built
+//! once by scanning all the container ids. Paths are only resolved when the
+//! index is queried, so renames don't touch it.
+//!
+//! The index is only maintained for changes done through this MGM. A slave
+//! follows the changelog instead, therefore the index is invalidated when
+//! the MGM changes role and rebuilt by the next user.
+//------------------------------------------------------------------------------
+class AttrIndex
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Check if an attribute key is covered by the index
+  //----------------------------------------------------------------------------
+  static bool IsIndexed(const std::string& key);
+
+  //----------------------------------------------------------------------------
+  //! Update the entries of a container after its attributes changed. Must be
+  //! called with the namespace write lock held.
+  //!
+  //! @param cid container id
+  //! @param attrs current attributes of the container
+  //----------------------------------------------------------------------------
+  static void Update(eos::IContainerMD::id_t cid,
+                     const eos::IContainerMD::XAttrMap& attrs);
+
+  //----------------------------------------------------------------------------
+  //! Remove a deleted container. Must be called with the namespace write lock
+  //! held.
+  //----------------------------------------------------------------------------
+  static void Remove(eos::IContainerMD::id_t cid);
+
+  //----------------------------------------------------------------------------
+  //! Build the index by scanning all the container ids. The namespace read
+  //! lock is taken for batches of containers only.
+  //!
+  //! @param millisleep milliseconds to sleep between two batches
+  //!
+  //! @return true if the index is ready
+  //----------------------------------------------------------------------------
+  static bool Rebuild(time_t millisleep = 0);
+
+  //----------------------------------------------------------------------------
+  //! Drop the index, the next Rebuild recreates it
+  //----------------------------------------------------------------------------
+  static void Invalidate();
+
+  //----------------------------------------------------------------------------
+  //! Check if the index is built and maintained
+  //----------------------------------------------------------------------------
+  static bool IsReady()
+  {
+    return sReady.load();
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the directories having an attribute matching a key, in the format
+  //! of XrdMgmOfs::_find with nofiles set
+  //!
+  //! @param key attribute prefix followed by '*' e.g. "sys.lru.*"
+  //! @param found map filled with the directory paths, ending with '/'
+  //!
+  //! @return false if the key is not covered or the index is not ready, in
+  //!         which case the caller has to fall back to a find
+  //----------------------------------------------------------------------------
+  static bool Find(const std::string& key,
+                   std::map<std::string, std::set<std::string> >& found);
+
+private:
+  //! Attribute key prefixes which are indexed
+  static const char* sPrefixes[];
+  static std::mutex sMutex; ///< Protecting sIndex
+  //! Map from attribute key prefix to the containers having such a key
+  static std::map<std::string, std::set<eos::IContainerMD::id_t> > sIndex;
+  static std::atomic<bool> sReady; ///< Index built and maintained
+  static std::atomic<uint64_t> sGeneration; ///< Bumped by Invalidate
+  static std::mutex sRebuildMutex; ///< Serializing the rebuilds
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+// File: BalancerCandidates.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/BalancerCandidates.hh"
+#include "mgm/XrdMgmOfs.hh"
+#include "common/Logging.hh"
+#include "namespace/interface/IFsView.hh"
+#include "namespace/interface/IFileMDSvc.hh"
+#include <algorithm>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+BalancerCandidates::BalancerCandidates():
+  mRandom(time(NULL))
+{
+}
+
+//------------------------------------------------------------------------------
+// Smallest file size of a class
+//------------------------------------------------------------------------------
+uint64_t
+BalancerCandidates::ClassMin(size_t sclass)
+{
+  // classes grow by a factor 16 starting at 1 MB
+  return sclass ? (1ull << (16 + 4 * sclass)) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Size class of a file size
+//------------------------------------------------------------------------------
+size_t
+BalancerCandidates::SizeClass(uint64_t size)
+{
+  size_t sclass = sClasses - 1;
+
+  while (sclass && (size < ClassMin(sclass))) {
+    sclass--;
+  }
+
+  return sclass;
+}
+
+//------------------------------------------------------------------------------
+// Sample the file list of a filesystem
+//------------------------------------------------------------------------------
+void
+BalancerCandidates::Sample(eos::common::FileSystem::fsid_t fsid, Pool& pool)
+{
+  for (size_t i = 0; i < sClasses; ++i) {
+    pool.mClass[i].clear();
+  }
+
+  pool.mSampled = time(NULL);
+  size_t nfiles = 0;
+  size_t nsampled = 0;
+  {
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+    eos::IFsView::FileList filelist = gOFS->eosFsView->getFileList(fsid);
+    nfiles = filelist.size();
+
+    if (!nfiles) {
+      return;
+    }
+
+    // every stride-th file starting at a random offset, the order of the
+    // list does not depend on the file size
+    size_t stride = std::max((size_t) 1, nfiles / sPoolSize);
+    size_t offset = mRandom() % stride;
+    size_t i = 0;
+
+    for (auto it = filelist.begin(); it != filelist.end() &&
+         (nsampled < sPoolSize); ++it, ++i) {
+      if ((i % stride) != offset) {
+        continue;
+      }
+
+      nsampled++;
+
+      try {
+        std::shared_ptr<eos::IFileMD> fmd = gOFS->eosFileService->getFileMD(*it);
+        uint64_t size = fmd->getSize();
+
+        // moving empty files does not balance anything
+        if (!size || !fmd->getContainerId()) {
+          continue;
+        }
+
+        pool.mClass[SizeClass(size)].push_back(std::make_pair(*it, size));
+      } catch (eos::MDException& e) {
+        continue;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < sClasses; ++i) {
+    std::shuffle(pool.mClass[i].begin(), pool.mClass[i].end(), mRandom);
+  }
+
+  eos_static_debug("msg=\"sampled balancer candidates\" fsid=%lu files=%lu "
+                   "sampled=%lu", (unsigned long) fsid, (unsigned long) nfiles,
+                   (unsigned long) nsampled);
+}
+
+//------------------------------------------------------------------------------
+// Take a file to move from a filesystem
+//------------------------------------------------------------------------------
+eos::common::FileId::fileid_t
+BalancerCandidates::Take(eos::common::FileSystem::fsid_t fsid,
+                         uint64_t maxsize, uint64_t& size)
+{
+  time_t now = time(NULL);
+  Pool& pool = mPools[fsid];
+  bool empty = true;
+
+  for (size_t i = 0; i < sClasses; ++i) {
+    if (!pool.mClass[i].empty()) {
+      empty = false;
+      break;
+    }
+  }
+
+  if ((now - pool.mSampled) >= (empty ? sEmptyRetry : sMaxAge)) {
+    Sample(fsid, pool);
+  }
+
+  // the largest file which fits
+  for (size_t c = sClasses; c-- > 0;) {
+    Candidates& candidates = pool.mClass[c];
+
+    if (candidates.empty() || (maxsize && (ClassMin(c) > maxsize))) {
+      continue;
+    }
+
+    for (size_t i = candidates.size(); i-- > 0;) {
+      if (!maxsize || (candidates[i].second <= maxsize)) {
+        eos::common::FileId::fileid_t fid = candidates[i].first;
+        size = candidates[i].second;
+        candidates[i] = candidates.back();
+        candidates.pop_back();
+        return fid;
+      }
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Drop the pools of the filesystems not in the given set
+//------------------------------------------------------------------------------
+void
+BalancerCandidates::Retain(const std::set<eos::common::FileSystem::fsid_t>&
+                           fsids)
+{
+  for (auto it = mPools.begin(); it != mPools.end();) {
+    if (fsids.count(it->first)) {
+      ++it;
+    } else {
+      mPools.erase(it++);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Drop all the pools
+//------------------------------------------------------------------------------
+void
+BalancerCandidates::Clear()
+{
+  mPools.clear();
+}
+
+EOSMGMNAMESPACE_END
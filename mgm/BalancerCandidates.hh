@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------
+// File: BalancerCandidates.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_BALANCERCANDIDATES__HH__
+#define __EOSMGM_BALANCERCANDIDATES__HH__
+
+#include "mgm/Namespace.hh"
+#include "common/FileId.hh"
+#include "common/FileSystem.hh"
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Pools of files to move, sampled from the filesystems by the
+//! balancers.
+//!
+//! Taking the file list of a filesystem copies it, so instead of doing it
+//! for every file to move, a sample of the list is taken at once and handed
+//! out one file after the other. The sampled files are kept by size class,
+//! so the balancers can take the largest file which does not overshoot the
+//! imbalance they correct. A pool is sampled again when it is empty or old.
+//!
+//! Only used by the thread of one balancer, not thread-safe.
+//------------------------------------------------------------------------------
+class BalancerCandidates
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  BalancerCandidates();
+
+  //----------------------------------------------------------------------------
+  //! Take a file to move from a filesystem
+  //!
+  //! @param fsid filesystem to take the file from
+  //! @param maxsize maximum size of the file, 0 for any
+  //! @param size filled with the size of the file
+  //!
+  //! @return file id, 0 if there is no suitable file
+  //----------------------------------------------------------------------------
+  eos::common::FileId::fileid_t Take(eos::common::FileSystem::fsid_t fsid,
+                                     uint64_t maxsize, uint64_t& size);
+
+  //----------------------------------------------------------------------------
+  //! Drop the pools of the filesystems not in the given set
+  //----------------------------------------------------------------------------
+  void Retain(const std::set<eos::common::FileSystem::fsid_t>& fsids);
+
+  //----------------------------------------------------------------------------
+  //! Drop all the pools
+  //----------------------------------------------------------------------------
+  void Clear();
+
+private:
+  static const size_t sClasses = 5; ///< <1M, <16M, <256M, <4G, >=4G
+  static const size_t sPoolSize = 1024; ///< Files sampled per filesystem
+  static const time_t sMaxAge = 600; ///< Seconds before a pool is resampled
+  static const time_t sEmptyRetry = 60; ///< Seconds before resampling an
+  ///< empty filesystem
+
+  typedef std::vector<std::pair<eos::common::FileId::fileid_t, uint64_t> >
+  Candidates;
+
+  //! Sampled files of a filesystem
+  struct Pool {
+    Candidates mClass[sClasses]; ///< Files by size class
+    time_t mSampled; ///< When the pool was sampled
+
+    Pool(): mSampled(0) {}
+  };
+
+  //! Sample the file list of a filesystem into its pool
+  void Sample(eos::common::FileSystem::fsid_t fsid, Pool& pool);
+
+  //! Size class of a file size
+  static size_t SizeClass(uint64_t size);
+
+  //! Smallest file size of a class
+  static uint64_t ClassMin(size_t sclass);
+
+  std::map<eos::common::FileSystem::fsid_t, Pool> mPools;
+  std::mt19937_64 mRandom;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -24,29 +24,43 @@
 #include "mgm/Converter.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mgm/FsView.hh"
-#include "mgm/XrdMgmOfsDirectory.hh"
+#include "mgm/Policy.hh"
+#include "mgm/Quota.hh"
 #include "common/StringConversion.hh"
 #include "common/FileId.hh"
 #include "common/LayoutId.hh"
+#include "common/Path.hh"
 #include "XrdSys/XrdSysTimer.hh"
-#include "XrdSys/XrdSysError.hh"
-#include "XrdOuc/XrdOucTrace.hh"
-#include "Xrd/XrdScheduler.hh"
-
-extern XrdSysError gMgmOfsEroute;
-extern XrdOucTrace gMgmOfsTrace;
+#include "namespace/interface/IView.hh"
+#include "namespace/interface/IFileMDSvc.hh"
+#include <set>
+#include <ctype.h>
+#include <errno.h>
 
 #define _STR(x) #x
 #define STR(x) _STR(x)
 #define SDUID STR(DAEMONUID)
 #define SDGID STR(DAEMONGID)
 
+
 EOSMGMNAMESPACE_BEGIN
 
-XrdSysMutex eos::mgm::Converter::gSchedulerMutex;
-XrdScheduler* eos::mgm::Converter::gScheduler;
-XrdSysMutex eos::mgm::Converter::gConverterMapMutex;
-std::map<std::string, Converter*> eos::mgm::Converter::gConverterMap;
+//------------------------------------------------------------------------------
+//! Copy progress handler aborting the copy when the converter stops
+//------------------------------------------------------------------------------
+class ConverterProgress : public XrdCl::CopyProgressHandler
+{
+public:
+  ConverterProgress(Converter& converter): mConverter(converter) {}
+
+  virtual bool ShouldCancel(uint16_t jobNum)
+  {
+    return mConverter.IsStopping();
+  }
+
+private:
+  Converter& mConverter;
+};
 
 //------------------------------------------------------------------------------
 // Constructor
@@ -56,7 +70,10 @@ ConverterJob::ConverterJob(eos::common::FileId::fileid_t fid,
                            std::string& convertername):
   mFid(fid),
   mConversionLayout(conversionlayout),
-  mConverterName(convertername)
+  mConverterName(convertername),
+  mSize(0),
+  mOwnerUid(0),
+  mOwnerGid(0)
 {
   mProcPath = gOFS->MgmProcConversionPath.c_str();
   mProcPath += "/";
@@ -68,87 +85,94 @@ ConverterJob::ConverterJob(eos::common::FileId::fileid_t fid,
 }
 
 //------------------------------------------------------------------------------
-// Run a third-party conversion transfer
+// Look up the source file and the target layout
 //------------------------------------------------------------------------------
-void
-ConverterJob::DoIt()
-
+bool
+ConverterJob::Prepare(std::map<std::string, eos::IContainerMD::XAttrMap>&
+                      attrcache)
 {
   eos::common::Mapping::VirtualIdentity rootvid;
   eos::common::Mapping::Root(rootvid);
-  XrdOucErrInfo error;
-  eos_static_info("msg=\"start tpc job\" fxid=%016x layout=%s proc_path=%s",
-                  mFid, mConversionLayout.c_str(), mProcPath.c_str());
-  XrdSysTimer sleeper;
-  std::shared_ptr<eos::IFileMD> fmd;
-  std::shared_ptr<eos::IContainerMD> cmd;
-  uid_t owner_uid = 0;
-  gid_t owner_gid = 0;
-  unsigned long long size = 0;
-  eos::IContainerMD::XAttrMap attrmap;
-  XrdOucString sourceChecksum;
-  XrdOucString sourceAfterChecksum;
-  XrdOucString sourceSize;
-  Converter* startConverter = 0;
-  Converter* stopConverter = 0;
-  {
-    XrdSysMutexHelper cLock(Converter::gConverterMapMutex);
-    startConverter = Converter::gConverterMap[mConverterName];
+
+  try {
+    gOFS->eosView->getFile(mProcPath);
+  } catch (eos::MDException& e) {
+    eos_static_info("msg=\"conversion entry is gone\" fxid=%016llx layout=%s",
+                    (unsigned long long) mFid, mConversionLayout.c_str());
+    return false;
   }
-  {
-    eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
 
-    try {
-      fmd = gOFS->eosFileService->getFileMD(mFid);
-      owner_uid = fmd->getCUid();
-      owner_gid = fmd->getCGid();
-      size = fmd->getSize();
-      mSourcePath = gOFS->eosView->getUri(fmd.get());
-      eos::common::Path cPath(mSourcePath.c_str());
-      cmd = gOFS->eosView->getContainer(cPath.GetParentPath());
-      cmd = gOFS->eosView->getContainer(gOFS->eosView->getUri(cmd.get()));
+  try {
+    std::shared_ptr<eos::IFileMD> fmd = gOFS->eosFileService->getFileMD(mFid);
+    mOwnerUid = fmd->getCUid();
+    mOwnerGid = fmd->getCGid();
+    mSize = fmd->getSize();
+    mSourcePath = gOFS->eosView->getUri(fmd.get());
+    eos::common::Path cPath(mSourcePath.c_str());
+    std::string parent = cPath.GetParentPath();
+    auto ait = attrcache.find(parent);
+
+    if (ait == attrcache.end()) {
+      // load the attributes once for all the files of the batch in the
+      // same directory
       XrdOucErrInfo error;
-      // load the attributes
-      gOFS->_attr_ls(gOFS->eosView->getUri(cmd.get()).c_str(), error, rootvid, 0,
-                     attrmap, false, true);
+      eos::IContainerMD::XAttrMap attrmap;
+      gOFS->_attr_ls(parent.c_str(), error, rootvid, 0, attrmap, false, true);
+      ait = attrcache.insert(std::make_pair(parent, attrmap)).first;
+    }
 
-      // get the checksum string if defined
-      for (unsigned int i = 0;
-           i < eos::common::LayoutId::GetChecksumLen(fmd->getLayoutId()); i++) {
-        char hb[3];
-        sprintf(hb, "%02x", (unsigned char)(fmd->getChecksum().getDataPadded(i)));
-        sourceChecksum += hb;
-      }
+    eos::IContainerMD::XAttrMap& attrmap = ait->second;
 
-      // get the size string
-      eos::common::StringConversion::GetSizeString(sourceSize,
-          (unsigned long long) fmd->getSize());
-      std::string conversionattribute = "sys.conversion.";
-      conversionattribute += mConversionLayout.c_str();
-      XrdOucString lEnv;
-      const char* val = 0;
-
-      if (attrmap.count(mConversionLayout.c_str())) {
-        // Conversion layout can either point to a conversion attribute
-        // definition in the parent directory.
-        val = eos::common::LayoutId::GetEnvFromConversionIdString(
-                lEnv, attrmap[mConversionLayout.c_str()].c_str());
-      } else {
-        // or can be directly a hexadecimal layout representation or env representation
-        val =
-          eos::common::LayoutId::GetEnvFromConversionIdString(lEnv,
-              mConversionLayout.c_str());
-      }
+    // get the checksum string if defined
+    for (unsigned int i = 0;
+         i < eos::common::LayoutId::GetChecksumLen(fmd->getLayoutId()); i++) {
+      char hb[3];
+      sprintf(hb, "%02x", (unsigned char)(fmd->getChecksum().getDataPadded(i)));
+      mSourceChecksum += hb;
+    }
 
-      if (val) {
-        mTargetCGI = val;
-      }
-    } catch (eos::MDException& e) {
-      errno = e.getErrno();
-      eos_static_err("fid=%016x errno=%d msg=\"%s\"\n",
-                     mFid, e.getErrno(), e.getMessage().str().c_str());
+    // get the size string
+    eos::common::StringConversion::GetSizeString(mSourceSize,
+        (unsigned long long) fmd->getSize());
+    XrdOucString lEnv;
+    const char* val = 0;
+
+    if (attrmap.count(mConversionLayout.c_str())) {
+      // Conversion layout can either point to a conversion attribute
+      // definition in the parent directory.
+      val = eos::common::LayoutId::GetEnvFromConversionIdString(
+              lEnv, attrmap[mConversionLayout.c_str()].c_str());
+    } else {
+      // or can be directly a hexadecimal layout representation or env representation
+      val =
+        eos::common::LayoutId::GetEnvFromConversionIdString(lEnv,
+            mConversionLayout.c_str());
     }
+
+    if (val) {
+      mTargetCGI = val;
+    }
+  } catch (eos::MDException& e) {
+    errno = e.getErrno();
+    eos_static_err("fid=%016x errno=%d msg=\"%s\"\n",
+                   mFid, e.getErrno(), e.getMessage().str().c_str());
   }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Run a third-party conversion transfer
+//------------------------------------------------------------------------------
+int
+ConverterJob::Run(Converter& converter)
+{
+  eos::common::Mapping::VirtualIdentity rootvid;
+  eos::common::Mapping::Root(rootvid);
+  XrdOucErrInfo error;
+  eos_static_info("msg=\"start tpc job\" fxid=%016x layout=%s proc_path=%s",
+                  mFid, mConversionLayout.c_str(), mProcPath.c_str());
+  XrdOucString sourceAfterChecksum;
   bool success = false;
 
   if (mTargetCGI.length()) {
@@ -159,7 +183,7 @@ ConverterJob::DoIt()
     XrdCl::PropertyList properties;
     XrdCl::PropertyList result;
 
-    if (size) {
+    if (mSize) {
       // non-empty files run with TPC
       properties.Set("thirdParty", "only");
     }
@@ -173,11 +197,11 @@ ConverterJob::DoIt()
     cgi += mTargetCGI.c_str();
     cgi += "&eos.app=converter";
     cgi += "&eos.targetsize=";
-    cgi += sourceSize.c_str();
+    cgi += mSourceSize.c_str();
 
-    if (sourceChecksum.length()) {
+    if (mSourceChecksum.length()) {
       cgi += "&eos.checksum=";
-      cgi += sourceChecksum.c_str();
+      cgi += mSourceChecksum.c_str();
     }
 
     XrdCl::URL url_src;
@@ -207,12 +231,19 @@ ConverterJob::DoIt()
                     lTpcPrepareStatus.ToStr().c_str());
 
     if (lTpcPrepareStatus.IsOK()) {
-      XrdCl::XRootDStatus lTpcStatus = lCopyProcess.Run(0);
+      ConverterProgress progress(converter);
+      XrdCl::XRootDStatus lTpcStatus = lCopyProcess.Run(&progress);
       eos_static_info("[tpc]: %s %d", lTpcStatus.ToStr().c_str(), lTpcStatus.IsOK());
       success = lTpcStatus.IsOK();
     } else {
       success = false;
     }
+
+    if (!success && converter.IsStopping()) {
+      eos_static_info("msg=\"aborted tpc job\" fxid=%016llx layout=%s",
+                      (unsigned long long) mFid, mConversionLayout.c_str());
+      return -1;
+    }
   } else {
     // -------------------------------------------------------------------------
     // this is a crappy defined job
@@ -229,7 +260,7 @@ ConverterJob::DoIt()
     eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
 
     try {
-      fmd = gOFS->eosFileService->getFileMD(mFid);
+      std::shared_ptr<eos::IFileMD> fmd = gOFS->eosFileService->getFileMD(mFid);
 
       // get the checksum string if defined
       for (unsigned int i = 0;
@@ -244,7 +275,7 @@ ConverterJob::DoIt()
                      mFid, e.getErrno(), e.getMessage().str().c_str());
     }
 
-    if (sourceChecksum != sourceAfterChecksum) {
+    if (mSourceChecksum != sourceAfterChecksum) {
       success = false;
       eos_static_err("fid=%016x conversion failed since file was modified",
                      mFid);
@@ -252,31 +283,21 @@ ConverterJob::DoIt()
   }
   eos_static_info("msg=\"stop tpc job\" fxid=%016x layout=%s",
                   mFid, mConversionLayout.c_str());
-  {
-    // We can only call-back to the Converter object if it wasn't destroyed/
-    // recreated in the mean-while.
-    XrdSysMutexHelper cLock(Converter::gConverterMapMutex);
-    stopConverter = Converter::gConverterMap[mConverterName];
-
-    if (startConverter && (startConverter == stopConverter)) {
-      stopConverter->GetSignal()->Signal();
-      stopConverter->DecActiveJobs();
-    }
-  }
 
   if (success) {
     // Merge the conversion entry
     if (!gOFS->merge(mProcPath.c_str(), mSourcePath.c_str(), error, rootvid)) {
       eos_static_info("msg=\"deleted processed conversion job entry\" name=\"%s\"",
                       mConversionLayout.c_str());
-      gOFS->MgmStats.Add("ConversionDone", owner_uid, owner_gid, 1);
+      gOFS->MgmStats.Add("ConversionDone", mOwnerUid, mOwnerGid, 1);
     } else {
       eos_static_err("msg=\"failed to remove failed conversion job entry\" name=\"%s\"",
                      mConversionLayout.c_str());
-      gOFS->MgmStats.Add("ConversionFailed", owner_uid, owner_gid, 1);
+      gOFS->MgmStats.Add("ConversionFailed", mOwnerUid, mOwnerGid, 1);
+      success = false;
     }
   } else {
-    // Set owner nobody to indicate that this is a failed/faulty entry
+    // Remove the failed/faulty entry
     if (!gOFS->_rem(mProcPath.c_str(), error, rootvid, (const char*) 0)) {
       eos_static_info("msg=\"removed failed conversion entry\" name=\"%s\"",
                       mConversionLayout.c_str());
@@ -285,32 +306,22 @@ ConverterJob::DoIt()
                      mConversionLayout.c_str());
     }
 
-    gOFS->MgmStats.Add("ConversionFailed", owner_uid, owner_gid, 1);
+    gOFS->MgmStats.Add("ConversionFailed", mOwnerUid, mOwnerGid, 1);
   }
 
-  delete this;
+  return success ? 1 : 0;
 }
 
 //------------------------------------------------------------------------------
 // Constructor by space name
 //------------------------------------------------------------------------------
-Converter::Converter(const char* spacename)
+Converter::Converter(const char* spacename):
+  mStop(false), mActiveJobs(0), mBusyWorkers(0), mMaxWorkers(0), mRate(0),
+  mDone(0), mFailed(0), mBytesDone(0), mJournal("converter"),
+  mLastScan(0), mLastPublish(0), mLastDone(0), mLastBytes(0),
+  mFileRate(0), mByteRate(0)
 {
   mSpaceName = spacename;
-  XrdSysMutexHelper sLock(gSchedulerMutex);
-
-  if (!gScheduler) {
-    gScheduler = new XrdScheduler(&gMgmOfsEroute, &gMgmOfsTrace, 2, 128, 64);
-    gScheduler->Start();
-  }
-
-  {
-    XrdSysMutexHelper cLock(Converter::gConverterMapMutex);
-    // store this object in the converter map for callbask
-    gConverterMap[spacename] = this;
-  }
-
-  mActiveJobs = 0;
   XrdSysThread::Run(&mThread, Converter::StaticConverter,
                     static_cast<void*>(this), XRDSYSTHREAD_HOLD,
                     "Converter Thread");
@@ -323,6 +334,12 @@ void
 Converter::Stop()
 {
   XrdSysThread::Cancel(mThread);
+  {
+    // running copies are aborted, their entries stay in the journal
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mCond.notify_all();
 }
 
 //------------------------------------------------------------------------------
@@ -332,8 +349,10 @@ Converter::~Converter()
 {
   Stop();
   XrdSysThread::Join(mThread, NULL);
-  XrdSysMutexHelper cLock(Converter::gConverterMapMutex);
-  gConverterMap[mSpaceName] = 0;
+
+  for (auto it = mWorkers.begin(); it != mWorkers.end(); ++it) {
+    it->join();
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -346,14 +365,11 @@ Converter::StaticConverter(void* arg)
 }
 
 //------------------------------------------------------------------------------
-// Eternal loop trying to run conversion jobs
+// Eternal loop queueing the conversion jobs
 //------------------------------------------------------------------------------
 void*
 Converter::Convert(void)
 {
-  eos::common::Mapping::VirtualIdentity rootvid;
-  eos::common::Mapping::Root(rootvid);
-  XrdOucErrInfo error;
   XrdSysThread::SetCancelOn();
   // Wait that the namespace is initialized
   bool go = false;
@@ -374,21 +390,15 @@ Converter::Convert(void)
 
   XrdSysTimer sleeper;
   sleeper.Snooze(10);
-
-  // Reset old jobs pending from service restart/crash
-  if (gOFS->MgmMaster.IsMaster()) {
-    ResetJobs();
-  }
+  bool journal_open = false;
 
   // loop forever until cancelled
-  // the conversion fid set points from file id to conversion attribute name in
-  // the parent container of the fid
-  std::map<eos::common::FileId::fileid_t, std::string> lConversionFidMap;
-
   while (1) {
     bool IsSpaceConverter = true;
     bool IsMaster = true;
     int lSpaceTransfers = 0;
+    unsigned long long lSpaceRate = 0;
+    time_t now = time(NULL);
     {
       // Extract the current settings if conversion enabled and how many
       // conversion jobs should run.
@@ -415,96 +425,58 @@ Converter::Convert(void)
 
       lSpaceTransfers = atoi(FsView::gFsView.mSpaceView[mSpaceName.c_str()]-> \
                              GetConfigMember("converter.ntx").c_str());
+      lSpaceRate = strtoull(FsView::gFsView.mSpaceView[mSpaceName.c_str()]-> \
+                            GetConfigMember("converter.rate").c_str(), 0, 10);
+      Publish(now);
       FsView::gFsView.ViewMutex.UnLockRead();
     }
     IsMaster = gOFS->MgmMaster.IsMaster();
 
+    if (lSpaceTransfers < 0) {
+      lSpaceTransfers = 0;
+    }
+
+    if (lSpaceTransfers > (int) sMaxWorkers) {
+      lSpaceTransfers = sMaxWorkers;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mMaxWorkers = lSpaceTransfers;
+      mRate = lSpaceRate;
+    }
+    mCond.notify_all();
+
     if (IsMaster && IsSpaceConverter) {
-      if (!lConversionFidMap.size()) {
-        XrdMgmOfsDirectory dir;
-        int listrc = 0;
-        // fill the conversion queue with the existing entries
-        listrc = dir.open(gOFS->MgmProcConversionPath.c_str(), rootvid,
-                          (const char*) 0);
-
-        if (listrc == SFS_OK) {
-          const char* val;
-
-          while ((val = dir.nextEntry())) {
-            XrdOucString sfxid = val;
-
-            if ((sfxid == ".") || (sfxid == "..")) {
-              continue;
-            }
-
-            XrdOucString fxid;
-            XrdOucString conversionattribute;
-            eos_static_info("name=\"%s\"", sfxid.c_str());
-            std::string lFullConversionFilePath =
-              gOFS->MgmProcConversionPath.c_str();
-            lFullConversionFilePath += "/";
-            lFullConversionFilePath += val;
-            struct stat buf;
-
-            if (gOFS->_stat(lFullConversionFilePath.c_str(), &buf, error, rootvid, "")) {
-              continue;
-            }
-
-            if ((buf.st_uid != 0) /* this is a failed or scheduled entry */) {
-              continue;
-            }
-
-            if (eos::common::StringConversion::SplitKeyValue(sfxid, fxid,
-                conversionattribute) &&
-                (eos::common::FileId::Hex2Fid(fxid.c_str())) &&
-                (fxid.length() == 16)) {
-              if (conversionattribute.beginswith(mSpaceName.c_str())) {
-                // This is a valid entry like <fxid>:<attribute> and we add it
-                // to the set if <attribute> starts with our space name!
-                lConversionFidMap[eos::common::FileId::Hex2Fid(fxid.c_str())] =
-                  conversionattribute.c_str();
-
-                // We set owner admin to indicate that this is a scheduled entry
-                if (!gOFS->_chown(lFullConversionFilePath.c_str(), 3, 4, error,
-                                  rootvid, (const char*) 0)) {
-                  eos_static_info("msg=\"tagged scheduled conversion entry with"
-                                  " owner admin\" name=\"%s\"",
-                                  conversionattribute.c_str());
-                } else {
-                  eos_static_err("msg=\"failed to tag with owner admin scheduled"
-                                 " conversion job entry\" name=\"%s\"",
-                                 conversionattribute.c_str());
-                }
-              }
-            } else {
-              eos_static_warning("split=%d fxid=%llu fxid=|%s|length=%u",
-                                 eos::common::StringConversion::SplitKeyValue(sfxid, fxid,
-                                     conversionattribute),
-                                 eos::common::FileId::Hex2Fid(fxid.c_str()),
-                                 fxid.c_str(), fxid.length());
-
-              // This is an invalid entry not following the <key(016x)>:<value>
-              // syntax - just remove it
-              if (!gOFS->_rem(lFullConversionFilePath.c_str(), error, rootvid,
-                              (const char*) 0)) {
-                eos_static_warning("msg=\"deleted invalid conversion entry\" "
-                                   "name=\"%s\"", val);
-              }
-            }
-          }
-
-          dir.close();
-        } else {
-          eos_static_err("msg=\"failed to list conversion directory\" path=\"%s\"",
-                         gOFS->MgmProcConversionPath.c_str());
-        }
+      if (!journal_open) {
+        // recover the jobs queued before a restart
+        OpenJournal();
+        journal_open = true;
       }
 
-      eos_static_info("converter is enabled ntx=%d nqueued=%d",
-                      lSpaceTransfers,
-                      lConversionFidMap.size());
+      while (mWorkers.size() < (size_t) lSpaceTransfers) {
+        mWorkers.push_back(std::thread(&Converter::Worker, this));
+      }
+
+      size_t nqueued = 0;
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        nqueued = mQueue.size();
+      }
+
+      // list the conversion directory again when the queue runs low, soon
+      // if it is empty
+      if ((nqueued < (size_t)(4 * sBatch * lSpaceTransfers)) &&
+          ((now - mLastScan) >= (nqueued ? 60 : 10))) {
+        Scan();
+        mLastScan = now;
+      }
+
+      eos_static_debug("converter is enabled ntx=%d nqueued=%lu",
+                       lSpaceTransfers, (unsigned long) nqueued);
+      SyncJournal();
     } else {
-      lConversionFidMap.clear();
+      Clear();
 
       if (IsMaster) {
         eos_static_debug("converter is disabled");
@@ -513,92 +485,510 @@ Converter::Convert(void)
       }
     }
 
-    // Schedule some conversion jobs if any
-    int nschedule = lSpaceTransfers - mActiveJobs;
-
-    for (int i = 0; i < nschedule; i++) {
-      if (lConversionFidMap.size()) {
-        auto it = lConversionFidMap.begin();
-        ConverterJob* job = new ConverterJob(it->first,
-                                             it->second.c_str(),
-                                             mSpaceName);
-        // use the global shared scheduler
-        XrdSysMutexHelper sLock(gSchedulerMutex);
-        gScheduler->Schedule((XrdJob*) job);
-        IncActiveJobs();
-        // Remove the entry from the conversion map
-        lConversionFidMap.erase(lConversionFidMap.begin());
-      } else {
+    XrdSysThread::SetCancelOn();
+    // Let some time pass
+    sleeper.Wait(1000);
+    XrdSysThread::CancelPoint();
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Worker thread running batches of jobs
+//------------------------------------------------------------------------------
+void
+Converter::Worker()
+{
+  while (true) {
+    std::vector<std::unique_ptr<ConverterJob> > jobs;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait(lock, [this] {
+        return mStop || (!mQueue.empty() && (mBusyWorkers < mMaxWorkers));
+      });
+
+      if (mStop) {
         break;
       }
+
+      mBusyWorkers++;
+
+      while (!mQueue.empty() && (jobs.size() < sBatch)) {
+        eos::common::FileId::fileid_t fid = mQueue.front();
+        mQueue.pop_front();
+        auto it = mJobs.find(fid);
+
+        if (it != mJobs.end()) {
+          jobs.emplace_back(new ConverterJob(fid, it->second.c_str(), mSpaceName));
+          mActiveJobs++;
+        }
+      }
     }
+    std::vector<bool> valid(jobs.size(), true);
+    {
+      // look up all the files of the batch in one go
+      std::map<std::string, eos::IContainerMD::XAttrMap> attrcache;
+      eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
 
-    XrdSysThread::SetCancelOn();
-    // Let some time pass or wait for a notification
-    mDoneSignal.Wait(10);
-    XrdSysThread::CancelPoint();
+      for (size_t i = 0; i < jobs.size(); ++i) {
+        valid[i] = jobs[i]->Prepare(attrcache);
+      }
+    }
+    PlaceBatch(jobs, valid);
+    size_t i = 0;
+
+    for (auto it = jobs.begin(); it != jobs.end(); ++it, ++i) {
+      int result = -1;
+
+      if (!valid[i]) {
+        // the conversion entry was removed meanwhile
+        result = 2;
+      } else if (!mStop) {
+        Throttle((*it)->GetSize());
+
+        if (!mStop) {
+          result = (*it)->Run(*this);
+        }
+      }
+
+      Finish((*it)->GetFid(), result, (*it)->GetSize());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBusyWorkers--;
+    }
+    mCond.notify_all();
   }
+}
 
-  return 0;
+//------------------------------------------------------------------------------
+// Choose the scheduling groups of the converted files of a batch
+//------------------------------------------------------------------------------
+void
+Converter::PlaceBatch(std::vector<std::unique_ptr<ConverterJob> >& jobs,
+                      const std::vector<bool>& valid)
+{
+  // jobs converting to the same layout are placed together
+  std::map<std::string, std::vector<size_t> > layouts;
+
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (valid[i] && jobs[i]->GetTargetCGI().length()) {
+      layouts[jobs[i]->GetTargetCGI()].push_back(i);
+    }
+  }
+
+  // the targets are created by the daemon account
+  eos::common::Mapping::VirtualIdentity vid;
+  eos::common::Mapping::Nobody(vid);
+  vid.uid = DAEMONUID;
+  vid.gid = DAEMONGID;
+
+  for (auto it = layouts.begin(); it != layouts.end(); ++it) {
+    const std::vector<size_t>& indices = it->second;
+    std::string procpath = jobs[indices[0]]->GetProcPath();
+    XrdOucEnv env(it->first.c_str());
+    eos::IContainerMD::XAttrMap attrmap;
+    unsigned long layoutid = 0;
+    unsigned long forcedfsid = 0;
+    long forcedgroup = -1;
+    XrdOucString space;
+    Policy::GetLayoutAndSpace(procpath.c_str(), attrmap, vid, layoutid, space,
+                              env, forcedfsid, forcedgroup);
+
+    if (forcedgroup >= 0) {
+      // the conversion layout already names the group
+      continue;
+    }
+
+    std::string spacename = space.c_str();
+    std::string targetgeotag;
+    std::vector<ino64_t> inodes;
+    std::vector<unsigned int> avoidfs;
+    std::vector<unsigned int> selectedfs;
+    std::vector<std::vector<unsigned int> > placements;
+    unsigned long long bookingsize = 0;
+    Scheduler::PlacementArguments plctargs;
+    Policy::GetPlctPolicy(procpath.c_str(), attrmap, vid, env,
+                          plctargs.plctpolicy, targetgeotag);
+
+    for (auto idx = indices.begin(); idx != indices.end(); ++idx) {
+      inodes.push_back(jobs[*idx]->GetFid());
+
+      if (jobs[*idx]->GetSize() > bookingsize) {
+        bookingsize = jobs[*idx]->GetSize();
+      }
+    }
+
+    plctargs.alreadyused_filesystems = &avoidfs;
+    plctargs.bookingsize = bookingsize;
+    plctargs.lid = layoutid;
+    plctargs.path = procpath.c_str();
+    plctargs.plctTrgGeotag = &targetgeotag;
+    plctargs.selected_filesystems = &selectedfs;
+    plctargs.spacename = &spacename;
+    plctargs.vid = &vid;
+
+    if (!plctargs.isValid()) {
+      continue;
+    }
+
+    eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
+    int retc = Quota::FilePlacementBatch(&plctargs, inodes, placements);
+
+    if (retc) {
+      eos_static_info("msg=\"batch placement incomplete\" space=%s files=%lu "
+                      "retc=%d", spacename.c_str(), inodes.size(), retc);
+    }
+
+    for (size_t i = 0; i < placements.size(); ++i) {
+      if (placements[i].empty() ||
+          !FsView::gFsView.mIdView.count(placements[i][0])) {
+        continue;
+      }
+
+      eos::common::FileSystem::fs_snapshot_t snapshot;
+      FsView::gFsView.mIdView[placements[i][0]]->SnapShotFileSystem(snapshot);
+      jobs[indices[i]]->SetTargetGroup(snapshot.mGroupIndex);
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
-// Publish the active job number in the space view
+// Record the end of a job
 //------------------------------------------------------------------------------
 void
-Converter::PublishActiveJobs()
+Converter::Finish(eos::common::FileId::fileid_t fid, int result,
+                  unsigned long long bytes)
 {
-  eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
-  char sactive[256];
-  snprintf(sactive, sizeof(sactive) - 1, "%lu", mActiveJobs);
-  FsView::gFsView.mSpaceView[mSpaceName.c_str()]->SetConfigMember
-  ("stat.converter.active",
-   sactive,
-   true,
-   "/eos/*/mgm",
-   true);
+  std::lock_guard<std::mutex> lock(mMutex);
+  mActiveJobs--;
+
+  if (result < 0) {
+    // aborted, recovered from the journal at the next start
+    return;
+  }
+
+  if (result == 1) {
+    mDone++;
+    mBytesDone += bytes;
+  } else if (result == 0) {
+    mFailed++;
+  }
+
+  mJobs.erase(fid);
+  char line[64];
+  snprintf(line, sizeof(line), "- %016llx", (unsigned long long) fid);
+  mJournal.Append(line);
 }
 
 //------------------------------------------------------------------------------
-// Reset pending conversion entries
+// Pace the start of the copies to the throughput limit of the space
 //------------------------------------------------------------------------------
 void
-Converter::ResetJobs()
+Converter::Throttle(unsigned long long bytes)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  if (!mRate || !bytes) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+
+  if (mNextStart < now) {
+    // no credit is accumulated while idle
+    mNextStart = now;
+  }
+
+  auto start = mNextStart;
+  mNextStart += std::chrono::microseconds(bytes / mRate);
+  mCond.wait_until(lock, start, [this] { return mStop.load(); });
+}
+
+//------------------------------------------------------------------------------
+// Parse a file id written with exactly 16 hex digits
+//------------------------------------------------------------------------------
+bool
+Converter::ParseFxid(const std::string& fxid,
+                     eos::common::FileId::fileid_t& fid)
+{
+  if (fxid.length() != 16) {
+    return false;
+  }
+
+  for (size_t i = 0; i < fxid.length(); ++i) {
+    if (!isxdigit((unsigned char) fxid[i])) {
+      return false;
+    }
+  }
+
+  fid = eos::common::FileId::Hex2Fid(fxid.c_str());
+  return (fid != 0);
+}
+
+//------------------------------------------------------------------------------
+// Parse a conversion entry name
+//------------------------------------------------------------------------------
+bool
+Converter::ParseEntry(const std::string& name,
+                      eos::common::FileId::fileid_t& fid, std::string& layout)
+{
+  std::string fxid;
+
+  if (!eos::common::StringConversion::SplitKeyValue(name, fxid, layout)) {
+    return false;
+  }
+
+  return ParseFxid(fxid, fid);
+}
+
+//------------------------------------------------------------------------------
+// Queue the new entries of the conversion directory
+//------------------------------------------------------------------------------
+void
+Converter::Scan()
 {
   eos::common::Mapping::VirtualIdentity rootvid;
   eos::common::Mapping::Root(rootvid);
   XrdOucErrInfo error;
-  XrdMgmOfsDirectory dir;
-  int listrc = dir.open(gOFS->MgmProcConversionPath.c_str(), rootvid,
-                        (const char*) 0);
+  std::set<std::string> names;
+  {
+    // take all the entries under one lock instead of a stat per entry
+    eos::common::RWMutexReadLock nsLock(gOFS->eosViewRWMutex);
 
-  if (listrc == SFS_OK) {
-    const char* val;
+    try {
+      std::shared_ptr<eos::IContainerMD> cmd =
+        gOFS->eosView->getContainer(gOFS->MgmProcConversionPath.c_str());
+      names = cmd->getNameFiles();
+    } catch (eos::MDException& e) {
+      eos_static_err("msg=\"failed to list conversion directory\" path=\"%s\" "
+                     "errno=%d", gOFS->MgmProcConversionPath.c_str(),
+                     e.getErrno());
+      return;
+    }
+  }
+  std::vector<std::string> invalid;
+  size_t nadded = 0;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
 
-    while ((val = dir.nextEntry())) {
-      XrdOucString sfxid = val;
+    for (auto it = names.begin(); it != names.end(); ++it) {
+      eos::common::FileId::fileid_t fid = 0;
+      std::string layout;
 
-      if ((sfxid == ".") || (sfxid == "..")) {
+      if (!ParseEntry(*it, fid, layout)) {
+        eos_static_warning("msg=\"invalid conversion entry\" name=\"%s\"",
+                           it->c_str());
+        invalid.push_back(*it);
         continue;
       }
 
-      std::string lFullConversionFilePath =
-        gOFS->MgmProcConversionPath.c_str();
-      lFullConversionFilePath += "/";
-      lFullConversionFilePath += val;
+      // only the entries with <attribute> starting with our space name
+      if (layout.compare(0, mSpaceName.length(), mSpaceName) ||
+          mJobs.count(fid)) {
+        continue;
+      }
 
-      if (!gOFS->_chown(lFullConversionFilePath.c_str(), 0, 0, error,
-                        rootvid, (const char*) 0)) {
-        eos_static_info("msg=\"reset scheduled conversion entry with owner "
-                        "root\" name=\"%s\"", lFullConversionFilePath.c_str());
-      } else {
-        eos_static_err("msg=\"failed to reset with owner root scheduled old "
-                       "job entry\" name=\"%s\"", lFullConversionFilePath.c_str());
+      if (mJobs.size() >= sMaxQueued) {
+        // picked up by a later listing
+        break;
       }
+
+      mJobs[fid] = layout;
+      mQueue.push_back(fid);
+      mJournal.Append("+ " + *it);
+      nadded++;
     }
   }
 
-  dir.close();
+  if (nadded) {
+    eos_static_info("msg=\"queued conversion entries\" space=%s n=%lu",
+                    mSpaceName.c_str(), (unsigned long) nadded);
+    mCond.notify_all();
+  }
+
+  // This is an invalid entry not following the <key(016x)>:<value> syntax -
+  // just remove it
+  for (auto it = invalid.begin(); it != invalid.end(); ++it) {
+    std::string path = gOFS->MgmProcConversionPath.c_str();
+    path += "/";
+    path += *it;
+
+    if (!gOFS->_rem(path.c_str(), error, rootvid, (const char*) 0)) {
+      eos_static_warning("msg=\"deleted invalid conversion entry\" "
+                         "name=\"%s\"", it->c_str());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Drop the queued jobs which did not start yet
+//------------------------------------------------------------------------------
+void
+Converter::Clear()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for (auto it = mQueue.begin(); it != mQueue.end(); ++it) {
+    mJobs.erase(*it);
+  }
+
+  mQueue.clear();
+  mLastScan = 0;
+}
+
+//------------------------------------------------------------------------------
+// Publish the progress in the space view
+//------------------------------------------------------------------------------
+void
+Converter::Publish(time_t now)
+{
+  unsigned long long active, queued, done, failed, bytes;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    active = mActiveJobs;
+    queued = mQueue.size();
+    done = mDone;
+    failed = mFailed;
+    bytes = mBytesDone;
+  }
+
+  if (mLastPublish && (now > mLastPublish)) {
+    double elapsed = now - mLastPublish;
+    double filerate = (done + failed - mLastDone) / elapsed;
+    double byterate = (bytes - mLastBytes) / 1000000.0 / elapsed;
+    // smoothed over about a minute
+    mFileRate = 0.95 * mFileRate + 0.05 * filerate;
+    mByteRate = 0.95 * mByteRate + 0.05 * byterate;
+  }
+
+  if (now > mLastPublish) {
+    mLastPublish = now;
+    mLastDone = done + failed;
+    mLastBytes = bytes;
+  }
+
+  time_t eta = 0;
+
+  if (mFileRate > 0.001) {
+    eta = (time_t)((queued + active) / mFileRate);
+  }
+
+  std::map<std::string, unsigned long long> values;
+  values["stat.converter.active"] = active;
+  values["stat.converter.queued"] = queued;
+  values["stat.converter.done"] = done;
+  values["stat.converter.failed"] = failed;
+  values["stat.converter.rate"] = (unsigned long long) mByteRate;
+  values["stat.converter.eta"] = eta;
+  FsSpace* space = FsView::gFsView.mSpaceView[mSpaceName.c_str()];
+
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    std::string value = std::to_string(it->second);
+
+    // only changes are broadcast
+    if (mPublished[it->first] != value) {
+      space->SetConfigMember(it->first, value, true, "/eos/*/mgm", true);
+      mPublished[it->first] = value;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Open the journal and recover the queued jobs from it
+//------------------------------------------------------------------------------
+void
+Converter::OpenJournal()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::string path = gOFS->MgmMetaLogDir.c_str();
+  path += "/converter.";
+  path += mSpaceName;
+  path += ".";
+  path += gOFS->HostName;
+  path += ".journal";
+  // keep the order in which the jobs were queued
+  std::vector<eos::common::FileId::fileid_t> order;
+  bool recovered = mJournal.Read(path, [this, &order](const std::string & line) {
+    eos::common::FileId::fileid_t fid = 0;
+    std::string layout;
+
+    if (line.length() < 3) {
+      return;
+    }
+
+    if (line[0] == '+') {
+      if (ParseEntry(line.substr(2), fid, layout) && !mJobs.count(fid)) {
+        mJobs[fid] = layout;
+        order.push_back(fid);
+      }
+    } else if (line[0] == '-') {
+      if (ParseFxid(line.substr(2), fid)) {
+        mJobs.erase(fid);
+      }
+    }
+  });
+
+  if (recovered) {
+    eos_static_notice("msg=\"recovered converter journal\" path=\"%s\" "
+                      "lines=%llu jobs=%lu", path.c_str(), mJournal.GetLines(),
+                      (unsigned long) mJobs.size());
+  }
+
+  for (auto it = order.begin(); it != order.end(); ++it) {
+    if (mJobs.count(*it)) {
+      mQueue.push_back(*it);
+    }
+  }
+
+  // start with a journal holding only the pending jobs
+  CompactJournal();
+}
+
+//------------------------------------------------------------------------------
+// Flush the journal to disk and compact it if needed
+//------------------------------------------------------------------------------
+void
+Converter::SyncJournal()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mJournal.Sync();
+
+  if (mJournal.NeedsRewrite(mJobs.size())) {
+    CompactJournal();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Rewrite the journal with only the pending jobs
+//------------------------------------------------------------------------------
+void
+Converter::CompactJournal()
+{
+  // queued jobs first to keep their order at the next recovery, then the
+  // running ones
+  std::vector<eos::common::FileId::fileid_t> fids(mQueue.begin(), mQueue.end());
+  std::set<eos::common::FileId::fileid_t> queued(mQueue.begin(), mQueue.end());
+  std::vector<std::string> lines;
+
+  for (auto it = mJobs.begin(); it != mJobs.end(); ++it) {
+    if (!queued.count(it->first)) {
+      fids.push_back(it->first);
+    }
+  }
+
+  lines.reserve(fids.size());
+
+  for (size_t i = 0; i < fids.size(); ++i) {
+    char fxid[20];
+    snprintf(fxid, sizeof(fxid), "%016llx", (unsigned long long) fids[i]);
+    lines.push_back(std::string("+ ") + fxid + ":" + mJobs[fids[i]]);
+  }
+
+  mJournal.Rewrite(lines);
 }
 
 EOSMGMNAMESPACE_END
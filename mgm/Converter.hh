@@ -25,12 +25,20 @@
 #define __EOSMGM_CONVERTER__
 
 #include "mgm/Namespace.hh"
+#include "mgm/JobJournal.hh"
 #include "common/Logging.hh"
 #include "common/FileSystem.hh"
 #include "common/FileId.hh"
+#include "namespace/interface/IContainerMD.hh"
 #include "XrdSys/XrdSysPthread.hh"
-#include "Xrd/XrdScheduler.hh"
 #include "XrdCl/XrdClCopyProcess.hh"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 #include <deque>
@@ -38,10 +46,12 @@
 
 EOSMGMNAMESPACE_BEGIN
 
+class Converter;
+
 //----------------------------------------------------------------------------
 //! @brief Class executing a third-party conversion job
 //----------------------------------------------------------------------------
-class ConverterJob : XrdJob
+class ConverterJob
 {
 public:
   //----------------------------------------------------------------------------
@@ -61,9 +71,67 @@ public:
   ~ConverterJob() {}
 
   //----------------------------------------------------------------------------
-  // Job execution function
+  //! Look up the source file and the target layout, must hold the namespace
+  //! read lock
+  //!
+  //! @param attrcache attributes of the parent directories already looked up
+  //!        by the jobs of the same batch
+  //!
+  //! @return false if the conversion entry does not exist anymore
+  //----------------------------------------------------------------------------
+  bool Prepare(std::map<std::string, eos::IContainerMD::XAttrMap>& attrcache);
+
+  //----------------------------------------------------------------------------
+  //! Run the third-party copy and merge the converted file
+  //!
+  //! @param converter converter running the job, the copy is aborted when it
+  //!        stops
+  //!
+  //! @return 1 if converted, 0 if failed, -1 if aborted, the conversion entry
+  //!         is then left for the next start of the converter
+  //----------------------------------------------------------------------------
+  int Run(Converter& converter);
+
+  //----------------------------------------------------------------------------
+  //! Get the file id of the file to convert
+  //----------------------------------------------------------------------------
+  eos::common::FileId::fileid_t GetFid() const
+  {
+    return mFid;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the size of the file to convert, known after Prepare
+  //----------------------------------------------------------------------------
+  unsigned long long GetSize() const
+  {
+    return mSize;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the proc path of the conversion job
+  //----------------------------------------------------------------------------
+  const std::string& GetProcPath() const
+  {
+    return mProcPath;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the CGI describing the target layout, known after Prepare
+  //----------------------------------------------------------------------------
+  const std::string& GetTargetCGI() const
+  {
+    return mTargetCGI;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Place the converted file in the given scheduling group
   //----------------------------------------------------------------------------
-  void DoIt();
+  void SetTargetGroup(unsigned int group)
+  {
+    mTargetCGI += "&eos.group=";
+    mTargetCGI += std::to_string(group);
+  }
 
 private:
   eos::common::FileId::fileid_t mFid; ///< file id of the conversion job
@@ -73,6 +141,11 @@ private:
   std::string mTargetCGI; ///< target CGI of the conversion job
   XrdOucString mConversionLayout; ///< layout name of the target file
   std::string mConverterName; ///< target space name of the conversion
+  XrdOucString mSourceChecksum; ///< checksum of the file when prepared
+  XrdOucString mSourceSize; ///< size of the file when prepared
+  unsigned long long mSize; ///< size of the file when prepared
+  uid_t mOwnerUid; ///< owner of the file
+  gid_t mOwnerGid; ///< group of the file
 };
 
 //------------------------------------------------------------------------------
@@ -81,12 +154,20 @@ private:
 //! This class run's an eternal thread per configured space which is responsible
 //! to pick-up conversion
 //! jobs from the directory /eos/../proc/conversion/\n\n
-//! It uses the XrdScheduler class to run third party clients copying files
-//! into the conversion definition files named !<fid(016x)!>:!<conversionlayout!>
+//! It runs third party clients copying files into the conversion definition
+//! files named !<fid(016x)!>:!<conversionlayout!>
 //! If a third party conversion finished successfully the layout & replica of the
 //! converted temporary file will be merged into the existing file and the
 //! previous layout will be dropped.
 //! !<conversionlayout!> is formed like !<space[.group]~>=!<layoutid(08x)!>
+//!
+//! The conversion entries are listed in one go under the namespace lock and
+//! queued in memory. Every queued and finished job is appended to a local
+//! journal, so after a restart the queue is recovered without listing the
+//! conversion directory. The jobs are run by a pool of worker threads of the
+//! space, as many as converter.ntx, which take the jobs in batches and look
+//! up all the files of a batch under one namespace lock. The start of the
+//! copies is paced to stay below converter.rate MB/s if configured.
 //------------------------------------------------------------------------------
 class Converter
 {
@@ -114,66 +195,116 @@ public:
   static void* StaticConverter(void*);
 
   //----------------------------------------------------------------------------
-  //! Service implementation e.g. eternal conversion loop running third-party
-  //! conversion
+  //! Service implementation e.g. eternal loop queueing the conversion jobs
+  //! for the worker threads
   //----------------------------------------------------------------------------
   void* Convert(void);
 
   //----------------------------------------------------------------------------
-  //! Return the condition variable to signal when a job finishes
+  //! Check if the converter is stopping
   //----------------------------------------------------------------------------
-  XrdSysCondVar* GetSignal()
+  bool IsStopping() const
   {
-    return &mDoneSignal;
+    return mStop;
   }
 
   //----------------------------------------------------------------------------
-  //! Decrement the number of active jobs in this converter
-  //----------------------------------------------------------------------------
-  void DecActiveJobs()
-  {
-    mActiveJobs--;
-    PublishActiveJobs();
-  }
-
-  //----------------------------------------------------------------------------
-  //! Increment the number of active jobs in this converter
-  //----------------------------------------------------------------------------
-  void IncActiveJobs()
-  {
-    mActiveJobs++;
-    PublishActiveJobs();
-  }
-
-  //----------------------------------------------------------------------------
-  //! Publish the number of active jobs in this converter
+  //! Wait until a copy of the given size can start within the throughput
+  //! limit of the space
+  //!
+  //! @param bytes size of the copy
   //----------------------------------------------------------------------------
-  void PublishActiveJobs();
+  void Throttle(unsigned long long bytes);
 
   //----------------------------------------------------------------------------
   //! Return active jobs
   //----------------------------------------------------------------------------
-  size_t GetActiveJobs() const
+  size_t GetActiveJobs()
   {
+    std::lock_guard<std::mutex> lock(mMutex);
     return mActiveJobs;
   }
 
+private:
+  //! Worker thread running batches of jobs
+  void Worker();
+
   //----------------------------------------------------------------------------
-  //! Reset pending conversion entries
+  //! Choose the scheduling groups of the converted files of a batch with one
+  //! placement per target layout. Each target is then created in the group of
+  //! its placement, the files which could not be placed are left to the
+  //! placement done when the target is opened.
+  //!
+  //! @param jobs jobs of the batch
+  //! @param valid jobs which are still to run
   //----------------------------------------------------------------------------
-  void ResetJobs();
+  void PlaceBatch(std::vector<std::unique_ptr<ConverterJob> >& jobs,
+                  const std::vector<bool>& valid);
 
-  static XrdSysMutex gSchedulerMutex; ///< Used for scheduler singleton
-  static XrdScheduler* gScheduler; ///< Scheduler singleton
-  static XrdSysMutex gConverterMapMutex; ///< Mutex protecting converter map
-  //! Map containing the current allocated converter objects
-  static std::map<std::string, Converter*> gConverterMap;
+  //! Record the end of a job, result as returned by ConverterJob::Run or 2
+  //! if the conversion entry is gone
+  void Finish(eos::common::FileId::fileid_t fid, int result,
+              unsigned long long bytes);
+
+  //! Queue the new entries of the conversion directory
+  void Scan();
+
+  //! Drop the queued jobs which did not start yet
+  void Clear();
+
+  //! Publish the progress in the space view, must hold the view read lock
+  void Publish(time_t now);
+
+  //! Parse a file id written with exactly 16 hex digits
+  static bool ParseFxid(const std::string& fxid,
+                        eos::common::FileId::fileid_t& fid);
+
+  //! Parse a conversion entry name !<fid(016x)!>:!<conversionlayout!>
+  static bool ParseEntry(const std::string& name,
+                         eos::common::FileId::fileid_t& fid,
+                         std::string& layout);
+
+  //! Open the journal and recover the queued jobs from it
+  void OpenJournal();
+
+  //! Flush the journal to disk and compact it if needed
+  void SyncJournal();
+
+  //! Rewrite the journal with only the pending jobs, must hold mMutex
+  void CompactJournal();
 
-private:
   pthread_t mThread; ///< Thread id
   std::string mSpaceName; ///< name of the espace this converter serves
-  size_t mActiveJobs; ///< All the queued jobs that didn't run yet
-  XrdSysCondVar mDoneSignal; ///< Condition variable signalled when a job is done
+  std::atomic<bool> mStop; ///< Set when the workers have to stop
+  std::vector<std::thread> mWorkers; ///< Only changed by the converter thread
+
+  std::mutex mMutex; ///< Protecting all the members below
+  std::condition_variable mCond; ///< Signalled on new jobs and on stop
+  //! Pending jobs, queued or taken by a worker: fid => conversion layout
+  std::map<eos::common::FileId::fileid_t, std::string> mJobs;
+  std::deque<eos::common::FileId::fileid_t> mQueue; ///< Jobs not yet taken
+  size_t mActiveJobs; ///< Jobs taken by a worker and not finished
+  size_t mBusyWorkers; ///< Workers running a batch
+  size_t mMaxWorkers; ///< converter.ntx
+  unsigned long long mRate; ///< converter.rate in MB/s, 0 unlimited
+  std::chrono::steady_clock::time_point mNextStart; ///< Earliest next copy
+  unsigned long long mDone; ///< Jobs converted
+  unsigned long long mFailed; ///< Jobs failed
+  unsigned long long mBytesDone; ///< Bytes converted
+  JobJournal mJournal; ///< Queued and finished jobs
+
+  // only used by the converter thread
+  time_t mLastScan; ///< Time of the last listing of the conversion directory
+  time_t mLastPublish;
+  unsigned long long mLastDone; ///< mDone + mFailed at the last publish
+  unsigned long long mLastBytes; ///< mBytesDone at the last publish
+  double mFileRate; ///< Average jobs finished per second
+  double mByteRate; ///< Average MB converted per second
+  std::map<std::string, std::string> mPublished; ///< Values last published
+
+  static const size_t sBatch = 16; ///< Jobs taken by a worker at once
+  static const size_t sMaxWorkers = 64; ///< Upper bound of converter.ntx
+  static const size_t sMaxQueued = 100000; ///< Jobs kept in memory
 };
 
 EOSMGMNAMESPACE_END
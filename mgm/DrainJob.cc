@@ -72,6 +72,7 @@ void
 DrainJob::ResetCounter ()
 {
   FileSystem* fs = 0;
+  gOFS->DrainSched.Remove(mFsId);
   if (FsView::gFsView.mIdView.count(mFsId))
   {
     fs = FsView::gFsView.mIdView[mFsId];
@@ -83,6 +84,8 @@ DrainJob::ResetCounter ()
       fs->SetLongLong("stat.timeleft", 0);
       fs->SetLongLong("stat.drainprogress", 0);
       fs->SetLongLong("stat.drainretry", 0);
+      fs->SetLongLong("stat.drainrate", 0);
+      fs->SetLongLong("stat.draineta", 0);
       fs->SetDrainStatus(eos::common::FileSystem::kNoDrain);
       SetDrainer();
       fs->CloseTransaction();
@@ -250,6 +253,8 @@ DrainJob::Drain (void)
   int ntried = 0;
 
   long long filesleft = 0;
+  unsigned long long drainbytes = 0;
+  DrainScheduler::Progress scheduled;
 
 
 retry:
@@ -505,6 +510,7 @@ retry:
     }
 
     fs->SetDrainStatus(eos::common::FileSystem::kDraining);
+    drainbytes = fs->GetLongLong("stat.statfs.usedbytes");
 
     //--------------------------------------------------------------------------
     // this enables the pull functionality on FST
@@ -512,6 +518,15 @@ retry:
     SetDrainer();
   }
 
+  //----------------------------------------------------------------------------
+  // the transfers are pushed by the MGM if the space drains centrally, the
+  // FSTs then only get transfers of other filesystems by pulling
+  //----------------------------------------------------------------------------
+  if (DrainScheduler::IsEnabled(mSpace))
+  {
+    gOFS->DrainSched.Add(mFsId, mSpace, mGroup, drainbytes);
+  }
+
   time_t last_filesleft_change;
   last_filesleft_change = time(NULL);
   long long last_filesleft;
@@ -530,9 +545,26 @@ retry:
 
     SetSpaceNode();
 
+    last_filesleft = filesleft;
+
+    if (gOFS->DrainSched.GetProgress(mFsId, scheduled) &&
+        scheduled.mTotalFiles)
+    {
+      //------------------------------------------------------------------------
+      // the scheduler counts the files left, no need to copy the file list
+      //------------------------------------------------------------------------
+      filesleft = scheduled.mFilesLeft;
+      eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+      if (FsView::gFsView.mIdView.count(mFsId) && FsView::gFsView.mIdView[mFsId])
+      {
+        fs = FsView::gFsView.mIdView[mFsId];
+        fs->SetLongLong("stat.drainrate", (long long) scheduled.mRate, false);
+        fs->SetLongLong("stat.draineta", scheduled.mEta, false);
+      }
+    }
+    else
     {
       eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
-      last_filesleft = filesleft;
       try
       {
         eos::IFsView::FileList filelist =
@@ -584,8 +616,15 @@ retry:
                             "Filesystem fsid=%u has been removed during drain operation", mFsId);
           return 0;
         }
-        fs->SetLongLong("stat.drainbytesleft",
-                        fs->GetLongLong("stat.statfs.usedbytes"));
+        if (scheduled.mTotalFiles)
+        {
+          fs->SetLongLong("stat.drainbytesleft", scheduled.mBytesLeft);
+        }
+        else
+        {
+          fs->SetLongLong("stat.drainbytesleft",
+                          fs->GetLongLong("stat.statfs.usedbytes"));
+        }
         fs->SetLongLong("stat.drainfiles",
                         filesleft);
         if (stalled)
@@ -712,6 +751,8 @@ retry:
 
 nofilestodrain:
 
+  gOFS->DrainSched.Remove(mFsId);
+
   //----------------------------------------------------------------------------
   // set status to 'drained'
   //----------------------------------------------------------------------------
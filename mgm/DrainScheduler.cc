@@ -0,0 +1,994 @@
+//------------------------------------------------------------------------------
+// File: DrainScheduler.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/DrainScheduler.hh"
+#include "mgm/FsView.hh"
+#include "mgm/Quota.hh"
+#include "mgm/Scheduler.hh"
+#include "mgm/XrdMgmOfs.hh"
+#include "common/LayoutId.hh"
+#include "common/Logging.hh"
+#include "common/Path.hh"
+#include "common/SecEntity.hh"
+#include "common/StringConversion.hh"
+#include "common/SymKeys.hh"
+#include "common/TransferJob.hh"
+#include "common/TransferQueue.hh"
+#include "authz/XrdCapability.hh"
+#include "mq/XrdMqMessage.hh"
+#include "namespace/MDException.hh"
+#include "namespace/interface/IView.hh"
+#include "namespace/interface/IFsView.hh"
+#include "XrdSys/XrdSysTimer.hh"
+#include <algorithm>
+
+EOSMGMNAMESPACE_BEGIN
+
+//! Attempts of a file before it is given up
+static const int sMaxAttempts = 5;
+//! Seconds before the first retry, doubled for every further attempt
+static const time_t sBackoff = 60;
+//! Minimum time given to a transfer before it is retried
+static const time_t sMinTimeout = 600;
+//! Seconds between two snapshots of the file list of a finished drain
+static const time_t sReloadInterval = 60;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+DrainScheduler::DrainScheduler():
+  mThread(0), mLastTick(0)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+DrainScheduler::~DrainScheduler()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+// Start the scheduler thread
+//------------------------------------------------------------------------------
+bool
+DrainScheduler::Start()
+{
+  mThread = 0;
+  XrdSysThread::Run(&mThread, DrainScheduler::StaticRun,
+                    static_cast<void*>(this), XRDSYSTHREAD_HOLD,
+                    "Drain Scheduler Thread");
+  return (mThread ? true : false);
+}
+
+//------------------------------------------------------------------------------
+// Stop the scheduler thread
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Stop()
+{
+  if (mThread) {
+    XrdSysThread::Cancel(mThread);
+    XrdSysThread::Join(mThread, 0);
+  }
+
+  mThread = 0;
+}
+
+//------------------------------------------------------------------------------
+// Static thread startup function
+//------------------------------------------------------------------------------
+void*
+DrainScheduler::StaticRun(void* arg)
+{
+  return reinterpret_cast<DrainScheduler*>(arg)->Run();
+}
+
+//------------------------------------------------------------------------------
+// Check if the drains of a space are scheduled centrally
+//------------------------------------------------------------------------------
+bool
+DrainScheduler::IsEnabled(const std::string& space)
+{
+  eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+  auto it = FsView::gFsView.mSpaceView.find(space);
+
+  if (it == FsView::gFsView.mSpaceView.end()) {
+    return false;
+  }
+
+  return (it->second->GetConfigMember("drainer.central") != "off");
+}
+
+//------------------------------------------------------------------------------
+// Start scheduling the transfers of a draining filesystem
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Add(eos::common::FileSystem::fsid_t fsid,
+                    const std::string& space, const std::string& group,
+                    unsigned long long bytes)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mDrains.count(fsid)) {
+    return;
+  }
+
+  std::shared_ptr<Drain> drain = std::make_shared<Drain>();
+  drain->mFsId = fsid;
+  drain->mSpace = space;
+  drain->mGroup = group;
+  drain->mTotalBytes = bytes;
+  drain->mProgress.mBytesLeft = bytes;
+  mDrains[fsid] = drain;
+  eos_static_notice("msg=\"scheduling drain\" fsid=%u space=%s group=%s",
+                    fsid, space.c_str(), group.c_str());
+}
+
+//------------------------------------------------------------------------------
+// Stop scheduling the transfers of a filesystem
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Remove(eos::common::FileSystem::fsid_t fsid)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mDrains.erase(fsid)) {
+    eos_static_notice("msg=\"stopped scheduling drain\" fsid=%u", fsid);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Check if the transfers of a filesystem are scheduled here
+//------------------------------------------------------------------------------
+bool
+DrainScheduler::IsScheduling(eos::common::FileSystem::fsid_t fsid)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mDrains.count(fsid);
+}
+
+//------------------------------------------------------------------------------
+// Get the progress of the drain of a filesystem
+//------------------------------------------------------------------------------
+bool
+DrainScheduler::GetProgress(eos::common::FileSystem::fsid_t fsid,
+                            Progress& progress)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mDrains.find(fsid);
+
+  if (it == mDrains.end()) {
+    return false;
+  }
+
+  progress = it->second->mProgress;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Concurrency limits configured for a space
+//------------------------------------------------------------------------------
+DrainScheduler::Limits
+DrainScheduler::GetLimits(const std::string& space)
+{
+  Limits limits;
+  limits.mFsTx = 5;
+  limits.mNodeTx = 2;
+  limits.mRate = 25;
+  eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+  auto it = FsView::gFsView.mSpaceView.find(space);
+
+  if (it != FsView::gFsView.mSpaceView.end()) {
+    std::string fstx = it->second->GetConfigMember("drainer.fs.ntx");
+    std::string nodetx = it->second->GetConfigMember("drainer.node.ntx");
+    std::string rate = it->second->GetConfigMember("drainer.node.rate");
+
+    if (fstx.length()) {
+      limits.mFsTx = strtoul(fstx.c_str(), 0, 10);
+    }
+
+    if (nodetx.length()) {
+      limits.mNodeTx = strtoul(nodetx.c_str(), 0, 10);
+    }
+
+    if (rate.length() && strtoull(rate.c_str(), 0, 10)) {
+      limits.mRate = strtoull(rate.c_str(), 0, 10);
+    }
+  }
+
+  return limits;
+}
+
+//------------------------------------------------------------------------------
+// Scheduler thread loop
+//------------------------------------------------------------------------------
+void*
+DrainScheduler::Run()
+{
+  XrdSysThread::SetCancelOn();
+  XrdSysThread::SetCancelDeferred();
+  XrdSysTimer sleeper;
+  bool go = false;
+
+  // Wait that the namespace is booted
+  do {
+    XrdSysThread::SetCancelOff();
+    {
+      XrdSysMutexHelper lock(gOFS->InitializationMutex);
+
+      if (gOFS->Initialized == gOFS->kBooted) {
+        go = true;
+      }
+    }
+    XrdSysThread::SetCancelOn();
+
+    if (!go) {
+      sleeper.Snooze(5);
+    }
+  } while (!go);
+
+  eos_static_info("msg=\"starting drain scheduler\"");
+
+  while (1) {
+    XrdSysThread::SetCancelOff();
+
+    if (gOFS->MgmMaster.IsMaster()) {
+      Tick();
+    }
+
+    XrdSysThread::SetCancelOn();
+    sleeper.Wait(1000);
+    XrdSysThread::CancelPoint();
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// One scheduling round over all the drains
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Tick()
+{
+  time_t now = time(NULL);
+  time_t elapsed = mLastTick ? (now - mLastTick) : 0;
+  mLastTick = now;
+  {
+    // Take over the drains added and removed since the last round
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto it = mActive.begin(); it != mActive.end();) {
+      auto dit = mDrains.find(it->first);
+
+      if ((dit == mDrains.end()) || (dit->second != it->second)) {
+        for (auto tit = it->second->mRunning.cbegin();
+             tit != it->second->mRunning.cend(); ++tit) {
+          Release(it->first, tit->second);
+        }
+
+        it = mActive.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    for (auto it = mDrains.begin(); it != mDrains.end(); ++it) {
+      if (!mActive.count(it->first)) {
+        mActive[it->first] = it->second;
+      }
+    }
+  }
+
+  for (auto it = mActive.begin(); it != mActive.end(); ++it) {
+    Drain& drain = *it->second;
+
+    if (!drain.mLoaded) {
+      LoadFiles(drain);
+    }
+
+    CheckRunning(drain, now);
+    Limits limits = GetLimits(drain.mSpace);
+    std::vector<Target> targets;
+    {
+      eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
+      auto git = FsView::gFsView.mGroupView.find(drain.mGroup);
+
+      if (git != FsView::gFsView.mGroupView.end()) {
+        for (auto fit = git->second->begin(); fit != git->second->end(); ++fit) {
+          if (*fit == drain.mFsId) {
+            continue;
+          }
+
+          auto fsit = FsView::gFsView.mIdView.find(*fit);
+
+          if (fsit == FsView::gFsView.mIdView.end()) {
+            continue;
+          }
+
+          eos::common::FileSystem::fs_snapshot_t snapshot;
+
+          if (!fsit->second->SnapShotFileSystem(snapshot, false)) {
+            continue;
+          }
+
+          if ((snapshot.mStatus != eos::common::FileSystem::kBooted) ||
+              (snapshot.mConfigStatus != eos::common::FileSystem::kRW) ||
+              (snapshot.mActiveStatus != eos::common::FileSystem::kOnline)) {
+            continue;
+          }
+
+          Target target;
+          target.mFsId = snapshot.mId;
+          target.mNode = snapshot.mQueue;
+          target.mHostPort = snapshot.mHostPort;
+          target.mPath = snapshot.mPath;
+          target.mFreeBytes = snapshot.mDiskFreeBytes - snapshot.mHeadRoom;
+          targets.push_back(target);
+        }
+      }
+    }
+
+    // Space already booked on the targets by running transfers
+    for (auto tit = drain.mRunning.cbegin(); tit != drain.mRunning.cend(); ++tit) {
+      for (auto target = targets.begin(); target != targets.end(); ++target) {
+        if (target->mFsId == tit->second.mTarget) {
+          target->mFreeBytes -= tit->second.mSize;
+        }
+      }
+    }
+
+    Schedule(drain, limits, targets, now);
+
+    // Take a new snapshot of what is left after a full pass
+    if ((drain.mCursor >= drain.mFiles.size()) && drain.mRunning.empty() &&
+        drain.mRetry.empty() && (!drain.mProgress.mFinished ||
+                                 ((now - drain.mLoadTime) > sReloadInterval))) {
+      LoadFiles(drain);
+    }
+  }
+
+  if (!mMoves.empty()) {
+    ApplyMoves(now);
+  }
+
+  // Publish the progress
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for (auto it = mActive.begin(); it != mActive.end(); ++it) {
+    Drain& drain = *it->second;
+    Progress& progress = drain.mProgress;
+
+    if (elapsed > 0) {
+      double rate = drain.mTickBytes / 1000000.0 / elapsed;
+      // smoothed over about a minute
+      progress.mRate = progress.mRate ? (0.95 * progress.mRate + 0.05 * rate) :
+                       rate;
+      drain.mTickBytes = 0;
+    }
+
+    progress.mFilesLeft = (drain.mFiles.size() - drain.mCursor) +
+                          drain.mRunning.size() + drain.mRetry.size() +
+                          drain.mFailed.size();
+    progress.mFilesFailed = drain.mFailed.size();
+    progress.mRunning = drain.mRunning.size();
+    progress.mBytesLeft = (drain.mTotalBytes > drain.mDoneBytes) ?
+                          (drain.mTotalBytes - drain.mDoneBytes) : 0;
+
+    if (progress.mRate > 0) {
+      progress.mEta = (time_t)(progress.mBytesLeft / 1000000.0 / progress.mRate);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Apply the namespace updates of the files which need no transfer. They are
+// checked again under the write lock since the files could have changed
+// after being scheduled: a file which got data or an atomic upload which
+// got committed meanwhile goes through a normal transfer.
+//------------------------------------------------------------------------------
+void
+DrainScheduler::ApplyMoves(time_t now)
+{
+  std::vector<std::pair<eos::common::FileSystem::fsid_t,
+      eos::common::FileId::fileid_t> > done;
+  std::vector<std::pair<eos::common::FileSystem::fsid_t,
+      eos::common::FileId::fileid_t> > resubmit;
+  {
+    eos::common::RWMutexWriteLock ns_lock(gOFS->eosViewRWMutex);
+
+    for (auto it = mMoves.begin(); it != mMoves.end(); ++it) {
+      eos::common::FileSystem::fsid_t source = it->second.first;
+      eos::common::FileSystem::fsid_t target = it->second.second;
+
+      try {
+        std::shared_ptr<eos::IFileMD> fmd =
+          gOFS->eosFileService->getFileMD(it->first);
+
+        if (!fmd->hasLocation(source)) {
+          // drained meanwhile
+          done.push_back(std::make_pair(source, it->first));
+          continue;
+        }
+
+        std::string fullpath = gOFS->eosView->getUri(fmd.get());
+        bool atomic = (fullpath.find(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) !=
+                       std::string::npos);
+
+        if (target ? (fmd->getSize() != 0) : !atomic) {
+          eos_static_info("msg=\"file changed since it was scheduled, drain it "
+                          "with a transfer\" fxid=%llx source-fsid=%u",
+                          it->first, source);
+          resubmit.push_back(std::make_pair(source, it->first));
+          continue;
+        }
+
+        fmd->unlinkLocation(source);
+        fmd->removeLocation(source);
+
+        if (target && !fmd->hasLocation(target)) {
+          fmd->addLocation(target);
+        }
+
+        gOFS->eosView->updateFileStore(fmd.get());
+        eos_static_info("msg=\"drained without transfer\" fxid=%llx "
+                        "source-fsid=%u target-fsid=%u", it->first, source,
+                        target);
+      } catch (eos::MDException& e) {
+        // deleted meanwhile
+        eos_static_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(),
+                         e.getMessage().str().c_str());
+      }
+
+      done.push_back(std::make_pair(source, it->first));
+    }
+  }
+  mMoves.clear();
+
+  for (auto it = resubmit.cbegin(); it != resubmit.cend(); ++it) {
+    auto dit = mActive.find(it->first);
+
+    if (dit != mActive.end()) {
+      dit->second->mRetry[it->second].mWhen = now;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for (auto it = done.cbegin(); it != done.cend(); ++it) {
+    auto dit = mActive.find(it->first);
+
+    if (dit != mActive.end()) {
+      dit->second->mProgress.mFilesDone++;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Take a new snapshot of the files left on a draining filesystem, the oldest
+// files first
+//------------------------------------------------------------------------------
+void
+DrainScheduler::LoadFiles(Drain& drain)
+{
+  drain.mFiles.clear();
+  drain.mCursor = 0;
+  drain.mLoadTime = time(NULL);
+  {
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+    try {
+      eos::IFsView::FileList filelist = gOFS->eosFsView->getFileList(drain.mFsId);
+      drain.mFiles.reserve(filelist.size());
+
+      for (auto it = filelist.begin(); it != filelist.end(); ++it) {
+        if (!drain.mFailed.count(*it)) {
+          drain.mFiles.push_back(*it);
+        }
+      }
+    } catch (eos::MDException& e) {
+      // there are no files in that view
+    }
+  }
+  std::sort(drain.mFiles.begin(), drain.mFiles.end());
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (!drain.mLoaded) {
+    drain.mProgress.mTotalFiles = drain.mFiles.size() + drain.mFailed.size();
+    drain.mLoaded = true;
+  }
+
+  drain.mProgress.mFinished = drain.mFiles.empty();
+
+  eos_static_info("msg=\"drain file list\" fsid=%u files=%lu failed=%lu",
+                  drain.mFsId, (unsigned long) drain.mFiles.size(),
+                  (unsigned long) drain.mFailed.size());
+}
+
+//------------------------------------------------------------------------------
+// Find the transfers which completed or timed out. A transfer is complete
+// once the commit of the new replica dropped the replica of the draining
+// filesystem, or the file is gone.
+//------------------------------------------------------------------------------
+void
+DrainScheduler::CheckRunning(Drain& drain, time_t now)
+{
+  if (drain.mRunning.empty()) {
+    return;
+  }
+
+  std::vector<eos::common::FileId::fileid_t> done;
+  std::vector<eos::common::FileId::fileid_t> expired;
+  {
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+    for (auto it = drain.mRunning.cbegin(); it != drain.mRunning.cend(); ++it) {
+      bool complete = true;
+
+      try {
+        std::shared_ptr<eos::IFileMD> fmd = gOFS->eosFileService->getFileMD(it->first);
+        complete = !fmd->hasLocation(drain.mFsId);
+      } catch (eos::MDException& e) {
+        // deleted meanwhile
+      }
+
+      if (complete) {
+        done.push_back(it->first);
+      } else if (it->second.mDeadline < now) {
+        expired.push_back(it->first);
+      }
+    }
+  }
+
+  for (auto it = done.cbegin(); it != done.cend(); ++it) {
+    const Transfer& tx = drain.mRunning[*it];
+    Release(drain.mFsId, tx);
+    drain.mDoneBytes += tx.mSize;
+    drain.mTickBytes += tx.mSize;
+    drain.mRunning.erase(*it);
+  }
+
+  if (!done.empty()) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    drain.mProgress.mFilesDone += done.size();
+  }
+
+  for (auto it = expired.cbegin(); it != expired.cend(); ++it) {
+    const Transfer& tx = drain.mRunning[*it];
+    eos_static_warning("msg=\"drain transfer timed out\" fxid=%llx "
+                       "source-fsid=%u target-fsid=%u", *it, drain.mFsId,
+                       tx.mTarget);
+    Release(drain.mFsId, tx);
+    drain.mRunning.erase(*it);
+    Fail(drain, *it, now);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Record a failed attempt of a file
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Fail(Drain& drain, eos::common::FileId::fileid_t fid,
+                     time_t now)
+{
+  Retry& retry = drain.mRetry[fid];
+  retry.mAttempts++;
+
+  if (retry.mAttempts >= sMaxAttempts) {
+    eos_static_err("msg=\"giving up draining file\" fxid=%llx fsid=%u "
+                   "attempts=%d", fid, drain.mFsId, retry.mAttempts);
+    drain.mRetry.erase(fid);
+    drain.mFailed.insert(fid);
+    return;
+  }
+
+  retry.mWhen = now + (sBackoff << (retry.mAttempts - 1));
+}
+
+//------------------------------------------------------------------------------
+// Get the next file to schedule, the retries which are due first
+//------------------------------------------------------------------------------
+eos::common::FileId::fileid_t
+DrainScheduler::NextFile(Drain& drain, time_t now)
+{
+  for (auto it = drain.mRetry.begin(); it != drain.mRetry.end(); ++it) {
+    if ((it->second.mWhen <= now) && !drain.mRunning.count(it->first)) {
+      // a far future time marks it as being scheduled
+      it->second.mWhen = now + sMinTimeout;
+      return it->first;
+    }
+  }
+
+  while (drain.mCursor < drain.mFiles.size()) {
+    eos::common::FileId::fileid_t fid = drain.mFiles[drain.mCursor++];
+
+    if (!drain.mRunning.count(fid) && !drain.mRetry.count(fid) &&
+        !drain.mFailed.count(fid)) {
+      return fid;
+    }
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Schedule new transfers of a drain within the limits
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Schedule(Drain& drain, const Limits& limits,
+                         std::vector<Target>& targets, time_t now)
+{
+  if (targets.empty()) {
+    return;
+  }
+
+  std::vector<eos::common::FileId::fileid_t> candidates;
+
+  while (mFsTx[drain.mFsId] + candidates.size() < limits.mFsTx) {
+    eos::common::FileId::fileid_t fid = NextFile(drain, now);
+
+    if (!fid) {
+      break;
+    }
+
+    candidates.push_back(fid);
+  }
+
+  if (candidates.empty()) {
+    return;
+  }
+
+  // Lock the view before the namespace like the commit does
+  eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
+  eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+  for (auto it = candidates.cbegin(); it != candidates.cend(); ++it) {
+    int rc = Submit(drain, *it, limits, targets, now);
+
+    if ((rc == 1) || (rc == 2)) {
+      drain.mRetry.erase(*it);
+    } else if (rc == 0) {
+      drain.mRetry.erase(*it);
+      std::lock_guard<std::mutex> lock(mMutex);
+      drain.mProgress.mFilesDone++;
+    } else if (rc == -1) {
+      // no free target now, the file comes first in the next round
+      drain.mRetry[*it].mWhen = now;
+    } else {
+      Fail(drain, *it, now);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Create the transfer of a file and hand it to a target. The capabilities are
+// the ones created by the schedule2drain call of the FSTs.
+//------------------------------------------------------------------------------
+int
+DrainScheduler::Submit(Drain& drain, eos::common::FileId::fileid_t fid,
+                       const Limits& limits, std::vector<Target>& targets,
+                       time_t now)
+{
+  std::shared_ptr<eos::IFileMD> fmd;
+  std::string fullpath;
+
+  try {
+    fmd = gOFS->eosFileService->getFileMD(fid);
+    fullpath = gOFS->eosView->getUri(fmd.get());
+  } catch (eos::MDException& e) {
+    return 0;
+  }
+
+  if (!fmd || !fmd->hasLocation(drain.mFsId)) {
+    return 0;
+  }
+
+  XrdOucString savepath = fullpath.c_str();
+
+  while (savepath.replace("&", "#AND#")) {}
+
+  fullpath = savepath.c_str();
+  if (fullpath.find(EOS_COMMON_PATH_ATOMIC_FILE_PREFIX) != std::string::npos) {
+    // a left-over atomic upload is just dropped
+    mMoves[fid] = std::make_pair(drain.mFsId, 0);
+    return 2;
+  }
+
+  unsigned long lid = fmd->getLayoutId();
+  unsigned long long cid = fmd->getContainerId();
+  unsigned long long size = fmd->getSize();
+  uid_t uid = fmd->getCUid();
+  gid_t gid = fmd->getCGid();
+  // Pick the least busy target not having the file, starting at a position
+  // depending on the file to spread equally busy targets
+  Target* target = 0;
+  size_t ntargets = targets.size();
+
+  for (size_t i = 0; i < ntargets; i++) {
+    Target& candidate = targets[(fid + i) % ntargets];
+
+    if (fmd->hasLocation(candidate.mFsId) ||
+        (candidate.mFreeBytes < (long long) size) ||
+        (mFsTx[candidate.mFsId] >= limits.mFsTx) ||
+        (mNodeTx[candidate.mNode] >= limits.mNodeTx)) {
+      continue;
+    }
+
+    if (!target || (mFsTx[candidate.mFsId] < mFsTx[target->mFsId])) {
+      target = &candidate;
+    }
+  }
+
+  if (!target) {
+    return -1;
+  }
+
+  if (!size) {
+    // nothing to copy
+    mMoves[fid] = std::make_pair(drain.mFsId, target->mFsId);
+    return 2;
+  }
+
+  auto source_it = FsView::gFsView.mIdView.find(drain.mFsId);
+  auto target_it = FsView::gFsView.mIdView.find(target->mFsId);
+
+  if ((source_it == FsView::gFsView.mIdView.end()) ||
+      (target_it == FsView::gFsView.mIdView.end())) {
+    return -1;
+  }
+
+  FileSystem* source_fs = source_it->second;
+  FileSystem* target_fs = target_it->second;
+
+  eos::common::FileSystem::fs_snapshot_t source_snapshot;
+  source_fs->SnapShotFileSystem(source_snapshot, false);
+  bool rain = ((eos::common::LayoutId::GetLayoutType(lid) ==
+                eos::common::LayoutId::kRaidDP) ||
+               (eos::common::LayoutId::GetLayoutType(lid) ==
+                eos::common::LayoutId::kArchive) ||
+               (eos::common::LayoutId::GetLayoutType(lid) ==
+                eos::common::LayoutId::kRaid6));
+  XrdOucString fullcapability = "";
+  XrdOucString hexfid = "";
+  eos::common::FileId::Fid2Hex(fid, hexfid);
+
+  if (rain && (source_snapshot.mConfigStatus ==
+               eos::common::FileSystem::kDrainDead)) {
+    // RAIN layouts drain by a reconstruction when the stripe is lost
+    fullcapability += "source.url=root://";
+    fullcapability += gOFS->ManagerId;
+    fullcapability += "/";
+    fullcapability += fullpath.c_str();
+    fullcapability += "&target.url=/dev/null";
+    XrdOucString source_env;
+    source_env = "eos.pio.action=reconstruct&";
+    source_env += "eos.pio.recfs=";
+    source_env += (int) source_snapshot.mId;
+    fullcapability += "&source.env=";
+    fullcapability += XrdMqMessage::Seal(source_env, "_AND_");
+    fullcapability += "&tx.layout.reco=true";
+  } else {
+    std::vector<unsigned int> locationfs;
+    unsigned long fsindex = 0;
+
+    if (!rain) {
+      eos::IFileMD::LocationVector loc_vect = fmd->getLocations();
+
+      for (auto lociter = loc_vect.cbegin(); lociter != loc_vect.cend();
+           ++lociter) {
+        // only read from the draining filesystem if it is not dead
+        if (*lociter && ((*lociter != drain.mFsId) ||
+                         (source_snapshot.mConfigStatus ==
+                          eos::common::FileSystem::kDrain))) {
+          locationfs.push_back(*lociter);
+        }
+      }
+
+      std::string tried_cgi;
+      std::vector<unsigned int> unavailfs;
+      eos::common::Mapping::VirtualIdentity_t h_vid;
+      eos::common::Mapping::Root(h_vid);
+      Scheduler::AccessArguments acsargs;
+      acsargs.bookingsize = 0;
+      acsargs.fsindex = &fsindex;
+      acsargs.isRW = false;
+      acsargs.lid = lid;
+      acsargs.locationsfs = &locationfs;
+      acsargs.tried_cgi = &tried_cgi;
+      acsargs.unavailfs = &unavailfs;
+      acsargs.vid = &h_vid;
+      acsargs.schedtype = Scheduler::draining;
+
+      if (!acsargs.isValid() || Quota::FileAccess(&acsargs)) {
+        eos_static_err("msg=\"no replica to drain from\" fxid=%llx fsid=%u",
+                       fid, drain.mFsId);
+        return -2;
+      }
+    } else {
+      // copy the stripe which is still accessible
+      locationfs.push_back(drain.mFsId);
+    }
+
+    auto replica_it = FsView::gFsView.mIdView.find(locationfs[fsindex]);
+
+    if (replica_it == FsView::gFsView.mIdView.end()) {
+      return -1;
+    }
+
+    FileSystem* replica_fs = replica_it->second;
+
+    eos::common::FileSystem::fs_snapshot_t replica_snapshot;
+    replica_fs->SnapShotFileSystem(replica_snapshot, false);
+    unsigned long long target_lid = lid & 0xffffff0f;
+
+    if (!eos::common::LayoutId::GetBlockChecksum(lid)) {
+      // mask block checksums (e.g. for replica layouts)
+      target_lid &= 0xf0ffffff;
+    }
+
+    XrdOucString sizestring;
+    XrdOucString source_capability = "mgm.access=read";
+    source_capability += "&mgm.lid=";
+    source_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         target_lid);
+    source_capability += "&mgm.cid=";
+    source_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         cid);
+    source_capability += "&mgm.ruid=1&mgm.rgid=1&mgm.uid=1&mgm.gid=1";
+    source_capability += "&mgm.path=";
+    source_capability += fullpath.c_str();
+    source_capability += "&mgm.manager=";
+    source_capability += gOFS->ManagerId.c_str();
+    source_capability += "&mgm.fid=";
+    source_capability += hexfid;
+    source_capability += "&mgm.sec=";
+    source_capability += eos::common::SecEntity::ToKey(0, "eos/draining").c_str();
+    source_capability += "&mgm.drainfsid=";
+    source_capability += (int) drain.mFsId;
+    source_capability += "&mgm.localprefix=";
+    source_capability += replica_snapshot.mPath.c_str();
+    source_capability += "&mgm.fsid=";
+    source_capability += (int) replica_snapshot.mId;
+    source_capability += "&mgm.sourcehostport=";
+    source_capability += replica_snapshot.mHostPort.c_str();
+    XrdOucString target_capability = "mgm.access=write";
+    target_capability += "&mgm.lid=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         target_lid);
+    target_capability += "&mgm.source.lid=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         (unsigned long long) lid);
+    target_capability += "&mgm.source.ruid=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         (unsigned long long) uid);
+    target_capability += "&mgm.source.rgid=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         (unsigned long long) gid);
+    target_capability += "&mgm.cid=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         cid);
+    target_capability += "&mgm.ruid=1&mgm.rgid=1&mgm.uid=1&mgm.gid=1";
+    target_capability += "&mgm.path=";
+    target_capability += fullpath.c_str();
+    target_capability += "&mgm.manager=";
+    target_capability += gOFS->ManagerId.c_str();
+    target_capability += "&mgm.fid=";
+    target_capability += hexfid;
+    target_capability += "&mgm.sec=";
+    target_capability += eos::common::SecEntity::ToKey(0, "eos/draining").c_str();
+    target_capability += "&mgm.drainfsid=";
+    target_capability += (int) drain.mFsId;
+    target_capability += "&mgm.localprefix=";
+    target_capability += target->mPath.c_str();
+    target_capability += "&mgm.fsid=";
+    target_capability += (int) target->mFsId;
+    target_capability += "&mgm.targethostport=";
+    target_capability += target->mHostPort.c_str();
+    target_capability += "&mgm.bookingsize=";
+    target_capability += eos::common::StringConversion::GetSizeString(sizestring,
+                         size);
+    XrdOucEnv insource_capability(source_capability.c_str());
+    XrdOucEnv intarget_capability(target_capability.c_str());
+    XrdOucEnv* source_capabilityenv = 0;
+    XrdOucEnv* target_capabilityenv = 0;
+    eos::common::SymKey* symkey = eos::common::gSymKeyStore.GetCurrentKey();
+    int caprc = 0;
+
+    if ((caprc = gCapabilityEngine.Create(&insource_capability,
+                                          source_capabilityenv, symkey,
+                                          gOFS->mCapabilityValidity)) ||
+        (caprc = gCapabilityEngine.Create(&intarget_capability,
+                                          target_capabilityenv, symkey,
+                                          gOFS->mCapabilityValidity))) {
+      eos_static_err("msg=\"unable to create source/target capability\" "
+                     "errno=%u", caprc);
+      delete source_capabilityenv;
+      delete target_capabilityenv;
+      return -1;
+    }
+
+    int caplen = 0;
+    XrdOucString source_cap = source_capabilityenv->Env(caplen);
+    XrdOucString target_cap = target_capabilityenv->Env(caplen);
+    delete source_capabilityenv;
+    delete target_capabilityenv;
+    source_cap.replace("cap.sym", "source.cap.sym");
+    target_cap.replace("cap.sym", "target.cap.sym");
+    source_cap.replace("cap.msg", "source.cap.msg");
+    target_cap.replace("cap.msg", "target.cap.msg");
+    source_cap += "&source.url=root://";
+    source_cap += replica_snapshot.mHostPort.c_str();
+    source_cap += "//replicate:";
+    source_cap += hexfid;
+    target_cap += "&target.url=root://";
+    target_cap += target->mHostPort.c_str();
+    target_cap += "//replicate:";
+    target_cap += hexfid;
+    fullcapability += source_cap;
+    fullcapability += target_cap;
+  }
+
+  eos::common::TransferJob txjob(fullcapability.c_str());
+
+  if (!target_fs->GetDrainQueue()->Add(&txjob)) {
+    eos_static_err("msg=\"failed to submit drain job\" fxid=%llx "
+                   "target-fsid=%u", fid, target->mFsId);
+    return -1;
+  }
+
+  Transfer tx;
+  tx.mTarget = target->mFsId;
+  tx.mTargetNode = target->mNode;
+  tx.mSize = size;
+  // allow for four times the nominal duration of the transfer
+  tx.mDeadline = now + sMinTimeout + 4 * (size / (limits.mRate * 1000000ull));
+  drain.mRunning[fid] = tx;
+  target->mFreeBytes -= size;
+  mFsTx[drain.mFsId]++;
+  mFsTx[target->mFsId]++;
+  mNodeTx[target->mNode]++;
+  eos_static_info("msg=\"queued drain transfer\" fxid=%llx source-fsid=%u "
+                  "target-fsid=%u", fid, drain.mFsId, target->mFsId);
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Release the slots of a running transfer
+//------------------------------------------------------------------------------
+void
+DrainScheduler::Release(eos::common::FileSystem::fsid_t source,
+                        const Transfer& tx)
+{
+  if (mFsTx[source]) {
+    mFsTx[source]--;
+  }
+
+  if (mFsTx[tx.mTarget]) {
+    mFsTx[tx.mTarget]--;
+  }
+
+  if (mNodeTx[tx.mTargetNode]) {
+    mNodeTx[tx.mTargetNode]--;
+  }
+}
+
+EOSMGMNAMESPACE_END
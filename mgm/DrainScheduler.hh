@@ -0,0 +1,256 @@
+//------------------------------------------------------------------------------
+// File: DrainScheduler.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_DRAINSCHEDULER__HH__
+#define __EOSMGM_DRAINSCHEDULER__HH__
+
+#include "mgm/Namespace.hh"
+#include "common/FileId.hh"
+#include "common/FileSystem.hh"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Central scheduler of the drain transfers.
+//!
+//! Instead of every FST pulling drain jobs one by one, the MGM pushes the
+//! transfers of all the draining filesystems into the drain queues of the
+//! target filesystems. A single thread walks a snapshot of the file list of
+//! each draining filesystem and keeps as many transfers running as the
+//! concurrency limits of the space allow:
+//!   drainer.fs.ntx   - transfers reading from or writing to one filesystem
+//!   drainer.node.ntx - transfers writing to one node
+//! A transfer is complete once the source replica is dropped by the commit
+//! of the target. Transfers not completing within a timeout derived from the
+//! file size and drainer.node.rate are retried with an exponential backoff
+//! on another target.
+//!
+//! The DrainJob of a filesystem keeps driving the drain states and adds the
+//! filesystem to the scheduler once it is draining. It publishes the
+//! progress, the throughput and the estimated time left reported here.
+//------------------------------------------------------------------------------
+class DrainScheduler
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Progress of the drain of a filesystem
+  //----------------------------------------------------------------------------
+  struct Progress {
+    unsigned long long mTotalFiles; ///< Files to drain when the drain started
+    unsigned long long mFilesLeft; ///< Files still on the filesystem
+    unsigned long long mFilesDone; ///< Files drained
+    unsigned long long mFilesFailed; ///< Files given up after all retries
+    unsigned long long mRunning; ///< Transfers running
+    unsigned long long mBytesLeft; ///< Estimate of the bytes still to drain
+    double mRate; ///< Drain throughput in MB/s
+    time_t mEta; ///< Estimated seconds until the drain is complete
+    bool mFinished; ///< Nothing left to schedule
+
+    Progress():
+      mTotalFiles(0), mFilesLeft(0), mFilesDone(0), mFilesFailed(0),
+      mRunning(0), mBytesLeft(0), mRate(0), mEta(0), mFinished(false) {}
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  DrainScheduler();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~DrainScheduler();
+
+  //----------------------------------------------------------------------------
+  //! Start the scheduler thread
+  //----------------------------------------------------------------------------
+  bool Start();
+
+  //----------------------------------------------------------------------------
+  //! Stop the scheduler thread
+  //----------------------------------------------------------------------------
+  void Stop();
+
+  //----------------------------------------------------------------------------
+  //! Check if the drains of a space are scheduled centrally, as configured by
+  //! the drainer.central space variable
+  //----------------------------------------------------------------------------
+  static bool IsEnabled(const std::string& space);
+
+  //----------------------------------------------------------------------------
+  //! Start scheduling the transfers of a draining filesystem
+  //!
+  //! @param fsid filesystem to drain
+  //! @param space space of the filesystem
+  //! @param group scheduling group of the filesystem, the targets are taken
+  //!        from it
+  //! @param bytes bytes used on the filesystem, 0 if unknown
+  //----------------------------------------------------------------------------
+  void Add(eos::common::FileSystem::fsid_t fsid, const std::string& space,
+           const std::string& group, unsigned long long bytes);
+
+  //----------------------------------------------------------------------------
+  //! Stop scheduling the transfers of a filesystem. Running transfers are not
+  //! cancelled, they complete on the FSTs.
+  //----------------------------------------------------------------------------
+  void Remove(eos::common::FileSystem::fsid_t fsid);
+
+  //----------------------------------------------------------------------------
+  //! Check if the transfers of a filesystem are scheduled here
+  //----------------------------------------------------------------------------
+  bool IsScheduling(eos::common::FileSystem::fsid_t fsid);
+
+  //----------------------------------------------------------------------------
+  //! Get the progress of the drain of a filesystem
+  //!
+  //! @return false if the filesystem is not scheduled here
+  //----------------------------------------------------------------------------
+  bool GetProgress(eos::common::FileSystem::fsid_t fsid, Progress& progress);
+
+private:
+  //! A transfer handed to a target filesystem
+  struct Transfer {
+    eos::common::FileSystem::fsid_t mTarget;
+    std::string mTargetNode;
+    unsigned long long mSize;
+    time_t mDeadline; ///< Retried if not complete by then
+  };
+
+  //! A file waiting to be retried
+  struct Retry {
+    time_t mWhen; ///< Not retried before
+    int mAttempts; ///< Failed attempts
+
+    Retry(): mWhen(0), mAttempts(0) {}
+  };
+
+  //! A possible target of the drain transfers
+  struct Target {
+    eos::common::FileSystem::fsid_t mFsId;
+    std::string mNode;
+    std::string mHostPort;
+    std::string mPath;
+    long long mFreeBytes; ///< Free bytes minus headroom and booked transfers
+  };
+
+  //! State of the drain of one filesystem, only used by the scheduler thread
+  //! except for mProgress
+  struct Drain {
+    eos::common::FileSystem::fsid_t mFsId;
+    std::string mSpace;
+    std::string mGroup;
+    unsigned long long mTotalBytes; ///< Bytes to drain when the drain started
+    unsigned long long mDoneBytes;
+    std::vector<eos::common::FileId::fileid_t> mFiles; ///< File list snapshot
+    size_t mCursor; ///< Next position in mFiles
+    bool mLoaded; ///< mFiles was taken at least once
+    time_t mLoadTime; ///< When mFiles was taken
+    std::map<eos::common::FileId::fileid_t, Transfer> mRunning;
+    std::map<eos::common::FileId::fileid_t, Retry> mRetry;
+    std::set<eos::common::FileId::fileid_t> mFailed;
+    unsigned long long mTickBytes; ///< Bytes drained since the last tick
+    Progress mProgress; ///< Protected by mMutex
+
+    Drain():
+      mFsId(0), mTotalBytes(0), mDoneBytes(0), mCursor(0), mLoaded(false),
+      mLoadTime(0), mTickBytes(0) {}
+  };
+
+  //! Concurrency limits of a space
+  struct Limits {
+    size_t mFsTx; ///< drainer.fs.ntx
+    size_t mNodeTx; ///< drainer.node.ntx
+    unsigned long long mRate; ///< drainer.node.rate in MB/s
+  };
+
+  static void* StaticRun(void* arg);
+
+  //! Scheduler thread loop
+  void* Run();
+
+  //! One scheduling round over all the drains
+  void Tick();
+
+  //! Apply the namespace updates of the files which need no transfer
+  void ApplyMoves(time_t now);
+
+  //! Take a new snapshot of the files left on a draining filesystem
+  void LoadFiles(Drain& drain);
+
+  //! Find the transfers which completed or timed out
+  void CheckRunning(Drain& drain, time_t now);
+
+  //! Record a failed attempt of a file
+  void Fail(Drain& drain, eos::common::FileId::fileid_t fid, time_t now);
+
+  //! Get the next file to schedule, 0 if there is none right now
+  eos::common::FileId::fileid_t NextFile(Drain& drain, time_t now);
+
+  //! Schedule new transfers of a drain within the limits
+  void Schedule(Drain& drain, const Limits& limits,
+                std::vector<Target>& targets, time_t now);
+
+  //----------------------------------------------------------------------------
+  //! Create the transfer of a file and hand it to a target, must hold the
+  //! filesystem view and the namespace read locks
+  //!
+  //! @return 1 if queued, 2 if only a namespace update was queued, 0 if the
+  //!         file needs nothing, -1 if the file can not be transferred to any
+  //!         target right now, -2 if there is no replica to read the file from
+  //----------------------------------------------------------------------------
+  int Submit(Drain& drain, eos::common::FileId::fileid_t fid,
+             const Limits& limits, std::vector<Target>& targets, time_t now);
+
+  //! Concurrency limits configured for a space
+  static Limits GetLimits(const std::string& space);
+
+  //! Release the slots of a running transfer
+  void Release(eos::common::FileSystem::fsid_t source, const Transfer& tx);
+
+  pthread_t mThread;
+  std::mutex mMutex; ///< Protecting mDrains and the progress of the drains
+  std::map<eos::common::FileSystem::fsid_t, std::shared_ptr<Drain> > mDrains;
+  //! Drains handled by the scheduler thread
+  std::map<eos::common::FileSystem::fsid_t, std::shared_ptr<Drain> > mActive;
+  //! Running transfers per filesystem, as source or as target
+  std::map<eos::common::FileSystem::fsid_t, size_t> mFsTx;
+  //! Running transfers per target node
+  std::map<std::string, size_t> mNodeTx;
+  //! Zero size files and left-over atomic uploads only needing a namespace
+  //! update: fid => (source, target), target 0 to only drop the source
+  std::map<eos::common::FileId::fileid_t,
+      std::pair<eos::common::FileSystem::fsid_t,
+      eos::common::FileSystem::fsid_t> > mMoves;
+  time_t mLastTick;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
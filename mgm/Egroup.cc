@@ -26,14 +26,149 @@
 /*----------------------------------------------------------------------------*/
 #include "common/Logging.hh"
 /*----------------------------------------------------------------------------*/
+#include <strings.h>
+/*----------------------------------------------------------------------------*/
 
 EOSMGMNAMESPACE_BEGIN
 
-XrdSysMutex Egroup::Mutex;
-std::map < std::string, std::map < std::string, bool > > Egroup::Map;
-std::map < std::string, std::map < std::string, time_t > > Egroup::LifeTime;
-std::deque <std::pair<std::string, std::string > > Egroup::LdapQueue;
-XrdSysCondVar Egroup::mCond;
+std::mutex Egroup::Mutex;
+std::map < std::string, std::map < std::string, Egroup::Entry > > Egroup::Map;
+std::deque <std::string> Egroup::LdapQueue;
+std::set <std::string> Egroup::Queued;
+std::map < std::string, std::set < std::string > > Egroup::InFlight;
+std::condition_variable Egroup::mCond;
+std::condition_variable Egroup::mResolved;
+std::shared_ptr<EgroupLookup> Egroup::Lookup(new LdapEgroupLookup());
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Escape a value used in an LDAP search filter (RFC 4515)
+ */
+/*----------------------------------------------------------------------------*/
+static std::string
+EscapeFilter(const std::string& value)
+{
+  std::string escaped;
+
+  for (auto it = value.begin(); it != value.end(); ++it) {
+    switch (*it) {
+    case '*':
+      escaped += "\\2a";
+      break;
+
+    case '(':
+      escaped += "\\28";
+      break;
+
+    case ')':
+      escaped += "\\29";
+      break;
+
+    case '\\':
+      escaped += "\\5c";
+      break;
+
+    case '\0':
+      escaped += "\\00";
+      break;
+
+    default:
+      escaped += *it;
+    }
+  }
+
+  return escaped;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+LdapEgroupLookup::Query(const std::string& username,
+                        const std::set<std::string>& egroups,
+                        std::set<std::string>& members)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Run one LDAP query returning the egroups a user is member of
+ *
+ * Instead of checking the user entry once per egroup, the requested egroups
+ * are searched for the ones having the user as (recursive) member.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  if (egroups.empty()) {
+    return true;
+  }
+
+  LDAP* ld = NULL;
+  int version = LDAP_VERSION3;
+  // currently hard coded to server name 'xldap'
+  ldap_initialize(&ld, "ldap://xldap");
+
+  if (ld == NULL) {
+    eos_static_err("msg=\"failed to initialize LDAP\"");
+    return false;
+  }
+
+  (void) ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
+  // the LDAP base
+  std::string sbase = "OU=e-groups,OU=Workgroups,DC=cern,DC=ch";
+  // the LDAP attribute
+  std::string attr = "cn";
+  // the LDAP filter (recursive membership of the user in any of the egroups)
+  std::string filter = "(&(member:1.2.840.113556.1.4.1941:=CN=";
+  filter += EscapeFilter(username);
+  filter += ",OU=Users,Ou=Organic Units,DC=cern,DC=ch)(|";
+
+  for (auto it = egroups.begin(); it != egroups.end(); ++it) {
+    filter += "(cn=";
+    filter += EscapeFilter(*it);
+    filter += ")";
+  }
+
+  filter += "))";
+  char* attrs[2];
+  attrs[0] = (char*) attr.c_str();
+  attrs[1] = NULL;
+  LDAPMessage* res = NULL;
+  struct timeval timeout;
+  timeout.tv_sec = 10;
+  timeout.tv_usec = 0;
+  eos_static_debug("base=%s attr=%s filter=%s", sbase.c_str(), attr.c_str(),
+                   filter.c_str());
+  int rc = ldap_search_ext_s(ld, sbase.c_str(), LDAP_SCOPE_SUBTREE,
+                             filter.c_str(), attrs, 0, NULL, NULL,
+                             &timeout, LDAP_NO_LIMIT, &res);
+
+  if (rc == LDAP_SUCCESS) {
+    for (LDAPMessage* e = ldap_first_entry(ld, res); e != NULL;
+         e = ldap_next_entry(ld, e)) {
+      struct berval** v = ldap_get_values_len(ld, e, attr.c_str());
+
+      if (v != NULL) {
+        int n = ldap_count_values_len(v);
+
+        for (int j = 0; j < n; j++) {
+          std::string result(v[j]->bv_val, v[j]->bv_len);
+
+          // LDAP attribute values compare case-insensitive
+          for (auto it = egroups.begin(); it != egroups.end(); ++it) {
+            if (!strcasecmp(it->c_str(), result.c_str())) {
+              members.insert(*it);
+            }
+          }
+        }
+
+        ldap_value_free_len(v);
+      }
+    }
+  } else {
+    eos_static_warning("user=\"%s\" e-groups=%d msg=\"ldap query failed or "
+                       "timed out\" rc=%d", username.c_str(), (int) egroups.size(), rc);
+  }
+
+  ldap_msgfree(res);
+  ldap_unbind_ext(ld, NULL, NULL);
+  return (rc == LDAP_SUCCESS);
+}
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -41,7 +176,7 @@ XrdSysCondVar Egroup::mCond;
  */
 /*----------------------------------------------------------------------------*/
 Egroup::Egroup():
-  mThread(0)
+  mThread(0), mStop(false)
 {}
 
 bool
@@ -56,6 +191,7 @@ Egroup::Start()
   // run an asynchronous refresh thread
   eos_static_info("Start");
   mThread = 0;
+  mStop = false;
   XrdSysThread::Run(&mThread, Egroup::StaticRefresh,
                     static_cast<void*>(this),
                     XRDSYSTHREAD_HOLD,
@@ -73,10 +209,15 @@ Egroup::Stop()
  */
 /*----------------------------------------------------------------------------*/
 {
-  // cancel the asynchronous resfresh thread
+  // terminate the asynchronous refresh thread, it finishes a running query
   if (mThread) {
-    XrdSysThread::Cancel(mThread);
+    {
+      std::lock_guard<std::mutex> lLock(Mutex);
+      mStop = true;
+    }
+    mCond.notify_all();
     XrdSysThread::Join(mThread, 0);
+    mThread = 0;
   }
 }
 
@@ -86,11 +227,10 @@ Egroup::~Egroup()
 /**
  * @brief Destructor
  *
- * We are cancelling and joining the asynchronous prefetch thread here.
+ * We are stopping and joining the asynchronous prefetch thread here.
  */
 /*----------------------------------------------------------------------------*/
 {
-  // cancel the asynchronous resfresh thread
   Stop();
 }
 
@@ -107,129 +247,110 @@ Egroup::Member(std::string& username, std::string& egroupname)
  */
 /*----------------------------------------------------------------------------*/
 {
-  Mutex.Lock();
-  time_t now = time(NULL);
-  bool iscached = false;
-  bool member = false;
-  bool isMember = false;
-
-  if (Map.count(egroupname)) {
-    if (Map[egroupname].count(username)) {
-      member = Map[egroupname][username];
-      time_t age = labs(LifeTime[egroupname][username] - now);
-
-      // we know that user, it has a cached entry which is not too old
-      if (LifeTime[egroupname].count(username) &&
-          (LifeTime[egroupname][username] > now) && (age < EOSEGROUPCACHETIME)) {
-        // that is ok, we can return member or not member from the cache
-        Mutex.UnLock();
-        return member;
-      } else {
-        // we have already an entry, we just schedule an asynchronous update
-        iscached = true;
+  std::unique_lock<std::mutex> lLock(Mutex);
+
+  while (1) {
+    auto uit = Map.find(username);
+
+    if (uit != Map.end()) {
+      auto git = uit->second.find(egroupname);
+
+      if (git != uit->second.end()) {
+        // we know that user, an entry getting old is refreshed asynchronously
+        // and the cached value is returned meanwhile
+        if (git->second.refresh <= time(NULL)) {
+          AsyncRefresh(username);
+        }
+
+        return git->second.member;
       }
     }
-  }
 
-  Mutex.UnLock();
-  // run the command not in the locked section !!!
+    auto fit = InFlight.find(username);
 
-  if (!iscached) {
-    eos_static_info("msg=\"lookup\" user=\"%s\" e-group=\"%s\"", username.c_str(),
-                    egroupname.c_str());
-    // run the LDAP query
-    LDAP* ld = NULL;
-    int version = LDAP_VERSION3;
-    // currently hard coded to server name 'lxadp'
-    ldap_initialize(&ld, "ldap://xldap");
+    if ((fit == InFlight.end()) || !fit->second.count(egroupname)) {
+      break;
+    }
 
-    if (ld == NULL) {
-      fprintf(stderr, "error: failed to initialize LDAP\n");
-    } else {
-      (void) ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
-      // the LDAP base
-      std::string sbase = "CN=";
-      sbase += username;
-      sbase += ",OU=Users,Ou=Organic Units,DC=cern,DC=ch";
-      // the LDAP attribute (recursive search)
-      std::string attr = "cn";
-      // the LDAP filter
-      std::string filter;
-      filter = "(memberOf:1.2.840.113556.1.4.1941:=CN=";
-      filter += egroupname;
-      filter += ",OU=e-groups,OU=Workgroups,DC=cern,DC=ch)";
-      char* attrs[2];
-      attrs[0] = (char*) attr.c_str();
-      attrs[1] = NULL;
-      LDAPMessage* res = NULL;
-      struct timeval timeout;
-      timeout.tv_sec = 10;
-      timeout.tv_usec = 0;
-      std::string match = username;
-      eos_static_debug("base=%s attr=%s filter=%s match=%s\n", sbase.c_str(),
-                       attr.c_str(), filter.c_str(), match.c_str());
-      int rc = ldap_search_ext_s(ld, sbase.c_str(), LDAP_SCOPE_SUBTREE,
-                                 filter.c_str(),
-                                 attrs, 0, NULL, NULL,
-                                 &timeout, LDAP_NO_LIMIT, &res);
-
-      if ((rc == LDAP_SUCCESS) && (ldap_count_entries(ld, res) != 0)) {
-        LDAPMessage* e = NULL;
-
-        for (e = ldap_first_entry(ld, res); e != NULL; e = ldap_next_entry(ld, e)) {
-          struct berval** v = ldap_get_values_len(ld, e, attr.c_str());
-
-          if (v != NULL) {
-            int n = ldap_count_values_len(v);
-            int j;
-
-            for (j = 0; j < n; j++) {
-              std::string result = v[ j ]->bv_val;
-              eos_static_info("result=%d %s\n", n, result.c_str());
-
-              if ((result.find(match)) != std::string::npos) {
-                isMember = true;
-              }
-            }
+    // another request is resolving this pair already
+    mResolved.wait(lLock);
+  }
 
-            ldap_value_free_len(v);
-          }
-        }
-      } else {
-        if (rc != LDAP_SUCCESS) {
-          eos_static_warning("member=false user=\"%s\" e-group=\"%s\" "
-                             "cachetime=<stall-information> "
-                             "msg=\"ldap query failed or timed out\"",
-                             username.c_str(),
-                             egroupname.c_str());
-        }
-      }
+  InFlight[username].insert(egroupname);
+  std::shared_ptr<EgroupLookup> lookup = Lookup;
+  lLock.unlock();
+  // run the query not in the locked section !!!
+  eos_static_info("msg=\"lookup\" user=\"%s\" e-group=\"%s\"", username.c_str(),
+                  egroupname.c_str());
+  std::set<std::string> egroups;
+  std::set<std::string> members;
+  egroups.insert(egroupname);
+  bool ok = lookup->Query(username, egroups, members);
+  bool isMember = members.count(egroupname);
+  lLock.lock();
+  Store(username, egroups, members, ok, true);
+  auto fit = InFlight.find(username);
+
+  if (fit != InFlight.end()) {
+    fit->second.erase(egroupname);
+
+    if (fit->second.empty()) {
+      InFlight.erase(fit);
+    }
+  }
 
-      ldap_msgfree(res);
+  lLock.unlock();
+  mResolved.notify_all();
+  return isMember;
+}
 
-      if (ld != NULL) {
-        ldap_unbind_ext(ld, NULL, NULL);
-      }
+/*----------------------------------------------------------------------------*/
+void
+Egroup::Store(const std::string& username, const std::set<std::string>& egroups,
+              const std::set<std::string>& members, bool ok, bool create)
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Store the result of a query in the Map
+ *
+ * @param username name of the user
+ * @param egroups egroups which were queried
+ * @param members egroups the user is member of
+ * @param ok query succeeded, otherwise existing entries are kept and retried
+ * @param create create missing entries, otherwise they were reset meanwhile
+ */
+/*----------------------------------------------------------------------------*/
+{
+  time_t now = time(NULL);
+
+  for (auto it = egroups.begin(); it != egroups.end(); ++it) {
+    auto uit = Map.find(username);
+    Entry* entry = 0;
+
+    if ((uit != Map.end()) && uit->second.count(*it)) {
+      entry = &uit->second[*it];
+    } else if (create) {
+      entry = &Map[username][*it];
+      entry->member = false;
+      entry->expire = 0;
+    } else {
+      continue;
     }
 
-    if (isMember)
-      eos_static_info("member=true user=\"%s\" e-group=\"%s\" cachetime=%lu",
-                      username.c_str(), egroupname.c_str(),
-                      now + EOSEGROUPCACHETIME);
-    else
-      eos_static_info("member=false user=\"%s\" e-group=\"%s\" cachetime=%lu",
-                      username.c_str(), egroupname.c_str(),
-                      now + EOSEGROUPCACHETIME);
-
-    Mutex.Lock();
-    Map[egroupname][username] = isMember;
-    LifeTime[egroupname][username] = now + EOSEGROUPCACHETIME;
-    Mutex.UnLock();
-    return isMember;
-  } else {
-    // just ask for asynchronous refresh
-    AsyncRefresh(egroupname, username);
-    return member;
+    if (ok) {
+      entry->member = members.count(*it);
+      entry->refresh = now + EOSEGROUPCACHETIME - EOSEGROUPREFRESHTIME;
+      entry->expire = now + EOSEGROUPCACHETIME;
+      eos_static_info("member=%s user=\"%s\" e-group=\"%s\" cachetime=%lu",
+                      entry->member ? "true" : "false", username.c_str(),
+                      it->c_str(), entry->expire);
+    } else {
+      // keep the previous information and try again later
+      entry->refresh = now + EOSEGROUPRETRYTIME;
+      eos_static_warning("member=%s user=\"%s\" e-group=\"%s\" "
+                         "cachetime=<stale-information>",
+                         entry->member ? "true" : "false", username.c_str(),
+                         it->c_str());
+    }
   }
 }
 
@@ -240,7 +361,7 @@ Egroup::StaticRefresh(void* arg)
 /**
  * @brief Thread startup function
  * @param arg Egroup object
- * @return Should never return until cancelled.
+ * @return Returns when the object is stopped.
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -253,198 +374,102 @@ void*
 /**
  * @brief Asynchronous refresh loop
  *
- * The looping thread takes Egroup requests and run's LDAP queries pushing
- * results into the Egroup membership map and updates the lifetime of the
- * resolved entry.
+ * The looping thread takes usernames to refresh and runs one LDAP query per
+ * user for all of the user's egroups which are due, pushing the results into
+ * the Egroup membership map.
  *
- * @return Should never return until cancelled.
+ * @return Returns when the object is stopped.
  */
 /*----------------------------------------------------------------------------*/
 Egroup::Refresh()
 {
   eos_static_info("msg=\"async egroup fetch thread started\"");
 
-  // infinite loop waiting to run refresh requests indicated by conditions
-  // variable
   while (1) {
-    // wait for anything to do ...
-    mCond.Wait();
-    XrdSysThread::SetCancelOff();
-    std::pair<std::string, std::string> resolve;
+    std::string username;
     {
-      XrdSysMutexHelper lLock(Mutex);
+      // wait for anything to do ...
+      std::unique_lock<std::mutex> lLock(Mutex);
 
-      if (LdapQueue.size()) {
-        resolve = LdapQueue.front();
-        LdapQueue.pop_front();
+      while (!mStop && LdapQueue.empty()) {
+        mCond.wait(lLock);
       }
-    }
 
-    if (resolve.first.length()) {
-      DoRefresh(resolve.first, resolve.second);
-    }
+      if (mStop) {
+        break;
+      }
 
-    XrdSysThread::SetCancelOn();
+      username = LdapQueue.front();
+      LdapQueue.pop_front();
+    }
+    DoRefresh(username);
   }
 
   return 0;
 }
 
 void
-Egroup::AsyncRefresh(std::string& egroupname, std::string& username)
+Egroup::AsyncRefresh(const std::string& username)
 /*----------------------------------------------------------------------------*/
 /**
- * @brief Pushes an Egroup/user resolution request into the asynchronous queue
+ * @brief Pushes a user resolution request into the asynchronous queue
+ *
+ * A user is queued only once, all its due egroups are refreshed together.
  */
 /*----------------------------------------------------------------------------*/
 {
-  // push a egroup/username pair into the async refresh queue
-  {
-    XrdSysMutexHelper qMutex(Mutex);
-    LdapQueue.push_back(std::make_pair(egroupname, username));
-  }
-  {
+  if (Queued.insert(username).second) {
+    LdapQueue.push_back(username);
     // signal to async thread
-    mCond.Signal();
+    mCond.notify_one();
   }
 }
 
 /*----------------------------------------------------------------------------*/
 void
-Egroup::DoRefresh(std::string& egroupname, std::string& username)
+Egroup::DoRefresh(const std::string& username)
 /*----------------------------------------------------------------------------*/
 /**
- * @brief Run a synchronous LDAP query for Egroup/username and update the Map
+ * @brief Run a synchronous LDAP query for all due egroups of username and
+ *        update the Map
  *
  * The asynchronous thread uses this function to update the Egroup Map.
  */
 /*----------------------------------------------------------------------------*/
 {
-  Mutex.Lock();
-  time_t now = time(NULL);
-  bool isMember = false;
-
-  if (Map.count(egroupname)) {
-    if (Map[egroupname].count(username)) {
-      // we know that user
-      if (LifeTime[egroupname].count(username) &&
-          (LifeTime[egroupname][username] > now)) {
-        // we don't update, we have already a fresh value
-        Mutex.UnLock();
-        return;
-      }
+  std::set<std::string> egroups;
+  std::shared_ptr<EgroupLookup> lookup;
+  {
+    std::lock_guard<std::mutex> lLock(Mutex);
+    // requests arriving from now on queue the user again
+    Queued.erase(username);
+    time_t now = time(NULL);
+    auto uit = Map.find(username);
+
+    if (uit == Map.end()) {
+      return;
     }
-  }
-
-  Mutex.UnLock();
-  eos_static_info("msg=\"async-lookup\" user=\"%s\" e-group=\"%s\"",
-                  username.c_str(), egroupname.c_str());
-  // run the LDAP query
-  LDAP* ld = NULL;
-  int version = LDAP_VERSION3;
-  // currently hard coded to server name 'xldap'
-  ldap_initialize(&ld, "ldap://xldap");
-  bool keepCached = true;
-
-  if (ld == NULL) {
-    fprintf(stderr, "error: failed to initialize LDAP\n");
-  } else {
-    (void) ldap_set_option(ld, LDAP_OPT_PROTOCOL_VERSION, &version);
-    // the LDAP base
-    std::string sbase = "CN=";
-    sbase += username;
-    sbase += ",OU=Users,Ou=Organic Units,DC=cern,DC=ch";
-    // the LDAP attribute (recursive search)
-    std::string attr = "cn";
-    // the LDAP filter
-    std::string filter;
-    filter = "(memberOf:1.2.840.113556.1.4.1941:=CN=";
-    filter += egroupname;
-    filter += ",OU=e-groups,OU=Workgroups,DC=cern,DC=ch)";
-    char* attrs[2];
-    attrs[0] = (char*) attr.c_str();
-    attrs[1] = NULL;
-    LDAPMessage* res = NULL;
-    struct timeval timeout;
-    timeout.tv_sec = 10;
-    timeout.tv_usec = 0;
-    std::string match = username;
-    eos_static_debug("base=%s attr=%s filter=%s match=%s\n", sbase.c_str(),
-                     attr.c_str(), filter.c_str(), match.c_str());
-    int rc = ldap_search_ext_s(ld, sbase.c_str(), LDAP_SCOPE_SUBTREE,
-                               filter.c_str(), attrs, 0, NULL, NULL,
-                               &timeout, LDAP_NO_LIMIT, &res);
-
-    if ((rc == LDAP_SUCCESS) && (ldap_count_entries(ld, res) != 0)) {
-      LDAPMessage* e = NULL;
-      keepCached = false;
-
-      for (e = ldap_first_entry(ld, res); e != NULL; e = ldap_next_entry(ld, e)) {
-        struct berval** v = ldap_get_values_len(ld, e, attr.c_str());
-
-        if (v != NULL) {
-          int n = ldap_count_values_len(v);
-          int j;
-
-          for (j = 0; j < n; j++) {
-            std::string result = v[ j ]->bv_val;
-
-            if ((result.find(match)) != std::string::npos) {
-              isMember = true;
-            }
-          }
 
-          ldap_value_free_len(v);
-        }
+    for (auto it = uit->second.begin(); it != uit->second.end(); ++it) {
+      if (it->second.refresh <= now) {
+        egroups.insert(it->first);
       }
     }
 
-    ldap_msgfree(res);
-
-    if (ld != NULL) {
-      ldap_unbind_ext(ld, NULL, NULL);
-    }
+    lookup = Lookup;
   }
 
-  if (!keepCached) {
-    if (isMember)
-      eos_static_info("member=true user=\"%s\" e-group=\"%s\" cachetime=%lu",
-                      username.c_str(), egroupname.c_str(),
-                      now + EOSEGROUPCACHETIME);
-    else
-      eos_static_info("member=false user=\"%s\" e-group=\"%s\" cachetime=%lu",
-                      username.c_str(), egroupname.c_str(),
-                      now + EOSEGROUPCACHETIME);
-
-    Mutex.Lock();
-    Map[egroupname][username] = isMember;
-    LifeTime[egroupname][username] = now + EOSEGROUPCACHETIME;
-    Mutex.UnLock();
-  } else {
-    Mutex.Lock();
-
-    if (Map.count(egroupname) && Map[egroupname].count(username)) {
-      isMember = Map[egroupname][username];
-    } else {
-      isMember = false;
-    }
-
-    Mutex.UnLock();
-
-    if (isMember) {
-      eos_static_warning("member=true user=\"%s\" e-group=\"%s\" "
-                         "cachetime=<stale-information",
-                         username.c_str(),
-                         egroupname.c_str());
-    } else {
-      eos_static_warning("member=false user=\"%s\" e-group=\"%s\" "
-                         "cachetime=<stale-information",
-                         username.c_str(),
-                         egroupname.c_str());
-    }
+  if (egroups.empty()) {
+    // we don't update, we have already fresh values
+    return;
   }
 
-  return;
+  eos_static_info("msg=\"async-lookup\" user=\"%s\" e-groups=%d",
+                  username.c_str(), (int) egroups.size());
+  std::set<std::string> members;
+  bool ok = lookup->Query(username, egroups, members);
+  std::lock_guard<std::mutex> lLock(Mutex);
+  Store(username, egroups, members, ok, false);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -462,15 +487,18 @@ Egroup::DumpMember(std::string& username, std::string& egroupname)
 {
   // trigger refresh
   Member(username, egroupname);
-  XrdSysMutexHelper lLock(Mutex);
+  std::lock_guard<std::mutex> lLock(Mutex);
   bool member = false;
   time_t timetolive = 0;
   time_t now = time(NULL);
+  auto uit = Map.find(username);
+
+  if (uit != Map.end()) {
+    auto git = uit->second.find(egroupname);
 
-  if (Map.count(egroupname)) {
-    if (Map[egroupname].count(username)) {
-      member = Map[egroupname][username];
-      timetolive = labs(LifeTime[egroupname][username] - now);
+    if (git != uit->second.end()) {
+      member = git->second.member;
+      timetolive = labs(git->second.expire - now);
     }
   }
 
@@ -503,28 +531,25 @@ Egroup::DumpMembers()
  */
 /*----------------------------------------------------------------------------*/
 {
-  XrdSysMutexHelper lLock(Mutex);
+  std::lock_guard<std::mutex> lLock(Mutex);
   time_t timetolive = 0;
   time_t now = time(NULL);
   std::string rs;
-  std::map < std::string, std::map <std::string, bool > >::iterator it;
-
-  for (it = Map.begin(); it != Map.end(); ++it) {
-    std::map <std::string, bool>::iterator uit;
 
-    for (uit = it->second.begin(); uit != it->second.end(); ++uit) {
+  for (auto uit = Map.begin(); uit != Map.end(); ++uit) {
+    for (auto git = uit->second.begin(); git != uit->second.end(); ++git) {
       rs += "egroup=";
-      rs += it->first;
+      rs += git->first;
       rs += " user=";
       rs += uit->first;
 
-      if (uit->second) {
+      if (git->second.member) {
         rs += " member=true";
       } else {
         rs += " member=false";
       }
 
-      timetolive = labs(LifeTime[it->first][uit->first] - now);
+      timetolive = labs(git->second.expire - now);
       rs += " lifetime=";
       rs += std::to_string((long long)timetolive);
       rs += "\n";
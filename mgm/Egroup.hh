@@ -31,8 +31,13 @@
 #include "XrdSys/XrdSysPthread.hh"
 /*----------------------------------------------------------------------------*/
 #include <sys/types.h>
-#include <string>
+#include <condition_variable>
 #include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
 #include <ldap.h>
 
 /*----------------------------------------------------------------------------*/
@@ -49,6 +54,47 @@
 EOSMGMNAMESPACE_BEGIN
 
 #define EOSEGROUPCACHETIME 1800
+#define EOSEGROUPREFRESHTIME 300
+#define EOSEGROUPRETRYTIME 60
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Interface resolving the egroup membership of a user
+ *
+ * The default implementation queries the CERN LDAP server, tests can install
+ * a stand-in with Egroup::SetLookup.
+ */
+/*----------------------------------------------------------------------------*/
+class EgroupLookup
+{
+public:
+  virtual ~EgroupLookup() {}
+
+  // ---------------------------------------------------------------------------
+  //! Resolve with a single query which of the egroups a user is member of
+  //!
+  //! @param username name of the user
+  //! @param egroups egroups to check
+  //! @param members returns the egroups the user is member of
+  //!
+  //! @return true if the query succeeded, otherwise false
+  // ---------------------------------------------------------------------------
+  virtual bool Query(const std::string& username,
+                     const std::set<std::string>& egroups,
+                     std::set<std::string>& members) = 0;
+};
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Egroup lookup doing recursive membership queries against LDAP
+ */
+/*----------------------------------------------------------------------------*/
+class LdapEgroupLookup : public EgroupLookup
+{
+public:
+  bool Query(const std::string& username, const std::set<std::string>& egroups,
+             std::set<std::string>& members);
+};
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -63,7 +109,12 @@ EOSMGMNAMESPACE_BEGIN
  * The problem here is that the calling function in the MGM
  * has a read lock durign the Egroup::Member call and the
  * refreshing of Egroup permissions should be done if possible asynchronous to 
- * avoid mutex starvation.
+ * avoid mutex starvation.\n\n
+ * Once an egroup/username pair is known, Member never blocks: entries
+ * getting close to their expiry are queued and refreshed by the thread with
+ * one query per user covering all of the user's egroups. Only the first
+ * lookup of a pair queries synchronously and concurrent first lookups of the
+ * same pair wait for a single query.
  */
 /*----------------------------------------------------------------------------*/
 class Egroup
@@ -72,27 +123,56 @@ private:
   /// thread id of the async refresh thread
   pthread_t mThread;
 
+  /// set to terminate the async refresh thread
+  bool mStop;
+
   // ---------------------------------------------------------------------------
-  // Synchronous refresh function doing an LDAP query for a given Egroup/user
+  // Synchronous refresh function doing one LDAP query for all the egroups of
+  // a user which are due
   // ---------------------------------------------------------------------------
-  void DoRefresh (std::string &egroupname, std::string &username);
+  void DoRefresh (const std::string &username);
+
+  // ---------------------------------------------------------------------------
+  // Store the result of a query, has to be called with Mutex locked
+  // ---------------------------------------------------------------------------
+  static void Store (const std::string &username,
+                     const std::set<std::string> &egroups,
+                     const std::set<std::string> &members,
+                     bool ok, bool create);
 
 public:
-  /// static queue with pairs of egroup/username 
-  static std::deque <std::pair<std::string, std::string > > LdapQueue;
+  /// cached membership of a user in an egroup
+  struct Entry {
+    bool member; ///< user is member of the egroup
+    time_t refresh; ///< time after which the entry is refreshed
+    time_t expire; ///< time after which the entry is stale
+  };
 
-  /// static mutex protecting static Egroup objects
-  static XrdSysMutex Mutex;
+  /// static queue with usernames to refresh
+  static std::deque <std::string> LdapQueue;
+
+  /// static set of the usernames in LdapQueue
+  static std::set <std::string> Queued;
 
-  /// static map indicating egroup memebership for egroup/username pairs
-  static std::map < std::string, std::map <std::string, bool > > Map;
+  /// static map of egroups currently resolved synchronously per username
+  static std::map < std::string, std::set <std::string > > InFlight;
 
-  /// static map storing the validity of egroup/username pairs in Map
-  static std::map < std::string, std::map <std::string, time_t > > LifeTime;
+  /// static mutex protecting static Egroup objects
+  static std::mutex Mutex;
+
+  /// static map indicating egroup membership for username/egroup pairs
+  static std::map < std::string, std::map <std::string, Entry > > Map;
 
   /// static condition variable to notify the asynchronous update thread about
   /// a new egroup request
-  static XrdSysCondVar mCond;
+  static std::condition_variable mCond;
+
+  /// static condition variable to notify waiters about a finished synchronous
+  /// query
+  static std::condition_variable mResolved;
+
+  /// static lookup used to resolve memberships
+  static std::shared_ptr<EgroupLookup> Lookup;
 
   // ---------------------------------------------------------------------------
   // Constructor
@@ -110,9 +190,17 @@ public:
   // ---------------------------------------------------------------------------
   static void Reset ()
   {
-    XrdSysMutexHelper mLock(Mutex);
+    std::lock_guard<std::mutex> mLock(Mutex);
     Map.clear();
-    LifeTime.clear();
+  }
+
+  // ---------------------------------------------------------------------------
+  //! Replace the lookup used to resolve memberships
+  // ---------------------------------------------------------------------------
+  static void SetLookup (std::shared_ptr<EgroupLookup> lookup)
+  {
+    std::lock_guard<std::mutex> mLock(Mutex);
+    Lookup = lookup;
   }
 
   // ---------------------------------------------------------------------------
@@ -141,9 +229,10 @@ public:
   static std::string DumpMembers ();
 
   // ---------------------------------------------------------------------------
-  // static function to schedule an asynchronous refresh for egroup/username
+  // static function to schedule an asynchronous refresh for username, has to
+  // be called with Mutex locked
   // ---------------------------------------------------------------------------
-  static void AsyncRefresh (std::string &egroupname, std::string &username);
+  static void AsyncRefresh (const std::string &username);
 
   // ---------------------------------------------------------------------------
   // asynchronous thread loop doing egroup/username fetching
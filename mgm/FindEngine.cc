@@ -0,0 +1,553 @@
+//------------------------------------------------------------------------------
+// File: FindEngine.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/FindEngine.hh"
+#include "mgm/XrdMgmOfs.hh"
+#include "mgm/Access.hh"
+#include "common/LayoutId.hh"
+#include "common/Logging.hh"
+#include "common/Path.hh"
+#include "common/RWMutex.hh"
+#include "namespace/interface/IView.hh"
+#include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdOuc/XrdOucString.hh"
+#include <stdlib.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+std::atomic<size_t> FindEngine::sWorkers(0);
+
+//------------------------------------------------------------------------------
+// Get the user limits of a find
+//------------------------------------------------------------------------------
+bool
+FindEngine::GetUserLimits(const eos::common::Mapping::VirtualIdentity& vid,
+                          unsigned long long& maxfiles,
+                          unsigned long long& maxdirs)
+{
+  // users cannot return more than 100k files and 50k dirs with one find,
+  // unless there is an access rule allowing deeper queries
+  maxfiles = 100000;
+  maxdirs = 50000;
+
+  if ((vid.uid == 0) || eos::common::Mapping::HasUid(3, vid.uid_list) ||
+      eos::common::Mapping::HasGid(4, vid.gid_list) || vid.sudoer) {
+    return false;
+  }
+
+  eos::common::RWMutexReadLock lock(Access::gAccessMutex);
+
+  if (Access::gStallUserGroup) {
+    const char* what[] = { "FindFiles", "FindDirs" };
+    unsigned long long* limit[] = { &maxfiles, &maxdirs };
+
+    for (size_t i = 0; i < 2; i++) {
+      std::string rules[] = {
+        std::string("rate:user:") + vid.uid_string + ":" + what[i],
+        std::string("rate:group:") + vid.gid_string + ":" + what[i],
+        std::string("rate:user:*:") + what[i]
+      };
+
+      for (size_t r = 0; r < 3; r++) {
+        auto it = Access::gStallRules.find(rules[r]);
+
+        if (it != Access::gStallRules.end()) {
+          *limit[i] = strtoull(it->second.c_str(), 0, 10);
+          break;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+FindEngine::FindEngine(const std::string& path, const Options& options,
+                       const eos::common::Mapping::VirtualIdentity& vid):
+  mPath(path), mOptions(options), mVid(vid), mMaxFiles(0), mMaxDirs(0),
+  mFilesFound(0), mDirsFound(0), mLimited(false), mPending(0), mRunning(0),
+  mStop(false)
+{
+  mLimitResult = GetUserLimits(mVid, mMaxFiles, mMaxDirs);
+
+  if (!mOptions.mChunkSize) {
+    mOptions.mChunkSize = 1;
+  }
+
+  if (!mOptions.mMaxChunks) {
+    mOptions.mMaxChunks = 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+FindEngine::~FindEngine()
+{
+  Stop();
+}
+
+//------------------------------------------------------------------------------
+// Start the workers
+//------------------------------------------------------------------------------
+void
+FindEngine::Start()
+{
+  std::string dpath = mPath;
+
+  if (dpath.empty() || (dpath[dpath.length() - 1] != '/')) {
+    dpath += "/";
+  }
+
+  bool isdir = false;
+  {
+    eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+    try {
+      (void) gOFS->eosView->getContainer(dpath.c_str(), false);
+      isdir = true;
+    } catch (eos::MDException& e) {
+      if (!mOptions.mNoFiles) {
+        // maybe this was a find by file
+        try {
+          (void) gOFS->eosView->getFile(mPath.c_str(), false);
+          eos::common::Path cPath(mPath.c_str());
+          Chunk chunk(1);
+          chunk[0].mPath = cPath.GetParentPath();
+          chunk[0].mFiles.push_back(cPath.GetName());
+          std::lock_guard<std::mutex> lock(mMutex);
+          mOut.push_back(std::move(chunk));
+        } catch (eos::MDException& e) {
+          eos_static_debug("msg=\"find path does not exist\" path=\"%s\"",
+                           mPath.c_str());
+        }
+      }
+    }
+  }
+
+  if (!isdir) {
+    return;
+  }
+
+  // take the workers from the global budget, but always at least one
+  size_t nthreads = mOptions.mThreads ? mOptions.mThreads : 1;
+  size_t running = sWorkers.load();
+
+  do {
+    size_t available = (running < sMaxWorkers) ? (sMaxWorkers - running) : 0;
+
+    if (nthreads > available) {
+      nthreads = available ? available : 1;
+    }
+  } while (!sWorkers.compare_exchange_weak(running, running + nthreads));
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  Work start;
+  start.mPath = dpath;
+  start.mDepth = 0;
+  start.mMatch = true;
+  mWork.push_back(start);
+  mPending = 1;
+  mRunning = nthreads;
+
+  for (size_t i = 0; i < nthreads; i++) {
+    mThreads.push_back(std::thread(&FindEngine::Worker, this));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get the next chunk of results
+//------------------------------------------------------------------------------
+bool
+FindEngine::Next(Chunk& chunk)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mOutCond.wait(lock, [this] {
+    return mStop || !mOut.empty() || !mRunning;
+  });
+
+  if (mStop || mOut.empty()) {
+    return false;
+  }
+
+  chunk.swap(mOut.front());
+  mOut.pop_front();
+  mSpaceCond.notify_one();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Abort the find
+//------------------------------------------------------------------------------
+void
+FindEngine::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+    mWorkCond.notify_all();
+    mOutCond.notify_all();
+    mSpaceCond.notify_all();
+  }
+
+  for (auto it = mThreads.begin(); it != mThreads.end(); ++it) {
+    if (it->joinable()) {
+      it->join();
+    }
+  }
+
+  mThreads.clear();
+}
+
+//------------------------------------------------------------------------------
+// Errors and warnings of the find
+//------------------------------------------------------------------------------
+std::string
+FindEngine::GetStdErr()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStdErr;
+}
+
+//------------------------------------------------------------------------------
+// Worker thread
+//------------------------------------------------------------------------------
+void
+FindEngine::Worker()
+{
+  eos::common::Mapping::VirtualIdentity vid = mVid;
+  Chunk out;
+  size_t nout = 0;
+  std::vector<Work> subdirs;
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  while (true) {
+    while (!mStop && mWork.empty() && mPending) {
+      if (nout) {
+        // hand out what we have before waiting for the other workers
+        Push(lock, out, nout);
+        continue;
+      }
+
+      mWorkCond.wait(lock);
+    }
+
+    if (mStop || !mPending) {
+      break;
+    }
+
+    // depth first keeps the number of queued directories small
+    Work work = std::move(mWork.back());
+    mWork.pop_back();
+    lock.unlock();
+
+    if (!mLimited) {
+      ProcessDir(work, vid, out, nout, subdirs);
+    } else if (work.mMatch) {
+      // found before the limit was hit, reported but not listed anymore
+      Dir dir;
+      dir.mPath = std::move(work.mPath);
+      out.push_back(std::move(dir));
+      nout++;
+    }
+
+    lock.lock();
+
+    if (!subdirs.empty()) {
+      for (auto it = subdirs.begin(); it != subdirs.end(); ++it) {
+        mWork.push_back(std::move(*it));
+      }
+
+      mPending += subdirs.size();
+      mWorkCond.notify_all();
+    }
+
+    subdirs.clear();
+
+    if (!--mPending) {
+      mWorkCond.notify_all();
+    }
+
+    if (nout >= mOptions.mChunkSize) {
+      Push(lock, out, nout);
+    }
+  }
+
+  if (nout) {
+    Push(lock, out, nout);
+  }
+
+  sWorkers--;
+
+  if (!--mRunning) {
+    mOutCond.notify_all();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Hand the results of a worker to the caller
+//------------------------------------------------------------------------------
+void
+FindEngine::Push(std::unique_lock<std::mutex>& lock, Chunk& out, size_t& nout)
+{
+  mSpaceCond.wait(lock, [this] {
+    return mStop || (mOut.size() < mOptions.mMaxChunks);
+  });
+
+  if (!mStop) {
+    mOut.push_back(std::move(out));
+    mOutCond.notify_one();
+  }
+
+  out.clear();
+  nout = 0;
+}
+
+//------------------------------------------------------------------------------
+// Take one from a user limit
+//------------------------------------------------------------------------------
+bool
+FindEngine::Reserve(std::atomic<unsigned long long>& found,
+                    unsigned long long limit)
+{
+  if (!mLimitResult) {
+    return true;
+  }
+
+  unsigned long long current = found.load();
+
+  do {
+    if (current >= limit) {
+      return false;
+    }
+  } while (!found.compare_exchange_weak(current, current + 1));
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Record that the user limit was hit
+//------------------------------------------------------------------------------
+void
+FindEngine::Limit(const char* what, unsigned long long limit)
+{
+  if (mLimited.exchange(true)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mStdErr += "warning: find results are limited for you to ";
+  mStdErr += what;
+  mStdErr += "=";
+  mStdErr += std::to_string(limit);
+  mStdErr += " -  result is truncated!\n";
+}
+
+//------------------------------------------------------------------------------
+// Select a directory by its attributes
+//------------------------------------------------------------------------------
+bool
+FindEngine::MatchAttributes(const std::string& path,
+                            eos::common::Mapping::VirtualIdentity& vid,
+                            bool& descend)
+{
+  XrdOucErrInfo error;
+  const std::string& key = mOptions.mAttrKey;
+
+  if (key.find('*') != std::string::npos) {
+    // this is a search for 'beginswith' match, all directories are listed
+    eos::IContainerMD::XAttrMap attrmap;
+    descend = true;
+
+    if (!gOFS->_attr_ls(path.c_str(), error, vid, (const char*) 0, attrmap,
+                        false)) {
+      for (auto it = attrmap.begin(); it != attrmap.end(); ++it) {
+        XrdOucString akey = it->first.c_str();
+
+        if (akey.matches(key.c_str())) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  // this is a search for a full match, only directories having the key are
+  // listed
+  XrdOucString attr = "";
+
+  if (gOFS->_attr_get(path.c_str(), error, vid, (const char*) 0, key.c_str(),
+                      attr, true)) {
+    descend = false;
+    return false;
+  }
+
+  descend = true;
+  return ((mOptions.mAttrVal == "*") || (mOptions.mAttrVal == attr.c_str()));
+}
+
+//------------------------------------------------------------------------------
+// List a directory
+//------------------------------------------------------------------------------
+void
+FindEngine::ProcessDir(const Work& work,
+                       eos::common::Mapping::VirtualIdentity& vid,
+                       Chunk& out, size_t& nout, std::vector<Work>& subdirs)
+{
+  Dir dir;
+  dir.mPath = work.mPath;
+  XrdOucErrInfo error;
+  std::shared_ptr<eos::IContainerMD> cmd;
+  bool permok = false;
+  eos::common::RWMutexReadLock ns_lock(gOFS->eosViewRWMutex);
+
+  try {
+    cmd = gOFS->eosView->getContainer(work.mPath.c_str(), false);
+    permok = cmd->access(vid.uid, vid.gid, R_OK | X_OK);
+  } catch (eos::MDException& e) {
+    cmd.reset();
+    eos_static_debug("msg=\"exception\" ec=%d emsg=\"%s\"", e.getErrno(),
+                     e.getMessage().str().c_str());
+  }
+
+  if (cmd && !permok) {
+    // check-out for ACLs
+    permok = gOFS->_access(work.mPath.c_str(), R_OK | X_OK, error, vid, "") ?
+             false : true;
+
+    if (!permok) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStdErr += "error: no permissions to read directory ";
+      mStdErr += work.mPath;
+      mStdErr += "\n";
+    }
+  }
+
+  if (cmd && permok) {
+    bool list_children = (!mOptions.mMaxDepth) ||
+                         (work.mDepth + 1 < mOptions.mMaxDepth);
+    std::set<std::string> dnames = cmd->getNameContainers();
+
+    for (auto dit = dnames.begin(); dit != dnames.end(); ++dit) {
+      Work sub;
+      sub.mPath = work.mPath;
+      sub.mPath += *dit;
+      sub.mPath += "/";
+      sub.mDepth = work.mDepth + 1;
+      bool descend = true;
+
+      if (mOptions.mAttrKey.length()) {
+        sub.mMatch = MatchAttributes(sub.mPath, vid, descend);
+      } else {
+        if (!Reserve(mDirsFound, mMaxDirs)) {
+          Limit("ndirs", mMaxDirs);
+          break;
+        }
+
+        sub.mMatch = true;
+      }
+
+      if (!descend) {
+        continue;
+      }
+
+      if (list_children) {
+        subdirs.push_back(std::move(sub));
+      } else if (sub.mMatch) {
+        // too deep to be listed, only the directory itself is reported
+        Dir leaf;
+        leaf.mPath = std::move(sub.mPath);
+        out.push_back(std::move(leaf));
+        nout++;
+      }
+    }
+
+    if (!mOptions.mNoFiles) {
+      std::string link;
+      std::set<std::string> fnames = cmd->getNameFiles();
+
+      for (auto fit = fnames.begin(); fit != fnames.end(); ++fit) {
+        std::shared_ptr<eos::IFileMD> fmd = cmd->findFile(*fit);
+
+        if (!fmd) {
+          continue;
+        }
+
+        if (mOptions.mFileMatch.length()) {
+          XrdOucString name = fit->c_str();
+
+          if (!name.matches(mOptions.mFileMatch.c_str())) {
+            continue;
+          }
+        }
+
+        uint64_t size = fmd->getSize();
+
+        if ((size < mOptions.mMinSize) ||
+            (mOptions.mMaxSize && (size > mOptions.mMaxSize))) {
+          continue;
+        }
+
+        if (mOptions.mMinMTime || mOptions.mMaxMTime) {
+          eos::IFileMD::ctime_t mtime;
+          fmd->getMTime(mtime);
+
+          if ((mOptions.mMinMTime && (mtime.tv_sec < mOptions.mMinMTime)) ||
+              (mOptions.mMaxMTime && (mtime.tv_sec > mOptions.mMaxMTime))) {
+            continue;
+          }
+        }
+
+        if ((mOptions.mLayoutType >= 0) &&
+            ((int) eos::common::LayoutId::GetLayoutType(fmd->getLayoutId()) !=
+             mOptions.mLayoutType)) {
+          continue;
+        }
+
+        if (!Reserve(mFilesFound, mMaxFiles)) {
+          Limit("nfiles", mMaxFiles);
+          break;
+        }
+
+        if (fmd->isLink() && mOptions.mFileMatch.empty()) {
+          link = *fit;
+          link += " -> ";
+          link += fmd->getLink();
+          dir.mFiles.push_back(link);
+        } else {
+          dir.mFiles.push_back(*fit);
+        }
+      }
+    }
+  }
+
+  if (work.mMatch || !dir.mFiles.empty()) {
+    nout += 1 + dir.mFiles.size();
+    out.push_back(std::move(dir));
+  }
+}
+
+EOSMGMNAMESPACE_END
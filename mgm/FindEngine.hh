@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------------
+// File: FindEngine.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_FINDENGINE__HH__
+#define __EOSMGM_FINDENGINE__HH__
+
+#include "mgm/Namespace.hh"
+#include "common/Mapping.hh"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Namespace find walking subtrees in parallel and streaming results.
+//!
+//! Worker threads take directories from a shared stack, list them under the
+//! namespace read lock and apply the filters while listing. The results are
+//! handed to the caller in chunks through a bounded queue, so the workers
+//! wait when the caller doesn't keep up and the memory used by a find does
+//! not depend on the size of the subtree. A directory and its selected files
+//! are always returned in the same chunk.
+//!
+//! The semantics of the filters and of the user limits are the ones of
+//! XrdMgmOfs::_find. The order of the directories in the result is not
+//! defined.
+//------------------------------------------------------------------------------
+class FindEngine
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Selection and tuning of a find
+  //----------------------------------------------------------------------------
+  struct Options {
+    bool mNoFiles; ///< Only list directories
+    int mMaxDepth; ///< Maximum depth below the start directory, 0 unlimited
+    std::string mFileMatch; ///< Wildcard match of the file names
+    std::string mAttrKey; ///< Directory attribute key, '*' ends a prefix
+    std::string mAttrVal; ///< Directory attribute value, '*' for any
+    unsigned long long mMinSize; ///< Minimum file size
+    unsigned long long mMaxSize; ///< Maximum file size, 0 unlimited
+    time_t mMinMTime; ///< Files modified before are skipped, 0 no limit
+    time_t mMaxMTime; ///< Files modified after are skipped, 0 no limit
+    int mLayoutType; ///< Layout type of the files, -1 for any
+    size_t mThreads; ///< Number of parallel workers
+    size_t mChunkSize; ///< Number of entries per chunk
+    size_t mMaxChunks; ///< Number of chunks queued before workers wait
+
+    Options():
+      mNoFiles(false), mMaxDepth(0), mMinSize(0), mMaxSize(0), mMinMTime(0),
+      mMaxMTime(0), mLayoutType(-1), mThreads(4), mChunkSize(1024),
+      mMaxChunks(16) {}
+  };
+
+  //----------------------------------------------------------------------------
+  //! A directory found with its selected files, like an entry of the map
+  //! filled by XrdMgmOfs::_find
+  //----------------------------------------------------------------------------
+  struct Dir {
+    std::string mPath; ///< Directory path ending with '/'
+    std::vector<std::string> mFiles; ///< Selected file names
+  };
+
+  typedef std::vector<Dir> Chunk;
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param path directory to search or single file
+  //! @param options selection of the find
+  //! @param vid virtual identity of the client
+  //----------------------------------------------------------------------------
+  FindEngine(const std::string& path, const Options& options,
+             const eos::common::Mapping::VirtualIdentity& vid);
+
+  //----------------------------------------------------------------------------
+  //! Destructor, stops the workers
+  //----------------------------------------------------------------------------
+  ~FindEngine();
+
+  //----------------------------------------------------------------------------
+  //! Start the workers
+  //----------------------------------------------------------------------------
+  void Start();
+
+  //----------------------------------------------------------------------------
+  //! Get the next chunk of results, waiting for the workers if needed
+  //!
+  //! @param chunk filled with the next results
+  //!
+  //! @return false once the find is complete
+  //----------------------------------------------------------------------------
+  bool Next(Chunk& chunk);
+
+  //----------------------------------------------------------------------------
+  //! Abort the find, Next returns false afterwards
+  //----------------------------------------------------------------------------
+  void Stop();
+
+  //----------------------------------------------------------------------------
+  //! Errors and warnings of the find, complete once Next returned false
+  //----------------------------------------------------------------------------
+  std::string GetStdErr();
+
+  //----------------------------------------------------------------------------
+  //! Get the maximum number of files and directories a client can find in
+  //! one query, as defined by the rate:<user|group>:<name>:Find<Files|Dirs>
+  //! access rules
+  //!
+  //! @param vid virtual identity of the client
+  //! @param maxfiles maximum number of files
+  //! @param maxdirs maximum number of directories
+  //!
+  //! @return true if the client is limited, false for root, admins and
+  //!         sudoers
+  //----------------------------------------------------------------------------
+  static bool GetUserLimits(const eos::common::Mapping::VirtualIdentity& vid,
+                            unsigned long long& maxfiles,
+                            unsigned long long& maxdirs);
+
+private:
+  //! A directory to list
+  struct Work {
+    std::string mPath; ///< Directory path ending with '/'
+    int mDepth; ///< Depth below the start directory
+    bool mMatch; ///< Directory is part of the result
+  };
+
+  //! Worker thread
+  void Worker();
+
+  //----------------------------------------------------------------------------
+  //! List a directory
+  //!
+  //! @param work directory to list
+  //! @param vid virtual identity of the client
+  //! @param out results of the worker
+  //! @param nout number of entries in out
+  //! @param subdirs filled with the directories to descend into
+  //----------------------------------------------------------------------------
+  void ProcessDir(const Work& work, eos::common::Mapping::VirtualIdentity& vid,
+                  Chunk& out, size_t& nout, std::vector<Work>& subdirs);
+
+  //----------------------------------------------------------------------------
+  //! Select a directory by its attributes, must hold the namespace lock
+  //!
+  //! @param path directory path
+  //! @param vid virtual identity of the client
+  //! @param descend set if the directory has to be listed
+  //!
+  //! @return true if the directory is part of the result
+  //----------------------------------------------------------------------------
+  bool MatchAttributes(const std::string& path,
+                       eos::common::Mapping::VirtualIdentity& vid,
+                       bool& descend);
+
+  //! Take one from a user limit, false if it is exhausted
+  bool Reserve(std::atomic<unsigned long long>& found,
+               unsigned long long limit);
+
+  //! Hand the results of a worker to the caller, waits for space
+  void Push(std::unique_lock<std::mutex>& lock, Chunk& out, size_t& nout);
+
+  //! Record that the user limit was hit
+  void Limit(const char* what, unsigned long long limit);
+
+  std::string mPath;
+  Options mOptions;
+  eos::common::Mapping::VirtualIdentity mVid;
+  bool mLimitResult; ///< Apply the user limits
+  unsigned long long mMaxFiles;
+  unsigned long long mMaxDirs;
+  std::atomic<unsigned long long> mFilesFound; ///< Counted for the limit
+  std::atomic<unsigned long long> mDirsFound; ///< Counted for the limit
+  std::atomic<bool> mLimited; ///< A user limit was hit
+
+  std::mutex mMutex; ///< Protecting all the members below
+  std::condition_variable mWorkCond; ///< Work or completion available
+  std::condition_variable mOutCond; ///< Results or completion available
+  std::condition_variable mSpaceCond; ///< Space in the result queue
+  std::vector<Work> mWork; ///< Directories to list, used as a stack
+  size_t mPending; ///< Directories queued or being listed
+  std::deque<Chunk> mOut; ///< Results not yet taken by the caller
+  size_t mRunning; ///< Running workers
+  bool mStop;
+  std::string mStdErr;
+  std::vector<std::thread> mThreads;
+
+  //! Workers running for all the finds, bounding the load of the MGM
+  static std::atomic<size_t> sWorkers;
+  static const size_t sMaxWorkers = 32;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -504,6 +504,16 @@ public:
         SetConfigMember("drainer.node.ntx", "2", true, "/eos/*/mgm");
       }
 
+      // Set parallel draining streams per filesystem
+      if (GetConfigMember("drainer.fs.ntx") == "") {
+        SetConfigMember("drainer.fs.ntx", "5", true, "/eos/*/mgm");
+      }
+
+      // Schedule the drain transfers in the MGM
+      if (GetConfigMember("drainer.central") == "") {
+        SetConfigMember("drainer.central", "on", true, "/eos/*/mgm");
+      }
+
       // Set the grace period before drain start on opserror to 1 day
       if (GetConfigMember("graceperiod") == "") {
         SetConfigMember("graceperiod", "86400", true, "/eos/*/mgm");
@@ -36,13 +36,21 @@ EOSMGMNAMESPACE_BEGIN
 
 const char* Fsck::gFsckEnabled = "fsck";
 const char* Fsck::gFsckInterval = "fsckinterval";
+const char* Fsck::sDerivedErrors[] = {
+  "rep_offline", "zero_replica", "file_offline", "adjust_replica", 0
+};
+
+//! Maximum number of filesystems asked for a full report by id, above all the
+//! FSTs are asked for one
+static const size_t sMaxResync = 1024;
 
 
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
 Fsck::Fsck():
-  mEnabled(false), mInterval(30), mThread(0), mRunning(false), eTimeStamp(0)
+  mEnabled(false), mInterval(30), mThread(0), mRunning(false), eTimeStamp(0),
+  mSeq(0), mAckSeq(0)
 {}
 
 //------------------------------------------------------------------------------
@@ -170,6 +178,8 @@ Fsck::Check(void)
   XrdSysTimer sleeper;
   int bccount = 0;
   ClearLog();
+  // Start from full reports of all the FSTs
+  ResetErrorMaps();
   bool go = false;
 
   do {
@@ -219,6 +229,34 @@ Fsck::Check(void)
     XrdOucString broadcasttargetqueue = gOFS->MgmDefaultReceiverQueue;
     XrdOucString msgbody;
     msgbody = "mgm.cmd=fsck&mgm.fsck.tags=*";
+    {
+      // Ask for the changes since the last collection, and for a full report
+      // from the filesystems whose last report could not be applied
+      XrdSysMutexHelper lock(eMutex);
+
+      if (eResync.size() > sMaxResync) {
+        mAckSeq = 0;
+      }
+
+      char seqs[256];
+      snprintf(seqs, sizeof(seqs) - 1, "&mgm.fsck.seq=%llu&mgm.fsck.ack=%llu",
+               ++mSeq, mAckSeq);
+      msgbody += seqs;
+
+      if (mAckSeq && !eResync.empty()) {
+        msgbody += "&mgm.fsck.resync=";
+
+        for (auto it = eResync.cbegin(); it != eResync.cend(); ++it) {
+          if (it != eResync.cbegin()) {
+            msgbody += ",";
+          }
+
+          msgbody += (int) *it;
+        }
+      }
+
+      eResync.clear();
+    }
     XrdOucString stdOut = "";
     XrdOucString stdErr = "";
 
@@ -229,35 +267,8 @@ Fsck::Check(void)
       stdErr = "error: broadcast failed\n";
     }
 
-    ResetErrorMaps();
-    std::vector<std::string> lines;
-    // Convert into a lines-wise seperated array
-    eos::common::StringConversion::StringToLineVector((char*) stdOut.c_str(),
-        lines);
-
-    for (size_t nlines = 0; nlines < lines.size(); nlines++) {
-      std::set<unsigned long long> fids;
-      unsigned long fsid = 0;
-      std::string errortag;
-
-      if (eos::common::StringConversion::ParseStringIdSet((char*)
-          lines[nlines].c_str(), errortag, fsid, fids)) {
-        std::set<unsigned long long>::const_iterator it;
-
-        if (fsid) {
-          XrdSysMutexHelper lock(eMutex);
-
-          // Add the fids into the error maps
-          for (auto it = fids.cbegin(); it != fids.cend(); ++it) {
-            eFsMap[errortag][fsid].insert(*it);
-            eMap[errortag].insert(*it);
-            eCount[errortag]++;
-          }
-        }
-      } else {
-        eos_static_err("Can not parse fsck response: %s", lines[nlines].c_str());
-      }
-    }
+    ResetDerivedErrors();
+    ApplyReports(stdOut);
 
     {
       // Grab all files which are damaged because filesystems are down
@@ -1434,9 +1445,286 @@ Fsck::ResetErrorMaps()
   eFsMap.clear();
   eMap.clear();
   eCount.clear();
+  eFsUnavail.clear();
+  eFsDark.clear();
+  eFidRefs.clear();
+  eFsSeq.clear();
+  eResync.clear();
+  mAckSeq = 0;
+  eTimeStamp = time(NULL);
+}
+
+//------------------------------------------------------------------------------
+// Reset the errors derived by the MGM
+//------------------------------------------------------------------------------
+void
+Fsck::ResetDerivedErrors()
+{
+  XrdSysMutexHelper lock(eMutex);
+
+  for (size_t i = 0; sDerivedErrors[i]; i++) {
+    eFsMap.erase(sDerivedErrors[i]);
+    eMap.erase(sDerivedErrors[i]);
+    eCount.erase(sDerivedErrors[i]);
+  }
+
   eFsUnavail.clear();
   eFsDark.clear();
   eTimeStamp = time(NULL);
 }
 
+//------------------------------------------------------------------------------
+// Add an error reported by a filesystem
+//------------------------------------------------------------------------------
+void
+Fsck::AddError(const std::string& tag, eos::common::FileSystem::fsid_t fsid,
+               eos::common::FileId::fileid_t fid)
+{
+  if (eFsMap[tag][fsid].insert(fid).second) {
+    eCount[tag]++;
+
+    if (!eFidRefs[tag][fid]++) {
+      eMap[tag].insert(fid);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove an error reported by a filesystem
+//------------------------------------------------------------------------------
+void
+Fsck::RemoveError(const std::string& tag, eos::common::FileSystem::fsid_t fsid,
+                  eos::common::FileId::fileid_t fid)
+{
+  auto fsmapit = eFsMap.find(tag);
+
+  if (fsmapit == eFsMap.end()) {
+    return;
+  }
+
+  auto fsit = fsmapit->second.find(fsid);
+
+  if ((fsit == fsmapit->second.end()) || !fsit->second.erase(fid)) {
+    return;
+  }
+
+  if (fsit->second.empty()) {
+    fsmapit->second.erase(fsit);
+  }
+
+  if (!--eCount[tag]) {
+    eCount.erase(tag);
+  }
+
+  auto& refs = eFidRefs[tag];
+  auto refit = refs.find(fid);
+
+  if ((refit != refs.end()) && !--refit->second) {
+    refs.erase(refit);
+    eMap[tag].erase(fid);
+
+    if (refs.empty()) {
+      eFidRefs.erase(tag);
+      eMap.erase(tag);
+      eFsMap.erase(fsmapit);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Remove all the errors reported by a filesystem
+//------------------------------------------------------------------------------
+void
+Fsck::DropFsErrors(eos::common::FileSystem::fsid_t fsid)
+{
+  std::vector<std::string> tags;
+
+  for (auto it = eFidRefs.cbegin(); it != eFidRefs.cend(); ++it) {
+    tags.push_back(it->first);
+  }
+
+  for (auto tag = tags.cbegin(); tag != tags.cend(); ++tag) {
+    auto fsmapit = eFsMap.find(*tag);
+
+    if (fsmapit == eFsMap.end()) {
+      continue;
+    }
+
+    auto fsit = fsmapit->second.find(fsid);
+
+    if (fsit == fsmapit->second.end()) {
+      continue;
+    }
+
+    std::set<eos::common::FileId::fileid_t> fids = fsit->second;
+
+    for (auto it = fids.cbegin(); it != fids.cend(); ++it) {
+      RemoveError(*tag, fsid, *it);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Apply the reports collected from the FSTs. The lines of a filesystem are
+// gathered first, as they may be spread over several reply messages, and only
+// applied if the report is complete and based on the state known here.
+// Otherwise the errors of the filesystem are kept as they are and a full
+// report is requested in the next collection. FSTs not supporting the
+// incremental reports send the full list of errors in the format
+// <tag>@<fsid>:<fid>:<fid>... on every collection.
+//------------------------------------------------------------------------------
+void
+Fsck::ApplyReports(XrdOucString& reports)
+{
+  struct FsReport {
+    bool mHeader; ///< Header line received
+    bool mLegacy; ///< Full report of an FST not sending increments
+    unsigned long long mBase; ///< Sequence number the report is based on
+    unsigned long long mSeq; ///< Sequence number of the report
+    unsigned long mLines; ///< Number of lines announced by the header
+    unsigned long mReceived; ///< Number of lines received
+    std::map<std::string, std::set<eos::common::FileId::fileid_t> > mAdded;
+    std::map<std::string, std::set<eos::common::FileId::fileid_t> > mRemoved;
+
+    FsReport():
+      mHeader(false), mLegacy(false), mBase(0), mSeq(0), mLines(0), mReceived(0)
+    {}
+  };
+  std::map<eos::common::FileSystem::fsid_t, FsReport> fsreports;
+  std::vector<std::string> lines;
+  // Convert into a lines-wise seperated array
+  eos::common::StringConversion::StringToLineVector((char*) reports.c_str(),
+      lines);
+
+  for (size_t nlines = 0; nlines < lines.size(); nlines++) {
+    std::string& line = lines[nlines];
+
+    if (line.empty()) {
+      continue;
+    }
+
+    if (line[0] == '#') {
+      unsigned long fsid = 0;
+      unsigned long long base = 0;
+      unsigned long long seq = 0;
+      unsigned long nfslines = 0;
+
+      if ((sscanf(line.c_str() + 1, "%lu:%llu:%llu:%lu", &fsid, &base, &seq,
+                  &nfslines) == 4) && fsid) {
+        FsReport& report = fsreports[fsid];
+        report.mHeader = true;
+        report.mBase = base;
+        report.mSeq = seq;
+        report.mLines = nfslines;
+      } else {
+        eos_static_err("Can not parse fsck response: %s", line.c_str());
+      }
+
+      continue;
+    }
+
+    size_t at = line.find('@');
+    size_t op = (at == std::string::npos) ? std::string::npos :
+                line.find_first_not_of("0123456789", at + 1);
+
+    if ((op != std::string::npos) && ((line[op] == '+') || (line[op] == '-'))) {
+      std::string errortag = line.substr(0, at);
+      unsigned long fsid = strtoul(line.c_str() + at + 1, 0, 10);
+      FsReport& report = fsreports[fsid];
+      std::set<eos::common::FileId::fileid_t>& fids = (line[op] == '+') ?
+          report.mAdded[errortag] : report.mRemoved[errortag];
+
+      if (fsid && eos::common::StringConversion::DecodeIdSet(line.c_str() + op + 1,
+          fids)) {
+        report.mReceived++;
+      } else {
+        eos_static_err("Can not parse fsck response: %s", line.c_str());
+      }
+
+      continue;
+    }
+
+    std::set<unsigned long long> fids;
+    unsigned long fsid = 0;
+    std::string errortag;
+
+    if (eos::common::StringConversion::ParseStringIdSet((char*) line.c_str(),
+        errortag, fsid, fids)) {
+      if (fsid) {
+        FsReport& report = fsreports[fsid];
+        report.mLegacy = true;
+        report.mAdded[errortag].insert(fids.begin(), fids.end());
+      }
+    } else {
+      eos_static_err("Can not parse fsck response: %s", line.c_str());
+    }
+  }
+
+  unsigned long long nadded = 0;
+  unsigned long long nremoved = 0;
+  size_t nfull = 0;
+  XrdSysMutexHelper lock(eMutex);
+
+  // Filesystems which did not report are not checked anymore
+  for (auto it = eFsSeq.begin(); it != eFsSeq.end();) {
+    if (!fsreports.count(it->first)) {
+      DropFsErrors(it->first);
+      it = eFsSeq.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (auto it = fsreports.begin(); it != fsreports.end(); ++it) {
+    eos::common::FileSystem::fsid_t fsid = it->first;
+    FsReport& report = it->second;
+
+    if (report.mLegacy) {
+      report.mBase = 0;
+    } else if (!report.mHeader || (report.mReceived != report.mLines)) {
+      eos_static_warning("msg=\"incomplete fsck report\" fsid=%lu lines=%lu/%lu",
+                         (unsigned long) fsid, report.mReceived, report.mLines);
+      eResync.insert(fsid);
+      continue;
+    } else if (report.mBase) {
+      auto seqit = eFsSeq.find(fsid);
+
+      if ((seqit == eFsSeq.end()) || (seqit->second != report.mBase)) {
+        eos_static_warning("msg=\"fsck report based on an unknown state\" "
+                           "fsid=%lu base=%llu", (unsigned long) fsid,
+                           report.mBase);
+        eResync.insert(fsid);
+        continue;
+      }
+    }
+
+    if (!report.mBase) {
+      DropFsErrors(fsid);
+      nfull++;
+    }
+
+    for (auto tit = report.mRemoved.cbegin(); tit != report.mRemoved.cend();
+         ++tit) {
+      for (auto fit = tit->second.cbegin(); fit != tit->second.cend(); ++fit) {
+        RemoveError(tit->first, fsid, *fit);
+        nremoved++;
+      }
+    }
+
+    for (auto tit = report.mAdded.cbegin(); tit != report.mAdded.cend(); ++tit) {
+      for (auto fit = tit->second.cbegin(); fit != tit->second.cend(); ++fit) {
+        AddError(tit->first, fsid, *fit);
+        nadded++;
+      }
+    }
+
+    eFsSeq[fsid] = report.mLegacy ? 0 : report.mSeq;
+  }
+
+  mAckSeq = mSeq;
+  Log(false, "Filesystems reported: %lu full: %lu resync: %lu added: %llu "
+      "removed: %llu", (unsigned long) fsreports.size(), (unsigned long) nfull,
+      (unsigned long) eResync.size(), nadded, nremoved);
+}
+
 EOSMGMNAMESPACE_END
@@ -47,7 +47,11 @@ EOSMGMNAMESPACE_BEGIN
 //! @brief Class implementing the EOS filesystem check.
 //!
 //! When the FSCK thread is enabled it collects in a regular interval the
-//! FSCK results broadcasted by all FST nodes into a central view.
+//! FSCK results broadcasted by all FST nodes into a central view. The FSTs
+//! only report the changes since the last report the MGM acknowledged, so the
+//! view of the errors found by the FSTs is updated incrementally. The errors
+//! derived from the namespace and the filesystem states are recomputed on
+//! every collection.
 //!
 //! The FSCK interface offers a 'report' and a 'repair' utility allowing to
 //! inspect and to actively try to run repair commands to fix inconsistencies.
@@ -161,11 +165,54 @@ private:
   //! in the filesystem view
   std::map<eos::common::FileSystem::fsid_t, unsigned long long > eFsDark;
   time_t eTimeStamp; ///< Timestamp of collection
+  //! Number of filesystems reporting a file "<error-name>=><fid>=>n", only
+  //! for the errors reported by the FSTs
+  std::map<std::string,
+      std::map<eos::common::FileId::fileid_t, unsigned int> > eFidRefs;
+  //! Sequence number of the last report applied per filesystem, 0 for FSTs
+  //! sending full reports only
+  std::map<eos::common::FileSystem::fsid_t, unsigned long long> eFsSeq;
+  //! Filesystems to ask a full report from in the next collection
+  std::set<eos::common::FileSystem::fsid_t> eResync;
+  unsigned long long mSeq; ///< Sequence number of the last collection
+  unsigned long long mAckSeq; ///< Sequence number acknowledged to the FSTs
+  //! Errors derived by the MGM, not reported by the FSTs
+  static const char* sDerivedErrors[];
 
   //----------------------------------------------------------------------------
   //! Reset all collected errors in the error map
   //----------------------------------------------------------------------------
   void ResetErrorMaps();
+
+  //----------------------------------------------------------------------------
+  //! Reset the errors derived by the MGM, keeping the ones reported by the
+  //! FSTs
+  //----------------------------------------------------------------------------
+  void ResetDerivedErrors();
+
+  //----------------------------------------------------------------------------
+  //! Apply the reports collected from the FSTs to the error maps
+  //!
+  //! @param reports fsck replies of the FSTs
+  //----------------------------------------------------------------------------
+  void ApplyReports(XrdOucString& reports);
+
+  //----------------------------------------------------------------------------
+  //! Add an error reported by a filesystem, must hold eMutex
+  //----------------------------------------------------------------------------
+  void AddError(const std::string& tag, eos::common::FileSystem::fsid_t fsid,
+                eos::common::FileId::fileid_t fid);
+
+  //----------------------------------------------------------------------------
+  //! Remove an error reported by a filesystem, must hold eMutex
+  //----------------------------------------------------------------------------
+  void RemoveError(const std::string& tag, eos::common::FileSystem::fsid_t fsid,
+                   eos::common::FileId::fileid_t fid);
+
+  //----------------------------------------------------------------------------
+  //! Remove all the errors reported by a filesystem, must hold eMutex
+  //----------------------------------------------------------------------------
+  void DropFsErrors(eos::common::FileSystem::fsid_t fsid);
 };
 
 EOSMGMNAMESPACE_END
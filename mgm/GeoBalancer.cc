@@ -32,6 +32,7 @@
 #include "XrdSys/XrdSysError.hh"
 #include "XrdOuc/XrdOucTrace.hh"
 #include "Xrd/XrdScheduler.hh"
+#include <algorithm>
 #include <random>
 #include <cmath>
 
@@ -206,6 +207,7 @@ GeoBalancer::populateGeotagsInfo()
 
   //std::set<eos::common::FileSystem::fsid_t>::const_iterator it;
   eos::mgm::BaseView::const_iterator it;
+  std::set<eos::common::FileSystem::fsid_t> fsids;
 
   for (it = spaceView->cbegin(); it != spaceView->cend(); it++) {
     FileSystem* fs = FsView::gFsView.mIdView[*it];
@@ -224,6 +226,7 @@ GeoBalancer::populateGeotagsInfo()
 
     mGeotagFs[snapshot.mGeoTag].push_back(*it);
     mFsGeotag[*it] = snapshot.mGeoTag;
+    fsids.insert(*it);
     uint64_t capacity = snapshot.mDiskCapacity;
     uint64_t usedBytes = (uint64_t)(capacity - snapshot.mDiskFreeBytes);
 
@@ -237,6 +240,8 @@ GeoBalancer::populateGeotagsInfo()
     }
   }
 
+  // forget the files sampled from filesystems which left the space
+  mCandidates.Retain(fsids);
   mAvgUsedSize = 0;
   std::map<std::string, std::vector<eos::common::FileSystem::fsid_t>>::const_iterator
       git;
@@ -288,12 +293,14 @@ GeoBalancer::fileIsInDifferentLocations(const eos::IFileMD* fmd)
 /*----------------------------------------------------------------------------*/
 std::string
 GeoBalancer::getFileProcTransferNameAndSize(eos::common::FileId::fileid_t fid,
+    eos::common::FileSystem::fsid_t fsid,
     uint64_t* size)
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Produces a file conversion path to be placed in the proc directory
  *        and also returns its size
  * @param fid the file ID
+ * @param fsid the filesystem the file was sampled from
  * @param size return address for the size of the file
  * @return the file path
  */
@@ -323,6 +330,14 @@ GeoBalancer::getFileProcTransferNameAndSize(eos::common::FileId::fileid_t fid,
         return std::string("");
       }
 
+      // the candidate may have been sampled minutes ago
+      if (!fmd->hasLocation(fsid)) {
+        eos_static_debug("msg=\"file no longer on the source filesystem\" "
+                         "fid=%llu fsid=%lu", (unsigned long long) fid,
+                         (unsigned long) fsid);
+        return std::string("");
+      }
+
       if (fileIsInDifferentLocations(fmd.get())) {
         eos_static_debug("filename=%s fid=%d is already in more than "
                          "one location", fmd->getName().c_str(), fileid);
@@ -369,33 +384,32 @@ GeoBalancer::updateTransferList()
 /*----------------------------------------------------------------------------*/
 {
   std::map<eos::common::FileId::fileid_t, std::string>::iterator it;
+  // check all the transfers under one lock
+  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
 
   for (it = mTransfers.begin(); it != mTransfers.end();) {
-    eos::common::Mapping::VirtualIdentity rootvid;
-    eos::common::Mapping::Root(rootvid);
-    XrdOucErrInfo error;
-    const std::string& fileName = (*it).second;
-    struct stat buf;
-
-    if (gOFS->_stat(fileName.c_str(), &buf, error, rootvid, "")) {
-      mTransfers.erase(it++);
-    } else {
+    try {
+      gOFS->eosView->getFile((*it).second);
       ++it;
+    } catch (eos::MDException& e) {
+      mTransfers.erase(it++);
     }
   }
 
-  eos_static_info("scheduledtransfers=%d", mTransfers.size());
+  eos_static_debug("scheduledtransfers=%d", mTransfers.size());
 }
 
 /*----------------------------------------------------------------------------*/
 bool
 GeoBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
+                              eos::common::FileSystem::fsid_t fsid,
                               const std::string& fromGeotag)
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Creates the conversion file in proc for the file ID, from the given
  *        fromGeotag (updates the cache structures)
  * @param fid the id of the file to be transferred
+ * @param fsid the filesystem of the fromGeotag holding the file
  * @param fromGeotag the geotag of the location where the file is located
  * @return whether the transfer file was successfully created or not
  */
@@ -405,7 +419,7 @@ GeoBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
   eos::common::Mapping::Root(rootvid);
   XrdOucErrInfo mError;
   uint64_t size = 0;
-  std::string fileName = getFileProcTransferNameAndSize(fid, &size);
+  std::string fileName = getFileProcTransferNameAndSize(fid, fsid, &size);
 
   if (fileName == "") {
     return false;
@@ -427,72 +441,59 @@ GeoBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
 
 /*----------------------------------------------------------------------------*/
 eos::common::FileId::fileid_t
-GeoBalancer::chooseFidFromGeotag(const std::string& geotag)
+GeoBalancer::chooseFidFromGeotag(const std::string& geotag, uint64_t maxSize,
+                                 eos::common::FileSystem::fsid_t& fsid)
 /*----------------------------------------------------------------------------*/
 /**
- * @brief Chooses a random file ID from a random filesystem in the given geotag
+ * @brief Chooses a file ID from a random filesystem in the given geotag, among
+ *        the files sampled from it
  * @param geotag the location's name from which the file id will be chosen
+ * @param maxSize the maximum size of the file
+ * @param fsid filled with the filesystem the file was chosen from
  * @return the chosen file ID
  */
 /*----------------------------------------------------------------------------*/
 {
   int rndIndex;
-  eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
-  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
-  eos::IFsView::FileList filelist;
   std::vector<eos::common::FileSystem::fsid_t>& validFs = mGeotagFs[geotag];
-  eos::common::FileSystem::fsid_t fsid;
 
   while (validFs.size() > 0) {
     rndIndex = getRandom(validFs.size() - 1);
-    fsid = validFs[rndIndex];
-    filelist = gOFS->eosFsView->getFileList(fsid);
+    uint64_t size = 0;
+    eos::common::FileId::fileid_t fid =
+      mCandidates.Take(validFs[rndIndex], maxSize, size);
 
-    if (filelist.size() > 0) {
-      break;
+    if (!fid) {
+      // nothing suitable on this filesystem until the next refresh
+      validFs.erase(validFs.begin() + rndIndex);
+      continue;
     }
 
-    validFs.erase(validFs.begin() + rndIndex);
-  }
-
-  if (validFs.size() == 0) {
-    mGeotagFs.erase(geotag);
-    mGeotagSizes.erase(geotag);
-    fillGeotagsByAvg();
-  }
-
-  if (filelist.size() == 0) {
-    return -1;
-  }
-
-  int attempts = 10;
-  eos::IFsView::FileIterator fid_it;
-
-  while (attempts-- > 0) {
-    rndIndex = getRandom(filelist.size() - 1);
-    fid_it = filelist.begin();
-    std::advance(fid_it, rndIndex);
-
-    if (mTransfers.count(*fid_it) == 0) {
-      return *fid_it;
+    if (mTransfers.count(fid) == 0) {
+      fsid = validFs[rndIndex];
+      return fid;
     }
   }
 
+  mGeotagFs.erase(geotag);
+  mGeotagSizes.erase(geotag);
+  fillGeotagsByAvg();
   return -1;
 }
 
 /*----------------------------------------------------------------------------*/
-void
+bool
 GeoBalancer::prepareTransfer()
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Picks a geotag randomly and schedule a file ID to be transferred
+ * @return whether a transfer was scheduled
  */
 /*----------------------------------------------------------------------------*/
 {
   if (mGeotagsOverAvg.size() == 0) {
     eos_static_debug("No geotags over the average!");
-    return;
+    return false;
   }
 
   int attempts = 10;
@@ -501,20 +502,34 @@ GeoBalancer::prepareTransfer()
     int rndIndex = getRandom(mGeotagsOverAvg.size() - 1);
     std::vector<std::string>::const_iterator over_it = mGeotagsOverAvg.cbegin();
     std::advance(over_it, rndIndex);
-    // TODO: this loop should be improved not to request the file list too
-    // many times in a tight loop
-    eos::common::FileId::fileid_t fid = chooseFidFromGeotag(*over_it);
+    // copy, the geotag may be dropped from the caches while choosing
+    std::string geotag = *over_it;
+    // don't move more than what brings the geotag back to the average
+    GeotagSize* geotagSize = mGeotagSizes[geotag];
+    double overBytes = (geotagSize->filled() - mAvgUsedSize) *
+                       geotagSize->capacity();
+    uint64_t maxSize = (uint64_t) std::max(1.0, overBytes);
+    eos::common::FileSystem::fsid_t fsid = 0;
+    eos::common::FileId::fileid_t fid = chooseFidFromGeotag(geotag, maxSize,
+                                        fsid);
 
     if ((int) fid == -1) {
       eos_static_debug("Couldn't choose any FID to schedule: failedgeotag=%s",
-                       (*over_it).c_str());
+                       geotag.c_str());
+
+      if (mGeotagsOverAvg.size() == 0) {
+        return false;
+      }
+
       continue;
     }
 
-    if (scheduleTransfer(fid, *over_it)) {
-      break;
+    if (scheduleTransfer(fid, fsid, geotag)) {
+      return true;
     }
   }
+
+  return false;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -548,12 +563,15 @@ GeoBalancer::prepareTransfers(int nrTransfers)
 /*--------------------------------------------------------------------------*/
 {
   int allowedTransfers = nrTransfers - mTransfers.size();
+  int scheduled = 0;
 
   for (int i = 0; i < allowedTransfers; i++) {
-    prepareTransfer();
+    if (prepareTransfer()) {
+      scheduled++;
+    }
   }
 
-  if (allowedTransfers > 0) {
+  if (scheduled > 0) {
     printSizes(&mGeotagSizes);
   }
 }
@@ -631,7 +649,7 @@ GeoBalancer::GeoBalance()
     isMaster = gOFS->MgmMaster.IsMaster();
 
     if (isMaster && isSpaceGeoBalancer) {
-      eos_static_info("geobalancer is enabled ntx=%d ", nrTransfers);
+      eos_static_debug("geobalancer is enabled ntx=%d ", nrTransfers);
     } else {
       if (isMaster) {
         eos_static_debug("geotag balancer is disabled");
@@ -658,10 +676,10 @@ GeoBalancer::GeoBalance()
 wait:
     XrdSysThread::SetCancelOn();
     // -------------------------------------------------------------------------
-    // Let some time pass or wait for a notification
+    // Let some time pass, transfers are topped up as they complete
     // -------------------------------------------------------------------------
     XrdSysTimer sleeper;
-    sleeper.Wait(10000);
+    sleeper.Wait(1000);
     XrdSysThread::CancelPoint();
   }
 
@@ -31,6 +31,7 @@
 
 /* -------------------------------------------------------------------------- */
 #include "mgm/Namespace.hh"
+#include "mgm/BalancerCandidates.hh"
 #include "common/Logging.hh"
 #include "common/FileId.hh"
 #include "common/FileSystem.hh"
@@ -125,10 +126,16 @@ private:
   /// transfers scheduled (maps files' ids with their path in proc)
   std::map<eos::common::FileId::fileid_t, std::string> mTransfers;
 
+  /// files sampled from the filesystems to be moved
+  BalancerCandidates mCandidates;
+
   std::string getFileProcTransferNameAndSize (eos::common::FileId::fileid_t fid,
+                                              eos::common::FileSystem::fsid_t fsid,
                                               uint64_t *size);
 
-  eos::common::FileId::fileid_t chooseFidFromGeotag (const std::string &geotag);
+  eos::common::FileId::fileid_t chooseFidFromGeotag (const std::string &geotag,
+                                                     uint64_t maxSize,
+                                                     eos::common::FileSystem::fsid_t &fsid);
 
   void populateGeotagsInfo (void);
 
@@ -138,9 +145,10 @@ private:
 
   void prepareTransfers (int nrTransfers);
 
-  void prepareTransfer (void);
+  bool prepareTransfer (void);
 
   bool scheduleTransfer (eos::common::FileId::fileid_t fid,
+                         eos::common::FileSystem::fsid_t fsid,
                          const std::string &sourceGeotag);
 
   int getRandom (int max);
@@ -860,7 +860,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 {
   assert(nNewReplicas);
   assert(newReplicas);
-  std::vector<SchedTME*> entries;
+  std::vector<FastStructSched*> fastStructs;
   // find the entry in the map
   tlCurrentGroup = group;
   SchedTME* entry;
@@ -875,8 +875,10 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
     entry = pGroup2SchedTME[group];
     AtomicInc(entry->fastStructLockWaitersCount);
   }
-  // readlock the original fast structure
-  entry->doubleBufferMutex.LockRead();
+  // placements don't take the double buffer lock: the foreground is loaded
+  // once and the updater waits for the epoch to be left before reusing it
+  EpochManager::enter();
+  FastStructSched* fg = entry->getForegroundFastStruct();
   // locate the existing replicas and the excluded fs in the tree
   vector<SchedTreeBase::tFastTreeIdx> newReplicasIdx(nNewReplicas),
          *existingReplicasIdx = NULL, *excludeFsIdx = NULL, *forceBrIdx = NULL;
@@ -893,7 +895,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
       const SchedTreeBase::tFastTreeIdx* idx =
         static_cast<const SchedTreeBase::tFastTreeIdx*>(0);
 
-      if (!entry->foregroundFastStruct->fs2TreeIdx->get(*it, idx) &&
+      if (!fg->fs2TreeIdx->get(*it, idx) &&
           !(*fsidsgeotags)[count].empty()) {
         // the fs is not in that group.
         // this could happen because the former file scheduler
@@ -901,11 +903,11 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
         // with the new geoscheduler, it should not happen
         // in that case, we try to match a filesystem having the same geotag
         SchedTreeBase::tFastTreeIdx idx =
-          entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode((
+          fg->tag2NodeIdx->getClosestFastTreeNode((
                 *fsidsgeotags)[count].c_str());
 
         if (idx &&
-            (*entry->foregroundFastStruct->treeInfo)[idx].nodeType ==
+            (*fg->treeInfo)[idx].nodeType ==
             SchedTreeBase::TreeNodeInfo::fs) {
           if ((std::find(existingReplicasIdx->begin(), existingReplicasIdx->end(),
                          idx) == existingReplicasIdx->end())) {
@@ -934,7 +936,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
     for (auto it = excludeFs->begin(); it != excludeFs->end(); ++it) {
       const SchedTreeBase::tFastTreeIdx* idx;
 
-      if (!entry->foregroundFastStruct->fs2TreeIdx->get(*it, idx)) {
+      if (!fg->fs2TreeIdx->get(*it, idx)) {
         // the excluded fs might belong to another group
         // so it's not an error condition
         // eos_warning("could not place excluded fs on the fast tree");
@@ -953,7 +955,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
     for (auto it = excludeGeoTags->begin(); it != excludeGeoTags->end(); ++it) {
       SchedTreeBase::tFastTreeIdx idx;
-      idx = entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(
+      idx = fg->tag2NodeIdx->getClosestFastTreeNode(
               it->c_str());
       excludeFsIdx->push_back(idx);
     }
@@ -964,7 +966,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
     for (auto it = forceGeoTags->begin(); it != forceGeoTags->end(); ++it) {
       SchedTreeBase::tFastTreeIdx idx;
-      idx = entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(
+      idx = fg->tag2NodeIdx->getClosestFastTreeNode(
               it->c_str());
       forceBrIdx->push_back(idx);
     }
@@ -974,7 +976,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
   if (!startFromGeoTag.empty()) {
     startFromNode =
-      entry->foregroundFastStruct->tag2NodeIdx->getClosestFastTreeNode(
+      fg->tag2NodeIdx->getClosestFastTreeNode(
         startFromGeoTag.c_str());
   }
 
@@ -985,7 +987,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
   case regularRO:
   case regularRW:
     success = placeNewReplicas(entry, nNewReplicas, &newReplicasIdx,
-                               entry->foregroundFastStruct->placementTree,
+                               fg->placementTree,
                                existingReplicasIdx, bookingSize, startFromNode,
                                nCollocatedReplicas, excludeFsIdx, forceBrIdx,
                                pSkipSaturatedPlct);
@@ -993,7 +995,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
   case draining:
     success = placeNewReplicas(entry, nNewReplicas, &newReplicasIdx,
-                               entry->foregroundFastStruct->drnPlacementTree,
+                               fg->drnPlacementTree,
                                existingReplicasIdx, bookingSize, startFromNode,
                                nCollocatedReplicas, excludeFsIdx, forceBrIdx,
                                pSkipSaturatedDrnPlct);
@@ -1001,7 +1003,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
   case balancing:
     success = placeNewReplicas(entry, nNewReplicas, &newReplicasIdx,
-                               entry->foregroundFastStruct->blcPlacementTree,
+                               fg->blcPlacementTree,
                                existingReplicasIdx, bookingSize, startFromNode,
                                nCollocatedReplicas, excludeFsIdx, forceBrIdx,
                                pSkipSaturatedBlcPlct);
@@ -1021,9 +1023,9 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
 
   for (auto it = newReplicasIdx.begin(); it != newReplicasIdx.end(); ++it) {
     const SchedTreeBase::tFastTreeIdx* idx = NULL;
-    const unsigned int fsid = (*entry->foregroundFastStruct->treeInfo)[*it].fsId;
+    const unsigned int fsid = (*fg->treeInfo)[*it].fsId;
 
-    if (!entry->foregroundFastStruct->fs2TreeIdx->get(fsid, idx)) {
+    if (!fg->fs2TreeIdx->get(fsid, idx)) {
       eos_crit("inconsistency : cannot retrieve index of selected fs though "
                "it should be in the tree");
       success = false;
@@ -1031,30 +1033,28 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
     }
 
     const char netSpeedClass =
-      (*entry->foregroundFastStruct->treeInfo)[*idx].netSpeedClass;
+      (*fg->treeInfo)[*idx].netSpeedClass;
     newReplicas->push_back(fsid);
 
     // Apply the penalties
-    if (entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.dlScore >
-        0) {
-      applyDlScorePenalty(entry, *idx,
-                          pPenaltySched.pPlctDlScorePenalty[netSpeedClass]);
+    if (fg->placementTree->pNodes[*idx].fsData.dlScore > 0) {
+      fg->applyDlScorePenalty(*idx, pPenaltySched.pPlctDlScorePenalty[netSpeedClass],
+                              false);
     }
 
-    if (entry->foregroundFastStruct->placementTree->pNodes[*idx].fsData.ulScore >
-        0) {
-      applyUlScorePenalty(entry, *idx,
-                          pPenaltySched.pPlctUlScorePenalty[netSpeedClass]);
+    if (fg->placementTree->pNodes[*idx].fsData.ulScore > 0) {
+      fg->applyUlScorePenalty(*idx, pPenaltySched.pPlctUlScorePenalty[netSpeedClass],
+                              false);
     }
   }
 
   if (dataProxys || firewallEntryPoint) {
-    entries.assign(newReplicasIdx.size(), entry);
+    fastStructs.assign(newReplicasIdx.size(), fg);
   }
 
   // find proxy for filesticky scheduling
   if (dataProxys) {
-    if (!findProxy(newReplicasIdx, entries, inode, dataProxys, NULL,
+    if (!findProxy(newReplicasIdx, fastStructs, inode, dataProxys, NULL,
                    pProxyCloseToFs ? "" : clientGeoTag, filesticky)) {
       success = false;
       goto cleanup;
@@ -1070,10 +1070,10 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
       for (size_t i = 0; i < newReplicasIdx.size(); i++) {
         if (clientGeoTag.empty() ||
             accessReqFwEP((
-                            *entries[i]->foregroundFastStruct->treeInfo)[newReplicasIdx[i]].fullGeotag ,
+                            *fastStructs[i]->treeInfo)[newReplicasIdx[i]].fullGeotag ,
                           clientGeoTag)) {
           firewallProxyGroups[i] = accessGetProxygroup((
-                                     *entries[i]->foregroundFastStruct->treeInfo)[newReplicasIdx[i]].fullGeotag);
+                                     *fastStructs[i]->treeInfo)[newReplicasIdx[i]].fullGeotag);
         }
       }
 
@@ -1082,7 +1082,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
       *firewallEntryPoint = *dataProxys;
     }
 
-    if (!findProxy(newReplicasIdx, entries, inode, firewallEntryPoint,
+    if (!findProxy(newReplicasIdx, fastStructs, inode, firewallEntryPoint,
                    &firewallProxyGroups, pProxyCloseToFs ? "" : clientGeoTag, any)) {
       success = false;
       goto cleanup;
@@ -1098,7 +1098,7 @@ GeoTreeEngine::placeNewReplicasOneGroup(FsGroup* group,
       *dataProxys = *firewallEntryPoint;
     }
 
-    if (!findProxy(newReplicasIdx, entries, inode, dataProxys, NULL,
+    if (!findProxy(newReplicasIdx, fastStructs, inode, dataProxys, NULL,
                    pProxyCloseToFs ? "" : clientGeoTag, regular)) {
       success = false;
       goto cleanup;
@@ -1112,7 +1112,7 @@ cleanup:
     newReplicas->clear();
   }
 
-  entry->doubleBufferMutex.UnLockRead();
+  EpochManager::leave();
   AtomicDec(entry->fastStructLockWaitersCount);
 
   if (existingReplicasIdx) {
@@ -1147,7 +1147,7 @@ struct TreeInfoFsIdComparator {
 
 bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
                               fsIdxs,
-                              std::vector<SchedTME*> entries,
+                              const std::vector<FastStructSched*>& fastStructs,
                               ino64_t inode,
                               std::vector<std::string>* dataProxys,
                               std::vector<std::string>* proxyGroups,
@@ -1164,7 +1164,8 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
   for (size_t i = 0; i < fsIdxs.size(); i++) {
     const std::string* geotag = NULL;
     // get the proxygroup
-    // WARNING: entries[i]->doubleBufferMutex should be locked by the caller of findProxy
+    // WARNING: fastStructs[i] should be protected by the caller of findProxy,
+    // either by the doubleBufferMutex of its entry or by an epoch section
 
     if (!(*dataProxys)[i].empty() && (*dataProxys)[i] != "<none>") {
       if (pPxyHost2DpTMEs.count((*dataProxys)[i])) {
@@ -1212,7 +1213,7 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
       fsproxygroup = &((*proxyGroups)[i]);
     } else {
       fsproxygroup = &
-                     (*entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].proxygroup;
+                     (*fastStructs[i]->treeInfo)[fsIdxs[i]].proxygroup;
     }
 
     if (fsproxygroup->empty() ||
@@ -1228,7 +1229,7 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
 
     if (!geotag) {
       geotag = (clientgeotag.empty() ? &
-                ((*(entries[i]->foregroundFastStruct->treeInfo))[fsIdxs[i]].fullGeotag) :
+                ((*(fastStructs[i]->treeInfo))[fsIdxs[i]].fullGeotag) :
                 &clientgeotag);
     }
 
@@ -1271,7 +1272,7 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
       // scheduling should consistently go through the same (firewallentrypoint,proxy)
       // this is to do the caching of the file only on one proxy
       // serving a same file from two proxies is not optimal but it is not mendatory neither
-      if ((*entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
+      if ((*fastStructs[i]->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
           < 0) {
         schedsuccess = true;
       }
@@ -1337,7 +1338,7 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
             while (
               uprlev < upRootLevelsCount &&
               upRootLevels[uprlev] <=
-              (*entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
+              (*fastStructs[i]->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
             ) {
               uprlev++;
             }
@@ -1365,9 +1366,9 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
               if (eos::common::Logging::gLogMask & LOG_MASK(LOG_DEBUG)) {
                 stringstream ss;
                 ss << "file sticky proxy scheduling fs:" <<
-                   (*entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].fsId;
+                   (*fastStructs[i]->treeInfo)[fsIdxs[i]].fsId;
                 ss << " | fileStickyProxyDepth:" << (int)(
-                     *entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].fileStickyProxyDepth;
+                     *fastStructs[i]->treeInfo)[fsIdxs[i]].fileStickyProxyDepth;
                 ss << " | possible proxys are:";
 
                 for (auto it = proxiesIdxs.begin(); it != proxiesIdxs.end(); it++) {
@@ -1390,7 +1391,7 @@ bool GeoTreeEngine::findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>&
       }
     } else {
       if (proxyschedtype == any
-          || ((*entries[i]->foregroundFastStruct->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
+          || ((*fastStructs[i]->treeInfo)[fsIdxs[i]].fileStickyProxyDepth
               < 0 && proxyschedtype == regular)) {
         // get the proxy
         if (!(schedsuccess = tree->findFreeSlot(idx, idx,
@@ -1670,6 +1671,8 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t& nAccessReplicas,
   ERIdx.reserve(existingReplicas->size());
   std::vector<SchedTME*> entries;
   entries.reserve(existingReplicas->size());
+  std::vector<FastStructSched*> fastStructs;
+  fastStructs.reserve(existingReplicas->size());
   // Maps tree maps entries (i.e. scheduling groups) to fsids containing a
   // replica being available and the corresponding fastTreeIndex
   map<SchedTME*, vector< pair<FileSystem::fsid_t, SchedTreeBase::tFastTreeIdx> > >
@@ -1716,6 +1719,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t& nAccessReplicas,
       // take the fastindex of each existing replica
       ERIdx.push_back(*idx);
       entries.push_back(entry);
+      fastStructs.push_back(entry->foregroundFastStruct);
       // check if the fs is available
       bool isValid = false;
 
@@ -1990,7 +1994,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t& nAccessReplicas,
   }
 
   if (dataProxys) {
-    if (!findProxy(ERIdx, entries, inode, dataProxys, NULL,
+    if (!findProxy(ERIdx, fastStructs, inode, dataProxys, NULL,
                    pProxyCloseToFs ? "" : accesserGeotag, filesticky)) {
       returnCode = ENONET;
       goto cleanup;
@@ -2015,7 +2019,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t& nAccessReplicas,
       *firewallEntryPoint = *dataProxys;
     }
 
-    if (!findProxy(ERIdx, entries, inode, firewallEntryPoint, &firewallProxyGroups,
+    if (!findProxy(ERIdx, fastStructs, inode, firewallEntryPoint, &firewallProxyGroups,
                    pProxyCloseToFs ? "" : accesserGeotag, any)) {
       returnCode = ENONET;
       goto cleanup;
@@ -2027,7 +2031,7 @@ int GeoTreeEngine::accessHeadReplicaMultipleGroup(const size_t& nAccessReplicas,
       *dataProxys = *firewallEntryPoint;
     }
 
-    if (!findProxy(ERIdx, entries, inode, dataProxys, NULL,
+    if (!findProxy(ERIdx, fastStructs, inode, dataProxys, NULL,
                    pProxyCloseToFs ? "" : accesserGeotag, regular)) {
       returnCode = ENONET;
       goto cleanup;
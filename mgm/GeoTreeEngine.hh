@@ -31,6 +31,7 @@
 /*----------------------------------------------------------------------------*/
 #include "mgm/FsView.hh"
 #include "mgm/geotree/SchedulingSlowTree.hh"
+#include "mgm/geotree/EpochManager.hh"
 #include "common/Timing.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOuc/XrdOucString.hh"
@@ -717,6 +718,8 @@ class GeoTreeEngine : public eos::common::LogId
     FastStruct* backgroundFastStruct;
     // the two previous pointers are swapped once an update is done. To do so, we need a mutex and a counter (for deletion)
     // every access to *mForegroundFastStruct for reading should be protected by a LockRead to mDoubleBufferMutex
+    // or by an EpochManager::ReadGuard, in which case the pointer has to be loaded once with getForegroundFastStruct
+    // and that snapshot used for the whole operation
     // when swapping mForegroundFastStruct and mBackgroundFastStruct is needed a LockWrite is taken to mDoubleBufferMutex
     eos::common::RWMutex doubleBufferMutex;
     size_t fastStructLockWaitersCount;
@@ -743,8 +746,19 @@ class GeoTreeEngine : public eos::common::LogId
 
     void swapFastStructBuffers()
     {
-      eos::common::RWMutexWriteLock lock(doubleBufferMutex);
-      std::swap(foregroundFastStruct, backgroundFastStruct);
+      {
+        eos::common::RWMutexWriteLock lock(doubleBufferMutex);
+        FastStruct* fg = foregroundFastStruct;
+        __atomic_store_n(&foregroundFastStruct, backgroundFastStruct,
+                         __ATOMIC_RELEASE);
+        backgroundFastStruct = fg;
+      }
+    }
+
+    // to be called from inside an EpochManager::ReadGuard
+    FastStruct* getForegroundFastStruct() const
+    {
+      return __atomic_load_n(&foregroundFastStruct, __ATOMIC_ACQUIRE);
     }
 
     void updateBGFastStructuresConfigParam(
@@ -927,6 +941,9 @@ class GeoTreeEngine : public eos::common::LogId
               entry->backgroundFastStruct->penalties->end(), Penalties());
     // swap the buffers (this is the only bit where the fast structures is not accessible for a placement/access operation)
     entry->swapFastStructBuffers();
+    // placements don't lock the double buffer, wait for the ones still using
+    // the former foreground before it gets modified as the new background
+    EpochManager::synchronize();
     return true;
   }
 
@@ -1791,7 +1808,7 @@ protected:
     any         // do the regular scheduling for all the filesystems
   } tProxySchedType;
   bool findProxy(const std::vector<SchedTreeBase::tFastTreeIdx>& fsidxs,
-                 std::vector<SchedTME*> entries,
+                 const std::vector<FastStructSched*>& fastStructs,
                  ino64_t inode,
                  std::vector<std::string>* proxies,
                  std::vector<std::string>* proxyGroups = NULL,
@@ -32,6 +32,7 @@
 #include "XrdSys/XrdSysError.hh"
 #include "XrdOuc/XrdOucTrace.hh"
 #include "Xrd/XrdScheduler.hh"
+#include <algorithm>
 #include <random>
 #include <cmath>
 
@@ -255,12 +256,15 @@ GroupBalancer::populateGroupsInfo()
   mAvgUsedSize = 0;
   clearCachedSizes();
   auto set_fsgrp = FsView::gFsView.mSpaceGroupView[spaceName];
+  std::set<eos::common::FileSystem::fsid_t> fsids;
 
   for (auto it = set_fsgrp.cbegin(); it != set_fsgrp.cend(); it++) {
     if ((*it)->GetConfigMember("status") != "on") {
       continue;
     }
 
+    fsids.insert((*it)->begin(), (*it)->end());
+
     uint64_t size = (*it)->AverageDouble("stat.statfs.usedbytes");
     uint64_t capacity = (*it)->AverageDouble("stat.statfs.capacity");
 
@@ -272,6 +276,9 @@ GroupBalancer::populateGroupsInfo()
     mAvgUsedSize += mGroupSizes[(*it)->mName]->filled();
   }
 
+  // forget the files sampled from filesystems which left the groups
+  mCandidates.Retain(fsids);
+
   if (mGroupSizes.size() == 0) {
     mAvgUsedSize = 0;
     eos_static_debug("No groups to be balanced!");
@@ -286,6 +293,7 @@ GroupBalancer::populateGroupsInfo()
 /*----------------------------------------------------------------------------*/
 std::string
 GroupBalancer::getFileProcTransferNameAndSize(eos::common::FileId::fileid_t fid,
+    eos::common::FileSystem::fsid_t fsid,
     FsGroup* group,
     uint64_t* size)
 /*----------------------------------------------------------------------------*/
@@ -293,6 +301,7 @@ GroupBalancer::getFileProcTransferNameAndSize(eos::common::FileId::fileid_t fid,
  * @brief Produces a file conversion path to be placed in the proc directory
  *        taking into account the given group and also returns its size
  * @param fid the file ID
+ * @param fsid the filesystem the file was sampled from
  * @param group the group to which the file will be transferred
  * @param size return address for the size of the file
  *
@@ -316,6 +325,14 @@ GroupBalancer::getFileProcTransferNameAndSize(eos::common::FileId::fileid_t fid,
         return std::string("");
       }
 
+      // the candidate may have been sampled minutes ago
+      if (!fmd->hasLocation(fsid)) {
+        eos_static_debug("msg=\"file no longer on the source filesystem\" "
+                         "fid=%llu fsid=%lu", (unsigned long long) fid,
+                         (unsigned long) fsid);
+        return std::string("");
+      }
+
       if (size) {
         *size = fmd->getSize();
       }
@@ -356,27 +373,25 @@ GroupBalancer::updateTransferList()
 /*----------------------------------------------------------------------------*/
 {
   std::map<eos::common::FileId::fileid_t, std::string>::iterator it;
+  // check all the transfers under one lock
+  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
 
   for (it = mTransfers.begin(); it != mTransfers.end();) {
-    eos::common::Mapping::VirtualIdentity rootvid;
-    eos::common::Mapping::Root(rootvid);
-    XrdOucErrInfo error;
-    const std::string& fileName = (*it).second;
-    struct stat buf;
-
-    if (gOFS->_stat(fileName.c_str(), &buf, error, rootvid, "")) {
-      mTransfers.erase(it++);
-    } else {
+    try {
+      gOFS->eosView->getFile((*it).second);
       ++it;
+    } catch (eos::MDException& e) {
+      mTransfers.erase(it++);
     }
   }
 
-  eos_static_info("scheduledtransfers=%d", mTransfers.size());
+  eos_static_debug("scheduledtransfers=%d", mTransfers.size());
 }
 
 /*----------------------------------------------------------------------------*/
-void
+bool
 GroupBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
+                                eos::common::FileSystem::fsid_t fsid,
                                 FsGroup* sourceGroup,
                                 FsGroup* targetGroup)
 /*----------------------------------------------------------------------------*/
@@ -384,8 +399,10 @@ GroupBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
  * @brief Creates the conversion file in proc for the file ID, from the given
  *        sourceGroup, to the targetGroup (and updates the cache structures)
  * @param fid the id of the file to be transferred
+ * @param fsid the filesystem of the sourceGroup holding the file
  * @param sourceGroup the group where the file is currently located
  * @param targetGroup the group to which the file is will be transferred
+ * @return whether the transfer file was scheduled or not
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -393,10 +410,11 @@ GroupBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
   eos::common::Mapping::Root(rootvid);
   XrdOucErrInfo mError;
   uint64_t size = -1;
-  std::string fileName = getFileProcTransferNameAndSize(fid, targetGroup, &size);
+  std::string fileName = getFileProcTransferNameAndSize(fid, fsid, targetGroup,
+                         &size);
 
   if (fileName == "") {
-    return;
+    return false;
   }
 
   if (!gOFS->_touch(fileName.c_str(), mError, rootvid, 0)) {
@@ -411,63 +429,53 @@ GroupBalancer::scheduleTransfer(eos::common::FileId::fileid_t fid,
       size);
   updateGroupAvgCache(sourceGroup);
   updateGroupAvgCache(targetGroup);
+  return true;
 }
 
 /*----------------------------------------------------------------------------*/
 eos::common::FileId::fileid_t
-GroupBalancer::chooseFidFromGroup(FsGroup* group)
+GroupBalancer::chooseFidFromGroup(FsGroup* group, uint64_t maxSize,
+                                  eos::common::FileSystem::fsid_t& fsid)
 /*----------------------------------------------------------------------------*/
 /**
- * @brief Chooses a random file ID from a random filesystem in the given group
+ * @brief Chooses a file ID from a random filesystem in the given group, among
+ *        the files sampled from it
  * @param group the group from which the file id will be chosen
+ * @param maxSize the maximum size of the file
+ * @param fsid filled with the filesystem the file was chosen from
  * @return the chosen file ID
  */
 /*----------------------------------------------------------------------------*/
 {
   int rndIndex;
   eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
-  eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
-  eos::IFsView::FileList filelist;
-  std::vector<int> validFsIndexes(group->size());
-
-  for (size_t i = 0; i < group->size(); i++) {
-    validFsIndexes[i] = (int) i;
-  }
-
+  std::vector<eos::common::FileSystem::fsid_t> validFs;
   eos::mgm::BaseView::const_iterator fs_it;
 
-  while (validFsIndexes.size() > 0) {
-    fs_it = group->begin();
-    rndIndex = getRandom(validFsIndexes.size() - 1);
-    std::advance(fs_it, validFsIndexes[rndIndex]);
-
+  for (fs_it = group->begin(); fs_it != group->end(); fs_it++) {
     // accept only active file systems
-    if (FsView::gFsView.mIdView[*fs_it]->GetActiveStatus() ==
-        eos::common::FileSystem::kOnline) {
-      filelist = gOFS->eosFsView->getFileList(*fs_it);
-
-      if (filelist.size() > 0) {
-        break;
-      }
+    if (FsView::gFsView.mIdView.count(*fs_it) &&
+        (FsView::gFsView.mIdView[*fs_it]->GetActiveStatus() ==
+         eos::common::FileSystem::kOnline)) {
+      validFs.push_back(*fs_it);
     }
-
-    validFsIndexes.erase(validFsIndexes.begin() + rndIndex);
-  }
-
-  if (filelist.size() == 0) {
-    return -1;
   }
 
-  int attempts = 10;
-  eos::IFsView::FileIterator fid_it;
+  while (validFs.size() > 0) {
+    rndIndex = getRandom(validFs.size() - 1);
+    uint64_t size = 0;
+    eos::common::FileId::fileid_t fid =
+      mCandidates.Take(validFs[rndIndex], maxSize, size);
 
-  while (attempts-- > 0) {
-    rndIndex = getRandom(filelist.size() - 1);
-    fid_it = filelist.begin();
-    std::advance(fid_it, rndIndex);
+    if (!fid) {
+      // nothing suitable on this filesystem
+      validFs.erase(validFs.begin() + rndIndex);
+      continue;
+    }
 
-    if (mTransfers.count(*fid_it) == 0) {
-      return *fid_it;
+    if (mTransfers.count(fid) == 0) {
+      fsid = validFs[rndIndex];
+      return fid;
     }
   }
 
@@ -485,12 +493,13 @@ printSizes(const std::map<std::string, GroupSize*>* sizes)
 }
 
 /*----------------------------------------------------------------------------*/
-void
+bool
 GroupBalancer::prepareTransfer()
 /*----------------------------------------------------------------------------*/
 /**
  * @brief Picks two groups (source and target) randomly and schedule a file ID
  *        to be transferred
+ * @return whether a transfer was scheduled
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -508,7 +517,7 @@ GroupBalancer::prepareTransfer()
     }
 
     recalculateAvg();
-    return;
+    return false;
   }
 
   over_it = mGroupsOverAvg.begin();
@@ -521,18 +530,29 @@ GroupBalancer::prepareTransfer()
   toGroup = (*under_it).second;
 
   if (fromGroup->size() == 0) {
-    return;
+    return false;
   }
 
-  eos::common::FileId::fileid_t fid = chooseFidFromGroup(fromGroup);
+  // don't move more than what brings either group back to the average, the
+  // cached sizes are per filesystem of the group
+  GroupSize* fromSize = mGroupSizes[fromGroup->mName];
+  GroupSize* toSize = mGroupSizes[toGroup->mName];
+  double overBytes = (fromSize->filled() - mAvgUsedSize) * fromSize->capacity()
+                     * fromGroup->size();
+  double underBytes = (mAvgUsedSize - toSize->filled()) * toSize->capacity()
+                      * toGroup->size();
+  uint64_t maxSize = (uint64_t) std::max(1.0, std::min(overBytes, underBytes));
+  eos::common::FileSystem::fsid_t fsid = 0;
+  eos::common::FileId::fileid_t fid = chooseFidFromGroup(fromGroup, maxSize,
+                                      fsid);
 
   if ((int) fid == -1) {
-    eos_static_info("Couldn't choose any FID to schedule: failedgroup=%s",
-                    fromGroup->mName.c_str());
-    return;
+    eos_static_debug("Couldn't choose any FID to schedule: failedgroup=%s",
+                     fromGroup->mName.c_str());
+    return false;
   }
 
-  scheduleTransfer(fid, fromGroup, toGroup);
+  return scheduleTransfer(fid, fsid, fromGroup, toGroup);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -566,12 +586,15 @@ GroupBalancer::prepareTransfers(int nrTransfers)
    */
   /*--------------------------------------------------------------------------*/
   int allowedTransfers = nrTransfers - mTransfers.size();
+  int scheduled = 0;
 
   for (int i = 0; i < allowedTransfers; i++) {
-    prepareTransfer();
+    if (prepareTransfer()) {
+      scheduled++;
+    }
   }
 
-  if (allowedTransfers > 0) {
+  if (scheduled > 0) {
     printSizes(&mGroupSizes);
   }
 }
@@ -655,7 +678,7 @@ GroupBalancer::GroupBalance()
     isMaster = gOFS->MgmMaster.IsMaster();
 
     if (isMaster && isSpaceGroupBalancer) {
-      eos_static_info("groupbalancer is enabled ntx=%d ", nrTransfers);
+      eos_static_debug("groupbalancer is enabled ntx=%d ", nrTransfers);
     } else {
       if (isMaster) {
         eos_static_debug("group balancer is disabled");
@@ -683,9 +706,9 @@ GroupBalancer::GroupBalance()
 
 wait:
     XrdSysThread::SetCancelOn();
-    // Let some time pass or wait for a notification
+    // Let some time pass, transfers are topped up as they complete
     XrdSysTimer sleeper;
-    sleeper.Wait(10000);
+    sleeper.Wait(1000);
     XrdSysThread::CancelPoint();
   }
 
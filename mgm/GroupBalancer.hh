@@ -26,6 +26,7 @@
 
 /* -------------------------------------------------------------------------- */
 #include "mgm/Namespace.hh"
+#include "mgm/BalancerCandidates.hh"
 #include "common/Logging.hh"
 #include "common/FileId.hh"
 /* -------------------------------------------------------------------------- */
@@ -114,11 +115,17 @@ private:
   /// transfers scheduled (maps files' ids with their path in proc)
   std::map<eos::common::FileId::fileid_t, std::string> mTransfers;
 
+  /// files sampled from the filesystems to be moved
+  BalancerCandidates mCandidates;
+
   std::string getFileProcTransferNameAndSize (eos::common::FileId::fileid_t fid,
+                                        eos::common::FileSystem::fsid_t fsid,
                                         FsGroup *group,
                                         uint64_t *size);
 
-  eos::common::FileId::fileid_t chooseFidFromGroup (FsGroup *group);
+  eos::common::FileId::fileid_t chooseFidFromGroup (FsGroup *group,
+                                                    uint64_t maxSize,
+                                                    eos::common::FileSystem::fsid_t &fsid);
 
   void populateGroupsInfo (void);
 
@@ -132,9 +139,10 @@ private:
 
   void prepareTransfers (int nrTransfers);
 
-  void prepareTransfer (void);
+  bool prepareTransfer (void);
 
-  void scheduleTransfer (eos::common::FileId::fileid_t fid,
+  bool scheduleTransfer (eos::common::FileId::fileid_t fid,
+                         eos::common::FileSystem::fsid_t fsid,
                          FsGroup *sourceGroup,
                          FsGroup *targetGroup);
 
@@ -368,6 +368,7 @@ IConfigEngine::ApplyConfig(XrdOucString& err)
     eos::common::Mapping::gVirtualUidMap.clear();
     eos::common::Mapping::gVirtualGidMap.clear();
     eos::common::Mapping::gAllowedTidentMatches.clear();
+    eos::common::Mapping::InvalidateIdMapCache();
   }
   Access::Reset();
   {
@@ -601,6 +602,7 @@ IConfigEngine::ResetConfig()
     eos::common::Mapping::gVirtualUidMap.clear();
     eos::common::Mapping::gVirtualGidMap.clear();
     eos::common::Mapping::gAllowedTidentMatches.clear();
+    eos::common::Mapping::InvalidateIdMapCache();
   }
   Access::Reset();
   gOFS->ResetPathMap();
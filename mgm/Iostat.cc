@@ -32,6 +32,8 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <unistd.h>
 /*----------------------------------------------------------------------------*/
 #include "XrdSys/XrdSysDNS.hh"
 /*----------------------------------------------------------------------------*/
@@ -44,6 +46,37 @@ const char* Iostat::gIostatReportNamespace = "iostat::reportnamespace";
 const char* Iostat::gIostatPopularity = "iostat::popularity";
 const char* Iostat::gIostatUdpTargetList = "iostat::udptargets";
 
+const char* Iostat::gTagNames[Iostat::kNumTags] = {
+  "bytes_read",
+  "bytes_written",
+  "read_calls",
+  "readv_calls",
+  "write_calls",
+  "fwd_seeks",
+  "bwd_seeks",
+  "xl_fwd_seeks",
+  "xl_bwd_seeks",
+  "bytes_fwd_seek",
+  "bytes_bwd_wseek",
+  "bytes_xl_fwd_seek",
+  "bytes_xl_bwd_wseek",
+  "disk_time_read",
+  "disk_time_write"
+};
+
+/* ------------------------------------------------------------------------- */
+int
+Iostat::GetTagId(const char* tag)
+{
+  for (int i = 0; i < kNumTags; ++i) {
+    if (!strcmp(gTagNames[i], tag)) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
 /* ------------------------------------------------------------------------- */
 Iostat::Iostat()
 {
@@ -52,6 +85,24 @@ Iostat::Iostat()
   mStoreFileName = "";
   cthread = 0;
   thread = 0;
+  mStopWorkers = false;
+  mReportsIn = 0;
+  mReportsBinary = 0;
+  mReportsFailed = 0;
+  mRingFull = 0;
+  mDecodeNs = 0;
+  mAccountNs = 0;
+  mAccounted = 0;
+  mIngestRate = 0;
+  mLastReportsIn = 0;
+  mLastRateTime = time(NULL);
+  mOpenReportFile = "";
+  mOpenReportFd = 0;
+
+  for (size_t i = 0; i < sShards; ++i) {
+    mShards[i].mRing.resize(sRingSize, 0);
+  }
+
   // push default domains to watch TODO: make generic
   IoDomains.insert(".ch");
   IoDomains.insert(".it");
@@ -77,10 +128,10 @@ Iostat::Iostat()
   IoNodes.insert("cms-cdr"); // CMS DAQ
   IoNodes.insert("pc-tdq"); // ATLAS DAQ
 
-  for (size_t i = 0; i < IOSTAT_POPULARITY_HISTORY_DAYS; i++) {
-    IostatPopularity[i].set_deleted_key("");
-    IostatPopularity[i].resize(100000);
-  }
+  IostatPopularityByCount.assign(IOSTAT_POPULARITY_HISTORY_DAYS,
+                                 PopularitySketch(sPopularityFiles));
+  IostatPopularityByBytes.assign(IOSTAT_POPULARITY_HISTORY_DAYS,
+                                 PopularitySketch(sPopularityFiles));
 
   IostatLastPopularityBin = 0;
   mReportPopularity = true;
@@ -197,6 +248,7 @@ Iostat::Start()
 
   if (!mRunning) {
     mClient.Subscribe();
+    StartWorkers();
     XrdSysThread::Run(&thread, Iostat::StaticReceive, static_cast<void*>(this),
                       XRDSYSTHREAD_HOLD, "Report Receiver Thread");
     mRunning = true;
@@ -213,6 +265,7 @@ Iostat::Stop()
   if (mRunning) {
     XrdSysThread::Cancel(thread);
     XrdSysThread::Join(thread, NULL);
+    StopWorkers();
     mRunning = false;
     mClient.Unsubscribe();
     return true;
@@ -232,6 +285,10 @@ Iostat::~Iostat()
     XrdSysThread::Cancel(cthread);
     XrdSysThread::Join(cthread, NULL);
   }
+
+  if (mOpenReportFd) {
+    fclose(mOpenReportFd);
+  }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -256,228 +313,367 @@ Iostat::Receive(void)
     XrdMqMessage* newmessage = 0;
 
     while ((newmessage = mClient.RecvMessage())) {
-      XrdOucString body = newmessage->GetBody();
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      const char* rawbody = newmessage->GetBody();
+      Received* received = new Received();
+      bool ok = true;
+      mReportsIn++;
+
+      if (eos::common::Report::IsBinary(rawbody)) {
+        mReportsBinary++;
+        ok = received->mReport.Decode(rawbody);
+      } else {
+        XrdOucString body = rawbody;
 
-      while (body.replace("&&", "&")) {
-      }
+        while (body.replace("&&", "&")) {
+        }
 
-      XrdOucEnv ioreport(body.c_str());
-      eos::common::Report* report = new eos::common::Report(ioreport);
-      Add("bytes_read", report->uid, report->gid, report->rb, report->ots,
-          report->cts);
-      Add("bytes_written", report->uid, report->gid, report->wb, report->ots,
-          report->cts);
-      Add("read_calls", report->uid, report->gid, report->nrc, report->ots,
-          report->cts);
-      Add("readv_calls", report->uid, report->gid, report->rv_op, report->ots,
-          report->cts);
-      Add("write_calls", report->uid, report->gid, report->nwc, report->ots,
-          report->cts);
-      Add("fwd_seeks", report->uid, report->gid, report->nfwds, report->ots,
-          report->cts);
-      Add("bwd_seeks", report->uid, report->gid, report->nbwds, report->ots,
-          report->cts);
-      Add("xl_fwd_seeks", report->uid, report->gid, report->nxlfwds, report->ots,
-          report->cts);
-      Add("xl_bwd_seeks", report->uid, report->gid, report->nxlbwds, report->ots,
-          report->cts);
-      Add("bytes_fwd_seek", report->uid, report->gid, report->sfwdb, report->ots,
-          report->cts);
-      Add("bytes_bwd_wseek", report->uid, report->gid, report->sbwdb, report->ots,
-          report->cts);
-      Add("bytes_xl_fwd_seek", report->uid, report->gid, report->sxlfwdb, report->ots,
-          report->cts);
-      Add("bytes_xl_bwd_wseek", report->uid, report->gid, report->sxlbwdb,
-          report->ots, report->cts);
-      Add("disk_time_read", report->uid, report->gid, (unsigned long long) report->rt,
-          report->ots, report->cts);
-      Add("disk_time_write", report->uid, report->gid,
-          (unsigned long long) report->wt, report->ots, report->cts);
-      // do the UDP broadcasting here
-      {
-        XrdSysMutexHelper mLock(BroadcastMutex);
+        XrdOucEnv ioreport(body.c_str());
+        received->mReport = eos::common::Report(ioreport);
+        received->mBody = body.c_str();
+      }
 
-        if (mUdpPopularityTarget.size()) {
-          UdpBroadCast(report);
-        }
+      delete newmessage;
+      mDecodeNs += std::chrono::duration_cast<std::chrono::nanoseconds>
+                   (std::chrono::steady_clock::now() - start).count();
+
+      if (!ok) {
+        mReportsFailed++;
+        eos_static_err("msg=\"failed to decode binary report\"");
+        delete received;
+        continue;
       }
 
-      // do the domain accounting here
-      if (report->path.substr(0, 11) == "/replicate:") {
-        // check if this is a replication path
-        // push into the 'eos' domain
-        Mutex.Lock();
+      Enqueue(received);
+    }
 
-        if (report->rb) {
-          IostatAvgDomainIOrb["eos"].Add(report->rb, report->ots, report->cts);
-        }
+    XrdSysThread::SetCancelOn();
+    XrdSysTimer sleeper;
+    sleeper.Snooze(1);
+    XrdSysThread::CancelPoint();
+    XrdSysThread::SetCancelOff();
+  }
 
-        if (report->wb) {
-          IostatAvgDomainIOwb["eos"].Add(report->wb, report->ots, report->cts);
-        }
+  return 0;
+}
 
-        Mutex.UnLock();
-      } else {
-        bool dfound = false;
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Enqueue(Received* received)
+{
+  Shard& shard = mShards[received->mReport.uid % sShards];
+  size_t tail = shard.mTail.load(std::memory_order_relaxed);
+  bool waited = false;
 
-        if (mReportPopularity) {
-          // do the popularity accounting here for everything which is not replication!
-          AddToPopularity(report->path, report->rb, report->ots, report->cts);
-        }
+  // the worker drains the ring, wait until there is a free slot
+  while (tail - shard.mHead.load(std::memory_order_acquire) >= sRingSize) {
+    if (!waited) {
+      mRingFull++;
+      waited = true;
+    }
 
-        size_t pos = 0;
+    usleep(1000);
+  }
 
-        if ((pos = report->sec_domain.rfind(".")) != std::string::npos) {
-          // we can sort in by domain
-          std::string sdomain = report->sec_domain.substr(pos);
+  shard.mRing[tail % sRingSize] = received;
+  shard.mTail.store(tail + 1, std::memory_order_release);
+}
 
-          if (IoDomains.find(sdomain) != IoDomains.end()) {
-            Mutex.Lock();
+/* ------------------------------------------------------------------------- */
+void
+Iostat::StartWorkers()
+{
+  mStopWorkers = false;
 
-            if (report->rb) {
-              IostatAvgDomainIOrb[sdomain].Add(report->rb, report->ots, report->cts);
-            }
+  for (size_t i = 0; i < sShards; ++i) {
+    mShards[i].mThread = std::thread(&Iostat::Worker, this, i);
+  }
+}
 
-            if (report->wb) {
-              IostatAvgDomainIOwb[sdomain].Add(report->wb, report->ots, report->cts);
-            }
+/* ------------------------------------------------------------------------- */
+void
+Iostat::StopWorkers()
+{
+  mStopWorkers = true;
 
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
+  for (size_t i = 0; i < sShards; ++i) {
+    Shard& shard = mShards[i];
 
-        // do the node accounting here - keep the node list small !!!
-        std::set<std::string>::const_iterator nit;
+    if (shard.mThread.joinable()) {
+      shard.mThread.join();
+    }
 
-        for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++) {
-          if (*nit == report->sec_host.substr(0, nit->length())) {
-            Mutex.Lock();
+    // drop what was not accounted
+    while (shard.mHead != shard.mTail) {
+      delete shard.mRing[shard.mHead % sRingSize];
+      shard.mHead++;
+    }
+  }
+}
 
-            if (report->rb) {
-              IostatAvgDomainIOrb[*nit].Add(report->rb, report->ots, report->cts);
-            }
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Worker(size_t index)
+{
+  Shard& shard = mShards[index];
+  unsigned int idle = 0;
 
-            if (report->wb) {
-              IostatAvgDomainIOwb[*nit].Add(report->wb, report->ots, report->cts);
-            }
+  while (!mStopWorkers) {
+    size_t head = shard.mHead.load(std::memory_order_relaxed);
 
-            Mutex.UnLock();
-            dfound = true;
-          }
-        }
+    if (head == shard.mTail.load(std::memory_order_acquire)) {
+      // back off up to 20 ms while there is nothing to do
+      if (idle < 20) {
+        idle++;
+      }
 
-        if (!dfound) {
-          // push into the 'other' domain
-          Mutex.Lock();
+      usleep(idle * 1000);
+      continue;
+    }
 
-          if (report->rb) {
-            IostatAvgDomainIOrb["other"].Add(report->rb, report->ots, report->cts);
-          }
+    idle = 0;
+    Received* received = shard.mRing[head % sRingSize];
+    shard.mHead.store(head + 1, std::memory_order_release);
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    {
+      XrdSysMutexHelper sLock(shard.mMutex);
+      Account(shard, received->mReport);
+    }
+    Publish(*received);
+    delete received;
+    mAccountNs += std::chrono::duration_cast<std::chrono::nanoseconds>
+                  (std::chrono::steady_clock::now() - start).count();
+    mAccounted++;
+  }
+}
 
-          if (report->wb) {
-            IostatAvgDomainIOwb["other"].Add(report->wb, report->ots, report->cts);
-          }
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Account(Shard& shard, eos::common::Report& report)
+{
+  unsigned long vals[kNumTags];
+  vals[kBytesRead] = report.rb;
+  vals[kBytesWritten] = report.wb;
+  vals[kReadCalls] = report.nrc;
+  vals[kReadvCalls] = report.rv_op;
+  vals[kWriteCalls] = report.nwc;
+  vals[kFwdSeeks] = report.nfwds;
+  vals[kBwdSeeks] = report.nbwds;
+  vals[kXlFwdSeeks] = report.nxlfwds;
+  vals[kXlBwdSeeks] = report.nxlbwds;
+  vals[kBytesFwdSeek] = report.sfwdb;
+  vals[kBytesBwdSeek] = report.sbwdb;
+  vals[kBytesXlFwdSeek] = report.sxlfwdb;
+  vals[kBytesXlBwdSeek] = report.sxlbwdb;
+  vals[kDiskTimeRead] = (unsigned long long) report.rt;
+  vals[kDiskTimeWrite] = (unsigned long long) report.wt;
+  Counters& ucounters = shard.mUid[report.uid];
+  Counters& gcounters = shard.mGid[report.gid];
+
+  for (int tag = 0; tag < kNumTags; ++tag) {
+    ucounters.mTotal[tag] += vals[tag];
+    gcounters.mTotal[tag] += vals[tag];
+    ucounters.mAvg[tag].Add(vals[tag], report.ots, report.cts);
+    gcounters.mAvg[tag].Add(vals[tag], report.ots, report.cts);
+  }
 
-          Mutex.UnLock();
-        }
-      }
+  // do the domain accounting here
+  std::vector<std::string> domains;
 
-      // do the application accounting here
-      std::string apptag = "other";
+  if (report.path.substr(0, 11) == "/replicate:") {
+    // check if this is a replication path
+    // push into the 'eos' domain
+    domains.push_back("eos");
+  } else {
+    size_t pos = 0;
+
+    if ((pos = report.sec_domain.rfind(".")) != std::string::npos) {
+      // we can sort in by domain
+      std::string sdomain = report.sec_domain.substr(pos);
 
-      if (report->sec_app.length()) {
-        apptag = report->sec_app;
+      if (IoDomains.find(sdomain) != IoDomains.end()) {
+        domains.push_back(sdomain);
       }
+    }
 
-      // Push into app accounting
-      Mutex.Lock();
+    // do the node accounting here - keep the node list small !!!
+    std::set<std::string>::const_iterator nit;
 
-      if (report->rb) {
-        IostatAvgAppIOrb[apptag].Add(report->rb, report->ots, report->cts);
+    for (nit = IoNodes.begin(); nit != IoNodes.end(); nit++) {
+      if (*nit == report.sec_host.substr(0, nit->length())) {
+        domains.push_back(*nit);
       }
+    }
 
-      if (report->wb) {
-        IostatAvgAppIOwb[apptag].Add(report->wb, report->ots, report->cts);
-      }
+    if (domains.empty()) {
+      // push into the 'other' domain
+      domains.push_back("other");
+    }
+  }
 
-      Mutex.UnLock();
-
-      if (mReport) {
-        // add the record to a daily report log file
-        static XrdOucString openreportfile = "";
-        static FILE* openreportfd = 0;
-        time_t now = time(NULL);
-        struct tm nowtm;
-        XrdOucString reportfile = "";
-
-        if (localtime_r(&now, &nowtm)) {
-          static char logfile[4096];
-          snprintf(logfile, sizeof(logfile) - 1, "%s/%04u/%02u/%04u%02u%02u.eosreport",
-                   gOFS->IoReportStorePath.c_str(),
-                   1900 + nowtm.tm_year,
-                   nowtm.tm_mon + 1,
-                   1900 + nowtm.tm_year,
-                   nowtm.tm_mon + 1,
-                   nowtm.tm_mday);
-          reportfile = logfile;
-
-          if (reportfile == openreportfile) {
-            // just add it here;
-            if (openreportfd) {
-              fprintf(openreportfd, "%s\n", body.c_str());
-              fflush(openreportfd);
-            }
-          } else {
-            if (openreportfd) {
-              fclose(openreportfd);
-            }
+  for (size_t i = 0; i < domains.size(); ++i) {
+    if (report.rb) {
+      shard.mDomainIOrb[domains[i]].Add(report.rb, report.ots, report.cts);
+    }
 
-            eos::common::Path cPath(reportfile.c_str());
+    if (report.wb) {
+      shard.mDomainIOwb[domains[i]].Add(report.wb, report.ots, report.cts);
+    }
+  }
 
-            if (cPath.MakeParentPath(S_IRWXU)) {
-              openreportfd = fopen(reportfile.c_str(), "a+");
+  // do the application accounting here
+  std::string apptag = "other";
 
-              if (openreportfd) {
-                fprintf(openreportfd, "%s\n", body.c_str());
-                fflush(openreportfd);
-              }
+  if (report.sec_app.length()) {
+    apptag = report.sec_app;
+  }
 
-              openreportfile = reportfile;
-            }
-          }
+  if (report.rb) {
+    shard.mAppIOrb[apptag].Add(report.rb, report.ots, report.cts);
+  }
+
+  if (report.wb) {
+    shard.mAppIOwb[apptag].Add(report.wb, report.ots, report.cts);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Publish(Received& received)
+{
+  eos::common::Report* report = &received.mReport;
+  // do the UDP broadcasting here
+  {
+    XrdSysMutexHelper mLock(BroadcastMutex);
+
+    if (mUdpPopularityTarget.size()) {
+      UdpBroadCast(report);
+    }
+  }
+
+  if (mReportPopularity && (report->path.substr(0, 11) != "/replicate:")) {
+    // do the popularity accounting here for everything which is not replication!
+    AddToPopularity(report->fid, report->rb, report->ots, report->cts);
+  }
+
+  if (!mReport && !mReportNamespace) {
+    return;
+  }
+
+  // the report files keep the env format
+  if (received.mBody.empty()) {
+    report->ToEnv(received.mBody);
+  }
+
+  const std::string& body = received.mBody;
+
+  if (mReport) {
+    // add the record to a daily report log file
+    time_t now = time(NULL);
+    struct tm nowtm;
+
+    if (localtime_r(&now, &nowtm)) {
+      char logfile[4096];
+      snprintf(logfile, sizeof(logfile) - 1, "%s/%04u/%02u/%04u%02u%02u.eosreport",
+               gOFS->IoReportStorePath.c_str(),
+               1900 + nowtm.tm_year,
+               nowtm.tm_mon + 1,
+               1900 + nowtm.tm_year,
+               nowtm.tm_mon + 1,
+               nowtm.tm_mday);
+      XrdOucString reportfile = logfile;
+      XrdSysMutexHelper rLock(ReportMutex);
+
+      if (reportfile == mOpenReportFile) {
+        // just add it here;
+        if (mOpenReportFd) {
+          fprintf(mOpenReportFd, "%s\n", body.c_str());
+          fflush(mOpenReportFd);
+        }
+      } else {
+        if (mOpenReportFd) {
+          fclose(mOpenReportFd);
+          mOpenReportFd = 0;
         }
-      }
 
-      if (mReportNamespace) {
-        // add the record into the report namespace file
-        char path[4096];
-        snprintf(path, sizeof(path) - 1, "%s/%s", gOFS->IoReportStorePath.c_str(),
-                 report->path.c_str());
-        eos::common::Path cPath(path);
+        eos::common::Path cPath(reportfile.c_str());
 
         if (cPath.MakeParentPath(S_IRWXU)) {
-          FILE* freport = fopen(path, "a+");
+          mOpenReportFd = fopen(reportfile.c_str(), "a+");
 
-          if (freport) {
-            fprintf(freport, "%s\n", body.c_str());
-            fclose(freport);
+          if (mOpenReportFd) {
+            fprintf(mOpenReportFd, "%s\n", body.c_str());
+            fflush(mOpenReportFd);
           }
+
+          mOpenReportFile = reportfile;
         }
       }
-
-      delete report;
-      delete newmessage;
     }
+  }
 
-    XrdSysThread::SetCancelOn();
-    XrdSysTimer sleeper;
-    sleeper.Snooze(1);
-    XrdSysThread::CancelPoint();
-    XrdSysThread::SetCancelOff();
+  if (mReportNamespace) {
+    // add the record into the report namespace file
+    char path[4096];
+    snprintf(path, sizeof(path) - 1, "%s/%s", gOFS->IoReportStorePath.c_str(),
+             report->path.c_str());
+    eos::common::Path cPath(path);
+
+    if (cPath.MakeParentPath(S_IRWXU)) {
+      FILE* freport = fopen(path, "a+");
+
+      if (freport) {
+        fprintf(freport, "%s\n", body.c_str());
+        fclose(freport);
+      }
+    }
   }
+}
 
-  return 0;
+/* ------------------------------------------------------------------------- */
+void
+Iostat::Merge(Merged& merged)
+{
+  for (size_t i = 0; i < sShards; ++i) {
+    Shard& shard = mShards[i];
+    XrdSysMutexHelper sLock(shard.mMutex);
+
+    for (auto it = shard.mUid.begin(); it != shard.mUid.end(); ++it) {
+      std::vector<Summary>& summary = merged.mUid[it->first];
+      summary.resize(kNumTags);
+
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        summary[tag].Add(it->second.mTotal[tag], it->second.mAvg[tag]);
+      }
+    }
+
+    for (auto it = shard.mGid.begin(); it != shard.mGid.end(); ++it) {
+      std::vector<Summary>& summary = merged.mGid[it->first];
+      summary.resize(kNumTags);
+
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        summary[tag].Add(it->second.mTotal[tag], it->second.mAvg[tag]);
+      }
+    }
+
+    for (auto it = shard.mDomainIOrb.begin(); it != shard.mDomainIOrb.end(); ++it) {
+      merged.mDomainIOrb[it->first].Add(0, it->second);
+    }
+
+    for (auto it = shard.mDomainIOwb.begin(); it != shard.mDomainIOwb.end(); ++it) {
+      merged.mDomainIOwb[it->first].Add(0, it->second);
+    }
+
+    for (auto it = shard.mAppIOrb.begin(); it != shard.mAppIOrb.end(); ++it) {
+      merged.mAppIOrb[it->first].Add(0, it->second);
+    }
+
+    for (auto it = shard.mAppIOwb.begin(); it != shard.mAppIOwb.end(); ++it) {
+      merged.mAppIOwb[it->first].Add(0, it->second);
+    }
+  }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -486,14 +682,25 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
                  bool monitoring, bool numerical, bool top,
                  bool domain, bool apps, XrdOucString option)
 {
-  Mutex.Lock();
+  Merged merged;
+  Merge(merged);
   std::vector<std::string> tags;
   std::vector<std::string>::iterator it;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator
-  tit;
-
-  for (tit = IostatUid.begin(); tit != IostatUid.end(); tit++) {
-    tags.push_back(tit->first);
+  std::map<std::string, Summary> totals;
+
+  if (merged.mUid.size()) {
+    for (int tag = 0; tag < kNumTags; ++tag) {
+      tags.push_back(gTagNames[tag]);
+      Summary& total = totals[gTagNames[tag]];
+
+      for (auto uit = merged.mUid.begin(); uit != merged.mUid.end(); ++uit) {
+        total.mTotal += uit->second[tag].mTotal;
+        total.mAvg60 += uit->second[tag].mAvg60;
+        total.mAvg300 += uit->second[tag].mAvg300;
+        total.mAvg3600 += uit->second[tag].mAvg3600;
+        total.mAvg86400 += uit->second[tag].mAvg86400;
+      }
+    }
   }
 
   std::sort(tags.begin(), tags.end());
@@ -511,14 +718,15 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
 
     for (it = tags.begin(); it != tags.end(); ++it) {
       const char* tag = it->c_str();
+      const Summary& total = totals[*it];
       char a60[1024];
       char a300[1024];
       char a3600[1024];
       char a86400[1024];
-      snprintf(a60, 1023, "%3.02f", GetTotalAvg60(tag));
-      snprintf(a300, 1023, "%3.02f", GetTotalAvg300(tag));
-      snprintf(a3600, 1023, "%3.02f", GetTotalAvg3600(tag));
-      snprintf(a86400, 1023, "%3.02f", GetTotalAvg86400(tag));
+      snprintf(a60, 1023, "%3.02f", total.mAvg60);
+      snprintf(a300, 1023, "%3.02f", total.mAvg300);
+      snprintf(a3600, 1023, "%3.02f", total.mAvg3600);
+      snprintf(a86400, 1023, "%3.02f", total.mAvg86400);
 
       if (!monitoring) {
         XrdOucString sizestring;
@@ -527,18 +735,57 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
         XrdOucString sa3;
         XrdOucString sa4;
         sprintf(outline, "ALL        %-32s %10s %8s %8s %8s %8s\n", tag,
-                eos::common::StringConversion::GetReadableSizeString(sizestring, GetTotal(tag),
+                eos::common::StringConversion::GetReadableSizeString(sizestring, total.mTotal,
                     ""), eos::common::StringConversion::GetReadableSizeString(sa1,
-                        GetTotalAvg60(tag), ""),
-                eos::common::StringConversion::GetReadableSizeString(sa2, GetTotalAvg300(tag),
+                        total.mAvg60, ""),
+                eos::common::StringConversion::GetReadableSizeString(sa2, total.mAvg300,
                     ""), eos::common::StringConversion::GetReadableSizeString(sa3,
-                        GetTotalAvg3600(tag), ""),
-                eos::common::StringConversion::GetReadableSizeString(sa4, GetTotalAvg86400(tag),
+                        total.mAvg3600, ""),
+                eos::common::StringConversion::GetReadableSizeString(sa4, total.mAvg86400,
                     ""));
       } else {
         sprintf(outline,
                 "uid=all gid=all measurement=%s total=%llu 60s=%s 300s=%s 3600s=%s 86400s=%s\n",
-                tag, GetTotal(tag), a60, a300, a3600, a86400);
+                tag, total.mTotal, a60, a300, a3600, a86400);
+      }
+
+      out += outline;
+    }
+
+    {
+      // statistics of the report ingestion itself
+      unsigned long long reports = mReportsIn;
+      unsigned long long binary = mReportsBinary;
+      unsigned long long failed = mReportsFailed;
+      unsigned long long accounted = mAccounted;
+      unsigned long long queued = 0;
+      double rate = 0;
+
+      for (size_t i = 0; i < sShards; ++i) {
+        queued += mShards[i].mTail - mShards[i].mHead;
+      }
+
+      {
+        XrdSysMutexHelper mLock(Mutex);
+        rate = mIngestRate;
+      }
+
+      double decode_us = reports ? (mDecodeNs / 1000.0 / reports) : 0;
+      double account_us = accounted ? (mAccountNs / 1000.0 / accounted) : 0;
+
+      if (!monitoring) {
+        out += "# -----------------------------------------------------------------------------------------------------------\n";
+        out += "# Report ingestion\n";
+        snprintf(outline, sizeof(outline) - 1,
+                 "reports=%llu binary=%llu failed=%llu rate=%.02f/s decode=%.02fus "
+                 "account=%.02fus queued=%llu ringfull=%llu\n", reports, binary, failed,
+                 rate, decode_us, account_us, queued, (unsigned long long) mRingFull);
+      } else {
+        snprintf(outline, sizeof(outline) - 1,
+                 "measurement=ingestion reports=%llu binary=%llu failed=%llu rate=%.02f "
+                 "decode_us=%.02f account_us=%.02f queued=%llu ringfull=%llu\n", reports,
+                 binary, failed, rate, decode_us, account_us, queued,
+                 (unsigned long long) mRingFull);
       }
 
       out += outline;
@@ -574,39 +821,35 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
       out += "# -----------------------------------------------------------------------------------------------------------\n";
     }
 
-    google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, IostatAvg > >::iterator
-    tuit;
-    google::sparse_hash_map<std::string, google::sparse_hash_map<gid_t, IostatAvg > >::iterator
-    tgit;
     std::vector <std::string> uidout;
     std::vector <std::string> gidout;
 
-    for (tuit = IostatAvgUid.begin(); tuit != IostatAvgUid.end(); tuit++) {
-      google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
+    for (auto uit = merged.mUid.begin(); uit != merged.mUid.end(); ++uit) {
+      char identifier[1024];
+
+      if (numerical) {
+        snprintf(identifier, 1023, "uid=%d", uit->first);
+      } else {
+        int terrc = 0;
+        std::string username = eos::common::Mapping::UidToUserName(uit->first, terrc);
 
-      for (it = tuit->second.begin(); it != tuit->second.end(); ++it) {
+        if (monitoring) {
+          snprintf(identifier, 1023, "uid=%s", username.c_str());
+        } else {
+          snprintf(identifier, 1023, "%s", username.c_str());
+        }
+      }
+
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        const Summary& val = uit->second[tag];
         char a60[1024];
         char a300[1024];
         char a3600[1024];
         char a86400[1024];
-        snprintf(a60, 1023, "%3.02f", it->second.GetAvg60());
-        snprintf(a300, 1023, "%3.02f", it->second.GetAvg300());
-        snprintf(a3600, 1023, "%3.02f", it->second.GetAvg3600());
-        snprintf(a86400, 1023, "%3.02f", it->second.GetAvg86400());
-        char identifier[1024];
-
-        if (numerical) {
-          snprintf(identifier, 1023, "uid=%d", it->first);
-        } else {
-          int terrc = 0;
-          std::string username = eos::common::Mapping::UidToUserName(it->first, terrc);
-
-          if (monitoring) {
-            snprintf(identifier, 1023, "uid=%s", username.c_str());
-          } else {
-            snprintf(identifier, 1023, "%s", username.c_str());
-          }
-        }
+        snprintf(a60, 1023, "%3.02f", val.mAvg60);
+        snprintf(a300, 1023, "%3.02f", val.mAvg300);
+        snprintf(a3600, 1023, "%3.02f", val.mAvg3600);
+        snprintf(a86400, 1023, "%3.02f", val.mAvg86400);
 
         if (!monitoring) {
           XrdOucString sizestring;
@@ -615,20 +858,19 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
           XrdOucString sa3;
           XrdOucString sa4;
           sprintf(outline, "%-10s  %-32s %8s %8s %8s %8s %8s\n", identifier,
-                  tuit->first.c_str(), eos::common::StringConversion::GetReadableSizeString(
-                    sizestring, IostatUid[tuit->first.c_str()][it->first], ""),
-                  eos::common::StringConversion::GetReadableSizeString(sa1, it->second.GetAvg60(),
+                  gTagNames[tag], eos::common::StringConversion::GetReadableSizeString(
+                    sizestring, val.mTotal, ""),
+                  eos::common::StringConversion::GetReadableSizeString(sa1, val.mAvg60,
                       ""), eos::common::StringConversion::GetReadableSizeString(sa2,
-                          it->second.GetAvg300(), ""),
+                          val.mAvg300, ""),
                   eos::common::StringConversion::GetReadableSizeString(sa3,
-                      it->second.GetAvg3600(), ""),
+                      val.mAvg3600, ""),
                   eos::common::StringConversion::GetReadableSizeString(sa4,
-                      it->second.GetAvg86400(), ""));
+                      val.mAvg86400, ""));
         } else {
           sprintf(outline,
                   "%s gid=all measurement=%s total=%llu 60s=%s 300s=%s 3600s=%s 86400s=%s\n",
-                  identifier, tuit->first.c_str(), IostatUid[tuit->first.c_str()][it->first], a60,
-                  a300, a3600, a86400);
+                  identifier, gTagNames[tag], val.mTotal, a60, a300, a3600, a86400);
         }
 
         uidout.push_back(outline);
@@ -650,32 +892,32 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
       out += "# --------------------------------------------------------------------------------------\n";
     }
 
-    for (tgit = IostatAvgGid.begin(); tgit != IostatAvgGid.end(); tgit++) {
-      google::sparse_hash_map<gid_t, IostatAvg>::iterator it;
+    for (auto git = merged.mGid.begin(); git != merged.mGid.end(); ++git) {
+      char identifier[1024];
+
+      if (numerical) {
+        snprintf(identifier, 1023, "gid=%d", git->first);
+      } else {
+        int terrc = 0;
+        std::string groupname = eos::common::Mapping::GidToGroupName(git->first, terrc);
+
+        if (monitoring) {
+          snprintf(identifier, 1023, "gid=%s", groupname.c_str());
+        } else {
+          snprintf(identifier, 1023, "%s", groupname.c_str());
+        }
+      }
 
-      for (it = tgit->second.begin(); it != tgit->second.end(); ++it) {
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        const Summary& val = git->second[tag];
         char a60[1024];
         char a300[1024];
         char a3600[1024];
         char a86400[1024];
-        snprintf(a60, 1023, "%3.02f", it->second.GetAvg60());
-        snprintf(a300, 1023, "%3.02f", it->second.GetAvg300());
-        snprintf(a3600, 1023, "%3.02f", it->second.GetAvg3600());
-        snprintf(a86400, 1023, "%3.02f", it->second.GetAvg86400());
-        char identifier[1024];
-
-        if (numerical) {
-          snprintf(identifier, 1023, "gid=%d", it->first);
-        } else {
-          int terrc = 0;
-          std::string groupname = eos::common::Mapping::GidToGroupName(it->first, terrc);
-
-          if (monitoring) {
-            snprintf(identifier, 1023, "gid=%s", groupname.c_str());
-          } else {
-            snprintf(identifier, 1023, "%s", groupname.c_str());
-          }
-        }
+        snprintf(a60, 1023, "%3.02f", val.mAvg60);
+        snprintf(a300, 1023, "%3.02f", val.mAvg300);
+        snprintf(a3600, 1023, "%3.02f", val.mAvg3600);
+        snprintf(a86400, 1023, "%3.02f", val.mAvg86400);
 
         if (!monitoring) {
           XrdOucString sizestring;
@@ -684,20 +926,19 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
           XrdOucString sa3;
           XrdOucString sa4;
           sprintf(outline, "%-10s  %-32s %8s %8s %8s %8s %8s\n", identifier,
-                  tgit->first.c_str(), eos::common::StringConversion::GetReadableSizeString(
-                    sizestring, IostatGid[tgit->first.c_str()][it->first], ""),
-                  eos::common::StringConversion::GetReadableSizeString(sa1, it->second.GetAvg60(),
+                  gTagNames[tag], eos::common::StringConversion::GetReadableSizeString(
+                    sizestring, val.mTotal, ""),
+                  eos::common::StringConversion::GetReadableSizeString(sa1, val.mAvg60,
                       ""), eos::common::StringConversion::GetReadableSizeString(sa2,
-                          it->second.GetAvg300(), ""),
+                          val.mAvg300, ""),
                   eos::common::StringConversion::GetReadableSizeString(sa3,
-                      it->second.GetAvg3600(), ""),
+                      val.mAvg3600, ""),
                   eos::common::StringConversion::GetReadableSizeString(sa4,
-                      it->second.GetAvg86400(), ""));
+                      val.mAvg86400, ""));
         } else {
           sprintf(outline,
                   "%s gid=all measurement=%s total=%llu 60s=%s 300s=%s 3600s=%s 86400s=%s\n",
-                  identifier, tgit->first.c_str(), IostatGid[tgit->first.c_str()][it->first], a60,
-                  a300, a3600, a86400);
+                  identifier, gTagNames[tag], val.mTotal, a60, a300, a3600, a86400);
         }
 
         gidout.push_back(outline);
@@ -717,6 +958,8 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
 
   if (top) {
     for (it = tags.begin(); it != tags.end(); ++it) {
+      int tag = GetTagId(it->c_str());
+
       if (!monitoring) {
         out += "# --------------------------------------------------------------------------------------\n";
         out += "# top IO list by user name: ";
@@ -725,14 +968,12 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
         out += "# --------------------------------------------------------------------------------------\n";
       }
 
-      std::vector <std::string> uidout;
-      std::vector <std::string> gidout;
-      std::vector<std::string>::reverse_iterator sit;
-      google::sparse_hash_map<uid_t, unsigned long long>::iterator tuit;
+      std::vector<std::pair<unsigned long long, unsigned int> > uidout;
+      std::vector<std::pair<unsigned long long, unsigned int> > gidout;
+      std::vector<std::pair<unsigned long long, unsigned int> >::reverse_iterator sit;
 
-      for (tuit = IostatUid[*it].begin(); tuit != IostatUid[*it].end(); tuit++) {
-        sprintf(outline, "%020llu|%u\n", tuit->second, tuit->first);
-        uidout.push_back(outline);
+      for (auto tuit = merged.mUid.begin(); tuit != merged.mUid.end(); tuit++) {
+        uidout.push_back(std::make_pair(tuit->second[tag].mTotal, tuit->first));
       }
 
       std::sort(uidout.begin(), uidout.end());
@@ -740,14 +981,12 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
 
       for (sit = uidout.rbegin(); sit != uidout.rend(); sit++) {
         topplace++;
-        std::string counter = sit->c_str();
-        std::string suid = sit->c_str();
+        char counter[64];
+        snprintf(counter, sizeof(counter), "%020llu", sit->first);
         XrdOucString stopplace = "";
         XrdOucString sizestring = "";
         stopplace += (int) topplace;
-        counter.erase(sit->find("|"));
-        suid.erase(0, sit->find("|") + 1);
-        uid_t uid = atoi(suid.c_str());
+        uid_t uid = sit->second;
         char identifier[1024];
 
         if (numerical) {
@@ -765,10 +1004,10 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
         if (!monitoring) {
           sprintf(outline, "[ %-16s ] %4s. %-10s %s\n", it->c_str(), stopplace.c_str(),
                   identifier, eos::common::StringConversion::GetReadableSizeString(sizestring,
-                      strtoull(counter.c_str(), 0, 10), ""));
+                      sit->first, ""));
         } else {
           sprintf(outline, "measurement=%s rank=%d uid=%s counter=%s\n", it->c_str(),
-                  topplace, identifier, counter.c_str());
+                  topplace, identifier, counter);
         }
 
         out += outline;
@@ -784,11 +1023,8 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
         out += "# --------------------------------------------------------------------------------------\n";
       }
 
-      google::sparse_hash_map<gid_t, unsigned long long>::iterator tgit;
-
-      for (tgit = IostatGid[*it].begin(); tgit != IostatGid[*it].end(); tgit++) {
-        sprintf(outline, "%020llu|%u\n", tgit->second, tgit->first);
-        gidout.push_back(outline);
+      for (auto tgit = merged.mGid.begin(); tgit != merged.mGid.end(); tgit++) {
+        gidout.push_back(std::make_pair(tgit->second[tag].mTotal, tgit->first));
       }
 
       std::sort(gidout.begin(), gidout.end());
@@ -796,35 +1032,33 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
 
       for (sit = gidout.rbegin(); sit != gidout.rend(); sit++) {
         topplace++;
-        std::string counter = sit->c_str();
-        std::string suid = sit->c_str();
+        char counter[64];
+        snprintf(counter, sizeof(counter), "%020llu", sit->first);
         XrdOucString stopplace = "";
         XrdOucString sizestring = "";
         stopplace += (int) topplace;
-        counter.erase(sit->find("|"));
-        suid.erase(0, sit->find("|") + 1);
-        uid_t uid = atoi(suid.c_str());
+        gid_t gid = sit->second;
         char identifier[1024];
 
         if (numerical) {
           if (!monitoring) {
-            snprintf(identifier, 1023, "gid=%d", uid);
+            snprintf(identifier, 1023, "gid=%d", gid);
           } else {
-            snprintf(identifier, 1023, "%d", uid);
+            snprintf(identifier, 1023, "%d", gid);
           }
         } else {
           int terrc = 0;
-          std::string groupname = eos::common::Mapping::GidToGroupName(uid, terrc);
+          std::string groupname = eos::common::Mapping::GidToGroupName(gid, terrc);
           snprintf(identifier, 1023, "%s", groupname.c_str());
         }
 
         if (!monitoring) {
           sprintf(outline, "[ %-16s ] %4s. %-10s %s\n", it->c_str(), stopplace.c_str(),
                   identifier, eos::common::StringConversion::GetReadableSizeString(sizestring,
-                      strtoull(counter.c_str(), 0, 10), ""));
+                      sit->first, ""));
         } else {
           sprintf(outline, "measurement=%s rank=%d gid=%s counter=%s\n", it->c_str(),
-                  topplace, identifier, counter.c_str());
+                  topplace, identifier, counter);
         }
 
         out += outline;
@@ -850,27 +1084,27 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
     }
 
     // IO out bytes
-    google::sparse_hash_map<std::string, IostatAvg>::iterator it;
+    std::map<std::string, Summary>::iterator it;
 
-    for (it = IostatAvgDomainIOrb.begin(); it != IostatAvgDomainIOrb.end(); it++) {
+    for (it = merged.mDomainIOrb.begin(); it != merged.mDomainIOrb.end(); it++) {
       if (!monitoring) {
         sprintf(outline, "%-10s %-32s %9s %8s %8s %8s %8s\n", "OUT", it->first.c_str(),
                 ""
                 , eos::common::StringConversion::GetReadableSizeString(sa1,
-                    (unsigned long long) it->second.GetAvg60(), "")
+                    (unsigned long long) it->second.mAvg60, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa2,
-                    (unsigned long long) it->second.GetAvg300(), "")
+                    (unsigned long long) it->second.mAvg300, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa3,
-                    (unsigned long long) it->second.GetAvg3600(), "")
+                    (unsigned long long) it->second.mAvg3600, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa4,
-                    (unsigned long long) it->second.GetAvg86400(), ""));
+                    (unsigned long long) it->second.mAvg86400, ""));
       } else {
         sprintf(outline,
                 "measurement=%s domain=\"%s\" 60s=%llu 300s=%llu 3600s=%llu 86400s=%llu\n",
-                "domain_io_out", it->first.c_str(), (unsigned long long) it->second.GetAvg60(),
-                (unsigned long long) it->second.GetAvg300(),
-                (unsigned long long) it->second.GetAvg3600(),
-                (unsigned long long) it->second.GetAvg86400());
+                "domain_io_out", it->first.c_str(), (unsigned long long) it->second.mAvg60,
+                (unsigned long long) it->second.mAvg300,
+                (unsigned long long) it->second.mAvg3600,
+                (unsigned long long) it->second.mAvg86400);
       }
 
       out += outline;
@@ -881,25 +1115,25 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
     }
 
     // IO in bytes
-    for (it = IostatAvgDomainIOwb.begin(); it != IostatAvgDomainIOwb.end(); it++) {
+    for (it = merged.mDomainIOwb.begin(); it != merged.mDomainIOwb.end(); it++) {
       if (!monitoring) {
         sprintf(outline, "%-10s %-32s %9s %8s %8s %8s %8s\n", "IN", it->first.c_str(),
                 ""
                 , eos::common::StringConversion::GetReadableSizeString(sa1,
-                    (unsigned long long) it->second.GetAvg60(), "")
+                    (unsigned long long) it->second.mAvg60, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa2,
-                    (unsigned long long) it->second.GetAvg300(), "")
+                    (unsigned long long) it->second.mAvg300, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa3,
-                    (unsigned long long) it->second.GetAvg3600(), "")
+                    (unsigned long long) it->second.mAvg3600, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa4,
-                    (unsigned long long) it->second.GetAvg86400(), ""));
+                    (unsigned long long) it->second.mAvg86400, ""));
       } else {
         sprintf(outline,
                 "measurement=%s domain=\"%s\" 60s=%llu 300s=%llu 3600s=%llu 86400s=%llu\n",
-                "domain_io_in", it->first.c_str(), (unsigned long long) it->second.GetAvg60(),
-                (unsigned long long) it->second.GetAvg300(),
-                (unsigned long long) it->second.GetAvg3600(),
-                (unsigned long long) it->second.GetAvg86400());
+                "domain_io_in", it->first.c_str(), (unsigned long long) it->second.mAvg60,
+                (unsigned long long) it->second.mAvg300,
+                (unsigned long long) it->second.mAvg3600,
+                (unsigned long long) it->second.mAvg86400);
       }
 
       out += outline;
@@ -924,27 +1158,27 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
     }
 
     // IO out bytes
-    google::sparse_hash_map<std::string, IostatAvg>::iterator it;
+    std::map<std::string, Summary>::iterator it;
 
-    for (it = IostatAvgAppIOrb.begin(); it != IostatAvgAppIOrb.end(); it++) {
+    for (it = merged.mAppIOrb.begin(); it != merged.mAppIOrb.end(); it++) {
       if (!monitoring) {
         sprintf(outline, "%-10s %-32s %9s %8s %8s %8s %8s\n", "OUT", it->first.c_str(),
                 ""
                 , eos::common::StringConversion::GetReadableSizeString(sa1,
-                    (unsigned long long) it->second.GetAvg60(), "")
+                    (unsigned long long) it->second.mAvg60, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa2,
-                    (unsigned long long) it->second.GetAvg300(), "")
+                    (unsigned long long) it->second.mAvg300, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa3,
-                    (unsigned long long) it->second.GetAvg3600(), "")
+                    (unsigned long long) it->second.mAvg3600, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa4,
-                    (unsigned long long) it->second.GetAvg86400(), ""));
+                    (unsigned long long) it->second.mAvg86400, ""));
       } else {
         sprintf(outline,
                 "measurement=%s app=\"%s\" 60s=%llu 300s=%llu 3600s=%llu 86400s=%llu\n",
-                "app_io_out", it->first.c_str(), (unsigned long long) it->second.GetAvg60(),
-                (unsigned long long) it->second.GetAvg300(),
-                (unsigned long long) it->second.GetAvg3600(),
-                (unsigned long long) it->second.GetAvg86400());
+                "app_io_out", it->first.c_str(), (unsigned long long) it->second.mAvg60,
+                (unsigned long long) it->second.mAvg300,
+                (unsigned long long) it->second.mAvg3600,
+                (unsigned long long) it->second.mAvg86400);
       }
 
       out += outline;
@@ -955,32 +1189,30 @@ Iostat::PrintOut(XrdOucString& out, bool summary, bool details,
     }
 
     // IO in bytes
-    for (it = IostatAvgAppIOwb.begin(); it != IostatAvgAppIOwb.end(); it++) {
+    for (it = merged.mAppIOwb.begin(); it != merged.mAppIOwb.end(); it++) {
       if (!monitoring) {
         sprintf(outline, "%-10s %-32s %9s %8s %8s %8s %8s\n", "IN", it->first.c_str(),
                 ""
                 , eos::common::StringConversion::GetReadableSizeString(sa1,
-                    (unsigned long long) it->second.GetAvg60(), "")
+                    (unsigned long long) it->second.mAvg60, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa2,
-                    (unsigned long long) it->second.GetAvg300(), "")
+                    (unsigned long long) it->second.mAvg300, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa3,
-                    (unsigned long long) it->second.GetAvg3600(), "")
+                    (unsigned long long) it->second.mAvg3600, "")
                 , eos::common::StringConversion::GetReadableSizeString(sa4,
-                    (unsigned long long) it->second.GetAvg86400(), ""));
+                    (unsigned long long) it->second.mAvg86400, ""));
       } else {
         sprintf(outline,
                 "measurement=%s app=\"%s\" 60s=%llu 300s=%llu 3600s=%llu 86400s=%llu\n",
-                "app_io_in", it->first.c_str(), (unsigned long long) it->second.GetAvg60(),
-                (unsigned long long) it->second.GetAvg300(),
-                (unsigned long long) it->second.GetAvg3600(),
-                (unsigned long long) it->second.GetAvg86400());
+                "app_io_in", it->first.c_str(), (unsigned long long) it->second.mAvg60,
+                (unsigned long long) it->second.mAvg300,
+                (unsigned long long) it->second.mAvg3600,
+                (unsigned long long) it->second.mAvg86400);
       }
 
       out += outline;
     }
   }
-
-  Mutex.UnLock();
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1194,18 +1426,44 @@ Iostat::PrintNs(XrdOucString& out, XrdOucString option)
   }
 
   for (size_t pbin = 0; pbin < days; pbin++) {
-    PopularityMutex.Lock();
     size_t sbin = (IOSTAT_POPULARITY_HISTORY_DAYS + popularitybin - pbin) %
                   IOSTAT_POPULARITY_HISTORY_DAYS;
-    google::sparse_hash_map<std::string, struct Popularity>::const_iterator it;
-    std::vector<popularity_t> popularity_nread(IostatPopularity[sbin].begin(),
-        IostatPopularity[sbin].end());
-    std::vector<popularity_t> popularity_rb(IostatPopularity[sbin].begin(),
-                                            IostatPopularity[sbin].end());
-    // sort them (backwards) by rb or nread
-    std::sort(popularity_nread.begin(), popularity_nread.end(),
-              PopularityCmp_nread());
-    std::sort(popularity_rb.begin(), popularity_rb.end(), PopularityCmp_rb());
+    // the sketches are already ranked, only the top entries are copied
+    std::vector<PopularitySketch::Entry> popularity_nread;
+    std::vector<PopularitySketch::Entry> popularity_rb;
+    PopularityMutex.Lock();
+
+    if (bycount) {
+      IostatPopularityByCount[sbin].Top(limit, popularity_nread);
+    }
+
+    if (bybytes) {
+      IostatPopularityByBytes[sbin].Top(limit, popularity_rb);
+    }
+
+    PopularityMutex.UnLock();
+    // resolve the paths of the ranked files only
+    std::map<eos::common::FileId::fileid_t, std::string> paths;
+    {
+      eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+
+      for (size_t i = 0; i < popularity_nread.size() + popularity_rb.size(); ++i) {
+        eos::common::FileId::fileid_t fid = (i < popularity_nread.size()) ?
+                                            popularity_nread[i].mFid :
+                                            popularity_rb[i - popularity_nread.size()].mFid;
+
+        if (paths.count(fid)) {
+          continue;
+        }
+
+        try {
+          paths[fid] = gOFS->eosView->getUri(gOFS->eosFileService->getFileMD(fid).get());
+        } catch (eos::MDException& e) {
+          paths[fid] = "<undef>";
+        }
+      }
+    }
+
     XrdOucString marker = "<today>";
 
     if (pbin == 1) {
@@ -1232,14 +1490,14 @@ Iostat::PrintNs(XrdOucString& out, XrdOucString option)
       marker = "<6 days ago>";
     }
 
-    std::vector<popularity_t>::const_iterator popit;
+    std::vector<PopularitySketch::Entry>::const_iterator popit;
 
     if (bycount) {
       if (!monitoring) {
         char outline[4096];
         out += "# --------------------------------------------------------------------------------------\n";
-        snprintf(outline, sizeof(outline) - 1, "%-6s %-14s %-14s %-64s\n", "rank",
-                 "by(read count)", "read bytes", "path");
+        snprintf(outline, sizeof(outline) - 1, "%-6s %-14s %-14s %-14s %-64s\n",
+                 "rank", "by(read count)", "overestimate", "read bytes", "path");
         out += outline;
         out += "# --------------------------------------------------------------------------------------\n";
       }
@@ -1249,25 +1507,25 @@ Iostat::PrintNs(XrdOucString& out, XrdOucString option)
       for (popit = popularity_nread.begin(); popit != popularity_nread.end();
            popit++) {
         cnt++;
-
-        if (cnt > limit) {
-          break;
-        }
-
         char line[4096];
         char nr[256];
-        snprintf(nr, sizeof(nr) - 1, "%u", popit->second.nread);
+        char err[256];
+        snprintf(nr, sizeof(nr) - 1, "%llu", popit->mWeight);
+        snprintf(err, sizeof(err) - 1, "%llu", popit->mError);
 
+        // the sketch never underestimates, nread-err is the guaranteed count
         if (monitoring) {
           snprintf(line, sizeof(line) - 1,
-                   "measurement=popularitybyaccess time=%u rank=%d nread=%u rb=%llu path=%s\n",
-                   (unsigned int) tmarker, (int) cnt, popit->second.nread, popit->second.rb,
-                   popit->first.c_str());
+                   "measurement=popularitybyaccess time=%u rank=%d nread=%llu nread_err=%llu rb=%llu path=%s fxid=%08llx\n",
+                   (unsigned int) tmarker, (int) cnt, popit->mWeight, popit->mError,
+                   popit->mRb, paths[popit->mFid].c_str(),
+                   (unsigned long long) popit->mFid);
         } else {
           XrdOucString sizestring;
-          snprintf(line, sizeof(line) - 1, "%06d nread=%-7s rb=%-10s %-64s\n", (int) cnt,
-                   nr, eos::common::StringConversion::GetReadableSizeString(sizestring,
-                       popit->second.rb, "B"), popit->first.c_str());
+          snprintf(line, sizeof(line) - 1, "%06d nread=%-7s err=%-7s rb=%-10s %-64s\n",
+                   (int) cnt, nr, err,
+                   eos::common::StringConversion::GetReadableSizeString(sizestring,
+                       popit->mRb, "B"), paths[popit->mFid].c_str());
         }
 
         out += line;
@@ -1278,8 +1536,8 @@ Iostat::PrintNs(XrdOucString& out, XrdOucString option)
       if (!monitoring) {
         char outline[4096];
         out += "# --------------------------------------------------------------------------------------\n";
-        snprintf(outline, sizeof(outline) - 1, "%-6s %-14s %-14s %-64s\n", "rank",
-                 "by(read bytes)", "read count", "path");
+        snprintf(outline, sizeof(outline) - 1, "%-6s %-14s %-14s %-14s %-64s\n",
+                 "rank", "by(read bytes)", "overestimate", "read count", "path");
         out += outline;
         out += "# --------------------------------------------------------------------------------------\n";
       }
@@ -1288,32 +1546,30 @@ Iostat::PrintNs(XrdOucString& out, XrdOucString option)
 
       for (popit = popularity_rb.begin(); popit != popularity_rb.end(); popit++) {
         cnt++;
-
-        if (cnt > limit) {
-          break;
-        }
-
         char line[4096];
         char nr[256];
-        snprintf(nr, sizeof(nr) - 1, "%u", popit->second.nread);
+        snprintf(nr, sizeof(nr) - 1, "%llu", popit->mNread);
 
+        // the sketch never underestimates, rb-err is the guaranteed volume
         if (monitoring) {
           snprintf(line, sizeof(line) - 1,
-                   "measurement=popularitybyvolume time=%u rank=%d nread=%u rb=%llu path=%s\n",
-                   (unsigned int) tmarker, (int) cnt, popit->second.nread, popit->second.rb,
-                   popit->first.c_str());
+                   "measurement=popularitybyvolume time=%u rank=%d nread=%llu rb=%llu rb_err=%llu path=%s fxid=%08llx\n",
+                   (unsigned int) tmarker, (int) cnt, popit->mNread, popit->mWeight,
+                   popit->mError, paths[popit->mFid].c_str(),
+                   (unsigned long long) popit->mFid);
         } else {
           XrdOucString sizestring;
-          snprintf(line, sizeof(line) - 1, "%06d rb=%-10s nread=%-7s %-64s\n", (int) cnt,
-                   eos::common::StringConversion::GetReadableSizeString(sizestring,
-                       popit->second.rb, "B"), nr, popit->first.c_str());
+          XrdOucString errstring;
+          snprintf(line, sizeof(line) - 1, "%06d rb=%-10s err=%-10s nread=%-7s %-64s\n",
+                   (int) cnt, eos::common::StringConversion::GetReadableSizeString(sizestring,
+                       popit->mWeight, "B"),
+                   eos::common::StringConversion::GetReadableSizeString(errstring,
+                       popit->mError, "B"), nr, paths[popit->mFid].c_str());
         }
 
         out += line;
       }
     }
-
-    PopularityMutex.UnLock();
   }
 }
 
@@ -1342,33 +1598,39 @@ Iostat::Store()
     return false;
   }
 
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator
-  tuit;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >::iterator
-  tgit;
-  Mutex.Lock();
+  // the counters of a uid are in one shard, the ones of a gid are summed
+  std::map<gid_t, std::vector<unsigned long long> > gids;
+
+  for (size_t i = 0; i < sShards; ++i) {
+    Shard& shard = mShards[i];
+    XrdSysMutexHelper sLock(shard.mMutex);
+
+    // store user counters
+    for (auto it = shard.mUid.begin(); it != shard.mUid.end(); ++it) {
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        fprintf(fout, "tag=%s&uid=%u&val=%llu\n", gTagNames[tag], it->first,
+                it->second.mTotal[tag]);
+      }
+    }
 
-  // store user counters
-  for (tuit = IostatUid.begin(); tuit != IostatUid.end(); tuit++) {
-    google::sparse_hash_map<uid_t, unsigned long long>::iterator it;
+    for (auto it = shard.mGid.begin(); it != shard.mGid.end(); ++it) {
+      std::vector<unsigned long long>& total = gids[it->first];
+      total.resize(kNumTags, 0);
 
-    for (it = tuit->second.begin(); it != tuit->second.end(); ++it) {
-      fprintf(fout, "tag=%s&uid=%u&val=%llu\n", tuit->first.c_str(), it->first,
-              it->second);
+      for (int tag = 0; tag < kNumTags; ++tag) {
+        total[tag] += it->second.mTotal[tag];
+      }
     }
   }
 
   // store group counter
-  for (tgit = IostatGid.begin(); tgit != IostatGid.end(); tgit++) {
-    google::sparse_hash_map<uid_t, unsigned long long>::iterator it;
-
-    for (it = tgit->second.begin(); it != tgit->second.end(); ++it) {
-      fprintf(fout, "tag=%s&gid=%u&val=%llu\n", tgit->first.c_str(), it->first,
-              it->second);
+  for (auto it = gids.begin(); it != gids.end(); ++it) {
+    for (int tag = 0; tag < kNumTags; ++tag) {
+      fprintf(fout, "tag=%s&gid=%u&val=%llu\n", gTagNames[tag], it->first,
+              it->second[tag]);
     }
   }
 
-  Mutex.UnLock();
   fclose(fout);
   return (rename(tmpname.c_str(), mStoreFileName.c_str()) ? false : true);
 }
@@ -1390,7 +1652,6 @@ Iostat::Restore()
     return false;
   }
 
-  Mutex.Lock();
   int item = 0;
   char line[16384];
 
@@ -1398,22 +1659,35 @@ Iostat::Restore()
   while ((item = fscanf(fin, "%s\n", line)) == 1) {
     XrdOucEnv env(line);
 
-    if (env.Get("tag") && env.Get("uid") && env.Get("val")) {
-      std::string tag = env.Get("tag");
+    if (!env.Get("tag") || !env.Get("val")) {
+      continue;
+    }
+
+    int tag = GetTagId(env.Get("tag"));
+
+    if (tag < 0) {
+      eos_static_debug("msg=\"skipping unknown tag\" tag=%s", env.Get("tag"));
+      continue;
+    }
+
+    unsigned long long val = strtoull(env.Get("val"), 0, 10);
+
+    if (env.Get("uid")) {
       uid_t uid = atoi(env.Get("uid"));
-      unsigned long long val = strtoull(env.Get("val"), 0, 10);
-      IostatUid[tag][uid] = val;
+      Shard& shard = mShards[uid % sShards];
+      XrdSysMutexHelper sLock(shard.mMutex);
+      shard.mUid[uid].mTotal[tag] = val;
     }
 
-    if (env.Get("tag") && env.Get("gid") && env.Get("val")) {
-      std::string tag = env.Get("tag");
+    if (env.Get("gid")) {
+      // the sum over the shards is the stored value
       gid_t gid = atoi(env.Get("gid"));
-      unsigned long long val = strtoull(env.Get("val"), 0, 10);
-      IostatGid[tag][gid] = val;
+      Shard& shard = mShards[0];
+      XrdSysMutexHelper sLock(shard.mMutex);
+      shard.mGid[gid].mTotal[tag] = val;
     }
   }
 
-  Mutex.UnLock();
   fclose(fin);
   return true;
 }
@@ -1496,59 +1770,66 @@ Iostat::Circulate()
     sc++;
     XrdSysTimer sleeper;
     sleeper.Wait(512);
-    Mutex.Lock();
-    google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, IostatAvg> >::iterator
-    tit;
-    google::sparse_hash_map<std::string, IostatAvg >::iterator dit;
-
-    // loop over tags
-    for (tit = IostatAvgUid.begin(); tit != IostatAvgUid.end(); ++tit) {
-      // loop over vids
-      google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
-
-      for (it = tit->second.begin(); it != tit->second.end(); ++it) {
-        it->second.StampZero();
+
+    for (size_t i = 0; i < sShards; ++i) {
+      Shard& shard = mShards[i];
+      XrdSysMutexHelper sLock(shard.mMutex);
+
+      // loop over uids and gids
+      for (auto it = shard.mUid.begin(); it != shard.mUid.end(); ++it) {
+        for (int tag = 0; tag < kNumTags; ++tag) {
+          it->second.mAvg[tag].StampZero();
+        }
       }
-    }
 
-    for (tit = IostatAvgGid.begin(); tit != IostatAvgGid.end(); ++tit) {
-      // loop over vids
-      google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
+      for (auto it = shard.mGid.begin(); it != shard.mGid.end(); ++it) {
+        for (int tag = 0; tag < kNumTags; ++tag) {
+          it->second.mAvg[tag].StampZero();
+        }
+      }
 
-      for (it = tit->second.begin(); it != tit->second.end(); ++it) {
-        it->second.StampZero();
+      // loop over domain accounting
+      for (auto dit = shard.mDomainIOrb.begin(); dit != shard.mDomainIOrb.end();
+           dit++) {
+        dit->second.StampZero();
       }
-    }
 
-    // loop over domain accounting
-    for (dit = IostatAvgDomainIOrb.begin(); dit != IostatAvgDomainIOrb.end();
-         dit++) {
-      dit->second.StampZero();
-    }
+      for (auto dit = shard.mDomainIOwb.begin(); dit != shard.mDomainIOwb.end();
+           dit++) {
+        dit->second.StampZero();
+      }
 
-    for (dit = IostatAvgDomainIOwb.begin(); dit != IostatAvgDomainIOwb.end();
-         dit++) {
-      dit->second.StampZero();
-    }
+      // loop over app accounting
+      for (auto dit = shard.mAppIOrb.begin(); dit != shard.mAppIOrb.end(); dit++) {
+        dit->second.StampZero();
+      }
 
-    // loop over app accounting
-    for (dit = IostatAvgAppIOrb.begin(); dit != IostatAvgAppIOrb.end(); dit++) {
-      dit->second.StampZero();
+      for (auto dit = shard.mAppIOwb.begin(); dit != shard.mAppIOwb.end(); dit++) {
+        dit->second.StampZero();
+      }
     }
 
-    for (dit = IostatAvgAppIOwb.begin(); dit != IostatAvgAppIOwb.end(); dit++) {
-      dit->second.StampZero();
+    {
+      // rate of the received reports over the last ~5 seconds
+      time_t now = time(NULL);
+
+      if (now - mLastRateTime >= 5) {
+        unsigned long long reports = mReportsIn;
+        XrdSysMutexHelper mLock(Mutex);
+        mIngestRate = 1.0 * (reports - mLastReportsIn) / (now - mLastRateTime);
+        mLastReportsIn = reports;
+        mLastRateTime = now;
+      }
     }
 
-    Mutex.UnLock();
     size_t popularitybin = (((time(NULL))) % (IOSTAT_POPULARITY_DAY *
                             IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
 
     if (IostatLastPopularityBin != popularitybin) {
       // only if we enter a new bin we erase it
       PopularityMutex.Lock();
-      IostatPopularity[popularitybin].clear();
-      IostatPopularity[popularitybin].resize(10000);
+      IostatPopularityByCount[popularitybin].Clear();
+      IostatPopularityByBytes[popularitybin].Clear();
       IostatLastPopularityBin = popularitybin;
       PopularityMutex.UnLock();
     }
@@ -25,6 +25,7 @@
 #define __EOSMGM_IOSTAT__HH__
 
 #include "mgm/Namespace.hh"
+#include "mgm/PopularitySketch.hh"
 #include "mq/XrdMqClient.hh"
 #include "common/Logging.hh"
 #include "common/FileId.hh"
@@ -33,8 +34,13 @@
 #include "XrdSys/XrdSysPthread.hh"
 #include <google/sparse_hash_map>
 #include <sys/types.h>
+#include <atomic>
+#include <map>
 #include <string>
 #include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -202,68 +208,145 @@ class Iostat
   // -------------------------------------------------------------
   // ! subscribes to our MQ, collects and digestes report messages
   // -------------------------------------------------------------
-private:
+public:
+  //! Ids of the measurements taken from every report
+  enum Tag {
+    kBytesRead = 0,
+    kBytesWritten,
+    kReadCalls,
+    kReadvCalls,
+    kWriteCalls,
+    kFwdSeeks,
+    kBwdSeeks,
+    kXlFwdSeeks,
+    kXlBwdSeeks,
+    kBytesFwdSeek,
+    kBytesBwdSeek,
+    kBytesXlFwdSeek,
+    kBytesXlBwdSeek,
+    kDiskTimeRead,
+    kDiskTimeWrite,
+    kNumTags
+  };
 
-  XrdSysMutex Mutex;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, unsigned long long> >
-  IostatUid;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<gid_t, unsigned long long> >
-  IostatGid;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<uid_t, IostatAvg> >
-  IostatAvgUid;
-  google::sparse_hash_map<std::string, google::sparse_hash_map<gid_t, IostatAvg> >
-  IostatAvgGid;
+  //! Names of the measurements as printed and stored
+  static const char* gTagNames[kNumTags];
 
-  google::sparse_hash_map<std::string, IostatAvg> IostatAvgDomainIOrb;
-  google::sparse_hash_map<std::string, IostatAvg> IostatAvgDomainIOwb;
+  //! Get the id of a measurement name, -1 if unknown
+  static int GetTagId(const char* tag);
 
-  google::sparse_hash_map<std::string, IostatAvg> IostatAvgAppIOrb;
-  google::sparse_hash_map<std::string, IostatAvg> IostatAvgAppIOwb;
+private:
+  //! Counters of one user or group
+  struct Counters {
+    unsigned long long mTotal[kNumTags];
+    IostatAvg mAvg[kNumTags];
 
-  std::set<std::string> IoDomains;
-  std::set<std::string> IoNodes;
+    Counters()
+    {
+      memset(mTotal, 0, sizeof(mTotal));
+    }
+  };
 
-  // -----------------------------------------------------------
-  // here we handle the popularity history for the last 7+1 days
-  // -----------------------------------------------------------
+  //! Counter values merged over the shards
+  struct Summary {
+    unsigned long long mTotal;
+    double mAvg60;
+    double mAvg300;
+    double mAvg3600;
+    double mAvg86400;
 
-  XrdSysMutex PopularityMutex;
+    Summary(): mTotal(0), mAvg60(0), mAvg300(0), mAvg3600(0), mAvg86400(0) {}
 
-  struct Popularity {
-    unsigned int nread;
-    unsigned long long rb;
+    void
+    Add(unsigned long long total, IostatAvg& avg)
+    {
+      mTotal += total;
+      mAvg60 += avg.GetAvg60();
+      mAvg300 += avg.GetAvg300();
+      mAvg3600 += avg.GetAvg3600();
+      mAvg86400 += avg.GetAvg86400();
+    }
   };
 
-  size_t IostatLastPopularityBin; // this points to the bin which was last used in IostatPopularity
+  //! All the counters merged over the shards
+  struct Merged {
+    std::map<uid_t, std::vector<Summary> > mUid;
+    std::map<gid_t, std::vector<Summary> > mGid;
+    std::map<std::string, Summary> mDomainIOrb;
+    std::map<std::string, Summary> mDomainIOwb;
+    std::map<std::string, Summary> mAppIOrb;
+    std::map<std::string, Summary> mAppIOwb;
+  };
 
-  google::sparse_hash_map<std::string, struct Popularity>
-    IostatPopularity[ IOSTAT_POPULARITY_HISTORY_DAYS ];
+  //! A report handed from the receiver to a shard worker
+  struct Received {
+    eos::common::Report mReport;
+    std::string mBody; ///< Report as received if it was not binary
+  };
 
-  typedef std::pair<std::string, struct Popularity> popularity_t;
+  // -----------------------------------------------------------
+  // The reports are decoded by the receiver thread and handed to
+  // the shard of their uid through a single producer single
+  // consumer ring. Each shard has its own worker and counters,
+  // which are only merged when they are printed or stored. The
+  // counters of a uid are always in the same shard, the ones of
+  // gids, domains and applications are summed over the shards.
+  // -----------------------------------------------------------
+  struct Shard {
+    XrdSysMutex mMutex; ///< Protecting the counters
+    std::unordered_map<uid_t, Counters> mUid;
+    std::unordered_map<gid_t, Counters> mGid;
+    std::map<std::string, IostatAvg> mDomainIOrb;
+    std::map<std::string, IostatAvg> mDomainIOwb;
+    std::map<std::string, IostatAvg> mAppIOrb;
+    std::map<std::string, IostatAvg> mAppIOwb;
+    std::vector<Received*> mRing; ///< Reports not yet accounted
+    std::atomic<size_t> mHead; ///< Next slot read by the worker
+    std::atomic<size_t> mTail; ///< Next slot written by the receiver
+    std::thread mThread;
+
+    Shard(): mHead(0), mTail(0) {}
+  };
 
-  struct PopularityCmp_nread {
+  static const size_t sShards = 8;
+  static const size_t sRingSize = 16384;
+  Shard mShards[sShards];
+  std::atomic<bool> mStopWorkers;
+
+  // ingestion statistics
+  std::atomic<unsigned long long> mReportsIn; ///< Reports received
+  std::atomic<unsigned long long> mReportsBinary; ///< Reports in binary format
+  std::atomic<unsigned long long> mReportsFailed; ///< Reports not decoded
+  std::atomic<unsigned long long> mRingFull; ///< Waits for a full ring
+  std::atomic<unsigned long long> mDecodeNs; ///< Time spent decoding
+  std::atomic<unsigned long long> mAccountNs; ///< Time spent accounting
+  std::atomic<unsigned long long> mAccounted; ///< Reports accounted
+  double mIngestRate; ///< Reports per second (protected by this::Mutex)
+  unsigned long long mLastReportsIn; ///< Used by Circulate for the rate
+  time_t mLastRateTime; ///< Used by Circulate for the rate
 
-    bool operator()(popularity_t const& l, popularity_t const& r)
-    {
-      if (l.second.nread == r.second.nread) {
-        return (l.first < r.first);
-      }
+  XrdSysMutex Mutex;
+  XrdSysMutex ReportMutex; ///< Protecting the report log file
+  XrdOucString mOpenReportFile; ///< Name of the open report log file
+  FILE* mOpenReportFd; ///< Open report log file
 
-      return l.second.nread > r.second.nread;
-    }
-  };
+  std::set<std::string> IoDomains;
+  std::set<std::string> IoNodes;
+
+  // -----------------------------------------------------------
+  // here we handle the popularity history for the last 7+1 days
+  // -----------------------------------------------------------
 
-  struct PopularityCmp_rb {
+  XrdSysMutex PopularityMutex;
 
-    bool operator()(popularity_t const& l, popularity_t const& r)
-    {
-      if (l.second.rb == r.second.rb) {
-        return (l.first < r.first);
-      }
+  size_t IostatLastPopularityBin; // this points to the bin which was last used in the popularity sketches
 
-      return l.second.rb > r.second.rb;
-    }
-  };
+  // most read files of a day, by number of reads and by bytes read
+  std::vector<PopularitySketch> IostatPopularityByCount;
+  std::vector<PopularitySketch> IostatPopularityByBytes;
+
+  // number of files tracked per day, the longest ranking printed
+  static const size_t sPopularityFiles = 10000;
 
 
   bool mReport; // indicates if we store reports to the local report store
@@ -343,135 +426,45 @@ public:
   static void* StaticCirculate(void*);
   void* Receive();
 
+  //! Hand a decoded report to the worker of its shard
+  void Enqueue(Received* received);
+
+  //! Worker accounting the reports of a shard
+  void Worker(size_t shard);
+
+  //! Account a report into the counters of a shard
+  void Account(Shard& shard, eos::common::Report& report);
+
+  //! Popularity, broadcasting and report files of a report
+  void Publish(Received& received);
+
+  //! Merge the counters of all the shards
+  void Merge(Merged& merged);
+
+  //! Start and stop the shard workers
+  void StartWorkers();
+  void StopWorkers();
+
   static bool NamespaceReport(const char* path, XrdOucString& stdOut,
                               XrdOucString& stdErr);
 
   void
-  AddToPopularity(std::string path, unsigned long long rb, time_t starttime,
-                  time_t stoptime)
+  AddToPopularity(eos::common::FileId::fileid_t fid, unsigned long long rb,
+                  time_t starttime, time_t stoptime)
   {
     size_t popularitybin = (((starttime + stoptime) / 2) % (IOSTAT_POPULARITY_DAY *
                             IOSTAT_POPULARITY_HISTORY_DAYS)) / IOSTAT_POPULARITY_DAY;
     PopularityMutex.Lock();
-    eos::common::Path cPath(path.c_str());
+    IostatPopularityByCount[popularitybin].Add(fid, 1, rb);
 
-    for (size_t k = 0; k < cPath.GetSubPathSize(); k++) {
-      std::string sp = cPath.GetSubPath(k);
-      IostatPopularity[popularitybin][sp].rb += rb;
-      IostatPopularity[popularitybin][sp].nread++;
+    if (rb) {
+      IostatPopularityByBytes[popularitybin].Add(fid, rb, rb);
     }
 
     IostatLastPopularityBin = popularitybin;
     PopularityMutex.UnLock();
   }
 
-  // stats collection
-
-  void
-  Add(const char* tag, uid_t uid, gid_t gid, unsigned long val, time_t starttime,
-      time_t stoptime)
-  {
-    Mutex.Lock();
-    IostatUid[tag][uid] += val;
-    IostatGid[tag][gid] += val;
-    IostatAvgUid[tag][uid].Add(val, starttime, stoptime);
-    IostatAvgGid[tag][gid].Add(val, starttime, stoptime);
-    Mutex.UnLock();
-  }
-
-  unsigned long long
-  GetTotal(const char* tag)
-  {
-    google::sparse_hash_map<uid_t, unsigned long long>::const_iterator it;
-    unsigned long long val = 0;
-
-    if (!IostatUid.count(tag)) {
-      return 0;
-    }
-
-    for (it = IostatUid[tag].begin(); it != IostatUid[tag].end(); ++it) {
-      val += it->second;
-    }
-
-    return val;
-  }
-
-  // warning: you have to lock the mutex if directly used
-
-  double
-  GetTotalAvg86400(const char* tag)
-  {
-    google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
-    double val = 0;
-
-    if (!IostatAvgUid.count(tag)) {
-      return 0;
-    }
-
-    for (it = IostatAvgUid[tag].begin(); it != IostatAvgUid[tag].end(); ++it) {
-      val += it->second.GetAvg86400();
-    }
-
-    return val;
-  }
-
-  // warning: you have to lock the mutex if directly used
-
-  double
-  GetTotalAvg3600(const char* tag)
-  {
-    google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
-    double val = 0;
-
-    if (!IostatAvgUid.count(tag)) {
-      return 0;
-    }
-
-    for (it = IostatAvgUid[tag].begin(); it != IostatAvgUid[tag].end(); ++it) {
-      val += it->second.GetAvg3600();
-    }
-
-    return val;
-  }
-
-  // warning: you have to lock the mutex if directly used
-
-  double
-  GetTotalAvg300(const char* tag)
-  {
-    google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
-    double val = 0;
-
-    if (!IostatAvgUid.count(tag)) {
-      return 0;
-    }
-
-    for (it = IostatAvgUid[tag].begin(); it != IostatAvgUid[tag].end(); ++it) {
-      val += it->second.GetAvg300();
-    }
-
-    return val;
-  }
-
-  // warning: you have to lock the mutex if directly used
-
-  double
-  GetTotalAvg60(const char* tag)
-  {
-    google::sparse_hash_map<uid_t, IostatAvg>::iterator it;
-    double val = 0;
-
-    if (!IostatAvgUid.count(tag)) {
-      return 0;
-    }
-
-    for (it = IostatAvgUid[tag].begin(); it != IostatAvgUid[tag].end(); ++it) {
-      val += it->second.GetAvg60();
-    }
-
-    return val;
-  }
-
   void* Circulate();
 };
 
@@ -0,0 +1,276 @@
+//------------------------------------------------------------------------------
+// File: JobJournal.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/JobJournal.hh"
+#include "common/Logging.hh"
+#include <fstream>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//! Length of the checksum closing every line, " xxxxxxxx"
+static const size_t sChecksumLength = 9;
+
+//------------------------------------------------------------------------------
+// FNV-1a hash of a line
+//------------------------------------------------------------------------------
+static uint32_t
+LineChecksum(const char* data, size_t length)
+{
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= (unsigned char) data[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+JobJournal::JobJournal(const std::string& name):
+  mName(name), mFd(-1), mDirty(false), mLines(0)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+JobJournal::~JobJournal()
+{
+  if (mFd >= 0) {
+    fdatasync(mFd);
+    close(mFd);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Read an existing journal
+//------------------------------------------------------------------------------
+bool
+JobJournal::Read(const std::string& path,
+                 const std::function<void(const std::string&)>& replay)
+{
+  mPath = path;
+  mLines = 0;
+  std::ifstream journal(path.c_str());
+
+  if (!journal.is_open()) {
+    return false;
+  }
+
+  std::string line;
+
+  while (std::getline(journal, line)) {
+    mLines++;
+
+    if (line.empty()) {
+      continue;
+    }
+
+    // a line torn by a crash does not carry its checksum
+    if (!Unseal(line)) {
+      eos_static_warning("msg=\"skipping torn %s journal line\" path=\"%s\" "
+                         "line=%llu", mName.c_str(), path.c_str(), mLines);
+      continue;
+    }
+
+    replay(line);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Add the checksum and the line end to a line
+//------------------------------------------------------------------------------
+std::string
+JobJournal::Seal(const std::string& line)
+{
+  char checksum[16];
+  snprintf(checksum, sizeof(checksum), " %08x\n",
+           LineChecksum(line.c_str(), line.length()));
+  return line + checksum;
+}
+
+//------------------------------------------------------------------------------
+// Verify and strip the checksum of a line
+//------------------------------------------------------------------------------
+bool
+JobJournal::Unseal(std::string& line)
+{
+  if (line.length() < sChecksumLength) {
+    return false;
+  }
+
+  size_t length = line.length() - sChecksumLength;
+
+  if (line[length] != ' ') {
+    return false;
+  }
+
+  for (size_t i = length + 1; i < line.length(); ++i) {
+    if (!isxdigit((unsigned char) line[i])) {
+      return false;
+    }
+  }
+
+  uint32_t checksum = strtoul(line.c_str() + length + 1, 0, 16);
+
+  if (checksum != LineChecksum(line.c_str(), length)) {
+    return false;
+  }
+
+  line.resize(length);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Append a line
+//------------------------------------------------------------------------------
+void
+JobJournal::Append(const std::string& line)
+{
+  if (mFd < 0) {
+    return;
+  }
+
+  std::string data = Seal(line);
+  const char* ptr = data.c_str();
+  size_t left = data.length();
+
+  while (left) {
+    ssize_t nwrite = write(mFd, ptr, left);
+
+    if (nwrite < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      eos_static_err("msg=\"failed to append to %s journal\" errno=%d",
+                     mName.c_str(), errno);
+      return;
+    }
+
+    ptr += nwrite;
+    left -= nwrite;
+  }
+
+  mLines++;
+  mDirty = true;
+}
+
+//------------------------------------------------------------------------------
+// Flush the appended lines to disk
+//------------------------------------------------------------------------------
+void
+JobJournal::Sync()
+{
+  if (mDirty && (mFd >= 0)) {
+    fdatasync(mFd);
+    mDirty = false;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Check if the journal should be rewritten
+//------------------------------------------------------------------------------
+bool
+JobJournal::NeedsRewrite(size_t pending) const
+{
+  return ((mLines > sMinRewriteLines) && (mLines > 4 * pending));
+}
+
+//------------------------------------------------------------------------------
+// Atomically replace the journal with the given lines
+//------------------------------------------------------------------------------
+void
+JobJournal::Rewrite(const std::vector<std::string>& lines)
+{
+  if (mPath.empty()) {
+    return;
+  }
+
+  std::string tmppath = mPath + ".tmp";
+  int fd = open(tmppath.c_str(), O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+
+  if (fd < 0) {
+    eos_static_err("msg=\"failed to create %s journal\" path=\"%s\" errno=%d",
+                   mName.c_str(), tmppath.c_str(), errno);
+    return;
+  }
+
+  std::string buffer;
+  bool ok = true;
+
+  for (size_t i = 0; i < lines.size(); ++i) {
+    buffer += Seal(lines[i]);
+
+    if ((buffer.length() > 65536) || ((i + 1) == lines.size())) {
+      if (write(fd, buffer.c_str(), buffer.length()) != (ssize_t) buffer.length()) {
+        ok = false;
+        break;
+      }
+
+      buffer.clear();
+    }
+  }
+
+  if (ok && fsync(fd)) {
+    ok = false;
+  }
+
+  if (close(fd)) {
+    ok = false;
+  }
+
+  if (!ok || rename(tmppath.c_str(), mPath.c_str())) {
+    eos_static_err("msg=\"failed to write %s journal\" path=\"%s\" errno=%d",
+                   mName.c_str(), tmppath.c_str(), errno);
+    unlink(tmppath.c_str());
+    return;
+  }
+
+  if (mFd >= 0) {
+    close(mFd);
+  }
+
+  mFd = open(mPath.c_str(), O_WRONLY | O_APPEND);
+
+  if (mFd < 0) {
+    eos_static_err("msg=\"failed to open %s journal\" path=\"%s\" errno=%d",
+                   mName.c_str(), mPath.c_str(), errno);
+  }
+
+  mLines = lines.size();
+  mDirty = false;
+}
+
+EOSMGMNAMESPACE_END
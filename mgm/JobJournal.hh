@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------
+// File: JobJournal.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_JOBJOURNAL__HH__
+#define __EOSMGM_JOBJOURNAL__HH__
+
+#include "mgm/Namespace.hh"
+#include <functional>
+#include <string>
+#include <vector>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Append-only journal of a job queue kept in a local file.
+//!
+//! The owner appends one line per state change of a job and replays the
+//! lines at start-up. Every line is closed by a checksum so that a line torn
+//! by a crash is skipped instead of being replayed truncated. Appended lines go to the page cache right away, so they
+//! survive a crash of the MGM, and are flushed to disk by Sync. When the
+//! journal grows much larger than the pending jobs the owner rewrites it
+//! with one line per pending job.
+//!
+//! The class is not thread-safe, the owner serialises the calls with the
+//! mutex protecting its queue.
+//------------------------------------------------------------------------------
+class JobJournal
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param name name of the journal used in the log messages
+  //----------------------------------------------------------------------------
+  JobJournal(const std::string& name);
+
+  //----------------------------------------------------------------------------
+  //! Destructor, flushes and closes the journal
+  //----------------------------------------------------------------------------
+  ~JobJournal();
+
+  //----------------------------------------------------------------------------
+  //! Read an existing journal. The file is only opened for appending by the
+  //! first Rewrite.
+  //!
+  //! @param path journal file
+  //! @param replay called with every non empty line whose checksum is
+  //!        correct, the checksum is stripped
+  //!
+  //! @return false if there is no journal
+  //----------------------------------------------------------------------------
+  bool Read(const std::string& path,
+            const std::function<void(const std::string&)>& replay);
+
+  //----------------------------------------------------------------------------
+  //! Append a line
+  //----------------------------------------------------------------------------
+  void Append(const std::string& line);
+
+  //----------------------------------------------------------------------------
+  //! Flush the appended lines to disk
+  //----------------------------------------------------------------------------
+  void Sync();
+
+  //----------------------------------------------------------------------------
+  //! Check if the journal should be rewritten
+  //!
+  //! @param pending number of pending jobs
+  //----------------------------------------------------------------------------
+  bool NeedsRewrite(size_t pending) const;
+
+  //----------------------------------------------------------------------------
+  //! Atomically replace the journal with the given lines and reopen it for
+  //! appending. The journal is left unchanged if the new one can not be
+  //! written.
+  //----------------------------------------------------------------------------
+  void Rewrite(const std::vector<std::string>& lines);
+
+  //----------------------------------------------------------------------------
+  //! Check if the journal is open for appending
+  //----------------------------------------------------------------------------
+  bool IsOpen() const
+  {
+    return (mFd >= 0);
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get the number of lines in the journal
+  //----------------------------------------------------------------------------
+  unsigned long long GetLines() const
+  {
+    return mLines;
+  }
+
+private:
+  //----------------------------------------------------------------------------
+  //! Add the checksum and the line end to a line
+  //----------------------------------------------------------------------------
+  static std::string Seal(const std::string& line);
+
+  //----------------------------------------------------------------------------
+  //! Verify and strip the checksum of a line
+  //!
+  //! @return false if the line is torn or corrupted
+  //----------------------------------------------------------------------------
+  static bool Unseal(std::string& line);
+
+  std::string mName; ///< Name used in the log messages
+  std::string mPath; ///< Journal file
+  int mFd; ///< Journal file descriptor, -1 if not open
+  bool mDirty; ///< Lines appended since the last Sync
+  unsigned long long mLines; ///< Lines in the journal
+
+  //! Journal lines below which the journal is never rewritten
+  static const unsigned long long sMinRewriteLines = 10000;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -28,6 +28,7 @@
 #include "common/RWMutex.hh"
 #include "mgm/Quota.hh"
 #include "mgm/LRU.hh"
+#include "mgm/AttrIndex.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mgm/XrdMgmOfsDirectory.hh"
 /*----------------------------------------------------------------------------*/
@@ -194,7 +195,13 @@ LRU::LRUr ()
 
       EXEC_TIMING_BEGIN("LRUFind");
 
-      if (!gOFS->_find("/",
+      // the attribute index is built once, afterwards it replaces the full
+      // namespace find
+      bool indexed = AttrIndex::Rebuild(ms) &&
+                     AttrIndex::Find(gLRUPolicyPrefix, lrudirs);
+
+      if (indexed ||
+          !gOFS->_find("/",
                        mError,
                        stdErr,
                        mRootVid,
@@ -207,8 +214,8 @@ LRU::LRUr ()
                        )
           )
       {
-        eos_static_info("msg=\"finished LRU find\" LRU-dirs=%llu",
-                        lrudirs.size()
+        eos_static_info("msg=\"finished LRU find\" LRU-dirs=%llu indexed=%d",
+                        lrudirs.size(), indexed
                         );
 
         // scan backwards ... in this way we get rid of empty directories in one go ...
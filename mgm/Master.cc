@@ -25,6 +25,8 @@
 #include "mgm/FsView.hh"
 #include "mgm/Access.hh"
 #include "mgm/Quota.hh"
+#include "mgm/AttrIndex.hh"
+#include "mgm/Policy.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "common/Statfs.hh"
 #include "common/ShellCmd.hh"
@@ -1250,6 +1252,11 @@ Master::Slave2Master()
 {
   eos_alert("msg=\"slave to master transition\"");
   fRunningState = Run::State::kIsTransition;
+  // the followed changes were not applied to the indexes and caches
+  AttrIndex::Invalidate();
+  Recycle::InvalidateIndex();
+  Policy::InvalidateCache();
+  Quota::InvalidateContainerQuota();
   // This will block draining/balancing for the next hour!!!
   f2MasterTransitionTime = time(NULL);
   // This call transforms the namespace following slave into a master in RW mode
@@ -1591,6 +1598,10 @@ bool
 Master::MasterRO2Slave()
 {
   eos_alert("msg=\"ro-master to slave transition\"");
+  AttrIndex::Invalidate();
+  Recycle::InvalidateIndex();
+  Policy::InvalidateCache();
+  Quota::InvalidateContainerQuota();
   // This call transforms a running ro-master into a slave following
   // a remote master
   fRunningState = Run::State::kIsTransition;
@@ -0,0 +1,400 @@
+//------------------------------------------------------------------------------
+// File: OpenTrace.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/OpenTrace.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+EOSMGMNAMESPACE_BEGIN
+
+OpenTrace::Histogram OpenTrace::sHistograms[OpenTrace::kNumPhases + 1];
+std::atomic<uint64_t> OpenTrace::sSlowThreshold(
+  1000ull * (getenv("EOS_MGM_OPEN_SLOW_MS") ?
+             strtoull(getenv("EOS_MGM_OPEN_SLOW_MS"), 0, 10) : 1000));
+std::mutex OpenTrace::sSamplesMutex;
+OpenTrace::Sample OpenTrace::sSamples[OpenTrace::sNumSamples];
+size_t OpenTrace::sNumSampled = 0;
+thread_local OpenTrace* OpenTrace::tlCurrent = nullptr;
+
+//------------------------------------------------------------------------------
+// Histogram constructor
+//------------------------------------------------------------------------------
+OpenTrace::Histogram::Histogram()
+{
+  Reset();
+}
+
+//------------------------------------------------------------------------------
+// Bucket of a latency: values below 4 have their own bucket, above that every
+// power of two is split in four buckets
+//------------------------------------------------------------------------------
+size_t
+OpenTrace::Histogram::Bucket(uint64_t us)
+{
+  if (us < 4) {
+    return us;
+  }
+
+  size_t exp = 63 - __builtin_clzll(us);
+  size_t bucket = 4 * (exp - 1) + ((us >> (exp - 2)) & 3);
+  return std::min(bucket, sNumBuckets - 1);
+}
+
+//------------------------------------------------------------------------------
+// Smallest latency falling into a bucket
+//------------------------------------------------------------------------------
+uint64_t
+OpenTrace::Histogram::BucketLow(size_t bucket)
+{
+  if (bucket < 4) {
+    return bucket;
+  }
+
+  return (4ull + (bucket & 3)) << (bucket / 4 - 1);
+}
+
+//------------------------------------------------------------------------------
+// Add a latency
+//------------------------------------------------------------------------------
+void
+OpenTrace::Histogram::Add(uint64_t us)
+{
+  mBuckets[Bucket(us)].fetch_add(1, std::memory_order_relaxed);
+  mCount.fetch_add(1, std::memory_order_relaxed);
+  mSum.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max = mMax.load(std::memory_order_relaxed);
+
+  while ((us > max) &&
+         !mMax.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+  }
+}
+
+//------------------------------------------------------------------------------
+// Clear the counters
+//------------------------------------------------------------------------------
+void
+OpenTrace::Histogram::Reset()
+{
+  for (size_t i = 0; i < sNumBuckets; i++) {
+    mBuckets[i].store(0, std::memory_order_relaxed);
+  }
+
+  mCount.store(0, std::memory_order_relaxed);
+  mSum.store(0, std::memory_order_relaxed);
+  mMax.store(0, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Number of recorded latencies
+//------------------------------------------------------------------------------
+uint64_t
+OpenTrace::Histogram::GetCount() const
+{
+  return mCount.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Average latency
+//------------------------------------------------------------------------------
+double
+OpenTrace::Histogram::GetAvg() const
+{
+  uint64_t count = GetCount();
+  return count ? (double) mSum.load(std::memory_order_relaxed) / count : 0;
+}
+
+//------------------------------------------------------------------------------
+// Maximum latency
+//------------------------------------------------------------------------------
+uint64_t
+OpenTrace::Histogram::GetMax() const
+{
+  return mMax.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Upper bound of the bucket holding a quantile, never above the maximum
+//------------------------------------------------------------------------------
+uint64_t
+OpenTrace::Histogram::GetQuantile(double quantile) const
+{
+  uint64_t counts[sNumBuckets];
+  uint64_t total = 0;
+
+  // the buckets are updated concurrently, so work on a snapshot
+  for (size_t i = 0; i < sNumBuckets; i++) {
+    counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+
+  if (!total) {
+    return 0;
+  }
+
+  uint64_t rank = std::max((uint64_t) 1, (uint64_t) std::ceil(quantile * total));
+  uint64_t sum = 0;
+  size_t bucket = 0;
+
+  for (; bucket < sNumBuckets - 1; bucket++) {
+    sum += counts[bucket];
+
+    if (sum >= rank) {
+      break;
+    }
+  }
+
+  if (bucket == sNumBuckets - 1) {
+    return GetMax();
+  }
+
+  return std::min(BucketLow(bucket + 1) - 1, GetMax());
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+OpenTrace::OpenTrace(const char* tident, const char* path):
+  mTident(tident ? tident : ""), mPath(path ? path : ""),
+  mPrevious(tlCurrent), mStart(Clock::now()), mLast(mStart), mPhase(kAuth)
+{
+  for (size_t i = 0; i < kNumPhases; i++) {
+    mPhaseNs[i] = 0;
+    mEntered[i] = false;
+  }
+
+  mEntered[kAuth] = true;
+  tlCurrent = this;
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+OpenTrace::~OpenTrace()
+{
+  Clock::time_point now = Clock::now();
+  mPhaseNs[mPhase] += std::chrono::duration_cast<std::chrono::nanoseconds>
+                      (now - mLast).count();
+  uint64_t total = std::chrono::duration_cast<std::chrono::microseconds>
+                   (now - mStart).count();
+  tlCurrent = mPrevious;
+
+  // only the phases the open went through count, an open failing in the
+  // namespace lookup must not add zeros to the placement
+  for (size_t i = 0; i < kNumPhases; i++) {
+    if (mEntered[i]) {
+      sHistograms[i].Add(mPhaseNs[i] / 1000);
+    }
+  }
+
+  sHistograms[kNumPhases].Add(total);
+
+  if (total < sSlowThreshold.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(sSamplesMutex);
+  Sample& sample = sSamples[sNumSampled++ % sNumSamples];
+  sample.mTime = time(NULL);
+  sample.mTident = mTident;
+  sample.mPath = mPath;
+  sample.mTotal = total;
+
+  for (size_t i = 0; i < kNumPhases; i++) {
+    sample.mPhase[i] = mPhaseNs[i] / 1000;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Close the current phase and enter a new one
+//------------------------------------------------------------------------------
+void
+OpenTrace::Enter(Phase phase)
+{
+  if (phase == mPhase) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  mPhaseNs[mPhase] += std::chrono::duration_cast<std::chrono::nanoseconds>
+                      (now - mLast).count();
+  mLast = now;
+  mPhase = phase;
+  mEntered[phase] = true;
+}
+
+//------------------------------------------------------------------------------
+// Enter a phase in the trace of the calling thread
+//------------------------------------------------------------------------------
+void
+OpenTrace::EnterCurrent(Phase phase)
+{
+  if (tlCurrent) {
+    tlCurrent->Enter(phase);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Name of a phase
+//------------------------------------------------------------------------------
+const char*
+OpenTrace::PhaseName(int phase)
+{
+  static const char* names[kNumPhases + 1] = {
+    "auth", "stall", "namespace", "policy", "quota", "placement", "capability",
+    "redirect", "total"
+  };
+
+  if ((phase < 0) || (phase > kNumPhases)) {
+    return "unknown";
+  }
+
+  return names[phase];
+}
+
+//------------------------------------------------------------------------------
+// Set the slow threshold
+//------------------------------------------------------------------------------
+void
+OpenTrace::SetSlowThreshold(uint64_t ms)
+{
+  sSlowThreshold.store(ms * 1000, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// Get the slow threshold
+//------------------------------------------------------------------------------
+uint64_t
+OpenTrace::GetSlowThreshold()
+{
+  return sSlowThreshold.load(std::memory_order_relaxed) / 1000;
+}
+
+//------------------------------------------------------------------------------
+// Clear the histograms and the slow traces
+//------------------------------------------------------------------------------
+void
+OpenTrace::Reset()
+{
+  for (size_t i = 0; i <= kNumPhases; i++) {
+    sHistograms[i].Reset();
+  }
+
+  std::lock_guard<std::mutex> lock(sSamplesMutex);
+  sNumSampled = 0;
+}
+
+//------------------------------------------------------------------------------
+// Print the latency percentiles of every phase and the slow traces
+//------------------------------------------------------------------------------
+void
+OpenTrace::PrintOut(XrdOucString& out, bool monitoring, bool slow)
+{
+  char outline[1024];
+
+  if (!monitoring) {
+    snprintf(outline, sizeof(outline),
+             "# open latency per phase in ms, slow threshold %llu ms\n",
+             (unsigned long long) GetSlowThreshold());
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+    out += outline;
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+    snprintf(outline, sizeof(outline), "%-12s %12s %10s %10s %10s %10s %10s\n",
+             "phase", "count", "avg", "p50", "p99", "p999", "max");
+    out += outline;
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+  } else {
+    snprintf(outline, sizeof(outline),
+             "uid=all gid=all open.slow.threshold=%llu\n",
+             (unsigned long long) GetSlowThreshold());
+    out += outline;
+  }
+
+  for (int i = 0; i <= kNumPhases; i++) {
+    const Histogram& h = sHistograms[i];
+
+    if (!monitoring) {
+      snprintf(outline, sizeof(outline),
+               "%-12s %12llu %10.03f %10.03f %10.03f %10.03f %10.03f\n",
+               PhaseName(i), (unsigned long long) h.GetCount(), h.GetAvg() / 1000.0,
+               h.GetQuantile(0.5) / 1000.0, h.GetQuantile(0.99) / 1000.0,
+               h.GetQuantile(0.999) / 1000.0, h.GetMax() / 1000.0);
+    } else {
+      snprintf(outline, sizeof(outline),
+               "uid=all gid=all open.phase=%s count=%llu avg=%.03f p50=%.03f "
+               "p99=%.03f p999=%.03f max=%.03f\n",
+               PhaseName(i), (unsigned long long) h.GetCount(), h.GetAvg() / 1000.0,
+               h.GetQuantile(0.5) / 1000.0, h.GetQuantile(0.99) / 1000.0,
+               h.GetQuantile(0.999) / 1000.0, h.GetMax() / 1000.0);
+    }
+
+    out += outline;
+  }
+
+  if (!slow) {
+    return;
+  }
+
+  if (!monitoring) {
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+    out += "# most recent slow opens, times in ms\n";
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+  }
+
+  std::lock_guard<std::mutex> lock(sSamplesMutex);
+  size_t n = std::min(sNumSampled, sNumSamples);
+
+  for (size_t i = 0; i < n; i++) {
+    const Sample& sample = sSamples[(sNumSampled - 1 - i) % sNumSamples];
+    std::string line;
+
+    if (monitoring) {
+      snprintf(outline, sizeof(outline),
+               "uid=all gid=all open.slow.time=%llu tident=%s total=%.03f",
+               (unsigned long long) sample.mTime, sample.mTident.c_str(),
+               sample.mTotal / 1000.0);
+    } else {
+      struct tm tm;
+      char stime[64];
+      localtime_r(&sample.mTime, &tm);
+      strftime(stime, sizeof(stime), "%y%m%d %H:%M:%S", &tm);
+      snprintf(outline, sizeof(outline), "%s %s total=%.03f", stime,
+               sample.mTident.c_str(), sample.mTotal / 1000.0);
+    }
+
+    line = outline;
+
+    for (int p = 0; p < kNumPhases; p++) {
+      snprintf(outline, sizeof(outline), " %s=%.03f", PhaseName(p),
+               sample.mPhase[p] / 1000.0);
+      line += outline;
+    }
+
+    line += " path=";
+    line += sample.mPath;
+    line += "\n";
+    out += line.c_str();
+  }
+}
+
+EOSMGMNAMESPACE_END
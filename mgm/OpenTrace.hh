@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+// File: OpenTrace.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_OPENTRACE__HH__
+#define __EOSMGM_OPENTRACE__HH__
+
+#include "mgm/Namespace.hh"
+#include "XrdOuc/XrdOucString.hh"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Phase timing of a single XrdMgmOfsFile::open call.
+//!
+//! A trace lives on the stack of the open call. Entering a phase attributes
+//! the time elapsed since the previous phase change to the previous phase, so
+//! a phase can be entered several times and the early returns of the open
+//! need no special handling. When the trace goes out of scope the phase times
+//! are added to process wide log-scale histograms with atomic counters, and
+//! requests slower than the configured threshold are kept in a ring of the
+//! most recent slow traces.
+//------------------------------------------------------------------------------
+class OpenTrace
+{
+public:
+  //! Phases of an open, in the order they normally happen
+  enum Phase {
+    kAuth = 0, ///< Identity mapping and path checks
+    kStall, ///< Stall and redirection rules
+    kNamespace, ///< Namespace lookups and updates
+    kPolicy, ///< Layout and space policy resolution
+    kQuota, ///< Quota check of a placement
+    kPlacement, ///< Scheduling of new or existing replicas
+    kCapability, ///< Building and signing the capability
+    kRedirect, ///< Assembling the redirection
+    kNumPhases
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor, starts the trace in the kAuth phase and makes it the
+  //! current trace of the calling thread
+  //!
+  //! @param tident client trace identifier
+  //! @param path path being opened
+  //----------------------------------------------------------------------------
+  OpenTrace(const char* tident, const char* path);
+
+  //----------------------------------------------------------------------------
+  //! Destructor, records the trace
+  //----------------------------------------------------------------------------
+  ~OpenTrace();
+
+  OpenTrace(const OpenTrace&) = delete;
+  OpenTrace& operator=(const OpenTrace&) = delete;
+
+  //----------------------------------------------------------------------------
+  //! Close the current phase and enter a new one
+  //----------------------------------------------------------------------------
+  void Enter(Phase phase);
+
+  //----------------------------------------------------------------------------
+  //! Enter a phase in the trace of the calling thread, if there is one. This
+  //! lets code shared with other callers split its time without taking the
+  //! trace as an argument.
+  //----------------------------------------------------------------------------
+  static void EnterCurrent(Phase phase);
+
+  //----------------------------------------------------------------------------
+  //! Print the latency percentiles of every phase
+  //!
+  //! @param out output string
+  //! @param monitoring print in <key>=<val> monitoring format
+  //! @param slow print the most recent slow traces as well
+  //----------------------------------------------------------------------------
+  static void PrintOut(XrdOucString& out, bool monitoring, bool slow);
+
+  //----------------------------------------------------------------------------
+  //! Clear the histograms and the slow traces
+  //----------------------------------------------------------------------------
+  static void Reset();
+
+  //----------------------------------------------------------------------------
+  //! Set/get the latency in milliseconds above which an open counts as slow
+  //----------------------------------------------------------------------------
+  static void SetSlowThreshold(uint64_t ms);
+  static uint64_t GetSlowThreshold();
+
+  //! Name of a phase
+  static const char* PhaseName(int phase);
+
+  //----------------------------------------------------------------------------
+  //! @brief Histogram of latencies in microseconds with four logarithmic
+  //! buckets per power of two, i.e. a resolution of 25%.
+  //----------------------------------------------------------------------------
+  class Histogram
+  {
+  public:
+    static const size_t sNumBuckets = 128;
+
+    Histogram();
+
+    //! Add a latency in microseconds
+    void Add(uint64_t us);
+
+    //! Clear the counters
+    void Reset();
+
+    //! Number of recorded latencies
+    uint64_t GetCount() const;
+
+    //! Average latency in microseconds
+    double GetAvg() const;
+
+    //! Maximum latency in microseconds
+    uint64_t GetMax() const;
+
+    //! Upper bound of the bucket holding the given quantile (0-1)
+    uint64_t GetQuantile(double quantile) const;
+
+    //! Bucket of a latency
+    static size_t Bucket(uint64_t us);
+
+    //! Smallest latency falling into a bucket
+    static uint64_t BucketLow(size_t bucket);
+
+  private:
+    std::atomic<uint64_t> mBuckets[sNumBuckets];
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mSum;
+    std::atomic<uint64_t> mMax;
+  };
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  //! A slow open as kept in the ring
+  struct Sample {
+    time_t mTime; ///< Wall clock time of the end of the open
+    std::string mTident;
+    std::string mPath;
+    uint64_t mTotal; ///< Total latency in microseconds
+    uint64_t mPhase[kNumPhases]; ///< Latency per phase in microseconds
+  };
+
+  static const size_t sNumSamples = 128;
+
+  //! Histograms per phase, the last one is the total
+  static Histogram sHistograms[kNumPhases + 1];
+  static std::atomic<uint64_t> sSlowThreshold; ///< In microseconds
+  static std::mutex sSamplesMutex;
+  static Sample sSamples[sNumSamples];
+  static size_t sNumSampled; ///< Samples ever taken, the ring head
+  static thread_local OpenTrace* tlCurrent;
+
+  const char* mTident;
+  const char* mPath;
+  OpenTrace* mPrevious; ///< Trace which was current before this one
+  Clock::time_point mStart;
+  Clock::time_point mLast; ///< Start of the current phase
+  Phase mPhase; ///< Current phase
+  uint64_t mPhaseNs[kNumPhases];
+  bool mEntered[kNumPhases];
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
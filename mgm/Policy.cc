@@ -34,6 +34,13 @@
 
 EOSMGMNAMESPACE_BEGIN
 
+std::atomic<uint64_t> Policy::sLinkVersion(1);
+Policy::CacheShard Policy::sCache[Policy::sCacheShards];
+
+//! Max number of cached policies per shard, the shard is dropped when
+//! reaching it
+static const size_t sMaxCachedPolicies = 1024;
+
 /*----------------------------------------------------------------------------*/
 void
 Policy::GetLayoutAndSpace (const char* path,
@@ -389,4 +396,143 @@ Policy::Get (const char* key)
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+bool
+Policy::HasPolicyOpaque (XrdOucEnv &env)
+{
+  static const char* keys[] = {
+    "eos.layout.type", "eos.layout.checksum", "eos.layout.blockchecksum",
+    "eos.layout.nstripes", "eos.layout.blocksize", "eos.layout.noforce",
+    "eos.checksum.noforce", "eos.space", "eos.group", "eos.force.fsid",
+    "eos.placementpolicy", "eos.placementpolicy.noforce"
+  };
+
+  for (const char* key : keys)
+  {
+    if (env.Get(key))
+      return true;
+  }
+
+  return false;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Policy::GetResolvedPolicy (const char* path,
+                           eos::IContainerMD::id_t cid,
+                           const AttrVersion &attr_version,
+                           eos::IContainerMD::XAttrMap &attrmap,
+                           const eos::common::Mapping::VirtualIdentity &vid,
+                           XrdOucEnv &env,
+                           Resolved &policy)
+{
+  bool cacheable = (cid != 0) && !HasPolicyOpaque(env);
+
+  if (cacheable)
+  {
+    CacheShard& shard = GetShard(cid);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto it = shard.mCache.find(cid);
+
+    // an entry is removed as soon as the attributes of its container change
+    if ((it != shard.mCache.end()) &&
+        (!it->second.mLinked || (it->second.mLinkVersion == attr_version.mLink)))
+    {
+      policy = it->second;
+      return;
+    }
+  }
+
+  XrdOucString space = "default";
+  policy.mLayoutId = 0;
+  policy.mForcedFsId = 0;
+  policy.mForcedGroup = -1;
+  GetLayoutAndSpace(path, attrmap, vid, policy.mLayoutId, space, env,
+                    policy.mForcedFsId, policy.mForcedGroup);
+  policy.mSpace = space.c_str();
+  policy.mTargetGeotag.clear();
+  GetPlctPolicy(path, attrmap, vid, env, policy.mPlctPolicy,
+                policy.mTargetGeotag);
+  policy.mHasBookingSize = false;
+  policy.mBookingSize = 0;
+
+  // we allow only a system attribute not to get fooled by a user
+  if (attrmap.count("sys.forced.bookingsize"))
+  {
+    policy.mHasBookingSize = true;
+    policy.mBookingSize = strtoull(attrmap["sys.forced.bookingsize"].c_str(), 0, 10);
+  }
+  else if (attrmap.count("user.forced.bookingsize"))
+  {
+    policy.mHasBookingSize = true;
+    policy.mBookingSize = strtoull(attrmap["user.forced.bookingsize"].c_str(), 0, 10);
+  }
+
+  policy.mMinSize = (attrmap.count("sys.forced.minsize") ?
+                     strtoull(attrmap["sys.forced.minsize"].c_str(), 0, 10) : 0);
+  policy.mMaxSize = (attrmap.count("sys.forced.maxsize") ?
+                     strtoull(attrmap["sys.forced.maxsize"].c_str(), 0, 10) : 0);
+  policy.mLinked = (attrmap.count("sys.attr.link") != 0);
+  policy.mLinkVersion = attr_version.mLink;
+
+  if (cacheable)
+  {
+    CacheShard& shard = GetShard(cid);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+
+    // Attributes modified since they were read must not end up in the cache,
+    // an invalidation of another container of the shard just skips caching
+    if ((attr_version.mShard == shard.mVersion.load()) &&
+        (!policy.mLinked || (attr_version.mLink == sLinkVersion.load())))
+    {
+      if (shard.mCache.size() >= sMaxCachedPolicies)
+        shard.mCache.clear();
+
+      shard.mCache[cid] = policy;
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+Policy::AttrVersion
+Policy::GetAttrVersion (eos::IContainerMD::id_t cid)
+{
+  AttrVersion version;
+  version.mShard = GetShard(cid).mVersion.load();
+  version.mLink = sLinkVersion.load();
+  return version;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Policy::AttributesChanged (eos::IContainerMD::id_t cid)
+{
+  LinksChanged();
+  CacheShard& shard = GetShard(cid);
+  std::lock_guard<std::mutex> lock(shard.mMutex);
+  ++shard.mVersion;
+  shard.mCache.erase(cid);
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Policy::LinksChanged ()
+{
+  ++sLinkVersion;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Policy::InvalidateCache ()
+{
+  LinksChanged();
+
+  for (size_t i = 0; i < sCacheShards; i++)
+  {
+    std::lock_guard<std::mutex> lock(sCache[i].mMutex);
+    ++sCache[i].mVersion;
+    sCache[i].mCache.clear();
+  }
+}
+
 EOSMGMNAMESPACE_END
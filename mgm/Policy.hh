@@ -34,6 +34,10 @@
 #include "XrdOuc/XrdOucEnv.hh"
 /*----------------------------------------------------------------------------*/
 #include <sys/types.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 /*----------------------------------------------------------------------------*/
 
@@ -43,6 +47,34 @@ class Policy
 {
 public:
 
+  //----------------------------------------------------------------------------
+  //! Placement and booking policy resolved out of the directory attributes
+  //----------------------------------------------------------------------------
+  struct Resolved
+  {
+    unsigned long mLayoutId; ///< Layout id for new files
+    std::string mSpace; ///< Space where new files are placed
+    unsigned long mForcedFsId; ///< Forced file system id, 0 if none
+    long mForcedGroup; ///< Forced scheduling group, -1 if none
+    eos::mgm::Scheduler::tPlctPolicy mPlctPolicy; ///< Placement policy
+    std::string mTargetGeotag; ///< Target geotag of the placement policy
+    bool mHasBookingSize; ///< Booking size forced by the directory
+    unsigned long long mBookingSize; ///< Forced booking size
+    unsigned long long mMinSize; ///< Minimum file size, 0 if none
+    unsigned long long mMaxSize; ///< Maximum file size, 0 if none
+    bool mLinked; ///< Attributes pulled in through sys.attr.link
+    uint64_t mLinkVersion; ///< Link version the policy was resolved at
+  };
+
+  //----------------------------------------------------------------------------
+  //! Attribute version of a container, sampled when reading its attributes
+  //----------------------------------------------------------------------------
+  struct AttrVersion
+  {
+    uint64_t mShard; ///< Version of the cache shard of the container
+    uint64_t mLink; ///< Version of the attributes reachable through links
+  };
+
   Policy () { };
 
   ~Policy () { };
@@ -69,6 +101,86 @@ public:
   static bool Rm (XrdOucEnv &env, int &retc, XrdOucString &stdOut, XrdOucString &stdErr);
 
   static const char* Get (const char* key);
+
+  //----------------------------------------------------------------------------
+  //! Resolve the policy of a directory - the result is cached per container
+  //! unless the client passes opaque tags which influence the policy
+  //!
+  //! @param path path used for logging
+  //! @param cid id of the container the attributes belong to
+  //! @param attr_version attribute version of the container sampled when the
+  //!        attributes were read i.e. under the same namespace lock
+  //! @param attrmap attributes of the container
+  //! @param vid virtual identity of the client
+  //! @param env opaque info of the client
+  //! @param policy resolved policy
+  //----------------------------------------------------------------------------
+  static void GetResolvedPolicy (const char* path,
+                                 eos::IContainerMD::id_t cid,
+                                 const AttrVersion &attr_version,
+                                 eos::IContainerMD::XAttrMap &attrmap,
+                                 const eos::common::Mapping::VirtualIdentity &vid,
+                                 XrdOucEnv &env,
+                                 Resolved &policy);
+
+  //----------------------------------------------------------------------------
+  //! Get the current attribute version of a container
+  //----------------------------------------------------------------------------
+  static AttrVersion GetAttrVersion (eos::IContainerMD::id_t cid);
+
+  //----------------------------------------------------------------------------
+  //! Invalidate the resolved policy of a container - to be called whenever
+  //! one of its attributes changes while holding the namespace write lock.
+  //! The policies of the directories linking to any other directory are
+  //! invalidated too, since they may pull the modified attributes.
+  //----------------------------------------------------------------------------
+  static void AttributesChanged (eos::IContainerMD::id_t cid);
+
+  //----------------------------------------------------------------------------
+  //! Invalidate the resolved policies of the directories linking to another
+  //! one - to be called when a directory is renamed, which may change the
+  //! target of a sys.attr.link
+  //----------------------------------------------------------------------------
+  static void LinksChanged ();
+
+  //----------------------------------------------------------------------------
+  //! Drop all the resolved policies - to be called on a master/slave
+  //! transition since the attribute changes replayed from the changelog do
+  //! not invalidate them
+  //----------------------------------------------------------------------------
+  static void InvalidateCache ();
+
+private:
+  //----------------------------------------------------------------------------
+  //! Check if the client opaque info contains tags influencing the policy
+  //----------------------------------------------------------------------------
+  static bool HasPolicyOpaque (XrdOucEnv &env);
+
+  //----------------------------------------------------------------------------
+  //! Resolved policies of the containers hashed to one shard
+  //----------------------------------------------------------------------------
+  struct CacheShard
+  {
+    std::mutex mMutex; ///< Mutex protecting the shard
+    std::atomic<uint64_t> mVersion; ///< Bumped by every invalidation
+    //! Resolved policies indexed by container id
+    std::unordered_map<eos::IContainerMD::id_t, Resolved> mCache;
+
+    CacheShard () : mVersion(1) { }
+  };
+
+  static const size_t sCacheShards = 64; ///< Number of cache shards
+
+  //----------------------------------------------------------------------------
+  //! Get the cache shard of a container
+  //----------------------------------------------------------------------------
+  static CacheShard& GetShard (eos::IContainerMD::id_t cid)
+  {
+    return sCache[cid % sCacheShards];
+  }
+
+  static std::atomic<uint64_t> sLinkVersion; ///< Version of linked attributes
+  static CacheShard sCache[sCacheShards]; ///< Resolved policies
 };
 
 EOSMGMNAMESPACE_END
@@ -0,0 +1,172 @@
+//------------------------------------------------------------------------------
+// File: PopularitySketch.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/PopularitySketch.hh"
+#include <algorithm>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+PopularitySketch::PopularitySketch(size_t capacity):
+  mCapacity(capacity ? capacity : 1)
+{
+  mHeap.reserve(mCapacity);
+  mIndex.reserve(mCapacity);
+}
+
+//------------------------------------------------------------------------------
+// Account an access to a file
+//------------------------------------------------------------------------------
+void
+PopularitySketch::Add(eos::common::FileId::fileid_t fid,
+                      unsigned long long weight, unsigned long long rb)
+{
+  auto it = mIndex.find(fid);
+
+  if (it != mIndex.end()) {
+    Entry& entry = mHeap[it->second];
+    entry.mWeight += weight;
+    entry.mNread++;
+    entry.mRb += rb;
+    SiftDown(it->second);
+    return;
+  }
+
+  Entry entry;
+  entry.mFid = fid;
+  entry.mWeight = weight;
+  entry.mError = 0;
+  entry.mNread = 1;
+  entry.mRb = rb;
+
+  if (mHeap.size() < mCapacity) {
+    mHeap.push_back(entry);
+    mIndex[fid] = mHeap.size() - 1;
+    SiftUp(mHeap.size() - 1);
+    return;
+  }
+
+  // replace the lightest file, which gives its weight as error
+  Entry& lightest = mHeap[0];
+  mIndex.erase(lightest.mFid);
+  entry.mError = lightest.mWeight;
+  entry.mWeight += lightest.mWeight;
+  lightest = entry;
+  mIndex[fid] = 0;
+  SiftDown(0);
+}
+
+//------------------------------------------------------------------------------
+// Get the files with the largest weights
+//------------------------------------------------------------------------------
+void
+PopularitySketch::Top(size_t limit, std::vector<Entry>& top) const
+{
+  top = mHeap;
+
+  if (limit > top.size()) {
+    limit = top.size();
+  }
+
+  std::partial_sort(top.begin(), top.begin() + limit, top.end(),
+  [](const Entry & l, const Entry & r) {
+    if (l.mWeight == r.mWeight) {
+      return l.mFid < r.mFid;
+    }
+
+    return l.mWeight > r.mWeight;
+  });
+  top.resize(limit);
+}
+
+//------------------------------------------------------------------------------
+// Forget all the files
+//------------------------------------------------------------------------------
+void
+PopularitySketch::Clear()
+{
+  mHeap.clear();
+  mIndex.clear();
+}
+
+//------------------------------------------------------------------------------
+// Move an entry up the heap until its parent is not heavier
+//------------------------------------------------------------------------------
+void
+PopularitySketch::SiftUp(size_t pos)
+{
+  while (pos) {
+    size_t parent = (pos - 1) / 2;
+
+    if (mHeap[parent].mWeight <= mHeap[pos].mWeight) {
+      break;
+    }
+
+    Swap(parent, pos);
+    pos = parent;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Move an entry down the heap until its children are not lighter
+//------------------------------------------------------------------------------
+void
+PopularitySketch::SiftDown(size_t pos)
+{
+  while (true) {
+    size_t lightest = pos;
+    size_t left = 2 * pos + 1;
+    size_t right = left + 1;
+
+    if ((left < mHeap.size()) &&
+        (mHeap[left].mWeight < mHeap[lightest].mWeight)) {
+      lightest = left;
+    }
+
+    if ((right < mHeap.size()) &&
+        (mHeap[right].mWeight < mHeap[lightest].mWeight)) {
+      lightest = right;
+    }
+
+    if (lightest == pos) {
+      break;
+    }
+
+    Swap(pos, lightest);
+    pos = lightest;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Swap two entries of the heap and update their index
+//------------------------------------------------------------------------------
+void
+PopularitySketch::Swap(size_t a, size_t b)
+{
+  std::swap(mHeap[a], mHeap[b]);
+  mIndex[mHeap[a].mFid] = a;
+  mIndex[mHeap[b].mFid] = b;
+}
+
+EOSMGMNAMESPACE_END
@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+// File: PopularitySketch.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_POPULARITYSKETCH__HH__
+#define __EOSMGM_POPULARITYSKETCH__HH__
+
+#include "mgm/Namespace.hh"
+#include "common/FileId.hh"
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Bounded summary of the most accessed files (space-saving
+//! algorithm).
+//!
+//! At most a fixed number of files are tracked. A file not tracked while the
+//! summary is full replaces the file with the smallest weight and inherits
+//! its weight as overestimation error. The weight of a file is thus never
+//! underestimated, and any file whose weight is above the total weight
+//! divided by the capacity is guaranteed to be tracked. The memory used does
+//! not depend on the number of distinct files.
+//!
+//! The tracked files are kept in a min-heap by weight, so an update costs
+//! O(log capacity). Not thread-safe.
+//------------------------------------------------------------------------------
+class PopularitySketch
+{
+public:
+  //----------------------------------------------------------------------------
+  //! A tracked file
+  //----------------------------------------------------------------------------
+  struct Entry {
+    eos::common::FileId::fileid_t mFid;
+    unsigned long long mWeight; ///< Estimated weight, never below the real one
+    unsigned long long mError; ///< Maximum overestimation of mWeight
+    unsigned long long mNread; ///< Accesses since the file is tracked
+    unsigned long long mRb; ///< Bytes read since the file is tracked
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param capacity maximum number of files tracked
+  //----------------------------------------------------------------------------
+  explicit PopularitySketch(size_t capacity = 10000);
+
+  //----------------------------------------------------------------------------
+  //! Account an access to a file
+  //!
+  //! @param fid file id
+  //! @param weight weight of the access in the ranking
+  //! @param rb bytes read by the access
+  //----------------------------------------------------------------------------
+  void Add(eos::common::FileId::fileid_t fid, unsigned long long weight,
+           unsigned long long rb);
+
+  //----------------------------------------------------------------------------
+  //! Get the files with the largest weights
+  //!
+  //! @param limit maximum number of files
+  //! @param top filled with the files by decreasing weight
+  //----------------------------------------------------------------------------
+  void Top(size_t limit, std::vector<Entry>& top) const;
+
+  //----------------------------------------------------------------------------
+  //! Forget all the files
+  //----------------------------------------------------------------------------
+  void Clear();
+
+  //----------------------------------------------------------------------------
+  //! Number of files tracked
+  //----------------------------------------------------------------------------
+  size_t Size() const
+  {
+    return mHeap.size();
+  }
+
+private:
+  //! Move an entry up the heap until its parent is not heavier
+  void SiftUp(size_t pos);
+
+  //! Move an entry down the heap until its children are not lighter
+  void SiftDown(size_t pos);
+
+  //! Swap two entries of the heap and update their index
+  void Swap(size_t a, size_t b);
+
+  size_t mCapacity;
+  std::vector<Entry> mHeap; ///< Tracked files, lightest first
+  //! Position of the tracked files in mHeap
+  std::unordered_map<eos::common::FileId::fileid_t, size_t> mIndex;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
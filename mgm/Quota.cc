@@ -23,8 +23,10 @@
 
 /*----------------------------------------------------------------------------*/
 #include "mgm/Quota.hh"
+#include "mgm/OpenTrace.hh"
 #include "mgm/Policy.hh"
 #include "mgm/XrdMgmOfs.hh"
+#include "mgm/geotree/EpochManager.hh"
 /*----------------------------------------------------------------------------*/
 #include <errno.h>
 /*----------------------------------------------------------------------------*/
@@ -32,6 +34,20 @@
 EOSMGMNAMESPACE_BEGIN
 
 std::map<std::string, SpaceQuota*> Quota::pMapQuota;
+//! Number of cached containers, a power of 2
+static const size_t sContainerQuotaSlots = 16384;
+Quota::ContainerQuota Quota::pContainerQuota[sContainerQuotaSlots];
+//! Number of entries probed in the container cache
+static const size_t sMaxProbes = 8;
+
+//------------------------------------------------------------------------------
+// Hash of a cache key
+//------------------------------------------------------------------------------
+static inline size_t
+QuotaCacheHash(unsigned long long key)
+{
+  return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32);
+}
 eos::common::RWMutex Quota::pMapMutex;
 gid_t Quota::gProjectId = 99;
 
@@ -51,7 +67,8 @@ SpaceQuota::SpaceQuota(const char* path):
   mQuotaNode((eos::IQuotaNode*)0),
   mLastEnableCheck(0),
   mLayoutSizeFactor(1.0),
-  mDirtyTarget(true)
+  mDirtyTarget(true),
+  mTargetGeneration(1)
 {
   std::shared_ptr<eos::IContainerMD> quotadir;
 
@@ -205,6 +222,7 @@ SpaceQuota::RmQuota(unsigned long tag, unsigned long id)
   if (mMapIdQuota.count(Index(tag, id))) {
     mMapIdQuota.erase(Index(tag, id));
     mDirtyTarget = true;
+    mTargetGeneration++;
     return true;
   }
 
@@ -239,6 +257,7 @@ SpaceQuota::SetQuota(unsigned long tag, unsigned long id,
       (tag == kUserLogicalBytesTarget) ||
       (tag == kGroupLogicalBytesTarget)) {
     mDirtyTarget = true;
+    mTargetGeneration++;
   }
 }
 
@@ -257,6 +276,7 @@ SpaceQuota::ResetQuota(unsigned long tag, unsigned long id)
       (tag == kUserLogicalBytesTarget) ||
       (tag == kGroupLogicalBytesTarget)) {
     mDirtyTarget = true;
+    mTargetGeneration++;
   }
 }
 
@@ -844,123 +864,93 @@ SpaceQuota::PrintOut(XrdOucString& output, long uid_sel, long gid_sel,
 }
 
 //------------------------------------------------------------------------------
-// User/group/project quota checks. If both user and group quotas are defined,
-// then both need to be satisfied.
+// Compute the remaining user, group and project quota
 //------------------------------------------------------------------------------
-bool
-SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
-                            unsigned int inodes)
+void
+SpaceQuota::GetQuotaLeft(uid_t uid, gid_t gid, QuotaLeft left[3])
 {
-  bool hasquota = false;
   // Update info from the ns quota node - user, group and project quotas
   UpdateFromQuotaNode(uid, gid, GetQuota(kGroupBytesTarget, Quota::gProjectId)
                       ? true : false);
-  eos_static_info("uid=%d gid=%d size=%llu quota=%llu", uid, gid, desired_vol,
-                  GetQuota(kUserBytesTarget, uid));
-  bool userquota = false;
-  bool groupquota = false;
-  bool projectquota = false;
-  bool hasuserquota = false;
-  bool hasgroupquota = false;
-  bool hasprojectquota = false;
-  bool uservolumequota = false;
-  bool userinodequota = false;
-  bool groupvolumequota = false;
-  bool groupinodequota = false;
-
-  if (GetQuota(kUserBytesTarget, uid) > 0) {
-    userquota = true;
-    uservolumequota = true;
-  }
-
-  if (GetQuota(kGroupBytesTarget, gid) > 0) {
-    groupquota = true;
-    groupvolumequota = true;
-  }
-
-  if (GetQuota(kUserFilesTarget, uid) > 0) {
-    userquota = true;
-    userinodequota = true;
-  }
-
-  if (GetQuota(kGroupFilesTarget, gid) > 0) {
-    groupquota = true;
-    groupinodequota = true;
-  }
-
-  if (uservolumequota) {
-    if ((GetQuota(kUserBytesTarget, uid) - GetQuota(kUserBytesIs,
-         uid)) > (long long)desired_vol) {
-      hasuserquota = true;
-    } else {
-      hasuserquota = false;
-    }
-  }
-
-  if (userinodequota) {
-    if ((GetQuota(kUserFilesTarget, uid) - GetQuota(kUserFilesIs, uid)) > inodes) {
-      if (!uservolumequota) {
-        hasuserquota = true;
-      }
-    } else {
-      hasuserquota = false;
-    }
-  }
-
-  if (groupvolumequota) {
-    if ((GetQuota(kGroupBytesTarget, gid) - GetQuota(kGroupBytesIs,
-         gid)) > desired_vol) {
-      hasgroupquota = true;
-    } else {
-      hasgroupquota = false;
-    }
-  }
-
-  if (groupinodequota) {
-    if ((GetQuota(kGroupFilesTarget, gid) - GetQuota(kGroupFilesIs,
-         gid)) > inodes) {
-      if (!groupvolumequota) {
-        hasgroupquota = true;
-      }
-    } else {
-      hasgroupquota = false;
-    }
+  XrdSysMutexHelper scope_lock(mMutex);
+  const unsigned long ids[3] = { uid, gid, Quota::gProjectId };
+
+  for (int i = 0; i < 3; i++) {
+    bool user = (i == 0);
+    long long bytes_target = mMapIdQuota[Index(user ? kUserBytesTarget :
+                                         kGroupBytesTarget, ids[i])];
+    long long files_target = mMapIdQuota[Index(user ? kUserFilesTarget :
+                                         kGroupFilesTarget, ids[i])];
+    left[i].mBytesTarget = (bytes_target > 0);
+    left[i].mFilesTarget = (files_target > 0);
+    left[i].mBytes = bytes_target - (long long) mMapIdQuota[Index(user ?
+                     kUserBytesIs : kGroupBytesIs, ids[i])];
+    left[i].mFiles = files_target - (long long) mMapIdQuota[Index(user ?
+                     kUserFilesIs : kGroupFilesIs, ids[i])];
   }
+}
 
-  if (((GetQuota(kGroupBytesTarget, Quota::gProjectId) -
-        GetQuota(kGroupBytesIs, Quota::gProjectId)) > desired_vol) &&
-      ((GetQuota(kGroupFilesTarget, Quota::gProjectId) -
-        GetQuota(kGroupFilesIs, Quota::gProjectId)) > inodes)) {
-    hasprojectquota = true;
-  }
+//------------------------------------------------------------------------------
+// User/group/project quota checks
+//------------------------------------------------------------------------------
+bool
+SpaceQuota::CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
+                            unsigned int inodes)
+{
+  QuotaLeft left[3];
+  GetQuotaLeft(uid, gid, left);
+  eos_static_info("uid=%d gid=%d size=%llu quota=%llu", uid, gid, desired_vol,
+                  GetQuota(kUserBytesTarget, uid));
 
-  if (!userquota && !groupquota) {
-    projectquota = true;
+  // Root does not need any quota
+  if (uid == 0) {
+    return true;
   }
 
-  eos_static_info("userquota=%d groupquota=%d userquota=%d groupquota=%d "
-                  "userinodequota=%d uservolumequota=%d projectquota=%d "
-                  "hasprojectquota=%d", userquota, groupquota, hasuserquota,
-                  hasgroupquota, userinodequota, uservolumequota, projectquota,
-                  hasprojectquota);
+  return QuotaBudget::HasQuota(left, desired_vol, inodes);
+}
 
-  // If both quotas are defined we need to have both
-  if (userquota && groupquota) {
-    hasquota = hasuserquota & hasgroupquota;
-  } else {
-    hasquota = hasuserquota || hasgroupquota;
+//------------------------------------------------------------------------------
+// User/group/project quota checks on the cached values
+//------------------------------------------------------------------------------
+bool
+SpaceQuota::CheckWriteQuotaCached(uid_t uid, gid_t gid, long long desired_vol,
+                                  unsigned int inodes)
+{
+  // Root does not need any quota
+  if (uid == 0) {
+    return true;
   }
 
-  if (projectquota && hasprojectquota) {
-    hasquota = true;
-  }
+  const unsigned long long keys[3] = {
+    Index(kUserBytesTarget, uid) + 1, Index(kGroupBytesTarget, gid) + 1,
+    Index(kGroupBytesTarget, Quota::gProjectId) + 1
+  };
+  return mBudget.Book(keys, mTargetGeneration.load(), time(NULL), desired_vol,
+                      inodes);
+}
 
-  // Root does not need any quota
+//------------------------------------------------------------------------------
+// User/group/project quota checks refreshing the cached values
+//------------------------------------------------------------------------------
+bool
+SpaceQuota::CheckWriteQuotaRefresh(uid_t uid, gid_t gid, long long desired_vol,
+                                   unsigned int inodes)
+{
   if (uid == 0) {
-    hasquota = true;
+    return true;
   }
 
-  return hasquota;
+  // the generation has to be sampled before the values are computed
+  const unsigned long long generation = mTargetGeneration.load();
+  const unsigned long long keys[3] = {
+    Index(kUserBytesTarget, uid) + 1, Index(kGroupBytesTarget, gid) + 1,
+    Index(kGroupBytesTarget, Quota::gProjectId) + 1
+  };
+  QuotaLeft left[3];
+  GetQuotaLeft(uid, gid, left);
+  mBudget.Store(keys, generation, time(NULL), left);
+  return QuotaBudget::HasQuota(left, desired_vol, inodes);
 }
 
 //------------------------------------------------------------------------------
@@ -1605,22 +1595,26 @@ bool
 Quota::RmSpaceQuota(std::string& path, std::string& msg, int& retc)
 {
   eos_static_debug("path=%s", path.c_str());
-  eos::common::RWMutexWriteLock wr_ns_lock(gOFS->eosViewRWMutex);
-  eos::common::RWMutexWriteLock wr_quota_lock(pMapMutex);
-  SpaceQuota* squota = GetSpaceQuota(path);
+  SpaceQuota* squota = 0;
+  {
+    eos::common::RWMutexWriteLock wr_ns_lock(gOFS->eosViewRWMutex);
+    eos::common::RWMutexWriteLock wr_quota_lock(pMapMutex);
+    squota = GetSpaceQuota(path);
+
+    if (!squota) {
+      retc = EINVAL;
+      msg = "error: there is no quota node under path ";
+      msg += path;
+      return false;
+    }
 
-  if (!squota) {
-    retc = EINVAL;
-    msg = "error: there is no quota node under path ";
-    msg += path;
-    return false;
-  } else {
     // Remove space quota from map
     if (path[path.length() - 1 ] != '/') {
       path += '/';
     }
 
     pMapQuota.erase(path);
+    ClearContainerQuota();
 
     // Remove ns quota node
     try {
@@ -1631,20 +1625,23 @@ Quota::RmSpaceQuota(std::string& path, std::string& msg, int& retc)
       retc = e.getErrno();
       msg = e.getMessage().str().c_str();
     }
-
-    // Remove all configuration entries
-    std::string match = path;
-    match += ":";
-    gOFS->ConfEngine->DeleteConfigValueByMatch("quota", match.c_str());
-    msg = "success: removed space quota for ";
-    msg += path;
-
-    if (!gOFS->ConfEngine->AutoSave()) {
-      return false;
-    }
-
-    return true;
   }
+  // Wait for the lock-free checks which could still use the space quota, as
+  // done by CleanUp. This must not hold pMapMutex.
+  EpochManager::synchronize();
+  delete squota;
+  // Remove all configuration entries
+  std::string match = path;
+  match += ":";
+  gOFS->ConfEngine->DeleteConfigValueByMatch("quota", match.c_str());
+  msg = "success: removed space quota for ";
+  msg += path;
+
+  if (!gOFS->ConfEngine->AutoSave()) {
+    return false;
+  }
+
+  return true;
 }
 
 //------------------------------------------------------------------------------
@@ -1847,19 +1844,151 @@ Quota::Check(const std::string& path, uid_t uid, gid_t gid,
   return squota->CheckWriteQuota(uid, gid, desired_vol, desired_inodes);
 }
 
+//------------------------------------------------------------------------------
+// Check if a write respects the quota using the container cache
+//------------------------------------------------------------------------------
+bool
+Quota::CheckWrite(unsigned long long cid, const std::string& path, uid_t uid,
+                  gid_t gid, long long desired_vol, unsigned int desired_inodes)
+{
+  if (!cid) {
+    return Check(path, uid, gid, desired_vol, desired_inodes);
+  }
+
+  {
+    // space quota objects are only deleted after an epoch synchronization.
+    // Nothing in this section may block: the epoch is shared with other
+    // subsystems whose writers wait for it.
+    EpochManager::ReadGuard epoch_guard;
+    SpaceQuota* squota = 0;
+
+    if (GetContainerQuota(cid, squota) &&
+        (!squota || squota->CheckWriteQuotaCached(uid, gid, desired_vol,
+            desired_inodes))) {
+      return true;
+    }
+  }
+
+  // Cache miss or budgets to refresh - the read lock keeps the space quota
+  // alive as it is only removed from the map under the write lock
+  eos::common::RWMutexReadLock rd_quota_lock(pMapMutex);
+  SpaceQuota* squota = GetResponsibleSpaceQuota(path);
+  SetContainerQuota(cid, squota);
+
+  if (!squota) {
+    return true;
+  }
+
+  return squota->CheckWriteQuotaRefresh(uid, gid, desired_vol, desired_inodes);
+}
+
+//------------------------------------------------------------------------------
+// Get the cached space quota responsible for a container
+//------------------------------------------------------------------------------
+bool
+Quota::GetContainerQuota(unsigned long long cid, SpaceQuota*& squota)
+{
+  const unsigned long long key = cid + 2;
+  const size_t start = QuotaCacheHash(key);
+
+  for (size_t i = 0; i < sMaxProbes; i++) {
+    ContainerQuota* entry = &pContainerQuota[(start + i) &
+                                             (sContainerQuotaSlots - 1)];
+
+    if (entry->mKey.load() == key) {
+      squota = entry->mQuota.load();
+
+      // the entry could have been replaced while reading it
+      if (entry->mKey.load() == key) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Cache the space quota responsible for a container
+//------------------------------------------------------------------------------
+void
+Quota::SetContainerQuota(unsigned long long cid, SpaceQuota* squota)
+{
+  const unsigned long long key = cid + 2;
+  const size_t start = QuotaCacheHash(key);
+  ContainerQuota* entry = 0;
+  unsigned long long current = 0;
+
+  for (size_t i = 0; i < sMaxProbes; i++) {
+    ContainerQuota* probe = &pContainerQuota[(start + i) &
+                                             (sContainerQuotaSlots - 1)];
+    current = 0;
+
+    if (probe->mKey.compare_exchange_strong(current, 1)) {
+      entry = probe;
+      break;
+    }
+  }
+
+  if (!entry) {
+    // evict the first probed entry unless it is being updated
+    entry = &pContainerQuota[start & (sContainerQuotaSlots - 1)];
+    current = entry->mKey.load();
+
+    if ((current == 1) || !entry->mKey.compare_exchange_strong(current, 1)) {
+      return;
+    }
+  }
+
+  entry->mQuota.store(squota);
+  entry->mKey.store(key);
+}
+
+//------------------------------------------------------------------------------
+// Clear the container cache
+//------------------------------------------------------------------------------
+void
+Quota::ClearContainerQuota()
+{
+  for (size_t i = 0; i < sContainerQuotaSlots; i++) {
+    pContainerQuota[i].mKey.store(0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Drop the cached container to space quota mapping
+//------------------------------------------------------------------------------
+void
+Quota::InvalidateContainerQuota()
+{
+  eos::common::RWMutexWriteLock wr_quota_lock(pMapMutex);
+  ClearContainerQuota();
+}
+
 //------------------------------------------------------------------------------
 // Clean-up all space quotas by deleting them and clearing the map
 //------------------------------------------------------------------------------
 void
 Quota::CleanUp()
 {
-  eos::common::RWMutexWriteLock wr_lock(pMapMutex);
+  std::vector<SpaceQuota*> squotas;
+  {
+    eos::common::RWMutexWriteLock wr_lock(pMapMutex);
+    ClearContainerQuota();
 
-  for (auto it = pMapQuota.begin(); it != pMapQuota.end(); ++it) {
-    delete it->second;
+    for (auto it = pMapQuota.begin(); it != pMapQuota.end(); ++it) {
+      squotas.push_back(it->second);
+    }
+
+    pMapQuota.clear();
   }
+  // Wait for the lock-free checks which could still use a space quota. This
+  // must not hold pMapMutex as these checks may be waiting for it.
+  EpochManager::synchronize();
 
-  pMapQuota.clear();
+  for (auto it = squotas.begin(); it != squotas.end(); ++it) {
+    delete *it;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -1879,26 +2008,21 @@ Quota::FilePlacement(Scheduler::PlacementArguments* args)
 
   // Check if quota enabled for current space
   if (FsView::gFsView.IsQuotaEnabled(*args->spacename)) {
-    eos::common::RWMutexReadLock rd_quota_lock(pMapMutex);
-    SpaceQuota* squota = GetResponsibleSpaceQuota(args->path);
-
-    if (squota) {
-      bool has_quota = false;
-      long long desired_vol = 1ll * nfilesystems * args->bookingsize;
-      has_quota = squota->CheckWriteQuota(args->vid->uid, args->vid->gid, desired_vol,
-                                          nfilesystems);
-
-      if (!has_quota) {
-        eos_static_debug("uid=%u gid=%u grouptag=%s place filesystems=%u "
-                         "has no quota left!", args->vid->uid, args->vid->gid, args->grouptag,
-                         nfilesystems);
-        return EDQUOT;
-      }
+    long long desired_vol = 1ll * nfilesystems * args->bookingsize;
+
+    if (!CheckWrite(args->cid, args->path, args->vid->uid, args->vid->gid,
+                    desired_vol, nfilesystems)) {
+      eos_static_debug("uid=%u gid=%u grouptag=%s place filesystems=%u "
+                       "has no quota left!", args->vid->uid, args->vid->gid, args->grouptag,
+                       nfilesystems);
+      return EDQUOT;
     }
   } else {
     eos_static_debug("quota is disabled for space=%s", args->spacename->c_str());
   }
 
+  OpenTrace::EnterCurrent(OpenTrace::kPlacement);
+
   if (!FsView::gFsView.mSpaceGroupView.count(*args->spacename)) {
     eos_static_err("msg=\"no filesystem in space\" space=\"%s\"",
                    args->spacename->c_str());
@@ -1910,6 +2034,49 @@ Quota::FilePlacement(Scheduler::PlacementArguments* args)
   return Scheduler::FilePlacement(args);
 }
 
+//------------------------------------------------------------------------------
+// Place several files of the same layout in one call
+//------------------------------------------------------------------------------
+int
+Quota::FilePlacementBatch(Scheduler::PlacementArguments* args,
+                          const std::vector<ino64_t>& inodes,
+                          std::vector<std::vector<unsigned int>>& placements,
+                          std::vector<std::vector<std::string>>* dataproxys,
+                          std::vector<std::vector<std::string>>* firewallentpts)
+{
+  unsigned int nfilesystems = eos::common::LayoutId::GetStripeNumber(
+                                args->lid) + 1;
+  placements.assign(inodes.size(), std::vector<unsigned int>());
+  eos_static_debug("uid=%u gid=%u grouptag=%s place files=%lu filesystems=%u",
+                   args->vid->uid, args->vid->gid, args->grouptag,
+                   inodes.size(), nfilesystems);
+
+  // Check the quota once for the whole batch
+  if (FsView::gFsView.IsQuotaEnabled(*args->spacename)) {
+    long long nstripes = 1ll * nfilesystems * inodes.size();
+    long long desired_vol = nstripes * args->bookingsize;
+
+    if (!CheckWrite(args->cid, args->path, args->vid->uid, args->vid->gid,
+                    desired_vol, nstripes)) {
+      eos_static_debug("uid=%u gid=%u grouptag=%s place files=%lu "
+                       "has no quota left!", args->vid->uid, args->vid->gid,
+                       args->grouptag, inodes.size());
+      return EDQUOT;
+    }
+  } else {
+    eos_static_debug("quota is disabled for space=%s", args->spacename->c_str());
+  }
+
+  if (!FsView::gFsView.mSpaceGroupView.count(*args->spacename)) {
+    eos_static_err("msg=\"no filesystem in space\" space=\"%s\"",
+                   args->spacename->c_str());
+    return ENOSPC;
+  }
+
+  return Scheduler::FilePlacementBatch(args, inodes, placements, dataproxys,
+                                       firewallentpts);
+}
+
 //------------------------------------------------------------------------------
 // Take the decision from where to access a file. The core of the
 // implementation is in the Scheduler and GeoTreeEngine.
@@ -1932,6 +2099,8 @@ Quota::Create(const std::string& path)
   if (pMapQuota.count(path) == 0) {
     SpaceQuota* squota = new SpaceQuota(path.c_str());
     pMapQuota[path] = squota;
+    // the new node takes over part of the namespace
+    ClearContainerQuota();
   }
 }
 
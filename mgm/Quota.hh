@@ -35,6 +35,7 @@
 #include "mgm/FsView.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mgm/Scheduler.hh"
+#include "mgm/QuotaBudget.hh"
 #include "common/Logging.hh"
 #include "common/LayoutId.hh"
 #include "common/Mapping.hh"
@@ -43,6 +44,8 @@
 #include "namespace/interface/IQuota.hh"
 #include "XrdOuc/XrdOucString.hh"
 /*----------------------------------------------------------------------------*/
+#include <atomic>
+/*----------------------------------------------------------------------------*/
 
 EOSMGMNAMESPACE_BEGIN
 
@@ -91,6 +94,26 @@ public:
   bool CheckWriteQuota(uid_t uid, gid_t gid, long long desired_vol,
                        unsigned int desired_inodes);
 
+  //----------------------------------------------------------------------------
+  //! Same check as CheckWriteQuota on the remaining quota cached per uid/gid.
+  //! It takes no lock and books the write on the cached values.
+  //!
+  //! @return true if the write was booked, false if the caller has to use
+  //!         CheckWriteQuotaRefresh
+  //! @warning Must be called inside an EpochManager read-side section
+  //----------------------------------------------------------------------------
+  bool CheckWriteQuotaCached(uid_t uid, gid_t gid, long long desired_vol,
+                             unsigned int desired_inodes);
+
+  //----------------------------------------------------------------------------
+  //! Same check as CheckWriteQuota which also refreshes the values cached for
+  //! CheckWriteQuotaCached
+  //!
+  //! @warning Must be called with a read lock on Quota::pMapMutex
+  //----------------------------------------------------------------------------
+  bool CheckWriteQuotaRefresh(uid_t uid, gid_t gid, long long desired_vol,
+                              unsigned int desired_inodes);
+
   //----------------------------------------------------------------------------
   //! Print quota information
   //!
@@ -119,6 +142,14 @@ public:
 
 private:
 
+  //----------------------------------------------------------------------------
+  //! Compute the remaining user, group and project quota from the ns quota
+  //! node
+  //!
+  //! @param left filled with the user, group and project quota left
+  //----------------------------------------------------------------------------
+  void GetQuotaLeft(uid_t uid, gid_t gid, QuotaLeft left[3]);
+
   //----------------------------------------------------------------------------
   //! Get quota
   //!
@@ -307,6 +338,10 @@ private:
 
   //! Map for user view, depending on eQuota and uid/gid
   std::map<long long, unsigned long long> mMapIdQuota;
+  //! Remaining quota used by CheckWriteQuotaCached
+  QuotaBudget mBudget;
+  //! Generation of the quota targets, invalidates the budgets
+  std::atomic<unsigned long long> mTargetGeneration;
 };
 
 
@@ -503,6 +538,32 @@ public:
   static bool Check(const std::string& path, uid_t uid, gid_t gid,
                     long long desired_vol, unsigned int desired_inodes);
 
+  //----------------------------------------------------------------------------
+  //! Check if a write respects the quota. If the container id is given, the
+  //! responsible space quota is taken from a lock-free cache and the check
+  //! is done by SpaceQuota::CheckWriteQuotaCached without taking pMapMutex.
+  //! Only a cache miss or a budget to refresh takes pMapMutex, outside of the
+  //! epoch read-side section.
+  //!
+  //! @param cid id of the container of the file, 0 if unknown
+  //! @param path path of the file
+  //! @param uid user id
+  //! @param gid group id
+  //! @param desired_vol desired space
+  //! @param desired_inodes desired number of inondes
+  //!
+  //! @return true if quota is respected, otherwise false
+  //----------------------------------------------------------------------------
+  static bool CheckWrite(unsigned long long cid, const std::string& path,
+                         uid_t uid, gid_t gid, long long desired_vol,
+                         unsigned int desired_inodes);
+
+  //----------------------------------------------------------------------------
+  //! Drop the cached container to space quota mapping e.g. after moving a
+  //! container or after a master/slave transition
+  //----------------------------------------------------------------------------
+  static void InvalidateContainerQuota();
+
   //----------------------------------------------------------------------------
   //! Callback function to calculate how much pyhisical space a file occupies
   //!
@@ -562,6 +623,31 @@ public:
   static
   int FilePlacement(Scheduler::PlacementArguments* args);
 
+  //----------------------------------------------------------------------------
+  //! Place several files of the same layout in one call e.g. for conversions.
+  //! The quota is checked once for the whole batch and the placement is done
+  //! by Scheduler::FilePlacementBatch.
+  //!
+  //! @param args arguments shared by all the files
+  //! @param inodes inodes of the files to place
+  //! @param placements filesystems selected for each file, the entries of the
+  //!        files that could not be placed are empty
+  //! @param dataproxys if non NULL, dataproxys scheduled for each file
+  //! @param firewallentpts if non NULL, firewall entry points scheduled for
+  //!        each file
+  //!
+  //! @return 0 if all the files were placed, otherwise a non-zero value
+  //!         ENOSPC - no space or not all the files could be placed
+  //!         EDQUOT - not enough quota to place the whole batch
+  //! @warning Must be called with a lock on the FsView::gFsView::ViewMutex
+  //----------------------------------------------------------------------------
+  static
+  int FilePlacementBatch(Scheduler::PlacementArguments* args,
+                         const std::vector<ino64_t>& inodes,
+                         std::vector<std::vector<unsigned int>>& placements,
+                         std::vector<std::vector<std::string>>* dataproxys = 0,
+                         std::vector<std::vector<std::string>>* firewallentpts = 0);
+
   //----------------------------------------------------------------------------
   //! Take the decision from where to access a file. The core of the
   //! implementation is in the Scheduler and GeoTreeEngine.
@@ -612,8 +698,40 @@ private:
   //----------------------------------------------------------------------------
   static SpaceQuota* GetResponsibleSpaceQuota(const std::string& path);
 
+  //----------------------------------------------------------------------------
+  //! Get the cached space quota responsible for a container
+  //!
+  //! @param squota responsible space quota, 0 if there is none
+  //!
+  //! @return true if the container is cached, otherwise false
+  //! @warning Caller has to be in an EpochManager read-side section
+  //----------------------------------------------------------------------------
+  static bool GetContainerQuota(unsigned long long cid, SpaceQuota*& squota);
+
+  //----------------------------------------------------------------------------
+  //! Cache the space quota responsible for a container
+  //!
+  //! @warning Caller needs to hold a read-lock on pMapMutex
+  //----------------------------------------------------------------------------
+  static void SetContainerQuota(unsigned long long cid, SpaceQuota* squota);
+
+  //----------------------------------------------------------------------------
+  //! Clear the container cache
+  //!
+  //! @warning Caller needs to hold a write-lock on pMapMutex
+  //----------------------------------------------------------------------------
+  static void ClearContainerQuota();
+
+  //! Cached space quota of a container
+  struct ContainerQuota {
+    std::atomic<unsigned long long> mKey; ///< cid + 2, 1 if busy, 0 if empty
+    std::atomic<SpaceQuota*> mQuota; ///< responsible space quota or 0
+  };
+
   //! Map from path to SpaceQuota object
   static std::map<std::string, SpaceQuota*> pMapQuota;
+  //! Lock-free cache from container id to responsible SpaceQuota object
+  static ContainerQuota pContainerQuota[];
 };
 
 EOSMGMNAMESPACE_END
@@ -0,0 +1,267 @@
+//------------------------------------------------------------------------------
+// File: QuotaBudget.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/QuotaBudget.hh"
+#include "common/Logging.hh"
+
+EOSMGMNAMESPACE_BEGIN
+
+//! Number of entries per table, a power of 2
+static const size_t sBudgetSlots = 512;
+//! Number of entries probed for a key
+static const size_t sMaxProbes = 8;
+
+//------------------------------------------------------------------------------
+// Hash of a quota index
+//------------------------------------------------------------------------------
+static inline size_t
+BudgetHash(unsigned long long key)
+{
+  return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+QuotaBudget::QuotaBudget():
+  mTable(nullptr)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+QuotaBudget::~QuotaBudget()
+{
+  delete[] mTable.load();
+}
+
+//------------------------------------------------------------------------------
+// Decide if a write respects the user/group/project quota left
+//------------------------------------------------------------------------------
+bool
+QuotaBudget::HasQuota(const QuotaLeft left[3], long long desired_vol,
+                      unsigned int inodes)
+{
+  bool hasquota = false;
+  bool hasid[2] = { false, false };
+
+  for (int i = 0; i < 2; i++) {
+    if (left[i].mBytesTarget) {
+      hasid[i] = (left[i].mBytes > desired_vol);
+    }
+
+    if (left[i].mFilesTarget) {
+      if (left[i].mFiles > inodes) {
+        if (!left[i].mBytesTarget) {
+          hasid[i] = true;
+        }
+      } else {
+        hasid[i] = false;
+      }
+    }
+  }
+
+  bool userquota = left[0].mBytesTarget || left[0].mFilesTarget;
+  bool groupquota = left[1].mBytesTarget || left[1].mFilesTarget;
+  bool hasprojectquota = (left[2].mBytes > desired_vol) &&
+                         (left[2].mFiles > inodes);
+  bool projectquota = !userquota && !groupquota;
+  eos_static_debug("userquota=%d groupquota=%d hasuserquota=%d "
+                   "hasgroupquota=%d userinodequota=%d uservolumequota=%d "
+                   "projectquota=%d hasprojectquota=%d", userquota, groupquota,
+                   hasid[0], hasid[1], left[0].mFilesTarget, left[0].mBytesTarget,
+                   projectquota, hasprojectquota);
+
+  // If both quotas are defined we need to have both
+  if (userquota && groupquota) {
+    hasquota = hasid[0] & hasid[1];
+  } else {
+    hasquota = hasid[0] || hasid[1];
+  }
+
+  if (projectquota && hasprojectquota) {
+    hasquota = true;
+  }
+
+  return hasquota;
+}
+
+//------------------------------------------------------------------------------
+// Check a write on the cached budgets and debit it
+//------------------------------------------------------------------------------
+bool
+QuotaBudget::Book(const unsigned long long keys[3],
+                  unsigned long long generation, time_t now,
+                  long long desired_vol, unsigned int desired_inodes)
+{
+  Entry* table = mTable.load(std::memory_order_acquire);
+
+  if (!table) {
+    return false;
+  }
+
+  Entry* entries[3];
+  QuotaLeft left[3];
+  bool reconcile = false;
+
+  for (int i = 0; i < 3; i++) {
+    entries[i] = Find(table, keys[i], false);
+
+    if (!entries[i] ||
+        !Read(entries[i], keys[i], generation, now, left[i], reconcile)) {
+      return false;
+    }
+  }
+
+  if (reconcile || !HasQuota(left, desired_vol, desired_inodes)) {
+    return false;
+  }
+
+  // the group entry may be the project one
+  for (int i = 0; i < 3; i++) {
+    if ((i == 2) && (entries[2] == entries[1])) {
+      break;
+    }
+
+    entries[i]->mBytes.fetch_sub(desired_vol);
+    entries[i]->mFiles.fetch_sub(desired_inodes);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Store the budgets computed from the ns quota node
+//------------------------------------------------------------------------------
+void
+QuotaBudget::Store(const unsigned long long keys[3],
+                   unsigned long long generation, time_t now,
+                   const QuotaLeft left[3])
+{
+  Entry* table = mTable.load(std::memory_order_acquire);
+
+  if (!table) {
+    Entry* fresh = new Entry[sBudgetSlots];
+
+    for (size_t i = 0; i < sBudgetSlots; i++) {
+      fresh[i].mKey = 0;
+      fresh[i].mGeneration = 0;
+      fresh[i].mUpdate = 0;
+      fresh[i].mBytes = 0;
+      fresh[i].mFiles = 0;
+      fresh[i].mTargets = 0;
+      fresh[i].mLock = 0;
+    }
+
+    if (mTable.compare_exchange_strong(table, fresh)) {
+      table = fresh;
+    } else {
+      delete[] fresh;
+    }
+  }
+
+  for (int i = 0; i < 3; i++) {
+    Entry* entry = Find(table, keys[i], true);
+    int unlocked = 0;
+
+    if (!entry->mLock.compare_exchange_strong(unlocked, 1)) {
+      continue;
+    }
+
+    entry->mGeneration.store(0);
+    entry->mKey.store(keys[i]);
+    entry->mTargets.store((left[i].mBytesTarget ? 1 : 0) |
+                          (left[i].mFilesTarget ? 2 : 0));
+    entry->mBytes.store(left[i].mBytes);
+    entry->mFiles.store(left[i].mFiles);
+    entry->mUpdate.store(now);
+    entry->mGeneration.store(generation);
+    entry->mLock.store(0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Find the entry of a quota index
+//------------------------------------------------------------------------------
+QuotaBudget::Entry*
+QuotaBudget::Find(Entry* table, unsigned long long key, bool create)
+{
+  size_t start = BudgetHash(key);
+  Entry* empty = 0;
+
+  for (size_t i = 0; i < sMaxProbes; i++) {
+    Entry* entry = &table[(start + i) & (sBudgetSlots - 1)];
+    unsigned long long current = entry->mKey.load();
+
+    if (current == key) {
+      return entry;
+    }
+
+    if (!current && !empty) {
+      empty = entry;
+    }
+  }
+
+  if (!create) {
+    return 0;
+  }
+
+  // evict the first probed entry if there is no free one
+  return (empty ? empty : &table[start & (sBudgetSlots - 1)]);
+}
+
+//------------------------------------------------------------------------------
+// Read an entry
+//------------------------------------------------------------------------------
+bool
+QuotaBudget::Read(Entry* entry, unsigned long long key,
+                  unsigned long long generation, time_t now, QuotaLeft& left,
+                  bool& reconcile)
+{
+  if (entry->mGeneration.load() != generation) {
+    return false;
+  }
+
+  int targets = entry->mTargets.load();
+  left.mBytesTarget = (targets & 1);
+  left.mFilesTarget = (targets & 2);
+  left.mBytes = entry->mBytes.load();
+  left.mFiles = entry->mFiles.load();
+
+  // an update or an eviction in between invalidates what we read
+  if ((entry->mGeneration.load() != generation) ||
+      (entry->mKey.load() != key)) {
+    return false;
+  }
+
+  time_t update = entry->mUpdate.load();
+
+  // only one caller reconciles, the others go on with the cached values
+  if ((update + sBudgetLifetime <= now) &&
+      entry->mUpdate.compare_exchange_strong(update, now)) {
+    reconcile = true;
+  }
+
+  return true;
+}
+
+EOSMGMNAMESPACE_END
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// File: QuotaBudget.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_QUOTABUDGET__HH__
+#define __EOSMGM_QUOTABUDGET__HH__
+
+#include "mgm/Namespace.hh"
+#include <atomic>
+#include <time.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Remaining quota of a user or group
+//------------------------------------------------------------------------------
+struct QuotaLeft {
+  bool mBytesTarget; ///< volume quota defined
+  bool mFilesTarget; ///< inode quota defined
+  long long mBytes; ///< remaining volume
+  long long mFiles; ///< remaining inodes
+};
+
+//------------------------------------------------------------------------------
+//! @brief Remaining user, group and project quota of a space quota cached per
+//! quota index, so that a write can be checked without any lock.
+//!
+//! The entries are kept in an open addressing table of atomics. A successful
+//! check debits the booking from the entries. The entries are invalidated
+//! when the quota targets change (generation) and one caller is asked to
+//! reconcile them with the ns quota node after sBudgetLifetime seconds.
+//------------------------------------------------------------------------------
+class QuotaBudget
+{
+public:
+  //! Seconds after which a budget is reconciled with the ns quota node
+  static const time_t sBudgetLifetime = 5;
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  QuotaBudget();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~QuotaBudget();
+
+  //----------------------------------------------------------------------------
+  //! Decide if a write respects the quota left. If both user and group quotas
+  //! are defined, then both need to be satisfied.
+  //!
+  //! @param left user, group and project quota left
+  //! @param desired_vol desired volume
+  //! @param desired_inodes desired number of inodes
+  //----------------------------------------------------------------------------
+  static bool HasQuota(const QuotaLeft left[3], long long desired_vol,
+                       unsigned int desired_inodes);
+
+  //----------------------------------------------------------------------------
+  //! Check a write on the cached budgets and debit it
+  //!
+  //! @param keys user, group and project quota index + 1
+  //! @param generation current generation of the quota targets
+  //! @param now current time
+  //! @param desired_vol desired volume
+  //! @param desired_inodes desired number of inodes
+  //!
+  //! @return true if the write was booked, false if a budget is missing,
+  //!         outdated, due for reconciliation or exhausted. The caller then
+  //!         has to check against the ns quota node and call Store.
+  //----------------------------------------------------------------------------
+  bool Book(const unsigned long long keys[3], unsigned long long generation,
+            time_t now, long long desired_vol, unsigned int desired_inodes);
+
+  //----------------------------------------------------------------------------
+  //! Store the budgets computed from the ns quota node
+  //!
+  //! @param keys user, group and project quota index + 1
+  //! @param generation generation of the quota targets sampled before
+  //!        computing the values
+  //! @param now current time
+  //! @param left user, group and project quota left
+  //----------------------------------------------------------------------------
+  void Store(const unsigned long long keys[3], unsigned long long generation,
+             time_t now, const QuotaLeft left[3]);
+
+private:
+  //! Cached remaining quota of a user or group. A writer owns the entry
+  //! through mLock and sets mGeneration to 0 while updating it.
+  struct Entry {
+    std::atomic<unsigned long long> mKey; ///< quota index + 1, 0 if empty
+    std::atomic<unsigned long long> mGeneration; ///< target generation
+    std::atomic<time_t> mUpdate; ///< time of the last reconciliation
+    std::atomic<long long> mBytes; ///< remaining volume
+    std::atomic<long long> mFiles; ///< remaining inodes
+    std::atomic<int> mTargets; ///< bit 0 volume, bit 1 inode quota defined
+    std::atomic<int> mLock; ///< set while a writer updates the entry
+  };
+
+  //----------------------------------------------------------------------------
+  //! Find the entry of a quota index
+  //!
+  //! @param create return an empty or evictable entry if not found
+  //----------------------------------------------------------------------------
+  Entry* Find(Entry* table, unsigned long long key, bool create);
+
+  //----------------------------------------------------------------------------
+  //! Read an entry
+  //!
+  //! @param reconcile set if the caller has to reconcile the entry
+  //!
+  //! @return true if the entry is valid, otherwise false
+  //----------------------------------------------------------------------------
+  bool Read(Entry* entry, unsigned long long key,
+            unsigned long long generation, time_t now, QuotaLeft& left,
+            bool& reconcile);
+
+  std::atomic<Entry*> mTable; ///< Entries, allocated by the first Store
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -0,0 +1,390 @@
+//------------------------------------------------------------------------------
+// File: RateLimiter.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/RateLimiter.hh"
+#include "mgm/geotree/EpochManager.hh"
+#include "common/Logging.hh"
+#include "common/Mapping.hh"
+#include "common/StringConversion.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+EOSMGMNAMESPACE_BEGIN
+
+//! Number of buckets of a wildcard rule, i.e. of clients tracked at once
+static const size_t sWildcardBuckets = 4096;
+//! Number of buckets probed before giving up on a client
+static const size_t sMaxProbes = 16;
+//! Maximum debt a client can accumulate, this bounds the stall time
+static const int64_t sMaxDebtNs = 5000000000ll;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+RateLimiter::RateLimiter():
+  mTable(nullptr)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+RateLimiter::~RateLimiter()
+{
+  delete mTable.load();
+}
+
+//------------------------------------------------------------------------------
+// Monotonic time in nanoseconds
+//------------------------------------------------------------------------------
+int64_t
+RateLimiter::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+         (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+// Find the bucket of an id and optionally create it. A bucket which is idle,
+// i.e. holds no debt, can be taken over by another id since its state is the
+// same as the one of a new bucket.
+//------------------------------------------------------------------------------
+RateLimiter::Bucket*
+RateLimiter::Rule::GetBucket(uint32_t id, int64_t now, bool create)
+{
+  const uint64_t key = (uint64_t) id + 1;
+  const size_t start = (id * 2654435761u) & mMask;
+  const size_t probes = std::min(mMask + 1, sMaxProbes);
+
+  for (size_t i = 0; i < probes; i++) {
+    Bucket* bucket = &mBuckets[(start + i) & mMask];
+    uint64_t current = bucket->mKey.load(std::memory_order_acquire);
+
+    if (current == key) {
+      return bucket;
+    }
+
+    if (!current) {
+      // buckets are never emptied, so the id can't be further away
+      break;
+    }
+  }
+
+  if (!create) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < probes; i++) {
+    Bucket* bucket = &mBuckets[(start + i) & mMask];
+    uint64_t current = bucket->mKey.load(std::memory_order_acquire);
+
+    while (!current ||
+           (current != key && bucket->mTat.load(std::memory_order_relaxed) <= now)) {
+      if (bucket->mKey.compare_exchange_weak(current, key)) {
+        return bucket;
+      }
+    }
+
+    if (current == key) {
+      return bucket;
+    }
+  }
+
+  // all the probed buckets are used by clients which are over their rate
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Split a rate rule key
+//------------------------------------------------------------------------------
+bool
+RateLimiter::SplitKey(const std::string& key, std::vector<std::string>& tokens)
+{
+  // rate:<user|group>:<name|*>:<op>
+  tokens.clear();
+  eos::common::StringConversion::Tokenize(key, tokens, ":");
+  return ((tokens.size() == 4) && (tokens[0] == "rate") &&
+          ((tokens[1] == "user") || (tokens[1] == "group")));
+}
+
+//------------------------------------------------------------------------------
+// Resolve the user or group name of a rate rule
+//------------------------------------------------------------------------------
+void
+RateLimiter::Resolve(const std::string& key)
+{
+  std::vector<std::string> tokens;
+
+  if (!SplitKey(key, tokens) || (tokens[2] == "*")) {
+    return;
+  }
+
+  int errc = 0;
+  uint32_t id = 0;
+
+  if (tokens[1] == "group") {
+    gid_t gid;
+
+    if (eos::common::Mapping::IsGid(tokens[2].c_str(), gid)) {
+      return;
+    }
+
+    id = eos::common::Mapping::GroupNameToGid(tokens[2], errc);
+  } else {
+    uid_t uid;
+
+    if (eos::common::Mapping::IsUid(tokens[2].c_str(), uid)) {
+      return;
+    }
+
+    id = eos::common::Mapping::UserNameToUid(tokens[2], errc);
+  }
+
+  std::lock_guard<std::mutex> lock(mIdsMutex);
+
+  if (errc) {
+    mIds.erase(tokens[1] + ":" + tokens[2]);
+  } else {
+    mIds[tokens[1] + ":" + tokens[2]] = id;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Parse a rate rule
+//------------------------------------------------------------------------------
+std::unique_ptr<RateLimiter::Rule>
+RateLimiter::ParseRule(const std::string& key, const std::string& value)
+{
+  std::vector<std::string> tokens;
+  double rate = strtod(value.c_str(), 0);
+
+  if (!SplitKey(key, tokens) || (rate <= 0)) {
+    return nullptr;
+  }
+
+  std::unique_ptr<Rule> rule(new Rule());
+  rule->mKey = key;
+  rule->mValue = value;
+  rule->mOp = tokens[3];
+  rule->mGroup = (tokens[1] == "group");
+  rule->mWildcard = (tokens[2] == "*");
+  rule->mId = 0;
+
+  if (!rule->mWildcard) {
+    uid_t uid;
+    gid_t gid;
+
+    if (rule->mGroup && eos::common::Mapping::IsGid(tokens[2].c_str(), gid)) {
+      rule->mId = gid;
+    } else if (!rule->mGroup &&
+               eos::common::Mapping::IsUid(tokens[2].c_str(), uid)) {
+      rule->mId = uid;
+    } else {
+      // names are resolved by Resolve, the Access mutex is held here
+      std::lock_guard<std::mutex> lock(mIdsMutex);
+      auto it = mIds.find(tokens[1] + ":" + tokens[2]);
+
+      if (it == mIds.end()) {
+        return nullptr;
+      }
+
+      rule->mId = it->second;
+    }
+  }
+
+  rule->mInterval = std::max((int64_t) 1, (int64_t)(1e9 / rate));
+  // allow a burst of one second worth of operations
+  rule->mTolerance = std::max((int64_t) 1000000000ll, rule->mInterval);
+  rule->mMask = (rule->mWildcard ? sWildcardBuckets : 1) - 1;
+  rule->mBuckets.reset(new Bucket[rule->mMask + 1]);
+
+  for (size_t i = 0; i <= rule->mMask; i++) {
+    rule->mBuckets[i].mKey = 0;
+    rule->mBuckets[i].mTat = 0;
+  }
+
+  return rule;
+}
+
+//------------------------------------------------------------------------------
+// Compile the rate rules, must be called with the Access mutex write-locked
+//------------------------------------------------------------------------------
+void
+RateLimiter::Compile(const std::map<std::string, std::string>& stall_rules)
+{
+  Table* old = mTable.load(std::memory_order_relaxed);
+  std::unique_ptr<Table> table(new Table());
+
+  for (auto it = stall_rules.begin(); it != stall_rules.end(); ++it) {
+    if (it->first.find("rate:") != 0) {
+      continue;
+    }
+
+    std::unique_ptr<Rule> rule;
+
+    if (old) {
+      // keep the buckets of unchanged rules, readers of the old table only
+      // use the raw pointers which stay valid
+      for (auto rit = old->mRules.begin(); rit != old->mRules.end(); ++rit) {
+        if (*rit && ((*rit)->mKey == it->first) && ((*rit)->mValue == it->second)) {
+          rule = std::move(*rit);
+          break;
+        }
+      }
+    }
+
+    if (!rule) {
+      rule = ParseRule(it->first, it->second);
+    }
+
+    if (!rule) {
+      eos_static_warning("msg=\"ignoring invalid or unresolved rate rule\" rule=\"%s\" value=\"%s\"",
+                         it->first.c_str(), it->second.c_str());
+      continue;
+    }
+
+    table->mByOp[rule->mOp].push_back(rule.get());
+    table->mAll.push_back(rule.get());
+    table->mRules.push_back(std::move(rule));
+  }
+
+  mTable.store(table->mAll.empty() ? nullptr : table.release(),
+               std::memory_order_release);
+
+  if (old) {
+    EpochManager::synchronize();
+    delete old;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Account for operations done by a client
+//------------------------------------------------------------------------------
+void
+RateLimiter::Record(const char* op, uid_t uid, gid_t gid, unsigned long nops)
+{
+  if (!mTable.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  Record(op, uid, gid, nops, Now());
+}
+
+//------------------------------------------------------------------------------
+// Account for operations done by a client at a given time
+//------------------------------------------------------------------------------
+void
+RateLimiter::Record(const char* op, uid_t uid, gid_t gid, unsigned long nops,
+                    int64_t now)
+{
+  EpochManager::ReadGuard guard;
+  Table* table = mTable.load(std::memory_order_acquire);
+
+  if (!table) {
+    return;
+  }
+
+  auto it = table->mByOp.find(op);
+
+  if (it == table->mByOp.end()) {
+    return;
+  }
+
+  for (auto rit = it->second.begin(); rit != it->second.end(); ++rit) {
+    Rule* rule = *rit;
+
+    if (!rule->Matches(uid, gid)) {
+      continue;
+    }
+
+    Bucket* bucket = rule->GetBucket(rule->mGroup ? gid : uid, now, true);
+
+    if (!bucket) {
+      continue;
+    }
+
+    int64_t tat = bucket->mTat.load(std::memory_order_relaxed);
+    int64_t next;
+
+    do {
+      next = std::min(std::max(tat, now) + (int64_t) nops * rule->mInterval,
+                      now + rule->mTolerance + sMaxDebtNs);
+    } while (!bucket->mTat.compare_exchange_weak(tat, next,
+             std::memory_order_relaxed));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Check if a client exceeds any of the rate rules
+//------------------------------------------------------------------------------
+bool
+RateLimiter::Exceeded(uid_t uid, gid_t gid, int& stalltime, std::string& rule)
+{
+  if (!mTable.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  return Exceeded(uid, gid, stalltime, rule, Now());
+}
+
+//------------------------------------------------------------------------------
+// Check if a client exceeds any of the rate rules at a given time
+//------------------------------------------------------------------------------
+bool
+RateLimiter::Exceeded(uid_t uid, gid_t gid, int& stalltime, std::string& rule,
+                      int64_t now)
+{
+  EpochManager::ReadGuard guard;
+  Table* table = mTable.load(std::memory_order_acquire);
+
+  if (!table) {
+    return false;
+  }
+
+  for (auto it = table->mAll.begin(); it != table->mAll.end(); ++it) {
+    Rule* r = *it;
+
+    if (!r->Matches(uid, gid)) {
+      continue;
+    }
+
+    Bucket* bucket = r->GetBucket(r->mGroup ? gid : uid, now, false);
+
+    if (!bucket) {
+      continue;
+    }
+
+    int64_t excess = bucket->mTat.load(std::memory_order_relaxed) - now -
+                     r->mTolerance;
+
+    if (excess > 0) {
+      // stall until the client is within its rate again
+      stalltime = (int)((excess + 999999999ll) / 1000000000ll);
+      rule = r->mKey;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+EOSMGMNAMESPACE_END
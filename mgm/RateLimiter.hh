@@ -0,0 +1,185 @@
+//------------------------------------------------------------------------------
+// File: RateLimiter.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_RATELIMITER__HH__
+#define __EOSMGM_RATELIMITER__HH__
+
+#include "mgm/Namespace.hh"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Token buckets enforcing the rate:<user|group>:<name|*>:<op> stall
+//! rules.
+//!
+//! The stall rules are compiled into a table which is published atomically
+//! and protected by epochs, so that recording an operation and checking a
+//! client never take a lock. Every rule keeps one bucket per uid (or gid) in
+//! an open addressing hash table. A bucket is a single atomic holding the
+//! theoretical arrival time of the next operation (GCRA), so a client can
+//! burst up to one second worth of operations and is limited to the rule
+//! rate afterwards.
+//------------------------------------------------------------------------------
+class RateLimiter
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  RateLimiter();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~RateLimiter();
+
+  //----------------------------------------------------------------------------
+  //! Resolve the user or group name of a rate rule. Must be called for every
+  //! new rule naming a user or group before compiling it, without holding
+  //! the Access mutex since it may query the password or group database.
+  //!
+  //! @param key stall rule key, ignored if not a rate rule
+  //----------------------------------------------------------------------------
+  void Resolve(const std::string& key);
+
+  //----------------------------------------------------------------------------
+  //! Compile the rate rules out of the stall rules and replace the current
+  //! table. The buckets of a rule that did not change are kept. A rule naming
+  //! a user or group which was not resolved is ignored.
+  //!
+  //! @param stall_rules map of stall rules as in Access::gStallRules
+  //----------------------------------------------------------------------------
+  void Compile(const std::map<std::string, std::string>& stall_rules);
+
+  //----------------------------------------------------------------------------
+  //! Account for operations done by a client
+  //!
+  //! @param op operation tag as used in the MGM statistics
+  //! @param uid user id
+  //! @param gid group id
+  //! @param nops number of operations
+  //----------------------------------------------------------------------------
+  void Record(const char* op, uid_t uid, gid_t gid, unsigned long nops);
+
+  //----------------------------------------------------------------------------
+  //! Account for operations done by a client at a given monotonic time in
+  //! nanoseconds
+  //----------------------------------------------------------------------------
+  void Record(const char* op, uid_t uid, gid_t gid, unsigned long nops,
+              int64_t now);
+
+  //----------------------------------------------------------------------------
+  //! Check if a client exceeds any of the rate rules
+  //!
+  //! @param uid user id
+  //! @param gid group id
+  //! @param stalltime seconds after which the client is within its rate
+  //!        again, at least 1
+  //! @param rule key of the rule which is exceeded
+  //!
+  //! @return true if a rule is exceeded, otherwise false
+  //----------------------------------------------------------------------------
+  bool Exceeded(uid_t uid, gid_t gid, int& stalltime, std::string& rule);
+
+  //----------------------------------------------------------------------------
+  //! Check if a client exceeds any of the rate rules at a given monotonic
+  //! time in nanoseconds
+  //----------------------------------------------------------------------------
+  bool Exceeded(uid_t uid, gid_t gid, int& stalltime, std::string& rule,
+                int64_t now);
+
+  //----------------------------------------------------------------------------
+  //! Monotonic time in nanoseconds
+  //----------------------------------------------------------------------------
+  static int64_t Now();
+
+private:
+  //! One bucket of a rule, keyed by the uid or gid plus 1 (0 means empty)
+  struct Bucket {
+    std::atomic<uint64_t> mKey;
+    std::atomic<int64_t> mTat; ///< Theoretical arrival time in ns
+  };
+
+  //! A compiled rate rule
+  struct Rule {
+    std::string mKey; ///< Rule key in the stall rules
+    std::string mValue; ///< Rule value in the stall rules
+    std::string mOp; ///< Operation tag
+    bool mGroup; ///< Rule applies to group ids
+    bool mWildcard; ///< Rule applies to every id
+    uint32_t mId; ///< Id the rule applies to if not a wildcard
+    int64_t mInterval; ///< Nanoseconds per operation
+    int64_t mTolerance; ///< Burst tolerance in nanoseconds
+    size_t mMask; ///< Bucket table size - 1
+    std::unique_ptr<Bucket[]> mBuckets;
+
+    bool Matches(uid_t uid, gid_t gid) const
+    {
+      return mWildcard || (mId == (mGroup ? gid : uid));
+    }
+
+    Bucket* GetBucket(uint32_t id, int64_t now, bool create);
+  };
+
+  //! A set of rules, immutable for the readers
+  struct Table {
+    std::vector<std::unique_ptr<Rule>> mRules; ///< Owned, only the writer
+    std::vector<Rule*> mAll; ///< All the rules, for the readers
+    std::unordered_map<std::string, std::vector<Rule*>> mByOp;
+  };
+
+  //----------------------------------------------------------------------------
+  //! Parse a rate rule
+  //!
+  //! @return rule or nullptr if the rule is not a valid rate rule
+  //----------------------------------------------------------------------------
+  std::unique_ptr<Rule> ParseRule(const std::string& key,
+                                  const std::string& value);
+
+  //----------------------------------------------------------------------------
+  //! Split a rate rule key
+  //!
+  //! @param key rate:<user|group>:<name|*>:<op>
+  //! @param tokens filled with the four fields
+  //!
+  //! @return false if the key is not a rate rule key
+  //----------------------------------------------------------------------------
+  static bool SplitKey(const std::string& key, std::vector<std::string>& tokens);
+
+  std::atomic<Table*> mTable; ///< Current table, nullptr if no rate rules
+  std::mutex mIdsMutex; ///< Mutex protecting mIds
+  //! Ids of the names used in the rules, keyed by "<user|group>:<name>"
+  std::map<std::string, uint32_t> mIds;
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
@@ -30,6 +30,7 @@
 #include "mgm/Quota.hh"
 #include "mgm/XrdMgmOfsDirectory.hh"
 #include "XrdSys/XrdSysTimer.hh"
+#include <vector>
 
 // MgmOfsConfigure prepends the proc directory path e.g. the bin is
 // /eos/<instance/proc/recycle/
@@ -43,6 +44,238 @@ int Recycle::gRecyclingPollTime = 30;
 
 EOSMGMNAMESPACE_BEGIN
 
+XrdSysMutex Recycle::gIndexMutex;
+std::map<Recycle::IndexKey, std::pair<uid_t, gid_t> > Recycle::gExpiryIndex;
+std::map<uid_t, std::set<Recycle::IndexKey> > Recycle::gUserIndex;
+std::map<std::string, time_t> Recycle::gPathIndex;
+bool Recycle::gIndexReady = false;
+unsigned long long Recycle::gIndexGeneration = 0;
+XrdSysMutex Recycle::gIndexBuildMutex;
+
+/*----------------------------------------------------------------------------*/
+// the bin paths are built from the prefix with and without a trailing '/',
+// the index uses them without double slashes
+static std::string
+IndexPath(const std::string& path)
+{
+  std::string ipath = path;
+  size_t pos;
+
+  while ((pos = ipath.find("//")) != std::string::npos) {
+    ipath.erase(pos, 1);
+  }
+
+  return ipath;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::IndexAdd(const std::string& path, time_t deletiontime, uid_t uid,
+                  gid_t gid)
+{
+  std::string ipath = IndexPath(path);
+
+  // only the entries of the bin cleaned by the recycle thread are indexed
+  if (ipath.compare(0, IndexPath(gRecyclingPrefix).length(),
+                    IndexPath(gRecyclingPrefix))) {
+    return;
+  }
+
+  XrdSysMutexHelper lock(gIndexMutex);
+  auto it = gPathIndex.find(ipath);
+
+  if (it != gPathIndex.end()) {
+    IndexKey old(it->second, ipath);
+    auto eit = gExpiryIndex.find(old);
+
+    if (eit != gExpiryIndex.end()) {
+      gUserIndex[eit->second.first].erase(old);
+      gExpiryIndex.erase(eit);
+    }
+  }
+
+  IndexKey key(deletiontime, ipath);
+  gExpiryIndex[key] = std::make_pair(uid, gid);
+  gUserIndex[uid].insert(key);
+  gPathIndex[ipath] = deletiontime;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::IndexRemove(const std::string& path)
+{
+  std::string ipath = IndexPath(path);
+  XrdSysMutexHelper lock(gIndexMutex);
+  auto it = gPathIndex.find(ipath);
+
+  if (it == gPathIndex.end()) {
+    return;
+  }
+
+  IndexKey key(it->second, ipath);
+  auto eit = gExpiryIndex.find(key);
+
+  if (eit != gExpiryIndex.end()) {
+    auto uit = gUserIndex.find(eit->second.first);
+
+    if (uit != gUserIndex.end()) {
+      uit->second.erase(key);
+
+      if (uit->second.empty()) {
+        gUserIndex.erase(uit);
+      }
+    }
+
+    gExpiryIndex.erase(eit);
+  }
+
+  gPathIndex.erase(it);
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::IndexOldest(IndexKey& key)
+{
+  XrdSysMutexHelper lock(gIndexMutex);
+
+  if (gExpiryIndex.empty()) {
+    return false;
+  }
+
+  key = gExpiryIndex.begin()->first;
+  return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void
+Recycle::InvalidateIndex()
+{
+  XrdSysMutexHelper lock(gIndexMutex);
+  gIndexGeneration++;
+  gIndexReady = false;
+}
+
+/*----------------------------------------------------------------------------*/
+bool
+Recycle::BuildIndex()
+{
+  XrdSysMutexHelper build_lock(gIndexBuildMutex);
+  unsigned long long generation = 0;
+  {
+    XrdSysMutexHelper lock(gIndexMutex);
+
+    if (gIndexReady) {
+      return true;
+    }
+
+    generation = gIndexGeneration;
+    gExpiryIndex.clear();
+    gUserIndex.clear();
+    gPathIndex.clear();
+  }
+  //...........................................................................
+  // the bin has the structure <prefix>/<gid>/<uid>/<entry>, entries recycled
+  // meanwhile are added by ToGarbage
+  //...........................................................................
+  eos::common::Mapping::VirtualIdentity rootvid;
+  eos::common::Mapping::Root(rootvid);
+  XrdOucErrInfo lError;
+  XrdMgmOfsDirectory dirl1;
+  XrdMgmOfsDirectory dirl2;
+  XrdMgmOfsDirectory dirl3;
+  unsigned long long nentries = 0;
+
+  if (dirl1.open(Recycle::gRecyclingPrefix.c_str(), rootvid, (const char*) 0)) {
+    eos_static_err("msg=\"unable to list the garbage directory level-1\" recycle-path=%s",
+                   Recycle::gRecyclingPrefix.c_str());
+    return false;
+  }
+
+  const char* dname1;
+
+  while ((dname1 = dirl1.nextEntry())) {
+    std::string sdname1 = dname1;
+
+    if ((sdname1 == ".") || (sdname1 == "..")) {
+      continue;
+    }
+
+    gid_t gid = strtoull(dname1, 0, 10);
+    std::string l2 = Recycle::gRecyclingPrefix;
+    l2 += dname1;
+
+    // list level-2 user directories
+    if (dirl2.open(l2.c_str(), rootvid, (const char*) 0)) {
+      eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s",
+                     Recycle::gRecyclingPrefix.c_str(), l2.c_str());
+      continue;
+    }
+
+    const char* dname2;
+
+    while ((dname2 = dirl2.nextEntry())) {
+      std::string sdname2 = dname2;
+
+      if ((sdname2 == ".") || (sdname2 == "..")) {
+        continue;
+      }
+
+      uid_t uid = strtoull(dname2, 0, 10);
+      std::string l3 = l2;
+      l3 += "/";
+      l3 += dname2;
+
+      // list the level-3 entries
+      if (dirl3.open(l3.c_str(), rootvid, (const char*) 0)) {
+        eos_static_err("msg=\"unable to list the garbage directory level-3\" recycle-path=%s l2-path=%s l3-path=%s",
+                       Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
+        continue;
+      }
+
+      const char* dname3;
+
+      while ((dname3 = dirl3.nextEntry())) {
+        std::string sdname3 = dname3;
+
+        if ((sdname3 == ".") || (sdname3 == "..")) {
+          continue;
+        }
+
+        std::string l4 = l3;
+        l4 += "/";
+        l4 += dname3;
+        // Stat the entry to get the deletion time
+        struct stat buf;
+
+        if (gOFS->_stat(l4.c_str(), &buf, lError, rootvid, "", 0, false)) {
+          eos_static_err("msg=\"unable to stat a garbage directory entry\" "
+                         "recycle-path=%s l4-path=%s",
+                         Recycle::gRecyclingPrefix.c_str(), l4.c_str());
+        } else {
+          IndexAdd(l4, buf.st_ctime, uid, gid);
+          nentries++;
+        }
+      }
+
+      dirl3.close();
+    }
+
+    dirl2.close();
+  }
+
+  dirl1.close();
+  XrdSysMutexHelper lock(gIndexMutex);
+
+  if (generation != gIndexGeneration) {
+    eos_static_warning("msg=\"recycle index invalidated during the build\"");
+    return false;
+  }
+
+  gIndexReady = true;
+  eos_static_info("msg=\"built recycle bin index\" entries=%llu", nentries);
+  return true;
+}
+
 /*----------------------------------------------------------------------------*/
 bool
 Recycle::Start()
@@ -92,7 +325,6 @@ Recycle::Recycler()
   XrdOucErrInfo lError;
   time_t lKeepTime = 0;
   double lSpaceKeepRatio = 0;
-  std::multimap<time_t, std::string> lDeletionMap;
   time_t snoozetime = 10;
   unsigned long long lLowInodesWatermark = 0;
   unsigned long long lLowSpaceWatermark = 0;
@@ -195,110 +427,19 @@ Recycle::Recycler()
 
       if (attrmap.count(Recycle::gRecyclingTimeAttribute)) {
         lKeepTime = strtoull(attrmap[Recycle::gRecyclingTimeAttribute].c_str(), 0, 10);
-        eos_static_info("keep-time=%llu deletion-map=%llu", lKeepTime,
-                        lDeletionMap.size());
+        eos_static_info("keep-time=%llu", lKeepTime);
 
         if (lKeepTime > 0) {
-          if (!lDeletionMap.size()) {
+          if (BuildIndex()) {
             //...................................................................
-            //  the deletion map is filled if there is nothing inside with files/
-            //  directories found previously in the garbage bin
+            // pop the expired entries from the head of the expiry index
             //...................................................................
-            std::string subdirs;
-            XrdMgmOfsDirectory dirl1;
-            XrdMgmOfsDirectory dirl2;
-            XrdMgmOfsDirectory dirl3;
-            int listrc = dirl1.open(Recycle::gRecyclingPrefix.c_str(), rootvid,
-                                    (const char*) 0);
-
-            if (listrc) {
-              eos_static_err("msg=\"unable to list the garbage directory level-1\" recycle-path=%s",
-                             Recycle::gRecyclingPrefix.c_str());
-            } else {
-              // loop over all directories = group directories
-              const char* dname1;
-
-              while ((dname1 = dirl1.nextEntry())) {
-                {
-                  std::string sdname = dname1;
-
-                  if ((sdname == ".") || (sdname == "..")) {
-                    continue;
-                  }
-                }
-                std::string l2 = Recycle::gRecyclingPrefix;
-                l2 += dname1;
-                // list level-2 user directories
-                listrc = dirl2.open(l2.c_str(), rootvid, (const char*) 0);
-
-                if (listrc) {
-                  eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s",
-                                 Recycle::gRecyclingPrefix.c_str(), l2.c_str());
-                } else {
-                  const char* dname2;
-
-                  while ((dname2 = dirl2.nextEntry())) {
-                    {
-                      std::string sdname = dname2;
-
-                      if ((sdname == ".") || (sdname == "..")) {
-                        continue;
-                      }
-                    }
-                    std::string l3 = l2;
-                    l3 += "/";
-                    l3 += dname2;
-                    // list the level-3 entries
-                    listrc = dirl3.open(l3.c_str(), rootvid, (const char*) 0);
-
-                    if (listrc) {
-                      eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s l3-path=%s",
-                                     Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
-                    } else {
-                      const char* dname3;
-
-                      while ((dname3 = dirl3.nextEntry())) {
-                        {
-                          std::string sdname = dname3;
-
-                          if ((sdname == ".") || (sdname == "..")) {
-                            continue;
-                          }
-                        }
-                        std::string l4 = l3;
-                        l4 += "/";
-                        l4 += dname3;
-                        eos_static_info("path=%s", l4.c_str());
-                        // Stat the directory to get the mtime
-                        struct stat buf;
-
-                        if (gOFS->_stat(l4.c_str(), &buf, lError, rootvid, "", 0, false)) {
-                          eos_static_err("msg=\"unable to stat a garbage directory entry\" "
-                                         "recycle-path=%s l2-path=%s l3-path=%s",
-                                         Recycle::gRecyclingPrefix.c_str(), l2.c_str(), l3.c_str());
-                        } else {
-                          // Add to the garbage fifo deletion multimap
-                          lDeletionMap.insert(std::pair<time_t, std::string > (buf.st_ctime, l4));
-                        }
-                      }
-
-                      dirl3.close();
-                    }
-                  }
-
-                  dirl2.close();
-                }
-              }
-
-              dirl1.close();
-            }
-          } else {
-            auto it = lDeletionMap.begin();
+            IndexKey oldest;
             time_t now = time(NULL);
 
-            while (it != lDeletionMap.end()) {
+            while (IndexOldest(oldest)) {
               // take the first element and see if it is exceeding the keep time
-              if ((it->first + lKeepTime) < now) {
+              if ((oldest.first + lKeepTime) < now) {
                 // This entry can be removed
                 // If there is a keep-ratio policy defined we abort deletion once
                 // we are enough under the thresholds
@@ -323,9 +464,9 @@ Recycle::Recycler()
                   }
                 }
 
-                XrdOucString delpath = it->second.c_str();
+                XrdOucString delpath = oldest.second.c_str();
 
-                if ((it->second.length()) &&
+                if ((oldest.second.length()) &&
                     (delpath.endswith(Recycle::gRecyclingPostFix.c_str()))) {
                   //.............................................................
                   // do a directory deletion - first find all subtree children
@@ -335,9 +476,9 @@ Recycle::Recycler()
                   std::set<std::string>::const_iterator fileit;
                   XrdOucString stdErr;
 
-                  if (gOFS->_find(it->second.c_str(), lError, stdErr, rootvid, found)) {
+                  if (gOFS->_find(oldest.second.c_str(), lError, stdErr, rootvid, found)) {
                     eos_static_err("msg=\"unable to do a find in subtree\" path=%s stderr=\"%s\"",
-                                   it->second.c_str(), stdErr.c_str());
+                                   oldest.second.c_str(), stdErr.c_str());
                   } else {
                     //...........................................................
                     // standard way to delete files recursively
@@ -379,25 +520,21 @@ Recycle::Recycler()
                       }
                     }
                   }
-
-                  lDeletionMap.erase(it);
-                  it = lDeletionMap.begin();
                 } else {
                   //...........................................................
                   // do a single file deletion
                   //...........................................................
-                  if (gOFS->_rem(it->second.c_str(), lError, rootvid, (const char*) 0)) {
-                    eos_static_err("msg=\"unable to remove file\" path=%s", it->second.c_str());
+                  if (gOFS->_rem(oldest.second.c_str(), lError, rootvid, (const char*) 0)) {
+                    eos_static_err("msg=\"unable to remove file\" path=%s", oldest.second.c_str());
                   }
-
-                  lDeletionMap.erase(it);
-                  it = lDeletionMap.begin();
                 }
+
+                IndexRemove(oldest.second);
               } else {
                 //...............................................................
-                // this entry has still to be kept
+                // this entry and all the ones after it have still to be kept
                 //...............................................................
-                snoozetime = (it->first + lKeepTime) - now;
+                snoozetime = (oldest.first + lKeepTime) - now;
 
                 if (snoozetime < gRecyclingPollTime) {
                   //.............................................................
@@ -416,7 +553,7 @@ Recycle::Recycler()
                   snoozetime = lKeepTime;
                 }
 
-                it++;
+                break;
               }
             }
           }
@@ -533,6 +670,13 @@ Recycle::ToGarbage(const char* epname, XrdOucErrInfo& error)
     return gOFS->Emsg(epname, error, EIO, "rename file/directory", srecyclepath);
   }
 
+  // the rename sets the change time used as deletion time
+  if (!gOFS->_stat(srecyclepath, &buf, error, rootvid, "")) {
+    IndexAdd(srecyclepath, buf.st_ctime, mOwnerUid, mOwnerGid);
+  } else {
+    IndexAdd(srecyclepath, time(NULL), mOwnerUid, mOwnerGid);
+  }
+
   // store the recycle path in the error object
   error.setErrInfo(0, srecyclepath);
   return SFS_OK;
@@ -546,200 +690,170 @@ Recycle::Print(XrdOucString& stdOut, XrdOucString& stdErr,
 {
   XrdOucString uids;
   XrdOucString gids;
-  std::map<gid_t, std::map<uid_t, bool> > printmap;
   eos::common::Mapping::VirtualIdentity rootvid;
   eos::common::Mapping::Root(rootvid);
 
-  if ((!vid.uid) ||
-      (eos::common::Mapping::HasUid(3, vid.uid_list)) ||
-      (eos::common::Mapping::HasGid(4, vid.gid_list))) {
-    // add everything found in the recycle directory structure to the printmap
-    std::string subdirs;
-    XrdMgmOfsDirectory dirl1;
-    XrdMgmOfsDirectory dirl2;
-    int listrc = dirl1.open(Recycle::gRecyclingPrefix.c_str(), rootvid,
-                            (const char*) 0);
-
-    if (listrc) {
-      eos_static_err("msg=\"unable to list the garbage directory level-1\" recycle-path=%s",
-                     Recycle::gRecyclingPrefix.c_str());
-    } else {
-      // loop over all directories = group directories
-      const char* dname1;
+  if (details) {
+    size_t count = 0;
+    bool all = ((!vid.uid) ||
+                (eos::common::Mapping::HasUid(3, vid.uid_list)) ||
+                (eos::common::Mapping::HasGid(4, vid.gid_list)));
+    std::vector<std::string> entries;
+
+    if (!BuildIndex()) {
+      stdErr += "error: unable to list the recycle bin\n";
+      return;
+    }
 
-      while ((dname1 = dirl1.nextEntry())) {
-        std::string sdname = dname1;
+    {
+      // take the requested page of entries ordered by deletion time, admins
+      // see everything, users their own group/user directory
+      XrdSysMutexHelper lock(gIndexMutex);
+      unsigned long long skipped = 0;
+
+      if (all) {
+        for (auto it = gExpiryIndex.begin(); it != gExpiryIndex.end(); ++it) {
+          if (skipped++ < offset) {
+            continue;
+          }
 
-        if ((sdname == ".") || (sdname == "..")) {
-          continue;
-        }
+          if (limit && (entries.size() >= limit)) {
+            break;
+          }
 
-        gid_t gid = strtoull(dname1, 0, 10);
-        std::string l2 = Recycle::gRecyclingPrefix;
-        l2 += dname1;
-        // list level-2 user directories
-        listrc = dirl2.open(l2.c_str(), rootvid, (const char*) 0);
+          entries.push_back(it->first.second);
+        }
+      } else {
+        auto uit = gUserIndex.find(vid.uid);
 
-        if (listrc) {
-          eos_static_err("msg=\"unable to list the garbage directory level-2\" recycle-path=%s l2-path=%s",
-                         Recycle::gRecyclingPrefix.c_str(), l2.c_str());
-        } else {
-          const char* dname2;
+        if (uit != gUserIndex.end()) {
+          for (auto it = uit->second.begin(); it != uit->second.end(); ++it) {
+            auto eit = gExpiryIndex.find(*it);
 
-          while ((dname2 = dirl2.nextEntry())) {
-            std::string sdname = dname2;
+            if ((eit == gExpiryIndex.end()) || (eit->second.second != vid.gid)) {
+              continue;
+            }
 
-            if ((sdname == ".") || (sdname == "..")) {
+            if (skipped++ < offset) {
               continue;
             }
 
-            uid_t uid = strtoull(dname2, 0, 10);
-            printmap[gid][uid] = true;
-          }
+            if (limit && (entries.size() >= limit)) {
+              break;
+            }
 
-          dirl2.close();
+            entries.push_back(it->second);
+          }
         }
       }
-
-      dirl1.close();
     }
-  } else {
-    // add only the virtual user to the printmap
-    printmap[vid.gid][vid.uid] = true;
-  }
 
-  if (details) {
-    size_t count = 0;
-
-    for (auto itgid = printmap.begin(); itgid != printmap.end(); itgid++) {
-      for (auto ituid = itgid->second.begin(); ituid != itgid->second.end();
-           ituid++) {
-        XrdMgmOfsDirectory dirl;
-        char sdir[4096];
-        snprintf(sdir, sizeof(sdir) - 1, "%s/%u/%u/", Recycle::gRecyclingPrefix.c_str(),
-                 (unsigned int) itgid->first, (unsigned int) ituid->first);
-        int retc = dirl.open(sdir, vid, "");
-
-        if (!retc) {
-          const char* dname;
+    for (auto eit = entries.begin(); eit != entries.end(); ++eit) {
+      std::string fullpath = *eit;
+      std::string dname = fullpath.substr(fullpath.rfind('/') + 1);
+      XrdOucString originode;
+      XrdOucString origpath = dname.c_str();
 
-          while ((dname = dirl.nextEntry())) {
-            std::string sdname = dname;
-
-            if ((sdname == ".") || (sdname == "..")) {
-              continue;
-            }
-
-            std::string fullpath = sdir;
-            fullpath += dname;
-            XrdOucString originode;
-            XrdOucString origpath = dname;
-
-            // demangle the original pathname
-            while (origpath.replace("#:#", "/")) {
-            }
+      // demangle the original pathname
+      while (origpath.replace("#:#", "/")) {
+      }
 
-            XrdOucString type = "file";
-            struct stat buf;
-            XrdOucErrInfo error;
+      XrdOucString type = "file";
+      struct stat buf;
+      XrdOucErrInfo error;
 
-            if (!gOFS->_stat(fullpath.c_str(), &buf, error, vid, "")) {
-              if (translateids) {
-                int errc = 0;
-                uids = eos::common::Mapping::UidToUserName(buf.st_uid, errc).c_str();
+      if (!gOFS->_stat(fullpath.c_str(), &buf, error, vid, "")) {
+        if (translateids) {
+          int errc = 0;
+          uids = eos::common::Mapping::UidToUserName(buf.st_uid, errc).c_str();
 
-                if (errc) {
-                  uids = eos::common::Mapping::UidAsString(buf.st_uid).c_str();
-                }
+          if (errc) {
+            uids = eos::common::Mapping::UidAsString(buf.st_uid).c_str();
+          }
 
-                gids = eos::common::Mapping::GidToGroupName(buf.st_gid, errc).c_str();
+          gids = eos::common::Mapping::GidToGroupName(buf.st_gid, errc).c_str();
 
-                if (errc) {
-                  gids = eos::common::Mapping::GidAsString(buf.st_gid).c_str();
-                }
-              } else {
-                uids = eos::common::Mapping::UidAsString(buf.st_uid).c_str();
-                gids = eos::common::Mapping::GidAsString(buf.st_gid).c_str();
-              }
+          if (errc) {
+            gids = eos::common::Mapping::GidAsString(buf.st_gid).c_str();
+          }
+        } else {
+          uids = eos::common::Mapping::UidAsString(buf.st_uid).c_str();
+          gids = eos::common::Mapping::GidAsString(buf.st_gid).c_str();
+        }
 
-              if (origpath.endswith(Recycle::gRecyclingPostFix.c_str())) {
-                type = "recursive-dir";
-                origpath.erase(origpath.length() - Recycle::gRecyclingPostFix.length());
-              }
+        if (origpath.endswith(Recycle::gRecyclingPostFix.c_str())) {
+          type = "recursive-dir";
+          origpath.erase(origpath.length() - Recycle::gRecyclingPostFix.length());
+        }
 
-              originode = origpath;
-              originode.erase(0, origpath.length() - 16);
-              origpath.erase(origpath.length() - 17);
-
-              if (monitoring) {
-                XrdOucString sizestring;
-                stdOut += "recycle=ls ";
-                stdOut += " recycle-bin=";
-                stdOut += Recycle::gRecyclingPrefix.c_str();
-                stdOut += " uid=";
-                stdOut += uids.c_str();
-                stdOut += " gid=";
-                stdOut += gids.c_str();
-                stdOut += " size=";
-                stdOut += eos::common::StringConversion::GetSizeString(sizestring,
-                          (unsigned long long) buf.st_size);
-                stdOut += " deletion-time=";
-                char deltime[256];
-                snprintf(deltime, sizeof(deltime) - 1, "%llu",
-                         (unsigned long long) buf.st_ctime);
-                stdOut += deltime;
-                stdOut += " type=";
-                stdOut += type.c_str();
-                stdOut += " keylength.restore-path=";
-                stdOut += (int) origpath.length();
-                stdOut += " restore-path=";
-                stdOut += origpath.c_str();
-                stdOut += " restore-key=";
-                stdOut += originode.c_str();
-                stdOut += "\n";
-              } else {
-                char sline[4096];
-                XrdOucString sizestring;
-
-                if (count == 0) {
-                  // print a header
-                  snprintf(sline, sizeof(sline) - 1,
-                           "# %-24s %-8s %-8s %-12s %-13s %-16s %-64s\n", "Deletion Time", "UID", "GID",
-                           "SIZE", "TYPE", "RESTORE-KEY", "RESTORE-PATH");
-                  stdOut += sline;
-                  stdOut += "# ==============================================================================================================================\n";
-                }
+        originode = origpath;
+        originode.erase(0, origpath.length() - 16);
+        origpath.erase(origpath.length() - 17);
+
+        if (monitoring) {
+          XrdOucString sizestring;
+          stdOut += "recycle=ls ";
+          stdOut += " recycle-bin=";
+          stdOut += Recycle::gRecyclingPrefix.c_str();
+          stdOut += " uid=";
+          stdOut += uids.c_str();
+          stdOut += " gid=";
+          stdOut += gids.c_str();
+          stdOut += " size=";
+          stdOut += eos::common::StringConversion::GetSizeString(sizestring,
+                    (unsigned long long) buf.st_size);
+          stdOut += " deletion-time=";
+          char deltime[256];
+          snprintf(deltime, sizeof(deltime) - 1, "%llu",
+                   (unsigned long long) buf.st_ctime);
+          stdOut += deltime;
+          stdOut += " type=";
+          stdOut += type.c_str();
+          stdOut += " keylength.restore-path=";
+          stdOut += (int) origpath.length();
+          stdOut += " restore-path=";
+          stdOut += origpath.c_str();
+          stdOut += " restore-key=";
+          stdOut += originode.c_str();
+          stdOut += "\n";
+        } else {
+          char sline[4096];
+          XrdOucString sizestring;
+
+          if (count == 0) {
+            // print a header
+            snprintf(sline, sizeof(sline) - 1,
+                     "# %-24s %-8s %-8s %-12s %-13s %-16s %-64s\n", "Deletion Time", "UID", "GID",
+                     "SIZE", "TYPE", "RESTORE-KEY", "RESTORE-PATH");
+            stdOut += sline;
+            stdOut += "# ==============================================================================================================================\n";
+          }
 
-                char tdeltime[4096];
-                std::string deltime = ctime_r(&buf.st_ctime, tdeltime);
-                deltime.erase(deltime.length() - 1);
-                snprintf(sline, sizeof(sline) - 1, "%-26s %-8s %-8s %-12s %-13s %-16s %-64s",
-                         deltime.c_str(), uids.c_str(), gids.c_str(),
-                         eos::common::StringConversion::GetSizeString(sizestring,
-                             (unsigned long long) buf.st_size), type.c_str(), originode.c_str(),
-                         origpath.c_str());
-
-                if (stdOut.length() > 1 * 1024 * 1024 * 1024) {
-                  stdOut += "... (truncated after 1G of output)\n";
-                  retc = E2BIG;
-                  stdErr += "warning: list too long - truncated after 1GB of output!\n";
-                  return;
-                }
+          char tdeltime[4096];
+          std::string deltime = ctime_r(&buf.st_ctime, tdeltime);
+          deltime.erase(deltime.length() - 1);
+          snprintf(sline, sizeof(sline) - 1, "%-26s %-8s %-8s %-12s %-13s %-16s %-64s",
+                   deltime.c_str(), uids.c_str(), gids.c_str(),
+                   eos::common::StringConversion::GetSizeString(sizestring,
+                       (unsigned long long) buf.st_size), type.c_str(), originode.c_str(),
+                   origpath.c_str());
+
+          if (stdOut.length() > 1 * 1024 * 1024 * 1024) {
+            stdOut += "... (truncated after 1G of output)\n";
+            stdErr += "warning: list too long - truncated after 1GB of output!\n";
+            return;
+          }
 
-                stdOut += sline;
-                stdOut += "\n";
-              }
+          stdOut += sline;
+          stdOut += "\n";
+        }
 
-              count++;
+        count++;
 
-              if ((vid.uid) && (!vid.sudoer) && (count > 100000)) {
-                stdOut += "... (truncated)\n";
-                retc = E2BIG;
-                stdErr += "warning: list too long - truncated after 100000 entries!\n";
-                return;
-              }
-            }
-          }
+        if ((vid.uid) && (!vid.sudoer) && (count > 100000)) {
+          stdOut += "... (truncated)\n";
+          stdErr += "warning: list too long - truncated after 100000 entries!\n";
+          return;
         }
       }
     }
@@ -940,6 +1054,7 @@ Recycle::Restore(XrdOucString& stdOut, XrdOucString& stdErr,
     stdErr += "\n";
     return EIO;
   } else {
+    IndexRemove(cPath.GetPath());
     stdOut += "success: restored path=";
     stdOut += oPath.GetPath();
     stdOut += "\n";
@@ -1030,6 +1145,8 @@ Recycle::Purge(XrdOucString& stdOut, XrdOucString& stdErr,
       Cmd.close();
 
       if (!result) {
+        IndexRemove(pathname);
+
         if (S_ISDIR(buf.st_mode)) {
           nbulk_deleted++;
         } else {
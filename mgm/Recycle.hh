@@ -28,6 +28,10 @@
 #include "XrdOuc/XrdOucString.hh"
 #include "XrdOuc/XrdOucEnv.hh"
 #include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdSys/XrdSysPthread.hh"
+#include <map>
+#include <set>
+#include <string>
 #include <sys/types.h>
 
 EOSMGMNAMESPACE_BEGIN
@@ -48,6 +52,11 @@ EOSMGMNAMESPACE_BEGIN
  * <constracted-path>.<08x:inode>
  * The constrcated path is the full path of the file where all '/' are replaced
  * with a '#:#'
+ *
+ * The entries of the recycling bin are kept in an in-memory expiry index
+ * ordered by deletion time, globally and per owner. The index is built by
+ * listing the bin once and then maintained by ToGarbage, Restore, Purge and
+ * the clean-up thread, which pops the expired entries from its head.
  */
 
 class Recycle
@@ -65,6 +74,27 @@ private:
   bool mWakeUp;
   XrdSysMutex mWakeUpMutex;
 
+  //! Key of the expiry index: deletion time and path in the recycle bin
+  typedef std::pair<time_t, std::string> IndexKey;
+
+  static XrdSysMutex gIndexMutex; //< protecting the index members below
+  //! all entries ordered by deletion time with their owner uid/gid
+  static std::map<IndexKey, std::pair<uid_t, gid_t> > gExpiryIndex;
+  //! entries per owner uid ordered by deletion time
+  static std::map<uid_t, std::set<IndexKey> > gUserIndex;
+  //! deletion time of the entries by path
+  static std::map<std::string, time_t> gPathIndex;
+  static bool gIndexReady; //< index built and maintained
+  static unsigned long long gIndexGeneration; //< bumped by InvalidateIndex
+  static XrdSysMutex gIndexBuildMutex; //< serializing the builds
+
+  /**
+   * get the oldest entry of the expiry index
+   * @param key filled with the deletion time and path of the entry
+   * @return false if the index is empty
+   */
+  static bool IndexOldest(IndexKey& key);
+
 public:
   //----------------------------------------------------------------------------
   //! Default Constructor - use it to run the Recycle thread by callign Start
@@ -141,10 +171,15 @@ public:
    * @param vid of the client
    * @param monitoring selects monitoring key-value output format
    * @param translateids selects to display uid/gid as number or string
+   * @param details list the entries instead of printing the bin status
+   * @param offset number of entries to skip, ordered by deletion time
+   * @param limit maximum number of entries to list, 0 for no limit
    */
   static void Print(XrdOucString& stdOut, XrdOucString& stdErr,
                     eos::common::Mapping::VirtualIdentity_t& vid, bool monitoring,
-                    bool transalteids, bool details);
+                    bool transalteids, bool details,
+                    unsigned long long offset = 0,
+                    unsigned long long limit = 0);
 
   /**
    * undo a deletion
@@ -183,6 +218,33 @@ public:
                     XrdOucString& options);
 
 
+  /**
+   * build the expiry index by listing the recycle bin, if it is not built
+   * @return true if the index is ready
+   */
+  static bool BuildIndex();
+
+  /**
+   * add an entry to the expiry index
+   * @param path of the entry in the recycle bin
+   * @param deletiontime of the entry
+   * @param uid of the owner directory of the entry
+   * @param gid of the group directory of the entry
+   */
+  static void IndexAdd(const std::string& path, time_t deletiontime, uid_t uid,
+                       gid_t gid);
+
+  /**
+   * remove an entry which left the recycle bin from the expiry index
+   * @param path of the entry in the recycle bin
+   */
+  static void IndexRemove(const std::string& path);
+
+  /**
+   * drop the expiry index, it is rebuilt by the next user
+   */
+  static void InvalidateIndex();
+
   /**
    * set the wake-up flag in the recycle thread to look at modified recycle bin settings
    */
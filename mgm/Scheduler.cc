@@ -43,19 +43,13 @@ Scheduler::~Scheduler() { }
 //! the write placement routine
 //! -------------------------------------------------------------
 
-// the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
-int
-Scheduler::FilePlacement(PlacementArguments* args)
+//------------------------------------------------------------------------------
+// Get the number of collocated filesystems for the placement policy
+//------------------------------------------------------------------------------
+unsigned int
+Scheduler::GetCollocatedFs(const PlacementArguments* args,
+                           unsigned int nfilesystems)
 {
-  eos_static_debug("requesting file placement from geolocation %s",
-                   args->vid->geolocation.c_str());
-  // the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
-  std::map<eos::common::FileSystem::fsid_t, float> availablefs;
-  std::map<eos::common::FileSystem::fsid_t, std::string> availablefsgeolocation;
-  std::list<eos::common::FileSystem::fsid_t> availablevector;
-  // fill the avoid list from the selected_filesystems input vector
-  unsigned int nfilesystems = eos::common::LayoutId::GetStripeNumber(
-                                args->lid) + 1;
   unsigned int ncollocatedfs = 0;
 
   switch (args->plctpolicy) {
@@ -89,94 +83,154 @@ Scheduler::FilePlacement(PlacementArguments* args)
   eos_static_debug("checking placement policy : policy is %d, nfilesystems is"
                    " %d and ncollocated is %d", (int)args->plctpolicy, (int)nfilesystems,
                    (int)ncollocatedfs);
-  uid_t uid = args->vid->uid;
-  gid_t gid = args->vid->gid;
+  return ncollocatedfs;
+}
+
+//------------------------------------------------------------------------------
+// Get the tag identifying the scheduling group rotation of the placement
+//------------------------------------------------------------------------------
+std::string
+Scheduler::GetIndexTag(const PlacementArguments* args)
+{
   XrdOucString lindextag = "";
 
   if (args->grouptag) {
     lindextag = args->grouptag;
   } else {
-    lindextag += (int) uid;
+    lindextag += (int) args->vid->uid;
     lindextag += ":";
-    lindextag += (int) gid;
+    lindextag += (int) args->vid->gid;
   }
 
-  std::string indextag = lindextag.c_str();
-  std::set<FsGroup*>::const_iterator git;
-  std::vector<std::string> fsidsgeotags;
-  std::vector<FsGroup*> groupsToTry;
+  return lindextag.c_str();
+}
 
-  // place the group iterator
+//------------------------------------------------------------------------------
+// Get the scheduling group where to start the placement
+//------------------------------------------------------------------------------
+bool
+Scheduler::GetStartGroup(const PlacementArguments* args,
+                         const std::string& indextag,
+                         std::set<FsGroup*>::const_iterator& git)
+{
+  std::set<FsGroup*>& groups = FsView::gFsView.mSpaceGroupView[*args->spacename];
 
-  if (!args->alreadyused_filesystems->empty()) {
-    if (!gGeoTreeEngine.getInfosFromFsIds(*args->alreadyused_filesystems,
-                                          &fsidsgeotags,
-                                          0, &groupsToTry)) {
-      eos_static_debug("could not retrieve scheduling group for all avoid fsids");
-    }
+  if (groups.empty()) {
+    return false;
   }
 
   if (args->forced_scheduling_group_index >= 0) {
-    for (git = FsView::gFsView.mSpaceGroupView[*args->spacename].begin();
-         git != FsView::gFsView.mSpaceGroupView[*args->spacename].end(); ++git) {
+    for (git = groups.begin(); git != groups.end(); ++git) {
       if ((*git)->GetIndex() == (unsigned int) args->forced_scheduling_group_index) {
         break;
       }
     }
 
-    if ((git != FsView::gFsView.mSpaceGroupView[*args->spacename].end()) &&
-        ((*git)->GetIndex() != (unsigned int) args->forced_scheduling_group_index)) {
-      args->selected_filesystems->clear();
-      return ENOSPC;
-    }
-    
-    if (git == FsView::gFsView.mSpaceGroupView[*args->spacename].end()) {
-      args->selected_filesystems->clear();
-      return ENOSPC;
-    }
+    return (git != groups.end());
+  }
+
+  XrdSysMutexHelper scope_lock(pMapMutex);
+
+  if (schedulingGroup.count(indextag)) {
+    git = groups.find(schedulingGroup[indextag]);
+    schedulingGroup[indextag] = *git;
   } else {
-    XrdSysMutexHelper scope_lock(pMapMutex);
+    git = groups.begin();
+    schedulingGroup[indextag] = *git;
+  }
 
-    if (schedulingGroup.count(indextag)) {
-      git = FsView::gFsView.mSpaceGroupView[*args->spacename].find(
-              schedulingGroup[indextag]);
-      schedulingGroup[indextag] = *git;
-    } else {
-      git = FsView::gFsView.mSpaceGroupView[*args->spacename].begin();
-      schedulingGroup[indextag] = *git;
-    }
+  git++;
+
+  if (git == groups.end()) {
+    git = groups.begin();
+  }
 
-    git++;
+  return true;
+}
 
-    if (git ==  FsView::gFsView.mSpaceGroupView[*args->spacename].end()) {
-      git = FsView::gFsView.mSpaceGroupView[*args->spacename].begin();
+//------------------------------------------------------------------------------
+// Resolve the placement state shared by the files of a placement call
+//------------------------------------------------------------------------------
+void
+Scheduler::GetPlacementContext(const PlacementArguments* args,
+                               PlacementContext& ctx)
+{
+  // fill the avoid list from the alreadyused_filesystems input vector
+  ctx.nfilesystems = eos::common::LayoutId::GetStripeNumber(args->lid) + 1;
+  ctx.ncollocatedfs = GetCollocatedFs(args, ctx.nfilesystems);
+  ctx.indextag = GetIndexTag(args);
+  ctx.fsidsgeotags.clear();
+  ctx.groupsToTry.clear();
+
+  if (args->alreadyused_filesystems &&
+      !args->alreadyused_filesystems->empty()) {
+    if (!gGeoTreeEngine.getInfosFromFsIds(*args->alreadyused_filesystems,
+                                          &ctx.fsidsgeotags,
+                                          0, &ctx.groupsToTry)) {
+      eos_static_debug("could not retrieve scheduling group for all avoid fsids");
     }
   }
+}
+
+//------------------------------------------------------------------------------
+// Get the group placer using the GeoTreeEngine
+//------------------------------------------------------------------------------
+Scheduler::GroupPlacer
+Scheduler::GetGeoTreePlacer(const PlacementArguments* args,
+                            const PlacementContext& ctx)
+{
+  return [args, &ctx](FsGroup * group, ino64_t inode,
+                      std::vector<unsigned int>* selected,
+                      std::vector<std::string>* dataproxys,
+                      std::vector<std::string>* firewallentpts) {
+    return gGeoTreeEngine.placeNewReplicasOneGroup(
+             group, ctx.nfilesystems,
+             selected,
+             inode,
+             dataproxys,
+             firewallentpts,
+             GeoTreeEngine::regularRW,
+             // file systems to avoid are assumed to already host a replica
+             args->alreadyused_filesystems,
+             const_cast<std::vector<std::string>*>(&ctx.fsidsgeotags),
+             args->bookingsize,
+             args->plctTrgGeotag ? *args->plctTrgGeotag : "",
+             args->vid->geolocation,
+             ctx.ncollocatedfs,
+             NULL,
+             NULL,
+             NULL);
+  };
+}
+
+//------------------------------------------------------------------------------
+// Place one file in the first group which can take it
+//------------------------------------------------------------------------------
+int
+Scheduler::PlaceFile(const PlacementArguments* args,
+                     const PlacementContext& ctx,
+                     const GroupPlacer& placer,
+                     ino64_t inode,
+                     std::vector<unsigned int>* selected,
+                     std::vector<std::string>* dataproxys,
+                     std::vector<std::string>* firewallentpts)
+{
+  std::set<FsGroup*>& groups = FsView::gFsView.mSpaceGroupView[*args->spacename];
+  std::set<FsGroup*>::const_iterator git;
+
+  // place the group iterator
+  if (!GetStartGroup(args, ctx.indextag, git)) {
+    selected->clear();
+    return ENOSPC;
+  }
 
   // Rotate scheduling view ptr, remove it from the selection map
   for (unsigned int groupindex = 0;
-       groupindex < FsView::gFsView.mSpaceGroupView[*args->spacename].size() +
-       groupsToTry.size(); groupindex++) {
+       groupindex < groups.size() + ctx.groupsToTry.size(); groupindex++) {
     // Rotate scheduling view ptr -  we select a random one
-    FsGroup* group = (groupindex < groupsToTry.size() ? groupsToTry[groupindex] :
-                      *git);
-    bool placeRes = gGeoTreeEngine.placeNewReplicasOneGroup(
-                      group, nfilesystems,
-                      args->selected_filesystems,
-                      args->inode,
-                      args->dataproxys,
-                      args->firewallentpts,
-                      GeoTreeEngine::regularRW,
-                      // file systems to avoid are assumed to already host a replica
-                      args->alreadyused_filesystems,
-                      &fsidsgeotags,
-                      args->bookingsize,
-                      args->plctTrgGeotag ? *args->plctTrgGeotag : "",
-                      args->vid->geolocation,
-                      ncollocatedfs,
-                      NULL,
-                      NULL,
-                      NULL);
+    FsGroup* group = (groupindex < ctx.groupsToTry.size() ?
+                      ctx.groupsToTry[groupindex] : *git);
+    bool placeRes = placer(group, inode, selected, dataproxys, firewallentpts);
 
     if (eos::common::Logging::gLogMask & LOG_MASK(LOG_DEBUG)) {
       char buffer[1024];
@@ -184,8 +238,7 @@ Scheduler::FilePlacement(PlacementArguments* args)
       char* buf = buffer;
 
       // only when we need one more geo location, we lower the selection probability
-      for (auto it = args->selected_filesystems->begin();
-           it != args->selected_filesystems->end(); ++it) {
+      for (auto it = selected->begin(); it != selected->end(); ++it) {
         buf += sprintf(buf, "%lu  ", (unsigned long)(*it));
       }
 
@@ -201,15 +254,14 @@ Scheduler::FilePlacement(PlacementArguments* args)
                        "checking next group", args->path, group->mName.c_str());
     }
 
-    if (groupindex >= groupsToTry.size()) {
-      if ((git == FsView::gFsView.mSpaceGroupView[*args->spacename].end()) ||
-          (++git == FsView::gFsView.mSpaceGroupView[*args->spacename].end())) {
-        git = FsView::gFsView.mSpaceGroupView[*args->spacename].begin();
+    if (groupindex >= ctx.groupsToTry.size()) {
+      if ((git == groups.end()) || (++git == groups.end())) {
+        git = groups.begin();
       }
 
       // remember the last group for that indextag
       pMapMutex.Lock();
-      schedulingGroup[indextag] = *git;
+      schedulingGroup[ctx.indextag] = *git;
       pMapMutex.UnLock();
     }
 
@@ -221,10 +273,78 @@ Scheduler::FilePlacement(PlacementArguments* args)
   }
 
   // Check if we are in any kind of no-update mode
-  args->selected_filesystems->clear();
+  selected->clear();
   return ENOSPC;
 }
 
+//------------------------------------------------------------------------------
+// Place several files one after the other
+//------------------------------------------------------------------------------
+int
+Scheduler::PlaceBatch(const PlacementArguments* args,
+                      const PlacementContext& ctx,
+                      const GroupPlacer& placer,
+                      const std::vector<ino64_t>& inodes,
+                      std::vector<std::vector<unsigned int>>& placements,
+                      std::vector<std::vector<std::string>>* dataproxys,
+                      std::vector<std::vector<std::string>>* firewallentpts)
+{
+  int retc = 0;
+  placements.assign(inodes.size(), std::vector<unsigned int>());
+
+  if (dataproxys) {
+    dataproxys->assign(inodes.size(), std::vector<std::string>());
+  }
+
+  if (firewallentpts) {
+    firewallentpts->assign(inodes.size(), std::vector<std::string>());
+  }
+
+  for (size_t i = 0; i < inodes.size(); ++i) {
+    // a file which does not fit does not stop the rotation for the next ones,
+    // as for consecutive calls to FilePlacement
+    if (PlaceFile(args, ctx, placer, inodes[i], &placements[i],
+                  dataproxys ? &(*dataproxys)[i] : 0,
+                  firewallentpts ? &(*firewallentpts)[i] : 0)) {
+      retc = ENOSPC;
+    }
+  }
+
+  return retc;
+}
+
+// the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
+int
+Scheduler::FilePlacement(PlacementArguments* args)
+{
+  eos_static_debug("requesting file placement from geolocation %s",
+                   args->vid->geolocation.c_str());
+  PlacementContext ctx;
+  GetPlacementContext(args, ctx);
+  return PlaceFile(args, ctx, GetGeoTreePlacer(args, ctx), args->inode,
+                   args->selected_filesystems, args->dataproxys,
+                   args->firewallentpts);
+}
+
+//------------------------------------------------------------------------------
+// Place several files of the same layout in one call
+//------------------------------------------------------------------------------
+int
+Scheduler::FilePlacementBatch(PlacementArguments* args,
+                              const std::vector<ino64_t>& inodes,
+                              std::vector<std::vector<unsigned int>>& placements,
+                              std::vector<std::vector<std::string>>* dataproxys,
+                              std::vector<std::vector<std::string>>* firewallentpts)
+{
+  // the caller routine has to lock via => eos::common::RWMutexReadLock(FsView::gFsView.ViewMutex)
+  eos_static_debug("requesting placement of %lu files from geolocation %s",
+                   inodes.size(), args->vid->geolocation.c_str());
+  PlacementContext ctx;
+  GetPlacementContext(args, ctx);
+  return PlaceBatch(args, ctx, GetGeoTreePlacer(args, ctx), inodes, placements,
+                    dataproxys, firewallentpts);
+}
+
 // we are off the wire
 // the weight is given mainly by the disk performance and the network load has a weaker impact (sqrt)
 // drain patch
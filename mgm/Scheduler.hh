@@ -31,6 +31,7 @@
 #include "mgm/Namespace.hh"
 #include "mgm/FsView.hh"
 /*----------------------------------------------------------------------------*/
+#include <functional>
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
@@ -73,6 +74,8 @@ public:
     unsigned long lid;
     //! file inode
     ino64_t inode;
+    //! id of the container of the file, enables the quota fast path if set
+    unsigned long long cid;
     //! indicates if placement should be local/spread/hybrid
     tPlctPolicy plctpolicy;
     //! indicates close to which Geotag collocated stripes should be placed
@@ -103,6 +106,7 @@ public:
       grouptag(0),
       lid(0),
       inode(0),
+      cid(0),
       plctpolicy(kScattered),
       plctTrgGeotag(),
       truncate(false),
@@ -140,6 +144,32 @@ public:
   //----------------------------------------------------------------------------
   static int FilePlacement(PlacementArguments* args);
 
+  //----------------------------------------------------------------------------
+  //! Place several files of the same layout in one call. The placement
+  //! policy and the avoided filesystems are resolved once for the whole
+  //! batch, the scheduling groups are rotated per file exactly like
+  //! consecutive calls to FilePlacement would do.
+  //!
+  //! @param args arguments shared by all the files, the inode,
+  //!        selected_filesystems, dataproxys and firewallentpts members are
+  //!        not used
+  //! @param inodes inodes of the files to place
+  //! @param placements filesystems selected for each file, the entries of the
+  //!        files that could not be placed are empty
+  //! @param dataproxys if non NULL, dataproxys scheduled for each file
+  //! @param firewallentpts if non NULL, firewall entry points scheduled for
+  //!        each file
+  //!
+  //! @return 0 if all the files were placed, otherwise ENOSPC
+  //!
+  //! NOTE: Has to be called with a lock on the FsView::gFsView::ViewMutex
+  //----------------------------------------------------------------------------
+  static int FilePlacementBatch(PlacementArguments* args,
+                                const std::vector<ino64_t>& inodes,
+                                std::vector<std::vector<unsigned int>>& placements,
+                                std::vector<std::vector<std::string>>* dataproxys = 0,
+                                std::vector<std::vector<std::string>>* firewallentpts = 0);
+
   struct AccessArguments {
     /// INPUT
     //! forced filesystem for access
@@ -219,6 +249,84 @@ public:
   static int FileAccess(AccessArguments* args);
 
 protected:
+  //! Placement state shared by all the files of one placement call
+  struct PlacementContext {
+    //! number of filesystems to place per file
+    unsigned int nfilesystems;
+    //! number of collocated filesystems for the placement policy
+    unsigned int ncollocatedfs;
+    //! tag of the scheduling group rotation
+    std::string indextag;
+    //! geotags of the filesystems to avoid
+    std::vector<std::string> fsidsgeotags;
+    //! groups of the filesystems to avoid, tried first
+    std::vector<FsGroup*> groupsToTry;
+  };
+
+  //! Place the replicas of one file in one group:
+  //! (group, inode, selected filesystems, dataproxys, firewall entry points)
+  typedef std::function<bool(FsGroup*, ino64_t, std::vector<unsigned int>*,
+                             std::vector<std::string>*,
+                             std::vector<std::string>*)> GroupPlacer;
+
+  //----------------------------------------------------------------------------
+  //! Resolve the placement state shared by the files of a placement call
+  //----------------------------------------------------------------------------
+  static void GetPlacementContext(const PlacementArguments* args,
+                                  PlacementContext& ctx);
+
+  //----------------------------------------------------------------------------
+  //! Get the group placer using the GeoTreeEngine
+  //----------------------------------------------------------------------------
+  static GroupPlacer GetGeoTreePlacer(const PlacementArguments* args,
+                                      const PlacementContext& ctx);
+
+  //----------------------------------------------------------------------------
+  //! Place one file, trying the groups of the avoided filesystems first and
+  //! then the groups of the space starting from the rotation of the index tag
+  //!
+  //! @return 0 if placed, otherwise ENOSPC
+  //----------------------------------------------------------------------------
+  static int PlaceFile(const PlacementArguments* args,
+                       const PlacementContext& ctx,
+                       const GroupPlacer& placer,
+                       ino64_t inode,
+                       std::vector<unsigned int>* selected,
+                       std::vector<std::string>* dataproxys,
+                       std::vector<std::string>* firewallentpts);
+
+  //----------------------------------------------------------------------------
+  //! Place several files with PlaceFile, see FilePlacementBatch
+  //----------------------------------------------------------------------------
+  static int PlaceBatch(const PlacementArguments* args,
+                        const PlacementContext& ctx,
+                        const GroupPlacer& placer,
+                        const std::vector<ino64_t>& inodes,
+                        std::vector<std::vector<unsigned int>>& placements,
+                        std::vector<std::vector<std::string>>* dataproxys,
+                        std::vector<std::vector<std::string>>* firewallentpts);
+
+  //----------------------------------------------------------------------------
+  //! Get the number of collocated filesystems for the placement policy
+  //----------------------------------------------------------------------------
+  static unsigned int GetCollocatedFs(const PlacementArguments* args,
+                                      unsigned int nfilesystems);
+
+  //----------------------------------------------------------------------------
+  //! Get the tag identifying the scheduling group rotation i.e. the group tag
+  //! or <uid>:<gid>
+  //----------------------------------------------------------------------------
+  static std::string GetIndexTag(const PlacementArguments* args);
+
+  //----------------------------------------------------------------------------
+  //! Get the scheduling group where to start the placement and advance the
+  //! rotation for the index tag
+  //!
+  //! @return false if there is no group to place in
+  //----------------------------------------------------------------------------
+  static bool GetStartGroup(const PlacementArguments* args,
+                            const std::string& indextag,
+                            std::set<FsGroup*>::const_iterator& git);
 
   static XrdSysMutex pMapMutex; //< protect the following scheduling state maps
 
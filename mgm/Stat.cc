@@ -23,6 +23,7 @@
 
 #include "common/Mapping.hh"
 #include "mgm/Stat.hh"
+#include "mgm/Access.hh"
 #include "mgm/FsView.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mq/XrdMqSharedObject.hh"
@@ -41,6 +42,7 @@ Stat::Add(const char* tag, uid_t uid, gid_t gid, unsigned long val)
   StatAvgUid[tag][uid].Add(val);
   StatAvgGid[tag][gid].Add(val);
   Mutex.UnLock();
+  Access::gRateLimiter.Record(tag, uid, gid, val);
 }
 
 /*----------------------------------------------------------------------------*/
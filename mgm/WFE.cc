@@ -56,6 +56,7 @@ WFE::WFE()
   mThread = 0;
   mMs = 0;
   mActiveJobs = 0;
+  mExport = false;
   eos::common::Mapping::Root(mRootVid);
   XrdSysMutexHelper sLock(gSchedulerMutex);
   gScheduler = new XrdScheduler(&gMgmOfsEroute, &gMgmOfsTrace, 2, 128, 64);
@@ -114,8 +115,10 @@ WFE::WFEr()
 /**
  * @brief WFE method doing the actual workflow
  *
- * This thread method loops in regular intervals over all workflow jobs in the
- * workflow directory /eos/<instance>/proc/workflow/
+ * This thread method hands the jobs of the journaled queue to the scheduler
+ * as soon as they are due. It is woken up by new and finished jobs. The
+ * workflow directory /eos/<instance>/proc/workflow/ is only written if
+ * wfe.export is on, and is cleaned up here.
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -140,26 +143,41 @@ WFE::WFEr()
 
   XrdSysTimer sleeper;
   sleeper.Snooze(10);
+  // ---------------------------------------------------------------------------
+  // recover the jobs from the journal, the first time take over the jobs
+  // queued in the workflow proc directory
+  // ---------------------------------------------------------------------------
+  XrdSysThread::SetCancelOff();
+  std::string journal = gOFS->MgmMetaLogDir.c_str();
+  journal += "/wfe.";
+  journal += gOFS->HostName;
+  journal += ".journal";
+  {
+    struct stat buf;
+    bool exists = !::stat(journal.c_str(), &buf);
+
+    if (!mQueue.Open(journal)) {
+      eos_static_err("msg=\"workflow journal not available, jobs are only kept "
+                     "in memory\" path=\"%s\"", journal.c_str());
+    }
+
+    if (!exists) {
+      Import();
+    }
+  }
+  XrdSysThread::SetCancelOn();
   //----------------------------------------------------------------------------
-  // Eternal thread doing WFE scans
+  // Eternal thread dispatching the workflow jobs when they are due
   //----------------------------------------------------------------------------
-  time_t snoozetime = 10;
   size_t lWFEntx = 0;
+  size_t lWFEWorkflowNtx = 0;
   time_t cleanuptime = 0;
   eos_static_info("msg=\"async WFE thread started\"");
 
   while (1) {
-    // -------------------------------------------------------------------------
-    // every now and then we wake up
-    // -------------------------------------------------------------------------
     XrdSysThread::SetCancelOff();
     bool IsEnabledWFE;
-    time_t lWFEInterval;
-    time_t lStartTime = time(NULL);
-    time_t lStopTime;
     time_t lKeepTime = 7 * 86400;
-    std::map<std::string, std::set<std::string> > wfedirs;
-    XrdOucString stdErr;
     {
       eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
 
@@ -171,164 +189,49 @@ WFE::WFEr()
       }
 
       if (FsView::gFsView.mSpaceView.count("default")) {
-        lWFEInterval =
-          atoi(FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe.interval").c_str());
         lWFEntx =
           atoi(FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe.ntx").c_str());
+        lWFEWorkflowNtx =
+          atoi(FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe.workflow.ntx").c_str());
         lKeepTime = atoi(
                       FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe.keepTIME").c_str());
+        mExport = (FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe.export")
+                   == "on");
 
         if (!lKeepTime) {
           lKeepTime = 7 * 86400;
         }
       } else {
-        lWFEInterval = 0;
         lWFEntx = 0;
+        lWFEWorkflowNtx = 0;
       }
     }
 
     // only a master needs to run WFE
     if (gOFS->MgmMaster.IsMaster() && IsEnabledWFE) {
-      // -------------------------------------------------------------------------
-      // do a find
-      // -------------------------------------------------------------------------
-      eos_static_info("msg=\"start WFE scan\"");
-      // -------------------------------------------------------------------------
-      // find all directories defining an WFE policy
-      // -------------------------------------------------------------------------
-      gOFS->MgmStats.Add("WFEFind", 0, 0, 1);
-      EXEC_TIMING_BEGIN("WFEFind");
-      // prepare four queries today, yestereday for queued and error jobs
-      std::string queries[4];
-
-      for (size_t i = 0; i < 4; ++i) {
-        queries[i] = gOFS->MgmProcWorkflowPath.c_str();
-        queries[i] += "/";
-      }
-
-      {
-        // today
-        time_t when = time(NULL);
-        std::string day = eos::common::Timing::UnixTimstamp_to_Day(when);
-        queries[0] += day;
-        queries[0] += "/q/";
-        queries[1] += day;
-        queries[1] += "/e/";
-        //yesterday
-        when -= (24 * 3600);
-        day = eos::common::Timing::UnixTimstamp_to_Day(when);
-        queries[2] += day;
-        queries[2] += "/q/";
-        queries[3] += day;
-        queries[3] += "/e/";
-      }
-
-      for (size_t i = 0; i < 4; ++i) {
-        eos_static_info("query-path=%s", queries[i].c_str());
-        gOFS->_find(queries[i].c_str(),
-                    mError,
-                    stdErr,
-                    mRootVid,
-                    wfedirs,
-                    0,
-                    0,
-                    false,
-                    0,
-                    false,
-                    0
-                   );
-      }
-
-      {
-        eos_static_info("msg=\"finished WFE find\" WFE-dirs=%llu %s",
-                        wfedirs.size(), stdErr.c_str()
-                       );
-        time_t now = time(NULL);
-
-        for (auto it = wfedirs.begin(); it != wfedirs.end(); it++) {
-          // -------------------------------------------------------------------
-          // get workflows
-          // -------------------------------------------------------------------
-          if (it->second.size()) {
-            for (auto wit = it->second.begin(); wit != it->second.end(); ++wit) {
-              eos_static_info("wfe-dir=\"%s\" wfe-job=\"%s\"", it->first.c_str(),
-                              wit->c_str());
-              std::string f = it->first;
-              f += *wit;
-              Job* job = new Job();
-
-              if (!job || job->Load(f)) {
-                eos_static_err("msg=\"cannot load workflow entry\" value=\"%s\"", f.c_str());
-
-                if (job) {
-                  delete job;
-                }
-              } else {
-                // don't schedule jobs for the future
-                if ((!job->mActions.size()) || (now < job->mActions[0].mTime)) {
-                  delete job;
-                  continue;
-                }
-
-                // stop scheduling if there are too many jobs running
-                if ((lWFEntx - GetActiveJobs()) <= 0) {
-                  if (lWFEntx > 0) {
-                    mDoneSignal.Wait(10);
-
-                    if ((lWFEntx - GetActiveJobs()) <= 0) {
-                      break;
-                    }
-                  }
-                }
-
-                // use the shared scheduler
-                XrdSysMutexHelper sLock(gSchedulerMutex);
-                gScheduler->Schedule((XrdJob*) job);
-                IncActiveJobs();
-                eos_static_info("msg=\"scheduled workflow\" job=\"%s\"",
-                                job->mDescription.c_str());
-              }
-            }
-          }
-        }
+      time_t now = time(NULL);
+      WFEQueue::Entry entry;
+
+      // hand out the due jobs as long as there are free slots
+      while ((!lWFEntx || (GetActiveJobs() < lWFEntx)) &&
+             mQueue.Next(now, lWFEWorkflowNtx, entry)) {
+        Job* job = new Job(entry);
+        // use the shared scheduler
+        XrdSysMutexHelper sLock(gSchedulerMutex);
+        gScheduler->Schedule((XrdJob*) job);
+        IncActiveJobs();
+        eos_static_info("msg=\"scheduled workflow\" job=\"%s\"",
+                        job->mDescription.c_str());
       }
-
-      EXEC_TIMING_END("WFEFind");
-      eos_static_info("msg=\"finished WFE application\" WFE-dirs=%llu",
-                      wfedirs.size()
-                     );
-    }
-
-    lStopTime = time(NULL);
-
-    if ((lStopTime - lStartTime) < lWFEInterval) {
-      snoozetime = lWFEInterval - (lStopTime - lStartTime);
     }
 
-    eos_static_info("snooze-time=%llu enabled=%d", snoozetime, IsEnabledWFE);
+    mQueue.Sync();
+    // wake up for new or finished jobs, at least every second for the jobs
+    // becoming due and for configuration changes
+    mQueue.Wait(1000);
     XrdSysThread::SetCancelOn();
-    XrdSysTimer sleeper;
-    time_t snoozeinterval = 1;
-    size_t snoozeloop = snoozetime / 1;
-
-    for (size_t i = 0; i < snoozeloop; i++) {
-      sleeper.Snooze(snoozeinterval);
-      {
-        // check if the setting changes
-        eos::common::RWMutexReadLock lock(FsView::gFsView.ViewMutex);
-
-        if (FsView::gFsView.mSpaceView.count("default") &&
-            (FsView::gFsView.mSpaceView["default"]->GetConfigMember("wfe") == "on")) {
-          if (!IsEnabledWFE) {
-            break;
-          }
-        } else {
-          if (IsEnabledWFE) {
-            break;
-          }
-        }
-      }
-    }
+    XrdSysThread::CancelPoint();
+    XrdSysThread::SetCancelOff();
 
     if (!cleanuptime || (cleanuptime < time(NULL))) {
       time_t now = time(NULL);
@@ -378,6 +281,82 @@ WFE::WFEr()
   return 0;
 }
 
+/*----------------------------------------------------------------------------*/
+void
+WFE::Import()
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief take over the jobs queued in the workflow proc directory
+ *
+ * Queued and failed jobs of today and yesterday are added to the journal,
+ * like the directory scans used to pick them up.
+ */
+/*----------------------------------------------------------------------------*/
+{
+  std::map<std::string, std::set<std::string> > wfedirs;
+  XrdOucString stdErr;
+  // prepare four queries today, yestereday for queued and error jobs
+  std::string queries[4];
+
+  for (size_t i = 0; i < 4; ++i) {
+    queries[i] = gOFS->MgmProcWorkflowPath.c_str();
+    queries[i] += "/";
+  }
+
+  {
+    // today
+    time_t when = time(NULL);
+    std::string day = eos::common::Timing::UnixTimstamp_to_Day(when);
+    queries[0] += day;
+    queries[0] += "/q/";
+    queries[1] += day;
+    queries[1] += "/e/";
+    //yesterday
+    when -= (24 * 3600);
+    day = eos::common::Timing::UnixTimstamp_to_Day(when);
+    queries[2] += day;
+    queries[2] += "/q/";
+    queries[3] += day;
+    queries[3] += "/e/";
+  }
+
+  for (size_t i = 0; i < 4; ++i) {
+    gOFS->_find(queries[i].c_str(), mError, stdErr, mRootVid, wfedirs,
+                0, 0, false, 0, false, 0);
+  }
+
+  size_t imported = 0;
+
+  for (auto it = wfedirs.begin(); it != wfedirs.end(); it++) {
+    for (auto wit = it->second.begin(); wit != it->second.end(); ++wit) {
+      std::string f = it->first;
+      f += *wit;
+      Job job;
+
+      if (job.Load(f) || (job.mActions.size() != 1)) {
+        eos_static_err("msg=\"cannot load workflow entry\" value=\"%s\"", f.c_str());
+        continue;
+      }
+
+      WFEQueue::Entry entry;
+      entry.mFid = job.mFid;
+      entry.mEvent = job.mActions[0].mEvent;
+      entry.mWorkflow = job.mActions[0].mWorkflow;
+      entry.mAction = job.mActions[0].mAction;
+      entry.mVid = eos::common::Mapping::VidToString(job.mVid);
+      entry.mQueue = job.mActions[0].mQueue;
+      entry.mTime = job.mActions[0].mTime;
+      entry.mWhen = job.mActions[0].mTime;
+      entry.mRetry = job.mRetry;
+      mQueue.Add(entry);
+      imported++;
+    }
+  }
+
+  eos_static_notice("msg=\"imported workflow jobs from the namespace\" jobs=%lu",
+                    (unsigned long) imported);
+}
+
 /*----------------------------------------------------------------------------*/
 int
 /*----------------------------------------------------------------------------*/
@@ -394,6 +373,32 @@ WFE::Job::Save(std::string queue, time_t when, int action, int retry)
     return -1;
   }
 
+  // the journal is the reference, the proc directory only an export
+  time_t due = when ? when : time(NULL);
+
+  if (!mId) {
+    WFEQueue::Entry entry;
+    entry.mFid = mFid;
+    entry.mEvent = mActions[action].mEvent;
+    entry.mWorkflow = mActions[action].mWorkflow;
+    entry.mAction = mActions[action].mAction;
+    entry.mVid = eos::common::Mapping::VidToString(mVid);
+    entry.mQueue = queue;
+    entry.mTime = mActions[action].mTime;
+    entry.mWhen = due;
+    entry.mRetry = retry;
+    gOFS->WFEd.GetQueue().Add(entry);
+    mId = entry.mId;
+  } else {
+    gOFS->WFEd.GetQueue().Update(mId, queue, due, retry);
+  }
+
+  mRetry = retry;
+
+  if (!gOFS->WFEd.IsExport()) {
+    return SFS_OK;
+  }
+
   std::string workflowdir = gOFS->MgmProcWorkflowPath.c_str();
   workflowdir += "/";
   workflowdir += mActions[action].mDay;
@@ -628,6 +633,11 @@ WFE::Job::Delete(std::string queue)
     return SFS_ERROR;
   }
 
+  if (!gOFS->WFEd.IsExport()) {
+    // nothing to remove, the journal recorded the move already
+    return SFS_OK;
+  }
+
   std::string workflowdir = gOFS->MgmProcWorkflowPath.c_str();
   workflowdir += "/";
   workflowdir += mActions[0].mDay;
@@ -1473,8 +1483,10 @@ WFE::Job::DoIt()
               // scan for result tags referencing the workflow path
               xstart = 0;
 
-              while ((xstart = outerr.find("<eos::wfe::vpath::fxattr:",
-                                           xstart)) != STR_NPOS) {
+              // the workflow path only exists if the jobs are exported
+              while (mWorkflowPath.length() &&
+                     ((xstart = outerr.find("<eos::wfe::vpath::fxattr:",
+                                            xstart)) != STR_NPOS)) {
                 int cnt = 0;
                 cnt++;
 
@@ -1548,6 +1560,7 @@ WFE::Job::DoIt()
     //Delete(mActions[0].mQueue);
   }
 
+  gOFS->WFEd.GetQueue().Release(mId);
   gOFS->WFEd.GetSignal()->Signal();
   gOFS->WFEd.DecActiveJobs();
 }
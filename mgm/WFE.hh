@@ -25,6 +25,7 @@
 #define __EOSMGM_WFE__HH__
 
 #include "mgm/Namespace.hh"
+#include "mgm/WFEQueue.hh"
 #include "common/Mapping.hh"
 #include "common/Timing.hh"
 #include "namespace/interface/IView.hh"
@@ -35,6 +36,7 @@
 #include "Xrd/XrdScheduler.hh"
 #include "XrdCl/XrdClCopyProcess.hh"
 #include <sys/types.h>
+#include <atomic>
 
 EOSMGMNAMESPACE_BEGIN
 
@@ -68,6 +70,16 @@ private:
   /// condition variabl to get signalled for a done job
   XrdSysCondVar mDoneSignal;
 
+  /// journaled queue of the jobs
+  WFEQueue mQueue;
+
+  /// jobs are also stored in the workflow proc directory
+  std::atomic<bool> mExport;
+
+  /* Take over the jobs stored in the workflow proc directory
+   */
+  void Import();
+
 public:
 
   /* Default Constructor - use it to run the WFE thread by calling Start
@@ -152,6 +164,7 @@ public:
     {
       mFid = 0;
       mRetry = 0;
+      mId = 0;
     }
 
     Job(eos::common::FileId::fileid_t fid,
@@ -159,9 +172,28 @@ public:
     {
       mFid = fid;
       mRetry = 0;
+      mId = 0;
       eos::common::Mapping::Copy(vid, mVid);
     }
 
+    /* Create a job from its journal entry
+     */
+    Job(const WFEQueue::Entry& entry)
+    {
+      mFid = entry.mFid;
+      mRetry = entry.mRetry;
+      mId = entry.mId;
+
+      if (!eos::common::Mapping::VidFromString(mVid, entry.mVid.c_str())) {
+        eos::common::Mapping::Nobody(mVid);
+      }
+
+      // like a job loaded from the proc directory, the action time is the
+      // time the job is due
+      AddAction(entry.mAction, entry.mEvent, entry.mWhen, entry.mWorkflow,
+                entry.mQueue);
+    }
+
     ~Job()
     {
     }
@@ -172,6 +204,7 @@ public:
       mFid = other.mFid;
       mDescription = other.mDescription;
       mRetry = other.mRetry;
+      mId = other.mId;
     }
     // ---------------------------------------------------------------------------
     // Job execution function
@@ -223,6 +256,7 @@ public:
     eos::common::Mapping::VirtualIdentity mVid;
     std::string mWorkflowPath;
     int mRetry;///! number of retries
+    uint64_t mId;///! id of the job in the journal, 0 if not journaled yet
   };
 
   XrdSysCondVar* GetSignal()
@@ -230,6 +264,22 @@ public:
     return &mDoneSignal;
   }
 
+  // ---------------------------------------------------------------------------
+  //! Return the journaled queue of the jobs
+  // ---------------------------------------------------------------------------
+  WFEQueue& GetQueue()
+  {
+    return mQueue;
+  }
+
+  // ---------------------------------------------------------------------------
+  //! Check if the jobs are also stored in the workflow proc directory
+  // ---------------------------------------------------------------------------
+  bool IsExport() const
+  {
+    return mExport;
+  }
+
   // ---------------------------------------------------------------------------
   //! Decrement the number of active jobs in the workflow enging
   // ---------------------------------------------------------------------------
@@ -0,0 +1,521 @@
+//------------------------------------------------------------------------------
+// File: WFEQueue.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "mgm/WFEQueue.hh"
+#include "common/Logging.hh"
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//! Weight of a new sample in the average latencies
+static const double sAvgWeight = 0.05;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+WFEQueue::WFEQueue():
+  mJournal("workflow"), mRecovered(false), mNextId(1), mEvents(0), mSeen(0)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+WFEQueue::~WFEQueue()
+{}
+
+//------------------------------------------------------------------------------
+// Escape blanks and percent signs of a journal field
+//------------------------------------------------------------------------------
+std::string
+WFEQueue::Escape(const std::string& in)
+{
+  std::string out;
+  char hex[4];
+
+  if (in.empty()) {
+    return "%";
+  }
+
+  for (size_t i = 0; i < in.length(); i++) {
+    unsigned char c = in[i];
+
+    if ((c <= ' ') || (c == '%') || (c >= 127)) {
+      snprintf(hex, sizeof(hex), "%%%02x", c);
+      out += hex;
+    } else {
+      out += in[i];
+    }
+  }
+
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Undo Escape
+//------------------------------------------------------------------------------
+std::string
+WFEQueue::Unescape(const std::string& in)
+{
+  std::string out;
+
+  for (size_t i = 0; i < in.length(); i++) {
+    if ((in[i] == '%') && (i + 2 < in.length())) {
+      out += (char) strtoul(in.substr(i + 1, 2).c_str(), 0, 16);
+      i += 2;
+    } else if (in[i] != '%') {
+      out += in[i];
+    }
+  }
+
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Journal line adding a job
+//------------------------------------------------------------------------------
+std::string
+WFEQueue::AddLine(const Entry& entry)
+{
+  std::ostringstream line;
+  line << "+ " << entry.mId << " " << std::hex << entry.mFid << std::dec << " "
+       << entry.mTime << " " << entry.mWhen << " " << entry.mRetry << " "
+       << Escape(entry.mQueue) << " " << Escape(entry.mEvent) << " "
+       << Escape(entry.mWorkflow) << " " << Escape(entry.mAction) << " "
+       << Escape(entry.mVid);
+  return line.str();
+}
+
+//------------------------------------------------------------------------------
+// Parse a journal line:
+//   + <id> <hex fid> <event time> <due time> <retry> <queue> <event>
+//     <workflow> <action> <vid>
+//   = <id> <queue> <due time> <retry>
+//------------------------------------------------------------------------------
+bool
+WFEQueue::Replay(const std::string& line)
+{
+  std::istringstream in(line);
+  std::string op;
+  uint64_t id = 0;
+
+  if (!(in >> op >> id) || !id) {
+    return false;
+  }
+
+  if (id >= mNextId) {
+    mNextId = id + 1;
+  }
+
+  if (op == "+") {
+    Entry entry;
+    std::string queue, event, workflow, action, vid;
+    entry.mId = id;
+
+    if (!(in >> std::hex >> entry.mFid >> std::dec >> entry.mTime >> entry.mWhen
+          >> entry.mRetry >> queue >> event >> workflow >> action >> vid)) {
+      return false;
+    }
+
+    entry.mQueue = Unescape(queue);
+    entry.mEvent = Unescape(event);
+    entry.mWorkflow = Unescape(workflow);
+    entry.mAction = Unescape(action);
+    entry.mVid = Unescape(vid);
+    Job& job = mJobs[id];
+    job.mEntry = entry;
+    job.mRunning = false;
+    job.mStart = 0;
+    return true;
+  }
+
+  if (op == "=") {
+    std::string queue;
+    time_t when = 0;
+    int retry = 0;
+
+    if (!(in >> queue >> when >> retry)) {
+      return false;
+    }
+
+    auto it = mJobs.find(id);
+
+    if (it == mJobs.end()) {
+      // the job was already done
+      return true;
+    }
+
+    if ((queue == "d") || (queue == "f") || (queue == "g")) {
+      mJobs.erase(it);
+    } else {
+      it->second.mEntry.mQueue = queue;
+      it->second.mEntry.mWhen = when;
+      it->second.mEntry.mRetry = retry;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Open the journal and recover the pending jobs from it
+//------------------------------------------------------------------------------
+bool
+WFEQueue::Open(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  unsigned long long nbad = 0;
+  mRecovered = mJournal.Read(path, [this, &nbad](const std::string & line) {
+    if (!Replay(line)) {
+      nbad++;
+    }
+  });
+
+  if (mRecovered) {
+    eos_static_notice("msg=\"recovered workflow journal\" path=\"%s\" lines=%llu "
+                      "bad-lines=%llu jobs=%lu", path.c_str(), mJournal.GetLines(),
+                      nbad, (unsigned long) mJobs.size());
+  }
+
+  for (auto it = mJobs.begin(); it != mJobs.end(); ++it) {
+    if (it->second.mEntry.mQueue == "r") {
+      // interrupted by the restart, run it again
+      it->second.mEntry.mQueue = "q";
+    }
+
+    Enqueue(it->second);
+  }
+
+  // start with a journal holding only the pending jobs
+  Compact();
+  return mJournal.IsOpen();
+}
+
+//------------------------------------------------------------------------------
+// Check if a journal was recovered
+//------------------------------------------------------------------------------
+bool
+WFEQueue::Recovered()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mRecovered;
+}
+
+//------------------------------------------------------------------------------
+// Rewrite the journal with only the pending jobs
+//------------------------------------------------------------------------------
+void
+WFEQueue::Compact()
+{
+  std::vector<std::string> lines;
+  lines.reserve(mJobs.size());
+
+  for (auto it = mJobs.begin(); it != mJobs.end(); ++it) {
+    lines.push_back(AddLine(it->second.mEntry));
+  }
+
+  mJournal.Rewrite(lines);
+}
+
+//------------------------------------------------------------------------------
+// Put a job in the queue of its workflow
+//------------------------------------------------------------------------------
+void
+WFEQueue::Enqueue(Job& job)
+{
+  Workflow& wf = mWorkflows[job.mEntry.mWorkflow];
+  wf.mDue.insert(std::make_pair(job.mEntry.mWhen, job.mEntry.mId));
+
+  if (job.mEntry.mQueue == "e") {
+    wf.mWaiting++;
+  } else {
+    wf.mQueued++;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Take a job out of the queue of its workflow
+//------------------------------------------------------------------------------
+void
+WFEQueue::Dequeue(Job& job)
+{
+  Workflow& wf = mWorkflows[job.mEntry.mWorkflow];
+
+  if (wf.mDue.erase(std::make_pair(job.mEntry.mWhen, job.mEntry.mId))) {
+    if (job.mEntry.mQueue == "e") {
+      wf.mWaiting--;
+    } else {
+      wf.mQueued--;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Add a new job
+//------------------------------------------------------------------------------
+void
+WFEQueue::Add(Entry& entry)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  entry.mId = mNextId++;
+
+  if (entry.mQueue.empty()) {
+    entry.mQueue = "q";
+  }
+
+  Job& job = mJobs[entry.mId];
+  job.mEntry = entry;
+  job.mRunning = false;
+  job.mStart = 0;
+  Enqueue(job);
+  mJournal.Append(AddLine(entry));
+  mEvents++;
+  mCond.notify_all();
+}
+
+//------------------------------------------------------------------------------
+// Record the change of queue of a job
+//------------------------------------------------------------------------------
+void
+WFEQueue::Update(uint64_t id, const std::string& queue, time_t when, int retry)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mJobs.find(id);
+
+  if (it == mJobs.end()) {
+    eos_static_warning("msg=\"update of unknown workflow job\" id=%llu queue=%s",
+                       (unsigned long long) id, queue.c_str());
+    return;
+  }
+
+  std::ostringstream line;
+  line << "= " << id << " " << Escape(queue) << " " << when << " " << retry;
+  mJournal.Append(line.str());
+  Job& job = it->second;
+  Workflow& wf = mWorkflows[job.mEntry.mWorkflow];
+
+  if (!job.mRunning) {
+    Dequeue(job);
+  }
+
+  if (queue == "r") {
+    job.mEntry.mQueue = queue;
+    job.mEntry.mRetry = retry;
+    return;
+  }
+
+  if (job.mRunning) {
+    // the run of the job is over
+    job.mRunning = false;
+    wf.mRunning--;
+    time_t runtime = time(NULL) - job.mStart;
+    wf.mRunTime = wf.mRunTime ? ((1 - sAvgWeight) * wf.mRunTime + sAvgWeight *
+                                 runtime) : runtime;
+  }
+
+  if ((queue == "e") && (retry > job.mEntry.mRetry)) {
+    wf.mRetried++;
+  }
+
+  if ((queue == "d") || (queue == "f") || (queue == "g")) {
+    if (queue == "d") {
+      wf.mDone++;
+    } else if (queue == "f") {
+      wf.mFailed++;
+    } else {
+      wf.mGone++;
+    }
+
+    mJobs.erase(it);
+  } else {
+    job.mEntry.mQueue = queue;
+    job.mEntry.mWhen = when;
+    job.mEntry.mRetry = retry;
+    Enqueue(job);
+  }
+
+  mEvents++;
+  mCond.notify_all();
+}
+
+//------------------------------------------------------------------------------
+// Get the next job which is due, taking the workflows in turn
+//------------------------------------------------------------------------------
+bool
+WFEQueue::Next(time_t now, size_t maxrunning, Entry& entry)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mWorkflows.empty()) {
+    return false;
+  }
+
+  auto start = mWorkflows.upper_bound(mLastWorkflow);
+
+  for (size_t n = 0; n < mWorkflows.size(); n++, ++start) {
+    if (start == mWorkflows.end()) {
+      start = mWorkflows.begin();
+    }
+
+    Workflow& wf = start->second;
+
+    if ((maxrunning && (wf.mRunning >= maxrunning)) || wf.mDue.empty() ||
+        (wf.mDue.begin()->first > now)) {
+      continue;
+    }
+
+    auto it = mJobs.find(wf.mDue.begin()->second);
+
+    if (it == mJobs.end()) {
+      wf.mDue.erase(wf.mDue.begin());
+      continue;
+    }
+
+    Job& job = it->second;
+    Dequeue(job);
+    job.mRunning = true;
+    job.mStart = now;
+    wf.mRunning++;
+    time_t latency = now - job.mEntry.mWhen;
+    wf.mDispatchLatency = wf.mDispatchLatency ?
+                          ((1 - sAvgWeight) * wf.mDispatchLatency + sAvgWeight * latency) :
+                          latency;
+    entry = job.mEntry;
+    mLastWorkflow = start->first;
+    return true;
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Release the running slot of a job handed out by Next
+//------------------------------------------------------------------------------
+void
+WFEQueue::Release(uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mJobs.find(id);
+
+  if ((it != mJobs.end()) && it->second.mRunning) {
+    // the job did not record any outcome, try again later
+    Job& job = it->second;
+    Workflow& wf = mWorkflows[job.mEntry.mWorkflow];
+    job.mRunning = false;
+    wf.mRunning--;
+    job.mEntry.mWhen = time(NULL) + 60;
+
+    if (job.mEntry.mQueue == "r") {
+      job.mEntry.mQueue = "e";
+    }
+
+    eos_static_warning("msg=\"workflow job ended without outcome\" id=%llu",
+                       (unsigned long long) id);
+    Enqueue(job);
+  }
+
+  mEvents++;
+  mCond.notify_all();
+}
+
+//------------------------------------------------------------------------------
+// Wait until a job was added or released since the last wait
+//------------------------------------------------------------------------------
+void
+WFEQueue::Wait(time_t maxms)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mCond.wait_for(lock, std::chrono::milliseconds(maxms), [this] {
+    return (mEvents != mSeen);
+  });
+  mSeen = mEvents;
+}
+
+//------------------------------------------------------------------------------
+// Flush the journal to disk and compact it if needed
+//------------------------------------------------------------------------------
+void
+WFEQueue::Sync()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mJournal.Sync();
+
+  if (mJournal.NeedsRewrite(mJobs.size())) {
+    Compact();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Print the counters of the workflows
+//------------------------------------------------------------------------------
+void
+WFEQueue::PrintOut(XrdOucString& out, bool monitoring)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  char outline[1024];
+
+  if (!monitoring) {
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+    out += "# workflow queues, latencies in seconds\n";
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+    snprintf(outline, sizeof(outline),
+             "%-16s %10s %10s %8s %10s %8s %8s %8s %10s %10s\n",
+             "workflow", "queued", "waiting", "running", "done", "failed", "gone",
+             "retried", "dispatch", "runtime");
+    out += outline;
+    out += "# -----------------------------------------------------------------------------------------------------------\n";
+  } else {
+    snprintf(outline, sizeof(outline),
+             "uid=all gid=all wfe.jobs=%lu wfe.journal.lines=%llu\n",
+             (unsigned long) mJobs.size(), mJournal.GetLines());
+    out += outline;
+  }
+
+  for (auto it = mWorkflows.begin(); it != mWorkflows.end(); ++it) {
+    const Workflow& wf = it->second;
+
+    if (!monitoring) {
+      snprintf(outline, sizeof(outline),
+               "%-16s %10llu %10llu %8lu %10llu %8llu %8llu %8llu %10.03f %10.03f\n",
+               it->first.c_str(), wf.mQueued, wf.mWaiting,
+               (unsigned long) wf.mRunning, wf.mDone, wf.mFailed, wf.mGone,
+               wf.mRetried, wf.mDispatchLatency, wf.mRunTime);
+    } else {
+      snprintf(outline, sizeof(outline),
+               "uid=all gid=all wfe.workflow=%s queued=%llu waiting=%llu "
+               "running=%lu done=%llu failed=%llu gone=%llu retried=%llu "
+               "dispatch=%.03f runtime=%.03f\n", Escape(it->first).c_str(),
+               wf.mQueued, wf.mWaiting, (unsigned long) wf.mRunning, wf.mDone,
+               wf.mFailed, wf.mGone, wf.mRetried, wf.mDispatchLatency, wf.mRunTime);
+    }
+
+    out += outline;
+  }
+}
+
+EOSMGMNAMESPACE_END
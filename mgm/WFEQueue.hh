@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------------
+// File: WFEQueue.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_WFEQUEUE__HH__
+#define __EOSMGM_WFEQUEUE__HH__
+
+#include "mgm/Namespace.hh"
+#include "mgm/JobJournal.hh"
+#include "common/FileId.hh"
+#include "XrdOuc/XrdOucString.hh"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <time.h>
+#include <stdint.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! @brief Queue of the workflow jobs kept in memory and backed by a journal.
+//!
+//! Every state change of a job (queued 'q', waiting for a retry 'e',
+//! running 'r', done 'd', failed 'f', gone 'g') is appended as one line to a
+//! local journal file, which is replayed when the MGM starts. Jobs still
+//! running at that time are queued again. The journal is rewritten with only
+//! the pending jobs when it grows much larger than them.
+//!
+//! Jobs are kept per workflow, ordered by the time they are due, so a retry
+//! delay is just a later due time. A workflow has its own number of running
+//! slots, so one busy workflow can not hold back the others, and its own
+//! counters and latencies.
+//------------------------------------------------------------------------------
+class WFEQueue
+{
+public:
+  //----------------------------------------------------------------------------
+  //! A workflow job as stored in the journal
+  //----------------------------------------------------------------------------
+  struct Entry {
+    uint64_t mId; ///< Journal id of the job, 0 if not yet added
+    eos::common::FileId::fileid_t mFid;
+    std::string mEvent;
+    std::string mWorkflow;
+    std::string mAction;
+    std::string mVid; ///< Identity of the client in Mapping::VidToString format
+    std::string mQueue; ///< q, e, r, d, f or g
+    time_t mTime; ///< Time of the event
+    time_t mWhen; ///< Time the job is due
+    int mRetry; ///< Number of retries done
+
+    Entry(): mId(0), mFid(0), mTime(0), mWhen(0), mRetry(0) {}
+  };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //----------------------------------------------------------------------------
+  WFEQueue();
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~WFEQueue();
+
+  //----------------------------------------------------------------------------
+  //! Open the journal and recover the pending jobs from it
+  //!
+  //! @param path journal file
+  //!
+  //! @return false if the journal can not be opened, the jobs are then only
+  //!         kept in memory
+  //----------------------------------------------------------------------------
+  bool Open(const std::string& path);
+
+  //----------------------------------------------------------------------------
+  //! Check if a journal was recovered, false before Open or if the journal
+  //! did not exist yet
+  //----------------------------------------------------------------------------
+  bool Recovered();
+
+  //----------------------------------------------------------------------------
+  //! Add a new job
+  //!
+  //! @param entry job to add, mId is set
+  //----------------------------------------------------------------------------
+  void Add(Entry& entry);
+
+  //----------------------------------------------------------------------------
+  //! Record the change of queue of a job. Jobs moved to d, f or g are done
+  //! and removed, jobs moved to q or e are handed out again once due.
+  //!
+  //! @param id journal id of the job
+  //! @param queue new queue
+  //! @param when time the job is due
+  //! @param retry number of retries done
+  //----------------------------------------------------------------------------
+  void Update(uint64_t id, const std::string& queue, time_t when, int retry);
+
+  //----------------------------------------------------------------------------
+  //! Get the next job which is due, taking the workflows in turn
+  //!
+  //! @param now current time
+  //! @param maxrunning maximum number of running jobs of a workflow, 0 for
+  //!        unlimited
+  //! @param entry filled with the job
+  //!
+  //! @return false if no job can run now
+  //----------------------------------------------------------------------------
+  bool Next(time_t now, size_t maxrunning, Entry& entry);
+
+  //----------------------------------------------------------------------------
+  //! Release the running slot of a job handed out by Next
+  //----------------------------------------------------------------------------
+  void Release(uint64_t id);
+
+  //----------------------------------------------------------------------------
+  //! Wait until a job was added or released since the last wait
+  //!
+  //! @param maxms maximum time to wait in milliseconds
+  //----------------------------------------------------------------------------
+  void Wait(time_t maxms);
+
+  //----------------------------------------------------------------------------
+  //! Flush the journal to disk and compact it if needed
+  //----------------------------------------------------------------------------
+  void Sync();
+
+  //----------------------------------------------------------------------------
+  //! Print the counters of the workflows
+  //!
+  //! @param out output string
+  //! @param monitoring print in key=value format
+  //----------------------------------------------------------------------------
+  void PrintOut(XrdOucString& out, bool monitoring);
+
+private:
+  //! Counters and queue of one workflow
+  struct Workflow {
+    std::set<std::pair<time_t, uint64_t> > mDue; ///< Jobs by due time
+    size_t mRunning; ///< Jobs handed out and not released
+    unsigned long long mQueued; ///< Jobs in q
+    unsigned long long mWaiting; ///< Jobs in e
+    unsigned long long mDone;
+    unsigned long long mFailed;
+    unsigned long long mGone;
+    unsigned long long mRetried;
+    double mDispatchLatency; ///< Average seconds between due and start
+    double mRunTime; ///< Average seconds between start and release
+
+    Workflow():
+      mRunning(0), mQueued(0), mWaiting(0), mDone(0), mFailed(0), mGone(0),
+      mRetried(0), mDispatchLatency(0), mRunTime(0) {}
+  };
+
+  //! A pending job
+  struct Job {
+    Entry mEntry;
+    bool mRunning; ///< Handed out by Next
+    time_t mStart; ///< Time it was handed out
+  };
+
+  //! Journal line adding a job
+  static std::string AddLine(const Entry& entry);
+
+  //! Parse a journal line, false if it is not valid
+  bool Replay(const std::string& line);
+
+  //! Put a job in the queue of its workflow, must hold mMutex
+  void Enqueue(Job& job);
+
+  //! Take a job out of the queue of its workflow, must hold mMutex
+  void Dequeue(Job& job);
+
+  //! Rewrite the journal with only the pending jobs, must hold mMutex
+  void Compact();
+
+  //! Escape blanks and percent signs of a journal field
+  static std::string Escape(const std::string& in);
+
+  //! Undo Escape
+  static std::string Unescape(const std::string& in);
+
+  std::mutex mMutex; ///< Protecting all the members below
+  std::condition_variable mCond; ///< Signalled on new or released jobs
+  JobJournal mJournal;
+  bool mRecovered; ///< A journal existed at Open
+  uint64_t mNextId;
+  std::map<uint64_t, Job> mJobs; ///< Pending jobs
+  std::map<std::string, Workflow> mWorkflows;
+  std::string mLastWorkflow; ///< Workflow handed out last by Next
+  unsigned long long mEvents; ///< Jobs added or released
+  unsigned long long mSeen; ///< Value of mEvents at the end of the last Wait
+};
+
+EOSMGMNAMESPACE_END
+
+#endif
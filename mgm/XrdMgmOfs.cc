@@ -40,6 +40,8 @@
 #include "mgm/XrdMgmOfsTrace.hh"
 #include "mgm/XrdMgmOfsSecurity.hh"
 #include "mgm/Policy.hh"
+#include "mgm/AttrIndex.hh"
+#include "mgm/FindEngine.hh"
 #include "mgm/Quota.hh"
 #include "mgm/Acl.hh"
 #include "mgm/Workflow.hh"
@@ -144,6 +146,7 @@ XrdSfsGetFileSystem(XrdSfsFileSystem* native_fs,
 //------------------------------------------------------------------------------
 XrdMgmOfs::XrdMgmOfs(XrdSysError* ep):
   ConfigFN(0), ConfEngine(0), CapabilityEngine(0), mCapabilityValidity(3600),
+  mCapabilityFormat(XrdCapability::Format::kLegacy),
   MgmOfsMessaging(0), MgmOfsVstMessaging(0),  ManagerPort(1094),
   MgmOfsConfigEngineRedisPort(0), LinuxStatsStartup{0},
   StartTime(0), HostName(0), HostPref(0), Initialized(kDown),
@@ -74,6 +74,7 @@
  * - Recycler
  * - LRU
  * - WFE
+ * - Drain Scheduler
  *
  * Many functions in the MgmOfs interface take CGI parameters. The supported
  * CGI parameter are:
@@ -119,6 +120,7 @@
 #include "mgm/Master.hh"
 #include "mgm/Egroup.hh"
 #include "mgm/Recycle.hh"
+#include "mgm/DrainScheduler.hh"
 #include "mgm/Messaging.hh"
 #include "mgm/VstMessaging.hh"
 #include "mgm/ProcInterface.hh"
@@ -1054,6 +1056,8 @@ public:
   //! Authorization module for token encryption/decryption
   XrdCapability* CapabilityEngine;
   uint64_t mCapabilityValidity; ////< Time in seconds the capability is valid
+  //! Encoding of the capabilities handed out to clients on redirection
+  XrdCapability::Format mCapabilityFormat;
   XrdOucString MgmOfsBroker; ///< Url of the message broker without MGM subject
   XrdOucString MgmOfsBrokerUrl; ///< Url of the message broker with MGM subject
   XrdOucString MgmOfsVstBrokerUrl; ///< Url of the message broker
@@ -1237,6 +1241,7 @@ public:
   //!  Egroup refresh object running asynchronous Egroup fetch thread
   Egroup EgroupRefresh;
   Recycle Recycler; ///<  Recycle object running the recycle bin deletion thread
+  DrainScheduler DrainSched; ///< Central scheduler of the drain transfers
   bool UTF8; ///< true if running in less restrictive character set mode
 
   std::string mArchiveEndpoint; ///< archive ZMQ connection endpoint
@@ -361,6 +361,12 @@ XrdMgmOfs::_attr_set(const char* path,
         dh->setMTimeNow();
         dh->notifyMTimeChange(gOFS->eosDirectoryService);
         eosView->updateContainerStore(dh.get());
+        Policy::AttributesChanged(dh->getId());
+
+        if (AttrIndex::IsIndexed(key)) {
+          AttrIndex::Update(dh->getId(), dh->getAttributes());
+        }
+
         errno = 0;
       }
     }
@@ -662,6 +668,11 @@ XrdMgmOfs::_attr_rem(const char* path,
         if (dh->hasAttribute(key)) {
           dh->removeAttribute(key);
           eosView->updateContainerStore(dh.get());
+          Policy::AttributesChanged(dh->getId());
+
+          if (AttrIndex::IsIndexed(key)) {
+            AttrIndex::Update(dh->getId(), dh->getAttributes());
+          }
         } else {
           errno = ENODATA;
         }
@@ -99,63 +99,14 @@ XrdMgmOfs::_find(const char* path,
   int deepness = 0;
   // users cannot return more than 100k files and 50k dirs with one find,
   // unless there is an access rule allowing deeper queries
-  static unsigned long long finddiruserlimit = 50000;
-  static unsigned long long findfileuserlimit = 100000;
-  {
-    // see if there are special access settings
-    eos::common::RWMutexReadLock lock(Access::gAccessMutex);
-
-    if (Access::gStallUserGroup) {
-      std::string usermatchfiles = "rate:user:";
-      usermatchfiles += vid.uid_string;
-      usermatchfiles += "FindFiles";
-      usermatchfiles += ":";
-      std::string groupmatchfiles = "rate:group:";
-      groupmatchfiles += vid.gid_string;
-      groupmatchfiles += ":";
-      groupmatchfiles += "FindFiles";
-      std::string userwildcardmatchfiles = "rate:user:*:FindFiles";
-
-      if (Access::gStallRules.count(usermatchfiles)) {
-        findfileuserlimit = strtoul(Access::gStallRules[usermatchfiles].c_str(), 0, 10);
-      } else if (Access::gStallRules.count(groupmatchfiles)) {
-        findfileuserlimit = strtoul(Access::gStallRules[groupmatchfiles].c_str(), 0,
-                                    10);
-      } else if (Access::gStallRules.count(userwildcardmatchfiles)) {
-        findfileuserlimit = strtoul(Access::gStallRules[userwildcardmatchfiles].c_str(),
-                                    0, 10);
-      }
-
-      std::string usermatchdirs = "rate:user:";
-      usermatchdirs += vid.uid_string;
-      usermatchdirs += "FindDirs";
-      usermatchdirs += ":";
-      std::string groupmatchdirs = "rate:group:";
-      groupmatchdirs += vid.gid_string;
-      groupmatchdirs += ":";
-      groupmatchdirs += "FindDirs";
-      std::string userwildcardmatchdirs = "rate:user:*:FindDirs";
-
-      if (Access::gStallRules.count(usermatchdirs)) {
-        finddiruserlimit = strtoul(Access::gStallRules[usermatchdirs].c_str(), 0, 10);
-      } else if (Access::gStallRules.count(groupmatchdirs)) {
-        finddiruserlimit = strtoul(Access::gStallRules[groupmatchdirs].c_str(), 0, 10);
-      } else if (Access::gStallRules.count(userwildcardmatchdirs)) {
-        finddiruserlimit = strtoul(Access::gStallRules[userwildcardmatchdirs].c_str(),
-                                   0, 10);
-      }
-    }
-  }
+  unsigned long long finddiruserlimit = 0;
+  unsigned long long findfileuserlimit = 0;
+  bool limitresult = FindEngine::GetUserLimits(vid, findfileuserlimit,
+                     finddiruserlimit);
   unsigned long long filesfound = 0;
   unsigned long long dirsfound = 0;
-  bool limitresult = false;
   bool limited = false;
 
-  if ((vid.uid != 0) && (!eos::common::Mapping::HasUid(3, vid.uid_list)) &&
-      (!eos::common::Mapping::HasGid(4, vid.gid_list)) && (!vid.sudoer)) {
-    limitresult = true;
-  }
-
   do {
     bool permok = false;
     found_dirs.resize(deepness + 2);
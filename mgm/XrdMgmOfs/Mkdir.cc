@@ -344,6 +344,8 @@ XrdMgmOfs::_mkdir(const char* path,
             for (const auto& elem : xattrs) {
               newdir->setAttribute(elem.first, elem.second);
             }
+
+            AttrIndex::Update(newdir->getId(), xattrs);
           }
 
           // Store the in-memory modification time into the parent
@@ -400,6 +402,8 @@ XrdMgmOfs::_mkdir(const char* path,
       for (const auto& elem : xattrs) {
         newdir->setAttribute(elem.first, elem.second);
       }
+
+      AttrIndex::Update(newdir->getId(), xattrs);
     }
 
     if (outino) {
@@ -189,6 +189,7 @@ XrdMgmOfs::_remdir(const char* path,
       }
 
       eosView->removeContainer(path);
+      AttrIndex::Remove(dh->getId());
     } catch (eos::MDException& e) {
       errno = e.getErrno();
       eos_debug("msg=\"exception\" ec=%d emsg=\"%s\"\n",
@@ -515,6 +515,9 @@ XrdMgmOfs::_rename(const char* old_name,
             }
           }
 
+          // the quota node responsible for the subtree may change
+          Quota::InvalidateContainerQuota();
+
           if (nP == oP) {
             // Rename within a container
             eosView->renameContainer(rdir.get(), nPath.GetName());
@@ -560,6 +563,9 @@ XrdMgmOfs::_rename(const char* old_name,
               eosView->updateContainerStore(newdir.get());
             }
           }
+
+          // directories referenced by sys.attr.link may have moved
+          Policy::LinksChanged();
         }
 
         file.reset();
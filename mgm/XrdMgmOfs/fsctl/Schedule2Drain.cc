@@ -186,13 +186,15 @@
     eos::common::FileSystem* source_fs = 0;
 
     for (size_t n = 0; n < group->size(); n++) {
-      // look for a filesystem in drain mode
-      if ((eos::common::FileSystem::GetDrainStatusFromString(
-             FsView::gFsView.mIdView[*group_iterator]->GetString("stat.drain").c_str()) !=
-           eos::common::FileSystem::kDraining) &&
-          (eos::common::FileSystem::GetDrainStatusFromString(
-             FsView::gFsView.mIdView[*group_iterator]->GetString("stat.drain").c_str()) !=
-           eos::common::FileSystem::kDrainStalling)) {
+      // look for a filesystem in drain mode, which is not drained by the
+      // central drain scheduler of the MGM
+      if (((eos::common::FileSystem::GetDrainStatusFromString(
+              FsView::gFsView.mIdView[*group_iterator]->GetString("stat.drain").c_str()) !=
+            eos::common::FileSystem::kDraining) &&
+           (eos::common::FileSystem::GetDrainStatusFromString(
+              FsView::gFsView.mIdView[*group_iterator]->GetString("stat.drain").c_str()) !=
+            eos::common::FileSystem::kDrainStalling)) ||
+          gOFS->DrainSched.IsScheduling(*group_iterator)) {
         source_fs = 0;
         group_iterator++;
 
@@ -394,6 +394,13 @@ XrdMgmOfs::Configure(XrdSysError& Eroute)
   MgmArchiveSvcClass = "default";
   eos::common::StringConversion::InitLookupTables();
 
+  // Compact capabilities require all the FSTs to understand the new format
+  if (getenv("EOS_MGM_CAPABILITY_FORMAT") &&
+      (!strcmp(getenv("EOS_MGM_CAPABILITY_FORMAT"), "compact"))) {
+    mCapabilityFormat = XrdCapability::Format::kCompact;
+    Eroute.Say("=====> mgmofs issues compact capabilities");
+  }
+
   if (getenv("EOS_VST_BROKER_URL")) {
     MgmOfsVstBrokerUrl = getenv("EOS_VST_BROKER_URL");
   }
@@ -1972,6 +1979,11 @@ XrdMgmOfs::Configure(XrdSysError& Eroute)
     eos_warning("msg=\"cannot start recycle thread\"");
   }
 
+  // start the drain scheduler, it only schedules on a master
+  if (!DrainSched.Start()) {
+    eos_warning("msg=\"cannot start drain scheduler thread\"");
+  }
+
   // add all stat entries with 0
   InitStats();
   // set IO accounting file
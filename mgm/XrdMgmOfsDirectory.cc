@@ -52,6 +52,8 @@
 /******************************************************************************/
 
 
+const size_t XrdMgmOfsDirectory::sListPageSize = 4096;
+
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
@@ -60,6 +62,8 @@ XrdMgmOfsDirectory::XrdMgmOfsDirectory(char* user, int MonID):
 {
   dirName = "";
   dh.reset();
+  dh_it = dh_list.end();
+  dh_more = false;
   d_pnt = &dirent_full.d_entry;
   eos::common::Mapping::Nobody(vid);
   eos::common::LogId();
@@ -145,8 +149,10 @@ XrdMgmOfsDirectory::_open(const char* dir_path,
  *
  * @return SFS_OK otherwise SFS_ERROR
  *
- * We create during the open the full directory listing which then is retrieved
- * via nextEntry() and cleaned up with close().
+ * The directory entries are returned in name order via nextEntry(). They are
+ * fetched page by page from namespaces which page the listing, otherwise a
+ * sorted snapshot of the entries is taken here. The listing state is cleaned
+ * up with close().
  */
 /*----------------------------------------------------------------------------*/
 {
@@ -192,14 +198,29 @@ XrdMgmOfsDirectory::_open(const char* dir_path,
       // Add all the files and subdirectories
       gOFS->MgmStats.Add("OpenDir-Entry", vid.uid, vid.gid,
                          dh->getNumContainers() + dh->getNumFiles());
-      dh_list = dh->getNameFiles();
-      std::set<std::string> dnames = dh->getNameContainers();
-      dh_list.insert(dnames.begin(), dnames.end());
-      dh_list.insert(".");
-
-      // The root dir has no .. entry
-      if (strcmp(dir_path, "/")) {
-        dh_list.insert("..");
+      dh_list.clear();
+
+      // No . and .. entries if the listing is resumed after a given entry
+      if (dh_token.empty()) {
+        dh_list.push_back(".");
+
+        // The root dir has no .. entry
+        if (strcmp(dir_path, "/")) {
+          dh_list.push_back("..");
+        }
+      }
+
+      if (dh->hasPagedListing()) {
+        dh_more = true;
+      } else {
+        // The children are in memory, take the snapshot of this listing
+        std::set<std::string> names = dh->getNameFiles();
+        std::set<std::string> dnames = dh->getNameContainers();
+        names.insert(dnames.begin(), dnames.end());
+        auto it = (dh_token.empty() ? names.begin() :
+                   names.upper_bound(dh_token));
+        dh_list.insert(dh_list.end(), it, names.end());
+        dh_more = false;
       }
     }
   } catch (eos::MDException& e) {
@@ -253,14 +274,38 @@ XrdMgmOfsDirectory::nextEntry()
  */
 /*----------------------------------------------------------------------------*/
 {
-  if (dh_it == dh_list.end()) {
+  if ((dh_it == dh_list.end()) && (!dh_more || !FetchEntries())) {
     // no more entry
     return (const char*) 0;
   }
 
-  std::set<std::string>::iterator tmp_it = dh_it;
+  const char* entry = dh_it->c_str();
   dh_it++;
-  return tmp_it->c_str();
+  return entry;
+}
+
+//------------------------------------------------------------------------------
+// Fetch the next page of entries from the namespace
+//------------------------------------------------------------------------------
+bool
+XrdMgmOfsDirectory::FetchEntries()
+{
+  std::vector<std::string> entries;
+  {
+    eos::common::RWMutexReadLock lock(gOFS->eosViewRWMutex);
+
+    try {
+      dh_token = dh->listEntries(dh_token, sListPageSize, entries);
+    } catch (eos::MDException& e) {
+      eos_err("msg=\"failed to list entries\" path=%s ec=%d emsg=\"%s\"",
+              dirName.c_str(), e.getErrno(), e.getMessage().str().c_str());
+      dh_token.clear();
+    }
+  }
+  dh_more = !dh_token.empty();
+  dh_list.swap(entries);
+  dh_it = dh_list.begin();
+  return (dh_it != dh_list.end());
 }
 
 /*----------------------------------------------------------------------------*/
@@ -275,7 +320,10 @@ XrdMgmOfsDirectory::close()
 /*----------------------------------------------------------------------------*/
 {
   //  static const char *epname = "closedir";
-  dh_list.clear();
+  std::vector<std::string>().swap(dh_list);
+  dh_it = dh_list.end();
+  dh_token.clear();
+  dh_more = false;
   return SFS_OK;
 }
 
@@ -44,6 +44,7 @@
 #include <dirent.h>
 #include <string>
 #include <set>
+#include <vector>
 /*----------------------------------------------------------------------------*/
 
 //! Forward declaration
@@ -85,6 +86,18 @@ public:
   // ---------------------------------------------------------------------------
   const char *nextEntry ();
 
+  //----------------------------------------------------------------------------
+  //! Start the listing after the given entry name. Must be called before
+  //! open, in which case the "." and ".." entries are not returned.
+  //!
+  //! @param marker entry name after which the listing starts
+  //----------------------------------------------------------------------------
+  void
+  SetListingMarker (const std::string& marker)
+  {
+    dh_token = marker;
+  }
+
   //----------------------------------------------------------------------------
   //! Create an error message
   //!
@@ -142,9 +155,22 @@ private:
   std::string dirName;
   eos::common::Mapping::VirtualIdentity vid;
 
+  //----------------------------------------------------------------------------
+  //! Fetch the next page of entries from the namespace
+  //!
+  //! @return true if there are entries to return, otherwise false
+  //----------------------------------------------------------------------------
+  bool FetchEntries ();
+
+  //! Number of entries fetched from the namespace at once
+  static const size_t sListPageSize;
+
   std::shared_ptr<eos::IContainerMD> dh;
-  std::set<std::string> dh_list;
-  std::set<std::string>::const_iterator dh_it;
+  //! Current page of entries or all of them if the listing is not paged
+  std::vector<std::string> dh_list;
+  std::vector<std::string>::const_iterator dh_it;
+  std::string dh_token; ///< Continuation token for the next page
+  bool dh_more; ///< More entries to fetch from the namespace
 };
 
 
@@ -42,6 +42,7 @@
 #include "mgm/txengine/TransferEngine.hh"
 #include "mgm/Recycle.hh"
 #include "mgm/Macros.hh"
+#include "mgm/OpenTrace.hh"
 #include "XrdVersion.hh"
 #include "XrdOss/XrdOss.hh"
 #include "XrdOuc/XrdOucEnv.hh"
@@ -101,6 +102,7 @@ XrdMgmOfsFile::open(const char* inpath,
   const char* tident = error.getErrUser();
   errno = 0;
   EXEC_TIMING_BEGIN("Open");
+  OpenTrace trace(tident, inpath);
   SetLogId(logId, tident);
   {
     EXEC_TIMING_BEGIN("IdMap");
@@ -185,6 +187,7 @@ XrdMgmOfsFile::open(const char* inpath,
   XrdOucString pinfo = (ininfo ? ininfo : "");
   eos::common::StringConversion::MaskTag(pinfo, "cap.msg");
   eos::common::StringConversion::MaskTag(pinfo, "cap.sym");
+  eos::common::StringConversion::MaskTag(pinfo, "cap.bin");
   eos::common::StringConversion::MaskTag(pinfo, "authz");
 
   if (isRW) {
@@ -204,8 +207,10 @@ XrdMgmOfsFile::open(const char* inpath,
     SET_ACCESSMODE_W;
   }
 
+  trace.Enter(OpenTrace::kStall);
   MAYSTALL;
   MAYREDIRECT;
+  trace.Enter(OpenTrace::kNamespace);
   XrdOucString currentWorkflow = "default";
 
   if ((spath.beginswith("fid:") || (spath.beginswith("fxid:")))) {
@@ -452,6 +457,8 @@ XrdMgmOfsFile::open(const char* inpath,
   std::shared_ptr<eos::IContainerMD> dmd =
     std::shared_ptr<eos::IContainerMD>((eos::IContainerMD*)0);
   eos::IContainerMD::XAttrMap attrmap;
+  // attribute version sampled together with the attributes
+  Policy::AttrVersion attr_version = {0, 0};
   Acl acl;
   Workflow workflow;
   bool stdpermcheck = false;
@@ -468,6 +475,7 @@ XrdMgmOfsFile::open(const char* inpath,
       // get the attributes out
       gOFS->_attr_ls(gOFS->eosView->getUri(dmd.get()).c_str(), error, vid, 0,
                      attrmap, false);
+      attr_version = Policy::GetAttrVersion(dmd->getId());
       // extract workflows
       workflow.Init(&attrmap);
 
@@ -526,6 +534,7 @@ XrdMgmOfsFile::open(const char* inpath,
           dmd = gOFS->eosView->getContainer(cPath.GetSubPath(2));
           // get the attributes out
           gOFS->_attr_ls(cPath.GetSubPath(2), error, vid, 0, attrmap, false);
+          attr_version = Policy::GetAttrVersion(dmd->getId());
         } catch (eos::MDException& e) {
           dmd.reset();
           errno = e.getErrno();
@@ -555,6 +564,7 @@ XrdMgmOfsFile::open(const char* inpath,
           XrdOucString predirectionhost = redirectionhost.c_str();
           eos::common::StringConversion::MaskTag(predirectionhost, "cap.msg");
           eos::common::StringConversion::MaskTag(predirectionhost, "cap.sym");
+          eos::common::StringConversion::MaskTag(predirectionhost, "cap.bin");
           eos::common::StringConversion::MaskTag(pinfo, "authz");
           eos_info("info=\"redirecting\" hostport=%s:%d", predirectionhost.c_str(),
                    ecode);
@@ -920,15 +930,17 @@ XrdMgmOfsFile::open(const char* inpath,
   // vector - for writes it is always 0, for reads it comes out of the
   // FileAccess function
   unsigned long fsIndex = 0;
-  XrdOucString space = "default";
-  unsigned long newlayoutId = 0;
-  // select space and layout according to policies
-  Policy::GetLayoutAndSpace(path, attrmap, vid, newlayoutId, space, *openOpaque,
-                            forcedFsId, forcedGroup);
-  eos::mgm::Scheduler::tPlctPolicy plctplcy;
-  std::string targetgeotag;
-  // get placement policy
-  Policy::GetPlctPolicy(path, attrmap, vid, *openOpaque, plctplcy, targetgeotag);
+  // select space, layout and placement according to the directory policies
+  Policy::Resolved policy;
+  trace.Enter(OpenTrace::kPolicy);
+  Policy::GetResolvedPolicy(path, (dmd ? dmd->getId() : 0), attr_version,
+                            attrmap, vid, *openOpaque, policy);
+  XrdOucString space = policy.mSpace.c_str();
+  unsigned long newlayoutId = policy.mLayoutId;
+  forcedFsId = policy.mForcedFsId;
+  forcedGroup = policy.mForcedGroup;
+  eos::mgm::Scheduler::tPlctPolicy plctplcy = policy.mPlctPolicy;
+  std::string targetgeotag = policy.mTargetGeotag;
   eos::common::RWMutexReadLock vlock(FsView::gFsView.ViewMutex);
   unsigned long long ext_mtime_sec = 0;
   unsigned long long ext_mtime_nsec = 0;
@@ -1082,34 +1094,25 @@ XrdMgmOfsFile::open(const char* inpath,
   unsigned long long minimumsize = 0;
   unsigned long long maximumsize = 0;
 
-  if (attrmap.count("sys.forced.bookingsize")) {
-    // we allow only a system attribute not to get fooled by a user
-    bookingsize = strtoull(attrmap["sys.forced.bookingsize"].c_str(), 0, 10);
+  if (policy.mHasBookingSize) {
+    // sys.forced.bookingsize or user.forced.bookingsize
+    bookingsize = policy.mBookingSize;
   } else {
-    if (attrmap.count("user.forced.bookingsize")) {
-      bookingsize = strtoull(attrmap["user.forced.bookingsize"].c_str(), 0, 10);
-    } else {
-      bookingsize = 1024ll; // 1k as default
+    bookingsize = 1024ll; // 1k as default
 
-      if (openOpaque->Get("eos.bookingsize")) {
-        bookingsize = strtoull(openOpaque->Get("eos.bookingsize"), 0, 10);
+    if (openOpaque->Get("eos.bookingsize")) {
+      bookingsize = strtoull(openOpaque->Get("eos.bookingsize"), 0, 10);
+      hasClientBookingSize = true;
+    } else {
+      if (openOpaque->Get("oss.asize")) {
+        bookingsize = strtoull(openOpaque->Get("oss.asize"), 0, 10);
         hasClientBookingSize = true;
-      } else {
-        if (openOpaque->Get("oss.asize")) {
-          bookingsize = strtoull(openOpaque->Get("oss.asize"), 0, 10);
-          hasClientBookingSize = true;
-        }
       }
     }
   }
 
-  if (attrmap.count("sys.forced.minsize")) {
-    minimumsize = strtoull(attrmap["sys.forced.minsize"].c_str(), 0, 10);
-  }
-
-  if (attrmap.count("sys.forced.maxsize")) {
-    maximumsize = strtoull(attrmap["sys.forced.maxsize"].c_str(), 0, 10);
-  }
+  minimumsize = policy.mMinSize;
+  maximumsize = policy.mMaxSize;
 
   if (openOpaque->Get("oss.asize")) {
     targetsize = strtoull(openOpaque->Get("oss.asize"), 0, 10);
@@ -1152,6 +1155,7 @@ XrdMgmOfsFile::open(const char* inpath,
     plctargs.grouptag = containertag;
     plctargs.lid = layoutId;
     plctargs.inode = (ino64_t) fmd->getId();
+    plctargs.cid = cid;
     plctargs.path = path;
     plctargs.plctTrgGeotag = &targetgeotag;
     plctargs.plctpolicy = plctplcy;
@@ -1166,6 +1170,8 @@ XrdMgmOfsFile::open(const char* inpath,
       return Emsg(epname, error, EINVAL, "open - invalid placement argument", path);
     }
 
+    // the quota check switches the trace to the placement phase
+    trace.Enter(OpenTrace::kQuota);
     retc = Quota::FilePlacement(&plctargs);
   } else {
     // Access existing file - fill the vector with the existing locations
@@ -1209,6 +1215,7 @@ XrdMgmOfsFile::open(const char* inpath,
       return Emsg(epname, error, EINVAL, "open - invalid access argument", path);
     }
 
+    trace.Enter(OpenTrace::kPlacement);
     retc = Quota::FileAccess(&acsargs);
 
     if (retc == EXDEV) {
@@ -1480,6 +1487,8 @@ XrdMgmOfsFile::open(const char* inpath,
       return Emsg(epname, error, retc, "open file ", path);
     }
   } else {
+    trace.Enter(OpenTrace::kNamespace);
+
     if (isRW) {
       if (isCreation && hasClientBookingSize && ((bookingsize == 0) ||
           ocUploadUuid.length())) {
@@ -1567,6 +1576,8 @@ XrdMgmOfsFile::open(const char* inpath,
   // ---------------------------------------------------------------------------
   // get the redirection host from the selected entry in the vector
   // ---------------------------------------------------------------------------
+  trace.Enter(OpenTrace::kRedirect);
+
   if (!selectedfs[fsIndex]) {
     eos_err("0 filesystem in selection");
     return Emsg(epname, error, ENONET, "received filesystem id 0", path);
@@ -1702,6 +1713,7 @@ XrdMgmOfsFile::open(const char* inpath,
 
   XrdOucString infolog = "";
   XrdOucString piolist = "";
+  trace.Enter(OpenTrace::kCapability);
 
   if ((eos::common::LayoutId::GetLayoutType(layoutId) ==
        eos::common::LayoutId::kReplica) ||
@@ -1803,6 +1815,7 @@ XrdMgmOfsFile::open(const char* inpath,
       plctargs.grouptag = containertag;
       plctargs.lid = plainLayoutId;
       plctargs.inode = (ino64_t) fmd->getId();
+      plctargs.cid = cid;
       plctargs.path = path;
       plctargs.plctTrgGeotag = &targetgeotag;
       plctargs.plctpolicy = plctplcy;
@@ -1817,7 +1830,9 @@ XrdMgmOfsFile::open(const char* inpath,
         return Emsg(epname, error, EIO, "open - invalid placement argument", path);
       }
 
+      trace.Enter(OpenTrace::kQuota);
       retc = Quota::FilePlacement(&plctargs);
+      trace.Enter(OpenTrace::kCapability);
 
       /// ###############
       if (eos::common::Logging::gLogMask & LOG_MASK(LOG_DEBUG)) {
@@ -2083,10 +2098,12 @@ XrdMgmOfsFile::open(const char* inpath,
   int caprc = 0;
 
   if ((caprc = gCapabilityEngine.Create(&incapability, capabilityenv, symkey,
-                                        gOFS->mCapabilityValidity))) {
+                                        gOFS->mCapabilityValidity,
+                                        gOFS->mCapabilityFormat))) {
     return Emsg(epname, error, caprc, "sign capability", path);
   }
 
+  trace.Enter(OpenTrace::kRedirect);
   int caplen = 0;
 
   if (isPio) {
@@ -2172,6 +2189,7 @@ XrdMgmOfsFile::open(const char* inpath,
   XrdOucString predirectionhost = redirectionhost.c_str();
   eos::common::StringConversion::MaskTag(predirectionhost, "cap.msg");
   eos::common::StringConversion::MaskTag(predirectionhost, "cap.sym");
+  eos::common::StringConversion::MaskTag(predirectionhost, "cap.bin");
 
   if (isRW) {
     eos_info("op=write path=%s info=%s %s redirection=%s:%d",
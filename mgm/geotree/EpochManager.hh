@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+// @file EpochManager.hh
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOSMGM_EPOCHMANAGER__H__
+#define __EOSMGM_EPOCHMANAGER__H__
+
+#include "mgm/Namespace.hh"
+#include <atomic>
+#include <thread>
+#include <stdint.h>
+
+EOSMGMNAMESPACE_BEGIN
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Epoch based reclamation for the double buffered fast structures.
+ *
+ * Readers announce the epoch they entered in a per-thread slot and never
+ * block. The writer publishes a new pointer and then calls synchronize()
+ * which returns once every reader that could have loaded the previous
+ * pointer has left its read-side section. After that, the previous buffer
+ * can be modified again without any reader looking at it.
+ *
+ * Slots are allocated once per thread, linked in a lock-free list and
+ * recycled when a thread exits. They are never freed.
+ */
+/*----------------------------------------------------------------------------*/
+class EpochManager
+{
+  struct Slot {
+    std::atomic<uint64_t> mEpoch; ///< Epoch entered, 0 when outside
+    std::atomic<bool> mInUse; ///< Slot owned by a live thread
+    unsigned mDepth; ///< Nesting depth, only touched by the owner
+    Slot* mNext; ///< Next slot in the list, immutable once linked
+
+    Slot(): mEpoch(0), mInUse(true), mDepth(0), mNext(nullptr) {}
+  };
+
+  //! Releases the slot of the current thread when it exits
+  struct SlotOwner {
+    Slot* mSlot;
+
+    SlotOwner(): mSlot(nullptr) {}
+
+    ~SlotOwner()
+    {
+      if (mSlot) {
+        mSlot->mEpoch.store(0, std::memory_order_release);
+        mSlot->mInUse.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  static std::atomic<uint64_t>& globalEpoch()
+  {
+    static std::atomic<uint64_t> sEpoch(1);
+    return sEpoch;
+  }
+
+  static std::atomic<Slot*>& slotList()
+  {
+    static std::atomic<Slot*> sHead(nullptr);
+    return sHead;
+  }
+
+  static Slot* getSlot()
+  {
+    static thread_local SlotOwner tlOwner;
+
+    if (tlOwner.mSlot) {
+      return tlOwner.mSlot;
+    }
+
+    // try to recycle the slot of a finished thread
+    for (Slot* s = slotList().load(std::memory_order_acquire); s; s = s->mNext) {
+      bool inuse = false;
+
+      if (!s->mInUse.load(std::memory_order_relaxed) &&
+          s->mInUse.compare_exchange_strong(inuse, true)) {
+        s->mDepth = 0;
+        tlOwner.mSlot = s;
+        return s;
+      }
+    }
+
+    Slot* s = new Slot();
+    Slot* head = slotList().load(std::memory_order_relaxed);
+
+    do {
+      s->mNext = head;
+    } while (!slotList().compare_exchange_weak(head, s, std::memory_order_release,
+             std::memory_order_relaxed));
+
+    tlOwner.mSlot = s;
+    return s;
+  }
+
+public:
+  /// Enter a read-side section, can be nested
+  static void enter()
+  {
+    Slot* s = getSlot();
+
+    if (s->mDepth++ == 0) {
+      s->mEpoch.store(globalEpoch().load(std::memory_order_acquire),
+                      std::memory_order_relaxed);
+      // the announcement must be visible before any pointer is loaded
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  /// Leave a read-side section
+  static void leave()
+  {
+    Slot* s = getSlot();
+
+    if (--s->mDepth == 0) {
+      s->mEpoch.store(0, std::memory_order_release);
+    }
+  }
+
+  /// Wait until all the readers which entered before this call have left.
+  /// The pointer to retire must have been replaced before calling this.
+  static void synchronize()
+  {
+    uint64_t target = globalEpoch().fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (Slot* s = slotList().load(std::memory_order_acquire); s; s = s->mNext) {
+      uint64_t epoch;
+
+      while ((epoch = s->mEpoch.load(std::memory_order_acquire)) &&
+             epoch < target) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /// Scoped read-side section
+  class ReadGuard
+  {
+  public:
+    ReadGuard()
+    {
+      EpochManager::enter();
+    }
+
+    ~ReadGuard()
+    {
+      EpochManager::leave();
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+  };
+};
+
+EOSMGMNAMESPACE_END
+
+#endif /* __EOSMGM_EPOCHMANAGER__H__ */
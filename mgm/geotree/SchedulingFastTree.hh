@@ -1306,15 +1306,25 @@ protected:
       eos_static_debug(ss.str().c_str());
     }
 
-    int weightSum = 0;
+    // gather the weights in a single pass as prefix sums, the visited
+    // branches have a null weight so that they are never selected
+    const size_t nBranches = brchEndIdx - brchBegIdx;
+    int localSums[256];
+    std::vector<int> heapSums;
+    int* prefixSums = localSums;
 
-    for (tFastTreeIdx i = brchBegIdx; i < brchEndIdx; i++) {
-      tFastTreeIdx nodeIdx = pBranches[i].sonIdx;
+    if (nBranches > sizeof(localSums) / sizeof(localSums[0])) {
+      heapSums.resize(nBranches);
+      prefixSums = &heapSums[0];
+    }
 
-      if (!visitedNode[nodeIdx]) {
-        const FastTreeNode& node = pNodes[pBranches[i].sonIdx];
-        weightSum += pRandVar(node.fsData, node.fileData);
-      }
+    int weightSum = 0;
+
+    for (size_t k = 0; k < nBranches; k++) {
+      const tFastTreeIdx nodeIdx = pBranches[brchBegIdx + k].sonIdx;
+      const FastTreeNode& node = pNodes[nodeIdx];
+      weightSum += visitedNode[nodeIdx] ? 0 : pRandVar(node.fsData, node.fileData);
+      prefixSums[k] = weightSum;
     }
 
     if (weightSum == 0) {
@@ -1323,24 +1333,11 @@ protected:
 
     int r = rand();
     r = r % (weightSum);
-    tFastTreeIdx i = 0;
-
-    for (weightSum = 0, i = brchBegIdx; i < brchEndIdx; i++) {
-      tFastTreeIdx nodeIdx = pBranches[i].sonIdx;
-
-      if (!visitedNode[nodeIdx]) {
-        const FastTreeNode& node = pNodes[pBranches[i].sonIdx];
-        weightSum += pRandVar(node.fsData, node.fileData);
-
-        if (weightSum > r) {
-          break;
-        }
-      }
-    }
-
+    size_t k = std::upper_bound(prefixSums, prefixSums + nBranches, r) -
+               prefixSums;
     __EOSMGM_TREECOMMON_CHK1__
-    assert(i < brchEndIdx);
-    *output = pBranches[i].sonIdx;
+    assert(k < nBranches);
+    *output = pBranches[brchBegIdx + k].sonIdx;
     return true;
   }
 
@@ -1787,6 +1784,12 @@ public:
     return pNodeCount;
   }
 
+  inline const FastTreeNode&
+  getNode(const tFastTreeIdx& node) const
+  {
+    return pNodes[node];
+  }
+
   inline bool
   findFreeSlotsMultiple(std::vector<tFastTreeIdx>& idxs, tFastTreeIdx nReplicas,
                         tFastTreeIdx startFrom = 0, bool allowUpRoot = false)
@@ -0,0 +1,632 @@
+//------------------------------------------------------------------------------
+// @file SchedulingTreeBench.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @brief Benchmarks of the scheduling fast structures
+//!
+//! - swap: placement throughput of the double buffered fast trees when the
+//!   foreground is protected by the RWMutex or published through epochs
+//!   while an updater keeps swapping the buffers as the GeoTreeEngine does.
+//! - scoring: placement and access rate of the tree walk compared to the
+//!   weighted pick in the structure of arrays of the leaves.
+//------------------------------------------------------------------------------
+
+#include "mgm/geotree/SchedulingSlowTree.hh"
+#include "mgm/geotree/EpochManager.hh"
+#include "common/Logging.hh"
+#include "common/RWMutex.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace eos::mgm;
+
+// large enough for a tree with the maximum number of nodes
+const size_t bufferSize = 1 << 22;
+const size_t nReplicas = 3;
+
+//------------------------------------------------------------------------------
+//! Structure of arrays holding the state of the leaves of a fast tree. Leaves
+//! are filtered 16 at a time with SSE2 on the status bits, the free slots and
+//! the score, and one of them is picked by weighted random sampling on the
+//! prefix sums of the scores. The weights are the ones of the tree walk
+//! (dlScore for placement, ulScore for access) but the geotag spreading is
+//! ignored.
+//! This is a measurement aid only: placeNewReplicas and accessReplicas keep
+//! walking the FastTree, which spreads the replicas over the geotags and
+//! balances the free slots branch by branch.
+//------------------------------------------------------------------------------
+class BenchLeafScores : public SchedTreeBase
+{
+public:
+  enum tScoreType { DlScore, UlScore };
+
+  BenchLeafScores() : pCount(0), pFiltered(false), pRequired(0),
+    pForbidden(0), pType(DlScore), pMinScore(0)
+  {}
+
+  inline void
+  clear()
+  {
+    pCount = 0;
+    pFiltered = false;
+    pNodeIdx.clear();
+    pStatus.clear();
+    pDlScore.clear();
+    pUlScore.clear();
+    pFreeSlots.clear();
+  }
+
+  inline void
+  push(tFastTreeIdx node, int16_t status, char dlScore, char ulScore,
+       unsigned char freeSlots)
+  {
+    if (pStatus.size() != pCount) {
+      // drop the padding added by a previous pick
+      pStatus.resize(pCount);
+      pDlScore.resize(pCount);
+      pUlScore.resize(pCount);
+      pFreeSlots.resize(pCount);
+    }
+
+    pFiltered = false;
+    pNodeIdx.push_back(node);
+    pStatus.push_back(status);
+    pDlScore.push_back(dlScore);
+    pUlScore.push_back(ulScore);
+    pFreeSlots.push_back(freeSlots);
+    pCount++;
+  }
+
+  inline size_t
+  size() const
+  {
+    return pCount;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Pick an eligible leaf by weighted random sampling. A leaf is eligible if
+  //! it has all the required status bits, none of the forbidden ones, a free
+  //! slot and a score of at least minScore. The free slot of the picked leaf
+  //! is consumed so that calling this again picks another leaf. Consecutive
+  //! picks with the same criteria reuse the filtered weights.
+  //!
+  //! @return true if a leaf was picked, false if none is eligible
+  //----------------------------------------------------------------------------
+  inline bool
+  pickWeighted(int16_t required, int16_t forbidden, tScoreType type,
+               char minScore, tFastTreeIdx& node)
+  {
+    if (!pFiltered || required != pRequired || forbidden != pForbidden ||
+        type != pType || minScore != pMinScore) {
+      filter(required, forbidden, type, minScore);
+    }
+
+    const int sum = pCount ? pPrefixSums[pCount - 1] : 0;
+
+    if (!sum) {
+      return false;
+    }
+
+    int r = rand() % sum;
+    size_t k = std::upper_bound(pPrefixSums.begin(), pPrefixSums.end(), r) -
+               pPrefixSums.begin();
+    node = pNodeIdx[k];
+
+    if (!--pFreeSlots[k]) {
+      // the leaf is no more eligible, remove its weight from the sums
+      const int w = (unsigned char) pWeights[k];
+      pWeights[k] = 0;
+
+      for (size_t i = k; i < pCount; i++) {
+        pPrefixSums[i] -= w;
+      }
+    }
+
+    return true;
+  }
+
+protected:
+  //----------------------------------------------------------------------------
+  //! Compute the weights of the leaves and their prefix sums
+  //----------------------------------------------------------------------------
+  inline void
+  filter(int16_t required, int16_t forbidden, tScoreType type, char minScore)
+  {
+    // pad to a full vector with leaves that are never eligible
+    const size_t padded = (pCount + 15) & ~((size_t)15);
+    pStatus.resize(padded, 0);
+    pDlScore.resize(padded, 0);
+    pUlScore.resize(padded, 0);
+    pFreeSlots.resize(padded, 0);
+    pWeights.resize(padded);
+    pPrefixSums.resize(pCount);
+    const char* score = (type == DlScore) ? &pDlScore[0] : &pUlScore[0];
+    // a weight of 0 is never picked so the score has to be positive too
+    const char minWeight = std::max(minScore, (char)1);
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i vreq = _mm_set1_epi16(required);
+    const __m128i vforb = _mm_set1_epi16(forbidden);
+    const __m128i vzero = _mm_setzero_si128();
+    const __m128i vmin = _mm_set1_epi8(minWeight - 1);
+
+    for (; i < padded; i += 16) {
+      __m128i st0 = _mm_loadu_si128((const __m128i*)&pStatus[i]);
+      __m128i st1 = _mm_loadu_si128((const __m128i*)&pStatus[i + 8]);
+      __m128i ok0 = _mm_and_si128(
+                      _mm_cmpeq_epi16(_mm_and_si128(st0, vreq), vreq),
+                      _mm_cmpeq_epi16(_mm_and_si128(st0, vforb), vzero));
+      __m128i ok1 = _mm_and_si128(
+                      _mm_cmpeq_epi16(_mm_and_si128(st1, vreq), vreq),
+                      _mm_cmpeq_epi16(_mm_and_si128(st1, vforb), vzero));
+      // 16 bit masks (0 or -1) narrowed to 8 bit masks
+      __m128i ok = _mm_packs_epi16(ok0, ok1);
+      __m128i slots = _mm_loadu_si128((const __m128i*)&pFreeSlots[i]);
+      ok = _mm_andnot_si128(_mm_cmpeq_epi8(slots, vzero), ok);
+      __m128i sc = _mm_loadu_si128((const __m128i*)&score[i]);
+      ok = _mm_and_si128(_mm_cmpgt_epi8(sc, vmin), ok);
+      _mm_storeu_si128((__m128i*)&pWeights[i], _mm_and_si128(sc, ok));
+    }
+
+#else
+
+    for (; i < padded; i++) {
+      bool ok = ((pStatus[i] & required) == required) &&
+                !(pStatus[i] & forbidden) && pFreeSlots[i] &&
+                (score[i] >= minWeight);
+      pWeights[i] = ok ? score[i] : 0;
+    }
+
+#endif
+    int sum = 0;
+
+    for (i = 0; i < pCount; i++) {
+      sum += (unsigned char) pWeights[i];
+      pPrefixSums[i] = sum;
+    }
+
+    pFiltered = true;
+    pRequired = required;
+    pForbidden = forbidden;
+    pType = type;
+    pMinScore = minScore;
+  }
+
+  size_t pCount;
+  std::vector<tFastTreeIdx> pNodeIdx;
+  std::vector<int16_t> pStatus;
+  std::vector<char> pDlScore;
+  std::vector<char> pUlScore;
+  std::vector<unsigned char> pFreeSlots;
+  std::vector<char> pWeights;
+  std::vector<int> pPrefixSums;
+  bool pFiltered;
+  int16_t pRequired;
+  int16_t pForbidden;
+  tScoreType pType;
+  char pMinScore;
+};
+
+//------------------------------------------------------------------------------
+//! Fill the leaf scores with the fs leaves of a fast tree
+//------------------------------------------------------------------------------
+template<typename Tree>
+static void
+FillLeafScores(const Tree& tree, const SchedTreeBase::FastTreeInfo& treeInfo,
+               BenchLeafScores& leaves)
+{
+  leaves.clear();
+
+  for (SchedTreeBase::tFastTreeIdx i = 0; i < tree.getNodeCount(); i++) {
+    const typename Tree::FastTreeNode& node = tree.getNode(i);
+
+    if (node.treeData.childrenCount ||
+        treeInfo[i].nodeType != SchedTreeBase::TreeNodeInfo::fs) {
+      continue;
+    }
+
+    leaves.push(i, node.fsData.mStatus, node.fsData.dlScore,
+                node.fsData.ulScore, node.fileData.freeSlotsCount);
+  }
+}
+
+//------------------------------------------------------------------------------
+//! The fast structures of one buffer of a scheduling group
+//------------------------------------------------------------------------------
+struct BenchFastStruct {
+  FastPlacementTree placementTree;
+  FastROAccessTree rOAccessTree;
+  FastRWAccessTree rWAccessTree;
+  FastBalancingPlacementTree blcPlacementTree;
+  FastBalancingAccessTree blcAccessTree;
+  FastDrainingPlacementTree drnPlacementTree;
+  FastDrainingAccessTree drnAccessTree;
+  SchedTreeBase::FastTreeInfo treeInfo;
+  Fs2TreeIdxMap fs2TreeIdx;
+  GeoTag2NodeIdxMap tag2NodeIdx;
+  BenchLeafScores placementLeaves;
+
+  bool build(const SlowTree& tree)
+  {
+    size_t n = tree.getNodeCount();
+    placementTree.selfAllocate(n);
+    rOAccessTree.selfAllocate(n);
+    rWAccessTree.selfAllocate(n);
+    blcPlacementTree.selfAllocate(n);
+    blcAccessTree.selfAllocate(n);
+    drnPlacementTree.selfAllocate(n);
+    drnAccessTree.selfAllocate(n);
+
+    if (!tree.buildFastStrcturesSched(&placementTree, &rOAccessTree,
+                                      &rWAccessTree, &blcPlacementTree,
+                                      &blcAccessTree, &drnPlacementTree,
+                                      &drnAccessTree, &treeInfo, &fs2TreeIdx,
+                                      &tag2NodeIdx)) {
+      return false;
+    }
+
+    FillLeafScores(placementTree, treeInfo, placementLeaves);
+    return true;
+  }
+};
+
+//------------------------------------------------------------------------------
+//! A scheduling group with its double buffer
+//------------------------------------------------------------------------------
+struct BenchGroup {
+  SlowTree slowTree;
+  BenchFastStruct fastStructures[2];
+  BenchFastStruct* foreground;
+  BenchFastStruct* background;
+  eos::common::RWMutex doubleBufferMutex;
+  vector<eos::common::FileSystem::fsid_t> fsIds;
+
+  BenchGroup(): foreground(fastStructures), background(fastStructures + 1)
+  {
+    doubleBufferMutex.SetBlocking(true);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Fill a scheduling group with synthetic filesystems spread over sites, racks
+// and hosts
+//------------------------------------------------------------------------------
+static bool
+PopulateGroup(BenchGroup& group, size_t groupIdx, size_t groupSize)
+{
+  ostringstream name;
+  name << groupIdx;
+  group.slowTree.setName(name.str());
+
+  for (size_t i = 0; i < groupSize; i++) {
+    ostringstream host, geotag;
+    host << "fst" << std::setw(4) << std::setfill('0') << i << ".cern.ch";
+    geotag << "site" << (i % 2) << "::rack" << (i % 8) << "::" << host.str();
+    SchedTreeBase::TreeNodeInfo info;
+    info.geotag = geotag.str();
+    info.host = host.str();
+    info.fsId = (eos::common::FileSystem::fsid_t)(groupIdx * groupSize + i + 1);
+    SchedTreeBase::TreeNodeStateFloat state;
+    // scores are percentages, like in GeoTreeEngine::updateTreeInfo
+    state.dlScore = 20 + 80.0 * rand() / RAND_MAX;
+    state.ulScore = 20 + 80.0 * rand() / RAND_MAX;
+    state.mStatus = SchedTreeBase::Available | SchedTreeBase::Writable |
+                    SchedTreeBase::Readable;
+
+    if (!(i % 16)) {
+      state.mStatus |= SchedTreeBase::Disabled;
+    }
+
+    state.fillRatio = 0.5;
+    state.totalSpace = 2e12;
+
+    if (!group.slowTree.insert(&info, &state)) {
+      return false;
+    }
+
+    group.fsIds.push_back(info.fsId);
+  }
+
+  return group.fastStructures[0].build(group.slowTree) &&
+         group.fastStructures[1].build(group.slowTree);
+}
+
+//------------------------------------------------------------------------------
+// Place the replicas in a working copy of the foreground placement tree like
+// placeNewReplicasOneGroup
+//------------------------------------------------------------------------------
+static bool
+PlaceReplicas(BenchFastStruct* fg, char* buffer)
+{
+  if (fg->placementTree.copyToBuffer(buffer, bufferSize)) {
+    return false;
+  }
+
+  FastPlacementTree* tree = (FastPlacementTree*) buffer;
+
+  for (size_t k = 0; k < nReplicas; k++) {
+    SchedTreeBase::tFastTreeIdx idx;
+
+    if (!tree->findFreeSlot(idx)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Run one measurement
+//
+// @param useEpoch protect the foreground with epochs instead of the RWMutex
+//------------------------------------------------------------------------------
+static void
+RunBenchmark(vector<BenchGroup>& groups, bool useEpoch, size_t nThreads,
+             double duration, size_t swapIntervalUs)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> placements(0), failures(0), swaps(0);
+  std::atomic<uint64_t> swapNs(0);
+  vector<std::thread> readers;
+
+  for (size_t t = 0; t < nThreads; t++) {
+    readers.emplace_back([&, t]() {
+      vector<char> buffer(bufferSize);
+      uint64_t count = 0, failed = 0;
+
+      for (size_t i = t; !stop.load(std::memory_order_relaxed); i++) {
+        BenchGroup& group = groups[i % groups.size()];
+        bool ok;
+
+        if (useEpoch) {
+          EpochManager::ReadGuard guard;
+          ok = PlaceReplicas(__atomic_load_n(&group.foreground, __ATOMIC_ACQUIRE),
+                             buffer.data());
+        } else {
+          eos::common::RWMutexReadLock lock(group.doubleBufferMutex);
+          ok = PlaceReplicas(group.foreground, buffer.data());
+        }
+
+        if (ok) {
+          count++;
+        } else {
+          failed++;
+        }
+      }
+
+      placements += count;
+      failures += failed;
+    });
+  }
+
+  // the updater refreshes the background from the foreground and swaps
+  std::thread updater([&]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      for (auto& group : groups) {
+        BenchFastStruct* bg = group.background;
+        group.foreground->placementTree.copyToFastTree(&bg->placementTree);
+        bg->placementTree.updateTree();
+        auto start = std::chrono::steady_clock::now();
+
+        if (useEpoch) {
+          BenchFastStruct* fg = group.foreground;
+          __atomic_store_n(&group.foreground, bg, __ATOMIC_RELEASE);
+          group.background = fg;
+          EpochManager::synchronize();
+        } else {
+          eos::common::RWMutexWriteLock lock(group.doubleBufferMutex);
+          std::swap(group.foreground, group.background);
+        }
+
+        swapNs += std::chrono::duration_cast<std::chrono::nanoseconds>
+                  (std::chrono::steady_clock::now() - start).count();
+        swaps++;
+      }
+
+      std::this_thread::sleep_for(std::chrono::microseconds(swapIntervalUs));
+    }
+  });
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+  stop = true;
+  updater.join();
+
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  double elapsed = std::chrono::duration<double>
+                   (std::chrono::steady_clock::now() - start).count();
+  cout << std::left << std::setw(10) << (useEpoch ? "epoch" : "rwmutex")
+       << std::right << " threads=" << std::setw(3) << nThreads
+       << " placements/s=" << std::setw(12) << std::fixed << std::setprecision(0)
+       << placements / elapsed
+       << " failed=" << std::setw(8) << failures.load()
+       << " swaps=" << std::setw(8) << swaps.load()
+       << " avg_swap_us=" << std::setw(8) << std::setprecision(1)
+       << (swaps ? swapNs / 1000.0 / swaps : 0.0) << endl;
+}
+
+//------------------------------------------------------------------------------
+// Compare the tree walk and the leaf scores for placement and access
+//------------------------------------------------------------------------------
+static void
+RunScoringBenchmark(vector<BenchGroup>& groups, double duration)
+{
+  vector<char> buffer(bufferSize);
+  BenchLeafScores leaves;
+  const int16_t plctMask = SchedTreeBase::Available | SchedTreeBase::Writable;
+  const int16_t accessMask = SchedTreeBase::Available | SchedTreeBase::Readable;
+
+  for (int test = 0; test < 4; test++) {
+    const bool access = (test >= 2);
+    const bool soa = (test % 2);
+    uint64_t count = 0, failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast
+                    <std::chrono::steady_clock::duration>
+                    (std::chrono::duration<double>(duration));
+
+    while (std::chrono::steady_clock::now() < deadline) {
+      for (size_t i = 0; i < 1000; i++, count++) {
+        BenchGroup& group = groups[count % groups.size()];
+        BenchFastStruct* fg = group.foreground;
+        SchedTreeBase::tFastTreeIdx idx;
+        bool ok = true;
+
+        if (access) {
+          // the replicas of the file are the only free slots of the access tree
+          FastROAccessTree* tree = (FastROAccessTree*) buffer.data();
+          fg->rOAccessTree.copyToBuffer(buffer.data(), bufferSize);
+
+          for (size_t k = 0; k < nReplicas; k++) {
+            const SchedTreeBase::tFastTreeIdx* replica;
+
+            if (fg->fs2TreeIdx.get(group.fsIds[(count + k * 7) %
+                                               group.fsIds.size()], replica)) {
+              tree->incrementFreeSlot(*replica);
+            }
+          }
+
+          if (soa) {
+            FillLeafScores(*tree, fg->treeInfo, leaves);
+            ok = leaves.pickWeighted(accessMask, SchedTreeBase::Disabled,
+                                     BenchLeafScores::UlScore, 0, idx);
+          } else {
+            ok = tree->findFreeSlot(idx);
+          }
+        } else if (soa) {
+          // working copy of the leaves, like the copy of the placement tree
+          leaves = fg->placementLeaves;
+
+          for (size_t k = 0; ok && k < nReplicas; k++) {
+            ok = leaves.pickWeighted(plctMask, SchedTreeBase::Disabled,
+                                     BenchLeafScores::DlScore, 0, idx);
+          }
+        } else {
+          fg->placementTree.copyToBuffer(buffer.data(), bufferSize);
+
+          for (size_t k = 0; ok && k < nReplicas; k++) {
+            ok = ((FastPlacementTree*) buffer.data())->findFreeSlot(idx);
+          }
+        }
+
+        if (!ok) {
+          failed++;
+        }
+      }
+    }
+
+    double elapsed = std::chrono::duration<double>
+                     (std::chrono::steady_clock::now() - start).count();
+    cout << std::left << std::setw(10) << (access ? "access" : "placement")
+         << std::setw(12) << (soa ? "leafscores" : "treewalk") << std::right
+         << " ops/s=" << std::setw(12) << std::fixed << std::setprecision(0)
+         << count / elapsed << " failed=" << failed << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  size_t nGroups = 16;
+  size_t groupSize = 100;
+  size_t maxThreads = std::thread::hardware_concurrency();
+  double duration = 3;
+  size_t swapIntervalUs = 1000;
+  std::string mode = "all";
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--groups")) {
+      nGroups = strtoul(argv[i + 1], 0, 10);
+    } else if (!strcmp(argv[i], "--group-size")) {
+      groupSize = strtoul(argv[i + 1], 0, 10);
+    } else if (!strcmp(argv[i], "--threads")) {
+      maxThreads = strtoul(argv[i + 1], 0, 10);
+    } else if (!strcmp(argv[i], "--seconds")) {
+      duration = atof(argv[i + 1]);
+    } else if (!strcmp(argv[i], "--swap-interval-us")) {
+      swapIntervalUs = strtoul(argv[i + 1], 0, 10);
+    } else if (!strcmp(argv[i], "--mode")) {
+      mode = argv[i + 1];
+    } else {
+      cerr << "usage: " << argv[0] << " [--mode swap|scoring|all] [--groups <n>] "
+           "[--group-size <n>] [--threads <max>] [--seconds <s>] "
+           "[--swap-interval-us <us>]" << endl;
+      return EINVAL;
+    }
+  }
+
+  if (!nGroups || !groupSize || !maxThreads || duration <= 0 ||
+      (mode != "swap" && mode != "scoring" && mode != "all")) {
+    cerr << "error: invalid arguments" << endl;
+    return EINVAL;
+  }
+
+  eos::common::Logging::Init();
+  eos::common::Logging::SetUnit("SchedulingTreeBench");
+  eos::common::Logging::SetLogPriority(LOG_ERR);
+  SchedTreeBase::gSettings.checkLevel = 0;
+  SchedTreeBase::gSettings.debugLevel = 0;
+  vector<BenchGroup> groups(nGroups);
+
+  for (size_t i = 0; i < nGroups; i++) {
+    if (!PopulateGroup(groups[i], i, groupSize)) {
+      cerr << "error: failed to build scheduling group " << i << endl;
+      return EIO;
+    }
+  }
+
+  cout << "groups=" << nGroups << " group_size=" << groupSize
+       << " replicas=" << nReplicas << " swap_interval_us=" << swapIntervalUs
+       << endl;
+
+  if (mode != "scoring") {
+    for (size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+      RunBenchmark(groups, false, nThreads, duration, swapIntervalUs);
+      RunBenchmark(groups, true, nThreads, duration, swapIntervalUs);
+    }
+  }
+
+  if (mode != "swap") {
+    RunScoringBenchmark(groups, duration);
+  }
+
+  return 0;
+}
@@ -301,6 +301,14 @@ S3Store::ListBucket(const std::string& bucket, const std::string& query)
     lPrefix += "/";
   }
 
+  if (!marker_found && (marker.length() > lPrefix.length()) &&
+      (marker.compare(0, lPrefix.length(), lPrefix) == 0) &&
+      (marker.find('/', lPrefix.length()) == std::string::npos)) {
+    // The listing is in name order so it can start right after the marker
+    bucketdir.SetListingMarker(marker.substr(lPrefix.length()));
+    marker_found = true;
+  }
+
   int listrc = bucketdir.open((mS3ContainerPath[bucket] + lPrefix).c_str(),
                               vid, (const char*) 0);
 
@@ -367,6 +367,11 @@ ProcCommand::Access()
   }
 
   if (mSubCmd == "set") {
+    // resolve the name of a rate rule before locking, this may be slow
+    if (stall.length() && (type.find("rate:") == 0)) {
+      Access::gRateLimiter.Resolve(type);
+    }
+
     eos::common::RWMutexWriteLock lock(Access::gAccessMutex);
 
     if (redirect.length() && ((type.length() == 0) || (type == "r") ||
@@ -25,6 +25,7 @@
 #include "mgm/ProcInterface.hh"
 #include "mgm/XrdMgmOfs.hh"
 #include "mgm/Quota.hh"
+#include "mgm/OpenTrace.hh"
 #include "common/LinuxMemConsumption.hh"
 #include "namespace/interface/IChLogFileMDSvc.hh"
 #include "namespace/interface/IChLogContainerMDSvc.hh"
@@ -160,6 +161,43 @@ ProcCommand::Ns()
 
 #endif
 
+  if (mSubCmd == "latency") {
+    XrdOucString option = pOpaque->Get("mgm.option");
+    XrdOucString threshold = pOpaque->Get("mgm.ns.latency.threshold");
+    mDoSort = false;
+
+    if ((option.find("r") != STR_NPOS) || threshold.length()) {
+      if (pVid->uid) {
+        retc = EPERM;
+        stdErr = "error: you have to take role 'root' to execute this command";
+        return SFS_OK;
+      }
+
+      if (option.find("r") != STR_NPOS) {
+        OpenTrace::Reset();
+        stdOut += "success: open latency histograms have been reset\n";
+      }
+
+      if (threshold.length()) {
+        OpenTrace::SetSlowThreshold(strtoull(threshold.c_str(), 0, 10));
+        stdOut += "success: slow open threshold set to ";
+        stdOut += (int) OpenTrace::GetSlowThreshold();
+        stdOut += " ms\n";
+      }
+    }
+
+    OpenTrace::PrintOut(stdOut, option.find("m") != STR_NPOS,
+                        option.find("a") != STR_NPOS);
+    return SFS_OK;
+  }
+
+  if (mSubCmd == "workflow") {
+    XrdOucString option = pOpaque->Get("mgm.option");
+    mDoSort = false;
+    gOFS->WFEd.GetQueue().PrintOut(stdOut, option.find("m") != STR_NPOS);
+    return SFS_OK;
+  }
+
   if ((mSubCmd != "mutex") && (mSubCmd != "compact")) {
     XrdOucString option = pOpaque->Get("mgm.option");
     bool details = false;
@@ -189,6 +227,10 @@ ProcCommand::Ns()
     sprintf(files, "%llu", f);
     char dirs[1024];
     sprintf(dirs, "%llu", d);
+    // one metric per line of the connections to the namespace backend
+    std::vector<std::string> backend_stats;
+    eos::common::StringConversion::Tokenize(
+      gOFS->eosFileService->getBackendStats(), backend_stats, "\n");
     // stat the size of the changelog files
     struct stat statf;
     struct stat statd;
@@ -359,6 +401,19 @@ ProcCommand::Ns()
       stdOut += "ALL      uptime                           ";
       stdOut += (int)(time(NULL) - gOFS->StartTime);
       stdOut += "\n";
+
+      for (auto it = backend_stats.begin(); it != backend_stats.end(); ++it) {
+        size_t pos = it->find('=');
+
+        if (pos == std::string::npos) {
+          continue;
+        }
+
+        char line[1024];
+        snprintf(line, sizeof(line), "ALL      %-32s %s\n",
+                 it->substr(0, pos).c_str(), it->c_str() + pos + 1);
+        stdOut += line;
+      }
       stdOut += "# ------------------------------------------------------------------------------------\n";
     } else {
       stdOut += "uid=all gid=all ns.total.files=";
@@ -445,6 +500,12 @@ ProcCommand::Ns()
       stdOut += "uid=all gid=all ns.uptime=";
       stdOut += (int)(time(NULL) - gOFS->StartTime);
       stdOut += "\n";
+
+      for (auto it = backend_stats.begin(); it != backend_stats.end(); ++it) {
+        stdOut += "uid=all gid=all ns.";
+        stdOut += it->c_str();
+        stdOut += "\n";
+      }
     }
 
     if (mSubCmd == "stat") {
@@ -517,13 +517,18 @@ ProcCommand::Space()
                 (key == "balancer.node.ntx") ||
                 (key == "drainer.node.rate") ||
                 (key == "drainer.node.ntx") ||
+                (key == "drainer.fs.ntx") ||
+                (key == "drainer.central") ||
                 (key == "converter") ||
                 (key == "lru") ||
                 (key == "lru.interval") ||
                 (key == "wfe") ||
                 (key == "wfe.interval") ||
                 (key == "wfe.ntx") ||
+                (key == "wfe.workflow.ntx") ||
+                (key == "wfe.export") ||
                 (key == "converter.ntx") ||
+                (key == "converter.rate") ||
                 (key == "autorepair") ||
                 (key == "groupbalancer") ||
                 (key == "groupbalancer.ntx") ||
@@ -536,6 +541,8 @@ ProcCommand::Space()
                 (key == "balancer.threshold")) {
               if ((key == "balancer") || (key == "converter") ||
                   (key == "autorepair") || (key == "lru") || (key == "wfe") ||
+                  (key == "wfe.export") ||
+                  (key == "drainer.central") ||
                   (key == "groupbalancer") || (key == "geobalancer") ||
                   (key == "geo.access.policy.read.exact") ||
                   (key == "geo.access.policy.write.exact")) {
@@ -564,6 +571,22 @@ ProcCommand::Space()
                       }
                     }
 
+                    if (key == "wfe.export") {
+                      if (value == "on") {
+                        stdOut += "success: workflow jobs are exported to the proc directory!";
+                      } else {
+                        stdOut += "success: workflow jobs are not exported to the proc directory!";
+                      }
+                    }
+
+                    if (key == "drainer.central") {
+                      if (value == "on") {
+                        stdOut += "success: central drain scheduling is enabled!";
+                      } else {
+                        stdOut += "success: central drain scheduling is disabled!";
+                      }
+                    }
+
                     if (key == "autorepair") {
                       if (value == "on") {
                         stdOut += "success: auto-repair is enabled!";
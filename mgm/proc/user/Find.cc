@@ -27,6 +27,7 @@
 #include "mgm/Access.hh"
 #include "mgm/Macros.hh"
 #include "mgm/Acl.hh"
+#include "mgm/FindEngine.hh"
 #include "common/LayoutId.hh"
 /*----------------------------------------------------------------------------*/
 
@@ -52,10 +53,10 @@ ProcCommand::Find()
   XrdOucString key = attribute;
   XrdOucString val = attribute;
   XrdOucString printkey = pOpaque->Get("mgm.find.printkey");
+  XrdOucString minsize = pOpaque->Get("mgm.find.minsize");
+  XrdOucString maxsize = pOpaque->Get("mgm.find.maxsize");
+  XrdOucString layout = pOpaque->Get("mgm.find.layout");
   const char* inpath = spath.c_str();
-  bool deepquery = false;
-  static XrdSysMutex deepQueryMutex;
-  static std::map<std::string, std::set<std::string> >* globalfound = 0;
   NAMESPACEMAP;
   PROC_BOUNCE_ILLEGAL_NAMES;
   PROC_BOUNCE_NOT_ALLOWED;
@@ -67,18 +68,6 @@ ProcCommand::Find()
     return SFS_OK;
   }
 
-  eos::common::Path cPath(spath.c_str());
-
-  if (cPath.GetSubPathSize() < 5) {
-    if ((((option.find("d")) != STR_NPOS) && ((option.find("f")) == STR_NPOS))) {
-      // directory queries are fine even for the complete namespace
-      deepquery = false;
-    } else {
-      // deep queries are serialized by a mutex and use a single the output hashmap !
-      deepquery = true;
-    }
-  }
-
   // this hash is used to calculate the balance of the found files over the filesystems involved
   google::dense_hash_map<unsigned long, unsigned long long> filesystembalance;
   google::dense_hash_map<std::string, unsigned long long> spacebalance;
@@ -257,25 +246,30 @@ ProcCommand::Find()
     finddepth = atoi(maxdepth.c_str());
   }
 
-  if (!spath.length()) {
-    fprintf(fstderr, "error: you have to give a path name to call 'find'");
-    retc = EINVAL;
-  } else {
-    std::map<std::string, std::set<std::string> >* found = 0;
+  int findlayout = -1;
 
-    if (deepquery) {
-      // we use a single once allocated map for deep searches to store the results to avoid memory explosion
-      deepQueryMutex.Lock();
-
-      if (!globalfound) {
-        globalfound = new std::map<std::string, std::set<std::string> >;
+  if (layout.length()) {
+    for (int type = eos::common::LayoutId::kPlain;
+         type <= eos::common::LayoutId::kRaid6; type++) {
+      if (layout == eos::common::LayoutId::GetLayoutTypeString(
+            eos::common::LayoutId::GetId(type))) {
+        findlayout = type;
       }
+    }
 
-      found = globalfound;
-    } else {
-      found = new std::map<std::string, std::set<std::string> >;
+    if (findlayout < 0) {
+      fprintf(fstderr, "error: unknown layout type '%s'", layout.c_str());
+      retc = EINVAL;
+      return SFS_OK;
     }
+  }
 
+  if (!spath.length()) {
+    fprintf(fstderr, "error: you have to give a path name to call 'find'");
+    retc = EINVAL;
+  } else {
+    // the results of one chunk of the find
+    std::map<std::string, std::set<std::string> > found;
     std::map<std::string, std::set<std::string> >::const_iterator foundit;
     std::set<std::string>::const_iterator fileit;
     bool nofiles = false;
@@ -293,13 +287,6 @@ ProcCommand::Find()
       stdErr += "'";
       fprintf(fstderr, "%s", stdErr.c_str());
       retc = errno;
-
-      if (deepquery) {
-        deepQueryMutex.UnLock();
-      } else {
-        delete found;
-      }
-
       return SFS_OK;
     } else {
       if (file_exists == XrdSfsFileExistIsFile) {
@@ -311,44 +298,41 @@ ProcCommand::Find()
         stdErr += "error: no such file or directory";
         fprintf(fstderr, "%s", stdErr.c_str());
         retc = ENOENT;
-
-        if (deepquery) {
-          deepQueryMutex.UnLock();
-        } else {
-          delete found;
-        }
-
         return SFS_OK;
       }
     }
 
-    if (gOFS->_find(spath.c_str(), *mError, stdErr, *pVid, (*found),
-                    key.c_str(), val.c_str(), nofiles, 0, true, finddepth,
-                    filematch.length() ? filematch.c_str() : 0)) {
-      fprintf(fstderr, "%s", stdErr.c_str());
-      fprintf(fstderr, "error: unable to run find in directory");
-      retc = errno;
-
-      if (deepquery) {
-        deepQueryMutex.UnLock();
-      } else {
-        delete found;
-      }
-
-      return SFS_OK;
-    } else {
-      if (stdErr.length()) {
-        fprintf(fstderr, "%s", stdErr.c_str());
-        retc = E2BIG;
-      }
-    }
-
     int cnt = 0;
     unsigned long long filecounter = 0;
     unsigned long long dircounter = 0;
+    FindEngine::Options findoptions;
+    findoptions.mNoFiles = nofiles;
+    findoptions.mMaxDepth = finddepth;
+    findoptions.mFileMatch = filematch.length() ? filematch.c_str() : "";
+    findoptions.mAttrKey = key.length() ? key.c_str() : "";
+    findoptions.mAttrVal = val.length() ? val.c_str() : "";
+    findoptions.mMinSize = minsize.length() ? strtoull(minsize.c_str(), 0, 10) : 0;
+    findoptions.mMaxSize = maxsize.length() ? strtoull(maxsize.c_str(), 0, 10) : 0;
+    findoptions.mMinMTime = selectyoungertime;
+    findoptions.mMaxMTime = selectoldertime;
+    findoptions.mLayoutType = findlayout;
+    FindEngine engine(spath.c_str(), findoptions, *pVid);
+    FindEngine::Chunk chunk;
+    gOFS->MgmStats.Add("Find", pVid->uid, pVid->gid, 1);
+    EXEC_TIMING_BEGIN("Find");
+    engine.Start();
+
+    // the results are streamed chunk by chunk, each directory comes with all
+    // its files in a single chunk
+    while (engine.Next(chunk)) {
+      found.clear();
+
+      for (auto dit = chunk.begin(); dit != chunk.end(); ++dit) {
+        found[dit->mPath].insert(dit->mFiles.begin(), dit->mFiles.end());
+      }
 
     if (((option.find("f")) != STR_NPOS) || ((option.find("d")) == STR_NPOS)) {
-      for (foundit = (*found).begin(); foundit != (*found).end(); foundit++) {
+      for (foundit = found.begin(); foundit != found.end(); foundit++) {
         if ((option.find("d")) == STR_NPOS) {
           if (option.find("f") == STR_NPOS) {
             if (!printcounter) {
@@ -796,13 +780,12 @@ ProcCommand::Find()
         }
       }
 
-      gOFS->MgmStats.Add("FindEntries", pVid->uid, pVid->gid, cnt);
     }
 
     eos_debug("Listing directories");
 
     if ((option.find("d")) != STR_NPOS) {
-      for (foundit = (*found).begin(); foundit != (*found).end(); foundit++) {
+      for (foundit = found.begin(); foundit != found.end(); foundit++) {
         // eventually call the version purge function if we own this version dir or we are root
         if (purge &&
             (foundit->first.find(EOS_COMMON_PATH_VERSION_PREFIX) != std::string::npos)) {
@@ -932,16 +915,19 @@ ProcCommand::Find()
             fprintf(fstdout, "\n");
           }
         }
-      }
 
-      dircounter++;
+        dircounter++;
+      }
+    }
     }
 
-    if (deepquery) {
-      globalfound->clear();
-      deepQueryMutex.UnLock();
-    } else {
-      delete found;
+    EXEC_TIMING_END("Find");
+    gOFS->MgmStats.Add("FindEntries", pVid->uid, pVid->gid, cnt);
+    stdErr += engine.GetStdErr().c_str();
+
+    if (stdErr.length()) {
+      fprintf(fstderr, "%s", stdErr.c_str());
+      retc = E2BIG;
     }
 
     if (printcounter) {
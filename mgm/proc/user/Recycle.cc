@@ -41,8 +41,12 @@ ProcCommand::Recycle ()
     XrdOucString monitoring = pOpaque->Get("mgm.recycle.format");
     XrdOucString translateids = pOpaque->Get("mgm.recycle.printid");
     XrdOucString option = pOpaque->Get("mgm.option");
+    XrdOucString offset = pOpaque->Get("mgm.recycle.offset");
+    XrdOucString limit = pOpaque->Get("mgm.recycle.limit");
 
-    Recycle::Print(stdOut, stdErr, *pVid, (monitoring == "m"), !(translateids == "n"), (mSubCmd == "ls"));
+    Recycle::Print(stdOut, stdErr, *pVid, (monitoring == "m"), !(translateids == "n"), (mSubCmd == "ls"),
+                   offset.length() ? strtoull(offset.c_str(), 0, 10) : 0,
+                   limit.length() ? strtoull(limit.c_str(), 0, 10) : 0);
   }
 
   if (mSubCmd == "purge")
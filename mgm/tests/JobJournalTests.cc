@@ -0,0 +1,168 @@
+//------------------------------------------------------------------------------
+// File: JobJournalTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/JobJournal.hh"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using eos::mgm::JobJournal;
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Fixture with a journal path in a temporary directory
+//------------------------------------------------------------------------------
+class JobJournalTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char dir[] = "/tmp/eos-jobjournal-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    mDir = dir;
+    mPath = mDir + "/test.journal";
+  }
+
+  void TearDown() override
+  {
+    unlink(mPath.c_str());
+    unlink((mPath + ".tmp").c_str());
+    rmdir(mDir.c_str());
+  }
+
+  //----------------------------------------------------------------------------
+  // Replay the journal with a new instance
+  //----------------------------------------------------------------------------
+  std::vector<std::string> Replay()
+  {
+    std::vector<std::string> lines;
+    JobJournal journal("test");
+    journal.Read(mPath, [&lines](const std::string & line) {
+      lines.push_back(line);
+    });
+    return lines;
+  }
+
+  //----------------------------------------------------------------------------
+  // Get the size of the journal file
+  //----------------------------------------------------------------------------
+  off_t Size()
+  {
+    struct stat buf;
+    return (stat(mPath.c_str(), &buf) ? -1 : buf.st_size);
+  }
+
+  std::string mDir;
+  std::string mPath;
+};
+}
+
+//------------------------------------------------------------------------------
+// The lines appended after opening the journal are replayed in order
+//------------------------------------------------------------------------------
+TEST_F(JobJournalTest, AppendReplay)
+{
+  JobJournal journal("test");
+  ASSERT_FALSE(journal.Read(mPath, [](const std::string&) {}));
+  ASSERT_FALSE(journal.IsOpen());
+  journal.Rewrite({"+ 0000000000000001:default#00100002"});
+  ASSERT_TRUE(journal.IsOpen());
+  journal.Append("+ 0000000000000002:default#00100002");
+  journal.Append("- 0000000000000001");
+  journal.Sync();
+  ASSERT_EQ(3u, journal.GetLines());
+  std::vector<std::string> expected = {
+    "+ 0000000000000001:default#00100002",
+    "+ 0000000000000002:default#00100002",
+    "- 0000000000000001"
+  };
+  ASSERT_EQ(expected, Replay());
+}
+
+//------------------------------------------------------------------------------
+// A line torn at the end or corrupted is skipped, the others are replayed
+//------------------------------------------------------------------------------
+TEST_F(JobJournalTest, TornLines)
+{
+  {
+    JobJournal journal("test");
+    journal.Read(mPath, [](const std::string&) {});
+    journal.Rewrite({"+ 0000000000000001:default#00100002"});
+    journal.Append("- 0000000000000001");
+  }
+  off_t complete = Size();
+  ASSERT_GT(complete, 0);
+
+  // a line which lost only its line end is complete
+  ASSERT_EQ(0, truncate(mPath.c_str(), complete - 1));
+  ASSERT_EQ(2u, Replay().size());
+
+  // every cut inside the last line drops it
+  for (off_t cut = 2; cut <= 28; ++cut) {
+    ASSERT_EQ(0, truncate(mPath.c_str(), complete - cut));
+    std::vector<std::string> lines = Replay();
+    ASSERT_EQ(1u, lines.size()) << "cut " << cut;
+    ASSERT_EQ("+ 0000000000000001:default#00100002", lines[0]);
+  }
+
+  ASSERT_EQ(0, truncate(mPath.c_str(), complete - 28));
+  {
+    std::ofstream out(mPath.c_str(), std::ios::app);
+    // a line without checksum and a line with a wrong one
+    out << "- 0000000000000001\n";
+    out << "- 0000000000000002 00000000\n";
+  }
+  std::vector<std::string> lines = Replay();
+  ASSERT_EQ(1u, lines.size());
+  ASSERT_EQ("+ 0000000000000001:default#00100002", lines[0]);
+}
+
+//------------------------------------------------------------------------------
+// A rewrite replaces the journal and the appends go to the new one
+//------------------------------------------------------------------------------
+TEST_F(JobJournalTest, Rewrite)
+{
+  JobJournal journal("test");
+  journal.Read(mPath, [](const std::string&) {});
+  std::vector<std::string> many;
+
+  for (int i = 0; i < 10001; ++i) {
+    many.push_back("+ line " + std::to_string(i));
+  }
+
+  journal.Rewrite(many);
+  ASSERT_EQ(10001u, journal.GetLines());
+  ASSERT_TRUE(journal.NeedsRewrite(100));
+  ASSERT_FALSE(journal.NeedsRewrite(5000));
+  journal.Rewrite({"+ pending"});
+  ASSERT_EQ(1u, journal.GetLines());
+  ASSERT_FALSE(journal.NeedsRewrite(0));
+  journal.Append("+ next");
+  journal.Sync();
+  std::vector<std::string> expected = {"+ pending", "+ next"};
+  ASSERT_EQ(expected, Replay());
+  ASSERT_NE(0, access((mPath + ".tmp").c_str(), F_OK));
+}
@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+// File: PopularitySketchTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/PopularitySketch.hh"
+#include <map>
+#include <vector>
+
+using eos::mgm::PopularitySketch;
+
+//------------------------------------------------------------------------------
+// Files are counted exactly as long as the sketch is not full
+//------------------------------------------------------------------------------
+TEST(PopularitySketch, Exact)
+{
+  PopularitySketch sketch(4);
+  sketch.Add(1, 1, 100);
+  sketch.Add(2, 3, 10);
+  sketch.Add(1, 1, 100);
+  ASSERT_EQ(2u, sketch.Size());
+  std::vector<PopularitySketch::Entry> top;
+  sketch.Top(10, top);
+  ASSERT_EQ(2u, top.size());
+  ASSERT_EQ(2u, top[0].mFid);
+  ASSERT_EQ(3u, top[0].mWeight);
+  ASSERT_EQ(0u, top[0].mError);
+  ASSERT_EQ(1u, top[0].mNread);
+  ASSERT_EQ(10u, top[0].mRb);
+  ASSERT_EQ(1u, top[1].mFid);
+  ASSERT_EQ(2u, top[1].mWeight);
+  ASSERT_EQ(0u, top[1].mError);
+  ASSERT_EQ(2u, top[1].mNread);
+  ASSERT_EQ(200u, top[1].mRb);
+  sketch.Clear();
+  ASSERT_EQ(0u, sketch.Size());
+  sketch.Top(10, top);
+  ASSERT_TRUE(top.empty());
+}
+
+//------------------------------------------------------------------------------
+// A new file takes the slot of the lightest one and inherits its weight as
+// error, the other files are untouched
+//------------------------------------------------------------------------------
+TEST(PopularitySketch, Eviction)
+{
+  PopularitySketch sketch(3);
+  sketch.Add(1, 5, 0);
+  sketch.Add(2, 2, 0);
+  sketch.Add(3, 7, 0);
+  sketch.Add(4, 1, 0);
+  ASSERT_EQ(3u, sketch.Size());
+  std::vector<PopularitySketch::Entry> top;
+  sketch.Top(3, top);
+  std::map<unsigned long long, PopularitySketch::Entry> byfid;
+
+  for (auto& entry : top) {
+    byfid[entry.mFid] = entry;
+  }
+
+  ASSERT_EQ(0u, byfid.count(2));
+  ASSERT_EQ(3u, byfid[4].mWeight);
+  ASSERT_EQ(2u, byfid[4].mError);
+  ASSERT_EQ(1u, byfid[4].mNread);
+  ASSERT_EQ(5u, byfid[1].mWeight);
+  ASSERT_EQ(0u, byfid[1].mError);
+  ASSERT_EQ(7u, byfid[3].mWeight);
+  ASSERT_EQ(0u, byfid[3].mError);
+  // the error accumulates over evictions: 4 (3) is the lightest now
+  sketch.Add(5, 1, 0);
+  sketch.Top(3, top);
+  byfid.clear();
+
+  for (auto& entry : top) {
+    byfid[entry.mFid] = entry;
+  }
+
+  ASSERT_EQ(0u, byfid.count(4));
+  ASSERT_EQ(4u, byfid[5].mWeight);
+  ASSERT_EQ(3u, byfid[5].mError);
+}
+
+//------------------------------------------------------------------------------
+// Files accessed much more than the others stay tracked whatever the number
+// of other files, and the real weight is within [weight - error, weight]
+//------------------------------------------------------------------------------
+TEST(PopularitySketch, HeavyHitters)
+{
+  const size_t capacity = 64;
+  PopularitySketch sketch(capacity);
+  std::map<unsigned long long, unsigned long long> real;
+  unsigned long long total = 0;
+  unsigned long long cold = 1000;
+
+  for (int round = 0; round < 2000; ++round) {
+    // three hot files with different rates
+    for (unsigned long long fid = 1; fid <= 3; ++fid) {
+      if ((round % fid) == 0) {
+        sketch.Add(fid, 1, 0);
+        real[fid]++;
+        total++;
+      }
+    }
+
+    // and a stream of files accessed a few times each
+    for (int i = 0; i < 5; ++i) {
+      unsigned long long fid = cold + (i % 2);
+      sketch.Add(fid, 1, 0);
+      real[fid]++;
+      total++;
+    }
+
+    cold += 2;
+  }
+
+  ASSERT_EQ(capacity, sketch.Size());
+  std::vector<PopularitySketch::Entry> top;
+  sketch.Top(capacity, top);
+  unsigned long long sum = 0;
+
+  for (auto& entry : top) {
+    ASSERT_LE(entry.mWeight - entry.mError, real[entry.mFid]);
+    ASSERT_GE(entry.mWeight, real[entry.mFid]);
+    sum += entry.mWeight;
+  }
+
+  // the weights of the tracked files add up to the total weight
+  ASSERT_EQ(total, sum);
+  ASSERT_EQ(1u, top[0].mFid);
+  ASSERT_EQ(2u, top[1].mFid);
+  ASSERT_EQ(3u, top[2].mFid);
+
+  // any file above total / capacity is tracked
+  for (auto& it : real) {
+    if (it.second > total / capacity) {
+      bool found = false;
+
+      for (auto& entry : top) {
+        found |= (entry.mFid == it.first);
+      }
+
+      ASSERT_TRUE(found) << "fid=" << it.first;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// The ranking is by decreasing weight, ties by increasing file id, and does
+// not depend on the order of the accesses
+//------------------------------------------------------------------------------
+TEST(PopularitySketch, StableRanking)
+{
+  PopularitySketch forward(16), backward(16);
+
+  for (unsigned long long fid = 1; fid <= 10; ++fid) {
+    forward.Add(fid, fid % 3, 0);
+  }
+
+  for (unsigned long long fid = 10; fid >= 1; --fid) {
+    backward.Add(fid, fid % 3, 0);
+  }
+
+  std::vector<PopularitySketch::Entry> top1, top2, top3;
+  forward.Top(10, top1);
+  forward.Top(10, top2);
+  backward.Top(10, top3);
+  std::vector<unsigned long long> expected = {2, 5, 8, 1, 4, 7, 10, 3, 6, 9};
+  ASSERT_EQ(expected.size(), top1.size());
+
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i], top1[i].mFid) << "rank=" << i;
+    ASSERT_EQ(expected[i], top2[i].mFid) << "rank=" << i;
+    ASSERT_EQ(expected[i], top3[i].mFid) << "rank=" << i;
+  }
+
+  // a limit gives a prefix of the full ranking
+  forward.Top(4, top2);
+  ASSERT_EQ(4u, top2.size());
+
+  for (size_t i = 0; i < top2.size(); ++i) {
+    ASSERT_EQ(top1[i].mFid, top2[i].mFid);
+  }
+}
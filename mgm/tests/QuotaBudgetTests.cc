@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------------
+// File: QuotaBudgetTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/QuotaBudget.hh"
+
+using eos::mgm::QuotaBudget;
+using eos::mgm::QuotaLeft;
+
+namespace
+{
+//! User, group and project keys
+const unsigned long long sKeys[3] = {11, 22, 33};
+//! An arbitrary start time
+const time_t sNow = 1500000000;
+
+//------------------------------------------------------------------------------
+// Quota left with a volume and an inode quota, or none if bytes is negative
+//------------------------------------------------------------------------------
+QuotaLeft
+Left(long long bytes, long long files)
+{
+  QuotaLeft left;
+  left.mBytesTarget = (bytes >= 0);
+  left.mFilesTarget = (bytes >= 0);
+  left.mBytes = (bytes >= 0 ? bytes : 0);
+  left.mFiles = (bytes >= 0 ? files : 0);
+  return left;
+}
+}
+
+//------------------------------------------------------------------------------
+// If both user and group quotas are defined both are needed, the project
+// quota is only used without any of them
+//------------------------------------------------------------------------------
+TEST(QuotaBudget, HasQuota)
+{
+  QuotaLeft left[3] = {Left(100, 10), Left(100, 10), Left(-1, 0)};
+  ASSERT_TRUE(QuotaBudget::HasQuota(left, 50, 1));
+  left[1] = Left(10, 10);
+  ASSERT_FALSE(QuotaBudget::HasQuota(left, 50, 1));
+  left[1] = Left(-1, 0);
+  ASSERT_TRUE(QuotaBudget::HasQuota(left, 50, 1));
+  ASSERT_FALSE(QuotaBudget::HasQuota(left, 50, 10));
+  left[0] = Left(-1, 0);
+  ASSERT_FALSE(QuotaBudget::HasQuota(left, 50, 1));
+  left[2].mBytes = 100;
+  left[2].mFiles = 10;
+  ASSERT_TRUE(QuotaBudget::HasQuota(left, 50, 1));
+  ASSERT_FALSE(QuotaBudget::HasQuota(left, 100, 1));
+}
+
+//------------------------------------------------------------------------------
+// Nothing is booked before the budgets were stored, afterwards every booking
+// is debited until the budget is exhausted
+//------------------------------------------------------------------------------
+TEST(QuotaBudget, BookUntilExhausted)
+{
+  QuotaBudget budget;
+  ASSERT_FALSE(budget.Book(sKeys, 1, sNow, 10, 1));
+  QuotaLeft left[3] = {Left(100, 100), Left(-1, 0), Left(-1, 0)};
+  budget.Store(sKeys, 1, sNow, left);
+
+  for (int i = 0; i < 9; i++) {
+    ASSERT_TRUE(budget.Book(sKeys, 1, sNow, 10, 1)) << "booking " << i;
+  }
+
+  // 10 bytes left, a write needs strictly less than what is left
+  ASSERT_FALSE(budget.Book(sKeys, 1, sNow, 10, 1));
+  ASSERT_TRUE(budget.Book(sKeys, 1, sNow, 5, 1));
+}
+
+//------------------------------------------------------------------------------
+// A change of the quota targets invalidates all the budgets
+//------------------------------------------------------------------------------
+TEST(QuotaBudget, GenerationInvalidates)
+{
+  QuotaBudget budget;
+  QuotaLeft left[3] = {Left(100, 100), Left(100, 100), Left(-1, 0)};
+  budget.Store(sKeys, 1, sNow, left);
+  ASSERT_TRUE(budget.Book(sKeys, 1, sNow, 10, 1));
+  ASSERT_FALSE(budget.Book(sKeys, 2, sNow, 10, 1));
+  budget.Store(sKeys, 2, sNow, left);
+  ASSERT_TRUE(budget.Book(sKeys, 2, sNow, 10, 1));
+}
+
+//------------------------------------------------------------------------------
+// Once outdated a single caller is sent to reconcile the budget, the others
+// go on with the cached values until it is stored again
+//------------------------------------------------------------------------------
+TEST(QuotaBudget, SingleReconciliation)
+{
+  QuotaBudget budget;
+  QuotaLeft left[3] = {Left(100, 100), Left(-1, 0), Left(-1, 0)};
+  budget.Store(sKeys, 1, sNow, left);
+  const time_t later = sNow + QuotaBudget::sBudgetLifetime;
+  ASSERT_TRUE(budget.Book(sKeys, 1, later - 1, 10, 1));
+  ASSERT_FALSE(budget.Book(sKeys, 1, later, 10, 1));
+  ASSERT_TRUE(budget.Book(sKeys, 1, later, 10, 1));
+  // the reconciliation stores the values of the ns quota node
+  left[0] = Left(15, 100);
+  budget.Store(sKeys, 1, later, left);
+  ASSERT_TRUE(budget.Book(sKeys, 1, later, 10, 1));
+  ASSERT_FALSE(budget.Book(sKeys, 1, later, 10, 1));
+}
+
+//------------------------------------------------------------------------------
+// The group budget is debited once when the group is the project
+//------------------------------------------------------------------------------
+TEST(QuotaBudget, ProjectGroupDebitedOnce)
+{
+  QuotaBudget budget;
+  const unsigned long long keys[3] = {11, 33, 33};
+  QuotaLeft left[3] = {Left(-1, 0), Left(30, 100), Left(30, 100)};
+  budget.Store(keys, 1, sNow, left);
+  ASSERT_TRUE(budget.Book(keys, 1, sNow, 10, 1));
+  ASSERT_TRUE(budget.Book(keys, 1, sNow, 10, 1));
+  ASSERT_FALSE(budget.Book(keys, 1, sNow, 10, 1));
+}
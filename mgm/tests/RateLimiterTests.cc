@@ -0,0 +1,197 @@
+//------------------------------------------------------------------------------
+// File: RateLimiterTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/RateLimiter.hh"
+#include <map>
+#include <string>
+
+using eos::mgm::RateLimiter;
+
+namespace
+{
+//! An arbitrary start time, far from 0
+const int64_t sStart = 1000000000000000ll;
+//! Nanoseconds per millisecond
+const int64_t sMs = 1000000ll;
+}
+
+//------------------------------------------------------------------------------
+// Nothing is ever stalled without rate rules
+//------------------------------------------------------------------------------
+TEST(RateLimiter, NoRules)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {{"*", "60"}, {"w:*", "10"}};
+  limiter.Compile(rules);
+  limiter.Record("Stat", 1, 1, 100000, sStart);
+  int stalltime = 0;
+  std::string rule;
+  ASSERT_FALSE(limiter.Exceeded(1, 1, stalltime, rule, sStart));
+  ASSERT_FALSE(limiter.Exceeded(1, 1, stalltime, rule));
+}
+
+//------------------------------------------------------------------------------
+// A client can burst one second worth of operations, the next one stalls it
+// until the bucket refilled by one operation
+//------------------------------------------------------------------------------
+TEST(RateLimiter, BurstStallRefill)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {{"rate:user:*:Stat", "10"}};
+  limiter.Compile(rules);
+  int stalltime = 0;
+  std::string rule;
+  // 10 Hz, i.e. 100 ms per operation and a burst of 10 operations
+  limiter.Record("Stat", 5, 5, 10, sStart);
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  limiter.Record("Stat", 5, 5, 1, sStart);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  ASSERT_EQ(1, stalltime);
+  ASSERT_EQ("rate:user:*:Stat", rule);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 99 * sMs));
+  // one operation worth of time later the client is within its rate again
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 100 * sMs));
+  // and a full second later the whole burst is available again
+  limiter.Record("Stat", 5, 5, 10, sStart + 1100 * sMs);
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 1100 * sMs));
+  limiter.Record("Stat", 5, 5, 1, sStart + 1100 * sMs);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 1100 * sMs));
+}
+
+//------------------------------------------------------------------------------
+// The stall time is rounded up to seconds and the debt is bounded
+//------------------------------------------------------------------------------
+TEST(RateLimiter, StallTime)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {{"rate:user:*:Stat", "1"}};
+  limiter.Compile(rules);
+  int stalltime = 0;
+  std::string rule;
+  // 1 Hz, the third operation is 1 s over the burst
+  limiter.Record("Stat", 5, 5, 3, sStart);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  ASSERT_EQ(2, stalltime);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 1500 * sMs));
+  ASSERT_EQ(1, stalltime);
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 2000 * sMs));
+  // a flood only buys a bounded stall
+  limiter.Record("Stat", 5, 5, 1000000, sStart + 2000 * sMs);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart + 2000 * sMs));
+  ASSERT_EQ(5, stalltime);
+}
+
+//------------------------------------------------------------------------------
+// Rules only count their operation and only stall the matching clients, a
+// wildcard rule keeps one bucket per client
+//------------------------------------------------------------------------------
+TEST(RateLimiter, Matching)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {
+    {"rate:user:*:Stat", "10"},
+    {"rate:user:7:OpenRead", "1"},
+    {"rate:group:100:OpenWrite", "1"}
+  };
+  limiter.Compile(rules);
+  int stalltime = 0;
+  std::string rule;
+  limiter.Record("Stat", 5, 100, 20, sStart);
+  ASSERT_TRUE(limiter.Exceeded(5, 100, stalltime, rule, sStart));
+  ASSERT_FALSE(limiter.Exceeded(6, 100, stalltime, rule, sStart));
+  // operations without a rule are not counted
+  limiter.Record("Mkdir", 6, 100, 1000, sStart);
+  ASSERT_FALSE(limiter.Exceeded(6, 100, stalltime, rule, sStart));
+  // a rule for another user
+  limiter.Record("OpenRead", 6, 100, 1000, sStart);
+  ASSERT_FALSE(limiter.Exceeded(6, 100, stalltime, rule, sStart));
+  limiter.Record("OpenRead", 7, 101, 5, sStart);
+  ASSERT_TRUE(limiter.Exceeded(7, 101, stalltime, rule, sStart));
+  ASSERT_EQ("rate:user:7:OpenRead", rule);
+  // a group rule is shared by the members of the group
+  limiter.Record("OpenWrite", 8, 100, 1, sStart);
+  ASSERT_FALSE(limiter.Exceeded(10, 100, stalltime, rule, sStart));
+  limiter.Record("OpenWrite", 9, 100, 1, sStart);
+  ASSERT_TRUE(limiter.Exceeded(11, 100, stalltime, rule, sStart));
+  ASSERT_EQ("rate:group:100:OpenWrite", rule);
+  ASSERT_FALSE(limiter.Exceeded(11, 101, stalltime, rule, sStart));
+}
+
+//------------------------------------------------------------------------------
+// Recompiling keeps the buckets of the unchanged rules only
+//------------------------------------------------------------------------------
+TEST(RateLimiter, Recompile)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {{"rate:user:*:Stat", "10"}};
+  limiter.Compile(rules);
+  int stalltime = 0;
+  std::string rule;
+  limiter.Record("Stat", 5, 5, 20, sStart);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  rules["r:*"] = "60";
+  limiter.Compile(rules);
+  ASSERT_TRUE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  rules["rate:user:*:Stat"] = "20";
+  limiter.Compile(rules);
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+  rules.clear();
+  limiter.Compile(rules);
+  limiter.Record("Stat", 5, 5, 1000, sStart);
+  ASSERT_FALSE(limiter.Exceeded(5, 5, stalltime, rule, sStart));
+}
+
+//------------------------------------------------------------------------------
+// A rule naming a user is only applied once the name was resolved, invalid
+// rules are ignored
+//------------------------------------------------------------------------------
+TEST(RateLimiter, Names)
+{
+  RateLimiter limiter;
+  std::map<std::string, std::string> rules = {
+    {"rate:user:root:Stat", "1"},
+    {"rate:user:*:Stat", "0"},
+    {"rate:host:*:Stat", "1"},
+    {"rate:user:*", "1"}
+  };
+  limiter.Compile(rules);
+  int stalltime = 0;
+  std::string rule;
+  limiter.Record("Stat", 0, 0, 100, sStart);
+  ASSERT_FALSE(limiter.Exceeded(0, 0, stalltime, rule, sStart));
+
+  for (auto it = rules.begin(); it != rules.end(); ++it) {
+    limiter.Resolve(it->first);
+  }
+
+  limiter.Compile(rules);
+  limiter.Record("Stat", 0, 0, 100, sStart);
+  ASSERT_TRUE(limiter.Exceeded(0, 0, stalltime, rule, sStart));
+  ASSERT_EQ("rate:user:root:Stat", rule);
+  ASSERT_FALSE(limiter.Exceeded(1, 1, stalltime, rule, sStart));
+  // an unknown user is not resolved
+  rules = {{"rate:user:no-such-user-eos:Stat", "1"}};
+  limiter.Resolve("rate:user:no-such-user-eos:Stat");
+  limiter.Compile(rules);
+  limiter.Record("Stat", 99, 99, 100, sStart);
+  ASSERT_FALSE(limiter.Exceeded(99, 99, stalltime, rule, sStart));
+}
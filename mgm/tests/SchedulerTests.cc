@@ -0,0 +1,225 @@
+//------------------------------------------------------------------------------
+// File: SchedulerTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/Scheduler.hh"
+#include "mgm/FsView.hh"
+#include "common/Mapping.hh"
+#include <memory>
+
+using eos::mgm::FsGroup;
+using eos::mgm::FsView;
+using eos::mgm::Scheduler;
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Access to the placement core of the scheduler
+//------------------------------------------------------------------------------
+class SchedulerProbe : public Scheduler
+{
+public:
+  using Scheduler::GroupPlacer;
+  using Scheduler::PlacementContext;
+  using Scheduler::PlaceBatch;
+  using Scheduler::PlaceFile;
+
+  //----------------------------------------------------------------------------
+  // Forget the group rotation of all the index tags
+  //----------------------------------------------------------------------------
+  static void ResetRotation()
+  {
+    XrdSysMutexHelper scope_lock(pMapMutex);
+    schedulingGroup.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  // Get the group where the next placement of an index tag starts from
+  //----------------------------------------------------------------------------
+  static FsGroup* GetRotation(const std::string& indextag)
+  {
+    XrdSysMutexHelper scope_lock(pMapMutex);
+    auto it = schedulingGroup.find(indextag);
+    return (it == schedulingGroup.end() ? nullptr : it->second);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Fixture with a space of five groups, one of them full
+//------------------------------------------------------------------------------
+class SchedulerTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    for (int i = 0; i < 5; ++i) {
+      std::string name = "schedtest." + std::to_string(i);
+      mGroups.emplace_back(new FsGroup(name.c_str()));
+      FsView::gFsView.mSpaceGroupView[mSpace].insert(mGroups.back().get());
+    }
+
+    mFull = mGroups[3].get();
+    eos::common::Mapping::Nobody(mVid);
+    mVid.uid = 2;
+    mVid.gid = 2;
+    mArgs.spacename = &mSpace;
+    mArgs.path = "/eos/test/file";
+    mArgs.lid = 0x00100112;
+    mArgs.vid = &mVid;
+    mArgs.alreadyused_filesystems = &mAvoid;
+    mArgs.selected_filesystems = &mSelected;
+    mCtx.nfilesystems = 2;
+    mCtx.ncollocatedfs = 0;
+    mCtx.indextag = "2:2";
+    SchedulerProbe::ResetRotation();
+  }
+
+  void TearDown() override
+  {
+    FsView::gFsView.mSpaceGroupView.erase(mSpace);
+    SchedulerProbe::ResetRotation();
+  }
+
+  //----------------------------------------------------------------------------
+  // Placer recording the groups tried, it refuses the full group and the
+  // inodes multiple of 7
+  //----------------------------------------------------------------------------
+  SchedulerProbe::GroupPlacer GetPlacer(std::vector<FsGroup*>& tried)
+  {
+    return [this, &tried](FsGroup * group, ino64_t inode,
+                          std::vector<unsigned int>* selected,
+                          std::vector<std::string>* dataproxys,
+                          std::vector<std::string>* firewallentpts) {
+      tried.push_back(group);
+
+      if ((group == mFull) || ((inode % 7) == 0)) {
+        return false;
+      }
+
+      for (unsigned int i = 0; i < mCtx.nfilesystems; ++i) {
+        selected->push_back(1000 * (inode % 100) + i);
+
+        if (dataproxys) {
+          dataproxys->push_back("proxy." + group->mName);
+        }
+
+        if (firewallentpts) {
+          firewallentpts->push_back("fwep." + group->mName);
+        }
+      }
+
+      return true;
+    };
+  }
+
+  std::string mSpace = "schedtest";
+  std::vector<std::unique_ptr<FsGroup>> mGroups;
+  FsGroup* mFull;
+  eos::common::Mapping::VirtualIdentity mVid;
+  std::vector<unsigned int> mAvoid;
+  std::vector<unsigned int> mSelected;
+  Scheduler::PlacementArguments mArgs;
+  SchedulerProbe::PlacementContext mCtx;
+};
+}
+
+//------------------------------------------------------------------------------
+// A batch tries the groups, selects the filesystems, the dataproxys and the
+// firewall entry points and leaves the rotation exactly like consecutive
+// single placements
+//------------------------------------------------------------------------------
+TEST_F(SchedulerTest, BatchMatchesSinglePlacements)
+{
+  std::vector<ino64_t> inodes;
+
+  for (ino64_t ino = 1; ino <= 23; ++ino) {
+    inodes.push_back(ino);
+  }
+
+  std::vector<FsGroup*> single_tried;
+  std::vector<std::vector<unsigned int>> single_fs;
+  std::vector<std::vector<std::string>> single_proxys;
+  std::vector<std::vector<std::string>> single_fweps;
+  int single_failed = 0;
+  auto single_placer = GetPlacer(single_tried);
+
+  for (auto ino : inodes) {
+    std::vector<unsigned int> selected;
+    std::vector<std::string> proxys;
+    std::vector<std::string> fweps;
+
+    if (SchedulerProbe::PlaceFile(&mArgs, mCtx, single_placer, ino, &selected,
+                                  &proxys, &fweps)) {
+      ++single_failed;
+    }
+
+    single_fs.push_back(selected);
+    single_proxys.push_back(proxys);
+    single_fweps.push_back(fweps);
+  }
+
+  FsGroup* single_rotation = SchedulerProbe::GetRotation(mCtx.indextag);
+  ASSERT_NE(nullptr, single_rotation);
+  // inodes 7, 14 and 21 fit nowhere
+  ASSERT_EQ(3, single_failed);
+  SchedulerProbe::ResetRotation();
+  std::vector<FsGroup*> batch_tried;
+  std::vector<std::vector<unsigned int>> batch_fs;
+  std::vector<std::vector<std::string>> batch_proxys;
+  std::vector<std::vector<std::string>> batch_fweps;
+  ASSERT_EQ(ENOSPC, SchedulerProbe::PlaceBatch(&mArgs, mCtx,
+            GetPlacer(batch_tried), inodes, batch_fs,
+            &batch_proxys, &batch_fweps));
+  ASSERT_EQ(single_tried, batch_tried);
+  ASSERT_EQ(single_fs, batch_fs);
+  ASSERT_EQ(single_proxys, batch_proxys);
+  ASSERT_EQ(single_fweps, batch_fweps);
+  ASSERT_EQ(single_rotation, SchedulerProbe::GetRotation(mCtx.indextag));
+  ASSERT_TRUE(batch_fs[6].empty());
+  ASSERT_EQ(2u, batch_fs[7].size());
+  ASSERT_EQ(2u, batch_proxys[7].size());
+  ASSERT_EQ(2u, batch_fweps[7].size());
+}
+
+//------------------------------------------------------------------------------
+// The groups of the avoided filesystems are tried first for every file without
+// moving the rotation
+//------------------------------------------------------------------------------
+TEST_F(SchedulerTest, BatchTriesAvoidedGroupsFirst)
+{
+  mCtx.groupsToTry.push_back(mFull);
+  mCtx.groupsToTry.push_back(mGroups[1].get());
+  std::vector<ino64_t> inodes = {1, 2, 3};
+  std::vector<FsGroup*> tried;
+  std::vector<std::vector<unsigned int>> placements;
+  ASSERT_EQ(0, SchedulerProbe::PlaceBatch(&mArgs, mCtx, GetPlacer(tried),
+                                          inodes, placements, 0, 0));
+  ASSERT_EQ(6u, tried.size());
+
+  for (size_t i = 0; i < inodes.size(); ++i) {
+    ASSERT_EQ(mFull, tried[2 * i]);
+    ASSERT_EQ(mGroups[1].get(), tried[2 * i + 1]);
+    ASSERT_EQ(2u, placements[i].size());
+  }
+
+  ASSERT_EQ(*FsView::gFsView.mSpaceGroupView[mSpace].begin(),
+            SchedulerProbe::GetRotation(mCtx.indextag));
+}
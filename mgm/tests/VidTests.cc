@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------
+// File: VidTests.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+#include <gtest/gtest.h>
+#include "mgm/Vid.hh"
+#include "common/Mapping.hh"
+
+using eos::common::Mapping;
+using eos::mgm::Vid;
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Map a unix client
+//------------------------------------------------------------------------------
+uid_t
+MapUnixUid()
+{
+  XrdSecEntity client("unix");
+  char name[] = "eostest";
+  client.name = name;
+  Mapping::VirtualIdentity vid;
+  Mapping::Nobody(vid);
+  Mapping::IdMap(&client, "", "eostest.1:10@localhost", vid, false);
+  // the entity does not own the strings
+  client.name = 0;
+  return vid.uid;
+}
+
+//------------------------------------------------------------------------------
+// Force the uid of the unix protocol like 'vid set map -unix <pwd> vuid:<uid>'
+//------------------------------------------------------------------------------
+bool
+SetUnixUid(const char* uid)
+{
+  std::string value = "mgm.vid.cmd=map&mgm.vid.key=<key>&mgm.vid.auth=unix&"
+                      "mgm.vid.pattern=<pwd>&mgm.vid.uid=";
+  value += uid;
+  return Vid::Set(value.c_str(), false);
+}
+}
+
+//------------------------------------------------------------------------------
+// Changing or removing a mapping rule is seen by the next mapping of a client
+// whose identity is cached
+//------------------------------------------------------------------------------
+TEST(Vid, SetRmInvalidateIdMapCache)
+{
+  ASSERT_TRUE(SetUnixUid("4101"));
+  ASSERT_EQ(4101u, MapUnixUid());
+  ASSERT_EQ(4101u, MapUnixUid());
+  ASSERT_TRUE(SetUnixUid("4102"));
+  ASSERT_EQ(4102u, MapUnixUid());
+  XrdOucEnv env("mgm.vid.cmd=unmap&mgm.vid.key=unix:\"<pwd>\":uid");
+  int retc = 0;
+  XrdOucString out, err;
+  ASSERT_TRUE(Vid::Rm(env, retc, out, err, false));
+  ASSERT_EQ(0, retc);
+  ASSERT_EQ(99u, MapUnixUid());
+}
@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 #include <sys/time.h>
 
 EOSNSNAMESPACE_BEGIN
@@ -326,6 +327,52 @@ public:
   //----------------------------------------------------------------------------
   virtual std::set<std::string> getNameContainers() const = 0;
 
+  //----------------------------------------------------------------------------
+  //! List the names of the files and subcontainers in name order, one page
+  //! at a time. The default implementation builds the full listing on every
+  //! call and is meant for backends which keep all the children in memory
+  //! anyway, see hasPagedListing.
+  //!
+  //! @param token continuation token i.e. the listing starts with the first
+  //!        entry strictly greater than it, empty to start from the beginning
+  //! @param max_entries maximum number of entries to return
+  //! @param entries vector filled with the names of the entries
+  //!
+  //! @return continuation token for the next call or empty string if there
+  //!         are no more entries
+  //----------------------------------------------------------------------------
+  virtual std::string
+  listEntries(const std::string& token, size_t max_entries,
+              std::vector<std::string>& entries)
+  {
+    entries.clear();
+
+    if (max_entries == 0) {
+      return token;
+    }
+
+    std::set<std::string> names = getNameFiles();
+    std::set<std::string> dnames = getNameContainers();
+    names.insert(dnames.begin(), dnames.end());
+    auto it = (token.empty() ? names.begin() : names.upper_bound(token));
+
+    for (; (it != names.end()) && (entries.size() < max_entries); ++it) {
+      entries.push_back(*it);
+    }
+
+    return ((it == names.end()) ? std::string() : entries.back());
+  }
+
+  //----------------------------------------------------------------------------
+  //! Check if listEntries fetches the entries page by page from the backend.
+  //! If not, listing all the entries at once is cheaper than paging.
+  //----------------------------------------------------------------------------
+  virtual bool
+  hasPagedListing() const
+  {
+    return false;
+  }
+
 //----------------------------------------------------------------------------
   //! Serialize the object to a buffer
   //----------------------------------------------------------------------------
@@ -182,6 +182,15 @@ public:
   //! Get first free file id
   //----------------------------------------------------------------------------
   virtual IFileMD::id_t getFirstFreeId() = 0;
+
+  //----------------------------------------------------------------------------
+  //! Get usage metrics of the connections to the backend, one line per
+  //! connection in key=value format, empty if there is no remote backend
+  //----------------------------------------------------------------------------
+  virtual std::string getBackendStats()
+  {
+    return "";
+  }
 };
 
 EOSNSNAMESPACE_END
@@ -29,6 +29,7 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <set>
 #include <pthread.h>
 
 #include "namespace/utils/TestHelpers.hh"
@@ -50,12 +51,14 @@ public:
   CPPUNIT_TEST(quotaTest);
   CPPUNIT_TEST(lostContainerTest);
   CPPUNIT_TEST(onlineCompactingTest);
+  CPPUNIT_TEST(listEntriesTest);
   CPPUNIT_TEST_SUITE_END();
 
   void reloadTest();
   void quotaTest();
   void lostContainerTest();
   void onlineCompactingTest();
+  void listEntriesTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(HierarchicalViewTest);
@@ -832,3 +835,79 @@ void HierarchicalViewTest::onlineCompactingTest()
   unlink(fileNameContMD.c_str());
   unlink(newFileLogName.c_str());
 }
+
+//------------------------------------------------------------------------------
+// Paged listing of a container
+//------------------------------------------------------------------------------
+void HierarchicalViewTest::listEntriesTest()
+{
+  std::shared_ptr<eos::IContainerMDSvc> contSvc =
+    std::shared_ptr<eos::IContainerMDSvc>(new eos::ChangeLogContainerMDSvc());
+  std::shared_ptr<eos::IFileMDSvc> fileSvc =
+    std::shared_ptr<eos::IFileMDSvc>(new eos::ChangeLogFileMDSvc());
+  std::shared_ptr<eos::IView> view =
+    std::shared_ptr<eos::IView>(new eos::HierarchicalView());
+  fileSvc->setContMDService(contSvc.get());
+  contSvc->setFileMDService(fileSvc.get());
+  std::map<std::string, std::string> fileSettings;
+  std::map<std::string, std::string> contSettings;
+  std::map<std::string, std::string> settings;
+  std::string fileNameFileMD = getTempName("/tmp", "eosns");
+  std::string fileNameContMD = getTempName("/tmp", "eosns");
+  contSettings["changelog_path"] = fileNameContMD;
+  fileSettings["changelog_path"] = fileNameFileMD;
+  fileSvc->configure(fileSettings);
+  contSvc->configure(contSettings);
+  view->setContainerMDSvc(contSvc.get());
+  view->setFileMDSvc(fileSvc.get());
+  view->configure(settings);
+  view->initialize();
+  std::shared_ptr<eos::IContainerMD> cont = view->createContainer("/list",
+      true);
+  std::set<std::string> expected;
+
+  for (int i = 0; i < 100; ++i) {
+    std::ostringstream o;
+    o << "file" << (1000 + i);
+    view->createFile("/list/" + o.str());
+    expected.insert(o.str());
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    std::ostringstream o;
+    o << "dir" << i;
+    view->createContainer("/list/" + o.str(), false);
+    expected.insert(o.str());
+  }
+
+  // Full paged listing
+  std::vector<std::string> all;
+  std::vector<std::string> page;
+  std::string token;
+
+  do {
+    token = cont->listEntries(token, 7, page);
+    CPPUNIT_ASSERT(page.size() <= 7);
+    all.insert(all.end(), page.begin(), page.end());
+  } while (!token.empty());
+
+  CPPUNIT_ASSERT(all == std::vector<std::string>(expected.begin(),
+                 expected.end()));
+  // Entries added and removed during a listing are seen by the next pages
+  token = cont->listEntries("", 5, page);
+  CPPUNIT_ASSERT_EQUAL(std::string("dir4"), token);
+  view->createFile("/list/dir40");
+  view->removeContainer("/list/dir5");
+  token = cont->listEntries(token, 3, page);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, page.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("dir40"), page[0]);
+  CPPUNIT_ASSERT_EQUAL(std::string("dir6"), page[1]);
+  CPPUNIT_ASSERT_EQUAL(std::string("dir7"), page[2]);
+  // Resume after the last entry
+  token = cont->listEntries("file1099", 10, page);
+  CPPUNIT_ASSERT(page.empty());
+  CPPUNIT_ASSERT(token.empty());
+  view->finalize();
+  unlink(fileNameFileMD.c_str());
+  unlink(fileNameContMD.c_str());
+}
@@ -17,6 +17,8 @@
  ************************************************************************/
 
 #include "namespace/ns_quarkdb/BackendClient.hh"
+#include <algorithm>
+#include <sstream>
 
 EOSNSNAMESPACE_BEGIN
 
@@ -26,6 +28,104 @@ std::string BackendClient::sQdbHost("localhost");
 int BackendClient::sQdbPort(7777);
 std::map<std::string, qclient::QClient*> BackendClient::pMapClients;
 std::mutex BackendClient::pMutexMap;
+std::map<std::string, BackendPool*> BackendClient::pMapPools;
+uint32_t BackendClient::sNumLookupConns(4);
+uint32_t BackendClient::sNumScanConns(2);
+
+//------------------------------------------------------------------------------
+// BackendConnection constructor
+//------------------------------------------------------------------------------
+BackendConnection::BackendConnection(const std::string& host, uint32_t port):
+  mQcl(new qclient::QClient(host, port, true, true)), mInFlight(0),
+  mNumRequests(0), mLatencyUs(0), mMaxLatencyUs(0)
+{}
+
+//------------------------------------------------------------------------------
+// Mark end of a request
+//------------------------------------------------------------------------------
+void
+BackendConnection::requestDone(std::chrono::microseconds latency)
+{
+  uint64_t lat_us = latency.count();
+  uint64_t max_us = mMaxLatencyUs.load();
+
+  while ((lat_us > max_us) &&
+         !mMaxLatencyUs.compare_exchange_weak(max_us, lat_us)) {}
+
+  mLatencyUs += lat_us;
+  ++mNumRequests;
+  --mInFlight;
+}
+
+//------------------------------------------------------------------------------
+// Get usage metrics
+//------------------------------------------------------------------------------
+std::string
+BackendConnection::getStats(const std::string& prefix) const
+{
+  uint64_t num_req = mNumRequests.load();
+  std::ostringstream oss;
+  oss << prefix << ".inflight=" << mInFlight.load() << std::endl
+      << prefix << ".requests=" << num_req << std::endl
+      << prefix << ".avg_latency_us="
+      << (num_req ? mLatencyUs.load() / num_req : 0) << std::endl
+      << prefix << ".max_latency_us=" << mMaxLatencyUs.load() << std::endl;
+  return oss.str();
+}
+
+//------------------------------------------------------------------------------
+// BackendPool constructor
+//------------------------------------------------------------------------------
+BackendPool::BackendPool(const std::string& host, uint32_t port,
+                         uint32_t num_lookup, uint32_t num_scan)
+{
+  for (uint32_t i = 0; i < std::max(num_lookup, 1u); ++i) {
+    mLookupConns.emplace_back(new BackendConnection(host, port));
+  }
+
+  for (uint32_t i = 0; i < num_scan; ++i) {
+    mScanConns.emplace_back(new BackendConnection(host, port));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get connection assigned to the calling thread
+//------------------------------------------------------------------------------
+BackendConnection*
+BackendPool::getConnection(Traffic traffic)
+{
+  // Threads get consecutive slots so that they are spread evenly over the
+  // connections of every pool
+  static std::atomic<uint32_t> sNextSlot(0);
+  static thread_local uint32_t sSlot = sNextSlot++;
+
+  if ((traffic == Traffic::kScan) && !mScanConns.empty()) {
+    return mScanConns[sSlot % mScanConns.size()].get();
+  }
+
+  return mLookupConns[sSlot % mLookupConns.size()].get();
+}
+
+//------------------------------------------------------------------------------
+// Get usage metrics
+//------------------------------------------------------------------------------
+std::string
+BackendPool::getStats(uint32_t& lookup_idx, uint32_t& scan_idx) const
+{
+  std::string stats;
+
+  for (size_t i = 0; i < mLookupConns.size(); ++i) {
+    stats += mLookupConns[i]->getStats("backend.lookup." +
+                                       std::to_string(lookup_idx++));
+  }
+
+  for (size_t i = 0; i < mScanConns.size(); ++i) {
+    stats += mScanConns[i]->getStats("backend.scan." +
+                                     std::to_string(scan_idx++));
+  }
+
+  return stats;
+}
 
 //------------------------------------------------------------------------------
 // Initialize
@@ -49,6 +149,12 @@ BackendClient::Finalize()
   }
 
   pMapClients.clear();
+
+  for (auto& elem : pMapPools) {
+    delete elem.second;
+  }
+
+  pMapPools.clear();
 }
 
 //------------------------------------------------------------------------------
@@ -91,6 +197,87 @@ BackendClient::getInstance(const std::string& host, uint32_t port)
   return instance;
 }
 
+//------------------------------------------------------------------------------
+// Create a dedicated connection
+//------------------------------------------------------------------------------
+qclient::QClient*
+BackendClient::createClient(const std::string& host, uint32_t port)
+{
+  std::string host_tmp{host};
+
+  if (host_tmp.empty() || (port == 0u)) {
+    host_tmp = sQdbHost;
+    port = sQdbPort;
+  }
+
+  return new qclient::QClient(host_tmp, port, true, true);
+}
+
+//------------------------------------------------------------------------------
+// Get connection pool
+//------------------------------------------------------------------------------
+BackendPool*
+BackendClient::getPool(const std::string& host, uint32_t port)
+{
+  std::string host_tmp{host};
+
+  if (host_tmp.empty() || (port == 0u)) {
+    host_tmp = sQdbHost;
+    port = sQdbPort;
+  }
+
+  std::string qdb_id = host_tmp + ":" + std::to_string(port);
+  std::lock_guard<std::mutex> lock(pMutexMap);
+  auto it = pMapPools.find(qdb_id);
+
+  if (it != pMapPools.end()) {
+    return it->second;
+  }
+
+  BackendPool* pool = new BackendPool(host_tmp, port, sNumLookupConns,
+                                      sNumScanConns);
+  pMapPools.insert(std::make_pair(qdb_id, pool));
+  return pool;
+}
+
+//------------------------------------------------------------------------------
+// Set the number of lookup connections of the pools
+//------------------------------------------------------------------------------
+void
+BackendClient::setLookupConns(uint32_t num_lookup)
+{
+  std::lock_guard<std::mutex> lock(pMutexMap);
+  sNumLookupConns = num_lookup;
+}
+
+//------------------------------------------------------------------------------
+// Set the number of scan connections of the pools
+//------------------------------------------------------------------------------
+void
+BackendClient::setScanConns(uint32_t num_scan)
+{
+  std::lock_guard<std::mutex> lock(pMutexMap);
+  sNumScanConns = num_scan;
+}
+
+//------------------------------------------------------------------------------
+// Get usage metrics of all the connection pools
+//------------------------------------------------------------------------------
+std::string
+BackendClient::getPoolStats()
+{
+  std::string stats;
+  uint32_t lookup_idx = 0;
+  uint32_t scan_idx = 0;
+  std::lock_guard<std::mutex> lock(pMutexMap);
+
+  for (const auto& elem : pMapPools) {
+    stats += elem.second->getStats(lookup_idx, scan_idx);
+  }
+
+  return stats;
+}
+
 //------------------------------------------------------------------------------
 // Initialization and finalization
 //------------------------------------------------------------------------------
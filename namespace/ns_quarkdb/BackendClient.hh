@@ -28,11 +28,159 @@
 #include "qclient/QSet.hh"
 #include "qclient/AsyncHandler.hh"
 #include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 EOSNSNAMESPACE_BEGIN
 
+//------------------------------------------------------------------------------
+//! Connection to the backend together with its usage metrics
+//------------------------------------------------------------------------------
+class BackendConnection
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param host quarkdb host
+  //! @param port quarkdb port
+  //----------------------------------------------------------------------------
+  BackendConnection(const std::string& host, uint32_t port);
+
+  //----------------------------------------------------------------------------
+  //! Get underlying client
+  //----------------------------------------------------------------------------
+  inline qclient::QClient&
+  getClient()
+  {
+    return *mQcl;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Mark start of a request
+  //----------------------------------------------------------------------------
+  inline void
+  requestStarted()
+  {
+    ++mInFlight;
+  }
+
+  //----------------------------------------------------------------------------
+  //! Mark end of a request
+  //!
+  //! @param latency request duration
+  //----------------------------------------------------------------------------
+  void requestDone(std::chrono::microseconds latency);
+
+  //----------------------------------------------------------------------------
+  //! Get usage metrics, one <prefix>.<metric>=<value> per line
+  //!
+  //! @param prefix key prefix identifying the connection
+  //----------------------------------------------------------------------------
+  std::string getStats(const std::string& prefix) const;
+
+private:
+  std::unique_ptr<qclient::QClient> mQcl; ///< Backend client
+  std::atomic<uint64_t> mInFlight; ///< Number of requests in flight
+  std::atomic<uint64_t> mNumRequests; ///< Number of finished requests
+  std::atomic<uint64_t> mLatencyUs; ///< Cumulated latency of the requests
+  std::atomic<uint64_t> mMaxLatencyUs; ///< Max latency of a request
+};
+
+//------------------------------------------------------------------------------
+//! Pool of connections to one backend instance used for reads. Point lookups
+//! and large scans (SSCAN/HSCAN) use separate connections so that background
+//! scans do not delay interactive requests. Each thread sticks to one
+//! connection of each type so that its reads of a given type are not
+//! reordered. Writes go through the shared client returned by getInstance or
+//! the connection of the metadata flusher, hence a read on a pooled
+//! connection is not ordered with respect to the writes still in flight. The
+//! file and container services cover this for the metadata objects by
+//! checking the mutations pending in the flusher before reading them.
+//------------------------------------------------------------------------------
+class BackendPool
+{
+public:
+  //! Type of traffic
+  enum class Traffic { kLookup, kScan };
+
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param host quarkdb host
+  //! @param port quarkdb port
+  //! @param num_lookup number of connections for point lookups
+  //! @param num_scan number of connections for scans, if 0 then scans share
+  //!        the lookup connections
+  //----------------------------------------------------------------------------
+  BackendPool(const std::string& host, uint32_t port, uint32_t num_lookup,
+              uint32_t num_scan);
+
+  //----------------------------------------------------------------------------
+  //! Get connection assigned to the calling thread for the given traffic type
+  //----------------------------------------------------------------------------
+  BackendConnection* getConnection(Traffic traffic);
+
+  //----------------------------------------------------------------------------
+  //! Get usage metrics, one backend.<type>.<n>.<metric>=<value> per line
+  //!
+  //! @param lookup_idx number of the first lookup connection, incremented
+  //!        for every lookup connection of the pool
+  //! @param scan_idx number of the first scan connection, incremented for
+  //!        every scan connection of the pool
+  //----------------------------------------------------------------------------
+  std::string getStats(uint32_t& lookup_idx, uint32_t& scan_idx) const;
+
+private:
+  std::vector<std::unique_ptr<BackendConnection>> mLookupConns;
+  std::vector<std::unique_ptr<BackendConnection>> mScanConns;
+};
+
+//------------------------------------------------------------------------------
+//! Helper accounting for one request done on a pooled connection
+//------------------------------------------------------------------------------
+class BackendRequest
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param pool backend pool
+  //! @param traffic type of traffic
+  //----------------------------------------------------------------------------
+  BackendRequest(BackendPool* pool, BackendPool::Traffic traffic):
+    mConn(pool->getConnection(traffic)),
+    mStart(std::chrono::steady_clock::now())
+  {
+    mConn->requestStarted();
+  }
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~BackendRequest()
+  {
+    mConn->requestDone(std::chrono::duration_cast<std::chrono::microseconds>
+                       (std::chrono::steady_clock::now() - mStart));
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get client to be used for the request
+  //----------------------------------------------------------------------------
+  inline qclient::QClient&
+  getClient()
+  {
+    return mConn->getClient();
+  }
+
+private:
+  BackendConnection* mConn; ///< Connection used
+  std::chrono::steady_clock::time_point mStart; ///< Start of the request
+};
+
 //------------------------------------------------------------------------------
 //! Singleton client class used throughout the namespace implementation
 //------------------------------------------------------------------------------
@@ -60,12 +208,59 @@ public:
   static qclient::QClient* getInstance(const std::string& host = "",
                                        uint32_t port = 0);
 
+  //----------------------------------------------------------------------------
+  //! Create a connection which is not shared with the rest of the namespace,
+  //! needed by users keeping per-connection state e.g. MULTI/EXEC
+  //!
+  //! @param host quarkdb host
+  //! @param port quarkdb port
+  //!
+  //! @return new qclient object owned by the caller
+  //----------------------------------------------------------------------------
+  static qclient::QClient* createClient(const std::string& host = "",
+                                        uint32_t port = 0);
+
+  //----------------------------------------------------------------------------
+  //! Get connection pool for a particular quarkdb instance
+  //!
+  //! @param host quarkdb host
+  //! @param port quarkdb port
+  //!
+  //! @return connection pool
+  //----------------------------------------------------------------------------
+  static BackendPool* getPool(const std::string& host = "", uint32_t port = 0);
+
+  //----------------------------------------------------------------------------
+  //! Set the number of lookup connections of the pools created from now on
+  //!
+  //! @param num_lookup number of connections for point lookups
+  //----------------------------------------------------------------------------
+  static void setLookupConns(uint32_t num_lookup);
+
+  //----------------------------------------------------------------------------
+  //! Set the number of scan connections of the pools created from now on
+  //!
+  //! @param num_scan number of connections for scans, 0 to share the lookup
+  //!        connections
+  //----------------------------------------------------------------------------
+  static void setScanConns(uint32_t num_scan);
+
+  //----------------------------------------------------------------------------
+  //! Get usage metrics of all the connection pools, one key=value per line.
+  //! The connections are numbered across all the pools.
+  //----------------------------------------------------------------------------
+  static std::string getPoolStats();
+
 private:
   static std::atomic<qclient::QClient*> sQdbClient;
   static std::string sQdbHost; ///< quarkdb instance host
   static int sQdbPort;         ///< quarkddb instance port
   static std::map<std::string, qclient::QClient*> pMapClients;
   static std::mutex pMutexMap; ///< Mutex to protect the access to the map
+  //! Connection pools per quarkdb instance, protected by pMutexMap
+  static std::map<std::string, BackendPool*> pMapPools;
+  static uint32_t sNumLookupConns; ///< Lookup connections per pool
+  static uint32_t sNumScanConns; ///< Scan connections per pool
 };
 
 EOSNSNAMESPACE_END
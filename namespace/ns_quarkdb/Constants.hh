@@ -54,6 +54,11 @@ static const std::string sFirstFreeCid{"first_free_cid"};
 static const std::string sSetCheckFiles{"files_set_check"};
 //! Set of containers that need to be rechecked
 static const std::string sSetCheckConts{"conts_set_check"};
+//! Field in meta info map holding the last file id committed by an
+//! in-progress conversion from the in-memory namespace
+static const std::string sConvertFileCkpt{"convert_file_ckpt"};
+//! Field in meta info map marking the containers as converted
+static const std::string sConvertContsDone{"convert_conts_done"};
 }
 
 //! Variable associated with the QuotaView
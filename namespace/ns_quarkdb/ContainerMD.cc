@@ -24,9 +24,13 @@
 #include "namespace/utils/StringConvertion.hh"
 #include <sys/stat.h>
 #include <algorithm>
+#include <iterator>
 
 EOSNSNAMESPACE_BEGIN
 
+const std::uint64_t ContainerMD::sPageSize = 1024;
+const std::uint64_t ContainerMD::sMaxCachedLookups = 16384;
+
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
@@ -37,7 +41,7 @@ ContainerMD::ContainerMD(id_t id, IFileMDSvc* file_svc,
     pTreeSize(0), pContSvc(cont_svc), pFileSvc(file_svc),
     pFilesKey(stringify(id) + constants::sMapFilesSuffix),
     pDirsKey(stringify(id) + constants::sMapDirsSuffix),
-    mDirsMap(), mFilesMap()
+    mDirsIndex(), mFilesIndex()
 {
   ContainerMDSvc* impl_cont_svc = dynamic_cast<ContainerMDSvc*>(cont_svc);
 
@@ -48,6 +52,7 @@ ContainerMD::ContainerMD(id_t id, IFileMDSvc* file_svc,
   }
 
   pQcl = impl_cont_svc->pQcl;
+  pPool = impl_cont_svc->mPool;
   pFilesMap = qclient::QHash(*pQcl, pFilesKey);
   pDirsMap = qclient::QHash(*pQcl, pDirsKey);
 }
@@ -92,6 +97,7 @@ ContainerMD& ContainerMD::operator= (const ContainerMD& other)
   pFileSvc  = other.pFileSvc;
   // Note: pFiles and pSubContainers are not copied here
   pQcl      = other.pQcl;
+  pPool     = other.pPool;
   return *this;
 }
 
@@ -101,23 +107,23 @@ ContainerMD& ContainerMD::operator= (const ContainerMD& other)
 std::shared_ptr<IContainerMD>
 ContainerMD::findContainer(const std::string& name)
 {
-  auto iter = mDirsMap.find(name);
+  std::uint64_t id;
 
-  if (iter == mDirsMap.end()) {
+  if (!lookupChild(pDirsKey, mDirsIndex, name, id)) {
     return std::shared_ptr<IContainerMD>(nullptr);
   }
 
   std::shared_ptr<IContainerMD> cont(nullptr);
 
   try {
-    cont = pContSvc->getContainerMD(iter->second);
+    cont = pContSvc->getContainerMD(id);
   } catch (MDException& ex) {
     cont.reset();
   }
 
   // Curate the list of subcontainers in case entry is not found
   if (cont == nullptr) {
-    mDirsMap.erase(iter);
+    eraseChild(mDirsIndex, name);
 
     try {
       (void) pDirsMap.hdel(name);
@@ -137,15 +143,15 @@ ContainerMD::findContainer(const std::string& name)
 void
 ContainerMD::removeContainer(const std::string& name)
 {
-  auto it = mDirsMap.find(name);
+  std::uint64_t id;
 
-  if (it == mDirsMap.end()) {
+  if (!lookupChild(pDirsKey, mDirsIndex, name, id)) {
     MDException e(ENOENT);
     e.getMessage() << "Container " << name << " not found";
     throw e;
   }
 
-  mDirsMap.erase(it);
+  eraseChild(mDirsIndex, name);
 
   // Do async call to KV backend
   try {
@@ -164,27 +170,13 @@ void
 ContainerMD::addContainer(IContainerMD* container)
 {
   container->setParentId(pId);
-  auto ret = mDirsMap.insert(std::pair<std::string, IContainerMD::id_t>(
-                               container->getName(), container->getId()));
 
-  if (!ret.second) {
+  if (!insertChild(pDirsKey, mDirsIndex, container->getName(),
+                   container->getId())) {
     MDException e(EINVAL);
     e.getMessage() << "Failed to add subcontainer #" << container->getId();
     throw e;
   }
-
-  // Add to new container to KV backend
-  try {
-    if (!pDirsMap.hset(container->getName(), container->getId())) {
-      MDException e(EINVAL);
-      e.getMessage() << "Failed to add subcontainer #" << container->getId();
-      throw e;
-    }
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ECOMM);
-    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
-    throw e;
-  }
 }
 
 //------------------------------------------------------------------------------
@@ -193,26 +185,26 @@ ContainerMD::addContainer(IContainerMD* container)
 std::shared_ptr<IFileMD>
 ContainerMD::findFile(const std::string& name)
 {
-  auto iter = mFilesMap.find(name);
+  std::uint64_t id;
 
-  if (iter == mFilesMap.end()) {
+  if (!lookupChild(pFilesKey, mFilesIndex, name, id)) {
     return std::shared_ptr<IFileMD>(nullptr);
   }
 
   std::shared_ptr<IFileMD> file(nullptr);
 
   try {
-    file = pFileSvc->getFileMD(iter->second);
+    file = pFileSvc->getFileMD(id);
   } catch (MDException& e) {
     file.reset();
   }
 
   // Curate the list of files in case file entry is not found
   if (file == nullptr) {
-    mFilesMap.erase(iter);
+    eraseChild(mFilesIndex, name);
 
     try {
-      (void) pFilesMap.hdel(stringify(iter->second));
+      (void) pFilesMap.hdel(name);
     } catch (std::runtime_error& qdb_err) {
       MDException e(ECOMM);
       e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
@@ -230,27 +222,13 @@ void
 ContainerMD::addFile(IFileMD* file)
 {
   file->setContainerId(pId);
-  auto ret = mFilesMap.insert(
-               std::pair<std::string, IFileMD::id_t>(file->getName(), file->getId()));
 
-  if (!ret.second) {
+  if (!insertChild(pFilesKey, mFilesIndex, file->getName(), file->getId())) {
     MDException e(EINVAL);
     e.getMessage() << "Error, file #" << file->getId() << " already exists";
     throw e;
   }
 
-  try {
-    if (!pFilesMap.hset(file->getName(), file->getId())) {
-      MDException e(EINVAL);
-      e.getMessage() << "File #" << file->getId() << " already exists";
-      throw e;
-    }
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(EINVAL);
-    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
-    throw e;
-  }
-
   if (file->getSize() != 0u) {
     IFileMDChangeListener::Event e(file, IFileMDChangeListener::SizeChange, 0,
                                    0, file->getSize());
@@ -264,18 +242,16 @@ ContainerMD::addFile(IFileMD* file)
 void
 ContainerMD::removeFile(const std::string& name)
 {
-  IFileMD::id_t id;
-  auto iter = mFilesMap.find(name);
+  std::uint64_t id;
 
-  if (iter == mFilesMap.end()) {
+  if (!lookupChild(pFilesKey, mFilesIndex, name, id)) {
     MDException e(ENOENT);
     e.getMessage() << "Unknown file " << name << " in container " << pName;
     throw e;
-  } else {
-    id = iter->second;
-    mFilesMap.erase(iter);
   }
 
+  eraseChild(mFilesIndex, name);
+
   // Do async call to KV backend
   try {
     (void) pFilesMap.hdel(name);
@@ -301,7 +277,7 @@ ContainerMD::removeFile(const std::string& name)
 size_t
 ContainerMD::getNumFiles()
 {
-  return mFilesMap.size();
+  return countChildren(pFilesKey, mFilesIndex);
 }
 
 //----------------------------------------------------------------------------
@@ -310,7 +286,7 @@ ContainerMD::getNumFiles()
 size_t
 ContainerMD::getNumContainers()
 {
-  return mDirsMap.size();
+  return countChildren(pDirsKey, mDirsIndex);
 }
 
 //------------------------------------------------------------------------
@@ -322,24 +298,30 @@ ContainerMD::cleanUp()
 {
   std::shared_ptr<IFileMD> file;
 
-  for (auto && elem : mFilesMap) {
+  for (auto && elem : getAllChildren(pFilesKey, mFilesIndex)) {
     file = pFileSvc->getFileMD(elem.second);
     pFileSvc->removeFile(file.get());
   }
 
   file.reset();
-  mFilesMap.clear();
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+    mFilesIndex = ChildIndex();
+  }
   qclient::AsyncHandler ah;
   ah.Register(pQcl->del_async(pFilesKey), pQcl);
 
   // Remove all subcontainers
-  for (auto && elem : mDirsMap) {
+  for (auto && elem : getAllChildren(pDirsKey, mDirsIndex)) {
     std::shared_ptr<IContainerMD> cont = pContSvc->getContainerMD(elem.second);
     cont->cleanUp();
     pContSvc->removeContainer(cont.get());
   }
 
-  mDirsMap.clear();
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+    mDirsIndex = ChildIndex();
+  }
   ah.Register(pQcl->del_async(pDirsKey), pQcl);
 
   if (!ah.Wait()) {
@@ -366,7 +348,7 @@ ContainerMD::getNameFiles() const
 {
   std::set<std::string> set_files;
 
-  for (auto && elem : mFilesMap) {
+  for (auto && elem : getAllChildren(pFilesKey, mFilesIndex)) {
     set_files.insert(elem.first);
   }
 
@@ -381,13 +363,363 @@ ContainerMD::getNameContainers() const
 {
   std::set<std::string> set_dirs;
 
-  for (auto && elem : mDirsMap) {
+  for (auto && elem : getAllChildren(pDirsKey, mDirsIndex)) {
     set_dirs.insert(elem.first);
   }
 
   return set_dirs;
 }
 
+//------------------------------------------------------------------------------
+// List entries in name order
+//------------------------------------------------------------------------------
+std::string
+ContainerMD::listEntries(const std::string& token, size_t max_entries,
+                         std::vector<std::string>& entries)
+{
+  entries.clear();
+
+  if (max_entries == 0) {
+    return token;
+  }
+
+  // Each child map yields its first max_entries names after the token so the
+  // first max_entries of the merged sequence are the right ones
+  std::vector<std::string> names;
+  bool done = scanChildren(pFilesKey, mFilesIndex, token, max_entries, names);
+  done = scanChildren(pDirsKey, mDirsIndex, token, max_entries, names) && done;
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+
+  if (names.size() > max_entries) {
+    names.resize(max_entries);
+    done = false;
+  }
+
+  entries.swap(names);
+  return ((done || entries.empty()) ? std::string() : entries.back());
+}
+
+//------------------------------------------------------------------------------
+// Probe backend child map
+//------------------------------------------------------------------------------
+void
+ContainerMD::probeChildren(const std::string& key, ChildIndex& index)
+{
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+
+    if (index.mProbed) {
+      return;
+    }
+  }
+
+  ChildPage page;
+  fetchPage(key, page, "", sPageSize);
+  std::lock_guard<std::mutex> lock(mChildMutex);
+
+  // Another reader might have probed the map in the meantime
+  if (index.mProbed) {
+    return;
+  }
+
+  index.mProbed = true;
+
+  if (page.mEnd) {
+    // Small enough to be kept in memory
+    index.mMap.swap(page.mEntries);
+    index.mPage = ChildPage();
+    index.mLoaded = true;
+    index.mCount = index.mMap.size();
+  } else {
+    index.mMap.clear();
+    index.mPage = std::move(page);
+    index.mLoaded = false;
+    index.mCount = -1;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Look up child by name
+//------------------------------------------------------------------------------
+bool
+ContainerMD::lookupChild(const std::string& key, ChildIndex& index,
+                         const std::string& name, std::uint64_t& id)
+{
+  probeChildren(key, index);
+
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+    auto it = index.mMap.find(name);
+
+    if (it != index.mMap.end()) {
+      id = it->second;
+      return true;
+    }
+
+    if (index.mLoaded) {
+      return false;
+    }
+
+    // The listing page is kept up to date with the local modifications
+    it = index.mPage.mEntries.find(name);
+
+    if (it != index.mPage.mEntries.end()) {
+      id = it->second;
+      return true;
+    }
+  }
+
+  std::string sid;
+
+  try {
+    BackendRequest req(pPool, BackendPool::Traffic::kLookup);
+    sid = qclient::QHash(req.getClient(), key).hget(name);
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
+    throw e;
+  }
+
+  if (sid.empty()) {
+    return false;
+  }
+
+  id = std::stoull(sid);
+  std::lock_guard<std::mutex> lock(mChildMutex);
+  cacheChild(index, name, id);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Add child entry
+//------------------------------------------------------------------------------
+bool
+ContainerMD::insertChild(const std::string& key, ChildIndex& index,
+                         const std::string& name, std::uint64_t id)
+{
+  std::uint64_t old_id;
+
+  if (lookupChild(key, index, name, old_id)) {
+    return false;
+  }
+
+  try {
+    if (!qclient::QHash(*pQcl, key).hset(name, id)) {
+      return false;
+    }
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
+    throw e;
+  }
+
+  std::lock_guard<std::mutex> lock(mChildMutex);
+
+  if (index.mLoaded) {
+    index.mMap.emplace(name, id);
+  } else {
+    cacheChild(index, name, id);
+  }
+
+  if (index.mCount >= 0) {
+    ++index.mCount;
+  }
+
+  ChildPage& page = index.mPage;
+
+  if (page.mValid && (name > page.mFrom) &&
+      (page.mEnd || (!page.mEntries.empty() &&
+                     (name < page.mEntries.rbegin()->first)))) {
+    page.mEntries.emplace(name, id);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Remember the result of a point lookup
+//------------------------------------------------------------------------------
+void
+ContainerMD::cacheChild(ChildIndex& index, const std::string& name,
+                        std::uint64_t id)
+{
+  if (index.mMap.size() >= sMaxCachedLookups) {
+    index.mMap.clear();
+  }
+
+  index.mMap[name] = id;
+}
+
+//------------------------------------------------------------------------------
+// Drop child entry from the in-memory index
+//------------------------------------------------------------------------------
+void
+ContainerMD::eraseChild(ChildIndex& index, const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mChildMutex);
+  (void) index.mMap.erase(name);
+  (void) index.mPage.mEntries.erase(name);
+
+  if (index.mCount > 0) {
+    --index.mCount;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Get number of children
+//------------------------------------------------------------------------------
+size_t
+ContainerMD::countChildren(const std::string& key, ChildIndex& index)
+{
+  probeChildren(key, index);
+
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+
+    if (index.mLoaded) {
+      return index.mMap.size();
+    }
+
+    if (index.mCount >= 0) {
+      return index.mCount;
+    }
+  }
+
+  std::int64_t count;
+
+  try {
+    BackendRequest req(pPool, BackendPool::Traffic::kLookup);
+    count = qclient::QHash(req.getClient(), key).hlen();
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
+    throw e;
+  }
+
+  std::lock_guard<std::mutex> lock(mChildMutex);
+  index.mCount = count;
+  return count;
+}
+
+//------------------------------------------------------------------------------
+// Get all the children
+//------------------------------------------------------------------------------
+std::map<std::string, std::uint64_t>
+ContainerMD::getAllChildren(const std::string& key,
+                            const ChildIndex& index) const
+{
+  {
+    std::lock_guard<std::mutex> lock(mChildMutex);
+
+    if (index.mProbed && index.mLoaded) {
+      return index.mMap;
+    }
+  }
+
+  std::map<std::string, std::uint64_t> children;
+
+  try {
+    std::string cursor = "0";
+
+    do {
+      BackendRequest req(pPool, BackendPool::Traffic::kScan);
+      qclient::QHash map(req.getClient(), key);
+      auto reply = map.hscan(cursor, sPageSize);
+      cursor = reply.first;
+
+      for (auto && elem : reply.second) {
+        children.emplace(elem.first, std::stoull(elem.second));
+      }
+    } while (cursor != "0");
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ECOMM);
+    e.getMessage() << "Container #" << pId << " failed to get subentries: "
+                   << qdb_err.what();
+    throw e;
+  }
+
+  return children;
+}
+
+//------------------------------------------------------------------------------
+// Get names of the children following the token
+//------------------------------------------------------------------------------
+bool
+ContainerMD::scanChildren(const std::string& key, ChildIndex& index,
+                          const std::string& token, size_t max_entries,
+                          std::vector<std::string>& names)
+{
+  probeChildren(key, index);
+  std::unique_lock<std::mutex> lock(mChildMutex);
+  const std::map<std::string, std::uint64_t>* children = &index.mMap;
+
+  if (!index.mLoaded) {
+    bool hit = (index.mPage.mValid && (token >= index.mPage.mFrom));
+
+    if (hit && !index.mPage.mEnd) {
+      auto it = index.mPage.mEntries.upper_bound(token);
+      hit = ((size_t) std::distance(it, index.mPage.mEntries.end()) >=
+             max_entries);
+    }
+
+    if (!hit) {
+      // Fetch without holding the lock, concurrent listings of the same
+      // container simply overwrite each other's page
+      lock.unlock();
+      ChildPage page;
+      fetchPage(key, page, token, std::max<size_t>(max_entries, sPageSize));
+      lock.lock();
+      index.mPage = std::move(page);
+    }
+
+    children = &index.mPage.mEntries;
+  }
+
+  auto it = children->upper_bound(token);
+
+  for (size_t num = 0; (it != children->end()) && (num < max_entries);
+       ++it, ++num) {
+    names.push_back(it->first);
+  }
+
+  return ((it == children->end()) && (index.mLoaded || index.mPage.mEnd));
+}
+
+//------------------------------------------------------------------------------
+// Fetch page of children from the backend
+//------------------------------------------------------------------------------
+void
+ContainerMD::fetchPage(const std::string& key, ChildPage& page,
+                       const std::string& token, size_t min_entries) const
+{
+  page = ChildPage();
+  page.mFrom = token;
+  std::string cursor = (token.empty() ? "0" : "next:" + token);
+
+  try {
+    do {
+      BackendRequest req(pPool, BackendPool::Traffic::kScan);
+      qclient::QHash map(req.getClient(), key);
+      auto reply = map.hscan(cursor, sPageSize);
+      cursor = reply.first;
+
+      for (auto && elem : reply.second) {
+        if (elem.first > token) {
+          page.mEntries.emplace(elem.first, std::stoull(elem.second));
+        }
+      }
+    } while ((cursor != "0") && (page.mEntries.size() < min_entries));
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " " << qdb_err.what();
+    throw e;
+  }
+
+  page.mEnd = (cursor == "0");
+  page.mValid = true;
+}
+
 //------------------------------------------------------------------------------
 // Access checking helpers
 //------------------------------------------------------------------------------
@@ -828,41 +1160,17 @@ ContainerMD::deserialize(Buffer& buffer)
   }
 
   // Rebuild the file and subcontainer keys
-  std::string files_key = stringify(pId) + constants::sMapFilesSuffix;
-  pFilesMap.setKey(files_key);
-  std::string dirs_key = stringify(pId) + constants::sMapDirsSuffix;
-  pDirsMap.setKey(dirs_key);
-
-  // Grab the files and subcontainers
-  try {
-    std::string cursor = "0";
-    std::pair<std::string, std::unordered_map<std::string, std::string>> reply;
-
-    do {
-      reply = pFilesMap.hscan(cursor);
-      cursor = reply.first;
-
-      for (auto && elem : reply.second) {
-        mFilesMap.emplace(elem.first, std::stoull(elem.second));
-      }
-    } while (cursor != "0");
-
-    // Get the subcontainers
-    cursor = "0";
-
-    do {
-      reply = pDirsMap.hscan(cursor);
-      cursor = reply.first;
-
-      for (auto && elem : reply.second) {
-        mDirsMap.emplace(elem.first, std::stoull(elem.second));
-      }
-    } while (cursor != "0");
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ENOENT);
-    e.getMessage() << "Container #" << pId << "failed to get subentries";
-    throw e;
-  }
+  pFilesKey = stringify(pId) + constants::sMapFilesSuffix;
+  pFilesMap.setKey(pFilesKey);
+  pDirsKey = stringify(pId) + constants::sMapDirsSuffix;
+  pDirsMap.setKey(pDirsKey);
+
+  // The child maps are probed lazily on first access
+  std::lock_guard<std::mutex> lock(mChildMutex);
+  mFilesIndex = ChildIndex();
+  mFilesIndex.mProbed = false;
+  mDirsIndex = ChildIndex();
+  mDirsIndex.mProbed = false;
 }
 
 //------------------------------------------------------------------------------
@@ -27,7 +27,10 @@
 #include "namespace/interface/IContainerMD.hh"
 #include "namespace/interface/IFileMD.hh"
 #include "namespace/ns_quarkdb/BackendClient.hh"
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <sys/time.h>
 
 EOSNSNAMESPACE_BEGIN
@@ -386,6 +389,29 @@ public:
   //----------------------------------------------------------------------------
   std::set<std::string> getNameContainers() const;
 
+  //----------------------------------------------------------------------------
+  //! List the names of the files and subcontainers in name order, one page
+  //! at a time, without loading the full child maps in memory.
+  //!
+  //! @param token continuation token, empty to start from the beginning
+  //! @param max_entries maximum number of entries to return
+  //! @param entries vector filled with the names of the entries
+  //!
+  //! @return continuation token for the next call or empty string if there
+  //!         are no more entries
+  //----------------------------------------------------------------------------
+  std::string listEntries(const std::string& token, size_t max_entries,
+                          std::vector<std::string>& entries);
+
+  //----------------------------------------------------------------------------
+  //! Check if listEntries fetches the entries page by page from the backend
+  //----------------------------------------------------------------------------
+  inline bool
+  hasPagedListing() const
+  {
+    return true;
+  }
+
   //----------------------------------------------------------------------------
   //! Serialize the object to a buffer
   //----------------------------------------------------------------------------
@@ -409,6 +435,108 @@ protected:
   XAttrMap pXAttrs;
 
 private:
+  //! Sorted window of child entries fetched from the backend
+  struct ChildPage {
+    std::string mFrom; ///< Page holds the entries strictly after this name
+    std::map<std::string, std::uint64_t> mEntries; ///< Name to id map
+    bool mValid = false; ///< Page holds data
+    bool mEnd = false; ///< Page extends up to the last entry of the map
+  };
+
+  //! Child entries of one type i.e. files or subcontainers
+  struct ChildIndex {
+    //! Name to id map - holds all the children if mLoaded is true, otherwise
+    //! it only caches the point lookups done so far
+    std::map<std::string, std::uint64_t> mMap;
+    bool mLoaded = true; ///< All children are in mMap
+    bool mProbed = true; ///< Backend map size was probed
+    std::int64_t mCount = 0; ///< Number of children, -1 if not known
+    ChildPage mPage; ///< Last page used for listing
+  };
+
+  //! Number of entries fetched per HSCAN, child maps which fit in one page
+  //! are loaded completely in memory
+  static const std::uint64_t sPageSize;
+  //! Max number of cached lookups for child maps not loaded in memory
+  static const std::uint64_t sMaxCachedLookups;
+
+  //----------------------------------------------------------------------------
+  //! Probe the backend child map - load it completely if it fits in one page,
+  //! otherwise keep the first page for listing and do point lookups. Does
+  //! nothing if the map was already probed.
+  //----------------------------------------------------------------------------
+  void probeChildren(const std::string& key, ChildIndex& index);
+
+  //----------------------------------------------------------------------------
+  //! Look up child by name
+  //!
+  //! @return true if found, in which case id is set, otherwise false
+  //----------------------------------------------------------------------------
+  bool lookupChild(const std::string& key, ChildIndex& index,
+                   const std::string& name, std::uint64_t& id);
+
+  //----------------------------------------------------------------------------
+  //! Add child entry both in memory and in the backend
+  //!
+  //! @return true if added, false if an entry with the same name exists
+  //----------------------------------------------------------------------------
+  bool insertChild(const std::string& key, ChildIndex& index,
+                   const std::string& name, std::uint64_t id);
+
+  //----------------------------------------------------------------------------
+  //! Remember the result of a point lookup - requires mChildMutex
+  //----------------------------------------------------------------------------
+  void cacheChild(ChildIndex& index, const std::string& name,
+                  std::uint64_t id);
+
+  //----------------------------------------------------------------------------
+  //! Drop child entry from the in-memory index (not from the backend)
+  //----------------------------------------------------------------------------
+  void eraseChild(ChildIndex& index, const std::string& name);
+
+  //----------------------------------------------------------------------------
+  //! Get number of children
+  //----------------------------------------------------------------------------
+  size_t countChildren(const std::string& key, ChildIndex& index);
+
+  //----------------------------------------------------------------------------
+  //! Get all the children, straight from the backend if the child map is not
+  //! loaded in memory
+  //----------------------------------------------------------------------------
+  std::map<std::string, std::uint64_t>
+  getAllChildren(const std::string& key, const ChildIndex& index) const;
+
+  //----------------------------------------------------------------------------
+  //! Get the names of the children following the token in name order
+  //!
+  //! @param key backend child map key
+  //! @param index child index
+  //! @param token list entries strictly greater than this name
+  //! @param max_entries maximum number of entries to return
+  //! @param names vector to which the names are appended
+  //!
+  //! @return true if there are no more entries after the returned ones
+  //----------------------------------------------------------------------------
+  bool scanChildren(const std::string& key, ChildIndex& index,
+                    const std::string& token, size_t max_entries,
+                    std::vector<std::string>& names);
+
+  //----------------------------------------------------------------------------
+  //! Fetch page of children from the backend. This relies on the QuarkDB
+  //! HSCAN semantics: fields are returned in lexicographical order and the
+  //! cursor has the form "next:<field>" so the scan can start at any name.
+  //!
+  //! @param key backend child map key
+  //! @param page page to be filled
+  //! @param token fetch entries strictly greater than this name
+  //! @param min_entries minimum number of entries to fetch unless the end of
+  //!        the map is reached first
+  //!
+  //! @note must be called without holding mChildMutex
+  //----------------------------------------------------------------------------
+  void fetchPage(const std::string& key, ChildPage& page,
+                 const std::string& token, size_t min_entries) const;
+
   // Non-presistent data members
   mtime_t pMTime;
   tmtime_t pTMTime;
@@ -417,13 +545,16 @@ private:
   IContainerMDSvc* pContSvc;  ///< Container metadata service
   IFileMDSvc* pFileSvc;       ///< File metadata service
   qclient::QClient* pQcl;     ///< QClient object
+  BackendPool* pPool;         ///< Connection pool for lookups and scans
   std::string pFilesKey;      ///< Map files key
   std::string pDirsKey;       ///< Map dir key
-  qclient::QHash pFilesMap;   ///< Map holding info about files
-  qclient::QHash pDirsMap;    ///< Map holding info about subcontainers
-  //! Dir name to id map
-  std::map<std::string, eos::IContainerMD::id_t> mDirsMap;
-  std::map<std::string, eos::IFileMD::id_t> mFilesMap; ///< File name to id map
+  mutable qclient::QHash pFilesMap; ///< Map holding info about files
+  mutable qclient::QHash pDirsMap; ///< Map holding info about subcontainers
+  //! Mutex protecting the child indexes - these are filled lazily also by
+  //! callers holding only the namespace read lock
+  mutable std::mutex mChildMutex;
+  ChildIndex mDirsIndex; ///< Subcontainer name to id index
+  ChildIndex mFilesIndex; ///< File name to id index
 };
 
 EOSNSNAMESPACE_END
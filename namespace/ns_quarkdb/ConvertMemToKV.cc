@@ -23,6 +23,7 @@
 #include "namespace/ns_in_memory/persistency/ChangeLogConstants.hh"
 #include "namespace/ns_quarkdb/Constants.hh"
 #include "namespace/utils/StringConvertion.hh"
+#include "FileMd.pb.h"
 
 // Static global variable
 static std::string sBkndHost;
@@ -30,11 +31,126 @@ static std::uint32_t sBkndPort;
 static long long int sAsyncBatch = 128 * 256 - 1;
 static qclient::QClient* sQcl;
 static qclient::AsyncHandler sAh;
+//! If true the containers are already in the backend from a previous run
+static bool sContsCommitted = false;
 
 EOSNSNAMESPACE_BEGIN
 
 std::uint64_t ConvertContainerMDSvc::sNumContBuckets = 128 * 1024;
 std::uint64_t ConvertFileMDSvc::sNumFileBuckets = 1024 * 1024;
+std::uint64_t ConvertFileMDSvc::sBatchIds = 4096;
+std::uint64_t ConvertFileMDSvc::sMaxQueuedBatches = 1024;
+std::chrono::seconds ConvertCheckpoint::sCommitInterval(10);
+
+//------------------------------------------------------------------------------
+//           ************* ConvertCheckpoint Class ************
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+ConvertCheckpoint::ConvertCheckpoint(qclient::QClient* qcl,
+                                     std::uint64_t total):
+  mQcl(qcl), mTotal(total), mCount(0), mNextSeq(0), mCkptId(0),
+  mStart(std::time(nullptr)), mLastCommit(mStart), mLastCount(0)
+{}
+
+//------------------------------------------------------------------------------
+// Load checkpoint from the backend
+//------------------------------------------------------------------------------
+std::uint64_t
+ConvertCheckpoint::load()
+{
+  qclient::QHash meta_map(*mQcl, constants::sMapMetaInfoKey);
+  std::string sval = meta_map.hget(constants::sConvertFileCkpt);
+  std::lock_guard<std::mutex> scope_lock(mMutex);
+  mCkptId = (sval.empty() ? 0 : std::stoull(sval));
+  return mCkptId;
+}
+
+//------------------------------------------------------------------------------
+// Set first file id of the first batch
+//------------------------------------------------------------------------------
+void
+ConvertCheckpoint::setStart(std::uint64_t id)
+{
+  std::lock_guard<std::mutex> scope_lock(mMutex);
+  mCkptId = id;
+}
+
+//------------------------------------------------------------------------------
+// Mark batch as committed
+//------------------------------------------------------------------------------
+void
+ConvertCheckpoint::batchDone(std::uint64_t seq, std::uint64_t end_id,
+                             std::uint64_t num_files)
+{
+  bool do_commit = false;
+  {
+    std::lock_guard<std::mutex> scope_lock(mMutex);
+    mCount += num_files;
+    mDone[seq] = end_id;
+
+    // Advance the checkpoint over all the consecutive completed batches
+    for (auto it = mDone.begin();
+         (it != mDone.end()) && (it->first == mNextSeq);
+         it = mDone.erase(it)) {
+      mCkptId = it->second;
+      ++mNextSeq;
+    }
+
+    std::time_t now = std::time(nullptr);
+
+    if (std::chrono::seconds(now - mLastCommit) >= sCommitInterval) {
+      printProgress();
+      mLastCommit = now;
+      mLastCount = mCount;
+      do_commit = true;
+    }
+  }
+
+  if (do_commit) {
+    commit();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Save checkpoint in the backend
+//------------------------------------------------------------------------------
+void
+ConvertCheckpoint::commit()
+{
+  std::uint64_t ckpt_id;
+  {
+    std::lock_guard<std::mutex> scope_lock(mMutex);
+    ckpt_id = mCkptId;
+  }
+  qclient::QHash meta_map(*mQcl, constants::sMapMetaInfoKey);
+  meta_map.hset(constants::sConvertFileCkpt, ckpt_id);
+}
+
+//------------------------------------------------------------------------------
+// Print progress and throughput information - must be called with the mutex
+// locked
+//------------------------------------------------------------------------------
+void
+ConvertCheckpoint::printProgress()
+{
+  std::time_t now = std::time(nullptr);
+  std::uint64_t elapsed = (now > mStart ? now - mStart : 1);
+  std::uint64_t interval = (now > mLastCommit ? now - mLastCommit : 1);
+  double avg_rate = (double) mCount / elapsed;
+  double rate = (double)(mCount - mLastCount) / interval;
+  std::uint64_t eta = 0;
+
+  if (avg_rate > 0 && mTotal > mCount) {
+    eta = (mTotal - mCount) / avg_rate;
+  }
+
+  std::cout << "Processed " << mCount << "/" << mTotal << " files at "
+            << rate << " Hz (avg " << avg_rate << " Hz), checkpoint fid="
+            << mCkptId << ", ETA " << eta << " seconds" << std::endl;
+}
 
 //------------------------------------------------------------------------------
 //           ************* ConvertContainerMD Class ************
@@ -71,6 +187,11 @@ ConvertContainerMD::updateInternal()
 void
 ConvertContainerMD::addContainer(eos::IContainerMD* container)
 {
+  if (sContsCommitted) {
+    pSubContainers[container->getName()] = container->getId();
+    return;
+  }
+
   try {
     sAh.Register(pDirsMap.hset_async(container->getName(), container->getId()),
                  pDirsMap.getClient());
@@ -114,6 +235,16 @@ ConvertContainerMD::findFile(const std::string& name)
   return eos::ContainerMD::findFile(name);
 }
 
+//------------------------------------------------------------------------------
+// Add file only to the in-memory map
+//------------------------------------------------------------------------------
+bool
+ConvertContainerMD::addFileLocal(IFileMD* file)
+{
+  std::lock_guard<std::mutex> scope_lock(mMutexFiles);
+  return pFiles.insert(std::make_pair(file->getName(), file->getId())).second;
+}
+
 //------------------------------------------------------------------------------
 //         ************* ConvertContainerMDSvc Class ************
 //------------------------------------------------------------------------------
@@ -182,12 +313,17 @@ ConvertContainerMDSvc::recreateContainer(IdMap::iterator& it,
     }
   }
 
+  if (getFirstFreeId() <= container->getId()) {
+    mFirstFreeId = container->getId() + 1;
+  }
+
+  // Containers already committed by a previous run of the conversion
+  if (sContsCommitted) {
+    return;
+  }
+
   // Add container to the KV store
   try {
-    if (getFirstFreeId() <= container->getId()) {
-      mFirstFreeId = container->getId() + 1;
-    }
-
     ++count;
     std::string buffer(ebuff.getDataPtr(), ebuff.getSize());
     std::string sid = stringify(container->getId());
@@ -255,7 +391,8 @@ ConvertContainerMDSvc::getFirstFreeId()
 //------------------------------------------------------------------------------
 ConvertFileMDSvc::ConvertFileMDSvc():
   ChangeLogFileMDSvc(), mFirstFreeId(0), mConvQView(nullptr),
-  mConvFsView(nullptr), mCount(0)
+  mConvFsView(nullptr), mCount(0),
+  mNumWorkers(std::max(1u, std::thread::hardware_concurrency()))
 {}
 
 //------------------------------------------------------------------------------
@@ -292,94 +429,225 @@ ConvertFileMDSvc::initialize()
   pFollowStart = pChangeLog->getFirstOffset();
   FileMDScanner scanner(pIdMap, pSlaveMode);
   pFollowStart = pChangeLog->scanAllRecords(&scanner);
-  std::uint64_t total = pIdMap.size();
-  std::time_t start = std::time(nullptr);
+  const IFileMD::id_t max_id = scanner.getLargestId();
+  ConvertCheckpoint ckpt(sQcl, pIdMap.size());
+  IFileMD::id_t resume_id = ckpt.load();
 
-  // Recreate the files
-  for (auto && elem : pIdMap) {
-    ++mCount;
+  if (resume_id) {
+    std::cout << "Resume conversion, files with id < " << resume_id
+              << " are already in the backend" << std::endl;
+  } else {
+    resume_id = 1;
+  }
 
-    if ((mCount & sAsyncBatch) == 0) {
-      if (!sAh.WaitForAtLeast(sAsyncBatch)) {
-        std::cerr << __FUNCTION__ << " Got error response from the backend"
-                  << std::endl;
-        exit(1);
-      }
+  // Batches cover the file ids in increasing order so that the checkpoint
+  // is just a file id - file ids are never 0
+  ckpt.setStart(1);
+  eos::common::ConcurrentQueue<FileBatch> queue;
+  std::vector<std::thread> workers;
 
-      // Get the rate
-      auto now = std::time(nullptr);
+  for (std::uint32_t i = 0; i < mNumWorkers; ++i) {
+    workers.emplace_back(&ConvertFileMDSvc::convertWorker, this,
+                         std::ref(queue), std::ref(ckpt), resume_id);
+  }
 
-      if (now != (std::time_t)(-1)) {
-        std::chrono::seconds duration(now - start);
+  std::uint64_t seq = 0;
 
-        if (duration.count()) {
-          double rate = (double)mCount / duration.count();
-          std::cout << "Processed " << mCount << "/" << total << " files at "
-                    << rate << " Hz" << std::endl;
-        }
-      }
+  for (IFileMD::id_t start = 1; start <= max_id; start += sBatchIds) {
+    FileBatch batch {seq++, start, std::min(start + sBatchIds, max_id + 1)};
+
+    // Bound the memory used by the pending batches
+    while (!queue.push_size(batch, sMaxQueuedBatches)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+  }
 
-    // Unpack the serialized buffers
-    std::shared_ptr<IFileMD> file = std::make_shared<FileMD>(0, this);
+  for (std::uint32_t i = 0; i < mNumWorkers; ++i) {
+    FileBatch end_batch {0, 0, 0};
+    queue.push(end_batch);
+  }
 
-    if (eos::FileMD* tmp_fmd = dynamic_cast<FileMD*>(file.get())) {
-      tmp_fmd->deserialize(*elem.second.buffer);
-    }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  ckpt.commit();
+
+  // Attach orphans and name conflicts once the hierarchy is complete
+  for (auto& elem : mBrokenFiles) {
+    attachBroken(elem.first, elem.second.get());
+    std::string sid = stringify(elem.second->getId());
+    qclient::QHash bucket_map(*sQcl, getBucketKey(elem.second->getId()));
+    sAh.Register(bucket_map.hset_async(sid, serializeProto(elem.second.get())),
+                 bucket_map.getClient());
+  }
+
+  mBrokenFiles.clear();
+}
+
+//------------------------------------------------------------------------------
+// Conversion worker
+//------------------------------------------------------------------------------
+void
+ConvertFileMDSvc::convertWorker(eos::common::ConcurrentQueue<FileBatch>& queue,
+                                ConvertCheckpoint& ckpt,
+                                IFileMD::id_t resume_id)
+{
+  // Each worker uses its own connection to pipeline its writes
+  std::unique_ptr<qclient::QClient> qcl
+  {new qclient::QClient(sBkndHost, sBkndPort, true, true)};
+  qclient::AsyncHandler ah;
+  FileBatch batch;
 
-    // Attach to the hierarchy
-    if (file->getContainerId() == 0) {
-      continue;
+  while (true) {
+    queue.wait_pop(batch);
+
+    if (batch.mEnd == 0) {
+      break;
     }
 
-    {
-      // Update the first free id
-      std::lock_guard<std::mutex> scope_lock(mMutexFreeId);
+    std::uint64_t num_files = 0;
 
-      if (getFirstFreeId() <= file->getId()) {
-        mFirstFreeId = file->getId() + 1;
+    for (IFileMD::id_t id = batch.mStart; id < batch.mEnd; ++id) {
+      if (convertFile(id, (id >= resume_id), qcl.get(), ah)) {
+        ++num_files;
       }
     }
 
-    // Add file to the KV store
+    if (!ah.Wait()) {
+      std::cerr << __FUNCTION__ << " Got error response from the backend"
+                << std::endl;
+      exit(1);
+    }
+
+    mCount += num_files;
+    ckpt.batchDone(batch.mSeq, batch.mEnd, num_files);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Convert one file
+//------------------------------------------------------------------------------
+bool
+ConvertFileMDSvc::convertFile(IFileMD::id_t id, bool write,
+                              qclient::QClient* qcl, qclient::AsyncHandler& ah)
+{
+  // The map is not modified while the workers are running, only the entries
+  // which are owned by the current worker
+  auto it = pIdMap.find(id);
+
+  if ((it == pIdMap.end()) || (it->second.buffer == nullptr)) {
+    return false;
+  }
+
+  // Unpack the serialized buffers
+  std::shared_ptr<IFileMD> file = std::make_shared<FileMD>(0, this);
+
+  if (eos::FileMD* tmp_fmd = dynamic_cast<FileMD*>(file.get())) {
+    tmp_fmd->deserialize(*it->second.buffer);
+  }
+
+  // Free the memory used by the buffer
+  delete it->second.buffer;
+  it->second.buffer = nullptr;
+
+  // Attach to the hierarchy
+  if (file->getContainerId() == 0) {
+    return true;
+  }
+
+  {
+    // Update the first free id
+    std::lock_guard<std::mutex> scope_lock(mMutexFreeId);
+
+    if (getFirstFreeId() <= file->getId()) {
+      mFirstFreeId = file->getId() + 1;
+    }
+  }
+
+  std::shared_ptr<IContainerMD> cont;
+
+  try {
+    cont = pContSvc->getContainerMD(file->getContainerId());
+  } catch (MDException& e) {
+    cont = nullptr;
+  }
+
+  ConvertContainerMD* conv_cont = dynamic_cast<ConvertContainerMD*>(cont.get());
+
+  if (!cont || !conv_cont || !conv_cont->addFileLocal(file.get())) {
+    std::lock_guard<std::mutex> scope_lock(mMutexBroken);
+    mBrokenFiles.emplace_back((cont ? "name_conflicts" : "orphans"), file);
+    return true;
+  }
+
+  // Add file to the KV store
+  if (write) {
     try {
-      std::string buffer(elem.second.buffer->getDataPtr(),
-                         elem.second.buffer->getSize());
       std::string sid = stringify(file->getId());
-      qclient::QHash bucket_map(*sQcl, getBucketKey(file->getId()));
-      sAh.Register(bucket_map.hset_async(sid, buffer), bucket_map.getClient());
+      qclient::QHash bucket_map(*qcl, getBucketKey(file->getId()));
+      ah.Register(bucket_map.hset_async(sid, serializeProto(file.get())), qcl);
+      qclient::QHash files_map(*qcl, stringify(cont->getId()) +
+                               constants::sMapFilesSuffix);
+      ah.Register(files_map.hset_async(file->getName(), file->getId()), qcl);
     } catch (std::runtime_error& qdb_err) {
       MDException e(ENOENT);
       e.getMessage() << "File #" << file->getId() << " failed to contact backend";
       throw e;
     }
+  }
 
-    // Free the memory used by the buffer
-    delete elem.second.buffer;
-    elem.second.buffer = nullptr;
-    std::shared_ptr<IContainerMD> cont;
+  // Populate the FileSystemView and QuotaView
+  mConvQView->addQuotaInfo(file.get());
+  mConvFsView->addFileInfo(file.get());
+  return true;
+}
 
-    try {
-      cont = pContSvc->getContainerMD(file->getContainerId());
-    } catch (MDException& e) {
-      cont = nullptr;
-    }
+//------------------------------------------------------------------------------
+// Get protobuf representation of a file object
+//------------------------------------------------------------------------------
+std::string
+ConvertFileMDSvc::serializeProto(IFileMD* file)
+{
+  eos::ns::FileMdProto proto;
+  proto.set_id(file->getId());
+  proto.set_cont_id(file->getContainerId());
+  proto.set_uid(file->getCUid());
+  proto.set_gid(file->getCGid());
+  proto.set_size(file->getSize());
+  proto.set_layout_id(file->getLayoutId());
+  proto.set_flags(file->getFlags());
+  proto.set_name(file->getName());
+  proto.set_link_name(file->getLink());
+  IFileMD::ctime_t tspec;
+  file->getCTime(tspec);
+  proto.set_ctime(&tspec, sizeof(tspec));
+  file->getMTime(tspec);
+  proto.set_mtime(&tspec, sizeof(tspec));
+  Buffer checksum = file->getChecksum();
+  proto.set_checksum(checksum.getDataPtr(), checksum.getSize());
+
+  for (const auto& loc : file->getLocations()) {
+    proto.add_locations(loc);
+  }
 
-    if (!cont) {
-      attachBroken("orphans", file.get());
-      continue;
-    }
+  for (const auto& loc : file->getUnlinkedLocations()) {
+    proto.add_unlink_locations(loc);
+  }
 
-    if (cont->findFile(file->getName())) {
-      attachBroken("name_conflicts", file.get());
-      continue;
-    } else {
-      cont->addFile(file.get());
-      // Populate the FileSystemView and QuotaView
-      mConvQView->addQuotaInfo(file.get());
-      mConvFsView->addFileInfo(file.get());
-    }
+  for (const auto& elem : file->getAttributes()) {
+    (*proto.mutable_xattrs())[elem.first] = elem.second;
   }
+
+  std::string buffer;
+
+  if (!proto.SerializeToString(&buffer)) {
+    MDException e(EIO);
+    e.getMessage() << "File #" << file->getId() << " failed to serialize";
+    throw e;
+  }
+
+  return buffer;
 }
 
 //------------------------------------------------------------------------------
@@ -401,6 +669,15 @@ ConvertFileMDSvc::setViews(ConvertQuotaView* qview, ConvertFsView* fsview)
   mConvFsView = fsview;
 }
 
+//------------------------------------------------------------------------------
+// Set number of conversion workers
+//------------------------------------------------------------------------------
+void
+ConvertFileMDSvc::setNumWorkers(std::uint32_t num_workers)
+{
+  mNumWorkers = (num_workers ? num_workers : 1);
+}
+
 //------------------------------------------------------------------------------
 //         ************* ConvertQuotaView Class ************
 //------------------------------------------------------------------------------
@@ -559,6 +836,28 @@ ConvertFsView::addFileInfo(IFileMD* file)
   }
 }
 
+//------------------------------------------------------------------------------
+// Add the members to a set. The commit is re-run when a conversion is resumed
+// so members might already be there: SADD then only counts the new ones and
+// the check is done on the size of the set instead.
+//------------------------------------------------------------------------------
+bool
+ConvertFsView::bulkAdd(qclient::QSet& set, const std::list<std::string>& lst)
+{
+  try {
+    long long int added = set.sadd(lst);
+
+    if (added == (long long int) lst.size()) {
+      return true;
+    }
+
+    return (set.scard() >= (long long int) lst.size());
+  } catch (std::runtime_error& qdb_err) {
+    std::cerr << __FUNCTION__ << " " << qdb_err.what() << std::endl;
+    return false;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Commit all of the fs view information to the backend
 //------------------------------------------------------------------------------
@@ -582,7 +881,7 @@ ConvertFsView::commitToBackend()
       lst_elem.clear();
       lst_elem.assign(fs_elem.second.first.begin(), fs_elem.second.first.end());
 
-      if (fs_set.sadd(lst_elem) != (long long int)lst_elem.size()) {
+      if (!bulkAdd(fs_set, lst_elem)) {
         std::cerr << "Error whlie doing bulk sadd operations!" << std::endl;
         exit(1);
       }
@@ -595,7 +894,7 @@ ConvertFsView::commitToBackend()
       lst_elem.clear();
       lst_elem.assign(fs_elem.second.second.begin(), fs_elem.second.second.end());
 
-      if (fs_set.sadd(lst_elem) != (long long int)lst_elem.size()) {
+      if (!bulkAdd(fs_set, lst_elem)) {
         std::cerr << "Error whlie doing bulk sadd operations!" << std::endl;
         exit(1);
       }
@@ -606,7 +905,7 @@ ConvertFsView::commitToBackend()
   lst_elem.clear();
   lst_elem.assign(mFileNoReplica.begin(), mFileNoReplica.end());
 
-  if (fs_set.sadd(lst_elem) != (long long int)lst_elem.size()) {
+  if (!lst_elem.empty() && !bulkAdd(fs_set, lst_elem)) {
     std::cerr << "Error whlie doing bulk sadd operations!" << std::endl;
     exit(1);
   }
@@ -630,12 +929,15 @@ usage()
 {
   std::cerr << "Usage:                                            " << std::endl
             << "  ./convert_mem_to_kv <file_chlog> <dir_chlog> <bknd_host> "
-            << "<bknd_port>" << std::endl
-            << "    file_chlog - file changelog                   " << std::endl
-            << "    dir_chlog  - directory changelog              " << std::endl
-            << "    bknd_host  - Backend host destination         " << std::endl
-            << "    bknd_port  - Backend port destination         "
-            << std::endl;
+            << "<bknd_port> [num_workers]" << std::endl
+            << "    file_chlog  - file changelog                  " << std::endl
+            << "    dir_chlog   - directory changelog             " << std::endl
+            << "    bknd_host   - Backend host destination        " << std::endl
+            << "    bknd_port   - Backend port destination        " << std::endl
+            << "    num_workers - Number of file conversion workers, default "
+            << "number of cores" << std::endl
+            << "  An interrupted conversion is resumed when run again with the "
+            << "same backend." << std::endl;
 }
 //------------------------------------------------------------------------------
 // Main function
@@ -643,7 +945,7 @@ usage()
 int
 main(int argc, char* argv[])
 {
-  if (argc != 5) {
+  if ((argc != 5) && (argc != 6)) {
     usage();
     return 1;
   }
@@ -695,8 +997,29 @@ main(int argc, char* argv[])
 
     conv_cont_svc->setQuotaView(quota_view.get());
     conv_file_svc->setViews(quota_view.get(), fs_view.get());
+
+    if (argc == 6) {
+      conv_file_svc->setNumWorkers(std::stoul(argv[5]));
+    }
+
+    qclient::QHash meta_map {*sQcl, eos::constants::sMapMetaInfoKey};
+    sContsCommitted = !meta_map.hget(eos::constants::sConvertContsDone).empty();
+
+    if (sContsCommitted) {
+      std::cout << "Resume conversion, containers are already in the backend"
+                << std::endl;
+    }
+
     std::time_t cont_start = std::time(nullptr);
     cont_svc->initialize();
+
+    if (!sAh.Wait()) {
+      std::cerr << __FUNCTION__ << " Got error response from the backend"
+                << std::endl;
+      exit(1);
+    }
+
+    meta_map.hset(eos::constants::sConvertContsDone, 1);
     std::chrono::seconds cont_duration {std::time(nullptr) - cont_start};
     std::cout << "Container init: " << cont_duration.count() << " seconds" <<
               std::endl;
@@ -725,9 +1048,11 @@ main(int argc, char* argv[])
               std::endl;
     // Save the first free file and container id in the meta_hmap - actually it is
     // the last id since we get the first free id by doing a hincrby operation
-    qclient::QHash meta_map {*sQcl, eos::constants::sMapMetaInfoKey};
     meta_map.hset(eos::constants::sFirstFreeFid, file_svc->getFirstFreeId() - 1);
     meta_map.hset(eos::constants::sFirstFreeCid, cont_svc->getFirstFreeId() - 1);
+    // Conversion complete, drop the checkpoint information
+    meta_map.hdel(eos::constants::sConvertFileCkpt);
+    meta_map.hdel(eos::constants::sConvertContsDone);
   } catch (std::runtime_error& e) {
     std::cerr << e.what() << std::endl;
     return 1;
@@ -30,13 +30,95 @@
 #include "namespace/ns_in_memory/persistency/ChangeLogContainerMDSvc.hh"
 #include "namespace/ns_in_memory/persistency/ChangeLogFileMDSvc.hh"
 #include "namespace/ns_quarkdb/BackendClient.hh"
+#include "common/ConcurrentQueue.hh"
 #include "common/RWMutex.hh"
+#include <chrono>
 #include <cstdint>
+#include <list>
+#include <set>
+#include <thread>
 
 EOSNSNAMESPACE_BEGIN
 
 using QuotaNodeMapT = std::map<std::string, eos::IQuotaNode::UsageInfo>;
 
+//------------------------------------------------------------------------------
+//! Class ConvertCheckpoint
+//!
+//! Tracks the batches of file ids committed to the backend by the conversion
+//! workers. Batches can complete out of order, therefore the checkpoint is the
+//! end of the longest sequence of consecutive completed batches i.e. all the
+//! file ids below it are in the backend. The checkpoint is periodically saved
+//! in the backend so that an interrupted conversion can be resumed.
+//------------------------------------------------------------------------------
+class ConvertCheckpoint
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param qcl qclient object
+  //! @param total total number of files to convert
+  //----------------------------------------------------------------------------
+  ConvertCheckpoint(qclient::QClient* qcl, std::uint64_t total);
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~ConvertCheckpoint() {};
+
+  //----------------------------------------------------------------------------
+  //! Load checkpoint from the backend
+  //!
+  //! @return first file id not yet committed to the backend, 0 if there is
+  //!         no conversion to resume
+  //----------------------------------------------------------------------------
+  std::uint64_t load();
+
+  //----------------------------------------------------------------------------
+  //! Set the first file id covered by the batch with sequence number 0
+  //!
+  //! @param id first file id
+  //----------------------------------------------------------------------------
+  void setStart(std::uint64_t id);
+
+  //----------------------------------------------------------------------------
+  //! Mark batch as committed to the backend
+  //!
+  //! @param seq batch sequence number
+  //! @param end_id first file id after the batch
+  //! @param num_files number of files in the batch
+  //----------------------------------------------------------------------------
+  void batchDone(std::uint64_t seq, std::uint64_t end_id,
+                 std::uint64_t num_files);
+
+  //----------------------------------------------------------------------------
+  //! Save current checkpoint in the backend
+  //----------------------------------------------------------------------------
+  void commit();
+
+private:
+  //! Interval between checkpoint saves and progress reports
+  static std::chrono::seconds sCommitInterval;
+
+  //----------------------------------------------------------------------------
+  //! Print progress and throughput information
+  //----------------------------------------------------------------------------
+  void printProgress();
+
+  qclient::QClient* mQcl; ///< Qclient object
+  std::mutex mMutex; ///< Mutex protecting access to the members below
+  std::uint64_t mTotal; ///< Total number of files
+  std::uint64_t mCount; ///< Number of files committed
+  std::uint64_t mNextSeq; ///< Sequence number of first batch not committed
+  std::uint64_t mCkptId; ///< All file ids below this are committed
+  std::map<std::uint64_t, std::uint64_t> mDone; ///< Out of order batches
+  std::time_t mStart; ///< Start timestamp
+  std::time_t mLastCommit; ///< Timestamp of last checkpoint save
+  std::uint64_t mLastCount; ///< Number of files at last checkpoint save
+};
+
+
 //------------------------------------------------------------------------------
 //! Class ConvertQuotaView
 //------------------------------------------------------------------------------
@@ -105,6 +187,16 @@ public:
   void commitToBackend();
 
 private:
+  //----------------------------------------------------------------------------
+  //! Add members to a backend set, members already present are accepted
+  //!
+  //! @param set backend set
+  //! @param lst members to add
+  //!
+  //! @return true if successful, otherwise false
+  //----------------------------------------------------------------------------
+  static bool bulkAdd(qclient::QSet& set, const std::list<std::string>& lst);
+
   std::set<std::string> mFileNoReplica; ///< Set of files with no replica
   //! Map of file system ids to set of file replicas and set of unlinked file ids
   std::map<std::string, std::pair<std::set<std::string>,
@@ -144,6 +236,17 @@ public:
   //----------------------------------------------------------------------------
   std::shared_ptr<IFileMD> findFile(const std::string& name) override;
 
+  //----------------------------------------------------------------------------
+  //! Add file only to the in-memory map, the backend update being done by the
+  //! caller. The lookup and the insertion are done atomically so that it can
+  //! be used by concurrent conversion workers.
+  //!
+  //! @param file file object
+  //!
+  //! @return true if file added, false if there is a name conflict
+  //----------------------------------------------------------------------------
+  bool addFileLocal(IFileMD* file);
+
   //----------------------------------------------------------------------------
   //! Update the name of the directories and files hmap based on the id of the
   //! container. This should be called after a deserialize.
@@ -244,8 +347,60 @@ public:
   //----------------------------------------------------------------------------
   void setViews(ConvertQuotaView* qview, ConvertFsView* fsview);
 
+  //----------------------------------------------------------------------------
+  //! Set number of conversion workers
+  //!
+  //! @param num_workers number of workers
+  //----------------------------------------------------------------------------
+  void setNumWorkers(std::uint32_t num_workers);
+
 private:
   static std::uint64_t sNumFileBuckets; ///< Numnber of buckets power of 2
+  static std::uint64_t sBatchIds; ///< Number of file ids in a batch
+  static std::uint64_t sMaxQueuedBatches; ///< Max batches waiting for workers
+
+  //! Range of file ids [mStart, mEnd) processed by a conversion worker. A batch
+  //! with mEnd equal to 0 tells the worker to exit.
+  struct FileBatch {
+    std::uint64_t mSeq;
+    IFileMD::id_t mStart;
+    IFileMD::id_t mEnd;
+  };
+
+  //----------------------------------------------------------------------------
+  //! Conversion worker - takes batches from the queue, serializes the files
+  //! to their protobuf representation and pipelines the backend writes over
+  //! its own connection.
+  //!
+  //! @param queue queue of batches
+  //! @param ckpt checkpoint object
+  //! @param resume_id file ids below this are already in the backend
+  //----------------------------------------------------------------------------
+  void convertWorker(eos::common::ConcurrentQueue<FileBatch>& queue,
+                     ConvertCheckpoint& ckpt, IFileMD::id_t resume_id);
+
+  //----------------------------------------------------------------------------
+  //! Convert one file and attach it to the hierarchy
+  //!
+  //! @param id file id
+  //! @param write if true update the backend, otherwise only the in-memory
+  //!        structures are rebuilt
+  //! @param qcl qclient object used for the backend writes
+  //! @param ah async handler collecting the backend replies
+  //!
+  //! @return true if file found, otherwise false
+  //----------------------------------------------------------------------------
+  bool convertFile(IFileMD::id_t id, bool write, qclient::QClient* qcl,
+                   qclient::AsyncHandler& ah);
+
+  //----------------------------------------------------------------------------
+  //! Get protobuf representation of a file object
+  //!
+  //! @param file file object
+  //!
+  //! @return serialized FileMdProto object
+  //----------------------------------------------------------------------------
+  static std::string serializeProto(IFileMD* file);
 
   //------------------------------------------------------------------------------
   //! Get file bucket
@@ -261,6 +416,10 @@ private:
   ConvertQuotaView* mConvQView; ///< Quota view object
   ConvertFsView* mConvFsView; ///< Filesystem view object
   std::atomic<std::uint64_t> mCount; ///< Number of files proccessed
+  std::uint32_t mNumWorkers; ///< Number of conversion workers
+  std::mutex mMutexBroken; ///< Mutex protecting the list of broken files
+  //! Orphan and name conflict files attached once all workers are done
+  std::list<std::pair<std::string, std::shared_ptr<IFileMD>>> mBrokenFiles;
 };
 
 EOSNSNAMESPACE_END
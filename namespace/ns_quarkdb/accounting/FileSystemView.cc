@@ -27,7 +27,7 @@ EOSNSNAMESPACE_BEGIN
 // Constructor
 //------------------------------------------------------------------------------
 FileSystemView::FileSystemView():
-  pQcl(BackendClient::getInstance()),
+  pQcl(BackendClient::getInstance()), mBkndPort(0),
   pNoReplicasSet(*pQcl, fsview::sNoReplicaPrefix),
   pFsIdsSet(*pQcl, fsview::sSetFsIds)
 {
@@ -228,10 +228,14 @@ FileSystemView::getFileList(IFileMD::location_t location)
   std::pair<std::string, std::vector<std::string>> reply;
   std::string cursor {"0"};
   long long count = 10000;
-  qclient::QSet fs_set(*pQcl, key);
+  BackendPool* pool = getPool();
 
   do {
-    reply = fs_set.sscan(cursor, count);
+    {
+      BackendRequest req(pool, BackendPool::Traffic::kScan);
+      qclient::QSet fs_set(req.getClient(), key);
+      reply = fs_set.sscan(cursor, count);
+    }
     cursor = reply.first;
 
     for (const auto& elem : reply.second) {
@@ -254,10 +258,14 @@ FileSystemView::getUnlinkedFileList(IFileMD::location_t location)
   std::pair<std::string, std::vector<std::string>> reply;
   std::string cursor = {"0"};
   long long count = 10000;
-  qclient::QSet fs_set(*pQcl, key);
+  BackendPool* pool = getPool();
 
   do {
-    reply = fs_set.sscan(cursor, count);
+    {
+      BackendRequest req(pool, BackendPool::Traffic::kScan);
+      qclient::QSet fs_set(req.getClient(), key);
+      reply = fs_set.sscan(cursor, count);
+    }
     cursor = reply.first;
 
     for (const auto& elem : reply.second) {
@@ -279,9 +287,14 @@ FileSystemView::getNoReplicasFileList()
   std::pair<std::string, std::vector<std::string>> reply;
   std::string cursor {"0"};
   long long count = 10000;
+  BackendPool* pool = getPool();
 
   do {
-    reply = pNoReplicasSet.sscan(cursor, count);
+    {
+      BackendRequest req(pool, BackendPool::Traffic::kScan);
+      qclient::QSet noreplicas_set(req.getClient(), fsview::sNoReplicaPrefix);
+      reply = noreplicas_set.sscan(cursor, count);
+    }
     cursor = reply.first;
 
     for (const auto& elem : reply.second) {
@@ -335,8 +348,20 @@ FileSystemView::initialize(const std::map<std::string, std::string>& config)
   }
 
   pQcl = BackendClient::getInstance(host, port);
+  mBkndHost = host;
+  mBkndPort = port;
   pNoReplicasSet.setClient(*pQcl);
   pFsIdsSet.setClient(*pQcl);
 }
 
+//------------------------------------------------------------------------------
+// Get the connection pool of the backend, created by the first scan so that
+// it connects to the configured instance
+//------------------------------------------------------------------------------
+BackendPool*
+FileSystemView::getPool()
+{
+  return BackendClient::getPool(mBkndHost, mBkndPort);
+}
+
 EOSNSNAMESPACE_END
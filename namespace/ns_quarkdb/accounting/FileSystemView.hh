@@ -156,7 +156,14 @@ public:
   void RemoveTree(IContainerMD* obj, int64_t dsize) {};
 
 private:
+  //----------------------------------------------------------------------------
+  //! Get the connection pool used for scans
+  //----------------------------------------------------------------------------
+  BackendPool* getPool();
+
   qclient::QClient* pQcl;    ///< QClient object
+  std::string mBkndHost; ///< quarkdb host, empty for the default instance
+  uint32_t mBkndPort; ///< quarkdb port, 0 for the default instance
   qclient::QSet pNoReplicasSet; ///< Set of file ids without replicas
   qclient::QSet pFsIdsSet; ///< Set of file ids in use
 };
@@ -33,8 +33,9 @@ std::uint64_t ContainerMDSvc::sNumContBuckets = 128 * 1024;
 // Constructor
 //------------------------------------------------------------------------------
 ContainerMDSvc::ContainerMDSvc()
-  : pQuotaStats(nullptr), pFileSvc(nullptr), pQcl(nullptr), mMetaMap(),
-    pBkndHost(""), pBkndPort(0), mContainerCache(static_cast<uint64_t>(10e6))
+  : pQuotaStats(nullptr), pFileSvc(nullptr), pQcl(nullptr), mPool(nullptr),
+    mMetaMap(), pBkndHost(""), pBkndPort(0), mFlushInterval(5), mFlusher(),
+    mContainerCache(static_cast<uint64_t>(10e6))
 {
   // TODO (esindril): Make size of the container cache configurable
 }
@@ -47,6 +48,9 @@ ContainerMDSvc::configure(const std::map<std::string, std::string>& config)
 {
   const std::string key_host = "qdb_host";
   const std::string key_port = "qdb_port";
+  const std::string key_flush = "qdb_flush_interval_ms";
+  const std::string key_lookup_conns = "qdb_lookup_conns";
+  const std::string key_scan_conns = "qdb_scan_conns";
 
   if (config.find(key_host) != config.end()) {
     pBkndHost = config.at(key_host);
@@ -55,6 +59,18 @@ ContainerMDSvc::configure(const std::map<std::string, std::string>& config)
   if (config.find(key_port) != config.end()) {
     pBkndPort = std::stoul(config.at(key_port));
   }
+
+  if (config.find(key_flush) != config.end()) {
+    mFlushInterval = std::chrono::milliseconds(std::stoul(config.at(key_flush)));
+  }
+
+  if (config.find(key_lookup_conns) != config.end()) {
+    BackendClient::setLookupConns(std::stoul(config.at(key_lookup_conns)));
+  }
+
+  if (config.find(key_scan_conns) != config.end()) {
+    BackendClient::setScanConns(std::stoul(config.at(key_scan_conns)));
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -64,6 +80,7 @@ void
 ContainerMDSvc::initialize()
 {
   pQcl = BackendClient::getInstance(pBkndHost, pBkndPort);
+  mPool = BackendClient::getPool(pBkndHost, pBkndPort);
   mMetaMap.setKey(constants::sMapMetaInfoKey);
   mMetaMap.setClient(*pQcl);
 
@@ -73,6 +90,22 @@ ContainerMDSvc::initialize()
                    << "metadata service";
     throw e;
   }
+
+  mFlusher.reset(new MetadataFlusher(pBkndHost, pBkndPort, mFlushInterval));
+}
+
+//------------------------------------------------------------------------------
+// Finalize the container service
+//------------------------------------------------------------------------------
+void
+ContainerMDSvc::finalize()
+{
+  if (mFlusher && !mFlusher->synchronize()) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " failed to persist some container updates "
+                   << "- backend error";
+    throw e;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -88,13 +121,17 @@ ContainerMDSvc::getContainerMD(IContainerMD::id_t id)
     return cont;
   }
 
-  // If not in cache, then get it from the KV store
+  // If not in cache, then check the write-back journal and then the KV store
   std::string blob;
+  std::string sid = stringify(id);
+  std::string bucket_key = getBucketKey(id);
 
   try {
-    std::string sid = stringify(id);
-    qclient::QHash bucket_map(*pQcl, getBucketKey(id));
-    blob = bucket_map.hget(sid);
+    if (!mFlusher->getPending(bucket_key, sid, blob)) {
+      BackendRequest req(mPool, BackendPool::Traffic::kLookup);
+      qclient::QHash bucket_map(req.getClient(), bucket_key);
+      blob = bucket_map.hget(sid);
+    }
   } catch (std::runtime_error& qdb_err) {
     MDException e(ENOENT);
     e.getMessage() << "Container #" << id << " not found";
@@ -143,14 +180,11 @@ ContainerMDSvc::updateStore(IContainerMD* obj)
   eos::Buffer ebuff;
   obj->serialize(ebuff);
   std::string buffer(ebuff.getDataPtr(), ebuff.getSize());
-
-  try {
-    std::string sid = stringify(obj->getId());
-    qclient::QHash bucket_map(*pQcl, getBucketKey(obj->getId()));
-    bucket_map.hset(sid, buffer);
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ENOENT);
-    e.getMessage() << "File #" << obj->getId() << " failed to contact backend";
+  if (!mFlusher->hset(getBucketKey(obj->getId()), stringify(obj->getId()),
+                      buffer)) {
+    MDException e(ECOMM);
+    e.getMessage() << "Container #" << obj->getId()
+                   << " failed to contact backend";
     throw e;
   }
 }
@@ -169,19 +203,16 @@ ContainerMDSvc::removeContainer(IContainerMD* obj)
     throw e;
   }
 
-  try {
-    std::string sid = stringify(obj->getId());
-    qclient::QHash bucket_map(*pQcl, getBucketKey(obj->getId()));
-    bucket_map.hdel(sid);
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ENOENT);
-    e.getMessage() << "Container #" << obj->getId() << " not found. "
-                   << "The object was not created in this store!";
+  if (!mFlusher->hdel(getBucketKey(obj->getId()), stringify(obj->getId()))) {
+    MDException e(ECOMM);
+    e.getMessage() << "Container #" << obj->getId()
+                   << " failed to contact backend";
     throw e;
   }
 
   // If this was the root container i.e. id=1 then drop also the meta map
   if (obj->getId() == 1) {
+    (void) mFlusher->synchronize();
     (void) pQcl->del(constants::sMapMetaInfoKey);
   }
 
@@ -267,6 +298,8 @@ ContainerMDSvc::getNumContainers()
   std::uint64_t num_conts = 0;
   std::string bucket_key("");
   qclient::AsyncHandler ah;
+  // Make sure the backend reflects all the updates done so far
+  (void) mFlusher->synchronize();
 
   for (std::uint64_t i = 0; i < sNumContBuckets; ++i) {
     bucket_key = stringify(i);
@@ -28,6 +28,7 @@
 #include "namespace/interface/IContainerMDSvc.hh"
 #include "namespace/ns_quarkdb/Constants.hh"
 #include "namespace/ns_quarkdb/LRU.hh"
+#include "namespace/ns_quarkdb/persistency/MetadataFlusher.hh"
 #include "namespace/ns_quarkdb/accounting/QuotaStats.hh"
 #include <list>
 #include <map>
@@ -65,9 +66,9 @@ public:
   virtual void configure(const std::map<std::string, std::string>& config);
 
   //----------------------------------------------------------------------------
-  //! Finalize the container service
+  //! Finalize the container service - flushes all the pending mutations
   //----------------------------------------------------------------------------
-  virtual void finalize() {};
+  virtual void finalize();
 
   //----------------------------------------------------------------------------
   //! Get the container metadata information for the given container ID
@@ -82,7 +83,8 @@ public:
 
   //----------------------------------------------------------------------------
   //! Update the contaienr metadata in the backing store after the
-  //! ContainerMD object has been changed
+  //! ContainerMD object has been changed. The update is queued in the
+  //! write-back journal and reaches the backend asynchronously.
   //----------------------------------------------------------------------------
   virtual void updateStore(IContainerMD* obj);
 
@@ -173,9 +175,12 @@ private:
   IQuotaStats* pQuotaStats;  ///< Quota view
   IFileMDSvc* pFileSvc;      ///< File metadata service
   qclient::QClient* pQcl;    ///< QClient object
+  BackendPool* mPool;        ///< Connection pool for lookups and scans
   qclient::QHash mMetaMap ;  ///< Map holding metainfo about the namespace
   std::string pBkndHost;     ///< Backend host
   uint32_t pBkndPort;        ///< Backend port
+  std::chrono::milliseconds mFlushInterval; ///< Write-back flush interval
+  std::unique_ptr<MetadataFlusher> mFlusher; ///< Write-back journal
   LRU<IContainerMD::id_t, IContainerMD> mContainerCache;
   // TODO: decide on how to ensure container consistency in case of a crash
   qclient::QSet pCheckConts; ///< Set of container idsd to be checked
@@ -28,15 +28,14 @@
 EOSNSNAMESPACE_BEGIN
 
 std::uint64_t FileMDSvc::sNumFileBuckets(1024 * 1024);
-std::chrono::seconds FileMDSvc::sFlushInterval(5);
 
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
 FileMDSvc::FileMDSvc()
-  : pQuotaStats(nullptr), pContSvc(nullptr), mFlushTimestamp(std::time(nullptr)),
-    pBkendPort(0), pBkendHost(""), pQcl(nullptr), mMetaMap(),
-    mDirtyFidBackend(), mFlushFidSet(), mFileCache(10e6)
+  : pQuotaStats(nullptr), pContSvc(nullptr), pBkendPort(0), pBkendHost(""),
+    pQcl(nullptr), mPool(nullptr), mMetaMap(), mDirtyFidBackend(),
+    mFlushInterval(5), mFlusher(), mFileCache(10e6)
 {
   // TODO (esindril): Make size of the file cache configurable
 }
@@ -49,6 +48,9 @@ FileMDSvc::configure(const std::map<std::string, std::string>& config)
 {
   const std::string key_host = "qdb_host";
   const std::string key_port = "qdb_port";
+  const std::string key_flush = "qdb_flush_interval_ms";
+  const std::string key_lookup_conns = "qdb_lookup_conns";
+  const std::string key_scan_conns = "qdb_scan_conns";
 
   if (config.find(key_host) != config.end()) {
     pBkendHost = config.at(key_host);
@@ -57,6 +59,18 @@ FileMDSvc::configure(const std::map<std::string, std::string>& config)
   if (config.find(key_port) != config.end()) {
     pBkendPort = std::stoul(config.at(key_port));
   }
+
+  if (config.find(key_flush) != config.end()) {
+    mFlushInterval = std::chrono::milliseconds(std::stoul(config.at(key_flush)));
+  }
+
+  if (config.find(key_lookup_conns) != config.end()) {
+    BackendClient::setLookupConns(std::stoul(config.at(key_lookup_conns)));
+  }
+
+  if (config.find(key_scan_conns) != config.end()) {
+    BackendClient::setScanConns(std::stoul(config.at(key_scan_conns)));
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -72,10 +86,26 @@ FileMDSvc::initialize()
   }
 
   pQcl = BackendClient::getInstance(pBkendHost, pBkendPort);
+  mPool = BackendClient::getPool(pBkendHost, pBkendPort);
   mMetaMap.setKey(constants::sMapMetaInfoKey);
   mMetaMap.setClient(*pQcl);
   mDirtyFidBackend.setKey(constants::sSetCheckFiles);
   mDirtyFidBackend.setClient(*pQcl);
+  mFlusher.reset(new MetadataFlusher(pBkendHost, pBkendPort, mFlushInterval));
+}
+
+//------------------------------------------------------------------------------
+// Finalize the file service
+//------------------------------------------------------------------------------
+void
+FileMDSvc::finalize()
+{
+  if (mFlusher && !mFlusher->synchronize()) {
+    MDException e(ECOMM);
+    e.getMessage() << __FUNCTION__ << " failed to persist some file updates "
+                   << "- backend error";
+    throw e;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -91,13 +121,17 @@ FileMDSvc::getFileMD(IFileMD::id_t id)
     return file;
   }
 
-  // If not in cache, then get info from KV store
+  // If not in cache, then check the write-back journal and then the KV store
   std::string blob;
+  std::string sid = stringify(id);
+  std::string bucket_key = getBucketKey(id);
 
   try {
-    std::string sid = stringify(id);
-    qclient::QHash bucket_map(*pQcl, getBucketKey(id));
-    blob = bucket_map.hget(sid);
+    if (!mFlusher->getPending(bucket_key, sid, blob)) {
+      BackendRequest req(mPool, BackendPool::Traffic::kLookup);
+      qclient::QHash bucket_map(req.getClient(), bucket_key);
+      blob = bucket_map.hget(sid);
+    }
   } catch (std::runtime_error& qdb_err) {
     MDException e(ENOENT);
     e.getMessage() << "File #" << id << " not found";
@@ -145,18 +179,14 @@ FileMDSvc::updateStore(IFileMD* obj)
   eos::Buffer ebuff;
   obj->serialize(ebuff);
   std::string buffer(ebuff.getDataPtr(), ebuff.getSize());
-
-  try {
-    std::string sid = stringify(obj->getId());
-    qclient::QHash bucket_map(*pQcl, getBucketKey(obj->getId()));
-    bucket_map.hset(sid, buffer);
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ENOENT);
+  if (!mFlusher->hset(getBucketKey(obj->getId()), stringify(obj->getId()),
+                      buffer)) {
+    MDException e(ECOMM);
     e.getMessage() << "File #" << obj->getId() << " failed to contact backend";
     throw e;
   }
 
-  // Flush fids in bunches to avoid too many round trips to the backend
+  // The dirty mark is removed in the same batch, after the object update
   flushDirtySet(obj->getId());
 }
 
@@ -166,14 +196,9 @@ FileMDSvc::updateStore(IFileMD* obj)
 void
 FileMDSvc::removeFile(IFileMD* obj)
 {
-  try {
-    std::string sid = stringify(obj->getId());
-    qclient::QHash bucket_map(*pQcl, getBucketKey(obj->getId()));
-    bucket_map.hdel(sid);
-  } catch (std::runtime_error& qdb_err) {
-    MDException e(ENOENT);
-    e.getMessage() << "File #" << obj->getId() << " not found. ";
-    e.getMessage() << "The object was not created in this store!";
+  if (!mFlusher->hdel(getBucketKey(obj->getId()), stringify(obj->getId()))) {
+    MDException e(ECOMM);
+    e.getMessage() << "File #" << obj->getId() << " failed to contact backend";
     throw e;
   }
 
@@ -190,7 +215,7 @@ FileMDSvc::removeFile(IFileMD* obj)
 
   (void) impl_obj->waitAsyncReplies();
   mFileCache.remove(obj->getId());
-  flushDirtySet(obj->getId(), true);
+  flushDirtySet(obj->getId());
 }
 
 //------------------------------------------------------------------------------
@@ -203,6 +228,8 @@ FileMDSvc::getNumFiles()
   std::atomic<std::uint64_t> num_files(0);
   std::string bucket_key("");
   qclient::AsyncHandler ah;
+  // Make sure the backend reflects all the updates done so far
+  (void) mFlusher->synchronize();
 
   for (std::uint64_t i = 0; i < sNumFileBuckets; ++i) {
     bucket_key = stringify(i);
@@ -298,9 +325,14 @@ FileMDSvc::checkFiles()
   std::string cursor {"0"};
   std::pair<std::string, std::vector<std::string>> reply;
   std::list<std::string> to_drop;
+  (void) mFlusher->synchronize();
 
   do {
-    reply = mDirtyFidBackend.sscan(cursor);
+    {
+      BackendRequest req(mPool, BackendPool::Traffic::kScan);
+      qclient::QSet dirty_set(req.getClient(), constants::sSetCheckFiles);
+      reply = dirty_set.sscan(cursor);
+    }
     cursor = reply.first;
 
     for (auto && elem : reply.second) {
@@ -369,47 +401,47 @@ FileMDSvc::getBucketKey(IContainerMD::id_t id) const
 void
 FileMDSvc::addToDirtySet(IFileMD* file)
 {
-  // Remove from the set of fid to be flushed and update the backend only if
-  // wasn't in the set - optimize the number of RTT to backend.
+  // If the removal of the fid from the set is still waiting in the journal
+  // then the backend already holds the "dirty" mark - just drop the removal.
+  // If the removal is in flight then wait for it, otherwise it could reach
+  // the backend after the SADD below and drop the mark.
   IFileMD::id_t fid = file->getId();
 
-  if (mFlushFidSet.erase(stringify(fid)) == 0) {
-    try {
-      mDirtyFidBackend.sadd(fid);  // add to backend set
-    } catch (std::runtime_error& qdb_err) {
-      MDException e(ENOENT);
-      e.getMessage() << "File #" << fid
-                     << " failed to insert into the set of files to be checked "
-                     << "- got an exception";
-      throw e;
-    }
+  if (mFlusher->fence(constants::sSetCheckFiles, stringify(fid))) {
+    return;
+  }
+
+  // The mark must reach the backend before any of the updates done by the
+  // listeners therefore send it directly - the reply is collected together
+  // with the listener ones when the file object is serialized.
+  FileMD* impl_file = dynamic_cast<FileMD*>(file);
+
+  if (!impl_file) {
+    MDException e(EFAULT);
+    e.getMessage() << "FileMD dynamic cast failed";
+    throw e;
+  }
+
+  try {
+    impl_file->Register(mDirtyFidBackend.sadd_async(fid),
+                        mDirtyFidBackend.getClient());
+  } catch (std::runtime_error& qdb_err) {
+    MDException e(ENOENT);
+    e.getMessage() << "File #" << fid
+                   << " failed to insert into the set of files to be checked "
+                   << "- got an exception";
+    throw e;
   }
 }
 
 //------------------------------------------------------------------------------
-// Remove all accumulated file ids from the local "dirty" set and mark them in
-// the backend set accordingly.
+// Queue removal of the file id from the set of "dirty" files
 //------------------------------------------------------------------------------
 void
-FileMDSvc::flushDirtySet(IFileMD::id_t id, bool force)
+FileMDSvc::flushDirtySet(IFileMD::id_t id)
 {
-  (void) mFlushFidSet.insert(stringify(id));
-  std::time_t now = std::time(nullptr);
-  std::chrono::seconds duration(now - mFlushTimestamp);
-
-  if (force || (duration >= sFlushInterval)) {
-    mFlushTimestamp = now;
-    std::list<std::string> to_del(mFlushFidSet.begin(), mFlushFidSet.end());
-    mFlushFidSet.clear();
-
-    try {
-      mDirtyFidBackend.srem(to_del);
-    } catch (std::runtime_error& qdb_err) {
-      MDException e(ENOENT);
-      e.getMessage() << "Failed to clear set of dirty files - backend error";
-      throw e;
-    }
-  }
+  // A failure is reported by the object update queued just before
+  (void) mFlusher->srem(constants::sSetCheckFiles, stringify(id));
 }
 
 //------------------------------------------------------------------------------
@@ -428,4 +460,13 @@ FileMDSvc::getFirstFreeId()
   return id;
 }
 
+//------------------------------------------------------------------------------
+// Get usage metrics of the connections to the backend
+//------------------------------------------------------------------------------
+std::string
+FileMDSvc::getBackendStats()
+{
+  return BackendClient::getPoolStats();
+}
+
 EOSNSNAMESPACE_END
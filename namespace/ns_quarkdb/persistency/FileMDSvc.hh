@@ -27,6 +27,7 @@
 #include "namespace/interface/IFileMDSvc.hh"
 #include "namespace/ns_quarkdb/LRU.hh"
 #include "namespace/ns_quarkdb/BackendClient.hh"
+#include "namespace/ns_quarkdb/persistency/MetadataFlusher.hh"
 
 EOSNSNAMESPACE_BEGIN
 
@@ -61,9 +62,9 @@ public:
   virtual void configure(const std::map<std::string, std::string>& config);
 
   //----------------------------------------------------------------------------
-  //! Finalize the file service
+  //! Finalize the file service - flushes all the pending mutations
   //----------------------------------------------------------------------------
-  virtual void finalize() {};
+  virtual void finalize();
 
   //----------------------------------------------------------------------------
   //! Get the file metadata information for the given file ID
@@ -79,7 +80,8 @@ public:
 
   //----------------------------------------------------------------------------
   //! Update the file metadata in the backing store after the FileMD object
-  //! has been changed
+  //! has been changed. The update is queued in the write-back journal and
+  //! reaches the backend asynchronously.
   //----------------------------------------------------------------------------
   virtual void updateStore(IFileMD* obj);
 
@@ -136,11 +138,24 @@ public:
   //----------------------------------------------------------------------------
   IFileMD::id_t getFirstFreeId();
 
+  //----------------------------------------------------------------------------
+  //! Get usage metrics of the connections to the backend
+  //----------------------------------------------------------------------------
+  std::string getBackendStats() override;
+
+  //----------------------------------------------------------------------------
+  //! Get file bucket which is computed as the id of the container  modulo the
+  //! number of file buckets.
+  //!
+  //! @param id file id
+  //!
+  //! @return file bucket key
+  //----------------------------------------------------------------------------
+  std::string getBucketKey(IContainerMD::id_t id) const;
+
 private:
   typedef std::list<IFileMDChangeListener*> ListenerList;
   static std::uint64_t sNumFileBuckets; ///< Number of buckets power of 2
-  //! Interval for backend flush of consistent file ids
-  static std::chrono::seconds sFlushInterval;
 
   //----------------------------------------------------------------------------
   //! Check file object consistency
@@ -157,16 +172,6 @@ private:
   //----------------------------------------------------------------------------
   void attachBroken(const std::string& parent, IFileMD* file);
 
-  //----------------------------------------------------------------------------
-  //! Get file bucket which is computed as the id of the container  modulo the
-  //! number of file buckets.
-  //!
-  //! @param id file id
-  //!
-  //! @return file bucket key
-  //----------------------------------------------------------------------------
-  std::string getBucketKey(IContainerMD::id_t id) const;
-
   //----------------------------------------------------------------------------
   //! Add file to consistency check list to recover it in case of a crash
   //!
@@ -175,24 +180,24 @@ private:
   void addToDirtySet(IFileMD* file);
 
   //----------------------------------------------------------------------------
-  //! Remove all accumulated objects from the local "dirty" set and mark them
-  //! in the backend set accordingly.
+  //! Queue removal of the file from the consistency check list. The removal
+  //! reaches the backend in the same batch as the file object update.
   //!
   //! @param id file id
-  //! @param force if true then force flush
   //----------------------------------------------------------------------------
-  void flushDirtySet(IFileMD::id_t id, bool force = false);
+  void flushDirtySet(IFileMD::id_t id);
 
   ListenerList pListeners; ///< List of listeners to notify of changes
   IQuotaStats* pQuotaStats; ///< Quota view
   IContainerMDSvc* pContSvc; ///< Container metadata service
-  std::time_t mFlushTimestamp; ///< Timestamp of the last dirty set flush
   uint32_t pBkendPort; ///< Backend instance port
   std::string pBkendHost; ///< Backend intance host
   qclient::QClient* pQcl; ///< QClient object
+  BackendPool* mPool; ///< Connection pool for lookups and scans
   qclient::QHash mMetaMap ; ///< Map holding metainfo about the namespace
   qclient::QSet mDirtyFidBackend; ///< Set of "dirty" files
-  std::set<std::string> mFlushFidSet; ///< Modified fids which are consistent
+  std::chrono::milliseconds mFlushInterval; ///< Write-back flush interval
+  std::unique_ptr<MetadataFlusher> mFlusher; ///< Write-back journal
   LRU<IFileMD::id_t, IFileMD> mFileCache; ///< Local cache of file objects
 };
 
@@ -0,0 +1,412 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "namespace/ns_quarkdb/persistency/MetadataFlusher.hh"
+#include "common/Logging.hh"
+#include <algorithm>
+#include <future>
+#include <vector>
+
+EOSNSNAMESPACE_BEGIN
+
+const std::uint64_t MetadataFlusher::sMaxPending = 500000;
+const std::chrono::seconds MetadataFlusher::sMaxRetryDelay(30);
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+MetadataFlusher::MetadataFlusher(const std::string& host, uint32_t port,
+                                 std::chrono::milliseconds interval):
+  mQcl(BackendClient::createClient(host, port)), mInterval(interval),
+  mEnqueuedSeq(0), mFlushedSeq(0), mNumFailures(0), mFailing(false),
+  mShutdown(false)
+{
+  mThread = std::thread(&MetadataFlusher::flusherThread, this);
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+MetadataFlusher::~MetadataFlusher()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mShutdown = true;
+  }
+  mCvFlush.notify_one();
+  mThread.join();
+}
+
+//------------------------------------------------------------------------------
+// Queue HSET mutation
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::hset(const std::string& key, const std::string& field,
+                      const std::string& value)
+{
+  return enqueue(key, field, OpType::kHset, value);
+}
+
+//------------------------------------------------------------------------------
+// Queue HDEL mutation
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::hdel(const std::string& key, const std::string& field)
+{
+  return enqueue(key, field, OpType::kHdel);
+}
+
+//------------------------------------------------------------------------------
+// Queue SADD mutation
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::sadd(const std::string& key, const std::string& member)
+{
+  return enqueue(key, member, OpType::kSadd);
+}
+
+//------------------------------------------------------------------------------
+// Queue SREM mutation
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::srem(const std::string& key, const std::string& member)
+{
+  return enqueue(key, member, OpType::kSrem);
+}
+
+//------------------------------------------------------------------------------
+// Add mutation to the journal
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::enqueue(const std::string& key, const std::string& field,
+                         OpType type, const std::string& value)
+{
+  auto pair_key = std::make_pair(key, field);
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  // Wait for the flusher to take the journal once it's full, unless the
+  // mutation only overwrites an existing entry. Reject the mutation instead
+  // of queueing it up behind a failing backend.
+  while ((mPending.size() >= sMaxPending) && !mShutdown &&
+         (mPending.find(pair_key) == mPending.end())) {
+    if (mFailing) {
+      eos_static_err("msg=\"rejecting metadata update, journal full and "
+                     "backend failing\" key=\"%s\" pending=%lu",
+                     key.c_str(), mPending.size());
+      return false;
+    }
+
+    mCvFlush.notify_one();
+    mCvDone.wait(lock);
+  }
+
+  Mutation& mut = mPending[pair_key];
+  mut.mType = type;
+  mut.mValue = value;
+  ++mEnqueuedSeq;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Order the queued mutations of a (key, field) before a direct request
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::fence(const std::string& key, const std::string& field)
+{
+  auto pair_key = std::make_pair(key, field);
+  std::unique_lock<std::mutex> lock(mMutex);
+  bool dropped = false;
+  bool waited = false;
+
+  // A failed in-flight batch is put back in the pending map, so check again
+  // after each batch
+  while (true) {
+    dropped = (mPending.erase(pair_key) != 0) || dropped;
+
+    if (mShutdown || (mInFlight.find(pair_key) == mInFlight.end())) {
+      break;
+    }
+
+    waited = true;
+    mCvDone.wait(lock);
+  }
+
+  return (dropped && !waited);
+}
+
+//------------------------------------------------------------------------------
+// Get value of a hash field not yet persisted in the backend
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::getPending(const std::string& key, const std::string& field,
+                            std::string& value) const
+{
+  auto pair_key = std::make_pair(key, field);
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // The pending mutations are more recent than the in-flight ones
+  for (const MutationMap* map : {&mPending, &mInFlight}) {
+    auto it = map->find(pair_key);
+
+    if (it == map->end()) {
+      continue;
+    }
+
+    if (it->second.mType == OpType::kHset) {
+      value = it->second.mValue;
+      return true;
+    } else if (it->second.mType == OpType::kHdel) {
+      value.clear();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// Flush barrier
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::synchronize()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  std::uint64_t target = mEnqueuedSeq;
+  std::uint64_t num_failures = mNumFailures;
+  mCvFlush.notify_one();
+  mCvDone.wait(lock, [&] {
+    return (mFlushedSeq >= target) || (mNumFailures != num_failures);
+  });
+  return (mFlushedSeq >= target);
+}
+
+//------------------------------------------------------------------------------
+// Get number of mutations not yet acknowledged
+//------------------------------------------------------------------------------
+std::uint64_t
+MetadataFlusher::getNumPending() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mPending.size() + mInFlight.size();
+}
+
+//------------------------------------------------------------------------------
+// Get number of failed flush attempts
+//------------------------------------------------------------------------------
+std::uint64_t
+MetadataFlusher::getNumFailures() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mNumFailures;
+}
+
+//------------------------------------------------------------------------------
+// Send batch to the backend
+//------------------------------------------------------------------------------
+bool
+MetadataFlusher::flushBatch(const MutationMap& batch)
+{
+  std::vector<std::future<qclient::redisReplyPtr>> replies;
+  replies.reserve(batch.size() + 2);
+
+  try {
+    std::vector<std::string> cmd {"MULTI"};
+    replies.push_back(mQcl->execute(cmd));
+
+    // First pass sends the hash mutations, the second one the set mutations
+    for (int pass = 0; pass < 2; ++pass) {
+      for (const auto& elem : batch) {
+        const std::string& key = elem.first.first;
+        const std::string& field = elem.first.second;
+
+        switch (elem.second.mType) {
+        case OpType::kHset:
+          if (pass == 0) {
+            cmd = {"HSET", key, field, elem.second.mValue};
+            replies.push_back(mQcl->execute(cmd));
+          }
+
+          break;
+
+        case OpType::kHdel:
+          if (pass == 0) {
+            cmd = {"HDEL", key, field};
+            replies.push_back(mQcl->execute(cmd));
+          }
+
+          break;
+
+        case OpType::kSadd:
+          if (pass == 1) {
+            cmd = {"SADD", key, field};
+            replies.push_back(mQcl->execute(cmd));
+          }
+
+          break;
+
+        case OpType::kSrem:
+          if (pass == 1) {
+            cmd = {"SREM", key, field};
+            replies.push_back(mQcl->execute(cmd));
+          }
+
+          break;
+        }
+      }
+    }
+
+    cmd = {"EXEC"};
+    replies.push_back(mQcl->execute(cmd));
+  } catch (std::runtime_error& qdb_err) {
+    eos_static_err("msg=\"failed to send metadata batch\" err=\"%s\"",
+                   qdb_err.what());
+
+    for (auto& reply : replies) {
+      reply.wait();
+    }
+
+    return false;
+  }
+
+  // MULTI and the mutations are only acknowledged as queued, the replies of
+  // the mutations are the elements of the EXEC reply
+  bool ok = true;
+
+  for (size_t i = 0; i + 1 < replies.size(); ++i) {
+    qclient::redisReplyPtr reply = replies[i].get();
+
+    if (ok && (!reply || (reply->type != REDIS_REPLY_STATUS))) {
+      std::string err = "no reply";
+
+      if (reply && (reply->type == REDIS_REPLY_ERROR)) {
+        err.assign(reply->str, reply->len);
+      }
+
+      eos_static_err("msg=\"metadata mutation not queued in transaction\" "
+                     "pos=%lu err=\"%s\"", i, err.c_str());
+      ok = false;
+    }
+  }
+
+  qclient::redisReplyPtr reply = replies.back().get();
+
+  if (!ok) {
+    return false;
+  }
+
+  if (!reply || (reply->type != REDIS_REPLY_ARRAY) ||
+      (reply->elements != replies.size() - 2)) {
+    eos_static_err("msg=\"metadata transaction not applied\" size=%lu",
+                   batch.size());
+    return false;
+  }
+
+  for (size_t i = 0; i < reply->elements; ++i) {
+    if (reply->element[i]->type == REDIS_REPLY_ERROR) {
+      // The other mutations of the transaction are applied, retrying the
+      // whole batch is harmless since it only holds the latest values
+      eos_static_err("msg=\"metadata mutation failed\" pos=%lu err=\"%s\"",
+                     i, std::string(reply->element[i]->str,
+                                    reply->element[i]->len).c_str());
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// Flusher thread loop
+//------------------------------------------------------------------------------
+void
+MetadataFlusher::flusherThread()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  std::uint32_t num_failures = 0;
+
+  while (true) {
+    if (mPending.empty()) {
+      // Entries might have been dropped by a fence, nothing left to wait for
+      mFlushedSeq = mEnqueuedSeq;
+      mCvDone.notify_all();
+
+      if (mShutdown) {
+        break;
+      }
+
+      mCvFlush.wait_for(lock, mInterval);
+      continue;
+    }
+
+    std::uint64_t batch_seq = mEnqueuedSeq;
+    mInFlight.swap(mPending);
+    // The in-flight map is only modified by this thread so it's safe to read
+    // it without the lock while the batch is being sent
+    lock.unlock();
+    bool ok = flushBatch(mInFlight);
+    lock.lock();
+
+    if (ok) {
+      mFlushedSeq = batch_seq;
+      mFailing = false;
+      num_failures = 0;
+    } else {
+      // The mutations were already acknowledged to the callers, keep them
+      // until the backend accepts them - re-queue only the ones that were
+      // not superseded in the meantime
+      mFailing = true;
+      ++mNumFailures;
+      ++num_failures;
+
+      for (auto& elem : mInFlight) {
+        (void) mPending.insert(elem);
+      }
+
+      if (mShutdown) {
+        eos_static_crit("msg=\"failed to flush metadata journal at shutdown, "
+                        "retrying\" pending=%lu attempt=%u", mPending.size(),
+                        num_failures);
+      } else {
+        eos_static_err("msg=\"failed to flush metadata batch, retrying\" "
+                       "size=%lu pending=%lu attempt=%u", mInFlight.size(),
+                       mPending.size(), num_failures);
+      }
+    }
+
+    mInFlight.clear();
+    mCvDone.notify_all();
+
+    if (!ok) {
+      // Back off exponentially, producers filling the journal and flush
+      // barriers must not shorten the delay
+      std::chrono::seconds delay = sMaxRetryDelay;
+
+      if (num_failures < 6) {
+        delay = std::min(delay, std::chrono::seconds(1 << (num_failures - 1)));
+      }
+
+      auto deadline = std::chrono::steady_clock::now() + delay;
+
+      while (std::chrono::steady_clock::now() < deadline) {
+        mCvFlush.wait_until(lock, deadline);
+      }
+    }
+  }
+}
+
+EOSNSNAMESPACE_END
@@ -0,0 +1,235 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @author Elvin-Alin Sindrilaru <esindril@cern.ch>
+//! @brief Write-back journal for metadata mutations sent to the backend
+//------------------------------------------------------------------------------
+
+#ifndef __EOS_NS_METADATA_FLUSHER_HH__
+#define __EOS_NS_METADATA_FLUSHER_HH__
+
+#include "namespace/Namespace.hh"
+#include "namespace/ns_quarkdb/BackendClient.hh"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+EOSNSNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Write-back journal for namespace objects
+//!
+//! Mutations are coalesced in memory per (key, field) pair so that only the
+//! latest value of an object reaches the backend. An asynchronous thread takes
+//! the whole accumulated journal every flush interval and sends it as one
+//! MULTI/EXEC transaction on a dedicated connection, waiting for the reply
+//! before taking the next one. A batch is therefore applied entirely or not
+//! at all, so the file, container and fs view keys it touches stay
+//! consistent after a crash. Since there is a single flusher thread and one
+//! entry per (key, field), the mutations of a given object always reach the
+//! backend in the order in which they were issued. Hash mutations of a batch
+//! are sent before the set ones so that a "dirty" marker is never dropped
+//! before the object it guards.
+//!
+//! Mutations are acknowledged to the caller as soon as they are queued, so
+//! they are never discarded: a failed batch is retried with an increasing
+//! delay until the backend accepts it, also at shutdown. The journal is
+//! bounded: producers wait for the flusher once it holds sMaxPending
+//! mutations and, if the backend is failing, new mutations are rejected
+//! without being queued so that the callers can report the error.
+//------------------------------------------------------------------------------
+class MetadataFlusher
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param host backend host, empty for the default one
+  //! @param port backend port, 0 for the default one
+  //! @param interval flush interval
+  //----------------------------------------------------------------------------
+  MetadataFlusher(const std::string& host, uint32_t port,
+                  std::chrono::milliseconds interval =
+                    std::chrono::milliseconds(5));
+
+  //----------------------------------------------------------------------------
+  //! Destructor - flushes all pending mutations before returning, retrying
+  //! for as long as the backend is unavailable
+  //----------------------------------------------------------------------------
+  virtual ~MetadataFlusher();
+
+  //----------------------------------------------------------------------------
+  //! Queue a HSET mutation
+  //!
+  //! @param key hash key
+  //! @param field hash field
+  //! @param value new value
+  //!
+  //! @return true if queued, false if the journal is full and the backend
+  //!         is failing in which case the mutation was not queued
+  //----------------------------------------------------------------------------
+  bool hset(const std::string& key, const std::string& field,
+            const std::string& value);
+
+  //----------------------------------------------------------------------------
+  //! Queue a HDEL mutation
+  //!
+  //! @param key hash key
+  //! @param field hash field
+  //!
+  //! @return true if queued, false if the journal is full and the backend
+  //!         is failing in which case the mutation was not queued
+  //----------------------------------------------------------------------------
+  bool hdel(const std::string& key, const std::string& field);
+
+  //----------------------------------------------------------------------------
+  //! Queue a SADD mutation
+  //!
+  //! @param key set key
+  //! @param member set member
+  //!
+  //! @return true if queued, false if the journal is full and the backend
+  //!         is failing in which case the mutation was not queued
+  //----------------------------------------------------------------------------
+  bool sadd(const std::string& key, const std::string& member);
+
+  //----------------------------------------------------------------------------
+  //! Queue a SREM mutation
+  //!
+  //! @param key set key
+  //! @param member set member
+  //!
+  //! @return true if queued, false if the journal is full and the backend
+  //!         is failing in which case the mutation was not queued
+  //----------------------------------------------------------------------------
+  bool srem(const std::string& key, const std::string& member);
+
+  //----------------------------------------------------------------------------
+  //! Make sure no mutation of the given (key, field) queued so far can reach
+  //! the backend after a request which the caller sends directly: a pending
+  //! mutation is dropped and an in-flight one is waited for.
+  //!
+  //! @param key hash or set key
+  //! @param field hash field or set member
+  //!
+  //! @return true if a pending mutation was dropped and none was in flight,
+  //!         otherwise false
+  //----------------------------------------------------------------------------
+  bool fence(const std::string& key, const std::string& field);
+
+  //----------------------------------------------------------------------------
+  //! Get the value of a hash field which is not yet persisted in the backend.
+  //! This provides the read-your-writes overlay for objects evicted from the
+  //! cache before the journal was flushed.
+  //!
+  //! @param key hash key
+  //! @param field hash field
+  //! @param value value of the field, empty if the field is being deleted
+  //!
+  //! @return true if there is a pending mutation for the field, otherwise
+  //!         false in which case the backend holds the latest value
+  //----------------------------------------------------------------------------
+  bool getPending(const std::string& key, const std::string& field,
+                  std::string& value) const;
+
+  //----------------------------------------------------------------------------
+  //! Flush barrier - block until all the mutations queued before this call
+  //! are acknowledged by the backend or until a flush attempt fails. In the
+  //! latter case the mutations stay queued and are retried.
+  //!
+  //! @return true if all the mutations were persisted, otherwise false
+  //----------------------------------------------------------------------------
+  bool synchronize();
+
+  //----------------------------------------------------------------------------
+  //! Get number of mutations not yet acknowledged by the backend
+  //----------------------------------------------------------------------------
+  std::uint64_t getNumPending() const;
+
+  //----------------------------------------------------------------------------
+  //! Get number of failed flush attempts
+  //----------------------------------------------------------------------------
+  std::uint64_t getNumFailures() const;
+
+private:
+  //! Max number of mutations held in the journal
+  static const std::uint64_t sMaxPending;
+  //! Max delay between two attempts to flush a failed batch
+  static const std::chrono::seconds sMaxRetryDelay;
+
+  //! Type of mutation
+  enum class OpType { kHset, kHdel, kSadd, kSrem };
+
+  //! Pending mutation
+  struct Mutation {
+    OpType mType; ///< Type of mutation
+    std::string mValue; ///< New value for hset
+  };
+
+  //! Mutations indexed by (key, field/member)
+  using MutationMap = std::map<std::pair<std::string, std::string>, Mutation>;
+
+  //----------------------------------------------------------------------------
+  //! Add mutation to the journal overwriting any previous one for the same
+  //! (key, field) pair
+  //!
+  //! @return true if queued, false if rejected because the journal is full
+  //!         and the backend is failing
+  //----------------------------------------------------------------------------
+  bool enqueue(const std::string& key, const std::string& field,
+               OpType type, const std::string& value = "");
+
+  //----------------------------------------------------------------------------
+  //! Send batch of mutations to the backend as one transaction and wait for
+  //! the reply
+  //!
+  //! @param batch mutations to be sent
+  //!
+  //! @return true if the transaction was applied, otherwise false
+  //----------------------------------------------------------------------------
+  bool flushBatch(const MutationMap& batch);
+
+  //----------------------------------------------------------------------------
+  //! Method ran by the asynchronous flusher thread
+  //----------------------------------------------------------------------------
+  void flusherThread();
+
+  std::unique_ptr<qclient::QClient> mQcl; ///< Dedicated backend connection
+  std::chrono::milliseconds mInterval; ///< Flush interval
+  mutable std::mutex mMutex; ///< Mutex protecting the journal
+  std::condition_variable mCvFlush; ///< Wake up the flusher thread
+  std::condition_variable mCvDone; ///< Notify waiters that a batch finished
+  MutationMap mPending; ///< Mutations accumulated since the last batch
+  MutationMap mInFlight; ///< Mutations sent but not yet acknowledged
+  std::uint64_t mEnqueuedSeq; ///< Sequence number of the last mutation
+  std::uint64_t mFlushedSeq; ///< Sequence number of last acknowledged mutation
+  std::uint64_t mNumFailures; ///< Number of failed flush attempts
+  bool mFailing; ///< Last flush attempt failed
+  bool mShutdown; ///< Flag to shutdown the flusher thread
+  std::thread mThread; ///< Flusher thread
+};
+
+EOSNSNAMESPACE_END
+
+#endif // __EOS_NS_METADATA_FLUSHER_HH__
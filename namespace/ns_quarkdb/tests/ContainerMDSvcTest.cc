@@ -24,7 +24,11 @@
 #include "namespace/ns_quarkdb/persistency/ContainerMDSvc.hh"
 #include "namespace/ns_quarkdb/persistency/FileMDSvc.hh"
 #include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <iomanip>
 
 //------------------------------------------------------------------------------
 // ContainerMDSvcTest class
@@ -34,9 +38,11 @@ class ContainerMDSvcTest : public CppUnit::TestCase
 public:
   CPPUNIT_TEST_SUITE(ContainerMDSvcTest);
   CPPUNIT_TEST(loadTest);
+  CPPUNIT_TEST(listEntriesTest);
   CPPUNIT_TEST_SUITE_END();
 
   void loadTest();
+  void listEntriesTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ContainerMDSvcTest);
@@ -154,3 +160,70 @@ ContainerMDSvcTest::loadTest()
     CPPUNIT_ASSERT_MESSAGE(e.getMessage().str(), false);
   }
 }
+
+//------------------------------------------------------------------------------
+// Paginated listing of a container not loaded in memory
+//------------------------------------------------------------------------------
+void
+ContainerMDSvcTest::listEntriesTest()
+{
+  try {
+    std::unique_ptr<eos::IContainerMDSvc> containerSvc{new eos::ContainerMDSvc()};
+    std::unique_ptr<eos::IFileMDSvc> fileSvc{new eos::FileMDSvc()};
+    std::map<std::string, std::string> config = {{"qdb_host", "localhost"},
+      {"qdb_port", "6380"}
+    };
+    containerSvc->setFileMDService(fileSvc.get());
+    containerSvc->configure(config);
+    containerSvc->initialize();
+    std::shared_ptr<eos::IContainerMD> parent = containerSvc->createContainer();
+    eos::IContainerMD::id_t id = parent->getId();
+    parent->setName("parent");
+    containerSvc->updateStore(parent.get());
+    // More than one backend page of subcontainers
+    const size_t num_conts = 2500;
+    std::set<std::string> expected;
+
+    for (size_t i = 0; i < num_conts; ++i) {
+      std::ostringstream oss;
+      oss << "cont_" << std::setw(5) << std::setfill('0') << (i * 7919) % 10007;
+      std::shared_ptr<eos::IContainerMD> cont = containerSvc->createContainer();
+      cont->setName(oss.str());
+      parent->addContainer(cont.get());
+      containerSvc->updateStore(cont.get());
+      expected.insert(oss.str());
+    }
+
+    containerSvc->finalize();
+    containerSvc->initialize();
+    parent = containerSvc->getContainerMD(id);
+    CPPUNIT_ASSERT_EQUAL(num_conts, parent->getNumContainers());
+    CPPUNIT_ASSERT(parent->findContainer(*expected.rbegin()) != nullptr);
+    CPPUNIT_ASSERT(parent->findContainer("cont_missing") == nullptr);
+    // List in pages and make sure the entries come in name order
+    std::vector<std::string> listed;
+    std::vector<std::string> entries;
+    std::string token;
+
+    do {
+      token = parent->listEntries(token, 100, entries);
+      CPPUNIT_ASSERT(entries.size() <= 100);
+      listed.insert(listed.end(), entries.begin(), entries.end());
+    } while (!token.empty());
+
+    CPPUNIT_ASSERT_EQUAL(num_conts, listed.size());
+    CPPUNIT_ASSERT(std::equal(listed.begin(), listed.end(), expected.begin()));
+    // Resume listing from a given entry
+    auto it = expected.find(listed[1500]);
+    token = parent->listEntries(listed[1500], 10, entries);
+    CPPUNIT_ASSERT_EQUAL((size_t)10, entries.size());
+    CPPUNIT_ASSERT(std::equal(entries.begin(), entries.end(), ++it));
+    CPPUNIT_ASSERT(token == entries.back());
+    // Clean up
+    parent->cleanUp();
+    containerSvc->removeContainer(parent.get());
+    containerSvc->finalize();
+  } catch (eos::MDException& e) {
+    CPPUNIT_ASSERT_MESSAGE(e.getMessage().str(), false);
+  }
+}
@@ -41,10 +41,12 @@ public:
   CPPUNIT_TEST_SUITE(FileMDSvcTest);
   CPPUNIT_TEST(loadTest);
   CPPUNIT_TEST(checkFileTest);
+  CPPUNIT_TEST(writeBackTest);
   CPPUNIT_TEST_SUITE_END();
 
   void loadTest();
   void checkFileTest();
+  void writeBackTest();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(FileMDSvcTest);
@@ -208,3 +210,39 @@ FileMDSvcTest::checkFileTest()
   view->removeFile(file.get());
   view->removeContainer("/test_dir", true);
 }
+
+//------------------------------------------------------------------------------
+// Updates are queued in the write-back journal and only reach the backend
+// after a flush barrier.
+//------------------------------------------------------------------------------
+void
+FileMDSvcTest::writeBackTest()
+{
+  std::map<std::string, std::string> config = {
+    {"qdb_host", "localhost"},
+    {"qdb_port", "6380"},
+    {"qdb_flush_interval_ms", "60000"}
+  };
+  std::unique_ptr<eos::IContainerMDSvc> contSvc{new eos::ContainerMDSvc};
+  std::unique_ptr<eos::IFileMDSvc> fileSvc{new eos::FileMDSvc};
+  fileSvc->setContMDService(contSvc.get());
+  fileSvc->configure(config);
+  CPPUNIT_ASSERT_NO_THROW(fileSvc->initialize());
+  std::shared_ptr<eos::IFileMD> file = fileSvc->createFile();
+  CPPUNIT_ASSERT(file != nullptr);
+  file->setName("write_back_file");
+  eos::IFileMD::id_t fid = file->getId();
+  std::string sfid = std::to_string(fid);
+  fileSvc->updateStore(file.get());
+  qclient::QClient* qcl = eos::BackendClient::getInstance(
+                            config["qdb_host"], std::stoi(config["qdb_port"]));
+  std::string bucket_key =
+    static_cast<eos::FileMDSvc*>(fileSvc.get())->getBucketKey(fid);
+  qclient::QHash bucket_map(*qcl, bucket_key);
+  CPPUNIT_ASSERT(!bucket_map.hexists(sfid));
+  fileSvc->finalize();
+  CPPUNIT_ASSERT(bucket_map.hexists(sfid));
+  CPPUNIT_ASSERT_NO_THROW(fileSvc->removeFile(file.get()));
+  fileSvc->finalize();
+  CPPUNIT_ASSERT(!bucket_map.hexists(sfid));
+}
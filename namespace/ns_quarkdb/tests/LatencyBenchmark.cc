@@ -0,0 +1,392 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @author Elvin-Alin Sindrilaru <esindril@cern.ch>
+//! @brief Per-operation latency benchmark for the QuarkDB namespace
+//!
+//! The benchmark runs either against an in-process redis-protocol stand-in
+//! with injected latency and jitter or against a live backend. For every
+//! operation it reports the latency percentiles and, when using the stand-in,
+//! the number of backend requests per operation which is independent of the
+//! machine speed and can be checked in CI with --max-requests.
+//------------------------------------------------------------------------------
+
+#include "namespace/ns_quarkdb/persistency/ContainerMDSvc.hh"
+#include "namespace/ns_quarkdb/persistency/FileMDSvc.hh"
+#include "namespace/ns_quarkdb/views/HierarchicalView.hh"
+#include "namespace/ns_quarkdb/tests/RespStandIn.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//! Latency samples of one operation
+//------------------------------------------------------------------------------
+struct OpStats {
+  std::vector<double> mLatencyUs; ///< Latency samples
+  uint64_t mNumRequests = 0; ///< Backend requests done by the operation
+
+  //----------------------------------------------------------------------------
+  //! Get percentile of the latency samples, they must be sorted
+  //----------------------------------------------------------------------------
+  double
+  percentile(double pct) const
+  {
+    if (mLatencyUs.empty()) {
+      return 0;
+    }
+
+    size_t idx = static_cast<size_t>(pct / 100.0 * (mLatencyUs.size() - 1));
+    return mLatencyUs[idx];
+  }
+
+  //----------------------------------------------------------------------------
+  //! Get average number of backend requests per operation
+  //----------------------------------------------------------------------------
+  double
+  requestsPerOp() const
+  {
+    return (mLatencyUs.empty() ? 0.0 :
+            static_cast<double>(mNumRequests) / mLatencyUs.size());
+  }
+};
+
+static std::map<std::string, OpStats> sStats;
+static std::unique_ptr<eos::RespStandIn> sStandIn;
+
+//------------------------------------------------------------------------------
+// Measure one operation
+//------------------------------------------------------------------------------
+template <typename Func>
+static void
+measure(const std::string& op, Func func)
+{
+  uint64_t num_req = (sStandIn ? sStandIn->getNumCommands() : 0);
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  OpStats& stats = sStats[op];
+  stats.mLatencyUs.push_back(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+    1000.0);
+
+  if (sStandIn) {
+    stats.mNumRequests += sStandIn->getNumCommands() - num_req;
+  }
+}
+
+//------------------------------------------------------------------------------
+// File size mapping function
+//------------------------------------------------------------------------------
+static uint64_t
+mapSize(const eos::IFileMD* /*file*/)
+{
+  return 0u;
+}
+
+//------------------------------------------------------------------------------
+// Boot the namespace - every boot starts with empty caches
+//------------------------------------------------------------------------------
+static eos::IView*
+bootNamespace(const std::map<std::string, std::string>& config)
+{
+  eos::IContainerMDSvc* contSvc = new eos::ContainerMDSvc();
+  eos::IFileMDSvc* fileSvc = new eos::FileMDSvc();
+  eos::IView* view = new eos::HierarchicalView();
+  fileSvc->configure(config);
+  contSvc->configure(config);
+  fileSvc->setContMDService(contSvc);
+  contSvc->setFileMDService(fileSvc);
+  view->setContainerMDSvc(contSvc);
+  view->setFileMDSvc(fileSvc);
+  view->configure(config);
+  view->getQuotaStats()->registerSizeMapper(mapSize);
+  view->initialize();
+  return view;
+}
+
+//------------------------------------------------------------------------------
+// Close the namespace flushing all pending updates
+//------------------------------------------------------------------------------
+static void
+closeNamespace(eos::IView* view)
+{
+  eos::IContainerMDSvc* contSvc = view->getContainerMDSvc();
+  eos::IFileMDSvc* fileSvc = view->getFileMDSvc();
+  view->finalize();
+  delete view;
+  delete contSvc;
+  delete fileSvc;
+}
+
+//------------------------------------------------------------------------------
+// Print usage
+//------------------------------------------------------------------------------
+static void
+printUsage()
+{
+  std::cerr << "Usage: eosnslatbench [options]" << std::endl
+            << "  --qdb <host:port>      use live backend instead of the "
+            << "in-process stand-in" << std::endl
+            << "  --latency-us <val>     injected round-trip latency "
+            << "(stand-in only, default 200)" << std::endl
+            << "  --jitter-us <val>      max injected jitter "
+            << "(stand-in only, default 50)" << std::endl
+            << "  --dirs <val>           number of directories (default 16)"
+            << std::endl
+            << "  --files <val>          files per directory (default 256)"
+            << std::endl
+            << "  --max-requests <op>=<val>  fail if the operation needs "
+            << "more backend requests on average (stand-in only, repeatable)"
+            << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+  std::string qdb_host = "127.0.0.1";
+  std::string qdb_port;
+  long latency_us = 200;
+  long jitter_us = 50;
+  size_t num_dirs = 16;
+  size_t num_files = 256;
+  std::map<std::string, double> max_requests;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string opt = argv[i];
+
+    if ((opt == "-h") || (opt == "--help") || (i + 1 >= argc)) {
+      printUsage();
+      return 1;
+    }
+
+    std::string val = argv[++i];
+
+    if (opt == "--qdb") {
+      size_t pos = val.find(':');
+
+      if (pos == std::string::npos) {
+        printUsage();
+        return 1;
+      }
+
+      qdb_host = val.substr(0, pos);
+      qdb_port = val.substr(pos + 1);
+    } else if (opt == "--latency-us") {
+      latency_us = std::stol(val);
+    } else if (opt == "--jitter-us") {
+      jitter_us = std::stol(val);
+    } else if (opt == "--dirs") {
+      num_dirs = std::stoul(val);
+    } else if (opt == "--files") {
+      num_files = std::stoul(val);
+    } else if (opt == "--max-requests") {
+      size_t pos = val.find('=');
+
+      if (pos == std::string::npos) {
+        printUsage();
+        return 1;
+      }
+
+      max_requests[val.substr(0, pos)] = std::stod(val.substr(pos + 1));
+    } else {
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (qdb_port.empty()) {
+    sStandIn.reset(new eos::RespStandIn(std::chrono::microseconds(latency_us),
+                                        std::chrono::microseconds(jitter_us)));
+    int port = sStandIn->start();
+
+    if (port < 0) {
+      std::cerr << "[!] Error: failed to start the backend stand-in" << std::endl;
+      return 2;
+    }
+
+    qdb_port = std::to_string(port);
+    std::cerr << "[i] Backend stand-in on port " << port << " latency="
+              << latency_us << "us jitter=" << jitter_us << "us" << std::endl;
+  }
+
+  // Long flush interval so that the background flusher does not interfere
+  // with the measurements, the journal is flushed when closing the namespace
+  std::map<std::string, std::string> config = {
+    {"qdb_host", qdb_host}, {"qdb_port", qdb_port},
+    {"qdb_flush_interval_ms", "60000"}
+  };
+  std::vector<std::string> dir_paths;
+  std::vector<std::string> file_paths;
+  std::vector<eos::IContainerMD::id_t> cont_ids;
+  std::vector<eos::IFileMD::id_t> file_ids;
+
+  try {
+    // Populate the namespace
+    eos::IView* view = bootNamespace(config);
+
+    for (size_t i = 0; i < num_dirs; ++i) {
+      char path[1024];
+      snprintf(path, sizeof(path), "/eos/latbench/dir_%06zu/", i);
+      dir_paths.emplace_back(path);
+      measure("createContainer", [&]() {
+        cont_ids.push_back(view->createContainer(path, true)->getId());
+      });
+
+      for (size_t j = 0; j < num_files; ++j) {
+        snprintf(path, sizeof(path), "/eos/latbench/dir_%06zu/file_%08zu", i, j);
+        file_paths.emplace_back(path);
+        measure("createFile", [&]() {
+          file_ids.push_back(view->createFile(path, 0, 0)->getId());
+        });
+      }
+    }
+
+    for (const auto& path : file_paths) {
+      std::shared_ptr<eos::IFileMD> fmd = view->getFile(path);
+      fmd->addLocation(1);
+      fmd->addLocation(2);
+      fmd->setSize(4096);
+      measure("updateStore", [&]() {
+        view->updateFileStore(fmd.get());
+      });
+    }
+
+    closeNamespace(view);
+    // Lookups by id, cold and warm caches
+    view = bootNamespace(config);
+
+    for (auto fid : file_ids) {
+      measure("getFileMD-uncached", [&]() {
+        (void) view->getFileMDSvc()->getFileMD(fid);
+      });
+    }
+
+    for (auto fid : file_ids) {
+      measure("getFileMD-cached", [&]() {
+        (void) view->getFileMDSvc()->getFileMD(fid);
+      });
+    }
+
+    for (auto cid : cont_ids) {
+      measure("getContainerMD-uncached", [&]() {
+        (void) view->getContainerMDSvc()->getContainerMD(cid);
+      });
+    }
+
+    for (auto cid : cont_ids) {
+      measure("getContainerMD-cached", [&]() {
+        (void) view->getContainerMDSvc()->getContainerMD(cid);
+      });
+    }
+
+    closeNamespace(view);
+    // Path lookups, cold and warm caches
+    view = bootNamespace(config);
+
+    for (const auto& path : file_paths) {
+      measure("pathLookup-uncached", [&]() {
+        (void) view->getFile(path);
+      });
+    }
+
+    for (const auto& path : file_paths) {
+      measure("pathLookup-cached", [&]() {
+        (void) view->getFile(path);
+      });
+    }
+
+    closeNamespace(view);
+    // Directory listings, cold and warm caches
+    view = bootNamespace(config);
+
+    for (const std::string& suffix : {
+           "-uncached", "-cached"
+         }) {
+      for (const auto& path : dir_paths) {
+        measure("listing" + suffix, [&]() {
+          std::shared_ptr<eos::IContainerMD> cont = view->getContainer(path);
+          std::vector<std::string> entries;
+          std::string token;
+
+          do {
+            token = cont->listEntries(token, 1000, entries);
+          } while (!token.empty());
+        });
+      }
+    }
+
+    closeNamespace(view);
+  } catch (eos::MDException& e) {
+    std::cerr << "[!] Error: " << e.getMessage().str() << std::endl;
+    return 2;
+  }
+
+  // Report
+  int retc = 0;
+  fprintf(stdout, "# %-24s %8s %9s %10s %10s %10s %10s %10s\n", "operation",
+          "count", "req/op", "p50[us]", "p90[us]", "p99[us]", "p99.9[us]",
+          "max[us]");
+
+  for (auto& elem : sStats) {
+    OpStats& stats = elem.second;
+    std::sort(stats.mLatencyUs.begin(), stats.mLatencyUs.end());
+    fprintf(stdout, "%-26s %8zu %9.2f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+            elem.first.c_str(), stats.mLatencyUs.size(), stats.requestsPerOp(),
+            stats.percentile(50), stats.percentile(90), stats.percentile(99),
+            stats.percentile(99.9), stats.mLatencyUs.back());
+  }
+
+  fprintf(stdout, "%s", eos::BackendClient::getPoolStats().c_str());
+
+  // Check the round-trip budgets
+  for (const auto& elem : max_requests) {
+    auto it = sStats.find(elem.first);
+
+    if (!sStandIn) {
+      std::cerr << "[!] Warning: request budgets are only checked against "
+                << "the stand-in backend" << std::endl;
+      break;
+    }
+
+    if (it == sStats.end()) {
+      std::cerr << "[!] Error: unknown operation " << elem.first << std::endl;
+      retc = 3;
+    } else if (it->second.requestsPerOp() > elem.second) {
+      std::cerr << "[!] Error: " << elem.first << " needs "
+                << it->second.requestsPerOp() << " backend requests per "
+                << "operation, budget is " << elem.second << std::endl;
+      retc = 3;
+    }
+  }
+
+  if (sStandIn) {
+    sStandIn->stop();
+  }
+
+  return retc;
+}
@@ -0,0 +1,656 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#include "namespace/ns_quarkdb/tests/RespStandIn.hh"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+EOSNSNAMESPACE_BEGIN
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Reply encoding helpers
+//------------------------------------------------------------------------------
+std::string
+encodeInt(long long value)
+{
+  return ":" + std::to_string(value) + "\r\n";
+}
+
+std::string
+encodeBulk(const std::string& value)
+{
+  return "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+}
+
+std::string
+encodeNil()
+{
+  return "$-1\r\n";
+}
+
+std::string
+encodeError(const std::string& msg)
+{
+  return "-" + msg + "\r\n";
+}
+
+std::string
+encodeArray(const std::vector<std::string>& elems)
+{
+  std::string out = "*" + std::to_string(elems.size()) + "\r\n";
+
+  for (const auto& elem : elems) {
+    out += encodeBulk(elem);
+  }
+
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Encode scan reply i.e. cursor followed by the array of elements
+//------------------------------------------------------------------------------
+std::string
+encodeScan(const std::string& cursor, const std::vector<std::string>& elems)
+{
+  return "*2\r\n" + encodeBulk(cursor) + encodeArray(elems);
+}
+
+//------------------------------------------------------------------------------
+// Parse one request in the redis protocol
+//
+// @param buf input buffer
+// @param pos position where the request starts, updated if complete
+// @param args parsed arguments
+//
+// @return 1 if a full request was parsed, 0 if more data is needed and -1
+//         if the input is malformed
+//------------------------------------------------------------------------------
+int
+parseRequest(const std::string& buf, size_t& pos,
+             std::vector<std::string>& args)
+{
+  size_t cur = pos;
+  args.clear();
+
+  auto read_line = [&](std::string & line) {
+    size_t end = buf.find("\r\n", cur);
+
+    if (end == std::string::npos) {
+      return false;
+    }
+
+    line = buf.substr(cur, end - cur);
+    cur = end + 2;
+    return true;
+  };
+
+  std::string line;
+
+  if (!read_line(line)) {
+    return 0;
+  }
+
+  if (line.empty() || (line[0] != '*')) {
+    return -1;
+  }
+
+  long num_args = std::strtol(line.c_str() + 1, nullptr, 10);
+
+  for (long i = 0; i < num_args; ++i) {
+    if (!read_line(line)) {
+      return 0;
+    }
+
+    if (line.empty() || (line[0] != '$')) {
+      return -1;
+    }
+
+    size_t len = std::strtoul(line.c_str() + 1, nullptr, 10);
+
+    if (buf.length() < cur + len + 2) {
+      return 0;
+    }
+
+    args.emplace_back(buf.substr(cur, len));
+    cur += len + 2;
+  }
+
+  pos = cur;
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Parse the COUNT option of a scan command
+//------------------------------------------------------------------------------
+size_t
+parseScanCount(const std::vector<std::string>& args)
+{
+  for (size_t i = 3; i + 1 < args.size(); i += 2) {
+    std::string opt = args[i];
+    std::transform(opt.begin(), opt.end(), opt.begin(), ::toupper);
+
+    if (opt == "COUNT") {
+      return std::max(1ul, std::strtoul(args[i + 1].c_str(), nullptr, 10));
+    }
+  }
+
+  return 10;
+}
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+RespStandIn::RespStandIn(std::chrono::microseconds latency,
+                         std::chrono::microseconds jitter):
+  mLatency(latency), mJitter(jitter), mRandom(42), mNumCommands(0),
+  mListenFd(-1), mShutdown(false)
+{}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+RespStandIn::~RespStandIn()
+{
+  stop();
+}
+
+//------------------------------------------------------------------------------
+// Start listening
+//------------------------------------------------------------------------------
+int
+RespStandIn::start(int port)
+{
+  mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+  if (mListenFd < 0) {
+    return -1;
+  }
+
+  int on = 1;
+  (void) setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  socklen_t len = sizeof(addr);
+
+  if (bind(mListenFd, (struct sockaddr*) &addr, sizeof(addr)) ||
+      listen(mListenFd, 64) ||
+      getsockname(mListenFd, (struct sockaddr*) &addr, &len)) {
+    close(mListenFd);
+    mListenFd = -1;
+    return -1;
+  }
+
+  mShutdown = false;
+  mAcceptThread = std::thread(&RespStandIn::acceptLoop, this);
+  return ntohs(addr.sin_port);
+}
+
+//------------------------------------------------------------------------------
+// Stop server
+//------------------------------------------------------------------------------
+void
+RespStandIn::stop()
+{
+  if (mListenFd < 0) {
+    return;
+  }
+
+  mShutdown = true;
+  (void) shutdown(mListenFd, SHUT_RDWR);
+  mAcceptThread.join();
+  close(mListenFd);
+  mListenFd = -1;
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(mConnMutex);
+
+    for (auto fd : mConnFds) {
+      (void) shutdown(fd, SHUT_RDWR);
+    }
+
+    threads.swap(mConnThreads);
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+//------------------------------------------------------------------------------
+// Change the injected latency
+//------------------------------------------------------------------------------
+void
+RespStandIn::setLatency(std::chrono::microseconds latency,
+                        std::chrono::microseconds jitter)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLatency = latency;
+  mJitter = jitter;
+}
+
+//------------------------------------------------------------------------------
+// Get delay for the current round-trip
+//------------------------------------------------------------------------------
+std::chrono::microseconds
+RespStandIn::getDelay()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mJitter.count() <= 0) {
+    return mLatency;
+  }
+
+  std::uniform_int_distribution<long long> dist(0, mJitter.count());
+  return mLatency + std::chrono::microseconds(dist(mRandom));
+}
+
+//------------------------------------------------------------------------------
+// Accept incoming connections
+//------------------------------------------------------------------------------
+void
+RespStandIn::acceptLoop()
+{
+  while (!mShutdown) {
+    int fd = accept(mListenFd, nullptr, nullptr);
+
+    if (fd < 0) {
+      if (mShutdown) {
+        break;
+      }
+
+      continue;
+    }
+
+    int on = 1;
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::lock_guard<std::mutex> lock(mConnMutex);
+    mConnFds.push_back(fd);
+    mConnThreads.emplace_back(&RespStandIn::serveConnection, this, fd);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Serve requests of one connection
+//------------------------------------------------------------------------------
+void
+RespStandIn::serveConnection(int fd)
+{
+  std::string buf;
+  std::vector<std::string> args;
+  // Commands queued between MULTI and EXEC
+  std::vector<std::vector<std::string>> queued;
+  bool in_multi = false;
+  char chunk[64 * 1024];
+
+  while (!mShutdown) {
+    ssize_t nread = recv(fd, chunk, sizeof(chunk), 0);
+
+    if (nread <= 0) {
+      break;
+    }
+
+    // All the requests received together are answered after one round-trip
+    auto deadline = std::chrono::steady_clock::now() + getDelay();
+    buf.append(chunk, nread);
+    std::string out;
+    size_t pos = 0;
+    int rc;
+
+    while ((rc = parseRequest(buf, pos, args)) == 1) {
+      std::string cmd = (args.empty() ? "" : args[0]);
+      std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+
+      if (cmd == "MULTI") {
+        out += (in_multi ? encodeError("ERR MULTI calls can not be nested") :
+                "+OK\r\n");
+        in_multi = true;
+      } else if (cmd == "EXEC") {
+        if (in_multi) {
+          out += executeMulti(queued);
+          queued.clear();
+          in_multi = false;
+        } else {
+          out += encodeError("ERR EXEC without MULTI");
+        }
+      } else if (in_multi) {
+        queued.push_back(args);
+        out += "+QUEUED\r\n";
+      } else {
+        out += execute(args);
+      }
+    }
+
+    if (rc < 0) {
+      out += encodeError("ERR protocol error");
+      buf.clear();
+    } else {
+      buf.erase(0, pos);
+    }
+
+    std::this_thread::sleep_until(deadline);
+    size_t sent = 0;
+
+    while (sent < out.length()) {
+      ssize_t nsent = send(fd, out.data() + sent, out.length() - sent,
+                           MSG_NOSIGNAL);
+
+      if (nsent <= 0) {
+        break;
+      }
+
+      sent += nsent;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mConnMutex);
+  mConnFds.erase(std::remove(mConnFds.begin(), mConnFds.end(), fd),
+                 mConnFds.end());
+  close(fd);
+}
+
+//------------------------------------------------------------------------------
+// Get value of the given type for the key
+//------------------------------------------------------------------------------
+RespStandIn::Value*
+RespStandIn::getValue(const std::string& key, bool is_hash, bool create,
+                      bool& err)
+{
+  err = false;
+  auto it = mData.find(key);
+
+  if (it == mData.end()) {
+    if (!create) {
+      return nullptr;
+    }
+
+    it = mData.emplace(key, Value()).first;
+    it->second.mIsHash = is_hash;
+  }
+
+  if (it->second.mIsHash != is_hash) {
+    err = true;
+    return nullptr;
+  }
+
+  return &it->second;
+}
+
+//------------------------------------------------------------------------------
+// Execute command
+//------------------------------------------------------------------------------
+std::string
+RespStandIn::execute(const std::vector<std::string>& args)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return executeLocked(args);
+}
+
+//------------------------------------------------------------------------------
+// Execute the commands of a transaction
+//------------------------------------------------------------------------------
+std::string
+RespStandIn::executeMulti(const std::vector<std::vector<std::string>>& cmds)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  std::string out = "*" + std::to_string(cmds.size()) + "\r\n";
+
+  for (const auto& args : cmds) {
+    out += executeLocked(args);
+  }
+
+  return out;
+}
+
+//------------------------------------------------------------------------------
+// Execute command with the data mutex held
+//------------------------------------------------------------------------------
+std::string
+RespStandIn::executeLocked(const std::vector<std::string>& args)
+{
+  static const std::string sWrongType =
+    "WRONGTYPE Operation against a key holding the wrong kind of value";
+  static const std::string sWrongArgs = "ERR wrong number of arguments";
+
+  if (args.empty()) {
+    return encodeError("ERR empty command");
+  }
+
+  ++mNumCommands;
+  std::string cmd = args[0];
+  std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+  bool err = false;
+  Value* val = nullptr;
+
+  if (cmd == "PING") {
+    return "+PONG\r\n";
+  } else if ((cmd == "DEL") || (cmd == "EXISTS")) {
+    long long num = 0;
+
+    for (size_t i = 1; i < args.size(); ++i) {
+      if (cmd == "DEL") {
+        num += mData.erase(args[i]);
+      } else {
+        num += mData.count(args[i]);
+      }
+    }
+
+    return encodeInt(num);
+  } else if (cmd == "FLUSHALL") {
+    mData.clear();
+    return "+OK\r\n";
+  } else if (cmd.length() && (cmd[0] == 'H')) {
+    if (args.size() < 2) {
+      return encodeError(sWrongArgs);
+    }
+
+    bool create = ((cmd == "HSET") || (cmd == "HSETNX") || (cmd == "HINCRBY"));
+    val = getValue(args[1], true, create, err);
+
+    if (err) {
+      return encodeError(sWrongType);
+    }
+
+    if ((cmd == "HGET") || (cmd == "HEXISTS")) {
+      if (args.size() != 3) {
+        return encodeError(sWrongArgs);
+      }
+
+      if (val) {
+        auto it = val->mHash.find(args[2]);
+
+        if (it != val->mHash.end()) {
+          return ((cmd == "HGET") ? encodeBulk(it->second) : encodeInt(1));
+        }
+      }
+
+      return ((cmd == "HGET") ? encodeNil() : encodeInt(0));
+    } else if ((cmd == "HSET") || (cmd == "HSETNX")) {
+      if ((args.size() < 4) || (args.size() % 2)) {
+        return encodeError(sWrongArgs);
+      }
+
+      long long num = 0;
+
+      for (size_t i = 2; i + 1 < args.size(); i += 2) {
+        auto ret = val->mHash.emplace(args[i], args[i + 1]);
+
+        if (ret.second) {
+          ++num;
+        } else if (cmd == "HSET") {
+          ret.first->second = args[i + 1];
+        }
+      }
+
+      return encodeInt(num);
+    } else if (cmd == "HINCRBY") {
+      if (args.size() != 4) {
+        return encodeError(sWrongArgs);
+      }
+
+      std::string& field = val->mHash[args[2]];
+      long long num = std::strtoll(field.c_str(), nullptr, 10) +
+                      std::strtoll(args[3].c_str(), nullptr, 10);
+      field = std::to_string(num);
+      return encodeInt(num);
+    } else if (cmd == "HDEL") {
+      long long num = 0;
+
+      for (size_t i = 2; val && (i < args.size()); ++i) {
+        num += val->mHash.erase(args[i]);
+      }
+
+      if (val && val->mHash.empty()) {
+        mData.erase(args[1]);
+      }
+
+      return encodeInt(num);
+    } else if (cmd == "HLEN") {
+      return encodeInt(val ? val->mHash.size() : 0);
+    } else if ((cmd == "HGETALL") || (cmd == "HKEYS")) {
+      std::vector<std::string> elems;
+
+      if (val) {
+        for (const auto& elem : val->mHash) {
+          elems.push_back(elem.first);
+
+          if (cmd == "HGETALL") {
+            elems.push_back(elem.second);
+          }
+        }
+      }
+
+      return encodeArray(elems);
+    } else if (cmd == "HSCAN") {
+      if (args.size() < 3) {
+        return encodeError(sWrongArgs);
+      }
+
+      std::vector<std::string> elems;
+      std::string cursor = "0";
+
+      if (val) {
+        auto it = val->mHash.begin();
+
+        if (args[2].compare(0, 5, "next:") == 0) {
+          it = val->mHash.lower_bound(args[2].substr(5));
+        }
+
+        for (size_t num = parseScanCount(args);
+             (it != val->mHash.end()) && num; ++it, --num) {
+          elems.push_back(it->first);
+          elems.push_back(it->second);
+        }
+
+        if (it != val->mHash.end()) {
+          cursor = "next:" + it->first;
+        }
+      }
+
+      return encodeScan(cursor, elems);
+    }
+  } else if (cmd.length() && (cmd[0] == 'S')) {
+    if (args.size() < 2) {
+      return encodeError(sWrongArgs);
+    }
+
+    val = getValue(args[1], false, (cmd == "SADD"), err);
+
+    if (err) {
+      return encodeError(sWrongType);
+    }
+
+    if (cmd == "SADD") {
+      long long num = 0;
+
+      for (size_t i = 2; i < args.size(); ++i) {
+        num += (val->mSet.insert(args[i]).second ? 1 : 0);
+      }
+
+      return encodeInt(num);
+    } else if (cmd == "SREM") {
+      long long num = 0;
+
+      for (size_t i = 2; val && (i < args.size()); ++i) {
+        num += val->mSet.erase(args[i]);
+      }
+
+      if (val && val->mSet.empty()) {
+        mData.erase(args[1]);
+      }
+
+      return encodeInt(num);
+    } else if (cmd == "SCARD") {
+      return encodeInt(val ? val->mSet.size() : 0);
+    } else if (cmd == "SISMEMBER") {
+      if (args.size() != 3) {
+        return encodeError(sWrongArgs);
+      }
+
+      return encodeInt((val && val->mSet.count(args[2])) ? 1 : 0);
+    } else if (cmd == "SMEMBERS") {
+      std::vector<std::string> elems;
+
+      if (val) {
+        elems.assign(val->mSet.begin(), val->mSet.end());
+      }
+
+      return encodeArray(elems);
+    } else if (cmd == "SSCAN") {
+      if (args.size() < 3) {
+        return encodeError(sWrongArgs);
+      }
+
+      std::vector<std::string> elems;
+      std::string cursor = "0";
+
+      if (val) {
+        auto it = val->mSet.begin();
+
+        if (args[2].compare(0, 5, "next:") == 0) {
+          it = val->mSet.lower_bound(args[2].substr(5));
+        }
+
+        for (size_t num = parseScanCount(args);
+             (it != val->mSet.end()) && num; ++it, --num) {
+          elems.push_back(*it);
+        }
+
+        if (it != val->mSet.end()) {
+          cursor = "next:" + *it;
+        }
+      }
+
+      return encodeScan(cursor, elems);
+    }
+  }
+
+  return encodeError("ERR unknown command '" + args[0] + "'");
+}
+
+EOSNSNAMESPACE_END
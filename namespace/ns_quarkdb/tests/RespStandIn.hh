@@ -0,0 +1,171 @@
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @author Elvin-Alin Sindrilaru <esindril@cern.ch>
+//! @brief In-process redis-protocol backend with latency injection
+//------------------------------------------------------------------------------
+
+#ifndef __EOS_NS_TESTS_RESP_STAND_IN_HH__
+#define __EOS_NS_TESTS_RESP_STAND_IN_HH__
+
+#include "namespace/Namespace.hh"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+EOSNSNAMESPACE_BEGIN
+
+//------------------------------------------------------------------------------
+//! Minimal redis-protocol server used as a stand-in for QuarkDB in benchmarks
+//! and tests. It implements the hash, set and key commands used by the
+//! namespace with the QuarkDB scan semantics i.e. fields are returned in
+//! lexicographical order and the cursor is "next:<field>". Commands sent
+//! between MULTI and EXEC on a connection are applied atomically.
+//!
+//! Every batch of requests read from a connection is answered after the
+//! configured latency plus a uniformly distributed jitter, which models the
+//! network round-trip: pipelined requests pay the latency only once.
+//------------------------------------------------------------------------------
+class RespStandIn
+{
+public:
+  //----------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param latency injected latency per round-trip
+  //! @param jitter max jitter added on top of the latency
+  //----------------------------------------------------------------------------
+  RespStandIn(std::chrono::microseconds latency = std::chrono::microseconds(0),
+              std::chrono::microseconds jitter = std::chrono::microseconds(0));
+
+  //----------------------------------------------------------------------------
+  //! Destructor
+  //----------------------------------------------------------------------------
+  ~RespStandIn();
+
+  //----------------------------------------------------------------------------
+  //! Start listening on the local interface
+  //!
+  //! @param port port to listen on, 0 to pick a free one
+  //!
+  //! @return port the server listens on, -1 if failed
+  //----------------------------------------------------------------------------
+  int start(int port = 0);
+
+  //----------------------------------------------------------------------------
+  //! Stop server and close all the connections
+  //----------------------------------------------------------------------------
+  void stop();
+
+  //----------------------------------------------------------------------------
+  //! Change the injected latency
+  //----------------------------------------------------------------------------
+  void setLatency(std::chrono::microseconds latency,
+                  std::chrono::microseconds jitter);
+
+  //----------------------------------------------------------------------------
+  //! Get number of commands executed so far
+  //----------------------------------------------------------------------------
+  inline uint64_t
+  getNumCommands() const
+  {
+    return mNumCommands.load();
+  }
+
+  //----------------------------------------------------------------------------
+  //! Execute a command - exposed for testing without a connection
+  //!
+  //! @param args command and arguments
+  //!
+  //! @return reply encoded in the redis protocol
+  //----------------------------------------------------------------------------
+  std::string execute(const std::vector<std::string>& args);
+
+private:
+  //! Stored value, a key holds either a hash or a set
+  struct Value {
+    bool mIsHash; ///< Hash if true, otherwise set
+    std::map<std::string, std::string> mHash; ///< Hash fields
+    std::set<std::string> mSet; ///< Set members
+  };
+
+  //----------------------------------------------------------------------------
+  //! Accept incoming connections
+  //----------------------------------------------------------------------------
+  void acceptLoop();
+
+  //----------------------------------------------------------------------------
+  //! Serve requests of one connection
+  //----------------------------------------------------------------------------
+  void serveConnection(int fd);
+
+  //----------------------------------------------------------------------------
+  //! Execute command with the data mutex held
+  //----------------------------------------------------------------------------
+  std::string executeLocked(const std::vector<std::string>& args);
+
+  //----------------------------------------------------------------------------
+  //! Execute the commands of a transaction without interleaving the ones of
+  //! other connections
+  //!
+  //! @return EXEC reply holding the reply of every command
+  //----------------------------------------------------------------------------
+  std::string executeMulti(const std::vector<std::vector<std::string>>& cmds);
+
+  //----------------------------------------------------------------------------
+  //! Get value of the given type for the key
+  //!
+  //! @param key key
+  //! @param is_hash requested type
+  //! @param create create the value if it does not exist
+  //! @param err set to true if the key holds a different type
+  //!
+  //! @return value or nullptr if it does not exist
+  //----------------------------------------------------------------------------
+  Value* getValue(const std::string& key, bool is_hash, bool create,
+                  bool& err);
+
+  //----------------------------------------------------------------------------
+  //! Get random delay to apply for the current round-trip
+  //----------------------------------------------------------------------------
+  std::chrono::microseconds getDelay();
+
+  std::mutex mMutex; ///< Mutex protecting the data and the latency settings
+  std::map<std::string, Value> mData; ///< Stored keys
+  std::chrono::microseconds mLatency; ///< Injected latency
+  std::chrono::microseconds mJitter; ///< Max jitter
+  std::mt19937_64 mRandom; ///< Jitter generator
+  std::atomic<uint64_t> mNumCommands; ///< Number of executed commands
+  int mListenFd; ///< Listening socket
+  std::atomic<bool> mShutdown; ///< Flag to stop the server
+  std::thread mAcceptThread; ///< Thread accepting connections
+  std::mutex mConnMutex; ///< Mutex protecting the connections
+  std::vector<int> mConnFds; ///< Open connections
+  std::vector<std::thread> mConnThreads; ///< Connection threads
+};
+
+EOSNSNAMESPACE_END
+
+#endif // __EOS_NS_TESTS_RESP_STAND_IN_HH__
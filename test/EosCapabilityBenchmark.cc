@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+// File: EosCapabilityBenchmark.cc
+// Author: Andreas-Joachim Peters - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @file EosCapabilityBenchmark.cc
+//! @brief Create/extract rate and size of the legacy and compact capabilities
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include "authz/XrdCapability.hh"
+#include "common/SymKeys.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdOuc/XrdOucEnv.hh"
+/*----------------------------------------------------------------------------*/
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Run benchmark for one capability format
+//------------------------------------------------------------------------------
+static bool
+RunBenchmark(const char* name, XrdCapability::Format format,
+             const std::string& capability, int loops)
+{
+  eos::common::SymKey* symkey = eos::common::gSymKeyStore.GetCurrentKey();
+  XrdOucEnv incapability(capability.c_str());
+  XrdOucEnv* capenv = 0;
+  int caplen = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < loops; ++i) {
+    delete capenv;
+    capenv = 0;
+
+    if (XrdCapability::Create(&incapability, capenv, symkey, 3600, format)) {
+      fprintf(stderr, "error: failed to create %s capability\n", name);
+      return false;
+    }
+  }
+
+  auto middle = std::chrono::steady_clock::now();
+  XrdOucEnv* outenv = 0;
+
+  for (int i = 0; i < loops; ++i) {
+    if (XrdCapability::Extract(capenv, outenv)) {
+      fprintf(stderr, "error: failed to extract %s capability\n", name);
+      delete capenv;
+      delete outenv;
+      return false;
+    }
+  }
+
+  auto stop = std::chrono::steady_clock::now();
+  double create_sec = std::chrono::duration<double>(middle - start).count();
+  double extract_sec = std::chrono::duration<double>(stop - middle).count();
+  fprintf(stdout, "%-8s create %10.0f Hz extract %10.0f Hz length %6d bytes\n",
+          name, loops / create_sec, loops / extract_sec,
+          (int) strlen(capenv->Env(caplen)));
+  delete capenv;
+  delete outenv;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int loops = 100000;
+
+  if (argc > 1) {
+    loops = atoi(argv[1]);
+  }
+
+  if (loops <= 0) {
+    fprintf(stderr, "usage: eoscapbench [<loops>]\n");
+    return EINVAL;
+  }
+
+  char key[SHA_DIGEST_LENGTH + 1];
+
+  for (int i = 0; i < SHA_DIGEST_LENGTH; ++i) {
+    key[i] = (char)(rand() & 0xff);
+  }
+
+  key[SHA_DIGEST_LENGTH] = 0;
+  eos::common::gSymKeyStore.SetKey(key, 0);
+  // Typical capability of a replica file opened for reading
+  std::string capability = "&mgm.access=read&mgm.ruid=12345&mgm.rgid=1338"
+                           "&mgm.uid=12345&mgm.gid=1338"
+                           "&mgm.path=/eos/user/e/example/data/run0001/file.root"
+                           "&mgm.manager=eosmgm.cern.ch:1094&mgm.fid=00a1b2c3"
+                           "&mgm.cid=123456&mgm.sec=krb5|example|host.cern.ch"
+                           "||example|||&mgm.lid=1048850&mgm.bookingsize=0"
+                           "&mgm.fsid=17&mgm.localprefix=/data17"
+                           "&mgm.url0=root://fst1.cern.ch:1095//&mgm.fsid0=17"
+                           "&mgm.url1=root://fst2.cern.ch:1095//&mgm.fsid1=42";
+
+  if (!RunBenchmark("legacy", XrdCapability::Format::kLegacy, capability,
+                    loops) ||
+      !RunBenchmark("compact", XrdCapability::Format::kCompact, capability,
+                    loops)) {
+    return EIO;
+  }
+
+  return 0;
+}
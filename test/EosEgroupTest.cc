@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+// File: EosEgroupTest.cc
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2017 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! @file EosEgroupTest.cc
+//! @brief Test of the egroup cache against a local stand-in for LDAP
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include "mgm/Egroup.hh"
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using eos::mgm::Egroup;
+using eos::mgm::EgroupLookup;
+
+//------------------------------------------------------------------------------
+//! Stand-in for the LDAP server answering from a local membership table
+//------------------------------------------------------------------------------
+class MockEgroupLookup : public EgroupLookup
+{
+public:
+  MockEgroupLookup(): mQueries(0), mLastBatch(0) {}
+
+  bool Query(const std::string& username, const std::set<std::string>& egroups,
+             std::set<std::string>& members)
+  {
+    // make concurrent requests overlap with the query
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueries++;
+    mLastBatch = egroups.size();
+
+    for (auto it = egroups.begin(); it != egroups.end(); ++it) {
+      if (mMembers[username].count(*it)) {
+        members.insert(*it);
+      }
+    }
+
+    return true;
+  }
+
+  void SetMember(const std::string& username, const std::string& egroup)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMembers[username].insert(egroup);
+  }
+
+  std::atomic<int> mQueries;
+  std::atomic<size_t> mLastBatch;
+
+private:
+  std::mutex mMutex;
+  std::map<std::string, std::set<std::string>> mMembers;
+};
+
+//------------------------------------------------------------------------------
+// Check a membership
+//------------------------------------------------------------------------------
+static bool
+IsMember(const char* user, const char* egroup)
+{
+  std::string username = user;
+  std::string egroupname = egroup;
+  return Egroup::Member(username, egroupname);
+}
+
+#define EXPECT(cond)                                                    \
+  if (!(cond)) {                                                        \
+    fprintf(stdout, "Test FAILED: %s (line %d)\n", #cond, __LINE__);    \
+    egroup.Stop();                                                      \
+    return -1;                                                          \
+  }
+
+int main(void)
+{
+  std::shared_ptr<MockEgroupLookup> mock(new MockEgroupLookup());
+  mock->SetMember("alice", "eg-a");
+  Egroup::SetLookup(mock);
+  Egroup egroup;
+
+  if (!egroup.Start()) {
+    fprintf(stdout, "Test FAILED: cannot start the refresh thread\n");
+    return -1;
+  }
+
+  // concurrent first lookups of the same pair issue a single query
+  std::vector<std::thread> threads;
+  std::atomic<int> members(0);
+
+  for (int i = 0; i < 8; i++) {
+    threads.push_back(std::thread([&members]() {
+      if (IsMember("alice", "eg-a")) {
+        members++;
+      }
+    }));
+  }
+
+  for (auto it = threads.begin(); it != threads.end(); ++it) {
+    it->join();
+  }
+
+  EXPECT(members == 8);
+  EXPECT(mock->mQueries == 1);
+  EXPECT(!IsMember("alice", "eg-b"));
+  EXPECT(!IsMember("alice", "eg-c"));
+  EXPECT(mock->mQueries == 3);
+  // cached entries don't query
+  EXPECT(IsMember("alice", "eg-a"));
+  EXPECT(!IsMember("alice", "eg-b"));
+  EXPECT(mock->mQueries == 3);
+  // entries which are due return the cached value without blocking and are
+  // refreshed with a single query for the user
+  {
+    std::lock_guard<std::mutex> lock(Egroup::Mutex);
+
+    for (auto it = Egroup::Map["alice"].begin(); it != Egroup::Map["alice"].end();
+         ++it) {
+      it->second.refresh = 0;
+    }
+  }
+  mock->SetMember("alice", "eg-b");
+  auto start = std::chrono::steady_clock::now();
+  EXPECT(!IsMember("alice", "eg-b"));
+  EXPECT(IsMember("alice", "eg-a"));
+  EXPECT(std::chrono::steady_clock::now() - start <
+         std::chrono::milliseconds(100));
+
+  for (int i = 0; (i < 50) && (mock->mQueries < 4); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  EXPECT(mock->mQueries == 4);
+  EXPECT(mock->mLastBatch == 3);
+  EXPECT(IsMember("alice", "eg-b"));
+  EXPECT(!IsMember("alice", "eg-c"));
+  EXPECT(mock->mQueries == 4);
+  egroup.Stop();
+  fprintf(stdout, "Test SUCCEEDED. \n");
+  return 0;
+}